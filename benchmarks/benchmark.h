@@ -0,0 +1,74 @@
+/**
+   @file
+   @brief helpers shared by the benchmarks
+*/
+
+#ifndef PGMLINK_BENCHMARK_H
+#define PGMLINK_BENCHMARK_H
+
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pgmlink/tracking_statistics.h"
+
+namespace pgmlink {
+namespace benchmark {
+
+/// high water mark of the resident set size of the process in kB; 0 where unknown
+inline long peak_memory_kb() {
+  return peak_rss_kb();
+}
+
+/**
+ * Wall time of a phase over all repetitions, the number of items (e.g.
+ * mergers) it processed and the peak memory after it.
+ */
+struct Phase {
+  explicit Phase(const std::string& name)
+      : name(name), seconds(0.), items(0), peak_memory_kb(0) {}
+
+  std::string name;
+  double seconds;
+  size_t items;
+  long peak_memory_kb;
+};
+
+inline void report(std::ostream& out, const std::vector<Phase>& phases, size_t repetitions) {
+  out << std::left << std::setw(28) << "phase"
+      << std::right << std::setw(14) << "seconds/run"
+      << std::setw(14) << "items/s"
+      << std::setw(16) << "peak RSS [kB]" << '\n';
+  for (std::vector<Phase>::const_iterator it = phases.begin(); it != phases.end(); ++it) {
+    out << std::left << std::setw(28) << it->name
+        << std::right << std::setw(14) << std::setprecision(6) << it->seconds / repetitions
+        << std::setw(14) << std::setprecision(6)
+        << (it->seconds > 0 ? it->items / it->seconds : 0.)
+        << std::setw(16) << it->peak_memory_kb << '\n';
+  }
+}
+
+/**
+ * Machine readable variant of report(): one comma separated line per
+ * phase, starting with the (already comma separated) parameters of the
+ * run. Lines of several runs and builds can be concatenated.
+ */
+inline void report_csv(std::ostream& out, const std::string& parameters, const std::vector<Phase>& phases,
+                       size_t repetitions) {
+  for (std::vector<Phase>::const_iterator it = phases.begin(); it != phases.end(); ++it) {
+    out << parameters << ',' << it->name << ',' << std::setprecision(9) << it->seconds / repetitions << ','
+        << (it->seconds > 0 ? it->items / it->seconds : 0.) << ',' << it->peak_memory_kb << '\n';
+  }
+}
+
+/// the columns of report_csv() after the parameters
+inline const char* csv_columns() {
+  return "phase,seconds_per_run,items_per_second,peak_rss_kb";
+}
+
+} /* namespace benchmark */
+} /* namespace pgmlink */
+
+#endif /* PGMLINK_BENCHMARK_H */
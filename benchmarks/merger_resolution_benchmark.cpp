@@ -0,0 +1,254 @@
+// Times the phases of the merger resolution on synthetic scenes:
+// calculate_gmm_beforehand(), MergerResolver::resolve_mergers(),
+// resolve_graph() and the division handling of the resolution subgraph.
+//
+// A scene consists of groups of 2 to max_objects objects that are tracked
+// on their own in the first and last timestep and merged in between.
+
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include "pgmlink/feature.h"
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/merger_resolving.h"
+#include "pgmlink/tracking_statistics.h"
+#include "pgmlink/traxels.h"
+
+#include "benchmark.h"
+
+using namespace pgmlink;
+using namespace std;
+namespace po = boost::program_options;
+
+namespace {
+struct SceneParameters {
+  size_t mergers;
+  int timesteps;
+  size_t object_size;
+  int max_objects;
+  int dimensions;
+  double division_fraction;
+  unsigned seed;
+};
+
+class SceneBuilder {
+ public:
+  SceneBuilder(const SceneParameters& p, HypothesesGraph& g, unsigned seed)
+      : p_(p), g_(g), rng_(seed), normal_(rng_, boost::normal_distribution<double>(0., 2.)) {
+    g_.add(node_traxel()).add(arc_distance()).add(arc_active()).add(node_active2()).add(division_active());
+  }
+
+  // returns the number of merger nodes
+  size_t build() {
+    boost::uniform_01<boost::mt19937&> uniform(rng_);
+    size_t n_mergers = 0;
+    for (size_t group = 0; group < p_.mergers; ++group) {
+      const int k = 2 + static_cast<int>(group % static_cast<size_t>(p_.max_objects - 1));
+      const double x0 = 100. * group;
+
+      vector<HypothesesGraph::Node> first;
+      for (int i = 0; i < k; ++i) {
+        first.push_back(add_object(0, object_centers(x0, 0, i, i + 1), 1));
+      }
+      if (uniform() < p_.division_fraction) {
+        // the other daughter of the first object is a track of its own
+        g_.get(division_active()).set(first[0], true);
+        connect(first[0], add_object(1, object_centers(x0 + 50., 1, 0, 1), 1));
+      }
+
+      HypothesesGraph::Node previous = lemon::INVALID;
+      for (int t = 1; t < p_.timesteps - 1; ++t) {
+        const HypothesesGraph::Node merger = add_object(t, object_centers(x0, t, 0, k), k);
+        ++n_mergers;
+        if (t == 1) {
+          for (int i = 0; i < k; ++i) {
+            connect(first[i], merger);
+          }
+        } else {
+          connect(previous, merger);
+        }
+        previous = merger;
+      }
+
+      for (int i = 0; i < k; ++i) {
+        connect(previous, add_object(p_.timesteps - 1, object_centers(x0, p_.timesteps - 1, i, i + 1), 1));
+      }
+    }
+    return n_mergers;
+  }
+
+ private:
+  // centers of the objects [begin, end) of a group in timestep t, 3 values each
+  vector<double> object_centers(double x0, int t, int begin, int end) const {
+    vector<double> centers;
+    for (int i = begin; i < end; ++i) {
+      centers.push_back(x0 + 10. * i + t);
+      centers.push_back(t);
+      centers.push_back(p_.dimensions == 3 ? 5. * i : 0.);
+    }
+    return centers;
+  }
+
+  HypothesesGraph::Node add_object(int t, const vector<double>& centers, int count) {
+    Traxel trax;
+    trax.Timestep = t;
+    trax.Id = ++max_ids_[t];
+    feature_array& coordinates = trax.features["coordinates"];
+    feature_array com(3, 0.);
+    for (size_t c = 0; c < centers.size(); c += 3) {
+      for (size_t pixel = 0; pixel < p_.object_size; ++pixel) {
+        for (int d = 0; d < 3; ++d) {
+          coordinates.push_back(d < p_.dimensions ? centers[c + d] + normal_() : 0.);
+        }
+      }
+      for (int d = 0; d < 3; ++d) {
+        com[d] += centers[c + d] / count;
+      }
+    }
+    trax.features["com"] = com;
+
+    const HypothesesGraph::Node n = g_.add_node(t);
+    g_.get(node_traxel()).set(n, trax);
+    g_.get(node_active2()).set(n, count);
+    return n;
+  }
+
+  void connect(HypothesesGraph::Node from, HypothesesGraph::Node to) {
+    const HypothesesGraph::Arc a = g_.addArc(from, to);
+    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g_.get(node_traxel());
+    g_.get(arc_distance()).set(a, traxel_map[from].distance_to(traxel_map[to]));
+    g_.get(arc_active()).set(a, true);
+  }
+
+  const SceneParameters& p_;
+  HypothesesGraph& g_;
+  boost::mt19937 rng_;
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<double> > normal_;
+  map<int, unsigned> max_ids_;
+};
+}
+
+int main(int argc, char** argv) {
+  SceneParameters p;
+  size_t repetitions;
+  bool with_components, with_assignment;
+  po::options_description options("merger_resolution_benchmark options");
+  options.add_options()
+      ("help,h", "show this message")
+      ("mergers,m", po::value<size_t>(&p.mergers)->default_value(100), "merged groups of objects")
+      ("timesteps,t", po::value<int>(&p.timesteps)->default_value(4), "timesteps, the groups are merged in all but the first and the last")
+      ("object-size,s", po::value<size_t>(&p.object_size)->default_value(200), "pixels per object")
+      ("max-objects,k", po::value<int>(&p.max_objects)->default_value(3), "largest number of objects in a merger")
+      ("dimensions,d", po::value<int>(&p.dimensions)->default_value(2), "spatial dimensions, 2 or 3")
+      ("divisions", po::value<double>(&p.division_fraction)->default_value(0.1), "fraction of groups with a division that enters the merger")
+      ("seed", po::value<unsigned>(&p.seed)->default_value(42), "seed of the scenes")
+      ("repetitions,r", po::value<size_t>(&repetitions)->default_value(3), "scenes to time, the results are averaged")
+      ("with-components", po::bool_switch(&with_components), "solve the components in resolve_graph() separately")
+      ("with-assignment", po::bool_switch(&with_assignment), "also time ResolveAmbiguousArcsPgm");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+  } catch (std::exception& e) {
+    cerr << e.what() << '\n' << options;
+    return 1;
+  }
+  if (vm.count("help")) {
+    cout << options;
+    return 0;
+  }
+  if (p.max_objects < 2 || p.timesteps < 3 || (p.dimensions != 2 && p.dimensions != 3) || repetitions == 0) {
+    cerr << "requires max-objects >= 2, timesteps >= 3, dimensions 2 or 3 and repetitions >= 1\n";
+    return 1;
+  }
+
+  vector<benchmark::Phase> phases;
+  phases.push_back(benchmark::Phase("calculate_gmm_beforehand"));
+  phases.push_back(benchmark::Phase("resolve_mergers"));
+  phases.push_back(benchmark::Phase("resolve_graph"));
+  phases.push_back(benchmark::Phase("duplicate_division_nodes"));
+  phases.push_back(benchmark::Phase("merge_split_divisions"));
+  if (with_assignment) {
+    phases.push_back(benchmark::Phase("ResolveAmbiguousArcsPgm"));
+  }
+
+  try {
+    for (size_t run = 0; run < repetitions; ++run) {
+      HypothesesGraph g;
+      const size_t n_mergers = SceneBuilder(p, g, p.seed + run).build();
+      for (size_t i = 0; i < 3; ++i) {
+        phases[i].items += n_mergers;
+      }
+
+      PhaseTimer timer;
+      calculate_gmm_beforehand(g, 1, p.dimensions);
+      timer.stop(phases[0].seconds);
+      phases[0].peak_memory_kb = benchmark::peak_memory_kb();
+
+      MergerResolver resolver(&g);
+      FeatureExtractorMCOMsFromMCOMs extractor;
+      DistanceFromCOMs distance;
+      FeatureHandlerFromTraxels handler(extractor, distance);
+      timer = PhaseTimer();
+      resolver.resolve_mergers(handler);
+      timer.stop(phases[1].seconds);
+      phases[1].peak_memory_kb = benchmark::peak_memory_kb();
+
+      HypothesesGraph g_res;
+      timer = PhaseTimer();
+      resolve_graph(g, g_res, NegLnTransition(1), 0.01, false, 5, true, with_components);
+      timer.stop(phases[2].seconds);
+      phases[2].peak_memory_kb = benchmark::peak_memory_kb();
+
+      // the division handling of resolve_graph() on a fresh copy of the
+      // resolution subgraph
+      HypothesesGraph subgraph;
+      subgraph.add(division_active()).add(arc_active());
+      NodeCrossReference nr, ncr;
+      ArcCrossReference ar, acr;
+      copy_hypotheses_graph_subset<node_resolution_candidate, arc_resolution_candidate>(g, subgraph, nr, ar, ncr, acr);
+      translate_property_bool_map<division_active, HypothesesGraph::Node>(g, subgraph, nr);
+      const size_t n_divisions = subgraph.get(division_active()).trueNum();
+      phases[3].items += n_divisions;
+      phases[4].items += n_divisions;
+
+      map<HypothesesGraph::Node, HypothesesGraph::Node> division_splits;
+      map<HypothesesGraph::Arc, HypothesesGraph::Arc> arc_cross_reference;
+      timer = PhaseTimer();
+      duplicate_division_nodes(subgraph, division_splits, arc_cross_reference);
+      timer.stop(phases[3].seconds);
+      phases[3].peak_memory_kb = benchmark::peak_memory_kb();
+      merge_split_divisions(subgraph, division_splits, arc_cross_reference);
+      timer.stop(phases[4].seconds);
+      phases[4].peak_memory_kb = benchmark::peak_memory_kb();
+
+      if (with_assignment) {
+        phases[5].items += n_mergers;
+        ResolveAmbiguousArcsPgm assignment(NegLnTransition(1), 5);
+        timer = PhaseTimer();
+        assignment(&g);
+        timer.stop(phases[5].seconds);
+        phases[5].peak_memory_kb = benchmark::peak_memory_kb();
+      }
+    }
+  } catch (std::exception& e) {
+    cerr << "merger_resolution_benchmark: " << e.what() << '\n';
+    return 1;
+  }
+
+  cout << repetitions << " scenes with " << p.mergers << " groups of up to " << p.max_objects
+       << " objects of " << p.object_size << " pixels in " << p.timesteps << " timesteps ("
+       << p.dimensions << "D); items are mergers resp. divisions\n";
+  benchmark::report(cout, phases, repetitions);
+  return 0;
+}
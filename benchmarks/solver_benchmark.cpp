@@ -0,0 +1,195 @@
+// Size of the ConservationTracking model and the time to formulate and
+// solve it on a fixed synthetic data set (see synthetic_dataset.h), for
+// every combination of max_number_objects, with_tracklets, with_divisions
+// and with_constraints given on the command line.
+//
+// The data set has detection probabilities for the largest
+// max_number_objects; smaller models use the first states. It is generated
+// again with the same seed for every run, as the tracker modifies it.
+
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "pgmlink/tracking.h"
+#include "pgmlink/tracking_statistics.h"
+#include "pgmlink/traxels.h"
+
+#include "benchmark.h"
+#include "synthetic_dataset.h"
+
+using namespace pgmlink;
+using namespace std;
+namespace po = boost::program_options;
+
+namespace {
+struct Configuration {
+  int max_number_objects;
+  bool with_tracklets;
+  bool with_divisions;
+  bool with_constraints;
+};
+
+struct Result {
+  Result() : formulate_seconds(0), infer_seconds(0), constraints_seconds(0), peak_memory_kb(0) {}
+
+  SolverStatistics solver;
+  double formulate_seconds;
+  double infer_seconds;
+  double constraints_seconds;
+  long peak_memory_kb;
+};
+
+// the switches given on the command line, both values by default
+vector<bool> switches(const vector<int>& values) {
+  vector<bool> result;
+  for (size_t i = 0; i < values.size(); ++i) {
+    result.push_back(values[i] != 0);
+  }
+  if (result.empty()) {
+    result.push_back(false);
+    result.push_back(true);
+  }
+  return result;
+}
+
+Result run(const Configuration& c, const benchmark::SyntheticDatasetParameters& p, double max_distance,
+           size_t repetitions) {
+  Result result;
+  for (size_t r = 0; r < repetitions; ++r) {
+    TraxelStore ts;
+    const benchmark::SyntheticDatasetSummary summary = benchmark::generate_dataset(p, ts);
+    const FieldOfView fov = benchmark::dataset_field_of_view(p, summary);
+    ConsTracking tracking(c.max_number_objects, max_distance, 0.3, "none", false, 0, 0.01, 30., c.with_tracklets,
+                          10., 10., c.with_divisions, 500., 500., false, p.dimensions, 5., 0, fov,
+                          c.with_constraints);
+    tracking.set_with_statistics(true);
+    tracking(ts);
+    const TrackingStatistics& s = tracking.statistics();
+    result.solver = s.solver;
+    result.formulate_seconds += s.formulate_seconds;
+    result.infer_seconds += s.infer_seconds;
+    result.constraints_seconds += s.solver.constraints_seconds;
+  }
+  result.formulate_seconds /= repetitions;
+  result.infer_seconds /= repetitions;
+  result.constraints_seconds /= repetitions;
+  result.peak_memory_kb = benchmark::peak_memory_kb();
+  return result;
+}
+
+void report(const Configuration& c, const Result& r, bool csv) {
+  if (csv) {
+    cout << c.max_number_objects << ',' << c.with_tracklets << ',' << c.with_divisions << ','
+         << c.with_constraints << ',' << r.solver.number_of_variables << ',' << r.solver.number_of_factors << ','
+         << r.solver.number_of_table_entries << ',' << r.solver.number_of_constraints << ','
+         << setprecision(9) << r.formulate_seconds << ',' << r.constraints_seconds << ',' << r.infer_seconds
+         << ',' << r.peak_memory_kb << ',' << r.solver.status << '\n';
+    return;
+  }
+  cout << setw(8) << c.max_number_objects << setw(10) << c.with_tracklets << setw(10) << c.with_divisions
+       << setw(12) << c.with_constraints << setw(12) << r.solver.number_of_variables << setw(12)
+       << r.solver.number_of_factors << setw(14) << r.solver.number_of_table_entries << setw(13)
+       << r.solver.number_of_constraints << setw(14) << setprecision(6) << r.formulate_seconds << setw(14)
+       << r.infer_seconds << setw(16) << r.peak_memory_kb << "  " << r.solver.status << '\n';
+}
+}
+
+int main(int argc, char** argv) {
+  benchmark::SyntheticDatasetParameters p;
+  vector<int> max_objects, tracklets, divisions, constraints;
+  size_t repetitions;
+  double max_distance;
+  bool csv;
+  po::options_description options("solver_benchmark options, lists are swept");
+  options.add_options()
+      ("help,h", "show this message")
+      ("max-objects,k", po::value<vector<int> >(&max_objects)->multitoken(), "max_number_objects (default 1 2 3 4)")
+      ("with-tracklets", po::value<vector<int> >(&tracklets)->multitoken(), "with_tracklets, 0 or 1 (default 0 1)")
+      ("with-divisions", po::value<vector<int> >(&divisions)->multitoken(), "with_divisions, 0 or 1 (default 0 1)")
+      ("with-constraints", po::value<vector<int> >(&constraints)->multitoken(), "with_constraints, 0 or 1 (default 0 1)")
+      ("cells,n", po::value<size_t>(&p.cells)->default_value(200), "cells in the first timestep")
+      ("timesteps,t", po::value<int>(&p.timesteps)->default_value(5), "timesteps")
+      ("divisions", po::value<double>(&p.division_rate)->default_value(0.02), "probability of a cell to divide per timestep")
+      ("mergers", po::value<double>(&p.merger_rate)->default_value(0.05), "probability of two close cells to merge per timestep")
+      ("dimensions,d", po::value<int>(&p.dimensions)->default_value(2), "spatial dimensions, 2 or 3")
+      ("density", po::value<double>(&p.density)->default_value(0.001), "cells per unit area resp. volume")
+      ("seed", po::value<unsigned>(&p.seed)->default_value(42), "seed of the data set")
+      ("max-distance", po::value<double>(&max_distance)->default_value(20.), "largest distance of a transition")
+      ("repetitions,r", po::value<size_t>(&repetitions)->default_value(1), "runs per configuration, the times are averaged")
+      ("csv", po::bool_switch(&csv), "comma separated output");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+  } catch (std::exception& e) {
+    cerr << e.what() << '\n' << options;
+    return 1;
+  }
+  if (vm.count("help")) {
+    cout << options;
+    return 0;
+  }
+  if (max_objects.empty()) {
+    for (int k = 1; k <= 4; ++k) {
+      max_objects.push_back(k);
+    }
+  }
+  if (*min_element(max_objects.begin(), max_objects.end()) < 1 || repetitions == 0) {
+    cerr << "requires max-objects >= 1 and repetitions >= 1\n";
+    return 1;
+  }
+  const vector<bool> with_tracklets = switches(tracklets);
+  const vector<bool> with_divisions = switches(divisions);
+  const vector<bool> with_constraints = switches(constraints);
+
+  TraxelStore dataset;
+  benchmark::SyntheticDatasetSummary summary;
+  p.max_objects = *max_element(max_objects.begin(), max_objects.end());
+  try {
+    summary = benchmark::generate_dataset(p, dataset);
+  } catch (std::exception& e) {
+    cerr << "solver_benchmark: " << e.what() << '\n';
+    return 1;
+  }
+
+  if (csv) {
+    cout << "max_number_objects,with_tracklets,with_divisions,with_constraints,variables,factors,table_entries,"
+            "constraints,formulate_seconds,constraints_seconds,infer_seconds,peak_rss_kb,status\n";
+  } else {
+    cout << summary.traxels << " traxels, " << summary.divisions << " divisions and " << summary.mergers
+         << " mergers in " << p.timesteps << " timesteps (" << p.dimensions << "D); times per run\n";
+    cout << setw(8) << "objects" << setw(10) << "tracklets" << setw(10) << "divisions" << setw(12)
+         << "constraints" << setw(12) << "variables" << setw(12) << "factors" << setw(14) << "table entries"
+         << setw(13) << "constraints" << setw(14) << "formulate [s]" << setw(14) << "infer [s]" << setw(16)
+         << "peak RSS [kB]" << "  status\n";
+  }
+
+  try {
+    for (size_t k = 0; k < max_objects.size(); ++k) {
+      for (size_t t = 0; t < with_tracklets.size(); ++t) {
+        for (size_t d = 0; d < with_divisions.size(); ++d) {
+          for (size_t c = 0; c < with_constraints.size(); ++c) {
+            Configuration configuration;
+            configuration.max_number_objects = max_objects[k];
+            configuration.with_tracklets = with_tracklets[t];
+            configuration.with_divisions = with_divisions[d];
+            configuration.with_constraints = with_constraints[c];
+            report(configuration, run(configuration, p, max_distance, repetitions), csv);
+          }
+        }
+      }
+    }
+  } catch (std::exception& e) {
+    cerr << "solver_benchmark: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,260 @@
+// Times the spatial search among traxels and the hypotheses building on
+// synthetic data sets (see synthetic_dataset.h):
+//
+// - construction of every SpatialIndex backend on one timestep
+// - knn_in_range() (single and batched) and count_in_range() with the
+//   traxels of the next timestep as queries
+// - SingleTimestepTraxel_HypothesesBuilder::build() on the whole data set
+//
+// for every combination of the objects per frame, max_nearest_neighbors,
+// distance_threshold, forward_backward and index given on the command
+// line. With --csv the results are comma separated, one line per phase,
+// so that the output of several builds can be compared.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/nearest_neighbors.h"
+#include "pgmlink/spatial_index.h"
+#include "pgmlink/tracking_statistics.h"
+#include "pgmlink/traxels.h"
+
+#include "benchmark.h"
+#include "synthetic_dataset.h"
+
+using namespace pgmlink;
+using namespace std;
+namespace po = boost::program_options;
+
+namespace {
+typedef SingleTimestepTraxel_HypothesesBuilder::Options BuilderOptions;
+
+struct Run {
+  string index;
+  size_t objects;
+  unsigned knn;
+  double distance;
+  bool forward_backward;
+
+  string csv() const {
+    ostringstream os;
+    os << index << ',' << objects << ',' << knn << ',' << distance << ',' << forward_backward;
+    return os.str();
+  }
+};
+
+BuilderOptions::SpatialIndexType index_type(const string& index) {
+  if (index == "kdtree") {
+    return BuilderOptions::KDTreeIndex;
+  } else if (index == "grid") {
+    return BuilderOptions::GridIndex;
+  }
+  throw invalid_argument("unknown index " + index + ", expected kdtree or grid");
+}
+
+boost::shared_ptr<SpatialIndex> make_index(const string& index, const TraxelStore& ts, int timestep,
+                                           double distance) {
+  const TraxelStoreByTimestep& traxels_by_timestep = ts.get<by_timestep>();
+  pair<TraxelStoreByTimestep::const_iterator, TraxelStoreByTimestep::const_iterator> traxels =
+      traxels_by_timestep.equal_range(timestep);
+  if (index_type(index) == BuilderOptions::GridIndex) {
+    return boost::shared_ptr<SpatialIndex>(new GridNeighborSearch(traxels.first, traxels.second, distance));
+  }
+  return boost::shared_ptr<SpatialIndex>(
+      new NearestNeighborSearch(traxels.first, traxels.second, false, ts.dimensions()));
+}
+
+// construction and queries of the index of timestep 0
+vector<benchmark::Phase> time_search(const Run& run, const TraxelStore& ts, size_t repetitions, size_t& checksum) {
+  vector<benchmark::Phase> phases;
+  phases.push_back(benchmark::Phase("construction"));
+  phases.push_back(benchmark::Phase("knn_in_range"));
+  phases.push_back(benchmark::Phase("knn_in_range batched"));
+  phases.push_back(benchmark::Phase("count_in_range"));
+
+  const TraxelStoreByTimestep& traxels_by_timestep = ts.get<by_timestep>();
+  vector<const Traxel*> queries;
+  for (TraxelStoreByTimestep::const_iterator it = traxels_by_timestep.lower_bound(1);
+       it != traxels_by_timestep.upper_bound(1); ++it) {
+    queries.push_back(&*it);
+  }
+  const size_t n_indexed = traxels_by_timestep.count(0);
+  const vector<unsigned int> knn(queries.size(), run.knn);
+  vector<size_t> offsets;
+  vector<unsigned int> ids;
+  vector<double> distances;
+
+  for (size_t r = 0; r < repetitions; ++r) {
+    PhaseTimer timer;
+    boost::shared_ptr<SpatialIndex> index = make_index(run.index, ts, 0, run.distance);
+    timer.stop(phases[0].seconds);
+    phases[0].items += n_indexed;
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+      checksum += index->knn_in_range(*queries[q], run.distance, run.knn).size();
+    }
+    timer.stop(phases[1].seconds);
+
+    index->knn_in_range(queries, knn, run.distance, offsets, ids, distances);
+    checksum += ids.size();
+    timer.stop(phases[2].seconds);
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+      checksum += index->count_in_range(*queries[q], run.distance);
+    }
+    timer.stop(phases[3].seconds);
+    for (size_t i = 1; i < phases.size(); ++i) {
+      phases[i].items += queries.size();
+    }
+  }
+  for (size_t i = 0; i < phases.size(); ++i) {
+    phases[i].peak_memory_kb = benchmark::peak_memory_kb();
+  }
+  return phases;
+}
+
+vector<benchmark::Phase> time_build(const Run& run, const TraxelStore& ts, size_t repetitions, size_t& checksum) {
+  vector<benchmark::Phase> phases;
+  phases.push_back(benchmark::Phase("HypothesesBuilder::build"));
+  BuilderOptions options(run.knn, run.distance, run.forward_backward);
+  options.spatial_index = index_type(run.index);
+  for (size_t r = 0; r < repetitions; ++r) {
+    // a new builder, so the indices are built every time
+    SingleTimestepTraxel_HypothesesBuilder builder(&ts, options);
+    PhaseTimer timer;
+    auto_ptr<HypothesesGraph> graph(builder.build());
+    timer.stop(phases[0].seconds);
+    phases[0].items += ts.size();
+    checksum += lemon::countArcs(*graph);
+  }
+  phases[0].peak_memory_kb = benchmark::peak_memory_kb();
+  return phases;
+}
+
+void report(const Run& run, const vector<benchmark::Phase>& phases, size_t repetitions, bool csv) {
+  if (csv) {
+    benchmark::report_csv(cout, run.csv(), phases, repetitions);
+  } else {
+    cout << "\nindex " << run.index << ", " << run.objects << " objects per frame, max_nearest_neighbors "
+         << run.knn << ", distance_threshold " << run.distance
+         << (run.forward_backward ? ", forward_backward" : "") << "\n";
+    benchmark::report(cout, phases, repetitions);
+  }
+}
+}
+
+int main(int argc, char** argv) {
+  benchmark::SyntheticDatasetParameters p;
+  vector<size_t> objects;
+  vector<unsigned> knns;
+  vector<double> distances;
+  vector<int> forward_backwards;
+  vector<string> indices;
+  size_t repetitions;
+  bool csv;
+  po::options_description options("spatial_benchmark options, lists are swept");
+  options.add_options()
+      ("help,h", "show this message")
+      ("objects,n", po::value<vector<size_t> >(&objects)->multitoken(), "objects per frame (default 1000 10000 100000)")
+      ("knn,k", po::value<vector<unsigned> >(&knns)->multitoken(), "max_nearest_neighbors (default 2 6)")
+      ("distance", po::value<vector<double> >(&distances)->multitoken(), "distance_threshold (default 20 50)")
+      ("forward-backward", po::value<vector<int> >(&forward_backwards)->multitoken(), "forward_backward of the builder, 0 or 1 (default 0 1)")
+      ("index", po::value<vector<string> >(&indices)->multitoken(), "spatial indices, kdtree or grid (default both)")
+      ("timesteps,t", po::value<int>(&p.timesteps)->default_value(5), "timesteps of the data set for build()")
+      ("dimensions,d", po::value<int>(&p.dimensions)->default_value(2), "spatial dimensions, 2 or 3")
+      ("density", po::value<double>(&p.density)->default_value(0.001), "objects per unit area resp. volume")
+      ("seed", po::value<unsigned>(&p.seed)->default_value(42), "seed of the data sets")
+      ("repetitions,r", po::value<size_t>(&repetitions)->default_value(3), "repetitions, the results are averaged")
+      ("csv", po::bool_switch(&csv), "comma separated output");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+  } catch (std::exception& e) {
+    cerr << e.what() << '\n' << options;
+    return 1;
+  }
+  if (vm.count("help")) {
+    cout << options;
+    return 0;
+  }
+  if (objects.empty()) {
+    objects.push_back(1000);
+    objects.push_back(10000);
+    objects.push_back(100000);
+  }
+  if (knns.empty()) {
+    knns.push_back(2);
+    knns.push_back(6);
+  }
+  if (distances.empty()) {
+    distances.push_back(20);
+    distances.push_back(50);
+  }
+  if (forward_backwards.empty()) {
+    forward_backwards.push_back(0);
+    forward_backwards.push_back(1);
+  }
+  if (indices.empty()) {
+    indices.push_back("kdtree");
+    indices.push_back("grid");
+  }
+  if (p.timesteps < 2 || repetitions == 0) {
+    cerr << "requires timesteps >= 2 and repetitions >= 1\n";
+    return 1;
+  }
+
+  if (csv) {
+    cout << "index,objects,max_nearest_neighbors,distance_threshold,forward_backward," << benchmark::csv_columns()
+         << '\n';
+  } else {
+    cout << repetitions << " repetitions on " << p.timesteps << " timesteps (" << p.dimensions << "D, density "
+         << p.density << "); items are indexed traxels, queries resp. traxels\n";
+  }
+
+  size_t checksum = 0;
+  try {
+    for (size_t o = 0; o < objects.size(); ++o) {
+      TraxelStore ts;
+      p.cells = objects[o];
+      p.division_rate = 0;
+      p.merger_rate = 0;
+      benchmark::generate_dataset(p, ts);
+
+      for (size_t i = 0; i < indices.size(); ++i) {
+        for (size_t d = 0; d < distances.size(); ++d) {
+          for (size_t k = 0; k < knns.size(); ++k) {
+            Run run;
+            run.index = indices[i];
+            run.objects = objects[o];
+            run.knn = knns[k];
+            run.distance = distances[d];
+            run.forward_backward = false;
+            report(run, time_search(run, ts, repetitions, checksum), repetitions, csv);
+            for (size_t fb = 0; fb < forward_backwards.size(); ++fb) {
+              run.forward_backward = forward_backwards[fb] != 0;
+              report(run, time_build(run, ts, repetitions, checksum), repetitions, csv);
+            }
+          }
+        }
+      }
+    }
+  } catch (std::exception& e) {
+    cerr << "spatial_benchmark: " << e.what() << '\n';
+    return 1;
+  }
+  // keeps the queries from being optimized away
+  cerr << "checksum " << checksum << '\n';
+  return 0;
+}
@@ -0,0 +1,241 @@
+/**
+   @file
+   @brief synthetic traxel stores of configurable size for the benchmarks
+*/
+
+#ifndef PGMLINK_SYNTHETIC_DATASET_H
+#define PGMLINK_SYNTHETIC_DATASET_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include "pgmlink/field_of_view.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+namespace benchmark {
+
+/**
+ * Cells doing a random walk in a box.
+ *
+ * The box is sized so that the cells of the first timestep have the given
+ * density (cells per unit area resp. volume). A cell divides with
+ * division_rate per timestep; its daughters appear step apart in the next
+ * timestep. Two cells in the same grid cell of size merger_distance are
+ * detected as one merger traxel with merger_rate per timestep.
+ */
+struct SyntheticDatasetParameters {
+  SyntheticDatasetParameters()
+      : cells(1000), timesteps(10), division_rate(0.01), merger_rate(0.01), dimensions(2),
+        density(0.001), step(3.), merger_distance(10.), max_objects(2), object_size(20), seed(42) {}
+
+  size_t cells;
+  int timesteps;
+  double division_rate;
+  double merger_rate;
+  int dimensions;
+  double density;
+  /// standard deviation of the movement per timestep and coordinate
+  double step;
+  double merger_distance;
+  /// length of detProb minus one, as ConsTracking's max_number_objects
+  int max_objects;
+  /// pixels per cell in the coordinates of merger traxels (none if 0)
+  size_t object_size;
+  unsigned seed;
+};
+
+/// what generate_dataset() generated
+struct SyntheticDatasetSummary {
+  SyntheticDatasetSummary() : traxels(0), divisions(0), mergers(0), side(0.) {}
+
+  size_t traxels;
+  size_t divisions;
+  size_t mergers;
+  /// edge length of the box
+  double side;
+};
+
+namespace detail {
+struct SyntheticCell {
+  double x[3];
+  bool dividing;
+};
+
+// grid cell of the position, for finding merger partners
+inline std::pair<std::pair<long, long>, long> grid_key(const SyntheticCell& c, double size) {
+  return std::make_pair(std::make_pair(static_cast<long>(std::floor(c.x[0] / size)),
+                                       static_cast<long>(std::floor(c.x[1] / size))),
+                        static_cast<long>(std::floor(c.x[2] / size)));
+}
+
+class SyntheticDatasetGenerator {
+ public:
+  SyntheticDatasetGenerator(const SyntheticDatasetParameters& p)
+      : p_(p), rng_(p.seed), normal_(rng_, boost::normal_distribution<double>(0., 1.)), uniform_(rng_) {}
+
+  SyntheticDatasetSummary generate(TraxelStore& ts) {
+    SyntheticDatasetSummary summary;
+    summary.side = std::pow(p_.cells / p_.density, 1. / p_.dimensions);
+    side_ = summary.side;
+    std::vector<SyntheticCell> cells(p_.cells);
+    for (size_t i = 0; i < cells.size(); ++i) {
+      for (int d = 0; d < 3; ++d) {
+        cells[i].x[d] = d < p_.dimensions ? uniform_() * side_ : 0.;
+      }
+      cells[i].dividing = false;
+    }
+
+    std::vector<std::pair<std::pair<std::pair<long, long>, long>, size_t> > keys;
+    std::vector<char> merged;
+    for (int t = 0; t < p_.timesteps; ++t) {
+      if (t > 0) {
+        move(cells, summary);
+      }
+      // divisions are decided before the detections are written, so that
+      // the mother carries its division probability
+      const bool last = t + 1 == p_.timesteps;
+      for (size_t i = 0; i < cells.size(); ++i) {
+        cells[i].dividing = !last && uniform_() < p_.division_rate;
+      }
+
+      // merger partners: consecutive cells of a grid cell
+      merged.assign(cells.size(), 0);
+      keys.clear();
+      if (p_.merger_rate > 0 && p_.max_objects >= 2) {
+        for (size_t i = 0; i < cells.size(); ++i) {
+          keys.push_back(std::make_pair(grid_key(cells[i], p_.merger_distance), i));
+        }
+        std::sort(keys.begin(), keys.end());
+      }
+
+      unsigned int id = 0;
+      for (size_t k = 0; k + 1 < keys.size(); ++k) {
+        const size_t a = keys[k].second;
+        const size_t b = keys[k + 1].second;
+        if (keys[k].first != keys[k + 1].first || merged[a] || cells[a].dividing || cells[b].dividing
+            || uniform_() >= p_.merger_rate) {
+          continue;
+        }
+        merged[a] = merged[b] = 1;
+        const SyntheticCell* pair[2] = {&cells[a], &cells[b]};
+        add(ts, traxel(t, ++id, pair, 2));
+        ++summary.mergers;
+        ++k;
+      }
+      for (size_t i = 0; i < cells.size(); ++i) {
+        if (!merged[i]) {
+          const SyntheticCell* single[1] = {&cells[i]};
+          add(ts, traxel(t, ++id, single, 1));
+        }
+      }
+      summary.traxels += id;
+    }
+    return summary;
+  }
+
+ private:
+  void move(std::vector<SyntheticCell>& cells, SyntheticDatasetSummary& summary) {
+    const size_t n = cells.size();
+    for (size_t i = 0; i < n; ++i) {
+      if (cells[i].dividing) {
+        // the daughters are step apart along a random direction
+        double direction[3] = {0., 0., 0.};
+        double norm = 0;
+        for (int d = 0; d < p_.dimensions; ++d) {
+          direction[d] = normal_();
+          norm += direction[d] * direction[d];
+        }
+        norm = std::sqrt(norm) + 1e-12;
+        SyntheticCell daughter = cells[i];
+        for (int d = 0; d < p_.dimensions; ++d) {
+          cells[i].x[d] -= 0.5 * p_.step * direction[d] / norm;
+          daughter.x[d] += 0.5 * p_.step * direction[d] / norm;
+        }
+        cells.push_back(daughter);
+        ++summary.divisions;
+      } else {
+        for (int d = 0; d < p_.dimensions; ++d) {
+          cells[i].x[d] += p_.step * normal_();
+        }
+      }
+    }
+    for (size_t i = 0; i < cells.size(); ++i) {
+      for (int d = 0; d < p_.dimensions; ++d) {
+        // reflect at the walls of the box
+        double& x = cells[i].x[d];
+        if (x < 0) x = -x;
+        if (x > side_) x = 2 * side_ - x;
+        x = std::min(std::max(x, 0.), side_);
+      }
+    }
+  }
+
+  Traxel traxel(int t, unsigned int id, const SyntheticCell* const* cells, size_t n) {
+    Traxel trax(id, t);
+    feature_array com(3, 0.);
+    for (size_t c = 0; c < n; ++c) {
+      for (int d = 0; d < 3; ++d) {
+        com[d] += cells[c]->x[d] / n;
+      }
+    }
+    trax.features["com"] = com;
+    trax.features["count"] = feature_array(1, static_cast<feature_type>(n * std::max<size_t>(p_.object_size, 1)));
+
+    // most of the mass on the true number of objects
+    feature_array det_prob(p_.max_objects + 1, 0.1f / p_.max_objects);
+    det_prob[std::min<size_t>(n, p_.max_objects)] = 0.9f;
+    trax.features["detProb"] = det_prob;
+    trax.features["divProb"] = feature_array(1, n == 1 && cells[0]->dividing ? 0.9f : 0.05f);
+
+    if (n > 1 && p_.object_size > 0) {
+      feature_array& coordinates = trax.features["coordinates"];
+      coordinates.reserve(3 * n * p_.object_size);
+      for (size_t c = 0; c < n; ++c) {
+        for (size_t pixel = 0; pixel < p_.object_size; ++pixel) {
+          for (int d = 0; d < 3; ++d) {
+            coordinates.push_back(d < p_.dimensions ? cells[c]->x[d] + normal_() : 0.);
+          }
+        }
+      }
+    }
+    return trax;
+  }
+
+  const SyntheticDatasetParameters& p_;
+  boost::mt19937 rng_;
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<double> > normal_;
+  boost::uniform_01<boost::mt19937&> uniform_;
+  double side_;
+};
+} /* namespace detail */
+
+/// fill ts with the traxels of a synthetic data set; throws for invalid parameters
+inline SyntheticDatasetSummary generate_dataset(const SyntheticDatasetParameters& p, TraxelStore& ts) {
+  if (p.cells == 0 || p.timesteps < 1 || (p.dimensions != 2 && p.dimensions != 3) || p.density <= 0
+      || p.max_objects < 1 || p.merger_distance <= 0) {
+    throw std::invalid_argument("generate_dataset(): requires cells > 0, timesteps > 0, dimensions 2 or 3, "
+                                "density > 0, max_objects > 0 and merger_distance > 0");
+  }
+  ts.set_dimensions(p.dimensions);
+  return detail::SyntheticDatasetGenerator(p).generate(ts);
+}
+
+/// the box of a generated data set
+inline FieldOfView dataset_field_of_view(const SyntheticDatasetParameters& p, const SyntheticDatasetSummary& s) {
+  return FieldOfView(0, 0, 0, 0, p.timesteps - 1, s.side, s.side, p.dimensions == 3 ? s.side : 0);
+}
+
+} /* namespace benchmark */
+} /* namespace pgmlink */
+
+#endif /* PGMLINK_SYNTHETIC_DATASET_H */
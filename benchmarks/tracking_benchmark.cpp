@@ -0,0 +1,211 @@
+// Runs ConsTracking and ChaingraphTracking end to end on synthetic data
+// sets (see synthetic_dataset.h) and reports the wall time and the peak
+// memory of every phase, followed by the memory report of the last run.
+//
+// Scale the cells, timesteps and density to see which phase dominates for
+// large movies.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "pgmlink/tracking.h"
+#include "pgmlink/tracking_statistics.h"
+#include "pgmlink/traxels.h"
+
+#include "benchmark.h"
+#include "synthetic_dataset.h"
+
+using namespace pgmlink;
+using namespace std;
+namespace po = boost::program_options;
+
+namespace {
+const char* const phase_names[] = {"energy", "hypotheses", "formulate", "infer", "conclude",
+                                   "prune", "merger resolution", "events"};
+const size_t n_phases = sizeof(phase_names) / sizeof(phase_names[0]);
+
+// the recorded peak of the phase, which the trackers name "<tracker>: <phase>"
+long phase_peak_kb(const MemoryReport& memory, const string& phase) {
+  long peak = 0;
+  for (vector<PhaseMemory>::const_iterator it = memory.phases.begin(); it != memory.phases.end(); ++it) {
+    const string::size_type colon = it->phase.rfind(": ");
+    if (colon != string::npos && it->phase.compare(colon + 2, string::npos, phase) == 0) {
+      peak = max(peak, it->peak_rss_kb);
+    }
+  }
+  return peak;
+}
+
+class TrackerPhases {
+ public:
+  explicit TrackerPhases(const string& tracker) {
+    generate_.push_back(benchmark::Phase(tracker + ": generate"));
+    for (size_t i = 0; i < n_phases; ++i) {
+      phases_.push_back(benchmark::Phase(tracker + ": " + phase_names[i]));
+    }
+  }
+
+  void add_generation(double seconds, size_t traxels) {
+    generate_[0].seconds += seconds;
+    generate_[0].items += traxels;
+    generate_[0].peak_memory_kb = max(generate_[0].peak_memory_kb, benchmark::peak_memory_kb());
+  }
+
+  void add(const TrackingStatistics& s, size_t traxels) {
+    const double seconds[] = {s.energy_seconds, s.hypotheses_seconds, s.formulate_seconds, s.infer_seconds,
+                              s.conclude_seconds, s.prune_seconds, s.merger_resolution_seconds,
+                              s.events_seconds};
+    for (size_t i = 0; i < n_phases; ++i) {
+      phases_[i].seconds += seconds[i];
+      phases_[i].items += traxels;
+      phases_[i].peak_memory_kb = max(phases_[i].peak_memory_kb, phase_peak_kb(s.memory, phase_names[i]));
+    }
+  }
+
+  // the generation and the phases the tracker went through
+  vector<benchmark::Phase> phases() const {
+    vector<benchmark::Phase> result(generate_);
+    for (size_t i = 0; i < n_phases; ++i) {
+      if (phases_[i].seconds > 0) {
+        result.push_back(phases_[i]);
+      }
+    }
+    return result;
+  }
+
+ private:
+  vector<benchmark::Phase> generate_;
+  vector<benchmark::Phase> phases_;
+};
+
+double generate(const benchmark::SyntheticDatasetParameters& p, TraxelStore& ts,
+                benchmark::SyntheticDatasetSummary& summary) {
+  double seconds = 0.;
+  PhaseTimer timer;
+  summary = benchmark::generate_dataset(p, ts);
+  timer.stop(seconds);
+  return seconds;
+}
+}
+
+int main(int argc, char** argv) {
+  benchmark::SyntheticDatasetParameters p;
+  size_t repetitions;
+  string tracker;
+  double max_distance;
+  bool with_merger_resolution, with_components;
+  po::options_description options("tracking_benchmark options");
+  options.add_options()
+      ("help,h", "show this message")
+      ("cells,n", po::value<size_t>(&p.cells)->default_value(1000), "cells in the first timestep")
+      ("timesteps,t", po::value<int>(&p.timesteps)->default_value(10), "timesteps")
+      ("divisions", po::value<double>(&p.division_rate)->default_value(0.01), "probability of a cell to divide per timestep")
+      ("mergers", po::value<double>(&p.merger_rate)->default_value(0.01), "probability of two close cells to merge per timestep")
+      ("dimensions,d", po::value<int>(&p.dimensions)->default_value(2), "spatial dimensions, 2 or 3")
+      ("density", po::value<double>(&p.density)->default_value(0.001), "cells per unit area resp. volume")
+      ("step", po::value<double>(&p.step)->default_value(3.), "standard deviation of the movement per timestep")
+      ("max-objects,k", po::value<int>(&p.max_objects)->default_value(2), "largest number of objects in a detection")
+      ("object-size,s", po::value<size_t>(&p.object_size)->default_value(20), "pixels per cell of a merger")
+      ("seed", po::value<unsigned>(&p.seed)->default_value(42), "seed of the data sets")
+      ("repetitions,r", po::value<size_t>(&repetitions)->default_value(1), "data sets to track, the results are averaged")
+      ("tracker", po::value<string>(&tracker)->default_value("both"), "cons, chaingraph or both")
+      ("max-distance", po::value<double>(&max_distance)->default_value(20.), "largest distance of a transition")
+      ("with-merger-resolution", po::bool_switch(&with_merger_resolution), "resolve the mergers after ConsTracking")
+      ("with-components", po::bool_switch(&with_components), "solve the connected components of ConsTracking separately");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+  } catch (std::exception& e) {
+    cerr << e.what() << '\n' << options;
+    return 1;
+  }
+  if (vm.count("help")) {
+    cout << options;
+    return 0;
+  }
+  const bool with_cons = tracker == "cons" || tracker == "both";
+  const bool with_chaingraph = tracker == "chaingraph" || tracker == "both";
+  if ((!with_cons && !with_chaingraph) || repetitions == 0) {
+    cerr << "requires tracker cons, chaingraph or both and repetitions >= 1\n";
+    return 1;
+  }
+
+  TrackerPhases cons_phases("ConsTracking");
+  TrackerPhases chaingraph_phases("ChaingraphTracking");
+  MemoryReport cons_memory, chaingraph_memory;
+  size_t traxels = 0, divisions = 0, mergers = 0;
+  try {
+    for (size_t run = 0; run < repetitions; ++run) {
+      benchmark::SyntheticDatasetParameters q = p;
+      q.seed = p.seed + run;
+      // every tracker gets a fresh store, the trackers modify it
+      if (with_cons) {
+        TraxelStore ts;
+        benchmark::SyntheticDatasetSummary summary;
+        cons_phases.add_generation(generate(q, ts, summary), summary.traxels);
+        traxels += summary.traxels;
+        divisions += summary.divisions;
+        mergers += summary.mergers;
+
+        ConsTracking tracking(p.max_objects, max_distance, 0.3, "none", false, 0, 0.01, 30., false,
+                              10., 10., p.division_rate > 0, 500., 500., with_merger_resolution,
+                              p.dimensions, 5., 0, benchmark::dataset_field_of_view(q, summary), true,
+                              1e+75, "none", with_components);
+        tracking.set_with_statistics(true);
+        tracking(ts);
+        cons_phases.add(tracking.statistics(), summary.traxels);
+        cons_memory = tracking.statistics().memory;
+      }
+      if (with_chaingraph) {
+        // ChaingraphTracking reads detProb as a cellness of two values and
+        // has no merger model
+        q.max_objects = 1;
+        TraxelStore ts;
+        benchmark::SyntheticDatasetSummary summary;
+        chaingraph_phases.add_generation(generate(q, ts, summary), summary.traxels);
+        if (!with_cons) {
+          traxels += summary.traxels;
+          divisions += summary.divisions;
+          mergers += summary.mergers;
+        }
+
+        ChaingraphTracking tracking("none", 500, 500, 10, 500, false, 0, 0, true, false, 25, 0, 0.01, 6,
+                                    p.division_rate > 0);
+        tracking.set_with_statistics(true);
+        tracking(ts);
+        chaingraph_phases.add(tracking.statistics(), summary.traxels);
+        chaingraph_memory = tracking.statistics().memory;
+      }
+    }
+  } catch (std::exception& e) {
+    cerr << "tracking_benchmark: " << e.what() << '\n';
+    return 1;
+  }
+
+  cout << repetitions << " data sets of " << p.cells << " cells in " << p.timesteps << " timesteps ("
+       << p.dimensions << "D, density " << p.density << "), on average " << traxels / repetitions
+       << " traxels, " << divisions / repetitions << " divisions and " << mergers / repetitions
+       << " mergers; items are traxels\n";
+  if (with_cons) {
+    benchmark::report(cout, cons_phases.phases(), repetitions);
+    cout << "\nConsTracking memory of the last run:\n";
+    cons_memory.write(cout);
+  }
+  if (with_chaingraph) {
+    if (with_cons) {
+      cout << '\n';
+    }
+    benchmark::report(cout, chaingraph_phases.phases(), repetitions);
+    cout << "\nChaingraphTracking memory of the last run:\n";
+    chaingraph_memory.write(cout);
+  }
+  return 0;
+}
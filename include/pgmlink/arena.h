@@ -0,0 +1,153 @@
+/**
+   @file
+   @ingroup tracking
+   @brief run-scoped arena for the short-lived containers of a tracking run
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+    /**
+     * Monotonic allocator: allocate() hands out consecutive pieces of large
+     * blocks and nothing is freed until the arena is rewound to an earlier
+     * mark(). Rewinding to the empty arena keeps one block of the capacity
+     * that was needed, so the next run of the same size allocates nothing;
+     * release() returns the memory.
+     *
+     * An arena is used by one thread at a time; for_this_thread() is the
+     * arena of the calling thread, kept for the lifetime of the thread.
+     * Its blocks are kept, too, unless release_thread_arenas() returns
+     * them after a run, which matters for the long-lived OpenMP workers.
+     */
+    class Arena : private boost::noncopyable
+    {
+      public:
+        // position of the arena to rewind to
+        struct Mark {
+            size_t block;
+            size_t offset;
+            size_t used;
+        };
+
+        PGMLINK_EXPORT explicit Arena(size_t block_size = 1 << 20);
+        PGMLINK_EXPORT ~Arena();
+
+        /// bytes aligned for any type; never 0
+        PGMLINK_EXPORT void* allocate(size_t bytes);
+
+        PGMLINK_EXPORT Mark mark() const;
+        /// free everything allocated since m
+        PGMLINK_EXPORT void rewind(const Mark& m);
+        /// rewind to the empty arena, keeping one block of the capacity
+        PGMLINK_EXPORT void clear();
+        /// free everything, including the blocks
+        PGMLINK_EXPORT void release();
+
+        /// bytes handed out since the arena was empty
+        PGMLINK_EXPORT size_t bytes_used() const;
+        /// bytes of the blocks
+        PGMLINK_EXPORT size_t capacity() const;
+
+        PGMLINK_EXPORT static Arena& for_this_thread();
+        /// release() the arena of the calling thread unless it is in use
+        PGMLINK_EXPORT static void release_this_thread();
+        /// release_this_thread() on the calling thread and on the threads
+        /// of an OpenMP parallel region; call it outside of parallel regions
+        PGMLINK_EXPORT static void release_thread_arenas();
+
+      private:
+        struct Block {
+            char* data;
+            size_t size;
+        };
+        void add_block(size_t min_size);
+
+        const size_t block_size_;
+        std::vector<Block> blocks_;
+        // current block and first free byte in it
+        size_t block_;
+        size_t offset_;
+        // bytes in the blocks before the current one
+        size_t used_before_;
+    };
+
+
+
+    /**
+     * Rewinds the arena to its state at construction when it goes out of
+     * scope; the containers allocating from it have to be gone by then.
+     */
+    class ArenaScope : private boost::noncopyable
+    {
+      public:
+        explicit ArenaScope(Arena& arena) : arena_(arena), mark_(arena.mark()) {}
+        ~ArenaScope() { arena_.rewind(mark_); }
+        Arena& arena() const { return arena_; }
+
+      private:
+        Arena& arena_;
+        const Arena::Mark mark_;
+    };
+
+
+
+    /**
+     * Standard allocator of T from an Arena; deallocate() is a no-op. The
+     * allocator is not default constructible, so containers get it passed:
+     * arena_vector<size_t>::type v(ArenaAllocator<size_t>(arena));
+     */
+    template <typename T>
+    class ArenaAllocator
+    {
+      public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        template <typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+        explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+        template <typename U> ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena_) {}
+
+        pointer address(reference x) const { return &x; }
+        const_pointer address(const_reference x) const { return &x; }
+        pointer allocate(size_type n, const void* = 0) {
+            if (n > max_size()) {
+                throw std::bad_alloc();
+            }
+            return static_cast<pointer>(arena_->allocate(n * sizeof(T)));
+        }
+        void deallocate(pointer, size_type) {}
+        size_type max_size() const { return std::numeric_limits<size_type>::max() / sizeof(T); }
+        void construct(pointer p, const T& value) { new (static_cast<void*>(p)) T(value); }
+        void destroy(pointer p) { p->~T(); }
+
+        template <typename U> bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+        template <typename U> bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+
+      private:
+        template <typename U> friend class ArenaAllocator;
+        Arena* arena_;
+    };
+
+    /// std::vector of T allocating from an Arena
+    template <typename T>
+    struct arena_vector {
+        typedef std::vector<T, ArenaAllocator<T> > type;
+    };
+}
+
+#endif /* ARENA_H */
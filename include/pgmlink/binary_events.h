@@ -0,0 +1,108 @@
+/**
+   @file
+   @ingroup tracking
+   @brief compact binary file format for tracking events
+*/
+
+#ifndef BINARY_EVENTS_H
+#define BINARY_EVENTS_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "pgmlink/event.h"
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+/**
+ * @page binary_events Binary event format
+ *
+ * All records are stored in native byte order and aligned to eight bytes:
+ *
+ * - header: magic, version, byte order mark, flags, number of slots and events
+ * - per timestep() call: a slot record with the slot and number of blocks
+ * - per block, a run of consecutive events of one type: a block record
+ *   with type, width and count, count x width 32 bit traxel ids and, with
+ *   the energies flag, count energies
+ *
+ * The width of a block is the largest number of ids of its events, at
+ * least one; shorter events are padded with missing_id, which the reader
+ * drops again. So every event takes some bytes of the file, and the
+ * reader checks the counts against the bytes left before allocating. So a
+ * Move takes 8 bytes plus its energy instead of a generic vector of ids,
+ * features and weights. Features and weights are not stored; a read event
+ * has its energy as the single feature with weight 1.
+ */
+namespace binary_events {
+  const char magic[8] = {'P', 'G', 'M', 'L', 'E', 'V', 'T', 'S'};
+  const boost::uint32_t version = 1;
+  const boost::uint32_t byte_order_mark = 0x01020304;
+  const boost::uint32_t with_energies_flag = 1;
+  const boost::uint32_t missing_id = ~static_cast<boost::uint32_t>(0);
+
+  struct Header {
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t byte_order;
+    boost::uint32_t flags;
+    boost::uint32_t padding;
+    boost::uint64_t n_slots; // slot records
+    boost::uint64_t n_events;
+  };
+
+  struct SlotRecord {
+    boost::uint64_t slot;
+    boost::uint64_t n_blocks;
+  };
+
+  struct BlockRecord {
+    boost::uint32_t type;
+    boost::uint32_t width;
+    boost::uint64_t count;
+  };
+} /* namespace binary_events */
+
+/**
+ * Writes the events handed to it in the binary format.
+ *
+ * The header is completed by close() (or the destructor), so the events of
+ * a solved graph can be written without building the nested event vector.
+ */
+class BinaryEventWriter : public EventSink {
+ public:
+  PGMLINK_EXPORT BinaryEventWriter(const std::string& filename, bool with_energies = true);
+  PGMLINK_EXPORT virtual ~BinaryEventWriter();
+
+  PGMLINK_EXPORT virtual void timestep(std::size_t slot, std::vector<Event>& events);
+  /// write the header and close the file; further events are an error
+  PGMLINK_EXPORT void close();
+
+ private:
+  void write(const void* data, std::size_t length);
+
+  std::string filename_;
+  std::ofstream out_;
+  binary_events::Header header_;
+  std::vector<boost::uint32_t> ids_; // of the current block
+  std::vector<double> energies_;
+};
+
+/// write a nested event vector in the binary format, one slot per timestep
+PGMLINK_EXPORT void save_binary_events(const std::vector<std::vector<Event> >& events,
+                                       const std::string& filename,
+                                       bool with_energies = true);
+
+/**
+ * Hand the events of a binary event file to sink, in the order they were
+ * written. Throws for files that are not in the format or truncated.
+ */
+PGMLINK_EXPORT void load_binary_events(const std::string& filename, EventSink& sink);
+PGMLINK_EXPORT std::vector<std::vector<Event> > load_binary_events(const std::string& filename);
+
+} /* namespace pgmlink */
+
+#endif /* BINARY_EVENTS_H */
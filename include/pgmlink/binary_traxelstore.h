@@ -0,0 +1,173 @@
+/**
+   @file
+   @ingroup tracking
+   @brief memory mappable binary file format for traxelstores
+*/
+
+#ifndef BINARY_TRAXELSTORE_H
+#define BINARY_TRAXELSTORE_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "pgmlink/pgmlink_export.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+/**
+ * @page binary_traxelstore Binary TraxelStore format
+ *
+ * All sections are stored in native byte order and aligned to eight
+ * bytes, so that a mapped file can be read in place:
+ *
+ * - header: magic, version, byte order mark, counts and section offsets
+ * - timestep index: timestep, first traxel and number of traxels, sorted by timestep
+ * - traxel table: id, timestep and locator index per traxel, sorted by timestep
+ * - locator table: locator kind and scales
+ * - feature table: name, presence flags, per traxel value offsets and the
+ *   packed values of every feature (one column per feature)
+ */
+namespace binary_traxelstore {
+  const char magic[8] = {'P', 'G', 'M', 'L', 'T', 'R', 'X', 'S'};
+  const boost::uint32_t version = 1;
+  const boost::uint32_t byte_order_mark = 0x01020304;
+
+  struct Header {
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t byte_order;
+    boost::uint64_t n_traxels;
+    boost::uint64_t n_timesteps;
+    boost::uint64_t n_locators;
+    boost::uint64_t n_features;
+    boost::uint64_t timestep_index_offset;
+    boost::uint64_t traxel_table_offset;
+    boost::uint64_t locator_table_offset;
+    boost::uint64_t feature_table_offset;
+  };
+
+  struct TimestepRecord {
+    boost::int32_t timestep;
+    boost::uint32_t padding;
+    boost::uint64_t first;
+    boost::uint64_t count;
+  };
+
+  struct TraxelRecord {
+    boost::uint32_t id;
+    boost::int32_t timestep;
+    boost::uint32_t locator;
+    boost::uint32_t padding;
+  };
+
+  enum LocatorKind { ComLocatorKind = 0, IntmaxposLocatorKind = 1 };
+
+  struct LocatorRecord {
+    boost::uint32_t kind;
+    boost::uint32_t padding;
+    double x_scale, y_scale, z_scale;
+  };
+
+  struct FeatureRecord {
+    boost::uint64_t name_offset;
+    boost::uint64_t name_length;
+    boost::uint64_t present_offset; // n_traxels bytes
+    boost::uint64_t offsets_offset; // n_traxels + 1 value offsets
+    boost::uint64_t values_offset;
+  };
+} /* namespace binary_traxelstore */
+
+/**
+ * Write the TraxelStore in the binary format.
+ * Only ComLocator and IntmaxposLocator are supported.
+ */
+PGMLINK_EXPORT void save_binary(const TraxelStore&, const std::string& filename);
+
+/**
+ * Read only, memory mapped binary TraxelStore.
+ *
+ * Opening only validates the header, the section bounds and the index
+ * tables (sorted timesteps, traxel ranges and value offsets); Traxels are
+ * materialized into a TraxelStore (and indexed there) only for the
+ * timesteps that are actually requested.
+ */
+class MappedTraxelStore {
+ public:
+  PGMLINK_EXPORT explicit MappedTraxelStore(const std::string& filename);
+
+  /// number of traxels in the file
+  PGMLINK_EXPORT size_t size() const { return static_cast<size_t>(header_->n_traxels); }
+  PGMLINK_EXPORT std::vector<int> timesteps() const;
+  /// number of traxels at timestep
+  PGMLINK_EXPORT size_t count(int timestep) const;
+  PGMLINK_EXPORT const std::vector<std::string>& feature_names() const { return feature_names_; }
+
+  /// add the traxels of timesteps [first, last] to ts; returns the number of added traxels
+  PGMLINK_EXPORT size_t load(TraxelStore& ts, int first, int last) const;
+  PGMLINK_EXPORT size_t load(TraxelStore& ts) const;
+
+ private:
+  const char* at(boost::uint64_t offset, boost::uint64_t length) const;
+  const binary_traxelstore::TimestepRecord* timestep_begin() const;
+  const binary_traxelstore::TimestepRecord* timestep_end() const;
+  Traxel traxel(size_t index) const;
+
+  boost::iostreams::mapped_file_source file_;
+  const binary_traxelstore::Header* header_;
+  const binary_traxelstore::TraxelRecord* traxels_;
+  const binary_traxelstore::LocatorRecord* locators_;
+  const binary_traxelstore::FeatureRecord* features_;
+  std::vector<std::string> feature_names_;
+  std::vector<boost::shared_ptr<Locator> > shared_locators_; // one per locator record
+};
+
+/// load a complete binary TraxelStore file into ts
+PGMLINK_EXPORT void load_binary(TraxelStore& ts, const std::string& filename);
+
+
+
+/**
+ * TraxelStore that keeps only a sliding window of timesteps resident.
+ *
+ * The traxels are paged in from a binary TraxelStore file on demand.
+ * require() makes a timestep range resident; timesteps farther away
+ * than window_size are paged out again, so the memory footprint stays
+ * bounded by the window irrespective of the length of the movie. A
+ * HypothesesGraph built from the store copies its traxels; see
+ * SingleTimestepTraxel_HypothesesBuilder::Options::node_features to
+ * copy only the features the tracking needs.
+ */
+class StreamingTraxelStore {
+ public:
+  /// window_size in timesteps
+  PGMLINK_EXPORT StreamingTraxelStore(const std::string& filename, size_t window_size);
+
+  PGMLINK_EXPORT const MappedTraxelStore& source() const { return source_; }
+  /// all timesteps in the file
+  PGMLINK_EXPORT std::vector<int> timesteps() const { return source_.timesteps(); }
+  PGMLINK_EXPORT size_t window_size() const { return window_size_; }
+
+  /**
+   * Make timesteps [first, last] resident and return the resident traxels.
+   * The window is moved in the direction of the request and prefetches
+   * ahead of it. References to the resident traxels are invalidated by
+   * the next call.
+   */
+  PGMLINK_EXPORT const TraxelStore& require(int first, int last);
+  PGMLINK_EXPORT const TraxelStore& resident() const { return resident_; }
+  PGMLINK_EXPORT bool is_resident(int timestep) const;
+
+ private:
+  MappedTraxelStore source_;
+  size_t window_size_;
+  TraxelStore resident_;
+  bool has_window_;
+  int lo_, hi_; // resident window [lo_, hi_]
+};
+
+} /* namespace pgmlink */
+
+#endif /* BINARY_TRAXELSTORE_H */
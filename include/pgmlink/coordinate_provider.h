@@ -0,0 +1,153 @@
+/**
+   @file
+   @ingroup tracking
+   @brief on demand access to the pixel coordinates of traxels
+*/
+
+#ifndef COORDINATE_PROVIDER_H
+#define COORDINATE_PROVIDER_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fstream>
+
+#include <armadillo>
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+
+// coordinates by (timestep, traxel id); one pixel per column
+typedef std::map<std::pair<int, unsigned>, arma::mat> TimestepIdCoordinateMap;
+
+typedef boost::shared_ptr<TimestepIdCoordinateMap > TimestepIdCoordinateMapPtr;
+
+typedef boost::shared_ptr<const arma::mat> CoordinatesPtr;
+
+/**
+ * Source of the pixel coordinates of traxels, queried for merger nodes
+ * only.
+ *
+ * The returned matrix has one row per spatial dimension and one column per
+ * pixel; it may refer to memory of the provider and is valid as long as
+ * the provider. Lookups from several threads are allowed.
+ */
+class CoordinateProvider {
+ public:
+  PGMLINK_EXPORT virtual ~CoordinateProvider() {}
+
+  /// empty if there are no coordinates for the traxel
+  PGMLINK_EXPORT virtual CoordinatesPtr coordinates(int timestep, unsigned id) const = 0;
+};
+
+typedef boost::shared_ptr<CoordinateProvider> CoordinateProviderPtr;
+
+/**
+ * Coordinates held in a TimestepIdCoordinateMap; they are not copied.
+ */
+class MapCoordinateProvider : public CoordinateProvider {
+ public:
+  PGMLINK_EXPORT explicit MapCoordinateProvider(TimestepIdCoordinateMapPtr coordinates);
+  PGMLINK_EXPORT virtual CoordinatesPtr coordinates(int timestep, unsigned id) const;
+
+ private:
+  TimestepIdCoordinateMapPtr coordinates_;
+};
+
+
+/**
+ * @page binary_coordinates Binary coordinate format
+ *
+ * Stored in native byte order and aligned to eight bytes, so that a mapped
+ * file can be read in place:
+ *
+ * - header: magic, version, byte order mark, number of entries and the
+ *   offset of the index
+ * - the coordinates of every traxel as doubles, column major
+ * - index: timestep, id, shape and offset of every entry, sorted by
+ *   (timestep, id)
+ */
+namespace binary_coordinates {
+  const char magic[8] = {'P', 'G', 'M', 'L', 'C', 'R', 'D', 'S'};
+  const boost::uint32_t version = 1;
+  const boost::uint32_t byte_order_mark = 0x01020304;
+
+  struct Header {
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t byte_order;
+    boost::uint64_t n_entries;
+    boost::uint64_t index_offset;
+  };
+
+  struct EntryRecord {
+    boost::int32_t timestep;
+    boost::uint32_t id;
+    boost::uint32_t n_rows;
+    boost::uint32_t padding;
+    boost::uint64_t n_cols;
+    boost::uint64_t offset;
+  };
+} /* namespace binary_coordinates */
+
+/**
+ * Writes the binary coordinate format one traxel at a time, so the
+ * coordinates of a movie never have to be in memory at once.
+ *
+ * close() writes the index; the destructor closes the file if that has not
+ * happened before.
+ */
+class CoordinateFileWriter {
+ public:
+  PGMLINK_EXPORT explicit CoordinateFileWriter(const std::string& filename);
+  PGMLINK_EXPORT ~CoordinateFileWriter();
+
+  /// throws if the traxel was added before
+  PGMLINK_EXPORT void add(int timestep, unsigned id, const arma::mat& coordinates);
+  PGMLINK_EXPORT void close();
+
+ private:
+  CoordinateFileWriter(const CoordinateFileWriter&);
+  CoordinateFileWriter& operator=(const CoordinateFileWriter&);
+
+  std::string filename_;
+  std::ofstream out_;
+  boost::uint64_t pos_;
+  std::vector<binary_coordinates::EntryRecord> index_;
+  bool closed_;
+};
+
+/// write all coordinates in the binary coordinate format
+PGMLINK_EXPORT void save_coordinates(const TimestepIdCoordinateMap& coordinates, const std::string& filename);
+
+/**
+ * Read only, memory mapped file in the binary coordinate format.
+ *
+ * Opening validates the header and the index; the coordinates are paged in
+ * by the operating system when a traxel is looked up, so only the mergers
+ * are ever read.
+ */
+class MappedCoordinateFile : public CoordinateProvider {
+ public:
+  PGMLINK_EXPORT explicit MappedCoordinateFile(const std::string& filename);
+
+  /// number of traxels in the file
+  PGMLINK_EXPORT size_t size() const { return static_cast<size_t>(header_->n_entries); }
+  PGMLINK_EXPORT virtual CoordinatesPtr coordinates(int timestep, unsigned id) const;
+
+ private:
+  const char* at(boost::uint64_t offset, boost::uint64_t length) const;
+
+  boost::iostreams::mapped_file_source file_;
+  const binary_coordinates::Header* header_;
+  const binary_coordinates::EntryRecord* index_;
+};
+
+} /* namespace pgmlink */
+
+#endif /* COORDINATE_PROVIDER_H */
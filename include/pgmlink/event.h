@@ -88,6 +88,48 @@ class Event
     }
   };
 
+/**
+   \brief Receiver of the events of a tracking result, one timestep at a time.
+
+   timestep() is called once per slot of the event vector, in order,
+   starting with slot 0 (the earliest timestep). The events are only valid
+   during the call; a sink may swap them out instead of copying.
+*/
+class EventSink
+{
+ public:
+    PGMLINK_EXPORT virtual ~EventSink() {}
+    PGMLINK_EXPORT virtual void timestep( std::size_t slot, std::vector<Event>& events ) = 0;
+};
+
+/**
+   \brief Collects the events into the nested event vector.
+
+   Events of a slot that has events already are appended, so the sink
+   merges the events of several passes like merge_event_vectors().
+*/
+class EventVectorSink : public EventSink
+{
+ public:
+    PGMLINK_EXPORT explicit EventVectorSink( std::vector<std::vector<Event> >& events )
+    : events_(events)
+    {}
+    PGMLINK_EXPORT virtual void timestep( std::size_t slot, std::vector<Event>& events )
+    {
+      if (events_.size() <= slot) {
+        events_.resize(slot + 1);
+      }
+      if (events_[slot].empty()) {
+        events_[slot].swap(events);
+      } else {
+        events_[slot].insert(events_[slot].end(), events.begin(), events.end());
+      }
+    }
+
+ private:
+    std::vector<std::vector<Event> >& events_;
+};
+
 struct EventsStatistics 
 {
     PGMLINK_EXPORT EventsStatistics() 
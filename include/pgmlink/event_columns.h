@@ -0,0 +1,75 @@
+/**
+   @file
+   @ingroup tracking
+   @brief columnar tables of tracking events
+*/
+
+#ifndef EVENT_COLUMNS_H
+#define EVENT_COLUMNS_H
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include "pgmlink/event.h"
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+/**
+ * The events of a tracking result as one table per event type.
+ *
+ * A table holds the timestep, the traxel ids and the energy of every event
+ * of its type as contiguous columns, in the order the events were added.
+ * The timestep of an event is first_timestep plus the slot of its event
+ * vector. As an EventSink, the tables can be filled from a solved graph
+ * without building the nested event vector.
+ */
+class EventColumns : public EventSink {
+ public:
+  class Table {
+   public:
+    Table() : width_(0) { offsets_.push_back(0); }
+
+    PGMLINK_EXPORT size_t size() const { return timesteps_.size(); }
+    /// largest number of traxel ids of an event
+    PGMLINK_EXPORT size_t width() const { return width_; }
+    PGMLINK_EXPORT const std::vector<int>& timesteps() const { return timesteps_; }
+    PGMLINK_EXPORT const std::vector<double>& energies() const { return energies_; }
+    /// size() x width() ids, row major; shorter events are padded with missing_id
+    PGMLINK_EXPORT void ids(boost::uint64_t* out) const;
+    PGMLINK_EXPORT std::vector<boost::uint64_t> ids() const;
+
+   private:
+    friend class EventColumns;
+    void add(int timestep, const Event& e);
+
+    size_t width_;
+    std::vector<int> timesteps_;
+    std::vector<double> energies_;
+    std::vector<boost::uint64_t> flat_ids_;
+    std::vector<size_t> offsets_;
+  };
+
+  /// padding of the ids of events with fewer ids than the table is wide
+  static const boost::uint64_t missing_id = ~static_cast<boost::uint64_t>(0);
+
+  PGMLINK_EXPORT explicit EventColumns(int first_timestep = 0);
+
+  PGMLINK_EXPORT virtual void timestep(std::size_t slot, std::vector<Event>& events);
+  /// add all events of a nested event vector
+  PGMLINK_EXPORT EventColumns& add(const std::vector<std::vector<Event> >& events);
+
+  /// empty for types without events
+  PGMLINK_EXPORT const Table& table(Event::EventType type) const { return tables_[type]; }
+  /// events of all types
+  PGMLINK_EXPORT size_t size() const;
+
+ private:
+  int first_timestep_;
+  std::vector<Table> tables_;
+};
+
+} /* namespace pgmlink */
+
+#endif /* EVENT_COLUMNS_H */
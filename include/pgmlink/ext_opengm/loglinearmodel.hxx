@@ -66,7 +66,7 @@ public:
       FunctionIdentifier
       addFeature(FunctionDecoratorWeighted<FEATURE_FUNCTION>, IndexType weightIndex );
 
-    void setWeights( std::vector<ValueType> in );
+    void setWeights( const std::vector<ValueType>& in );
     void getWeights( std::vector<ValueType>& out ) const;
     IndexType numberOfWeights() const { return static_cast<IndexType>(weights_.size()); }
     IndexType incrementNumberOfWeights( ValueType val=1 ) { weights_.push_back(val); return numberOfWeights() - 1; }
@@ -98,7 +98,7 @@ struct WeightAccessor {
   void get( const model_t* m, std::vector<T>& out ) const {
     w_next_.get(m, out);
   };
-  void set( model_t* m, std::vector<T>& in ) {
+  void set( model_t* m, const std::vector<T>& in ) {
     w_next_.set(m, in);
   };
   WeightAccessor<FUNCTION_INDEX-1, typename meta::TypeAtTypeList<FUNCTION_TYPE_LIST, FUNCTION_INDEX-1>::type, T, FUNCTION_TYPE_LIST, SPACE> w_next_;
@@ -117,7 +117,7 @@ struct WeightAccessor<FUNCTION_INDEX, opengm::FunctionDecoratorWeighted<FUNCTION
     }
     w_next_.get(m, out);
   };
-  void set( model_t* m, std::vector<T>& in ) {
+  void set( model_t* m, const std::vector<T>& in ) {
     typename model_t::FunctionIdentifier fid(0, FUNCTION_INDEX);
     for(size_t i=0; i<m->template functions<FUNCTION_INDEX>().size(); ++i){
       fid.functionIndex = i;
@@ -138,7 +138,7 @@ struct WeightAccessor<0, FUNCTION_TYPE, T, FUNCTION_TYPE_LIST, SPACE> {
     _unused(out); // build in release mode
     _unused(m); // build in release mode
   };
-  void set( model_t* /*m*/, std::vector<T>& /*in*/ ) {
+  void set( model_t* /*m*/, const std::vector<T>& /*in*/ ) {
   };
 };
 
@@ -154,7 +154,7 @@ struct WeightAccessor<0, opengm::FunctionDecoratorWeighted<FUNCTION_TYPE>, T, FU
       }
     }
   };
-  void set( model_t* m, std::vector<T>& in ) {
+  void set( model_t* m, const std::vector<T>& in ) {
     typename model_t::FunctionIdentifier fid(0, 0);
     for(size_t i=0; i<m->template functions<0>().size(); ++i){
       fid.functionIndex = i;
@@ -260,7 +260,7 @@ LoglinearModel<T, FUNCTION_TYPE_LIST, SPACE>::addFeature(FunctionDecoratorWeight
 
 template<class T, class FUNCTION_TYPE_LIST, class SPACE>
 void
-LoglinearModel<T, FUNCTION_TYPE_LIST, SPACE>::setWeights( std::vector<ValueType> in ) 
+LoglinearModel<T, FUNCTION_TYPE_LIST, SPACE>::setWeights( const std::vector<ValueType>& in ) 
 {
   if( in.size() != this->numberOfWeights() ) {
     throw std::invalid_argument("LoglinearModel::setWeights(): vector size not equal to number of weights");
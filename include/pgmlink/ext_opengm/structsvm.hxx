@@ -4,9 +4,13 @@
 
 #include <cassert>
 #include <ostream>
+#include <sstream>
 #include <vector>
+#include <boost/shared_ptr.hpp>
 
 #include <dlib/svm.h>
+#include <dlib/svm_threaded.h>
+#include <dlib/threads.h>
 #include <dlib/optimization.h>
 #include <dlib/matrix.h>
 
@@ -25,20 +29,35 @@
 
 namespace opengm {
 
+/// \brief Structured SVM training of the weights of log-linear models
+///
+/// Every sample is held once, augmented with the Hamming loss against its
+/// labels; the loss factors are no features and do not change the feature
+/// sums. The separation oracle only updates the weights of the sample in
+/// place and keeps one solver per sample, whose objective is refreshed
+/// instead of formulating the model again.
+///
+/// With num_threads > 1, dlib calls the separation oracle of the samples
+/// of an iteration concurrently. A call only touches the model and the
+/// solver of its own sample, so no locking is needed besides the output.
 template<class LLM>
 class StructSvmDlib
-  : public dlib::structural_svm_problem<dlib::matrix<typename LLM::ValueType> > {
+  : public dlib::structural_svm_problem_threaded<dlib::matrix<typename LLM::ValueType> > {
 public:
   typedef LLM LoglinearModelType;
+#ifdef WITH_GUROBI
+  typedef opengm::LPGurobi<LLM, opengm::Minimizer> OptimizerType;
+#else
+  typedef opengm::LPCplex<LLM, opengm::Minimizer> OptimizerType;
+#endif
 
   StructSvmDlib(const std::vector<LoglinearModelType>& samples,
-		const std::vector<std::vector<typename LoglinearModelType::LabelType> > labels)
-    : samples_(samples), samples_and_loss_(samples), labels_(labels) {
-    for(size_t i=0; i < samples.size(); ++i) {
-      augmentWithLoss(samples_and_loss_[i], labels_[i]);
-      LLM loss(samples_[i].space());
-      augmentWithLoss(loss, labels_[i]);
-      loss_.push_back(loss);
+		const std::vector<std::vector<typename LoglinearModelType::LabelType> > labels,
+		unsigned long num_threads = 1)
+    : dlib::structural_svm_problem_threaded<dlib::matrix<typename LLM::ValueType> >(num_threads),
+      samples_(samples), labels_(labels), optimizers_(samples.size()), num_threads_(num_threads) {
+    for(size_t i=0; i < samples_.size(); ++i) {
+      augmentWithLoss(samples_[i], labels_[i]);
     }
   };
 
@@ -63,11 +82,17 @@ public:
 
 private:
   void augmentWithLoss( LoglinearModelType&, std::vector<typename LoglinearModelType::LabelType>& );
+  // number of variables labeled differently than in the labels of the sample
+  typename LLM::ValueType hammingLoss( long idx, const std::vector<typename LLM::LabelType>& ) const;
 
+  // the samples augmented with the loss; only their weights change
   mutable std::vector<LoglinearModelType> samples_;
-  mutable std::vector<LoglinearModelType> samples_and_loss_;
-  std::vector<LoglinearModelType> loss_;
   std::vector<std::vector<typename LoglinearModelType::LabelType> > labels_;
+  // created by the first oracle call of a sample
+  mutable std::vector<boost::shared_ptr<OptimizerType> > optimizers_;
+  unsigned long num_threads_;
+  // the report of one oracle call is written at once
+  mutable dlib::mutex output_mutex_;
 };
   
 /******************/
@@ -122,28 +147,30 @@ void StructSvmDlib<LLM>::separation_oracle(const long idx,
 					   scalar_type_dlib& loss,
 					   feature_vector_type_dlib& psi
 					   ) const {
-  std::cout << "\n";
-  std::cout << "Entered separation oracle\n";
+  std::ostringstream out;
+  out << "\n";
+  out << "Entered separation oracle\n";
   std::vector<typename LLM::ValueType> weights;
   for(int i = 0; i < current_solution.nr(); ++i) {
     weights.push_back(-1*current_solution(i, 0));
-    std::cout << "weights["<<i<<"]: " << current_solution(i,0) << "\n";
+    out << "weights["<<i<<"]: " << current_solution(i,0) << "\n";
   }
-  samples_and_loss_[idx].setWeights(weights);
+  // the weighted functions are shared by the factors; the solver reads
+  // the changed values when its objective is updated
   samples_[idx].setWeights(weights);
 
-#ifdef WITH_GUROBI
-  typedef opengm::LPGurobi<LLM, opengm::Minimizer> optimizer_type;
-#else
-  typedef opengm::LPCplex<LLM, opengm::Minimizer> optimizer_type;
-#endif
-  typename optimizer_type::Parameter params;
-  params.verbose_ = true;
-  params.integerConstraint_ = true;
-  params.epGap_ = 0.01;
-  opengm::InferenceTermination status;  
-  optimizer_type inference = optimizer_type(samples_and_loss_[idx], params);
-  status = inference.infer();
+  if(!optimizers_[idx]) {
+    typename OptimizerType::Parameter params;
+    // concurrent solver logs would interleave
+    params.verbose_ = num_threads_ <= 1;
+    params.integerConstraint_ = true;
+    params.epGap_ = 0.01;
+    optimizers_[idx] = boost::shared_ptr<OptimizerType>(new OptimizerType(samples_[idx], params));
+  } else {
+    optimizers_[idx]->updateObjective();
+  }
+  OptimizerType& inference = *optimizers_[idx];
+  opengm::InferenceTermination status = inference.infer();
   if(status != opengm::NORMAL) {
     throw RuntimeError("GraphicalModel::infer(): optimizer terminated unnormally");
   }
@@ -154,26 +181,42 @@ void StructSvmDlib<LLM>::separation_oracle(const long idx,
   if(status != opengm::NORMAL) {
     throw RuntimeError("GraphicalModel::infer(): solution extraction terminated unnormally");
   }
-  std::cout << "current[0]: " << optimal[0] << " label[0]: " << labels_[idx][0]  << "\n";
-  std::cout << "current[1]: " << optimal[1] << " label[1]: " << labels_[idx][1]  << "\n";
-  std::cout << "current[2]: " << optimal[2] << " label[2]: " << labels_[idx][2]  << "\n";
-  std::cout << "current[3]: " << optimal[3] << " label[3]: " << labels_[idx][3]  << "\n";
-  std::cout << "etc. etc.\n"; 
-
-  std::vector<typename LLM::ValueType> feats(samples_and_loss_[idx].numberOfWeights());
-  samples_and_loss_[idx].weightedFeatureSums( optimal, feats );
+  out << "current[0]: " << optimal[0] << " label[0]: " << labels_[idx][0]  << "\n";
+  out << "current[1]: " << optimal[1] << " label[1]: " << labels_[idx][1]  << "\n";
+  out << "current[2]: " << optimal[2] << " label[2]: " << labels_[idx][2]  << "\n";
+  out << "current[3]: " << optimal[3] << " label[3]: " << labels_[idx][3]  << "\n";
+  out << "etc. etc.\n"; 
+
+  std::vector<typename LLM::ValueType> feats(samples_[idx].numberOfWeights());
+  samples_[idx].weightedFeatureSums( optimal, feats );
   psi.set_size(samples_[idx].numberOfWeights(), 1);
   for(long i = 0; i < psi.size(); ++i) {
-    std::cout << "feature["<<i <<"]: " << feats[i] << "\n";
+    out << "feature["<<i <<"]: " << feats[i] << "\n";
     psi(i,0) = feats[i];
   }
 
-  loss = -1*loss_[idx].evaluate(optimal);
-  std::cout << "ground truth energy for idx" << idx <<": "<< -1*samples_[idx].evaluate(labels_[idx])<<"\n";
-  std::cout << "energy for idx" << idx <<": "<< -1*samples_[idx].evaluate(optimal)<<"\n";
-  std::cout << "energy incl. loss for idx" << idx <<": "<< -1*samples_and_loss_[idx].evaluate(optimal)<<"\n";
-  std::cout << "loss for idx "<< idx <<": " << loss << "\n";
-  std::cout << "leaving oracle\n\n";
+  // the Hamming factors contribute -1 per wrong label and nothing at the
+  // true labels
+  loss = hammingLoss(idx, optimal);
+  const typename LLM::ValueType energy_with_loss = samples_[idx].evaluate(optimal);
+  out << "ground truth energy for idx" << idx <<": "<< -1*samples_[idx].evaluate(labels_[idx])<<"\n";
+  out << "energy for idx" << idx <<": "<< -1*(energy_with_loss + loss)<<"\n";
+  out << "energy incl. loss for idx" << idx <<": "<< -1*energy_with_loss<<"\n";
+  out << "loss for idx "<< idx <<": " << loss << "\n";
+  out << "leaving oracle\n\n";
+  dlib::auto_mutex lock(output_mutex_);
+  std::cout << out.str() << std::flush;
+}
+
+template<class LLM>
+typename LLM::ValueType StructSvmDlib<LLM>::hammingLoss( long idx, const std::vector<typename LLM::LabelType>& labels ) const {
+  typename LLM::ValueType loss = 0;
+  for(size_t i = 0; i < labels.size(); ++i) {
+    if(labels[i] != labels_[idx][i]) {
+      loss += 1;
+    }
+  }
+  return loss;
 }
 
 template<class LLM>
@@ -9,6 +9,10 @@
 
 #include <cmath>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/shared_ptr.hpp>
 #include "pgmlink/log.h"
 #include "pgmlink/traxels.h"
 #include "pgmlink/field_of_view.h"
@@ -32,19 +36,43 @@ class GeometryDivision2
      * @param min_angle minimal angle to accept configuration as a division
      * @param distance_dependence if turned off, feature will not depend on distance between ancestor and children
      * @param angle_constraint if turned on, a minimal division angle is demanded
+     * @param dimensions 2 to ignore the z coordinates, or 3
      */
     PGMLINK_EXPORT
-    GeometryDivision2(double mean_div_dist, double min_angle, bool distance_dependence=true, bool angle_constraint=true) 
+    GeometryDivision2(double mean_div_dist, double min_angle, bool distance_dependence=true, bool angle_constraint=true,
+                      int dimensions=3)
     : mean_div_dist_(mean_div_dist), min_angle_(min_angle), 
-      distance_dependence_(distance_dependence), angle_constraint_(angle_constraint)
-    {}
+      distance_dependence_(distance_dependence), angle_constraint_(angle_constraint), dimensions_(dimensions)
+    {
+      if (dimensions != 2 && dimensions != 3) {
+        throw std::invalid_argument("GeometryDivision2: 2 or 3 dimensions required");
+      }
+    }
 
     PGMLINK_EXPORT double operator()(const Traxel& ancestor,
                                      const Traxel& child1,
                                      const Traxel& child2) const;
+
+    /**
+     * The feature of all pairs (i, j), i < j, of children at once, ordered
+     * by i then j. Every position is read once and the angle constraint is
+     * checked on the cosine, without acos; the results are those of
+     * operator() up to rounding at the minimal angle.
+     */
+    PGMLINK_EXPORT void score_pairs(const Traxel& ancestor,
+                                    const std::vector<const Traxel*>& children,
+                                    std::vector<double>& pair_features) const;
   private:
+    template <int Dimensions>
+    double evaluate(const Traxel& ancestor, const Traxel& child1, const Traxel& child2) const;
+    template <int Dimensions>
+    void score_pairs_in(const Traxel& ancestor,
+                        const std::vector<const Traxel*>& children,
+                        std::vector<double>& pair_features) const;
+
     double mean_div_dist_, min_angle_;
     bool distance_dependence_, angle_constraint_; 
+    int dimensions_;
 };
 
 class KasterDivision2
@@ -57,6 +85,11 @@ class KasterDivision2
     PGMLINK_EXPORT double operator()(const Traxel& ancestor,
                                      const Traxel& child1,
                                      const Traxel& child2) const;
+
+    /// the feature of all pairs of children, see GeometryDivision2::score_pairs()
+    PGMLINK_EXPORT void score_pairs(const Traxel& ancestor,
+                                    const std::vector<const Traxel*>& children,
+                                    std::vector<double>& pair_features) const;
   private:
     double w_;
     double div_cost_;
@@ -91,6 +124,7 @@ public:
     {}
     
     PGMLINK_EXPORT double operator()( const Traxel&, const size_t state ) const;
+    PGMLINK_EXPORT double weight() const { return w_; }
 private:
     double w_;
 };
@@ -116,10 +150,12 @@ class NegLnDivision
     {}
     
     PGMLINK_EXPORT double operator()( const Traxel&, const size_t state ) const;
+    PGMLINK_EXPORT double weight() const { return w_; }
 private:
     double w_;
 };
 
+// defined inline: it is evaluated for every arc and state of the model
 class NegLnTransition 
 {
  public:
@@ -127,7 +163,12 @@ class NegLnTransition
     : w_(weight)
     {}
 
-    PGMLINK_EXPORT double operator()( const double ) const;
+    PGMLINK_EXPORT double operator()( const double dist_prob ) const {
+      double arg = dist_prob;
+      if(arg < 0.0000000001) arg = 0.0000000001;
+      return w_*-1*std::log(arg);
+    }
+    PGMLINK_EXPORT double weight() const { return w_; }
 private:
     double w_;
 };
@@ -173,6 +214,26 @@ private:
   int margin_t_;
 };
 
+/**
+ * FieldOfView::spatial_distance_to_border() of every traxel of a store,
+ * computed in one batch over their coordinates and looked up by
+ * (timestep, id). The store itself is not modified.
+ */
+class BorderDistances
+{
+  public:
+    PGMLINK_EXPORT BorderDistances( const TraxelStore& ts, const FieldOfView& fov, bool relative );
+
+    /// false for traxels that were not in the store
+    PGMLINK_EXPORT bool find( const Traxel& tr, double& distance ) const;
+    PGMLINK_EXPORT size_t size() const { return keys_.size(); }
+
+  private:
+    // sorted (timestep, id) and the distances in the same order
+    std::vector<std::pair<int, unsigned int> > keys_;
+    std::vector<double> distances_;
+};
+
 class SpatialBorderAwareWeight
 {
   public:
@@ -186,11 +247,19 @@ class SpatialBorderAwareWeight
 
     PGMLINK_EXPORT double operator()( const Traxel& tr ) const;
 
+    /**
+     * Look the distance to the border up in distances, computed with the
+     * same field of view and relative flag. The distance of any other
+     * traxel is computed as before.
+     */
+    PGMLINK_EXPORT SpatialBorderAwareWeight& use_border_distances( const boost::shared_ptr<const BorderDistances>& distances );
+
   private:
     double cost_;
     double margin_;
     bool relative_;
     FieldOfView fov_;
+    boost::shared_ptr<const BorderDistances> distances_;
   };
 
 
@@ -221,7 +290,9 @@ class ConstantFeature
 class SquaredDistance 
 {
 public:
-  PGMLINK_EXPORT double operator()(const Traxel& from, const Traxel& to) const;
+  PGMLINK_EXPORT double operator()(const Traxel& from, const Traxel& to) const {
+    return from.distance_to(to);
+  }
 };
 
 class KasterDivision 
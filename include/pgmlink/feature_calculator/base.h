@@ -24,6 +24,18 @@ class FeatureCalculator {
   virtual feature_array calculate(const feature_array& /* f1 */, const feature_array& /* f2 */, const feature_array& /* f3 */) const;
   virtual const std::string& name() const;
 
+  // batch evaluation
+  // Evaluates the calculator on n inputs of size values each, stored one
+  // after the other (input i starts at f1 + i * size), and writes the
+  // output_size(size) results of input i to out + i * out_stride. The
+  // defaults go through calculate(); the built-in calculators override
+  // them with plain loops over the contiguous arrays.
+  virtual size_t output_size(size_t input_size) const;
+  virtual void calculate_batch(const feature_type* f1, size_t n, size_t size,
+                               feature_type* out, size_t out_stride) const;
+  virtual void calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                               feature_type* out, size_t out_stride) const;
+
   bool operator==(const FeatureCalculator& other);
   bool operator!=(const FeatureCalculator& other);
 
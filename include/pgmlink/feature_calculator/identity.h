@@ -19,6 +19,8 @@ class IdentityCalculator : public FeatureCalculator {
  public:
   virtual ~IdentityCalculator();
   virtual feature_array calculate(const feature_array& f1) const;
+  virtual void calculate_batch(const feature_type* f1, size_t n, size_t size,
+                               feature_type* out, size_t out_stride) const;
   virtual const std::string& name() const;
 private:
 static const std::string name_;
@@ -22,6 +22,8 @@ class RatioCalculator : public FeatureCalculator {
 
   virtual ~RatioCalculator();
   virtual feature_array calculate(const feature_array& f1, const feature_array& f2) const;
+  virtual void calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                               feature_type* out, size_t out_stride) const;
   virtual feature_array calculate(const feature_array& f1, const feature_array& f2, const feature_array& f3) const;
   virtual const std::string& name() const;
 };
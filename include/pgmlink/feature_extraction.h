@@ -5,6 +5,7 @@
 #include <string>
 #include <map>
 #include <utility>
+#include <vector>
 
 // boost
 #include <boost/shared_ptr.hpp>
@@ -26,11 +27,21 @@ class FeatureCalculator;
 class FeatureExtractor 
 {
  public:
+  typedef std::pair<const Traxel*, const Traxel*> TraxelPair;
+
   PGMLINK_EXPORT FeatureExtractor(boost::shared_ptr<FeatureCalculator> calculator, const std::string& feature_name);
   PGMLINK_EXPORT virtual ~FeatureExtractor();
   PGMLINK_EXPORT virtual feature_array extract(const Traxel& t1) const;
   PGMLINK_EXPORT virtual feature_array extract(const Traxel& t1, const Traxel& t2) const;
   PGMLINK_EXPORT virtual feature_array extract(const Traxel& t1, const Traxel& t2, const Traxel& t3) const;
+
+  // batch extraction
+  // Gathers the feature of all traxels into one contiguous array and
+  // evaluates the calculator once on the whole batch. out gets a row of
+  // calculator()->output_size() values per traxel (pair), in order; the
+  // row size is returned. All traxels have to share the size of the feature.
+  PGMLINK_EXPORT size_t extract(const std::vector<const Traxel*>& traxels, feature_array& out) const;
+  PGMLINK_EXPORT size_t extract(const std::vector<TraxelPair>& pairs, feature_array& out) const;
   PGMLINK_EXPORT boost::shared_ptr<FeatureCalculator> calculator() const;
   PGMLINK_EXPORT virtual std::string name() const;
 
@@ -57,6 +68,70 @@ class MultipleFeatureExtraction
 
 
 
+////
+//// class FeatureExtractionPlan
+////
+/**
+ * A FeatureList compiled for the extraction over many traxels or traxel
+ * pairs, e.g. for the training features of a classifier.
+ *
+ * The calculators are looked up once on construction. Every evaluation
+ * fills a row major matrix with one row per traxel (pair); the row holds
+ * the results of all entries of the list, in order of the list. The sizes
+ * of the features, and with them the offsets of the entries in a row, are
+ * fixed by the first evaluation and must not change afterwards.
+ *
+ * With a schema, traxels interned with that schema are read through their
+ * feature slots; all others by name. Only unary and pairwise calculators
+ * are supported.
+ */
+class FeatureExtractionPlan
+{
+ public:
+  typedef MultipleFeatureExtraction::CombinedFeatureName CombinedFeatureName;
+
+  PGMLINK_EXPORT explicit FeatureExtractionPlan( const MultipleFeatureExtraction::FeatureList& features,
+                                                 boost::shared_ptr<FeatureSchema> schema = boost::shared_ptr<FeatureSchema>() );
+
+  /// evaluate on every traxel; returns the row size
+  PGMLINK_EXPORT size_t operator() ( const std::vector<const Traxel*>& traxels, feature_array& out );
+  /// evaluate on every pair; returns the row size
+  PGMLINK_EXPORT size_t operator() ( const std::vector<FeatureExtractor::TraxelPair>& pairs, feature_array& out );
+
+  /// whether the first evaluation fixed the layout of the rows
+  PGMLINK_EXPORT bool has_layout() const { return has_layout_; }
+  PGMLINK_EXPORT size_t row_size() const { return row_size_; }
+  PGMLINK_EXPORT size_t size() const { return entries_.size(); }
+  PGMLINK_EXPORT const CombinedFeatureName& name( size_t entry ) const { return entries_.at(entry).name; }
+  PGMLINK_EXPORT size_t offset( size_t entry ) const { return entries_.at(entry).offset; }
+  PGMLINK_EXPORT size_t output_size( size_t entry ) const { return entries_.at(entry).output_size; }
+
+  /// the results of a row as returned by MultipleFeatureExtraction
+  PGMLINK_EXPORT MultipleFeatureExtraction::CombinedFeatureMap row( const feature_array& out, size_t i ) const;
+
+ private:
+  struct Entry {
+    CombinedFeatureName name;
+    boost::shared_ptr<FeatureCalculator> calculator;
+    FeatureSchema::slot_type slot;
+    size_t input_size;
+    size_t offset;
+    size_t output_size;
+  };
+
+  void fix_layout( const Traxel& trax );
+  // the feature of entry in trax and its size; throws if it is absent
+  const feature_type* feature( const Entry& entry, const Traxel& trax, size_t& size ) const;
+  void gather( const Entry& entry, const Traxel& trax, feature_array& buffer ) const;
+
+  boost::shared_ptr<FeatureSchema> schema_;
+  std::vector<Entry> entries_;
+  bool has_layout_;
+  size_t row_size_;
+};
+
+
+
 ////
 //// helpers
 ////
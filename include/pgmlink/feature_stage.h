@@ -0,0 +1,79 @@
+/**
+   @file
+   @ingroup tracking
+   @brief parallel computation of derived traxel features
+*/
+
+#ifndef FEATURE_STAGE_H
+#define FEATURE_STAGE_H
+
+#include <string>
+
+#include "pgmlink/log.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+/**
+ * Pipeline stage that derives features of every traxel in a store.
+ *
+ * The stage function has to provide
+ *
+ *     typedef ... scratch_type; // default constructible
+ *     void operator()(const Traxel&, FeatureMap&, scratch_type&) const;
+ *
+ * Traxels are visited via modify_features(), i.e. timesteps are handed
+ * out to the threads when running in parallel. Every thread owns one
+ * scratch_type for all traxels it visits, so buffers kept there are
+ * allocated once per thread instead of once per traxel. The function
+ * itself is shared and has to be thread safe.
+ */
+template<typename Function>
+class FeatureStage {
+ public:
+  typedef typename Function::scratch_type scratch_type;
+
+  FeatureStage(const std::string& name, const Function& f, bool parallel = true)
+  : name_(name), f_(f), parallel_(parallel) {}
+
+  const std::string& name() const { return name_; }
+  bool parallel() const { return parallel_; }
+
+  /// run over timesteps [first, last]
+  void operator()(TraxelStore& ts, int first, int last) const {
+    LOG(logDEBUG) << "FeatureStage " << name_ << ": timesteps [" << first << ", " << last << "]"
+                  << (parallel_ ? " in parallel" : "");
+    modify_features(ts, Visitor(f_), first, last, parallel_);
+  }
+
+  /// run over all timesteps
+  void operator()(TraxelStore& ts) const {
+    if(!ts.empty()) {
+      (*this)(ts, earliest_timestep(ts), latest_timestep(ts));
+    }
+  }
+
+ private:
+  // copied per thread by modify_features()
+  struct Visitor {
+    explicit Visitor(const Function& f) : f(&f), scratch() {}
+    void operator()(const Traxel& t, FeatureMap& features) { (*f)(t, features, scratch); }
+    const Function* f;
+    scratch_type scratch;
+  };
+
+  std::string name_;
+  Function f_;
+  bool parallel_;
+};
+
+template<typename Function>
+FeatureStage<Function> feature_stage(const std::string& name, const Function& f, bool parallel = true) {
+  return FeatureStage<Function>(name, f, parallel);
+}
+
+/// scratch_type of stage functions that need none
+struct NoScratch {};
+
+} /* namespace pgmlink */
+
+#endif /* FEATURE_STAGE_H */
@@ -7,6 +7,7 @@
 #ifndef FIELD_OF_VIEW_H
 #define FIELD_OF_VIEW_H
 
+#include <cstddef>
 #include <vector>
 #include "pgmlink/pgmlink_export.h"
 
@@ -59,6 +60,13 @@ namespace pgmlink {
      */
     PGMLINK_EXPORT double spatial_margin( double t, double x, double y, double z ) const;
     PGMLINK_EXPORT double spatial_distance_to_border( double t, double x, double y, double z, bool relative ) const;
+
+    /**
+     * spatial_distance_to_border() of n points at once; xyz holds x, y
+     * and z of every point. The faces of the cuboid are set up once per
+     * call instead of once per point.
+     */
+    PGMLINK_EXPORT void spatial_distances_to_border( const double* xyz, size_t n, bool relative, double* distances ) const;
     
     /** Shortest distance to the temporal boundary of the field of view. */
     PGMLINK_EXPORT double temporal_margin( double t, double x, double y, double z ) const;
@@ -0,0 +1,60 @@
+/**
+   @file
+   @ingroup tracking
+   @brief loading traxelstores from hdf5 object tables
+*/
+
+#ifndef HDF5_TRAXELSTORE_H
+#define HDF5_TRAXELSTORE_H
+
+#include <string>
+#include <vector>
+
+#include "pgmlink/pgmlink_export.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+/**
+ * @page hdf5_traxelstore HDF5 object tables
+ *
+ * One group per timestep below a common root; the group name is the
+ * timestep. Every dataset in a timestep group is a feature table with one
+ * row per object, either one dimensional (a scalar per object) or two
+ * dimensional (objects x feature size). An optional id dataset holds the
+ * object ids; otherwise rows are labeled 1, 2, ... (label 0 is the
+ * background in a label image).
+ *
+ *     /objects/0/com      (n_0 x 3)
+ *     /objects/0/count    (n_0)
+ *     /objects/0/ids      (n_0)
+ *     /objects/1/...
+ */
+struct HDF5TraxelStoreOptions {
+  PGMLINK_EXPORT HDF5TraxelStoreOptions()
+  : group("/objects"), id_dataset("ids"), timesteps_per_chunk(16) {}
+
+  /// root group of the timestep groups; relative to the file root
+  std::string group;
+  /// name of the id dataset in every timestep group
+  std::string id_dataset;
+  /// features to load; all datasets if empty
+  std::vector<std::string> features;
+  /// number of timesteps read before the traxels are assembled
+  /// (bounds the memory held by the raw tables)
+  size_t timesteps_per_chunk;
+};
+
+/**
+ * Add the objects of all timestep groups to ts.
+ *
+ * Feature tables are read as a whole (one read per table and timestep)
+ * and the traxels of a chunk of timesteps are assembled in parallel
+ * before they are added to the store.
+ * @return number of added traxels
+ */
+PGMLINK_EXPORT size_t load_hdf5(TraxelStore& ts, const std::string& filename,
+                                const HDF5TraxelStoreOptions& options = HDF5TraxelStoreOptions());
+
+} /* namespace pgmlink */
+
+#endif /* HDF5_TRAXELSTORE_H */
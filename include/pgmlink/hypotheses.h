@@ -12,8 +12,12 @@
 #include <sstream>
 #include <stdexcept>
 #include <map>
+#include <utility>
 #include <boost/serialization/set.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 #include <boost/shared_ptr.hpp>
+#include <lemon/adaptors.h>
 #include <lemon/list_graph.h>
 #include <lemon/maps.h>
 
@@ -50,6 +54,28 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
 }
 
 
+////
+//// TraxelHandleMap
+////
+// Node map of references to traxels owned elsewhere, usually by a
+// TraxelStore (whose elements keep their address until they are erased).
+// Read like the node_traxel map, but without copying the traxels; the
+// referenced traxels have to outlive the map.
+template <typename Graph>
+class TraxelHandleMap : public Graph::template NodeMap<const Traxel*> {
+ public:
+  typedef typename Graph::template NodeMap<const Traxel*> Parent;
+  typedef typename Graph::Node Key;
+  typedef Traxel Value;
+
+  explicit TraxelHandleMap(const Graph& graph) : Parent(graph, 0) {}
+
+  void set(const Key& key, const Traxel& traxel) { Parent::set(key, &traxel); }
+  const Traxel& operator[](const Key& key) const { return *Parent::operator[](key); }
+  bool has_traxel(const Key& key) const { return Parent::operator[](key) != 0; }
+};
+
+
   ////
   //// HypothesesGraph
   ////
@@ -77,6 +103,17 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
   template <typename Graph>
     const std::string property_map<node_traxel,Graph>::name = "node_traxel";
 
+  // node_traxel_handle: alternative to node_traxel that refers to the
+  // traxels instead of holding copies (see NodeTraxels)
+  struct node_traxel_handle {};
+  template <typename Graph>
+    struct property_map<node_traxel_handle, Graph> {
+    typedef TraxelHandleMap< Graph > type;
+    static const std::string name;
+  };
+  template <typename Graph>
+    const std::string property_map<node_traxel_handle,Graph>::name = "node_traxel_handle";
+
   // node_traxel
 	struct node_tracklet {};
 	template <typename Graph>
@@ -260,6 +297,9 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
 
 
 
+  struct MemoryReport;
+  class NodeTraxels;
+
   class HypothesesGraph 
   : public PropertyGraph<lemon::ListDigraph> 
   {
@@ -282,6 +322,35 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
     PGMLINK_EXPORT const std::set<HypothesesGraph::node_timestep_map::Value>& timesteps() const;
     PGMLINK_EXPORT node_timestep_map::Value earliest_timestep() const;
     PGMLINK_EXPORT node_timestep_map::Value latest_timestep() const;
+
+    // Dense (timestep, traxel id) -> node index of the node_traxel property.
+    // add_traxel_node() keeps the index of its timestep up to date; after
+    // add_node() the timestep is reindexed on the next lookup (the traxel
+    // has to be set by then). Erased nodes are skipped on lookup, but the
+    // node of a traxel whose id was changed in place has to be reindexed
+    // with index_traxel_node(). Lookups are not thread safe, since they may
+    // reindex; call index_traxel_nodes() first to make them read only.
+    // The index is a table by traxel id, so ids far beyond the number of
+    // nodes (see max_indexed_traxel_id()) throw std::runtime_error.
+    PGMLINK_EXPORT HypothesesGraph::Node add_traxel_node(const Traxel& traxel);
+    PGMLINK_EXPORT void index_traxel_node(HypothesesGraph::Node node, const Traxel& traxel);
+    PGMLINK_EXPORT void index_traxel_nodes() const;
+    // lemon::INVALID if there is no such node
+    PGMLINK_EXPORT HypothesesGraph::Node traxel_node(node_timestep_map::Value timestep, unsigned int id) const;
+    // the index of timestep; entries without node are lemon::INVALID and
+    // erased nodes are not removed
+    PGMLINK_EXPORT const std::vector<HypothesesGraph::Node>& traxel_nodes(node_timestep_map::Value timestep) const;
+    // largest traxel id of the nodes at timestep (0 if there are none)
+    PGMLINK_EXPORT unsigned int max_traxel_id(node_timestep_map::Value timestep) const;
+
+    // the traxels of the nodes are in node_traxel or node_traxel_handle
+    PGMLINK_EXPORT bool has_traxels() const;
+    // copies traxel to node_traxel or refers to it in node_traxel_handle,
+    // whichever the graph has; does not reindex the node
+    PGMLINK_EXPORT void set_traxel(HypothesesGraph::Node node, const Traxel& traxel);
+
+    // estimated bytes of the timestep set and the traxel node index
+    PGMLINK_EXPORT size_t index_memory_bytes() const;
     
   private:
     // boost serialize
@@ -292,15 +361,206 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
       void load( Archive&, const unsigned int /*version*/ );
     BOOST_SERIALIZATION_SPLIT_MEMBER()
 
+    const std::vector<HypothesesGraph::Node>& indexed_traxel_nodes(node_timestep_map::Value timestep) const;
+    // largest id the table of a timestep may grow to
+    size_t max_indexed_traxel_id() const;
+    void index_at(std::vector<HypothesesGraph::Node>& nodes, HypothesesGraph::Node node, unsigned int id) const;
+    bool is_traxel_node(const NodeTraxels& traxels, HypothesesGraph::Node node,
+                        node_timestep_map::Value timestep, unsigned int id) const;
+
     std::set<node_timestep_map::Value> timesteps_;      
+    // timestep -> nodes by traxel id; timesteps without entry are indexed lazily
+    mutable std::map<node_timestep_map::Value, std::vector<HypothesesGraph::Node> > traxel_nodes_;
   };
 
+  /**
+   * Read access to the traxels of the nodes of a graph, whether they are
+   * stored as copies (node_traxel) or as handles (node_traxel_handle).
+   * Read-only stages should use this instead of the node_traxel map.
+   */
+  class NodeTraxels {
+  public:
+    typedef HypothesesGraph::Node Key;
+    typedef Traxel Value;
+
+    // throws if the graph has no traxels
+    PGMLINK_EXPORT explicit NodeTraxels(const HypothesesGraph& g);
+
+    const Traxel& operator[](const Key& node) const {
+      return copies_ ? (*copies_)[node] : (*handles_)[node];
+    }
+
+  private:
+    const property_map<node_traxel, HypothesesGraph::base_graph>::type* copies_;
+    const property_map<node_traxel_handle, HypothesesGraph::base_graph>::type* handles_;
+  };
+
+  /**
+   * Map from nodes or arcs of a HypothesesGraph to values, indexed by the
+   * dense lemon ids instead of a search tree.
+   *
+   * Offers the subset of the std::map interface the reasoners use; the
+   * iteration visits the entries in insertion order. The map does not
+   * follow changes of the graph: erased items have to be cleared with
+   * the map.
+   */
+  template <typename Key, typename Value>
+  class DenseItemMap {
+  public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<Key, Value> value_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    iterator begin() { return entries_.begin(); }
+    iterator end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    void clear() {
+      entries_.clear();
+      positions_.clear();
+    }
+
+    iterator find(const Key& key) {
+      const int position = position_of(key);
+      return position < 0 ? entries_.end() : entries_.begin() + position;
+    }
+    const_iterator find(const Key& key) const {
+      const int position = position_of(key);
+      return position < 0 ? entries_.end() : entries_.begin() + position;
+    }
+    size_t count(const Key& key) const { return position_of(key) < 0 ? 0 : 1; }
+
+    // does not overwrite an existing entry, like std::map::insert
+    std::pair<iterator, bool> insert(const value_type& entry) {
+      const int id = HypothesesGraph::base_graph::id(entry.first);
+      if (position_of(entry.first) >= 0) {
+        return std::make_pair(entries_.begin() + positions_[id], false);
+      }
+      if (static_cast<size_t>(id) >= positions_.size()) {
+        positions_.resize(id + 1, -1);
+      }
+      positions_[id] = static_cast<int>(entries_.size());
+      entries_.push_back(entry);
+      return std::make_pair(entries_.end() - 1, true);
+    }
+
+    Value& operator[](const Key& key) {
+      return insert(value_type(key, Value())).first->second;
+    }
+
+  private:
+    int position_of(const Key& key) const {
+      const int id = HypothesesGraph::base_graph::id(key);
+      return id >= 0 && static_cast<size_t>(id) < positions_.size() ? positions_[id] : -1;
+    }
+
+    std::vector<value_type> entries_;
+    // entry of every item id, -1 for items without entry
+    std::vector<int> positions_;
+  };
+
+  /**
+   * The active part of a solved graph: the nodes marked by node_active (or
+   * node_active2 > 0) and the arcs marked by arc_active between them.
+   *
+   * A lemon SubDigraph over the graph, which is not modified; the items of
+   * the view are the items of the graph, so all property maps apply. Event
+   * extraction on the view gives the same events as on the graph after
+   * prune_inactive(). Without node activity properties, all nodes are
+   * active. The view is not updated when the activity properties change.
+   */
+  class ActiveSubgraph {
+  public:
+    typedef HypothesesGraph::base_graph::NodeMap<bool> NodeFilter;
+    typedef HypothesesGraph::base_graph::ArcMap<bool> ArcFilter;
+    typedef lemon::SubDigraph<const HypothesesGraph::base_graph, NodeFilter, ArcFilter> Digraph;
+
+    // throws if the graph has no arc_active property
+    PGMLINK_EXPORT explicit ActiveSubgraph(const HypothesesGraph& g);
+
+    const HypothesesGraph& graph() const { return g_; }
+    const Digraph& digraph() const { return digraph_; }
+    bool active(const HypothesesGraph::Node& n) const { return nodes_[n]; }
+    bool active(const HypothesesGraph::Arc& a) const { return digraph_.status(a) && nodes_[g_.source(a)] && nodes_[g_.target(a)]; }
+
+  private:
+    ActiveSubgraph(const ActiveSubgraph&);
+    ActiveSubgraph& operator=(const ActiveSubgraph&);
+
+    const HypothesesGraph& g_;
+    NodeFilter nodes_;
+    ArcFilter arcs_;
+    Digraph digraph_;
+  };
+
+  /**
+   * Flat node and arc arrays of a HypothesesGraph.
+   *
+   * Nodes are numbered densely in NodeIt order; arcs refer to these
+   * numbers. This is the layout of the serialized graph.
+   */
+  struct HypothesesGraphArrays {
+    std::vector<int> node_timesteps;
+    std::vector<int> arc_sources;
+    std::vector<int> arc_targets;
+    std::vector<int> arc_from_timesteps;
+    std::vector<int> arc_to_timesteps;
+
+    template< typename Archive >
+      void serialize( Archive& ar, const unsigned int /*version*/ ) {
+      ar & node_timesteps & arc_sources & arc_targets & arc_from_timesteps & arc_to_timesteps;
+    }
+  };
+  // nodes: the node of every node number
+  PGMLINK_EXPORT void to_arrays( const HypothesesGraph&, HypothesesGraphArrays&, std::vector<HypothesesGraph::Node>& nodes );
+  // arcs: the arc of every arc number, for property columns
+  PGMLINK_EXPORT void to_arrays( const HypothesesGraph&, HypothesesGraphArrays&, std::vector<HypothesesGraph::Node>& nodes,
+                                 std::vector<HypothesesGraph::Arc>& arcs );
+  // adds the nodes and arcs to the graph
+  PGMLINK_EXPORT void from_arrays( HypothesesGraph&, const HypothesesGraphArrays&, std::vector<HypothesesGraph::Node>& nodes );
+  PGMLINK_EXPORT void from_arrays( HypothesesGraph&, const HypothesesGraphArrays&, std::vector<HypothesesGraph::Node>& nodes,
+                                   std::vector<HypothesesGraph::Arc>& arcs );
+
+  /**
+   * Compact binary graph format (a boost binary archive of the node and
+   * arc arrays and the traxels).
+   *
+   * With traxel_references, nodes refer to their traxel by (timestep, id)
+   * instead of holding a copy; the traxels are looked up in ts when the
+   * graph is read.
+   */
+  PGMLINK_EXPORT void write_binary( const HypothesesGraph&, std::ostream& os, bool traxel_references=false );
+
+  /**
+   * Add the estimated bytes of the graph structure, its indices and every
+   * property map of the graph to the report.
+   *
+   * The iterable value maps keep a copy of every distinct value (e.g. of
+   * every traxel of node_traxel) besides the value of every item, which is
+   * included in the estimate of the map.
+   */
+  PGMLINK_EXPORT void add_memory_usage( const HypothesesGraph&, MemoryReport& report );
+  PGMLINK_EXPORT void read_binary( HypothesesGraph&, std::istream& is, const TraxelStore* ts=0 );
+
   PGMLINK_EXPORT void generateTrackletGraph(const HypothesesGraph& traxel_graph, HypothesesGraph& tracklet_graph);
   PGMLINK_EXPORT std::map<HypothesesGraph::Node, std::vector<HypothesesGraph::Node> > generateTrackletGraph2(
 		  const HypothesesGraph& traxel_graph, HypothesesGraph& tracklet_graph);
   PGMLINK_EXPORT HypothesesGraph& prune_inactive(HypothesesGraph&);
   PGMLINK_EXPORT boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGraph&);
   PGMLINK_EXPORT boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(const HypothesesGraph& g);
+  // the events of the active part of a solved graph, without pruning it
+  PGMLINK_EXPORT boost::shared_ptr<std::vector< std::vector<Event> > > events(const ActiveSubgraph&);
+  PGMLINK_EXPORT boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(const ActiveSubgraph&);
+  // hand the events to sink timestep by timestep instead of collecting them
+  PGMLINK_EXPORT void events(const HypothesesGraph&, EventSink& sink);
+  PGMLINK_EXPORT void events(const ActiveSubgraph&, EventSink& sink);
+  PGMLINK_EXPORT void multi_frame_move_events(const HypothesesGraph&, EventSink& sink);
+  PGMLINK_EXPORT void multi_frame_move_events(const ActiveSubgraph&, EventSink& sink);
   PGMLINK_EXPORT boost::shared_ptr<std::vector< std::vector<Event> > > merge_event_vectors(const std::vector<std::vector<Event> >& ev1, const std::vector<std::vector<Event> >& ev2);
   PGMLINK_EXPORT boost::shared_ptr<std::vector< std::map<unsigned int, bool> > > state_of_nodes(const HypothesesGraph&);
 
@@ -332,40 +592,166 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
   ////
   //// SingleTimestepTraxel_HypothesesBuilder
   ////
+  class SpatialIndex;
+  class StreamingTraxelStore;
   class SingleTimestepTraxel_HypothesesBuilder 
   : public HypothesesBuilder 
   {
    public:
     struct Options 
     {
+        // spatial index for the neighbor search
+        enum SpatialIndexType {
+          KDTreeIndex, // ANN kd-tree
+          GridIndex,   // uniform grid with cells of distance_threshold
+          AutoIndex    // GridIndex for parallel builds, else KDTreeIndex
+        };
+
 	    PGMLINK_EXPORT Options(unsigned int mnn = 6, double dt = 50,
 			                  bool forward_backward=false, bool consider_divisions=false,
-			                  double division_threshold = 0.5)
+			                  double division_threshold = 0.5, bool parallel = false,
+			                  SpatialIndexType spatial_index = AutoIndex,
+			                  bool traxel_handles = false, int dimensions = 3)
         : max_nearest_neighbors(mnn), distance_threshold(dt), forward_backward(forward_backward),
   		  consider_divisions(consider_divisions),
-  		  division_threshold(division_threshold)
+  		  division_threshold(division_threshold),
+  		  parallel(parallel),
+  		  spatial_index(spatial_index),
+  		  traxel_handles(traxel_handles),
+  		  dimensions(dimensions)
         {}
 
   	    unsigned int max_nearest_neighbors;
   	    double distance_threshold;
   	    bool forward_backward, consider_divisions;
   	    double division_threshold;
+  	    // collect the neighbor candidates of all timesteps concurrently
+  	    // (ignored for streaming traxelstores); for a given index the
+  	    // resulting graph is the same. Only the GridIndex searches run in
+  	    // parallel: ANN serializes all kd-tree builds and searches (see
+  	    // NearestNeighborSearch), so AutoIndex picks the grid.
+  	    bool parallel;
+  	    // the grid is faster for nearly uniform densities; the resulting
+  	    // graph is the same up to kNN ties at equal distance
+  	    SpatialIndexType spatial_index;
+  	    // refer to the traxels of the traxelstore (node_traxel_handle)
+  	    // instead of copying them into the graph (node_traxel); the
+  	    // traxelstore has to outlive the graph and its traxels must not be
+  	    // erased. Not available for streaming traxelstores.
+  	    bool traxel_handles;
+  	    // 2 for planar data: the kd-trees ignore the z coordinates
+  	    int dimensions;
+  	    // features copied into the nodes (node_traxel) besides the
+  	    // position features; empty copies all. With a streaming
+  	    // traxelstore, the graph holds these copies of the whole movie.
+  	    std::vector<std::string> node_features;
     };
 
     PGMLINK_EXPORT SingleTimestepTraxel_HypothesesBuilder(const TraxelStore* ts, const Options& o = Options()) 
-    : ts_(ts), options_(o) 
+    : ts_(ts), streaming_ts_(0), options_(o) 
+    {}
+
+    // page the traxels in timestep by timestep instead of keeping them
+    // resident. The nodes hold copies of the traxels (node_traxel), since
+    // handles would dangle once their timestep is paged out; restrict
+    // them to the features the tracking reads with node_features.
+    PGMLINK_EXPORT SingleTimestepTraxel_HypothesesBuilder(StreamingTraxelStore* ts, const Options& o = Options()) 
+    : ts_(0), streaming_ts_(ts), options_(o) 
     {}
 
+    // The spatial indices of the timesteps are kept between builds and
+    // shared by the forward and backward pass of timesteps without
+    // com_corrected. A grid is rebuilt when the distance threshold is
+    // more than twice or less than half its cell size, and an index of
+    // the other type is replaced; clear them after changing the
+    // traxelstore or the dimensions option. Streaming traxelstores are
+    // not cached.
+    PGMLINK_EXPORT void clear_index_cache() { indices_.clear(); }
+
+    // Append the traxels of timesteps [first_timestep, last_timestep] to a
+    // graph built from the same traxelstore: adds their nodes and the arcs
+    // between the new timesteps and to the previous latest timestep. The
+    // timesteps have to be later than all timesteps of the graph. With the
+    // index cache, the cost is about that of the new timesteps.
+    PGMLINK_EXPORT HypothesesGraph* extend(HypothesesGraph* graph, int first_timestep, int last_timestep) const;
+    PGMLINK_EXPORT size_t n_cached_indices() const { return indices_.size(); }
+    PGMLINK_EXPORT Options& options() { return options_; }
+
    protected:
     // builder method implementations
     PGMLINK_EXPORT virtual HypothesesGraph* construct() const;
     PGMLINK_EXPORT virtual HypothesesGraph* add_nodes(HypothesesGraph*) const;
     PGMLINK_EXPORT virtual HypothesesGraph* add_edges(HypothesesGraph*) const;
 
+    // traxels of timestep; only valid until the next call
+    const TraxelStore& traxels_at(int timestep) const;
+
+    // (node at timestep, id of neighbor traxel) in node order
+    typedef std::vector<std::pair<HypothesesGraph::Node, unsigned int> > Candidates;
+    // arcs between the nodes at timestep and their candidates at
+    // to_timestep (pointing backward in time if reverse, without
+    // duplicating existing arcs); sets arc_from_timestep and arc_to_timestep
+    void add_arcs(HypothesesGraph*, int timestep, int to_timestep, bool reverse, const Candidates&) const;
+    // spatial index of the traxels at timestep (on the corrected positions
+    // if reverse and there are any), in options_.dimensions
+    boost::shared_ptr<SpatialIndex> index_at(int timestep, bool reverse) const;
+    // options_.spatial_index resolved
+    bool grid_index() const;
+
     const TraxelStore* ts_;
+    StreamingTraxelStore* streaming_ts_;
     Options options_;
   private:
-    HypothesesGraph* add_edges_at(HypothesesGraph*, int timestep, bool reverse=false) const;
+    void add_nodes_in(HypothesesGraph*, int first_timestep, int last_timestep) const;
+    // arcs of the timesteps from forward_from on (forward) and from
+    // backward_from on (backward)
+    void add_edges_from(HypothesesGraph*, int forward_from, int backward_from) const;
+    // search only; safe to call concurrently for different timesteps
+    void candidates_at(const HypothesesGraph&, int timestep, bool reverse, Candidates&) const;
+
+    // a cached index with the cell size it was built for (0 for kd-trees)
+    struct CachedIndex {
+        double cell_size;
+        boost::shared_ptr<SpatialIndex> index;
+    };
+    // by (timestep, on the corrected positions)
+    mutable std::map<std::pair<int, bool>, CachedIndex> indices_;
+  };
+
+
+
+  ////
+  //// GapClosing_HypothesesBuilder
+  ////
+  /**
+   * Single timestep builder that bridges missed detections.
+   *
+   * After the arcs to the adjacent timesteps are added, every node without
+   * outgoing arc is offered arcs to its nearest neighbors (within the
+   * distance threshold) in the first of the timesteps t+2, ..., t+max_gap
+   * that has any; with forward_backward, nodes without incoming arc are
+   * treated likewise backward in time. The timesteps bridged by an arc are
+   * in arc_from_timestep and arc_to_timestep and are reported by
+   * multi_frame_move_events().
+   */
+  class GapClosing_HypothesesBuilder
+  : public SingleTimestepTraxel_HypothesesBuilder
+  {
+   public:
+    PGMLINK_EXPORT GapClosing_HypothesesBuilder(const TraxelStore* ts, const Options& o = Options(),
+                                                unsigned int max_gap = 2)
+    : SingleTimestepTraxel_HypothesesBuilder(ts, o), max_gap_(max_gap)
+    {}
+
+    PGMLINK_EXPORT unsigned int max_gap() const { return max_gap_; }
+
+   protected:
+    PGMLINK_EXPORT virtual HypothesesGraph* add_edges(HypothesesGraph*) const;
+
+   private:
+    void add_gap_arcs(HypothesesGraph*, bool reverse) const;
+
+    unsigned int max_gap_;
   };
 
 
@@ -378,36 +764,61 @@ Value& IterableEditableValueMap<Graph, Key, Value>::get_value(const Key& key) {
     void HypothesesGraph::save( Archive& ar, const unsigned int /*version*/ ) const {
     ar & timesteps_;
     
-    bool with_n_traxel = false;
-    try {
-      this->get(node_traxel());
-      with_n_traxel = true;
-    } catch( std::runtime_error& e ) {}
+    // traxel handles are saved as copies
+    bool with_n_traxel = has_traxels();
     ar & with_n_traxel;
 
-    std::string lgf;
-    {
-      std::stringstream ss;
-      write_lgf(*this, ss, with_n_traxel);
-      lgf = ss.str();
+    HypothesesGraphArrays arrays;
+    std::vector<Node> nodes;
+    to_arrays(*this, arrays, nodes);
+    ar & arrays;
+    if(with_n_traxel) {
+      const NodeTraxels traxel_map(*this);
+      for(std::vector<Node>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+        const Traxel& traxel = traxel_map[*node];
+        ar & traxel;
+      }
     }
-    ar & lgf;
   }
 
   template< typename Archive >
-    void HypothesesGraph::load( Archive& ar, const unsigned int /*version*/ ) {
+    void HypothesesGraph::load( Archive& ar, const unsigned int version ) {
     ar & timesteps_;
 
     bool with_n_traxel;
     ar & with_n_traxel;
 
-    std::string lgf;
-    ar & lgf;
-    {
-      std::stringstream ss(lgf);
-      read_lgf(*this, ss, with_n_traxel);
+    if(version == 0) {
+      // lgf text with the traxels as embedded text archives
+      std::string lgf;
+      ar & lgf;
+      {
+        std::stringstream ss(lgf);
+        read_lgf(*this, ss, with_n_traxel);
+      }
+    } else {
+      HypothesesGraphArrays arrays;
+      ar & arrays;
+      std::vector<Node> nodes;
+      from_arrays(*this, arrays, nodes);
+      if(with_n_traxel) {
+        if(!has_property(node_traxel())) {
+          add(node_traxel());
+        }
+        property_map<node_traxel, base_graph>::type& traxel_map = get(node_traxel());
+        for(std::vector<Node>::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+          Traxel traxel;
+          ar & traxel;
+          traxel_map.set(*node, traxel);
+        }
+      }
     }
+    traxel_nodes_.clear();
    }
 
 }
+
+// version 0: lgf text archive
+BOOST_CLASS_VERSION(pgmlink::HypothesesGraph, 1)
+
 #endif /* HYPOTHESES_H */
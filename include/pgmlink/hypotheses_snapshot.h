@@ -0,0 +1,118 @@
+/**
+   @file
+   @ingroup matching
+   @brief frozen compressed sparse row view of a hypotheses graph
+*/
+
+#ifndef HYPOTHESES_SNAPSHOT_H
+#define HYPOTHESES_SNAPSHOT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+  /**
+   * Read-only compressed sparse row (CSR) copy of the adjacency of a
+   * HypothesesGraph.
+   *
+   * Nodes are numbered densely in NodeIt order. Arcs are numbered by
+   * source node and, for every source, in OutArcIt order, so the out arcs
+   * of node i are the arcs out_begin(i), ..., out_end(i) - 1. The in arcs
+   * of node i are in_arc(j) for j in [in_begin(i), in_end(i)), in InArcIt
+   * order. Iterating the snapshot thus visits nodes and arcs in the same
+   * order as the lemon iterators of the graph it was taken of.
+   *
+   * Properties are gathered into flat arrays indexed by node or arc
+   * number with node_column() and arc_column().
+   *
+   * The snapshot is not updated when the graph changes; take a new one
+   * after nodes or arcs were added or erased.
+   */
+  class HypothesesGraphSnapshot {
+  public:
+    typedef HypothesesGraph::Node Node;
+    typedef HypothesesGraph::Arc Arc;
+
+    /// node_index()/arc_index() of items that are not in the snapshot
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    PGMLINK_EXPORT explicit HypothesesGraphSnapshot(const HypothesesGraph& g);
+
+    std::size_t node_count() const { return nodes_.size(); }
+    std::size_t arc_count() const { return arcs_.size(); }
+
+    Node node(std::size_t i) const { return nodes_[i]; }
+    Arc arc(std::size_t k) const { return arcs_[k]; }
+    PGMLINK_EXPORT std::size_t node_index(const Node& n) const;
+    PGMLINK_EXPORT std::size_t arc_index(const Arc& a) const;
+
+    std::size_t out_begin(std::size_t i) const { return out_offsets_[i]; }
+    std::size_t out_end(std::size_t i) const { return out_offsets_[i + 1]; }
+    std::size_t out_degree(std::size_t i) const { return out_end(i) - out_begin(i); }
+
+    std::size_t in_begin(std::size_t i) const { return in_offsets_[i]; }
+    std::size_t in_end(std::size_t i) const { return in_offsets_[i + 1]; }
+    std::size_t in_degree(std::size_t i) const { return in_end(i) - in_begin(i); }
+    std::size_t in_arc(std::size_t j) const { return in_arcs_[j]; }
+
+    /// node numbers of the arc ends
+    std::size_t source(std::size_t k) const { return sources_[k]; }
+    std::size_t target(std::size_t k) const { return targets_[k]; }
+
+    const std::vector<int>& node_timesteps() const { return node_timesteps_; }
+    const std::vector<int>& arc_from_timesteps() const { return arc_from_timesteps_; }
+    const std::vector<int>& arc_to_timesteps() const { return arc_to_timesteps_; }
+
+    /// column[i] = map[node(i)]
+    template<typename Map, typename Value>
+      void node_column(const Map& map, std::vector<Value>& column) const;
+    /// column[k] = map[arc(k)]
+    template<typename Map, typename Value>
+      void arc_column(const Map& map, std::vector<Value>& column) const;
+
+  private:
+    std::vector<Node> nodes_;
+    std::vector<Arc> arcs_;
+    // lemon id -> number
+    std::vector<std::size_t> node_numbers_;
+    std::vector<std::size_t> arc_numbers_;
+
+    std::vector<std::size_t> out_offsets_;
+    std::vector<std::size_t> in_offsets_;
+    std::vector<std::size_t> in_arcs_;
+    std::vector<std::size_t> sources_;
+    std::vector<std::size_t> targets_;
+
+    std::vector<int> node_timesteps_;
+    std::vector<int> arc_from_timesteps_;
+    std::vector<int> arc_to_timesteps_;
+  };
+
+
+
+  /******************/
+  /* Implementation */
+  /******************/
+
+  template<typename Map, typename Value>
+    void HypothesesGraphSnapshot::node_column(const Map& map, std::vector<Value>& column) const {
+    column.resize(nodes_.size());
+    for(std::size_t i = 0; i < nodes_.size(); ++i) {
+      column[i] = map[nodes_[i]];
+    }
+  }
+
+  template<typename Map, typename Value>
+    void HypothesesGraphSnapshot::arc_column(const Map& map, std::vector<Value>& column) const {
+    column.resize(arcs_.size());
+    for(std::size_t k = 0; k < arcs_.size(); ++k) {
+      column[k] = map[arcs_[k]];
+    }
+  }
+
+} /* namespace pgmlink */
+
+#endif /* HYPOTHESES_SNAPSHOT_H */
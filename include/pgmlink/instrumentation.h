@@ -0,0 +1,176 @@
+/**
+   @file
+   @ingroup util
+   @brief scoped timers and counters for profiling a tracking run
+*/
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "pgmlink/pgmlink_export.h"
+
+/**
+ * @page instrumentation Instrumentation
+ *
+ * Timers and counters at interesting places of the library, compiled in
+ * with the CMake option WITH_INSTRUMENTATION (which defines
+ * PGMLINK_INSTRUMENTATION); otherwise the macros expand to nothing.
+ * @code
+ * void f() {
+ *   PGMLINK_TIMED_SCOPE("f");
+ *   ...
+ *   PGMLINK_COUNT("f: arcs added", n_arcs);
+ * }
+ * @endcode
+ * Every thread aggregates into probes of its own, report() sums them up:
+ * @code
+ * pgmlink::instrumentation::report(std::cerr);
+ * @endcode
+ *
+ * Independent of the build option, the phases of a tracking run can be
+ * written as a Chrome trace (chrome://tracing, ui.perfetto.dev) to see
+ * how they overlap across threads:
+ * @code
+ * pgmlink::instrumentation::start_trace("tracking.json");
+ * tracking(ts);
+ * pgmlink::instrumentation::stop_trace();
+ * @endcode
+ * The timers of an instrumented build appear in the trace as well.
+ */
+
+namespace pgmlink {
+namespace instrumentation {
+
+/// totals of a probe over all threads
+struct ProbeTotals {
+  ProbeTotals() : timer(false), calls(0), total(0) {}
+
+  std::string name;
+  /// seconds for a timer, the sum of the counts for a counter
+  bool timer;
+  std::size_t calls;
+  double total;
+};
+
+/// whether the library was built with instrumentation
+PGMLINK_EXPORT bool enabled();
+
+/// number of the probe name, registering it on first use
+PGMLINK_EXPORT std::size_t probe(const char* name, bool timer);
+
+/// name of a registered probe
+PGMLINK_EXPORT std::string probe_name(std::size_t probe);
+
+/// add n to the counter probe in the calling thread
+PGMLINK_EXPORT void count(std::size_t probe, double n);
+
+/// add a timed call of seconds to the timer probe in the calling thread
+PGMLINK_EXPORT void add_time(std::size_t probe, double seconds);
+
+/// the probes summed over all threads, in order of registration
+PGMLINK_EXPORT std::vector<ProbeTotals> totals();
+
+/// table of the totals; probes never hit are left out
+PGMLINK_EXPORT void report(std::ostream& os);
+
+/// zero all probes
+PGMLINK_EXPORT void reset();
+
+/// record trace events until stop_trace(); throws if a trace is running
+PGMLINK_EXPORT void start_trace(const std::string& filename);
+
+/// write the recorded events as Chrome trace-event JSON; nothing if no trace is running
+PGMLINK_EXPORT void stop_trace();
+
+/// whether a trace is being recorded
+PGMLINK_EXPORT bool tracing();
+
+/// a span of the calling thread; dropped if no trace is running
+PGMLINK_EXPORT void trace_event(const std::string& name, const char* category,
+                                const boost::posix_time::ptime& start,
+                                const boost::posix_time::ptime& end);
+
+/**
+ * Traces the span from construction to destruction, if a trace was running
+ * on construction.
+ */
+class TraceScope {
+ public:
+  TraceScope(const std::string& name, const char* category) : traced_(tracing()) {
+    if (traced_) {
+      name_ = name;
+      category_ = category;
+      start_ = boost::posix_time::microsec_clock::universal_time();
+    }
+  }
+  ~TraceScope() {
+    if (traced_) {
+      trace_event(name_, category_, start_, boost::posix_time::microsec_clock::universal_time());
+    }
+  }
+
+ private:
+  TraceScope(const TraceScope&);
+  TraceScope& operator=(const TraceScope&);
+
+  bool traced_;
+  std::string name_;
+  const char* category_;
+  boost::posix_time::ptime start_;
+};
+
+/**
+ * Adds the wall time from construction to destruction to a timer probe.
+ */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(std::size_t probe)
+    : probe_(probe), start_(boost::posix_time::microsec_clock::universal_time()) {}
+  ~ScopedTimer() {
+    const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    add_time(probe_, (now - start_).total_microseconds() / 1e6);
+    if (tracing()) {
+      trace_event(probe_name(probe_), "instrumentation", start_, now);
+    }
+  }
+
+ private:
+  ScopedTimer(const ScopedTimer&);
+  ScopedTimer& operator=(const ScopedTimer&);
+
+  std::size_t probe_;
+  boost::posix_time::ptime start_;
+};
+
+} /* namespace instrumentation */
+} /* namespace pgmlink */
+
+#define PGMLINK_INSTRUMENTATION_CONCAT_(a, b) a##b
+#define PGMLINK_INSTRUMENTATION_CONCAT(a, b) PGMLINK_INSTRUMENTATION_CONCAT_(a, b)
+
+#ifdef PGMLINK_INSTRUMENTATION
+/// time the rest of the enclosing scope
+#define PGMLINK_TIMED_SCOPE(name) \
+  static const std::size_t PGMLINK_INSTRUMENTATION_CONCAT(pgmlink_probe_, __LINE__) = \
+    pgmlink::instrumentation::probe(name, true); \
+  pgmlink::instrumentation::ScopedTimer PGMLINK_INSTRUMENTATION_CONCAT(pgmlink_timer_, __LINE__)( \
+    PGMLINK_INSTRUMENTATION_CONCAT(pgmlink_probe_, __LINE__))
+/// add n to a counter
+#define PGMLINK_COUNT(name, n) \
+  do { \
+    static const std::size_t pgmlink_probe = pgmlink::instrumentation::probe(name, false); \
+    pgmlink::instrumentation::count(pgmlink_probe, static_cast<double>(n)); \
+  } while(0)
+#else
+#define PGMLINK_TIMED_SCOPE(name)
+#define PGMLINK_COUNT(name, n) do {} while(0)
+#endif
+
+#endif /* INSTRUMENTATION_H */
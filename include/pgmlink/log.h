@@ -24,6 +24,7 @@
 #include <iostream>
 #include <iomanip>
 
+#include "pgmlink/pgmlink_export.h"
 
 
 /**
@@ -77,6 +78,18 @@
  *
  *
  *
+ * @section asynclogging Asynchronous logging
+ * By default, every message is written and flushed to the FILE by the
+ * thread that logs it. With
+ * @code
+ * pgmlink::set_async_logging(true);
+ * @endcode
+ * the messages are appended to a buffer per thread instead and written in
+ * batches by a background thread, so that deep logging levels neither
+ * serialize OpenMP threads on stdio nor flush once per message.
+ *
+ *
+ *
  * @author Bernhard X. Kausler <bernhard.kausler@iwr.uni-heidelberg.de>
  * @date 2009-04-02
  */
@@ -103,6 +116,34 @@ inline std::string nowTime();
 
 
 
+// set_async_logging()
+/**
+ * Hand the messages to a background writer instead of writing them in the
+ * logging thread.
+ *
+ * Every thread appends its messages to a buffer of its own; the writer
+ * collects the buffers every flush_interval_seconds and writes each with a
+ * single fwrite. The messages of a thread keep their order, those of
+ * different threads are interleaved per batch. Disabling writes the
+ * pending messages and stops the writer, as does the end of the program;
+ * after a crash, the messages of the last interval may be missing.
+ */
+PGMLINK_EXPORT void set_async_logging(bool enable, double flush_interval_seconds = 0.05);
+PGMLINK_EXPORT bool async_logging();
+
+// flush_log()
+/**
+ * Write the pending messages of the background writer now.
+ */
+PGMLINK_EXPORT void flush_log();
+
+namespace detail {
+// hands msg to the background writer; false if logging is synchronous
+PGMLINK_EXPORT bool async_log_output(const std::string& msg);
+}
+
+
+
 // LogLevel
 /**
  * The logging levels, which can be used.
@@ -158,6 +199,9 @@ inline FILE*& pgmlink::Output2FILE::getRedirect()
 // output()
 inline void pgmlink::Output2FILE::output(const std::string& msg)
 {
+    if (detail::async_log_output(msg)) {
+        return;
+    }
     FILE* pStream = getRedirect();
     if (!pStream) {
         return;
@@ -439,28 +483,36 @@ namespace pgmlink {
 inline std::string nowTime()
 {
     // get time
-    time_t t;
-    t = time(NULL);
-    if ( t == static_cast<std::time_t>(-1) ) {
-        return "Error_in_nowTime().time";
-    }
-
-    // convert time to local time
-    tm r;
-    if (localtime_r(&t, &r) == NULL) {
-        return "Error_in_nowTime().localtime_r";
+    struct timeval tv;
+    if (gettimeofday(&tv, 0) != 0) {
+        return "Error_in_nowTime().gettimeofday";
     }
 
-    // convert localtime to a string
+    // the local time of the current second is formatted once per thread
+#if defined(__GNUC__)
+    static __thread time_t formatted_second = -1;
+    static __thread char buffer[101];
+#else
+    time_t formatted_second = -1;
     char buffer[101];
-    if (strftime(buffer, sizeof(buffer), "%X", &r) == 0) {
-        return "Error_in_nowTime().strftime";
+#endif
+    if (tv.tv_sec != formatted_second) {
+        // convert time to local time
+        time_t t = tv.tv_sec;
+        tm r;
+        if (localtime_r(&t, &r) == NULL) {
+            return "Error_in_nowTime().localtime_r";
+        }
+
+        // convert localtime to a string
+        if (strftime(buffer, sizeof(buffer), "%X", &r) == 0) {
+            return "Error_in_nowTime().strftime";
+        }
+        formatted_second = tv.tv_sec;
     }
 
     // format the string according to our format: "hh:mm:ss.ms"
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-    char result[101] = {0};
+    char result[128] = {0};
     std::sprintf(result, "%s.%03ld", buffer, (long)tv.tv_usec / 1000);
 
     return result;
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <string>
 #include <map>
+#include <iosfwd>
 
 
 // external headers
@@ -15,11 +16,14 @@
 #include <lemon/adaptors.h>
 #include <armadillo>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
 #include <vigra/multi_iterator_coupled.hxx>
 #include <vigra/tinyvector.hxx>
 
 
 // pgmlink headers
+#include "pgmlink/coordinate_provider.h"
 #include "pgmlink/hypotheses.h"
 #include "pgmlink/event.h"
 #include "pgmlink/traxels.h"
@@ -43,18 +47,22 @@ namespace pgmlink {
 
 // typedef std::map<unsigned, arma::mat> IdCoordinateMap;
 
-typedef std::map<std::pair<int, unsigned>, arma::mat> TimestepIdCoordinateMap;
-
-typedef boost::shared_ptr<TimestepIdCoordinateMap > TimestepIdCoordinateMapPtr;
-
 ////
 //// ClusteringMlpackBase
 ////
 
+/**
+ * The clustering classes take the data either as a feature_array of points
+ * with three coordinates each, which is converted once on construction, or
+ * as an arma::mat with one point per column. Such a matrix is not copied:
+ * the clustering works on its memory, which has to outlive the object.
+ */
 class ClusteringMlpackBase 
 {
  protected:
   PGMLINK_EXPORT void copy_centers_to_feature_array(const arma::mat& centers, feature_array& c);
+  // the first n coordinates of every point of data, one point per column
+  PGMLINK_EXPORT static void feature_array_to_points(const feature_array& data, int n, arma::mat& points);
  public:
   PGMLINK_EXPORT virtual ~ClusteringMlpackBase() {}
   PGMLINK_EXPORT virtual feature_array operator()() = 0;
@@ -82,7 +90,7 @@ class KMeans
  private:
   KMeans();
   int k_;
-  const feature_array& data_;
+  arma::mat data_;
   // void copy_centers_to_feature_array(const arma::mat& centers, feature_array& c);
  public:
   // tested
@@ -91,9 +99,14 @@ class KMeans
    * @param [in] k number of clusters
    * @param [in] data feature_array storing data
    */
-  PGMLINK_EXPORT KMeans(int k, const feature_array& data) 
-  : k_(k), data_(data)
-  {}
+  PGMLINK_EXPORT KMeans(int k, const feature_array& data);
+
+  /**
+   * @brief Constructor for data that is not copied
+   * @param [in] k number of clusters
+   * @param [in] data one point per column
+   */
+  PGMLINK_EXPORT KMeans(int k, const arma::mat& data);
 
   // tested
   /**
@@ -111,7 +124,7 @@ class GMM
   GMM();
   int k_;
   int n_;
-  const feature_array& data_;
+  arma::mat data_;
   double score_;
   int n_trials_;
  public:
@@ -119,9 +132,9 @@ class GMM
   // for 2D data, ilastik provides coordinates with 3rd dimension 0
   // which will cause singular covariance matrix
   // therefore add option for dimensionality
-  PGMLINK_EXPORT GMM(int k, int n, const feature_array& data, int n_trials=1) 
-  : k_(k), n_(n), data_(data), score_(0.0), n_trials_(n_trials)
-  {}
+  PGMLINK_EXPORT GMM(int k, int n, const feature_array& data, int n_trials=1);
+  // data has n rows and is not copied
+  PGMLINK_EXPORT GMM(int k, const arma::mat& data, int n_trials=1);
 
   PGMLINK_EXPORT virtual feature_array operator()();
   PGMLINK_EXPORT double score() const;
@@ -129,6 +142,8 @@ class GMM
 };
 
 
+// EM starting from the given means, covariances and weights; unlike GMM
+// it is deterministic and may run concurrently
 class GMMWithInitialized 
 : public ClusteringMlpackBase 
 {
@@ -136,7 +151,7 @@ class GMMWithInitialized
   GMMWithInitialized();
   int k_;
   int n_;
-  const feature_array& data_;
+  arma::mat data_;
   double score_;
   int n_trials_;
   const std::vector<arma::vec>& means_;
@@ -149,9 +164,11 @@ class GMMWithInitialized
   // therefore add option for dimensionality
   PGMLINK_EXPORT GMMWithInitialized(int k, int n, const feature_array& data, int n_trials,
                                     const std::vector<arma::vec>& means, 
-                                    const std::vector<arma::mat>& covs, const arma::vec& weights)
-  : k_(k), n_(n), data_(data), score_(0.0), n_trials_(n_trials), means_(means), covs_(covs), weights_(weights) 
-  {}
+                                    const std::vector<arma::mat>& covs, const arma::vec& weights);
+  // data has n rows and is not copied
+  PGMLINK_EXPORT GMMWithInitialized(int k, const arma::mat& data, int n_trials,
+                                    const std::vector<arma::vec>& means, 
+                                    const std::vector<arma::mat>& covs, const arma::vec& weights);
 
   PGMLINK_EXPORT virtual feature_array operator()();
   PGMLINK_EXPORT double score() const;
@@ -182,6 +199,50 @@ class GMMInitializeArma
 
 };
 
+
+////
+//// MergerCentersCache
+////
+/**
+ * @brief Fitted merger centers of previous runs.
+ *
+ * An entry is keyed by the timestep and id of the traxel, the number of
+ * objects and a hash of everything the fit depends on (coordinates,
+ * initialization, parameters), so a changed merger misses the cache. The
+ * cache can be written to and read from a stream to be reused across
+ * processes. It is not thread-safe.
+ */
+class MergerCentersCache {
+ public:
+  // FNV-1a hash of the values of data
+  PGMLINK_EXPORT static boost::uint64_t hash(const feature_array& data);
+  // hash of data continuing the hash seed, to combine several arrays
+  PGMLINK_EXPORT static boost::uint64_t hash(const feature_array& data, boost::uint64_t seed);
+
+  // true and the centers if there is an entry
+  PGMLINK_EXPORT bool find(int timestep, unsigned id, int k, boost::uint64_t hash, feature_array& centers) const;
+  // replaces an existing entry
+  PGMLINK_EXPORT void insert(int timestep, unsigned id, int k, boost::uint64_t hash, const feature_array& centers);
+  PGMLINK_EXPORT size_t size() const;
+  PGMLINK_EXPORT void clear();
+
+  // binary format; read() adds the entries of the stream
+  PGMLINK_EXPORT void write(std::ostream& os) const;
+  PGMLINK_EXPORT void read(std::istream& is);
+
+ private:
+  struct Key {
+    int timestep;
+    unsigned id;
+    int k;
+    boost::uint64_t hash;
+    bool operator<(const Key& other) const;
+  };
+  std::map<Key, feature_array> entries_;
+};
+
+typedef boost::shared_ptr<MergerCentersCache> MergerCentersCachePtr;
+
     
 
 ////
@@ -274,9 +335,11 @@ class FeatureExtractorMCOMsFromGMM
 {
  private:
   int n_dim_;
+  MergerCentersCachePtr cache_;
  public:
-  PGMLINK_EXPORT FeatureExtractorMCOMsFromGMM(int n_dim) 
-  : n_dim_(n_dim) 
+  // the fits are looked up in and added to cache, if given
+  PGMLINK_EXPORT FeatureExtractorMCOMsFromGMM(int n_dim, MergerCentersCachePtr cache = MergerCentersCachePtr()) 
+  : n_dim_(n_dim), cache_(cache) 
   {}
   
   PGMLINK_EXPORT virtual std::vector<Traxel> operator()(Traxel& trax, size_t nMergers, unsigned int max_id);
@@ -290,10 +353,12 @@ class FeatureExtractorArmadillo
 {
  public:
   PGMLINK_EXPORT FeatureExtractorArmadillo(TimestepIdCoordinateMapPtr coordinates);
+  // the coordinates of the mergers are looked up on demand
+  PGMLINK_EXPORT FeatureExtractorArmadillo(CoordinateProviderPtr coordinates);
   PGMLINK_EXPORT virtual std::vector<Traxel> operator()(Traxel& trax, size_t nMergers, unsigned int max_id);
  private:
   FeatureExtractorArmadillo();
-  TimestepIdCoordinateMapPtr coordinates_;
+  CoordinateProviderPtr coordinates_;
 };
   
 
@@ -399,14 +464,64 @@ class ResolveAmbiguousArcsGreedy
 ////
 //// ReasonerMaxOneArc
 ////
+/**
+ * @brief Assign the resolution candidate arcs without a full ILP
+ *
+ * Every node keeps at most one active incoming and one active outgoing
+ * resolution candidate arc, two outgoing ones for an active division. The
+ * candidate arcs between two timesteps fall apart into connected bipartite
+ * pieces, usually one per merger; each piece is an assignment problem that
+ * is solved exactly with the Hungarian method, the pieces in parallel.
+ *
+ * As in resolve_graph(), as many arcs as possible are activated; among these
+ * assignments the one with the lowest transition energy is chosen. Arcs that
+ * are not resolution candidates keep their state.
+ */
 class ReasonerMaxOneArc : public Reasoner {
+ public:
+  PGMLINK_EXPORT ReasonerMaxOneArc(boost::function<double(const double)> transition,
+                                   double transition_parameter = 5);
+
+  PGMLINK_EXPORT virtual void formulate(const HypothesesGraph& g);
+  PGMLINK_EXPORT virtual void infer();
+  PGMLINK_EXPORT virtual void conclude(HypothesesGraph& g);
+
+  /// number of assignment problems of the last formulate()
+  PGMLINK_EXPORT size_t number_of_pieces() const { return pieces_.size(); }
+
+ private:
+  struct Piece {
+    std::vector<HypothesesGraph::Arc> arcs;
+    // per arc: energy of activating it, index of its source and its target
+    std::vector<double> costs;
+    std::vector<size_t> sources;
+    std::vector<size_t> targets;
+    // per source: number of outgoing arcs it may keep
+    std::vector<size_t> capacities;
+    size_t number_of_targets;
+    std::vector<bool> active;
+  };
+
+  boost::function<double(const double)> transition_;
+  double transition_parameter_;
+  std::vector<Piece> pieces_;
 };
   
 
 ////
 //// ResolveAmbiguousArcsPgm
 ////
+/**
+ * @brief Drop in for resolve_graph(): resolves the candidate arcs of g in
+ * place with ReasonerMaxOneArc
+ */
 class ResolveAmbiguousArcsPgm : public ReasonerMaxOneArc, private ResolveAmbiguousArcsBase {
+ public:
+  PGMLINK_EXPORT ResolveAmbiguousArcsPgm(boost::function<double(const double)> transition,
+                                         double transition_parameter = 5)
+      : ReasonerMaxOneArc(transition, transition_parameter) {}
+
+  PGMLINK_EXPORT virtual HypothesesGraph& operator()(HypothesesGraph* g);
 };
 
 
@@ -460,6 +575,12 @@ class MergerResolver
   // Get maximum id for given timestep
   unsigned int get_max_id(int ts);
 
+  // next free traxel id of every timestep; built once by index_ids() and
+  // advanced by refine_node(), so the ids of the replacement nodes only
+  // depend on the order of the mergers
+  std::map<int, unsigned int> next_ids_;
+  void index_ids();
+
   // Split merger node into appropiately many new nodes.
   void refine_node(HypothesesGraph::Node,
                    std::size_t,
@@ -485,6 +606,7 @@ class MergerResolver
       g_->add(node_resolution_candidate());
     if (!g_->has_property(arc_resolution_candidate()))
       g_->add(arc_resolution_candidate());
+    index_ids();
   }
 
   PGMLINK_EXPORT HypothesesGraph* resolve_mergers(FeatureHandlerBase& handler);
@@ -494,35 +616,45 @@ class MergerResolver
 ////
 //// given a graph, do retracking
 ////
+// With with_components, every connected component of the resolution
+// candidates, i.e. the replacement nodes of neighboring mergers with their
+// arcs, is solved as a small model of its own, in parallel.
 PGMLINK_EXPORT void resolve_graph(HypothesesGraph& src, HypothesesGraph& dest, boost::function<double(const double)> transition, double ep_gap, bool with_tracklets,
-                   const double transition_parameter=5, const bool with_constraints=true);
+                   const double transition_parameter=5, const bool with_constraints=true,
+                   const bool with_components=false);
 // void resolve_graph(HypothesesGraph& src, HypothesesGraph& dest);
 
   
 ////
 //// transfer graph to graph containing only subset of nodes based on tags
 ////
-template <typename NodePropertyTag, typename ArcPropertyTag>
+// Cross references between the items of two graphs, indexed by the ids of
+// the keys. The functions below also accept std::maps.
+typedef DenseItemMap<HypothesesGraph::Node, HypothesesGraph::Node> NodeCrossReference;
+typedef DenseItemMap<HypothesesGraph::Arc, HypothesesGraph::Arc> ArcCrossReference;
+
+template <typename NodePropertyTag, typename ArcPropertyTag, typename NodeReference, typename ArcReference>
 void copy_hypotheses_graph_subset(const HypothesesGraph& src,
                                   HypothesesGraph& dest,
-                                  std::map<HypothesesGraph::Node, HypothesesGraph::Node>& nr,
-                                  std::map<HypothesesGraph::Arc, HypothesesGraph::Arc>& ar,
-                                  std::map<HypothesesGraph::Node, HypothesesGraph::Node>& ncr,
-                                  std::map<HypothesesGraph::Arc, HypothesesGraph::Arc>& acr
+                                  NodeReference& nr,
+                                  ArcReference& ar,
+                                  NodeReference& ncr,
+                                  ArcReference& acr
                                   );
 
 
-template <typename PropertyTag, typename KeyType>
+// copy the values of the keys of dict to the mapped items in one pass over dict
+template <typename PropertyTag, typename KeyType, typename CrossReference>
 void translate_property_value_map(const HypothesesGraph& src,
                                   const HypothesesGraph& dest,
-                                  std::map<KeyType, KeyType> dict
+                                  const CrossReference& dict
                                   );
 
 
-template <typename PropertyTag, typename KeyType>
+template <typename PropertyTag, typename KeyType, typename CrossReference>
 void translate_property_bool_map(const HypothesesGraph& src,
                                  const HypothesesGraph& dest,
-                                 std::map<KeyType,KeyType> dict
+                                 const CrossReference& dict
                                  );
 
 
@@ -539,9 +671,19 @@ void get_subset(const HypothesesGraph& src,
 PGMLINK_EXPORT double calculate_BIC(int k, int n, double weight);
 
 
-PGMLINK_EXPORT void gmm_priors_and_centers(const feature_array& data, feature_array& priors, feature_array& centers, int k_max, int n, double weight);
+/**
+ * BIC of GMMs with k = 1..k_max components of data, fitted concurrently.
+ *
+ * priors[k-1] is the BIC of k components; the ndim coordinates of its
+ * centers start at centers[(k-1)*k/2*ndim]. With patience > 0, no more
+ * components are fitted once the BIC decreased patience times in a row;
+ * the priors of the larger k are -infinity and their centers 0 then.
+ */
+PGMLINK_EXPORT void gmm_priors_and_centers(const feature_array& data, feature_array& priors, feature_array& centers, int k_max, int n, double weight,
+                                          int patience = 0);
 
-PGMLINK_EXPORT void gmm_priors_and_centers_arma(const arma::mat& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight);
+PGMLINK_EXPORT void gmm_priors_and_centers_arma(const arma::mat& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight,
+                                               int patience = 0);
 
 
 ////
@@ -560,7 +702,17 @@ PGMLINK_EXPORT void merge_split_divisions(const HypothesesGraph& graph,
                            std::map<HypothesesGraph::Arc, HypothesesGraph::Arc>& arc_cross_reference);
 
 
-PGMLINK_EXPORT void calculate_gmm_beforehand(HypothesesGraph& g, int n_trials, int n_dimensions);
+/**
+ * Fit a GMM to the coordinates of every merger, initialized with the
+ * centers of its predecessors, and store the centers as "mergerCOMs".
+ * The fits run EM from that initial model (see GMMWithInitialized), so
+ * they draw no random numbers and every trial gives the same fit. With
+ * parallel, the mergers of a timestep are fitted concurrently, with the
+ * serial results. Mergers found in cache are not fitted again; the new
+ * fits are added to it.
+ */
+PGMLINK_EXPORT void calculate_gmm_beforehand(HypothesesGraph& g, int n_trials, int n_dimensions, bool parallel = false,
+                                            MergerCentersCachePtr cache = MergerCentersCachePtr());
 
 
 // extract coordinates in arma::mat
@@ -588,9 +740,7 @@ void feature_array_to_arma_mat(const std::vector<T>& in, arma::Mat<U>& out) {
   int count = 0;
   typename std::vector<T>::const_iterator srcIt = in.begin();
   while (count < n) {
-    arma::Col<U> col(stepSize);
-    std::copy(srcIt, srcIt+stepSize, col.begin());
-    out.col(count) = col;
+    std::copy(srcIt, srcIt+stepSize, out.colptr(count));
     ++count;
     srcIt += stepSize;
   }
@@ -606,9 +756,7 @@ void feature_array_to_arma_mat_skip_last_dimension(const std::vector<T>& in, arm
   assert(stepSize == last_dimension-1);
   typename std::vector<T>::const_iterator srcIt = in.begin();
   while (count < n) {
-    arma::Col<U> col(stepSize);
-    std::copy(srcIt, srcIt+stepSize, col.begin());
-    out.col(count) = col;
+    std::copy(srcIt, srcIt+stepSize, out.colptr(count));
     ++count;
     srcIt += last_dimension;
   }
@@ -644,13 +792,13 @@ void MergerResolver::collect_arcs(ArcIterator arcIt,
 }
 
   
-template <typename NodePropertyTag, typename ArcPropertyTag>
+template <typename NodePropertyTag, typename ArcPropertyTag, typename NodeReference, typename ArcReference>
 void copy_hypotheses_graph_subset(const HypothesesGraph& src,
                                   HypothesesGraph& dest,
-                                  std::map<HypothesesGraph::Node, HypothesesGraph::Node>& nr,
-                                  std::map<HypothesesGraph::Arc, HypothesesGraph::Arc>& ar,
-                                  std::map<HypothesesGraph::Node, HypothesesGraph::Node>& ncr,
-                                  std::map<HypothesesGraph::Arc, HypothesesGraph::Arc>& acr
+                                  NodeReference& nr,
+                                  ArcReference& ar,
+                                  NodeReference& ncr,
+                                  ArcReference& acr
                                   ) {
   LOG(logDEBUG) << "copy_hypotheses_graph_subset(): entered";
   property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = src.get(node_traxel());
@@ -707,49 +855,32 @@ void copy_hypotheses_graph_subset(const HypothesesGraph& src,
    void translate_property_map(const HypothesesGraph& src, const HypothesesGraph& dest, const std::map<KeyType, KeyType> dict); */
 
   
-template <typename PropertyTag, typename KeyType>
+template <typename PropertyTag, typename KeyType, typename CrossReference>
 void translate_property_value_map(const HypothesesGraph& src,
                                   const HypothesesGraph& dest,
-                                  std::map<KeyType, KeyType> dict
+                                  const CrossReference& dict
                                   ) {
   typedef typename property_map<PropertyTag, HypothesesGraph::base_graph>::type IterableMap;
   IterableMap& src_map = src.get(PropertyTag());
   IterableMap& dest_map = dest.get(PropertyTag());
-  typename IterableMap::ValueIt v_it;
-  for (v_it = src_map.beginValue(); v_it != src_map.endValue(); ++ v_it) {
-    typename IterableMap::ItemIt i_it(src_map, *v_it);
-    for (; i_it != lemon::INVALID; ++i_it) {
-      if (dict.count(i_it) > 0) {
-        dest_map.set(dict[i_it], *v_it);
-      }
-    }
+  for (typename CrossReference::const_iterator it = dict.begin(); it != dict.end(); ++it) {
+    dest_map.set(it->second, src_map[it->first]);
   }
 }
 
 
-template <typename PropertyTag, typename KeyType>
+template <typename PropertyTag, typename KeyType, typename CrossReference>
 void translate_property_bool_map(const HypothesesGraph& src,
                                  const HypothesesGraph& dest,
-                                 std::map<KeyType,KeyType> dict
+                                 const CrossReference& dict
                                  ) {
-  // use c++11 and change for loop to:
-  // for(bool b : {false, true});
-
-  // C++11 !!!
-
   LOG(logDEBUG) << "translate_property_bool_map(): entering";
     
-  bool const bools[] = {false, true};
   typedef typename property_map<PropertyTag, HypothesesGraph::base_graph>::type IterableMap;
   IterableMap& src_map = src.get(PropertyTag());
   IterableMap& dest_map = dest.get(PropertyTag());
-  for (bool const* v_it(bools); v_it != bools + 2; ++v_it) {
-    typename IterableMap::ItemIt i_it(src_map, *v_it);
-    for(; i_it != lemon::INVALID; ++i_it) {
-      if (dict.count(i_it) > 0) {
-        dest_map.set(dict[i_it], *v_it);
-      }
-    }
+  for (typename CrossReference::const_iterator it = dict.begin(); it != dict.end(); ++it) {
+    dest_map.set(it->second, src_map[it->first]);
   }
 }
 
@@ -837,7 +968,7 @@ void extract_coordinates(TimestepIdCoordinateMapPtr coordinates,
    ClusteringAlg calg(nMergers, trax.features["Coord<ValueList>"]);
    mergerCOMs = calg();
    }
-   trax.features["mergerCOMs"] = mergerCOMs;
+   trax.set_feature("mergerCOMs", mergerCOMs);
    assert((int)mergerCOMs.size() == 3*nMergers);
    traxel_map.set(node, trax);
    } */
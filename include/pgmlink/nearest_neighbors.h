@@ -8,28 +8,57 @@
 #ifndef NEAREST_NEIGHBORS_H
 #define NEAREST_NEIGHBORS_H
 #include <map>
+#include <vector>
 #include <ANN/ANN.h>
 #include <boost/shared_ptr.hpp>
 
 #include "pgmlink/pgmlink_export.h"
+#include "pgmlink/spatial_index.h"
 
 namespace pgmlink {
     class Traxel;
 
-    class NearestNeighborSearch
+    /**
+     * kNN and range search among traxels with an ANN kd-tree.
+     *
+     * ANN keeps the state of a running search (and a shared trivial leaf
+     * created on the first build) in global variables, so all calls into
+     * ANN are serialized, including the construction and destruction of
+     * the trees. Instances may be used from different threads, but their
+     * searches never run concurrently.
+     *
+     * With dimensions = 2 the points are (x, y) and the z coordinates are
+     * ignored, which saves a third of the point memory and of the distance
+     * computations for planar data.
+     */
+    class NearestNeighborSearch : public SpatialIndex
     {
       public:
         template <typename InputIt>
         NearestNeighborSearch( InputIt traxel_begin,
                    InputIt traxel_end,
-                   const bool reverse = false);
-        ~NearestNeighborSearch();
+                   const bool reverse = false,
+                   const int dimensions = 3);
+        virtual ~NearestNeighborSearch();
     
          /**
           * Returns (traxel id, distance*distance) map.
           */
-        PGMLINK_EXPORT std::map<unsigned int, double> knn_in_range( const Traxel& query, double radius, unsigned int knn, const bool reverse = false );
-        PGMLINK_EXPORT unsigned int count_in_range( const Traxel& query, double radius, const bool reverse = false );
+        PGMLINK_EXPORT virtual std::map<unsigned int, double> knn_in_range( const Traxel& query, double radius, unsigned int knn, const bool reverse = false );
+        PGMLINK_EXPORT virtual unsigned int count_in_range( const Traxel& query, double radius, const bool reverse = false );
+
+        /**
+         * Batched knn_in_range(), see SpatialIndex. The query points and
+         * the ANN result buffers are allocated once per batch, and all
+         * searches of the batch run in one ANN critical section.
+         */
+        PGMLINK_EXPORT virtual void knn_in_range( const std::vector<const Traxel*>& queries,
+                                                  const std::vector<unsigned int>& knn,
+                                                  double radius,
+                                                  std::vector<size_t>& offsets,
+                                                  std::vector<unsigned int>& ids,
+                                                  std::vector<double>& distances,
+                                                  const bool reverse = false );
 
     private:
         /**
@@ -38,8 +67,11 @@ namespace pgmlink {
         template <typename InputIt>
         void define_point_set( InputIt traxel_begin, InputIt traxel_end, const bool reverse = false );
         ANNpoint point_from_traxel( const Traxel& traxel, const bool reverse = false );
+        void set_query_point( ANNpoint point, const Traxel& traxel, const bool reverse ) const;
+        template <int Dimensions>
+        static void set_point( ANNpoint point, const Traxel& traxel, const bool corrected );
 
-        std::map<unsigned int, unsigned int> point_idx2traxel_id_;
+        std::vector<unsigned int> point_idx2traxel_id_;
     
         const int dim_;
     
@@ -56,6 +88,7 @@ namespace pgmlink {
  ****/
 #include <cassert>
 #include <iterator>
+#include <stdexcept>
 #include <boost/scoped_array.hpp>
 #include "pgmlink/traxels.h"
 #include <pgmlink/log.h>
@@ -67,20 +100,33 @@ using namespace std;
 using namespace boost;
 
 template <typename InputIt>
-NearestNeighborSearch::NearestNeighborSearch(InputIt traxel_begin, InputIt traxel_end, const bool reverse) 
-: dim_(3), points_(NULL) 
+NearestNeighborSearch::NearestNeighborSearch(InputIt traxel_begin, InputIt traxel_end, const bool reverse,
+                                             const int dimensions)
+: dim_(dimensions), points_(NULL)
 {
+  if(dim_ != 2 && dim_ != 3) {
+    throw std::invalid_argument("NearestNeighborSearch: 2 or 3 dimensions required");
+  }
   size_t size(distance(traxel_begin, traxel_end));
 
   if(size > 0) {
     this->define_point_set( traxel_begin, traxel_end, reverse );
-    try {
-      kd_tree_ = boost::shared_ptr<ANNkd_tree>( new ANNkd_tree( points_, size, dim_ ) );
-    } catch(...) {
+    ANNkd_tree* kd_tree = NULL;
+    // no exception may leave the critical section
+    #pragma omp critical(pgmlink_ann)
+    {
+      try {
+        kd_tree = new ANNkd_tree( points_, size, dim_ );
+      } catch(...) {
+        kd_tree = NULL;
+      }
+    }
+    if(kd_tree == NULL) {
       annDeallocPts(points_);
       points_ = NULL;
-      throw;
+      throw std::runtime_error("NearestNeighborSearch: construction of the kd-tree failed");
     }
+    kd_tree_ = boost::shared_ptr<ANNkd_tree>( kd_tree );
   }
 }
 
@@ -90,31 +136,25 @@ void NearestNeighborSearch::define_point_set( InputIt traxel_begin, InputIt trax
     size_t traxel_number = distance(traxel_begin, traxel_end);
     points_ = annAllocPts( traxel_number, dim_ );
     if( points_ == NULL ){
-      throw "Allocation of points for kd-tree failed";
+      throw std::runtime_error("NearestNeighborSearch: allocation of points for kd-tree failed");
     }
 
     // fill the nodes with coordinates
     try 
     {
-      point_idx2traxel_id_.clear();
+      point_idx2traxel_id_.assign(traxel_number, 0);
       size_t i = 0;
       for( InputIt traxel = traxel_begin; traxel != traxel_end; ++traxel, ++i) {
         ANNpoint point = points_[i];
-        assert(dim_ == 3);
-        if (!reverse) {
-            point[0] = traxel->X();
-            point[1] = traxel->Y();
-            point[2] = traxel->Z();
-            LOG(logDEBUG4) << "NearestNeighborSearch::define_point_set (!reverse): " << *traxel <<
-                            " point = " << point[0] << "," << point[1] << "," << point[2];
+        if (dim_ == 2) {
+            set_point<2>(point, *traxel, reverse);
         } else {
-            point[0] = traxel->X_corr();
-            point[1] = traxel->Y_corr();
-            point[2] = traxel->Z_corr();
-            LOG(logDEBUG4) << "NearestNeighborSearch::define_point_set: " << *traxel <<
-                                      " point = " << point[0] << "," << point[1] << "," << point[2];
+            set_point<3>(point, *traxel, reverse);
         }
-      
+        LOG(logDEBUG4) << "NearestNeighborSearch::define_point_set" << (reverse ? "" : " (!reverse)") << ": "
+                       << *traxel << " point = " << point[0] << "," << point[1]
+                       << "," << (dim_ == 3 ? point[2] : 0.);
+
         // save point <-> traxel association
         point_idx2traxel_id_[i] = traxel->Id;
       }
@@ -126,6 +166,19 @@ void NearestNeighborSearch::define_point_set( InputIt traxel_begin, InputIt trax
     }
 }
 
+template <int Dimensions>
+void NearestNeighborSearch::set_point( ANNpoint point, const Traxel& traxel, const bool corrected ) {
+    if (!corrected) {
+        point[0] = traxel.X();
+        point[1] = traxel.Y();
+        if (Dimensions == 3) point[2] = traxel.Z();
+    } else {
+        point[0] = traxel.X_corr();
+        point[1] = traxel.Y_corr();
+        if (Dimensions == 3) point[2] = traxel.Z_corr();
+    }
+}
+
 } /* namespace pgmlink */
 
 #endif
@@ -7,6 +7,12 @@
 #ifndef PGMLINK_PGM_H
 #define PGMLINK_PGM_H
 
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include <pgmlink/ext_opengm/loss_hamming.hxx>
@@ -22,6 +28,7 @@
 #include "pgmlink/hypotheses.h"
 #include "pgmlink/graph.h"
 #include "pgmlink/util.h"
+#include "pgmlink/tracking_statistics.h"
 
 namespace pgmlink {
   namespace pgm {
@@ -162,6 +169,74 @@ namespace pgmlink {
       OpengmModel::ValueType* entry_;
     };
 
+    /**
+       @brief Solve in time slices and report the progress after each of them.
+
+       The time limit of the optimizer has to be set to the length of a
+       slice, slice_seconds, see anytime_slice_seconds(). The LP/MIP
+       solvers resume from where the last slice stopped. Stops when the
+       optimizer is done: a slice terminates other than NORMAL or TIMEOUT,
+       or the solution is within the relative gap ep_gap of the bound (the
+       MIP gap of the solvers, with their absolute gap of 1e-6). Also
+       stops when less than half a slice of timeout is left, and when
+       progress returns false. progress is only called if the slice found
+       a solution.
+
+       Returns NORMAL if a solution was found.
+    */
+    template <typename OPTIMIZER>
+      opengm::InferenceTermination infer_anytime( OPTIMIZER& optimizer,
+						  double slice_seconds,
+						  double timeout,
+						  double ep_gap,
+						  const SolverProgressCallback& progress );
+
+    /**
+       @brief Length of the slices of infer_anytime().
+
+       The LP/MIP solvers read their time limit from the parameter they
+       are constructed with, so a slice cannot be shortened once the
+       optimizer exists. The slices are about interval_seconds long
+       instead and add up to timeout, so that the last one ends at the
+       timeout.
+    */
+    inline double anytime_slice_seconds( double interval_seconds, double timeout ) {
+      if(timeout <= interval_seconds) {
+	return timeout;
+      }
+      const double slices = std::ceil(timeout / interval_seconds);
+      // no timeout to speak of
+      if(slices > 1e9) {
+	return interval_seconds;
+      }
+      return timeout / slices;
+    }
+
+    /**
+       @brief Add the estimated bytes of an opengm model to the report.
+
+       One component per function type, named prefix + ": " + the name of
+       the type in function_types (in the order of the type list of the
+       model), and one for the factors and variables. The first function
+       type has to be opengm::ExplicitFunction, which stores a value per
+       label combination; the others are counted by their shape. Functions
+       shared by several factors are counted once.
+    */
+    template <typename GM>
+      void add_model_memory_usage( const GM& gm,
+				   const std::vector<std::string>& function_types,
+				   const std::string& prefix,
+				   MemoryReport& report );
+
+    /**
+       @brief Sum of the number of label combinations of the factors of gm.
+
+       The size of the value tables if all functions were explicit; shared
+       functions are counted for every factor.
+    */
+    template <typename GM>
+      size_t number_of_table_entries( const GM& gm );
+
 
 
 /******************/
@@ -335,6 +410,94 @@ template<class VALUE>
  }
 
 
+////
+//// function infer_anytime
+////
+template <typename OPTIMIZER>
+  opengm::InferenceTermination infer_anytime( OPTIMIZER& optimizer,
+					      double slice_seconds,
+					      double timeout,
+					      double ep_gap,
+					      const SolverProgressCallback& progress ) {
+  opengm::InferenceTermination status = opengm::UNKNOWN;
+  double elapsed = 0;
+  while(true) {
+    double slice = 0;
+    PhaseTimer timer;
+    const opengm::InferenceTermination slice_status = optimizer.infer();
+    timer.stop(slice);
+    elapsed += slice;
+
+    if(slice_status != opengm::NORMAL && slice_status != opengm::TIMEOUT) {
+      break;
+    }
+    if(slice_status == opengm::NORMAL) {
+      status = opengm::NORMAL;
+      const double value = optimizer.value();
+      const double bound = optimizer.bound();
+      if(!progress(elapsed, value, bound)) {
+	break;
+      }
+      if(std::fabs(value - bound) <= std::max(1e-6, ep_gap * (1e-10 + std::fabs(value)))) {
+	break;
+      }
+    }
+    // the slices add up to the timeout; the clock may be off by a bit
+    if(timeout - elapsed < slice_seconds / 2) {
+      break;
+    }
+  }
+  return status;
+ }
+
+
+////
+//// function number_of_table_entries
+////
+template <typename GM>
+  size_t number_of_table_entries( const GM& gm ) {
+  size_t entries = 0;
+  for(typename GM::IndexType f = 0; f < gm.numberOfFactors(); ++f) {
+    entries += gm[f].size();
+  }
+  return entries;
+}
+
+
+////
+//// function add_model_memory_usage
+////
+template <typename GM>
+  void add_model_memory_usage( const GM& gm,
+			       const std::vector<std::string>& function_types,
+			       const std::string& prefix,
+			       MemoryReport& report ) {
+  typedef typename GM::IndexType IndexType;
+  std::vector<size_t> function_bytes(function_types.size(), 0);
+  std::set<std::pair<size_t, size_t> > counted;
+  // the variable indices of the factors and the factors of the variables
+  size_t factor_bytes = gm.numberOfFactors() * sizeof(typename GM::FactorType);
+  for(IndexType f = 0; f < gm.numberOfFactors(); ++f) {
+    const size_t n_vars = gm[f].numberOfVariables();
+    factor_bytes += 2 * n_vars * sizeof(IndexType);
+    const size_t type = gm[f].functionType();
+    if(type >= function_types.size()) {
+      throw std::invalid_argument("add_model_memory_usage(): no name for function type");
+    }
+    if(!counted.insert(std::make_pair(type, static_cast<size_t>(gm[f].functionIndex()))).second) {
+      continue;
+    }
+    const size_t values = type == 0 ? gm[f].size() * sizeof(typename GM::ValueType) : 0;
+    function_bytes[type] += values + n_vars * sizeof(typename GM::LabelType) + 4 * sizeof(void*);
+  }
+  for(size_t type = 0; type < function_types.size(); ++type) {
+    report.add(prefix + ": " + function_types[type], function_bytes[type]);
+  }
+  report.add(prefix + ": factors", factor_bytes);
+  report.add(prefix + ": variables",
+             gm.numberOfVariables() * (sizeof(typename GM::LabelType) + 3 * sizeof(void*)));
+ }
+
 } /* namespace pgm */
 } /* namespace pgmlink */
 
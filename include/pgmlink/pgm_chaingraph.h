@@ -14,7 +14,6 @@
 #include <utility>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/bimap.hpp>
 #include <opengm/inference/inference.hxx>
 
 #ifdef WITH_GUROBI
@@ -78,10 +77,8 @@ namespace pgmlink {
       typedef HypothesesGraph::Node node_t;
       typedef HypothesesGraph::Arc arc_t;
       typedef OpengmModel::IndexType var_t;
-      typedef boost::bimap<node_t, var_t>::left_map node_var_map;
-      typedef boost::bimap<node_t, var_t>::right_map var_node_map;
-      typedef boost::bimap<arc_t, var_t>::left_map arc_var_map;
-      typedef boost::bimap<arc_t, var_t>::right_map var_arc_map;
+      typedef DenseItemMap<node_t, var_t> node_var_map;
+      typedef DenseItemMap<arc_t, var_t> arc_var_map;
 
       Model();
       Model( shared_ptr<OpengmModel>,
@@ -92,9 +89,7 @@ namespace pgmlink {
       shared_ptr<OpengmModel> opengm_model; ///< opengm model usually constructed by chaingraph::ModelBuilder
 
       const node_var_map& var_of_node() const; ///< maps nodes to random variables representing detections
-      const var_node_map& node_of_var() const;
       const arc_var_map& var_of_arc() const; ///< maps arcs to random variables representing links
-      const var_arc_map& arc_of_var() const;
 
       var_t var_of_node(node_t) const;
       var_t var_of_arc(arc_t) const;
@@ -107,15 +102,22 @@ namespace pgmlink {
       enum WeightType {det_weight, mov_weight, div_weight, app_weight, dis_weight, opp_weight};
       map<WeightType, vector<OpengmModel::IndexType> > weight_map; ///< associates events with their corresponding weight ids
       
-      //void set_weights( WeightType, vector<OpengmModel::ValueType> );
-      //const vector<OpengmModel::ValueType>& get_weights( WeightType );
+      /// update the weights of an event type in place, in the order of weight_map[type];
+      /// the factors are not rebuilt
+      void set_weights( WeightType, const vector<OpengmModel::ValueType>& );
+      vector<OpengmModel::ValueType> get_weights( WeightType ) const;
     private:
       friend class ModelBuilder;
 
       void init();
-
-      boost::bimap<node_t, var_t> node_var_;
-      boost::bimap<arc_t, var_t> arc_var_;
+      void add_node_var(node_t, var_t);
+      void add_arc_var(arc_t, var_t);
+
+      node_var_map node_var_;
+      arc_var_map arc_var_;
+      // node or arc id of every variable, -1 for variables of neither
+      vector<int> var_item_;
+      vector<VarCategory> var_category_;
     };
       
     class ModelBuilder {
@@ -171,15 +173,32 @@ namespace pgmlink {
       // build
       virtual chaingraph::Model* build( const HypothesesGraph& ) const = 0;      
 
-      // refinement
-      void add_hard_constraints( const Model&, const HypothesesGraph&, OpengmLPCplex& );
-      void fix_detections( const Model&, const HypothesesGraph&, OpengmLPCplex& );
+      // refinement; return the number of constraints added
+      size_t add_hard_constraints( const Model&, const HypothesesGraph&, OpengmLPCplex& );
+      size_t fix_detections( const Model&, const HypothesesGraph&, OpengmLPCplex& );
 
       // cplex parameters
       void set_cplex_timeout( double seconds );
 
 
     protected:
+      // energies of the factors of a node
+      struct NodeEnergies {
+	double detection;
+	double non_detection;
+	double appearance;
+	double disappearance;
+	vector<double> moves; ///< one per outgoing arc, in OutArcIt order
+	vector<double> divisions; ///< one per pair (i,j), i < j, of outgoing arcs, ordered by i then j
+      };
+
+      // evaluates the energy functions of all nodes concurrently; indexed by node id
+      void compute_energies( const HypothesesGraph&, vector<NodeEnergies>& ) const;
+      // instantiated for the built-in functors, so that their calls are inlined
+      template <class Move, class Division>
+      void compute_energies( const HypothesesGraph&, vector<NodeEnergies>&,
+			     const Move&, const Division& ) const;
+
       void add_detection_vars( const HypothesesGraph&, Model& ) const;
       void add_assignment_vars( const HypothesesGraph&, Model& ) const;
 
@@ -222,9 +241,9 @@ namespace pgmlink {
       virtual chaingraph::Model* build( const HypothesesGraph& ) const;
 
     private:
-      void add_detection_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node& ) const;
-      void add_outgoing_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node& ) const;
-      void add_incoming_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node& ) const;
+      void add_detection_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node&, const NodeEnergies& ) const;
+      void add_outgoing_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node&, const NodeEnergies& ) const;
+      void add_incoming_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node&, const NodeEnergies& ) const;
 
       
     };
@@ -243,9 +262,9 @@ namespace pgmlink {
       virtual chaingraph::Model* build( const HypothesesGraph& ) const;
 
     private:
-      void add_detection_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node& ) const;
-      void add_outgoing_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node& ) const;
-      void add_incoming_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node& ) const;
+      void add_detection_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node&, const NodeEnergies& ) const;
+      void add_outgoing_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node&, const NodeEnergies& ) const;
+      void add_incoming_factor( const HypothesesGraph&, Model&, const HypothesesGraph::Node&, const NodeEnergies& ) const;
     };
       
     /* class ModelTrainer { */
@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include <vigra/multi_array.hxx>
 #include <vigra/hdf5impex.hxx>
 #include <vigra/random_forest.hxx>
@@ -32,6 +34,22 @@ namespace RF {
     vigra::RandomForest<RF_LABEL_TYPE> getRandomForest(std::string filename);
 
 
+    typedef boost::shared_ptr<const vigra::RandomForest<RF_LABEL_TYPE> > RandomForestPtr;
+
+    /** getSharedRandomForest
+      * Like getRandomForest(), but every file is imported only once per
+      * modification time and size: all callers share the same immutable
+      * forest until the file changes. Thread safe.
+      */
+    RandomForestPtr getSharedRandomForest(const std::string& filename);
+
+    /** clearRandomForestCache
+      * Drop all forests imported by getSharedRandomForest(); forests still in
+      * use stay alive until they are released.
+      */
+    void clearRandomForestCache();
+
+
 
     /** createFeatureVector
       * Create a Random Forest compatible feature vector from Traxel
@@ -41,6 +59,15 @@ namespace RF {
     vigra::MultiArray<2,float> createFeatureVector(const Traxel &tr, const std::vector<std::string> &selFeatures);
 
 
+    /** createFeatureMatrix
+      * One row per traxel, laid out like createFeatureVector(). Traxels
+      * interned with the schema of the first traxel are read through their
+      * feature slots. Throws if the rows differ in length.
+      */
+    vigra::MultiArray<2,float> createFeatureMatrix(const std::vector<const Traxel*>& traxels,
+                                                   const std::vector<std::string>& selFeatures);
+
+
 
     /** getProbabilities
       *
@@ -69,6 +96,12 @@ namespace RF {
                           unsigned int lbl,
                           std::string lblname);
     
+    /**
+      * Predict the probability of class 'cls' for every traxel in the store
+      * and save it as feature 'output_feat_name'. The traxels of a
+      * timestep are predicted as one feature matrix; the timesteps in
+      * parallel.
+      */
     void predict_traxels( TraxelStore&,
                           const vigra::RandomForest<RF_LABEL_TYPE>&,
                           const std::vector<std::string>& feature_names,
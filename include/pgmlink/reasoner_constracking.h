@@ -2,7 +2,10 @@
 #define CONSTRACKING_REASONER_H
 
 #include <map>
+#include <stdexcept>
+#include <vector>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include <opengm/inference/inference.hxx>
 
 #ifdef WITH_GUROBI
@@ -15,13 +18,53 @@
 #include "pgmlink/hypotheses.h"
 #include "pgmlink/reasoner.h"
 #include "pgmlink/feature.h"
+#include "pgmlink/tracking_statistics.h"
 
 namespace pgmlink {
 class Traxel;
 
 
+/**
+ * Conservation tracking as an integer linear program.
+ *
+ * The conservation of objects is always added as hard constraints;
+ * formulate() throws if with_constraints is false.
+ *
+ * With with_components, formulate() splits the graph into its weakly
+ * connected components. Every component gets its own model; the models are
+ * formulated and solved in parallel and conclude() writes the states of all
+ * components into the graph. The objective is a sum over the components,
+ * so the result is the one of the monolithic model as long as every
+ * component is solved to optimality (ep_gap = 0) and the optimum is
+ * unique. A graph with a single component is solved monolithically.
+ *
+ * With a window_length > 0, infer() solves overlapping windows of
+ * window_length timesteps one after the other instead of one model for
+ * the whole graph. Consecutive windows share window_overlap timesteps.
+ * The states before the overlap are final; the next window starts at the
+ * first timestep of the overlap, where the number of objects coming in
+ * from the previous window is fixed. Solve time thus grows linearly with
+ * the number of timesteps and the model size is bounded by the window.
+ * Tracks ending at the end of a window pay no disappearance costs. The
+ * result is an approximation of the monolithic solve, which gets better
+ * with a wider overlap.
+ *
+ * With set_tiling(), infer() splits the field of view into square (cubic
+ * in 3D) tiles instead. Every tile is solved on its own, in parallel,
+ * together with the nodes within the halo around it; a node takes the
+ * states of the tile it lies in. Nodes closer than halo / 2 to the border
+ * between two tiles form the seam, which is solved again afterwards with
+ * the arcs to the rest of the graph fixed as decided by the tiles, so that
+ * tracks crossing a border are consistent. Such an arc is active only if
+ * the tiles of both of its ends chose it; where they disagree, the track
+ * ends and a new one begins. The halo should be at least the longest arc;
+ * longer arcs between tiles stay inactive.
+ */
 class ConservationTracking : public Reasoner {
     public:
+    typedef DenseItemMap<HypothesesGraph::Node, size_t> node_var_map;
+    typedef DenseItemMap<HypothesesGraph::Arc, size_t> arc_var_map;
+
 	ConservationTracking(
                              unsigned int max_number_objects,
                              boost::function<double (const Traxel&, const size_t)> detection,
@@ -38,7 +81,10 @@ class ConservationTracking : public Reasoner {
                              bool with_disappearance = true,
                              double transition_parameter = 5,
                              bool with_constraints = true,
-                             double cplex_timeout = 1e75
+                             double cplex_timeout = 1e75,
+                             bool with_components = false,
+                             unsigned int window_length = 0,
+                             unsigned int window_overlap = 1
                              )
         : max_number_objects_(max_number_objects),
           detection_(detection),
@@ -60,16 +106,128 @@ class ConservationTracking : public Reasoner {
           with_disappearance_(with_disappearance),
           transition_parameter_(transition_parameter),
           with_constraints_(with_constraints),
-          cplex_timeout_(cplex_timeout)
-    { };
+          cplex_timeout_(cplex_timeout),
+          with_components_(with_components),
+          window_length_(window_length),
+          window_overlap_(window_overlap),
+          tile_size_(0),
+          tile_halo_(0),
+          is_subproblem_(false),
+          earliest_timestep_(0),
+          latest_timestep_(0),
+          windowed_graph_(NULL),
+          next_energy_function_(0),
+          number_of_constraints_(0),
+          constraints_seconds_(0),
+          solved_(false),
+          progress_interval_(1.),
+          stop_requested_(new bool(false)),
+          with_constraint_names_(false),
+          with_statistics_(false)
+    {
+        if (window_length_ > 0 && (window_overlap_ < 1 || window_overlap_ >= window_length_)) {
+            throw std::invalid_argument("ConservationTracking: window_overlap has to be in [1, window_length)");
+        }
+    };
     ~ConservationTracking();
 
     virtual void formulate( const HypothesesGraph& );
     virtual void infer();
     virtual void conclude( HypothesesGraph& );
 
+    /** Start the next infer() from the states of a solved graph
+     *
+     * The states are read from node_active2 (or node_active), arc_active and
+     * division_active, e.g. as written by a previous conclude(). The nodes
+     * and arcs of solved have to be those of the graph passed to the next
+     * formulate(). The flow of an active arc is the smaller of the object
+     * counts at its ends. The labeling is passed to the solver as a MIP
+     * start; the solver repairs or drops it if it is infeasible.
+     */
+    void set_starting_point( const HypothesesGraph& solved );
+
+    /** Start the next infer() from a greedy nearest neighbor tracking of g
+     *
+     * Every detection holds one object, and the arcs are accepted by
+     * ascending arc_distance as long as their source has no accepted
+     * outgoing and their target no accepted incoming arc.
+     */
+    void set_greedy_starting_point( const HypothesesGraph& g );
+
+    /// forget the starting point
+    void clear_starting_point();
+
+    /** Replace the energies of a formulated model
+     *
+     * Refills the factors of the detections, transitions and divisions
+     * and updates the objective of the solver; the variables and the
+     * constraints are kept. Call infer() and conclude() again afterwards.
+     * hypotheses has to be the graph passed to the last formulate(). Meant
+     * for parameter sweeps, where rebuilding the model for every set of
+     * weights dominates the run time.
+     */
+    void reweight( const HypothesesGraph& hypotheses,
+                   boost::function<double (const Traxel&, const size_t)> detection,
+                   boost::function<double (const Traxel&, const size_t)> division,
+                   boost::function<double (const double)> transition,
+                   double forbidden_cost,
+                   boost::function<double (const Traxel&)> disappearance_cost_fn,
+                   boost::function<double (const Traxel&)> appearance_cost_fn );
+
     double forbidden_cost() const;
     bool with_constraints() const;
+    bool with_components() const;
+
+    /** Model sizes and solver result of the last formulate() and infer()
+     *
+     * Sums over the components, windows and tiles if the graph was split. The
+     * objective and the bound are read from the solver on each call.
+     */
+    SolverStatistics statistics() const;
+
+    /** Add the estimated bytes of the opengm models to the report
+     *
+     * Sums over the components; the models of the windows and tiles are
+     * freed after solving them and not counted.
+     */
+    void add_memory_usage(MemoryReport& report) const;
+
+    /** Name the linear constraints (for debugging)
+     *
+     * Without names, which is the default, the constraints are collected
+     * in one sparse row buffer and handed to the solver without formatting
+     * a description for each of them. With names, they are also logged at
+     * logDEBUG3.
+     */
+    void set_constraint_names( bool with_names );
+
+    /** Time the constraints of formulate() for statistics()
+     *
+     * Off by default; the clock is not read then.
+     */
+    void set_with_statistics( bool );
+
+    /** Solve the graph in spatial tiles of tile_size with a halo
+     *
+     * See the class documentation. A tile_size of 0, the default, solves
+     * the graph as a whole. Cannot be combined with windows. Takes effect
+     * with the next formulate().
+     */
+    void set_tiling( double tile_size, double halo );
+
+    /** Report the progress of infer() and let the caller stop it
+     *
+     * The solver runs in slices of about interval_seconds that add up to
+     * cplex_timeout (see pgm::anytime_slice_seconds()) and calls callback
+     * with the best solution and the bound after every slice; it stops
+     * early once the solution is within ep_gap of the bound. Once callback returns false,
+     * infer() keeps the best solution found so far. Components and windows
+     * are reported one model at a time, never concurrently; after a stop
+     * request the remaining models stop at their first solution. Takes
+     * effect with the next formulate(). An empty callback switches the
+     * reports off.
+     */
+    void set_progress_callback( SolverProgressCallback callback, double interval_seconds = 1. );
 
     /** Return current state of graphical model
      *
@@ -86,27 +244,55 @@ class ConservationTracking : public Reasoner {
 
     /** Return mapping from HypothesesGraph arcs to graphical model variable ids
      *
-     * The map is populated after the first call to formulate().
+     * The map is populated after the first call to formulate(). It is empty
+     * if the graph was decomposed into components.
      */
-    const std::map<HypothesesGraph::Arc, size_t>& get_arc_map() const;
+    const arc_var_map& get_arc_map() const;
     
 
     private:
+    struct Subproblem;
+
     // copy and assingment have to be implemented, yet
     ConservationTracking(const ConservationTracking&) {};
     ConservationTracking& operator=(const ConservationTracking&) { return *this;};
 
     void reset();
+    // splits g into components_; nothing is split off if g is connected
+    void decompose( const HypothesesGraph& g );
+    // solves windowed_graph_ window by window
+    void infer_windows();
+    // solves windowed_graph_ tile by tile and then the seams between the tiles
+    void infer_tiles();
+    // new reasoner for a part of the graph, with the timestep range of this one
+    ConservationTracking* subproblem_reasoner( bool with_components ) const;
+    // translates the starting point to the reasoner of a part of g
+    void pass_starting_point( const HypothesesGraph& g, Subproblem& sub ) const;
+    // opengm labels of the starting point; hypotheses is the formulated graph
+    void add_starting_labels( const HypothesesGraph& hypotheses );
     void add_constraints( const HypothesesGraph& );
     void add_detection_nodes( const HypothesesGraph& );
     void add_appearance_nodes( const HypothesesGraph& );
     void add_disappearance_nodes( const HypothesesGraph& );
     void add_transition_nodes( const HypothesesGraph& );
     void add_division_nodes(const HypothesesGraph& );
+    // evaluates the energy functions once per node and arc of the graph
+    void compute_energies( const HypothesesGraph& );
+    // instantiated for the built-in functors, so that their calls are inlined
+    template <class Detection, class Division, class Transition>
+    void compute_energies( const HypothesesGraph&,
+                           const Detection&,
+                           const Division&,
+                           const Transition& );
     void add_finite_factors( const HypothesesGraph& );
+    // adds the factor of table; in reweight(), overwrites the values of
+    // the next factor in energy_functions_ instead
+    void add_energy_table( const pgm::OpengmExplicitFactor<double>& table );
 
     // helper
     size_t cplex_id(size_t opengm_id, size_t state);
+    // forwards to progress_callback_ until a model requested the stop
+    bool report_progress( double seconds, double objective, double bound );
 
 
     unsigned int max_number_objects_;
@@ -125,10 +311,10 @@ class ConservationTracking : public Reasoner {
     opengm::LPCplex<pgm::OpengmModelDeprecated::ogmGraphicalModel, pgm::OpengmModelDeprecated::ogmAccumulator>* optimizer_;
 #endif
 
-    std::map<HypothesesGraph::Node, size_t> div_node_map_;
-    std::map<HypothesesGraph::Node, size_t> app_node_map_;
-    std::map<HypothesesGraph::Node, size_t> dis_node_map_;
-    std::map<HypothesesGraph::Arc, size_t> arc_map_;
+    node_var_map div_node_map_;
+    node_var_map app_node_map_;
+    node_var_map dis_node_map_;
+    arc_var_map arc_map_;
 
     double ep_gap_;    
 
@@ -152,6 +338,64 @@ class ConservationTracking : public Reasoner {
 
     HypothesesGraph tracklet_graph_;
     std::map<HypothesesGraph::Node, std::vector<HypothesesGraph::Node> > tracklet2traxel_node_map_;
+
+    bool with_components_;
+    unsigned int window_length_, window_overlap_;
+    // edge length of the tiles (0: no tiles) and width of their halo
+    double tile_size_, tile_halo_;
+
+    // set for the reasoner of a part of a graph: the appearance and
+    // disappearance costs use earliest_timestep_ and latest_timestep_ as
+    // set by the reasoner of the whole graph
+    bool is_subproblem_;
+    int earliest_timestep_, latest_timestep_;
+    // node -> fixed state of its disappearance node (i.e. incoming flow)
+    node_var_map fixed_dis_states_;
+    // arc -> decided outside of the model whether it is active (1) or not;
+    // its flow is free. Requires with_tracklets_ off.
+    arc_var_map fixed_arc_states_;
+
+    std::vector<boost::shared_ptr<Subproblem> > components_;
+
+    // the graph solved window by window or tile by tile in infer()
+    const HypothesesGraph* windowed_graph_;
+    // final states of the windows or tiles by node and arc id
+    std::vector<size_t> window_node_states_;
+    std::vector<bool> window_arc_states_, window_division_states_;
+
+    // starting point by node and arc id; empty if there is none
+    std::vector<size_t> start_node_states_;
+    std::vector<size_t> start_arc_flows_;
+    std::vector<bool> start_division_states_;
+    std::vector<pgm::OpengmModelDeprecated::ogmInference::LabelType> starting_labels_;
+
+    // energies by node and arc id, written by compute_energies(); detection
+    // and transition energies have max_number_objects_ + 1 states per id,
+    // division energies 2
+    std::vector<double> detection_energies_;
+    std::vector<double> appearance_costs_;
+    std::vector<double> disappearance_costs_;
+    std::vector<double> transition_energies_;
+    std::vector<double> division_energies_;
+
+    // functions of the energy factors in the order add_finite_factors() adds them
+    std::vector<pgm::OpengmModelDeprecated::FunctionIdentifier> energy_functions_;
+    size_t next_energy_function_;
+
+    size_t number_of_constraints_;
+    double constraints_seconds_;
+    // infer() has been called on the current objective
+    bool solved_;
+    // summed up by infer_windows() and infer_tiles()
+    SolverStatistics window_statistics_;
+
+    SolverProgressCallback progress_callback_;
+    double progress_interval_;
+    // shared with the reasoners of the components and windows
+    boost::shared_ptr<bool> stop_requested_;
+
+    bool with_constraint_names_;
+    bool with_statistics_;
 };
 
 
@@ -0,0 +1,136 @@
+/**
+   @file
+   @ingroup tracking
+   @brief min-cost flow reasoner for conservation tracking
+*/
+
+#ifndef REASONER_FLOW_H
+#define REASONER_FLOW_H
+
+#include <vector>
+#include <boost/function.hpp>
+#include <lemon/list_graph.h>
+
+#include "pgmlink/feature.h"
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/reasoner.h"
+#include "pgmlink/tracking_statistics.h"
+
+namespace pgmlink {
+class Traxel;
+
+/**
+ * Conservation tracking as a min-cost flow problem, solved by lemon's
+ * NetworkSimplex instead of a MIP solver.
+ *
+ * Every object is one unit of flow from a source to a sink. A detection
+ * is a chain of max_number_objects unit arcs, the k-th one costing
+ * detection(k) - detection(k-1); objects enter at appearances and leave
+ * at disappearances, with the costs per object of ConservationTracking
+ * (none in the first and the last timestep). A transition arc costs
+ * transition(1) - transition(0) per object. A division is an extra unit
+ * entering at the parent, costing division(1) - division(0).
+ *
+ * The flow is a relaxation of the ConservationTracking model: divisions
+ * are only valid if the parent holds exactly one object that leaves by
+ * exactly two transitions. infer() disables the division arcs of invalid
+ * divisions and solves again until all divisions are valid. The optimum
+ * is the one of ConservationTracking for max_number_objects = 1 as long
+ * as no division has to be disabled; with more objects, the detection
+ * energies have to be convex in the number of objects and mergers pay
+ * the transition costs per object. Partial appearances and
+ * disappearances (objects joining or leaving a track at a detection) are
+ * allowed.
+ *
+ * conclude() writes node_active2, arc_active and division_active like
+ * ConservationTracking.
+ */
+class FlowTracking : public Reasoner {
+    public:
+    FlowTracking(unsigned int max_number_objects,
+                 boost::function<double (const Traxel&, const size_t)> detection,
+                 boost::function<double (const Traxel&, const size_t)> division,
+                 boost::function<double (const double)> transition,
+                 bool with_divisions = true,
+                 boost::function<double (const Traxel&)> disappearance_cost_fn = ConstantFeature(500.0),
+                 boost::function<double (const Traxel&)> appearance_cost_fn = ConstantFeature(500.0),
+                 double transition_parameter = 5
+                 )
+        : max_number_objects_(max_number_objects),
+          detection_(detection),
+          division_(division),
+          transition_(transition),
+          with_divisions_(with_divisions),
+          disappearance_cost_(disappearance_cost_fn),
+          appearance_cost_(appearance_cost_fn),
+          transition_parameter_(transition_parameter),
+          capacities_(network_),
+          costs_(network_),
+          flows_(network_),
+          supply_(0),
+          graph_(NULL),
+          number_of_disabled_divisions_(0),
+          total_cost_(0),
+          solved_(false)
+    {};
+
+    virtual void formulate( const HypothesesGraph& );
+    virtual void infer();
+    virtual void conclude( HypothesesGraph& );
+
+    /// divisions disabled by the last infer() since they were invalid
+    size_t number_of_disabled_divisions() const { return number_of_disabled_divisions_; }
+
+    /// network arcs as variables and network nodes as constraints; the
+    /// objective is the cost of the flow, i.e. relative to the empty
+    /// tracking, and equals the bound
+    SolverStatistics statistics() const;
+
+    private:
+    typedef lemon::ListDigraph Network;
+
+    // copy and assignment are not supported
+    FlowTracking(const FlowTracking&);
+    FlowTracking& operator=(const FlowTracking&);
+
+    Network::Arc add_arc( Network::Node from, Network::Node to, int capacity, double cost );
+    // the objects in hypotheses node id
+    int node_flow( int id ) const;
+    // the division at n violates the division constraints in flows_
+    bool invalid_division( const HypothesesGraph& g, const HypothesesGraph::Node& n ) const;
+
+    unsigned int max_number_objects_;
+
+    // energy functions
+    boost::function<double (const Traxel&, const size_t)> detection_;
+    boost::function<double (const Traxel&, const size_t)> division_;
+    boost::function<double (const double)> transition_;
+    bool with_divisions_;
+    boost::function<double (const Traxel&)> disappearance_cost_;
+    boost::function<double (const Traxel&)> appearance_cost_;
+    double transition_parameter_;
+
+    Network network_;
+    Network::Node source_, sink_;
+    Network::ArcMap<int> capacities_;
+    Network::ArcMap<double> costs_;
+    Network::ArcMap<int> flows_;
+    int supply_;
+
+    // the formulated graph
+    const HypothesesGraph* graph_;
+    // by node id of graph_: max_number_objects_ unit arcs per node
+    std::vector<Network::Arc> detection_arcs_;
+    std::vector<Network::Arc> disappearance_arcs_;
+    // lemon::INVALID if the node cannot divide
+    std::vector<Network::Arc> division_arcs_;
+    // by arc id of graph_
+    std::vector<Network::Arc> transition_arcs_;
+
+    size_t number_of_disabled_divisions_;
+    double total_cost_;
+    bool solved_;
+};
+
+} /* namespace pgmlink */
+#endif /* REASONER_FLOW_H */
@@ -14,7 +14,6 @@
 #include <utility>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
-#include <boost/bimap.hpp>
 #include <opengm/inference/inference.hxx>
 
 #ifdef WITH_GUROBI
@@ -29,6 +28,7 @@
 #include "pgmlink/hypotheses.h"
 #include "pgmlink/reasoner.h"
 #include "pgmlink/pgm_chaingraph.h"
+#include "pgmlink/tracking_statistics.h"
 
 namespace pgmlink {
   class Traxel;
@@ -55,7 +55,15 @@ namespace pgmlink {
       fixed_detections_(fixed_detections),
       ep_gap_(ep_gap),
       cplex_timeout_(cplex_timeout),
-      builder_(NULL)
+      builder_(NULL),
+      number_of_constraints_(0),
+      constraints_seconds_(0),
+      solved_(false),
+      progress_interval_(1.),
+      with_lp_relaxation_(false),
+      with_statistics_(false),
+      graph_(NULL),
+      rounded_objective_(0)
 	{ builder_ = new pgm::chaingraph::ECCV12ModelBuilder(); (*builder_).with_detection_vars().with_divisions(); }
     
 
@@ -70,7 +78,15 @@ namespace pgmlink {
     fixed_detections_(fixed_detections),
     ep_gap_(ep_gap),
     cplex_timeout_(cplex_timeout),
-    builder_(builder.clone())
+    builder_(builder.clone()),
+    number_of_constraints_(0),
+    constraints_seconds_(0),
+    solved_(false),
+    progress_interval_(1.),
+    with_lp_relaxation_(false),
+    with_statistics_(false),
+    graph_(NULL),
+    rounded_objective_(0)
     {};
     ~Chaingraph();
 
@@ -102,6 +118,45 @@ namespace pgmlink {
      * The map is populated after the first call to formulate().
      */
     const arc_var_map& get_arc_map() const;
+
+    /** Model size and solver result of the last formulate() and infer()
+     *
+     * The objective and the bound are read from the solver on each call.
+     */
+    SolverStatistics statistics() const;
+
+    /// add the estimated bytes of the opengm model to the report
+    void add_memory_usage(MemoryReport& report) const;
+
+    /** Report the progress of infer() and let the caller stop it
+     *
+     * The solver runs in slices of about interval_seconds that add up to
+     * cplex_timeout (see pgm::anytime_slice_seconds()) and calls callback
+     * with the best solution and the bound after every slice; it stops
+     * early once the solution is within ep_gap of the bound. Once callback returns false,
+     * infer() keeps the best solution found so far. Takes effect with the
+     * next formulate(). An empty callback switches the reports off.
+     */
+    void set_progress_callback( SolverProgressCallback callback, double interval_seconds = 1. );
+
+    /** Solve the LP relaxation instead of the integer program
+     *
+     * infer() takes the most likely label of every variable of the
+     * relaxed solution and repairs it to satisfy the hard constraints:
+     * detections are fixed if requested, arcs to undetected objects are
+     * switched off, and of too many incoming or outgoing arcs the ones
+     * with the cheapest moves are kept. statistics() reports the energy
+     * of the repaired solution against the LP bound, with the status
+     * "rounded". Takes effect with the next formulate().
+     */
+    void set_lp_relaxation( bool );
+    bool lp_relaxation() const;
+
+    /** Time the constraints of formulate() for statistics()
+     *
+     * Off by default; the clock is not read then.
+     */
+    void set_with_statistics( bool );
     
 
     private:
@@ -109,6 +164,7 @@ namespace pgmlink {
     Chaingraph(const Chaingraph&) {};
     Chaingraph& operator=(const Chaingraph&) { return *this;};
     void reset();
+    void round_relaxed_solution();
     
     pgm::OpengmLPCplex* optimizer_;
     shared_ptr<pgm::chaingraph::Model> linking_model_;
@@ -119,6 +175,19 @@ namespace pgmlink {
     double ep_gap_;
     double cplex_timeout_;
     pgm::chaingraph::ModelBuilder* builder_;
+
+    size_t number_of_constraints_;
+    double constraints_seconds_;
+    bool solved_;
+
+    SolverProgressCallback progress_callback_;
+    double progress_interval_;
+
+    bool with_lp_relaxation_;
+    bool with_statistics_;
+    const HypothesesGraph* graph_;
+    std::vector<pgm::OpengmLPCplex::LabelType> rounded_solution_;
+    double rounded_objective_;
 };
 
 } /* namespace pgmlink */
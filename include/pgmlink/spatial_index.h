@@ -0,0 +1,161 @@
+/**
+   @file
+   @ingroup tracking
+   @brief spatial indices for the neighbor search among traxels
+*/
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+    class Traxel;
+
+    /**
+     * Range and kNN search among the traxels of one timestep.
+     *
+     * The indexed traxels are placed at their com (X(), Y(), Z()), or at
+     * their corrected com if the index is built in reverse. Queries use the
+     * opposite: the corrected com, or the com if reverse is set.
+     *
+     * Radii are inclusive and distances are squared euclidean distances.
+     */
+    class SpatialIndex
+    {
+      public:
+        PGMLINK_EXPORT virtual ~SpatialIndex() {}
+
+        /**
+         * Returns (traxel id, distance*distance) map of at most knn
+         * nearest traxels within radius.
+         */
+        PGMLINK_EXPORT virtual std::map<unsigned int, double> knn_in_range( const Traxel& query, double radius, unsigned int knn, const bool reverse = false ) = 0;
+        PGMLINK_EXPORT virtual unsigned int count_in_range( const Traxel& query, double radius, const bool reverse = false ) = 0;
+
+        /**
+         * Batched knn_in_range() in compressed sparse row layout.
+         *
+         * The neighbors of queries[i] (at most knn[i]) are
+         * ids[offsets[i]], ..., ids[offsets[i+1] - 1], sorted by id as in
+         * knn_in_range(), with the squared distances at the same positions.
+         * The output vectors are overwritten; pass the same vectors again
+         * to reuse their memory.
+         */
+        PGMLINK_EXPORT virtual void knn_in_range( const std::vector<const Traxel*>& queries,
+                                                  const std::vector<unsigned int>& knn,
+                                                  double radius,
+                                                  std::vector<size_t>& offsets,
+                                                  std::vector<unsigned int>& ids,
+                                                  std::vector<double>& distances,
+                                                  const bool reverse = false ) = 0;
+    };
+
+
+
+    /**
+     * Uniform grid (cell list) of the traxels.
+     *
+     * Points are bucketed into cubic cells of the given edge length, so a
+     * query with a radius of about the cell size visits only the cells
+     * next to the query point. This beats a kd-tree for nearly uniform
+     * densities and a fixed search radius. If all traxels share the same z,
+     * the grid is planar. Results are the same as with
+     * NearestNeighborSearch, except that kNN ties at equal distance are
+     * broken by the smaller id.
+     *
+     * Queries do not modify the grid and may run concurrently.
+     */
+    class GridNeighborSearch : public SpatialIndex
+    {
+      public:
+        /**
+         * cell_size should be about the query radius; if it is not
+         * positive, it is chosen so that there is about one traxel per
+         * cell. It is increased if the grid would have too many empty
+         * cells.
+         */
+        template <typename InputIt>
+        GridNeighborSearch( InputIt traxel_begin,
+                            InputIt traxel_end,
+                            double cell_size,
+                            const bool reverse = false );
+
+        PGMLINK_EXPORT virtual std::map<unsigned int, double> knn_in_range( const Traxel& query, double radius, unsigned int knn, const bool reverse = false );
+        PGMLINK_EXPORT virtual unsigned int count_in_range( const Traxel& query, double radius, const bool reverse = false );
+        PGMLINK_EXPORT virtual void knn_in_range( const std::vector<const Traxel*>& queries,
+                                                  const std::vector<unsigned int>& knn,
+                                                  double radius,
+                                                  std::vector<size_t>& offsets,
+                                                  std::vector<unsigned int>& ids,
+                                                  std::vector<double>& distances,
+                                                  const bool reverse = false );
+
+        /// 2 if the grid is planar, 3 otherwise
+        PGMLINK_EXPORT int dimension() const { return dimension_; }
+        PGMLINK_EXPORT double cell_size() const { return cell_size_; }
+        PGMLINK_EXPORT size_t size() const { return ids_.size(); }
+
+      private:
+        // (distance*distance, traxel id)
+        typedef std::vector<std::pair<double, unsigned int> > Found;
+
+        // ctor helper: bucket the points in coordinates_/ids_
+        PGMLINK_EXPORT void build( double cell_size );
+        // all traxels within radius of the query, unordered
+        void in_range( const Traxel& query, double radius, const bool reverse, Found& found ) const;
+        // the knn nearest of found, sorted by id
+        static void nearest( Found& found, unsigned int knn );
+
+        // x, y, z of the traxels in cell order
+        std::vector<double> coordinates_;
+        std::vector<unsigned int> ids_;
+        // points of cell c: cell_offsets_[c], ..., cell_offsets_[c+1] - 1
+        std::vector<size_t> cell_offsets_;
+        double origin_[3];
+        size_t shape_[3];
+        double cell_size_;
+        int dimension_;
+    };
+
+} /* namespace pgmlink */
+
+
+
+/****
+ Implementation
+ ****/
+#include <iterator>
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+
+template <typename InputIt>
+GridNeighborSearch::GridNeighborSearch(InputIt traxel_begin, InputIt traxel_end, double cell_size, const bool reverse)
+: cell_size_(0), dimension_(2)
+{
+  const size_t size = std::distance(traxel_begin, traxel_end);
+  coordinates_.reserve(3 * size);
+  ids_.reserve(size);
+  for(InputIt traxel = traxel_begin; traxel != traxel_end; ++traxel) {
+    if (!reverse) {
+      coordinates_.push_back(traxel->X());
+      coordinates_.push_back(traxel->Y());
+      coordinates_.push_back(traxel->Z());
+    } else {
+      coordinates_.push_back(traxel->X_corr());
+      coordinates_.push_back(traxel->Y_corr());
+      coordinates_.push_back(traxel->Z_corr());
+    }
+    ids_.push_back(traxel->Id);
+  }
+  build(cell_size);
+}
+
+} /* namespace pgmlink */
+
+#endif /* SPATIAL_INDEX_H */
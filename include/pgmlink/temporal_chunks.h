@@ -0,0 +1,91 @@
+/**
+   @file
+   @ingroup tracking
+   @brief tracking of temporal chunks in separate processes and merging
+   of their events
+*/
+
+#ifndef TEMPORAL_CHUNKS_H
+#define TEMPORAL_CHUNKS_H
+
+#include <string>
+#include <vector>
+
+#include "pgmlink/event.h"
+#include "pgmlink/pgmlink_export.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+class ConsTracking;
+
+/**
+ * Timesteps of one chunk of a movie. The chunk owns the event slots of
+ * own_first, ..., own_last: the events between t-1 and t for t in that
+ * range (see events()). It is solved over first, ..., last, which adds
+ * overlap timesteps of context on either side, and the slots are numbered
+ * from origin, the earliest timestep of the movie.
+ */
+struct TemporalChunk {
+  TemporalChunk() : first(0), last(-1), own_first(0), own_last(-1), origin(0) {}
+  int first, last;
+  int own_first, own_last;
+  int origin;
+};
+
+/**
+ * Chunks of chunk_length owned timesteps covering first_timestep, ...,
+ * last_timestep. The plan only depends on its arguments, so the
+ * coordinator and every worker can compute it on their own.
+ */
+PGMLINK_EXPORT std::vector<TemporalChunk> plan_temporal_chunks(int first_timestep, int last_timestep,
+                                                              int chunk_length, int overlap);
+/// plan_temporal_chunks() of the timesteps of ts
+PGMLINK_EXPORT std::vector<TemporalChunk> plan_temporal_chunks(const TraxelStore& ts,
+                                                              int chunk_length, int overlap);
+
+/// <prefix>.chunk<number>.pgmlevts
+PGMLINK_EXPORT std::string chunk_events_filename(const std::string& prefix, size_t chunk);
+
+/**
+ * Worker: track the traxels of ts in [chunk.first, chunk.last] and write
+ * the events of the owned slots to filename in the binary event format
+ * (see binary_events.h), numbered from chunk.origin. ts itself is not
+ * modified; tracking is configured by the caller as for a whole movie,
+ * except that it must not resolve mergers (see
+ * ConsTracking::resolves_mergers()): the resolved traxels get ids of
+ * their chunk only. Throws std::invalid_argument otherwise.
+ */
+PGMLINK_EXPORT void track_temporal_chunk(ConsTracking& tracking,
+                                         const TraxelStore& ts,
+                                         const TemporalChunk& chunk,
+                                         const std::string& filename);
+
+/**
+ * Coordinator: the events of all chunks, read from the files written by
+ * track_temporal_chunk(), in one nested event vector.
+ *
+ * At the seam between two chunks the earlier one decided whether the
+ * traxels at own_first - 1 of the later one are tracked, and the later one
+ * decided where they go. Where the two disagree, the traxel gets an
+ * Appearance, or a Disappearance, or its Disappearance is dropped, so that
+ * every track is continuous. The first timestep of the movie has no
+ * Appearances, so a seam there keeps the decisions of the later chunk.
+ * Throws std::runtime_error on ResolvedTo and MultiFrameMove events.
+ */
+PGMLINK_EXPORT std::vector<std::vector<Event> > merge_temporal_chunks(const std::vector<TemporalChunk>& chunks,
+                                                                     const std::vector<std::string>& filenames);
+
+/**
+ * Both roles in one process: track_temporal_chunk() of every chunk, one
+ * after the other, to chunk_events_filename(prefix, chunk) and
+ * merge_temporal_chunks() of the files.
+ */
+PGMLINK_EXPORT std::vector<std::vector<Event> > track_temporal_chunks(ConsTracking& tracking,
+                                                                     const TraxelStore& ts,
+                                                                     int chunk_length,
+                                                                     int overlap,
+                                                                     const std::string& prefix);
+
+} /* namespace pgmlink */
+
+#endif /* TEMPORAL_CHUNKS_H */
@@ -10,6 +10,7 @@
 #include "pgmlink/randomforest.h"
 #include <vector>
 #include <string>
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include "pgmlink/event.h"
@@ -17,8 +18,13 @@
 #include "pgmlink/traxels.h"
 #include "pgmlink/field_of_view.h"
 #include "pgmlink/merger_resolving.h"
+#include "pgmlink/tracking_checkpoint.h"
+#include "pgmlink/tracking_statistics.h"
 
 namespace pgmlink {
+  class ConservationTracking;
+  class BorderDistances;
+
   class ChaingraphTracking 
   {
    public:
@@ -46,7 +52,8 @@ namespace pgmlink {
       opportunity_cost_(opportunity_cost), forbidden_cost_(forbidden_cost), with_constraints_(with_constraints),
       fixed_detections_(fixed_detections), mean_div_dist_(mean_div_dist), min_angle_(min_angle),
       ep_gap_(ep_gap), n_neighbors_(n_neighbors), with_divisions_(with_divisions),
-      cplex_timeout_(cplex_timeout), alternative_builder_(alternative_builder)
+      cplex_timeout_(cplex_timeout), alternative_builder_(alternative_builder),
+      with_statistics_(false), progress_interval_(1.), with_lp_relaxation_(false)
     {}
 
     PGMLINK_EXPORT std::vector< std::vector<Event> > operator()(TraxelStore&);
@@ -62,6 +69,30 @@ namespace pgmlink {
     PGMLINK_EXPORT void set_with_divisions(bool);
     PGMLINK_EXPORT void set_cplex_timeout(double);
 
+    /**
+     * Collect phase timings, model sizes and the solver result in
+     * operator(). Off by default; the clock is not read then.
+     */
+    PGMLINK_EXPORT void set_with_statistics(bool);
+
+    /**
+     * Statistics of the last call to operator(); all zero unless
+     * set_with_statistics(true) was called before.
+     */
+    PGMLINK_EXPORT const TrackingStatistics& statistics() const;
+
+    /**
+     * Report the progress of the solver and let the caller stop it; see
+     * Chaingraph::set_progress_callback().
+     */
+    PGMLINK_EXPORT void set_progress_callback(SolverProgressCallback callback, double interval_seconds = 1.);
+
+    /**
+     * Solve the LP relaxation and round it instead of solving the integer
+     * program; see Chaingraph::set_lp_relaxation(). Off by default.
+     */
+    PGMLINK_EXPORT void set_lp_relaxation(bool);
+
   private:
     double app_, dis_, det_, mis_;
     const std::string rf_fn_;
@@ -77,8 +108,32 @@ namespace pgmlink {
     double cplex_timeout_;
     bool alternative_builder_;
     shared_ptr<std::vector< std::map<unsigned int, bool> > > last_detections_;
+    bool with_statistics_;
+    TrackingStatistics statistics_;
+    SolverProgressCallback progress_callback_;
+    double progress_interval_;
+    bool with_lp_relaxation_;
   };
 
+  /**
+   * Nearest neighbor tracking without a solver, for previews and when no
+   * ILP solver is available.
+   *
+   * The traxels of every pair of consecutive timesteps are linked on their
+   * own, the pairs in parallel. The candidate successors come from a
+   * GridNeighborSearch of the positions of the next timestep, queried in
+   * one batch for all traxels within max(divDist, movDist); no
+   * HypothesesGraph is built and no traxel is copied.
+   *
+   * A traxel with a divProb above divisionThreshold divides into its two
+   * nearest free successors within divDist. The remaining traxels move to
+   * the nearest free successor within movDist, the shortest links first.
+   * With mergerHandling, a traxel left over moves into an already taken
+   * successor, which becomes a Merger. With splitterHandling, a successor
+   * left over is linked to its nearest predecessor with a single move as a
+   * second Move. Distances are euclidean in the given features, or in the
+   * positions if there are none. maxTraxelIdAt is not used.
+   */
   class NNTracking 
   {
    public:
@@ -96,6 +151,8 @@ namespace pgmlink {
     {}
     
     PGMLINK_EXPORT std::vector< std::vector<Event> > operator()(TraxelStore&);
+    /// hand the events to sink, one slot per timestep
+    PGMLINK_EXPORT void operator()(TraxelStore&, EventSink& sink);
 
     /**
      * Get state of detection variables after call to operator().
@@ -112,6 +169,13 @@ namespace pgmlink {
   };
 
 
+  /**
+   * Nearest neighbor tracklets: like NNTracking, but a traxel only moves
+   * to its successor within maxDist if they are mutual nearest neighbors,
+   * so ambiguous links are left to the appearances and disappearances (or
+   * to the merger and splitter handling). Divisions are limited by maxDist
+   * as well.
+   */
   class NNTrackletsTracking
   {
     public:
@@ -128,6 +192,8 @@ namespace pgmlink {
       {}
       
       PGMLINK_EXPORT std::vector< std::vector<Event> > operator()(TraxelStore&);
+      /// hand the events to sink, one slot per timestep
+      PGMLINK_EXPORT void operator()(TraxelStore&, EventSink& sink);
 
       /**
        * Get state of detection variables after call to operator().
@@ -143,6 +209,35 @@ namespace pgmlink {
       std::vector<int> maxTraxelIdAt_;
   };
 
+  /**
+   * The weights and solver settings of ConsTracking that do not change the
+   * hypotheses graph.
+   */
+  struct ConsTrackingParameters {
+    ConsTrackingParameters(double division_weight = 10.0,
+                           double transition_weight = 10.0,
+                           double disappearance_cost = 0,
+                           double appearance_cost = 0,
+                           double forbidden_cost = 0,
+                           double ep_gap = 0.01,
+                           double transition_parameter = 5.,
+                           double cplex_timeout = 1e+75)
+    : division_weight(division_weight), transition_weight(transition_weight),
+      disappearance_cost(disappearance_cost), appearance_cost(appearance_cost),
+      forbidden_cost(forbidden_cost), ep_gap(ep_gap),
+      transition_parameter(transition_parameter), cplex_timeout(cplex_timeout)
+    {}
+
+    double division_weight;
+    double transition_weight;
+    double disappearance_cost;
+    double appearance_cost;
+    double forbidden_cost;
+    double ep_gap;
+    double transition_parameter;
+    double cplex_timeout;
+  };
+
   class ConsTracking
   {
     public:
@@ -168,7 +263,12 @@ namespace pgmlink {
                     FieldOfView fov = FieldOfView(),
                     bool with_constraints = true,
                     double cplex_timeout = 1e+75,
-                    const std::string& event_vector_dump_filename = "none"
+                    const std::string& event_vector_dump_filename = "none",
+                    bool with_components = false,
+                    int window_length = 0,
+                    int window_overlap = 1,
+                    bool with_warm_start = false,
+                    bool with_min_cost_flow = false
                    )
       : max_number_objects_(max_number_objects),
         max_dist_(max_neighbor_distance), division_threshold_(division_threshold),
@@ -190,7 +290,20 @@ namespace pgmlink {
         fov_(fov),
         with_constraints_(with_constraints),
         cplex_timeout_(cplex_timeout),
-        event_vector_dump_filename_(event_vector_dump_filename)
+        event_vector_dump_filename_(event_vector_dump_filename),
+        with_components_(with_components),
+        window_length_(window_length),
+        window_overlap_(window_overlap),
+        with_warm_start_(with_warm_start),
+        with_min_cost_flow_(with_min_cost_flow),
+        with_statistics_(false),
+        progress_interval_(1.),
+        with_parallel_gmm_(false),
+        with_assignment_resolution_(false),
+        tile_size_(0),
+        tile_halo_(0),
+        checkpoint_prefix_(""),
+        resume_checkpoint_("")
       {}
 
       PGMLINK_EXPORT std::vector< std::vector<Event> > operator()(TraxelStore& ts,
@@ -201,7 +314,150 @@ namespace pgmlink {
        */
       PGMLINK_EXPORT std::vector< std::map<unsigned int, bool> > detections();
 
+      /**
+       * Solve the model of the last call to operator() again with other
+       * weights, without building the hypotheses and the constraints anew.
+       * The traxel store passed to operator() has to be unchanged. Not
+       * available if the last call resolved mergers, since that changes
+       * the hypotheses graph.
+       */
+      PGMLINK_EXPORT std::vector< std::vector<Event> > reweight(double division_weight,
+                                                               double transition_weight,
+                                                               double disappearance_cost,
+                                                               double appearance_cost,
+                                                               double forbidden_cost);
+
+      /**
+       * Track ts once per configuration.
+       *
+       * The hypotheses graph and the detection energies are built once,
+       * with the parameters of this object; the configurations replace the
+       * weights and the solver settings. The models of all configurations
+       * are formulated and solved concurrently on the shared graph, so they
+       * are all in memory at the same time. Mergers are not resolved and
+       * the result cannot be reweighted. detections() returns the states of
+       * the last configuration.
+       */
+      PGMLINK_EXPORT std::vector< std::vector< std::vector<Event> > > track_configurations(
+          TraxelStore& ts,
+          const std::vector<ConsTrackingParameters>& configurations);
+
+      /**
+       * Collect phase timings, model sizes and the solver result in
+       * operator() and reweight(). Off by default; the clock is not read
+       * then.
+       */
+      PGMLINK_EXPORT void set_with_statistics(bool);
+
+      /**
+       * Statistics of the last call to operator() or reweight(); all zero
+       * unless set_with_statistics(true) was called before.
+       */
+      PGMLINK_EXPORT const TrackingStatistics& statistics() const;
+
+      /**
+       * Report the progress of the solver and let the caller stop it; see
+       * ConservationTracking::set_progress_callback(). Also used by
+       * reweight() if set before operator(). The min-cost flow is solved
+       * exactly and reports nothing.
+       */
+      PGMLINK_EXPORT void set_progress_callback(SolverProgressCallback callback, double interval_seconds = 1.);
+
+      /**
+       * Fit the mixture models of the mergers of a timestep concurrently
+       * when resolving mergers without coordinates, with the serial
+       * results; see calculate_gmm_beforehand(). Off by default.
+       */
+      PGMLINK_EXPORT void set_with_parallel_gmm(bool);
+
+      /**
+       * Reuse the merger fits of previous runs in cache and add the new
+       * ones to it; see calculate_gmm_beforehand(). No cache by default.
+       */
+      PGMLINK_EXPORT void set_merger_cache(MergerCentersCachePtr cache);
+
+      /**
+       * Resolve mergers with the coordinates of provider when operator()
+       * gets no coordinate map, e.g. with a MappedCoordinateFile that only
+       * reads the coordinates of the mergers.
+       */
+      PGMLINK_EXPORT void set_coordinate_provider(CoordinateProviderPtr provider);
+
+      /**
+       * Assign the arcs of the resolved mergers with ReasonerMaxOneArc
+       * instead of solving them with conservation tracking in
+       * resolve_graph(). Off by default.
+       */
+      PGMLINK_EXPORT void set_with_assignment_resolution(bool);
+
+      /**
+       * True if operator() resolves the mergers, i.e. with
+       * with_merger_resolution and max_number_objects > 1.
+       */
+      PGMLINK_EXPORT bool resolves_mergers() const;
+
+      /**
+       * Solve the field of view in spatial tiles of tile_size with a halo
+       * of halo around each, in parallel, and reconcile the tracks
+       * crossing the tiles; see ConservationTracking::set_tiling(). The
+       * halo should be at least max_neighbor_distance. A tile_size of 0,
+       * the default, solves the whole field of view at once.
+       */
+      PGMLINK_EXPORT void set_tiling(double tile_size, double halo);
+
+      /**
+       * Checkpoint the graph after the hypotheses, after solving and
+       * before the merger resolution to checkpoint_filename(prefix, stage);
+       * see save_checkpoint(). An empty prefix, the default, writes no
+       * checkpoints.
+       */
+      PGMLINK_EXPORT void set_checkpoint_prefix(const std::string& prefix);
+
+      /**
+       * Resume operator() from the checkpoint in filename instead of
+       * building the hypotheses graph: the stages up to the one of the
+       * checkpoint are skipped, the later ones run with the current
+       * parameters. operator() has to get the traxel store the checkpoint
+       * was taken of. An empty filename, the default, runs all stages.
+       */
+      PGMLINK_EXPORT void set_resume_checkpoint(const std::string& filename);
+
     private:
+      // detection energy and the border distances of the traxels of ts
+      void prepare_traxels(TraxelStore& ts,
+                           boost::function<double(const Traxel&, const size_t)>& detection,
+                           PhaseTimer& timer);
+      // prepare_traxels() and the hypotheses graph with arc distances of ts
+      shared_ptr<HypothesesGraph> build_hypotheses(TraxelStore& ts,
+                                                   boost::function<double(const Traxel&, const size_t)>& detection,
+                                                   PhaseTimer& timer);
+      ConsTrackingParameters current_parameters() const;
+      // unformulated reasoner with a starting point and the progress callback
+      shared_ptr<ConservationTracking> conservation_reasoner(
+          const HypothesesGraph& graph,
+          const ConsTrackingParameters& parameters,
+          boost::function<double(const Traxel&, const size_t)> detection,
+          boost::function<double(const Traxel&, const size_t)> division,
+          boost::function<double(const double)> transition,
+          boost::function<double(const Traxel&)> disappearance_cost_fn,
+          boost::function<double(const Traxel&)> appearance_cost_fn) const;
+      // formulates, solves and concludes a FlowTracking of graph
+      void solve_min_cost_flow(HypothesesGraph& graph,
+                               boost::function<double(const Traxel&, const size_t)> detection,
+                               boost::function<double(const Traxel&, const size_t)> division,
+                               boost::function<double(const double)> transition,
+                               boost::function<double(const Traxel&)> disappearance_cost_fn,
+                               boost::function<double(const Traxel&)> appearance_cost_fn,
+                               PhaseTimer& timer);
+      // energies of the weights of parameters
+      void energy_functions(const ConsTrackingParameters& parameters,
+                            boost::function<double(const Traxel&, const size_t)>& division,
+                            boost::function<double(const double)>& transition,
+                            boost::function<double(const Traxel&)>& disappearance_cost_fn,
+                            boost::function<double(const Traxel&)>& appearance_cost_fn) const;
+      // save_checkpoint() of graph at stage if there is a checkpoint prefix
+      void checkpoint(const HypothesesGraph& graph, TrackingStage stage, PhaseTimer& timer);
+
       int max_number_objects_;
       double max_dist_;
       double division_threshold_;
@@ -224,7 +480,37 @@ namespace pgmlink {
       FieldOfView fov_;
       bool with_constraints_;
       double cplex_timeout_;
+      // events in the binary event format, the traxel store as binary
+      // TraxelStore next to it ("none": no dump)
       std::string event_vector_dump_filename_;
+      // solve the connected components of the graph independently, also
+      // the neighborhoods of the resolved mergers
+      bool with_components_;
+      // solve windows of window_length_ timesteps one after the other (0: no windows)
+      int window_length_, window_overlap_;
+      // start the solver from a greedy nearest neighbor tracking
+      bool with_warm_start_;
+      // solve with FlowTracking instead of ConservationTracking
+      bool with_min_cost_flow_;
+      // border distances of the traxels of the run, if border_width_ > 0
+      shared_ptr<const BorderDistances> border_distances_;
+      // formulated model of the last operator() call, for reweight()
+      shared_ptr<HypothesesGraph> last_graph_;
+      shared_ptr<ConservationTracking> last_reasoner_;
+      boost::function<double(const Traxel&, const size_t)> last_detection_;
+      bool with_statistics_;
+      TrackingStatistics statistics_;
+      SolverProgressCallback progress_callback_;
+      double progress_interval_;
+      bool with_parallel_gmm_;
+      MergerCentersCachePtr merger_cache_;
+      CoordinateProviderPtr coordinate_provider_;
+      bool with_assignment_resolution_;
+      // edge length of the spatial tiles (0: no tiles) and width of their halo
+      double tile_size_, tile_halo_;
+      // prefix of the checkpoints to write, checkpoint to resume from ("": none)
+      std::string checkpoint_prefix_;
+      std::string resume_checkpoint_;
     };
 }
 
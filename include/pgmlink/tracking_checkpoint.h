@@ -0,0 +1,53 @@
+/**
+   @file
+   @ingroup tracking
+   @brief checkpoints of the hypotheses graph between the stages of ConsTracking
+*/
+
+#ifndef TRACKING_CHECKPOINT_H
+#define TRACKING_CHECKPOINT_H
+
+#include <string>
+
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/pgmlink_export.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+/**
+ * Stages of ConsTracking after which the graph is checkpointed and from
+ * which ConsTracking::operator() can be resumed.
+ */
+enum TrackingStage {
+  /// hypotheses graph with the arc distances
+  HypothesesStage = 1,
+  /// solved graph after conclude (active nodes, arcs and divisions)
+  SolvedStage = 2,
+  /// solved graph pruned to its active part, before the merger resolution
+  PreMergerStage = 3
+};
+
+/// <prefix>.<stage name>.pgmlckpt
+PGMLINK_EXPORT std::string checkpoint_filename(const std::string& prefix, TrackingStage stage);
+
+/**
+ * Write the graph in a boost binary archive: the node and arc arrays, the
+ * (timestep, id) of the traxel of every node and the columns of
+ * arc_distance, node_active, node_active2, arc_active and division_active,
+ * where the graph has them.
+ *
+ * The file is written next to filename and renamed when complete, so an
+ * interrupted run never leaves a truncated checkpoint behind.
+ */
+PGMLINK_EXPORT void save_checkpoint(const HypothesesGraph& g, TrackingStage stage, const std::string& filename);
+
+/**
+ * Add the checkpointed graph to the empty graph g and return its stage.
+ * The traxels of the nodes are looked up in ts, which has to hold the
+ * traxels the checkpoint was taken of.
+ */
+PGMLINK_EXPORT TrackingStage load_checkpoint(HypothesesGraph& g, const TraxelStore& ts, const std::string& filename);
+
+} /* namespace pgmlink */
+
+#endif /* TRACKING_CHECKPOINT_H */
@@ -0,0 +1,185 @@
+/**
+   @file
+   @ingroup tracking
+   @brief statistics of a tracking run
+*/
+
+#ifndef TRACKING_STATISTICS_H
+#define TRACKING_STATISTICS_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/function.hpp>
+
+#include "pgmlink/instrumentation.h"
+#include "pgmlink/pgmlink_export.h"
+
+namespace pgmlink {
+
+/// relative gap |objective - bound| / (1e-10 + |objective|), as CPLEX defines it
+PGMLINK_EXPORT double relative_gap( double objective, double bound );
+
+/**
+ * Progress of an anytime solve.
+ *
+ * Called with the seconds since the start of the solve, the energy of the
+ * best solution found so far and the lower bound. Returning false stops
+ * the solver; the best solution found so far is the result then.
+ */
+typedef boost::function<bool (double seconds, double objective, double bound)> SolverProgressCallback;
+
+/**
+ * Size and result of the model of a reasoner.
+ *
+ * A reasoner that solves several models (components or windows) reports
+ * the sums over its models.
+ */
+struct SolverStatistics {
+    PGMLINK_EXPORT SolverStatistics();
+
+    /// relative_gap() of objective and bound
+    PGMLINK_EXPORT double gap() const;
+
+    /// add the statistics of another model of the same problem
+    PGMLINK_EXPORT void add( const SolverStatistics& other );
+
+    size_t number_of_models;
+    size_t number_of_variables;
+    size_t number_of_factors;
+    /// sum of the number of label combinations of all factors
+    size_t number_of_table_entries;
+    size_t number_of_constraints;
+    /// wall time of adding the hard constraints, in seconds, if the reasoner collects statistics
+    double constraints_seconds;
+
+    /// energy of the solution and lower bound of the solver
+    double objective;
+    double bound;
+
+    /// "not solved", "optimal" (within the requested gap), "rounded" (a
+    /// repaired solution of the LP relaxation) or "time limit"; the worst
+    /// status of all models
+    std::string status;
+};
+
+/// resident set size of the process in kB; 0 where unknown
+PGMLINK_EXPORT long current_rss_kb();
+
+/// high water mark of the resident set size of the process in kB; 0 where unknown
+PGMLINK_EXPORT long peak_rss_kb();
+
+/// estimated bytes held by a part of a tracking run
+struct MemoryUsage {
+    MemoryUsage() : bytes(0) {}
+    MemoryUsage(const std::string& component, size_t bytes) : component(component), bytes(bytes) {}
+
+    std::string component;
+    size_t bytes;
+};
+
+/// resident set size of the process after a phase
+struct PhaseMemory {
+    PhaseMemory() : rss_kb(0), peak_rss_kb(0) {}
+
+    std::string phase;
+    long rss_kb;
+    long peak_rss_kb;
+};
+
+/**
+ * Where the memory of a tracking run goes.
+ *
+ * The components are estimates of the bytes in the data structures
+ * (traxel store, graph structure and every property map, opengm model by
+ * function type); the phases record the resident set size, which also
+ * covers what the estimates miss, e.g. the CPLEX instance built by
+ * formulate.
+ */
+struct MemoryReport {
+    /// add bytes to the component, which is appended if new
+    PGMLINK_EXPORT void add( const std::string& component, size_t bytes );
+    /// record the resident set size after phase
+    PGMLINK_EXPORT void record_phase( const std::string& phase );
+    /// sum of the component estimates
+    PGMLINK_EXPORT size_t total_bytes() const;
+    PGMLINK_EXPORT void write( std::ostream& os ) const;
+
+    std::vector<MemoryUsage> components;
+    std::vector<PhaseMemory> phases;
+};
+
+/**
+ * Wall times in seconds of the phases of a tracking run, the size of the
+ * hypotheses graph, the statistics of the solver and the memory report.
+ */
+struct TrackingStatistics {
+    PGMLINK_EXPORT TrackingStatistics();
+
+    double energy_seconds;
+    double hypotheses_seconds;
+    double formulate_seconds;
+    double infer_seconds;
+    double conclude_seconds;
+    double prune_seconds;
+    double merger_resolution_seconds;
+    double events_seconds;
+    double checkpoint_seconds;
+
+    size_t number_of_nodes;
+    size_t number_of_arcs;
+
+    SolverStatistics solver;
+    MemoryReport memory;
+};
+
+/**
+ * Wall clock for consecutive phases.
+ *
+ * A disabled timer never reads the clock, unless a trace is recorded (see
+ * instrumentation::start_trace()); stopping a named phase then adds it to
+ * the trace. With a memory report, the resident set size after every named
+ * phase is recorded as well.
+ */
+class PhaseTimer {
+    public:
+    explicit PhaseTimer(bool enabled = true, MemoryReport* memory = NULL)
+        : enabled_(enabled), traced_(instrumentation::tracing()), memory_(memory) {
+        if (enabled_ || traced_) {
+            start_ = boost::posix_time::microsec_clock::universal_time();
+        }
+    }
+
+    /// add the time since the construction or the last stop() to seconds and restart
+    void stop( double& seconds ) {
+        stop(seconds, NULL);
+    }
+
+    /// as stop(seconds), tracing the phase under its name
+    void stop( double& seconds, const char* phase ) {
+        if (enabled_ || traced_) {
+            const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+            if (enabled_) {
+                seconds += (now - start_).total_microseconds() / 1e6;
+            }
+            if (traced_ && phase != NULL) {
+                instrumentation::trace_event(phase, "tracking", start_, now);
+            }
+            start_ = now;
+        }
+        if (memory_ != NULL && phase != NULL) {
+            memory_->record_phase(phase);
+        }
+    }
+
+    private:
+    bool enabled_;
+    bool traced_;
+    MemoryReport* memory_;
+    boost::posix_time::ptime start_;
+};
+
+} /* namespace pgmlink */
+#endif /* TRACKING_STATISTICS_H */
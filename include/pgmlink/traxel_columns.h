@@ -0,0 +1,99 @@
+/**
+   @file
+   @ingroup tracking
+   @brief columnar view of a traxelstore
+*/
+
+#ifndef TRAXEL_COLUMNS_H
+#define TRAXEL_COLUMNS_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pgmlink/pgmlink_export.h"
+#include "pgmlink/traxels.h"
+
+namespace pgmlink {
+/**
+ * Columnar snapshot of a TraxelStore.
+ *
+ * Rows are the traxels in timestep order. Timesteps, ids and every
+ * requested feature are stored as contiguous columns; a feature column
+ * is a row major n_rows x width matrix, where width is the largest size
+ * of the feature in the store. Missing or shorter features are padded
+ * with NaN.
+ * The view is a copy: later changes of the store are not reflected.
+ */
+class TraxelColumns {
+ public:
+  class Column {
+   public:
+    Column(const std::string& name, size_t width) : name_(name), width_(width) {}
+
+    PGMLINK_EXPORT const std::string& name() const { return name_; }
+    PGMLINK_EXPORT size_t width() const { return width_; }
+    /// n_rows * width values, row major
+    PGMLINK_EXPORT const feature_type* data() const { return values_.empty() ? 0 : &values_[0]; }
+    PGMLINK_EXPORT const feature_type* row(size_t r) const { return data() + r * width_; }
+
+   private:
+    friend class TraxelColumns;
+    std::string name_;
+    size_t width_;
+    feature_array values_;
+  };
+
+  /// all features registered with the store
+  PGMLINK_EXPORT explicit TraxelColumns(const TraxelStore&);
+  PGMLINK_EXPORT TraxelColumns(const TraxelStore&, const std::vector<std::string>& feature_names);
+
+  PGMLINK_EXPORT size_t size() const { return ids_.size(); }
+  PGMLINK_EXPORT const std::vector<int>& timesteps() const { return timesteps_; }
+  PGMLINK_EXPORT const std::vector<unsigned int>& ids() const { return ids_; }
+  /// rows [first, second) of timestep
+  PGMLINK_EXPORT std::pair<size_t, size_t> rows(int timestep) const;
+
+  PGMLINK_EXPORT std::vector<std::string> feature_names() const;
+  PGMLINK_EXPORT bool has_column(const std::string& name) const { return index_.count(name) == 1; }
+  /// throws std::invalid_argument for unknown features
+  PGMLINK_EXPORT const Column& column(const std::string& name) const;
+
+ private:
+  void fill(const TraxelStore&, const std::vector<std::string>& feature_names);
+
+  std::vector<int> timesteps_;
+  std::vector<unsigned int> ids_;
+  std::vector<Column> columns_;
+  std::map<std::string, size_t> index_;
+};
+
+/**
+ * A row major n_rows x width matrix of feature values, as input of
+ * add_columns(). The values are not owned.
+ */
+struct FeatureColumnView {
+  FeatureColumnView(const std::string& name, const feature_type* data, size_t width)
+    : name(name), data(data), width(width) {}
+
+  std::string name;
+  const feature_type* data;
+  size_t width;
+};
+
+/**
+ * Add n traxels given as columns to ts, the inverse of TraxelColumns.
+ *
+ * Traxel i has timestep timesteps[i], id ids[i] and row i of every column
+ * as feature; a row of NaN only is a missing feature. The traxels of each
+ * timestep are built and interned in parallel and then inserted into the
+ * store. Throws std::invalid_argument if a (timestep, id) occurs twice or
+ * is already in the store; nothing is added then.
+ */
+PGMLINK_EXPORT TraxelStore& add_columns(TraxelStore& ts, size_t n, const int* timesteps, const unsigned int* ids,
+                                        const std::vector<FeatureColumnView>& features);
+
+} /* namespace pgmlink */
+
+#endif /* TRAXEL_COLUMNS_H */
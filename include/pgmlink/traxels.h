@@ -7,8 +7,15 @@
 #ifndef TRAXELS_H
 #define TRAXELS_H
 
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <map>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <iostream>
 #include <ostream>
 
@@ -19,6 +26,16 @@
 #include <boost/multi_index/composite_key.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/tracking.hpp>
+#include <boost/serialization/version.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/thread/shared_mutex.hpp>
 
 #include "pgmlink/pgmlink_export.h"
 
@@ -30,11 +47,186 @@ typedef float feature_type;
 typedef std::vector<feature_type> feature_array;
 typedef std::map<std::string,feature_array> FeatureMap;
 
+/**
+ * Interns feature names to integer slots.
+ *
+ * Slots are handed out in order of first appearance and never change
+ * afterwards, so the schema may be shared between stores and traxels
+ * and a slot stays valid as long as the schema lives. Interning and
+ * lookups are thread safe.
+ */
+class FeatureSchema {
+ public:
+  typedef size_t slot_type;
+  static const slot_type invalid_slot = static_cast<slot_type>(-1);
+
+  /// slot of name; registers the name if it is not known yet
+  PGMLINK_EXPORT slot_type intern(const std::string& name);
+  /// slot of name or invalid_slot if the name is not registered
+  PGMLINK_EXPORT slot_type slot(const std::string& name) const;
+  PGMLINK_EXPORT std::string name(slot_type slot) const;
+  PGMLINK_EXPORT size_t size() const;
+
+ private:
+  // lookups share the lock; only the registration of a new name is exclusive
+  mutable boost::shared_mutex mutex_;
+  std::map<std::string, slot_type> slots_;
+  std::deque<std::string> names_;
+};
+
+
+/**
+ * Read-only view of the values of one feature; converts to a copy.
+ */
+class FeatureValues {
+ public:
+  typedef feature_type value_type;
+  typedef const feature_type* const_iterator;
+  typedef const_iterator iterator;
+
+  FeatureValues() : data_(0), size_(0) {}
+  FeatureValues(const feature_type* data, size_t size) : data_(data), size_(size) {}
+  FeatureValues(const feature_array& values) : data_(values.empty() ? 0 : &values[0]), size_(values.size()) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const feature_type& operator[](size_t i) const { return data_[i]; }
+  const feature_type& front() const { return data_[0]; }
+  const feature_type& back() const { return data_[size_ - 1]; }
+  operator feature_array() const { return feature_array(begin(), end()); }
+
+ private:
+  const feature_type* data_;
+  size_t size_;
+};
+
+PGMLINK_EXPORT bool operator==(const FeatureValues&, const FeatureValues&);
+inline bool operator!=(const FeatureValues& a, const FeatureValues& b) { return !(a == b); }
+
+
+
+/**
+ * The features of a traxel, held in exactly one of two forms.
+ *
+ * Unpacked, they are a FeatureMap. Packed (see pack()), they are one
+ * contiguous buffer addressed by the slots of a FeatureSchema, read
+ * through feature(slot), and the map is freed.
+ *
+ * The const interface of a map is served in both forms; its iterators
+ * point to (name, FeatureValues) pairs. The writing members, operator[]
+ * and map(), unpack first, so edited features have to be packed again.
+ * The schema is kept for that.
+ */
+class TraxelFeatures {
+ public:
+  typedef std::string key_type;
+  typedef FeatureValues mapped_type;
+  typedef std::pair<std::string, FeatureValues> value_type;
+
+  class const_iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef TraxelFeatures::value_type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef const value_type& reference;
+
+    const_iterator() : features_(0), slot_(0) {}
+    reference operator*() const { return value_; }
+    pointer operator->() const { return &value_; }
+    PGMLINK_EXPORT const_iterator& operator++();
+    const_iterator operator++(int) { const_iterator old(*this); ++*this; return old; }
+    bool operator==(const const_iterator& other) const {
+      return features_ == other.features_ && it_ == other.it_ && slot_ == other.slot_;
+    }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+   private:
+    friend class TraxelFeatures;
+    // unpacked: it_ is the position and slot_ is 0; packed: the reverse
+    const_iterator(const TraxelFeatures* features, FeatureMap::const_iterator it, size_t slot);
+    void load();
+
+    const TraxelFeatures* features_;
+    FeatureMap::const_iterator it_;
+    size_t slot_;
+    value_type value_;
+  };
+  typedef const_iterator iterator;
+
+  TraxelFeatures() {}
+  TraxelFeatures(const FeatureMap& map) : map_(map) {}
+
+  // reads, in both forms
+  PGMLINK_EXPORT const_iterator begin() const;
+  PGMLINK_EXPORT const_iterator end() const;
+  PGMLINK_EXPORT const_iterator find(const std::string& name) const;
+  size_t count(const std::string& name) const { return find(name) != end() ? 1 : 0; }
+  PGMLINK_EXPORT size_t size() const;
+  bool empty() const { return begin() == end(); }
+  /// throws std::out_of_range if the feature is absent
+  PGMLINK_EXPORT FeatureValues at(const std::string& name) const;
+  /// a copy in the unpacked form
+  PGMLINK_EXPORT FeatureMap to_map() const;
+
+  // writes, unpacking first
+  feature_array& operator[](const std::string& name) { return map()[name]; }
+  /// the features as a map; unpacks them if packed
+  PGMLINK_EXPORT FeatureMap& map();
+  void clear() { map().clear(); }
+
+  // the packed form
+  /// pack into a buffer addressed by the slots of schema and free the map
+  PGMLINK_EXPORT void pack(const boost::shared_ptr<FeatureSchema>& schema);
+  bool packed() const { return !offsets_.empty(); }
+  /// schema of the last pack(), kept when unpacked
+  const boost::shared_ptr<FeatureSchema>& schema() const { return schema_; }
+  /// packed values at slot or 0 if absent (or unpacked)
+  const feature_type* feature(FeatureSchema::slot_type slot) const {
+    return feature_size(slot) ? &values_[offsets_[slot]] : 0;
+  }
+  size_t feature_size(FeatureSchema::slot_type slot) const {
+    return slot < offsets_.size() && slot + 1 < offsets_.size() ? offsets_[slot + 1] - offsets_[slot] : 0;
+  }
+  /// writable packed value; the feature has to be present
+  feature_type& packed_value(FeatureSchema::slot_type slot, size_t i) { return values_[offsets_[slot] + i]; }
+
+  /// estimated bytes held besides the object itself
+  PGMLINK_EXPORT size_t memory_bytes() const;
+
+ private:
+  friend class const_iterator;
+  bool present(FeatureSchema::slot_type slot) const { return slot < present_.size() && present_[slot]; }
+
+  // boost serialize: always as a FeatureMap
+  friend class boost::serialization::access;
+  template< typename Archive >
+    void save( Archive&, const unsigned int /*version*/ ) const;
+  template< typename Archive >
+    void load( Archive&, const unsigned int /*version*/ );
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+  FeatureMap map_;
+  boost::shared_ptr<FeatureSchema> schema_;
+  feature_array values_;
+  std::vector<unsigned int> offsets_;
+  std::vector<bool> present_; // tells empty features from absent ones
+};
+
+/// same features with the same values, in whichever form
+PGMLINK_EXPORT bool operator==(const TraxelFeatures&, const TraxelFeatures&);
+inline bool operator!=(const TraxelFeatures& a, const TraxelFeatures& b) { return !(a == b); }
+
 
 
 //
 // retrieve spatial coordinates from features
 //
+// Traxels share their locators; a shared locator is copied on write
+// (see Traxel::locator()), so it may be treated as immutable.
+//
 class Locator {
  public:
   PGMLINK_EXPORT Locator( std::string fn,
@@ -47,16 +239,21 @@ class Locator {
   PGMLINK_EXPORT virtual Locator* clone() = 0;
   PGMLINK_EXPORT virtual ~Locator() {};
 
-  PGMLINK_EXPORT virtual bool is_applicable(const FeatureMap& m) const { return m.count(feature_name_)==1; };
-  PGMLINK_EXPORT virtual double X(const FeatureMap&) const = 0;
-  PGMLINK_EXPORT virtual double Y(const FeatureMap&) const = 0;
-  PGMLINK_EXPORT virtual double Z(const FeatureMap&) const = 0;
+  PGMLINK_EXPORT virtual bool is_applicable(const TraxelFeatures& m) const { return m.count(feature_name_)==1; };
+  PGMLINK_EXPORT virtual double X(const TraxelFeatures&) const = 0;
+  PGMLINK_EXPORT virtual double Y(const TraxelFeatures&) const = 0;
+  PGMLINK_EXPORT virtual double Z(const TraxelFeatures&) const = 0;
+
+  /// same type, feature and scales
+  PGMLINK_EXPORT bool equivalent(const Locator& other) const;
+  /// the feature the coordinates are read from
+  const std::string& feature_name() const { return feature_name_; }
 
   double x_scale, y_scale, z_scale;
 
  protected:
   std::string feature_name_;
-  PGMLINK_EXPORT double coordinate_from(const FeatureMap&, size_t idx) const;
+  PGMLINK_EXPORT double coordinate_from(const TraxelFeatures&, size_t idx) const;
 
  private:
   // boost serialize
@@ -74,9 +271,9 @@ class ComLocator
   {}
   
   PGMLINK_EXPORT virtual ComLocator* clone() { return new ComLocator(*this); }
-  PGMLINK_EXPORT double X(const FeatureMap& m) const { return x_scale * coordinate_from(m, 0); }
-  PGMLINK_EXPORT double Y(const FeatureMap& m) const { return y_scale * coordinate_from(m, 1); }
-  PGMLINK_EXPORT double Z(const FeatureMap& m) const { return z_scale * coordinate_from(m, 2); }
+  PGMLINK_EXPORT double X(const TraxelFeatures& m) const { return x_scale * coordinate_from(m, 0); }
+  PGMLINK_EXPORT double Y(const TraxelFeatures& m) const { return y_scale * coordinate_from(m, 1); }
+  PGMLINK_EXPORT double Z(const TraxelFeatures& m) const { return z_scale * coordinate_from(m, 2); }
 
  private:
   // boost serialize
@@ -94,9 +291,9 @@ class ComCorrLocator
   {}
 
   PGMLINK_EXPORT virtual ComCorrLocator* clone() { return new ComCorrLocator(*this); }
-  PGMLINK_EXPORT double X(const FeatureMap& m) const { return x_scale * coordinate_from(m, 0); }
-  PGMLINK_EXPORT double Y(const FeatureMap& m) const { return y_scale * coordinate_from(m, 1); }
-  PGMLINK_EXPORT double Z(const FeatureMap& m) const { return z_scale * coordinate_from(m, 2); }
+  PGMLINK_EXPORT double X(const TraxelFeatures& m) const { return x_scale * coordinate_from(m, 0); }
+  PGMLINK_EXPORT double Y(const TraxelFeatures& m) const { return y_scale * coordinate_from(m, 1); }
+  PGMLINK_EXPORT double Z(const TraxelFeatures& m) const { return z_scale * coordinate_from(m, 2); }
 
  private:
   // boost serialize
@@ -114,9 +311,9 @@ class IntmaxposLocator
   {}
 
   PGMLINK_EXPORT virtual IntmaxposLocator* clone() { return new IntmaxposLocator(*this); }
-  PGMLINK_EXPORT double X(const FeatureMap& m) const { return x_scale * coordinate_from(m, 1); }
-  PGMLINK_EXPORT double Y(const FeatureMap& m) const { return y_scale * coordinate_from(m, 2); }
-  PGMLINK_EXPORT double Z(const FeatureMap& m) const { return z_scale * coordinate_from(m, 3); }
+  PGMLINK_EXPORT double X(const TraxelFeatures& m) const { return x_scale * coordinate_from(m, 1); }
+  PGMLINK_EXPORT double Y(const TraxelFeatures& m) const { return y_scale * coordinate_from(m, 2); }
+  PGMLINK_EXPORT double Z(const TraxelFeatures& m) const { return z_scale * coordinate_from(m, 3); }
 
  private:
   // boost serialize
@@ -134,22 +331,24 @@ class Traxel
 {
  public:
    // construction / assignment
-   //takes ownership of locator pointer
-  PGMLINK_EXPORT Traxel(unsigned int id = 0, int timestep = 0, FeatureMap fmap = FeatureMap(), Locator* l = new ComLocator(),
-		                ComCorrLocator* lc = new ComCorrLocator()) 
-  : Id(id), Timestep(timestep), features(fmap), locator_(l), corr_locator_(lc) 
-  {}
+   // takes ownership of the locator pointers; without locators the traxel
+   // shares the default ComLocator and ComCorrLocator of all traxels.
+   // Copies share the locators, too.
+  PGMLINK_EXPORT Traxel(unsigned int id = 0, int timestep = 0, FeatureMap fmap = FeatureMap(), Locator* l = 0,
+		                ComCorrLocator* lc = 0);
 
-  PGMLINK_EXPORT Traxel(const Traxel& other);
-  PGMLINK_EXPORT Traxel& operator=(const Traxel& other);
-  PGMLINK_EXPORT ~Traxel() { delete locator_; }
   PGMLINK_EXPORT Traxel& set_locator(Locator*);
-  PGMLINK_EXPORT Locator* locator() {return locator_;}
+  PGMLINK_EXPORT Traxel& set_locator(const boost::shared_ptr<Locator>&);
+  // copies a shared locator before handing it out (copy on write) and drops
+  // the coordinate cache, since the locator may be changed through the pointer
+  PGMLINK_EXPORT Locator* locator();
+  PGMLINK_EXPORT const Locator* locator() const { return locator_.get(); }
+  PGMLINK_EXPORT const boost::shared_ptr<Locator>& locator_ptr() const { return locator_; }
    
    // fields
    unsigned int Id; // id of connected component (aka "label")
    int Timestep; // traxel occured after
-   FeatureMap features;
+   TraxelFeatures features;
    
    // position according to locator
    PGMLINK_EXPORT double X() const;
@@ -164,17 +363,83 @@ class Traxel
    PGMLINK_EXPORT double distance_to(const Traxel& other) const;
    PGMLINK_EXPORT double distance_to_corr(const Traxel& other) const;
    PGMLINK_EXPORT double angle(const Traxel& leg1, const Traxel& leg2) const;
+   // the same in Dimensions = 2 or 3; the 2D kernels ignore Z(), so for
+   // planar data they give the results of the 3D ones with less work
+   template <int Dimensions> double distance_to(const Traxel& other) const;
+   template <int Dimensions> double distance_to_corr(const Traxel& other) const;
+   template <int Dimensions> double angle(const Traxel& leg1, const Traxel& leg2) const;
    friend std::ostream& operator<< (std::ostream &out, const Traxel &t);
 
+   // cached coordinates
+   // Materializes X(), Y(), Z() and their corrected counterparts once, so
+   // that the position getters do not go through the locators anymore.
+   // The cache is dropped by set_locator() and locator() and refreshed by
+   // intern_features(); after editing the position features directly
+   // call update_coordinate_cache(). Traxels without position features
+   // are left uncached.
+   PGMLINK_EXPORT Traxel& cache_coordinates();
+   PGMLINK_EXPORT Traxel& drop_coordinate_cache() { coordinates_cached_ = false; return *this; }
+   // recompute the cache if there is one
+   PGMLINK_EXPORT Traxel& update_coordinate_cache() { return coordinates_cached_ ? cache_coordinates() : *this; }
+   PGMLINK_EXPORT bool has_coordinate_cache() const { return coordinates_cached_; }
+
+   // interned features
+   // Packs the features into one contiguous buffer addressed by the slots
+   // of schema, which is then their only storage (see TraxelFeatures).
+   // set_feature() and set_feature_value() keep them packed (and the
+   // coordinate cache in sync); writing to 'features' directly unpacks
+   // them, and the traxel has to be interned again. TraxelStore interns
+   // on add() and replace().
+   PGMLINK_EXPORT Traxel& intern_features(const boost::shared_ptr<FeatureSchema>& schema);
+   PGMLINK_EXPORT Traxel& set_feature(const std::string& name, const feature_array& value);
+   // throws if the feature is absent or shorter than i + 1
+   PGMLINK_EXPORT Traxel& set_feature_value(const std::string& name, size_t i, feature_type value);
+   // drop all features but names and the position features of the
+   // locators; an interned traxel is interned again
+   PGMLINK_EXPORT Traxel& keep_features(const std::vector<std::string>& names);
+   PGMLINK_EXPORT const boost::shared_ptr<FeatureSchema>& feature_schema() const { return features.schema(); }
+   // interned feature at slot or 0 if the feature is absent (or the traxel not interned)
+   PGMLINK_EXPORT const feature_type* feature(FeatureSchema::slot_type slot) const { return features.feature(slot); }
+   PGMLINK_EXPORT size_t feature_size(FeatureSchema::slot_type slot) const { return features.feature_size(slot); }
+
+   // estimated bytes held by the traxel: the object and its features; the
+   // shared locators and schema are not counted
+   PGMLINK_EXPORT size_t memory_bytes() const;
+
  private:
    // boost serialize for Traxel datatype
    friend class boost::serialization::access;
    template< typename Archive >
-     void serialize( Archive&, const unsigned int /*version*/ );
+     void save( Archive&, const unsigned int /*version*/ ) const;
+   template< typename Archive >
+     void load( Archive&, const unsigned int version );
+   BOOST_SERIALIZATION_SPLIT_MEMBER()
 
-   Locator* locator_;
+   boost::shared_ptr<Locator> locator_;
 
-   ComCorrLocator* corr_locator_;
+   boost::shared_ptr<ComCorrLocator> corr_locator_;
+
+   bool coordinates_cached_;
+   double coordinates_[6]; // x y z x_corr y_corr z_corr
+ };
+
+ /**
+  * Reads one feature of many traxels. For traxels interned with schema the
+  * values come from the interned copy through a slot resolved once at
+  * construction; any other traxel (or a null schema) is read from its
+  * feature map. Immutable, so one reader may serve many threads.
+  */
+ class FeatureReader {
+ public:
+   PGMLINK_EXPORT FeatureReader(const std::string& name, const boost::shared_ptr<FeatureSchema>& schema);
+   /// values of the feature of t and their number in size; 0 if t has none
+   PGMLINK_EXPORT const feature_type* operator()(const Traxel& t, size_t& size) const;
+   PGMLINK_EXPORT const std::string& name() const { return name_; }
+
+ private:
+   std::string name_;
+   boost::shared_ptr<FeatureSchema> schema_;
+   FeatureSchema::slot_type slot_;
  };
 
  // compare by (time,id) (Traxels can be used as keys (for instance in a std::map) )
@@ -215,7 +480,137 @@ class Traxel
 	> 
      >
    > 
-   TraxelStore;
+   TraxelStoreBase;
+
+ /**
+  * Traxel key-value store.
+  * Behaves like the underlying multi index container and additionally
+  * owns the feature schema its traxels are interned with. Copies of a
+  * store share the schema.
+  *
+  * The bounding box and the number of traxels per timestep are cached
+  * and maintained by add() and replace(). The cache is keyed on a
+  * generation that every mutator of the container bumps. An index handed
+  * out by a non-const get<>() may change the store later without notice,
+  * so from then on the aggregates are computed on every request until
+  * invalidate_aggregates() declares the edits through the index done;
+  * read through a const store to keep the cache. Changing a traxel in
+  * place through a const_cast requires invalidate_aggregates(), too.
+  * Cache reads and writes are serialized, so the const interface may be
+  * used from several threads.
+  */
+ class TraxelStore : public TraxelStoreBase {
+ public:
+   PGMLINK_EXPORT TraxelStore() : schema_(new FeatureSchema), cache_coordinates_(false),
+     generation_(1), index_exposed_(false), counts_generation_(0), bounding_box_generation_(0) {}
+
+   PGMLINK_EXPORT FeatureSchema& feature_schema() { return *schema_; }
+   PGMLINK_EXPORT const FeatureSchema& feature_schema() const { return *schema_; }
+   PGMLINK_EXPORT const boost::shared_ptr<FeatureSchema>& feature_schema_ptr() const { return schema_; }
+
+   /// (re)intern the features of all traxels in the store
+   PGMLINK_EXPORT void intern_features();
+
+   /// cache the coordinates of all traxels, including those added later
+   PGMLINK_EXPORT void cache_coordinates();
+   /// drop all coordinate caches and stop caching on add
+   PGMLINK_EXPORT void drop_coordinate_caches();
+   PGMLINK_EXPORT bool caches_coordinates() const { return cache_coordinates_; }
+
+   /// registered locator equivalent to l (registering l if there is none)
+   PGMLINK_EXPORT const boost::shared_ptr<Locator>& shared_locator(const boost::shared_ptr<Locator>& l);
+   /// let all traxels in the store share the registered locators
+   PGMLINK_EXPORT void share_locators();
+   /// number of distinct locators
+   PGMLINK_EXPORT size_t n_locators() const { return locators_.size(); }
+
+   /// lt lx ly lz ut ux uy uz (all zero for an empty store)
+   PGMLINK_EXPORT std::vector<double> bounding_box() const;
+   /// number of traxels per timestep
+   PGMLINK_EXPORT std::map<int, size_t> timestep_counts() const;
+   /// drop the aggregates; ends the suspension by a non-const get<>()
+   PGMLINK_EXPORT void invalidate_aggregates();
+
+   // the container interface, dropping the aggregates on every mutation
+   template<typename Tag>
+     typename TraxelStoreBase::index<Tag>::type& get() {
+       expose_index();
+       return TraxelStoreBase::get<Tag>();
+     }
+   template<typename Tag>
+     const typename TraxelStoreBase::index<Tag>::type& get() const { return TraxelStoreBase::get<Tag>(); }
+
+   std::pair<iterator, bool> insert(const Traxel& t) { drop_aggregates(); return TraxelStoreBase::insert(t); }
+   iterator insert(iterator position, const Traxel& t) {
+     drop_aggregates();
+     return TraxelStoreBase::insert(position, t);
+   }
+   template<typename InputIt>
+     void insert(InputIt first, InputIt last) { drop_aggregates(); TraxelStoreBase::insert(first, last); }
+   iterator erase(iterator position) { drop_aggregates(); return TraxelStoreBase::erase(position); }
+   size_type erase(int timestep) { drop_aggregates(); return TraxelStoreBase::erase(timestep); }
+   iterator erase(iterator first, iterator last) { drop_aggregates(); return TraxelStoreBase::erase(first, last); }
+   bool replace(iterator position, const Traxel& t) { drop_aggregates(); return TraxelStoreBase::replace(position, t); }
+   template<typename Modifier>
+     bool modify(iterator position, Modifier mod) { drop_aggregates(); return TraxelStoreBase::modify(position, mod); }
+   template<typename Modifier, typename Rollback>
+     bool modify(iterator position, Modifier mod, Rollback back) {
+       drop_aggregates();
+       return TraxelStoreBase::modify(position, mod, back);
+     }
+   void clear() { drop_aggregates(); TraxelStoreBase::clear(); }
+
+ private:
+   friend TraxelStore& add(TraxelStore&, const Traxel&);
+   friend bool add_interned(TraxelStore&, const Traxel&);
+   friend bool replace(TraxelStore&, iterator, const Traxel&);
+   // incremental maintenance of the aggregates
+   void aggregate_added(const Traxel&);
+   void aggregate_replaced(int old_timestep, const Traxel&);
+   // bump the generation; keeps a suspension by expose_index()
+   PGMLINK_EXPORT void drop_aggregates();
+   // suspend the cache while the caller holds a mutable index
+   PGMLINK_EXPORT void expose_index();
+
+   // boost serialize; archive layout is that of the plain container
+   friend class boost::serialization::access;
+   template< typename Archive >
+     void serialize( Archive&, const unsigned int /*version*/ );
+
+   boost::shared_ptr<FeatureSchema> schema_;
+   bool cache_coordinates_;
+   std::vector<boost::shared_ptr<Locator> > locators_;
+
+   // computed on request and valid while their generation is current;
+   // guarded by the critical section pgmlink_traxelstore_aggregates
+   unsigned long generation_;
+   bool index_exposed_;
+   mutable unsigned long counts_generation_;
+   mutable std::map<int, size_t> counts_;
+   mutable unsigned long bounding_box_generation_;
+   mutable std::vector<double> bounding_box_;
+ };
+
+ /**
+  * Caches the coordinates of a store for the lifetime of the scope. A
+  * store that did not cache coordinates before drops the caches again on
+  * exit, so that later direct edits of its features are not shadowed by
+  * stale positions.
+  */
+ class CoordinateCacheScope : private boost::noncopyable {
+ public:
+   explicit CoordinateCacheScope(TraxelStore& ts) : ts_(ts), was_caching_(ts.caches_coordinates()) {
+     if(!was_caching_) ts_.cache_coordinates();
+   }
+   ~CoordinateCacheScope() {
+     if(!was_caching_) ts_.drop_coordinate_caches();
+   }
+
+ private:
+   TraxelStore& ts_;
+   const bool was_caching_;
+ };
+
  typedef PGMLINK_EXPORT TraxelStore::index<by_timestep>::type
    TraxelStoreByTimestep;
  typedef PGMLINK_EXPORT TraxelStore::index<by_timeid>::type
@@ -230,6 +625,9 @@ class Traxel
   */
  PGMLINK_EXPORT std::vector<double> bounding_box(const TraxelStore&);
 
+ // timesteps, earliest and latest timestep are served from the cached
+ // timestep counts; the latter two throw for an empty store
+
  // timesteps
  PGMLINK_EXPORT std::set<TraxelStoreByTimestep::key_type>
    timesteps(const TraxelStore&);
@@ -241,13 +639,44 @@ class Traxel
    latest_timestep(const TraxelStore&);
 
  // io
+ // add interns the features of the traxel with the schema of the store
+ // (and caches its coordinates if the store does so)
  PGMLINK_EXPORT TraxelStore& add(TraxelStore&, const Traxel&);
 
+ /// add a traxel that is interned with the schema of the store (and has
+ /// its coordinates cached if the store does so) without interning it
+ /// again, for traxels prepared in parallel; false on key collision
+ PGMLINK_EXPORT bool add_interned(TraxelStore&, const Traxel&);
+
+ /// replace the traxel at it like the index does, but intern the
+ /// replacement and maintain the aggregates; false on key collision
+ PGMLINK_EXPORT bool replace(TraxelStore&, TraxelStore::iterator it, const Traxel&);
+
  template<typename InputIt>
    TraxelStore& add(TraxelStore&, InputIt begin, InputIt end);
 
  std::vector<std::vector<Traxel> > nested_vec_from(const TraxelStore&);
 
+ /**
+  * Edit the features of the Traxels in timesteps [first, last] in place.
+  *
+  * The visitor is called as visitor(const Traxel&, FeatureMap&), where the
+  * map holds the unpacked features of the very Traxel. Only the features may be
+  * changed: Id and Timestep are the keys of the store and stay untouched,
+  * so there is no copy and no reindexing. Afterwards the Traxel is
+  * re-interned with the schema of the store.
+  * With parallel set, timesteps are processed concurrently by threads that
+  * each work with their own copy of the visitor (so members of the visitor
+  * may serve as per thread scratch space); exceptions are then rethrown as
+  * runtime_error.
+  */
+ template<typename FeatureVisitor>
+   void modify_features(TraxelStore&, FeatureVisitor visitor, int first, int last, bool parallel = false);
+
+ /// modify_features() over all timesteps
+ template<typename FeatureVisitor>
+   void modify_features(TraxelStore&, FeatureVisitor visitor, bool parallel = false);
+
  /** 
   * Filter by field of fiew. 
   * This function adds Traxels from in to out, that are contained in the field of fiew.
@@ -256,6 +685,9 @@ class Traxel
  class FieldOfView;
  PGMLINK_EXPORT size_t filter_by_fov( const TraxelStore& in, TraxelStore& out, const FieldOfView& );
 
+ /// estimated bytes held by the traxels of the store and its indices
+ PGMLINK_EXPORT size_t memory_bytes( const TraxelStore& );
+
 
 
 /**/
@@ -279,14 +711,85 @@ void IntmaxposLocator::serialize( Archive& ar, const unsigned int /*version*/ )
 }
 
 template< typename Archive >
-void Traxel::serialize( Archive& ar, const unsigned int /*version*/ ) {
+void TraxelFeatures::save( Archive& ar, const unsigned int /*version*/ ) const {
+  const FeatureMap map = to_map();
+  ar << map;
+}
+
+template< typename Archive >
+void TraxelFeatures::load( Archive& ar, const unsigned int /*version*/ ) {
+  FeatureMap map;
+  ar >> map;
+  *this = TraxelFeatures(map);
+}
+
+template< typename Archive >
+void Traxel::save( Archive& ar, const unsigned int /*version*/ ) const {
+  ar.template register_type<ComLocator>();
+  ar.template register_type<IntmaxposLocator>();
+
+  ar << Id;
+  ar << Timestep;
+  ar << features;
+  ar << locator_;
+}
+
+template< typename Archive >
+void Traxel::load( Archive& ar, const unsigned int version ) {
   ar.template register_type<ComLocator>();
   ar.template register_type<IntmaxposLocator>();
 
-  ar & Id;
-  ar & Timestep;
-  ar & features;
-  ar & locator_;
+  ar >> Id;
+  ar >> Timestep;
+  ar >> features;
+  if(version == 0) {
+    // every traxel owned a plain locator pointer
+    Locator* l = 0;
+    ar >> l;
+    locator_.reset(l);
+  } else {
+    ar >> locator_;
+  }
+  coordinates_cached_ = false;
+}
+
+template <int Dimensions>
+double Traxel::distance_to(const Traxel& other) const {
+  BOOST_STATIC_ASSERT(Dimensions == 2 || Dimensions == 3);
+  const double dx = other.X() - X();
+  const double dy = other.Y() - Y();
+  if(Dimensions == 2) {
+    return std::sqrt(dx*dx + dy*dy);
+  }
+  const double dz = other.Z() - Z();
+  return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+template <int Dimensions>
+double Traxel::distance_to_corr(const Traxel& other) const {
+  BOOST_STATIC_ASSERT(Dimensions == 2 || Dimensions == 3);
+  const double dx = other.X() - X_corr();
+  const double dy = other.Y() - Y_corr();
+  if(Dimensions == 2) {
+    return std::sqrt(dx*dx + dy*dy);
+  }
+  const double dz = other.Z() - Z_corr();
+  return std::sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+template <int Dimensions>
+double Traxel::angle(const Traxel& leg1, const Traxel& leg2) const {
+  BOOST_STATIC_ASSERT(Dimensions == 2 || Dimensions == 3);
+  const double x0 = X(), y0 = Y();
+  const double dx1 = leg1.X() - x0, dy1 = leg1.Y() - y0;
+  const double dx2 = leg2.X() - x0, dy2 = leg2.Y() - y0;
+  if(Dimensions == 2) {
+    return std::acos((dx1*dx2 + dy1*dy2) / (std::sqrt(dx1*dx1 + dy1*dy1) * std::sqrt(dx2*dx2 + dy2*dy2)));
+  }
+  const double z0 = Z();
+  const double dz1 = leg1.Z() - z0, dz2 = leg2.Z() - z0;
+  return std::acos((dx1*dx2 + dy1*dy2 + dz1*dz2) /
+                   (std::sqrt(dx1*dx1 + dy1*dy1 + dz1*dz1) * std::sqrt(dx2*dx2 + dy2*dy2 + dz2*dz2)));
 }
 
 template<typename InputIterator>
@@ -300,11 +803,104 @@ Traxels traxel_map_from_traxel_sequence(InputIterator begin, InputIterator end)
 
 template<typename InputIt>
   TraxelStore& add(TraxelStore& ts, InputIt begin, InputIt end) {
-  ts.get<by_timestep>().insert(begin, end);
+  for(; begin != end; ++begin) {
+    add(ts, *begin);
+  }
   return ts;
 }
 
+namespace detail {
+template<typename FeatureVisitor>
+void modify_features_in(TraxelStore& ts, FeatureVisitor& visitor,
+                        TraxelStoreByTimestep::iterator begin, TraxelStoreByTimestep::iterator end) {
+  for(; begin != end; ++begin) {
+    // Written in place instead of through TraxelStore::modify(): the keys
+    // of both indices are Id and Timestep, which the visitor cannot reach
+    // (it gets a const Traxel&) and intern_features() does not touch. So
+    // the index nodes stay valid, and timesteps may be processed
+    // concurrently because every thread writes its own elements only.
+    // Keep this in sync with the index definitions of TraxelStoreBase.
+    Traxel& t = const_cast<Traxel&>(*begin);
+    visitor(static_cast<const Traxel&>(t), t.features.map());
+    t.intern_features(ts.feature_schema_ptr());
+  }
+}
+} /* namespace detail */
+
+template<typename FeatureVisitor>
+void modify_features(TraxelStore& ts, FeatureVisitor visitor, int first, int last, bool parallel) {
+  // positions may change; the aggregates are dropped after the edits
+  TraxelStoreBase& base = ts;
+  TraxelStoreByTimestep& traxels_by_timestep = base.get<by_timestep>();
+  TraxelStoreByTimestep::iterator it = traxels_by_timestep.lower_bound(first);
+  TraxelStoreByTimestep::iterator end = traxels_by_timestep.upper_bound(last);
+  if(!parallel) {
+    try {
+      detail::modify_features_in(ts, visitor, it, end);
+    } catch(...) {
+      ts.invalidate_aggregates();
+      throw;
+    }
+    ts.invalidate_aggregates();
+    return;
+  }
+
+  // split into timesteps
+  std::vector<std::pair<TraxelStoreByTimestep::iterator, TraxelStoreByTimestep::iterator> > ranges;
+  while(it != end) {
+    TraxelStoreByTimestep::iterator next = traxels_by_timestep.upper_bound(it->Timestep);
+    ranges.push_back(std::make_pair(it, next));
+    it = next;
+  }
+
+  std::string error;
+  #pragma omp parallel
+  {
+    FeatureVisitor local_visitor(visitor);
+    #pragma omp for schedule(dynamic)
+    for(int i = 0; i < static_cast<int>(ranges.size()); ++i) {
+      try {
+        detail::modify_features_in(ts, local_visitor, ranges[i].first, ranges[i].second);
+      } catch(std::exception& e) {
+        #pragma omp critical(pgmlink_modify_features)
+        {
+          if(error.empty()) error = e.what();
+        }
+      }
+    }
+  }
+  ts.invalidate_aggregates();
+  if(!error.empty()) {
+    throw std::runtime_error(error);
+  }
+}
+
+template<typename FeatureVisitor>
+void modify_features(TraxelStore& ts, FeatureVisitor visitor, bool parallel) {
+  if(ts.empty()) {
+    return;
+  }
+  modify_features(ts, visitor, earliest_timestep(ts), latest_timestep(ts), parallel);
+}
+
+template< typename Archive >
+void TraxelStore::serialize( Archive& ar, const unsigned int /*version*/ ) {
+  ar & boost::serialization::base_object<TraxelStoreBase>(*this);
+  if(Archive::is_loading::value) {
+    invalidate_aggregates();
+    share_locators();
+    intern_features();
+  }
+}
+
 } /* namespace pgmlink */
 
+// version 1: shared locators
+BOOST_CLASS_VERSION(pgmlink::Traxel, 1)
+
+// keep archives of TraxelStore compatible with the former plain container typedef
+BOOST_CLASS_IMPLEMENTATION(pgmlink::TraxelStore, boost::serialization::object_serializable)
+BOOST_CLASS_TRACKING(pgmlink::TraxelStore, boost::serialization::track_never)
+
 
 #endif /* TRAXELS_H */
@@ -1,11 +1,15 @@
 #define PY_ARRAY_UNIQUE_SYMBOL pgmlink_pyarray
 #define NO_IMPORT_ARRAY
 
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/python.hpp>
 #include <boost/python/iterator.hpp>
 #include <boost/python/return_internal_reference.hpp>
@@ -14,6 +18,7 @@
 #include <lemon/core.h>
 
 #include "../include/pgmlink/hypotheses.h"
+#include <vigra/numpy_array.hxx>
 
 using namespace pgmlink;
 using namespace boost::python;
@@ -81,6 +86,101 @@ struct IterableValueMap_ValueIterator {
 
 
 
+//
+// graph as arrays
+//
+// owning numpy array of the values
+template <typename T>
+object numpy_array_of(const std::vector<T>& values, int typenum) {
+  npy_intp n = values.size();
+  PyObject* array = PyArray_SimpleNew(1, &n, typenum);
+  if(!array) {
+    throw_error_already_set();
+  }
+  if(n > 0) {
+    memcpy(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)), &values[0], n * sizeof(T));
+  }
+  return object(handle<>(array));
+}
+
+template <typename PROPERTY, typename ITEM, typename T>
+void add_property_array(dict& arrays, const HypothesesGraph& g, const std::vector<ITEM>& items, int typenum) {
+  const typename property_map<PROPERTY, HypothesesGraph::base_graph>::type& m = g.get(PROPERTY());
+  std::vector<T> values;
+  values.reserve(items.size());
+  for(typename std::vector<ITEM>::const_iterator it = items.begin(); it != items.end(); ++it) {
+    values.push_back(static_cast<T>(m[*it]));
+  }
+  arrays[property_map<PROPERTY, HypothesesGraph::base_graph>::name] = numpy_array_of(values, typenum);
+}
+
+// Nodes are numbered in NodeIt order and arcs in ArcIt order, like
+// to_arrays(); the arrays are filled in one pass over the graph.
+dict graph_to_arrays(const HypothesesGraph& g, object node_properties, object arc_properties) {
+  std::vector<HypothesesGraph::Node> nodes;
+  std::vector<int> node_timesteps;
+  HypothesesGraph::NodeMap<int> number(g, -1);
+  const HypothesesGraph::node_timestep_map& timestep_m = g.get(node_timestep());
+  for(HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+    number[n] = static_cast<int>(nodes.size());
+    nodes.push_back(n);
+    node_timesteps.push_back(timestep_m[n]);
+  }
+
+  std::vector<HypothesesGraph::Arc> arcs;
+  std::vector<int> sources, targets;
+  arcs.reserve(lemon::countArcs(g));
+  sources.reserve(arcs.capacity());
+  targets.reserve(arcs.capacity());
+  for(HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+    arcs.push_back(a);
+    sources.push_back(number[g.source(a)]);
+    targets.push_back(number[g.target(a)]);
+  }
+
+  dict arrays;
+  arrays["node_timestep"] = numpy_array_of(node_timesteps, NPY_INT);
+  arrays["arc_source"] = numpy_array_of(sources, NPY_INT);
+  arrays["arc_target"] = numpy_array_of(targets, NPY_INT);
+  if(g.has_property(node_traxel())) {
+    const property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_m = g.get(node_traxel());
+    std::vector<unsigned int> ids;
+    ids.reserve(nodes.size());
+    for(std::vector<HypothesesGraph::Node>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+      ids.push_back(traxel_m[*n].Id);
+    }
+    arrays["node_traxel_id"] = numpy_array_of(ids, NPY_UINT);
+  }
+
+  for(int i = 0; i < len(node_properties); ++i) {
+    const std::string name = extract<std::string>(node_properties[i]);
+    if(name == "node_active") {
+      add_property_array<node_active, HypothesesGraph::Node, npy_bool>(arrays, g, nodes, NPY_BOOL);
+    } else if(name == "node_active2") {
+      add_property_array<node_active2, HypothesesGraph::Node, boost::uint64_t>(arrays, g, nodes, NPY_UINT64);
+    } else if(name == "division_active") {
+      add_property_array<division_active, HypothesesGraph::Node, npy_bool>(arrays, g, nodes, NPY_BOOL);
+    } else {
+      throw std::invalid_argument("HypothesesGraph.to_arrays(): unsupported node property " + name);
+    }
+  }
+  for(int i = 0; i < len(arc_properties); ++i) {
+    const std::string name = extract<std::string>(arc_properties[i]);
+    if(name == "arc_distance") {
+      add_property_array<arc_distance, HypothesesGraph::Arc, double>(arrays, g, arcs, NPY_DOUBLE);
+    } else if(name == "arc_active") {
+      add_property_array<arc_active, HypothesesGraph::Arc, npy_bool>(arrays, g, arcs, NPY_BOOL);
+    } else if(name == "arc_vol_ratio") {
+      add_property_array<arc_vol_ratio, HypothesesGraph::Arc, double>(arrays, g, arcs, NPY_DOUBLE);
+    } else if(name == "traxel_arc_id") {
+      add_property_array<traxel_arc_id, HypothesesGraph::Arc, int>(arrays, g, arcs, NPY_INT);
+    } else {
+      throw std::invalid_argument("HypothesesGraph.to_arrays(): unsupported arc property " + name);
+    }
+  }
+  return arrays;
+}
+
 void export_hypotheses() {
   class_<HypothesesGraph::Arc>("Arc");
   class_<HypothesesGraph::ArcIt>("ArcIt");
@@ -155,6 +255,11 @@ void export_hypotheses() {
 	 return_internal_reference<>())
     .def("getNodeTraxelMap", &getNodeTraxelMap,
 	 return_internal_reference<>())
+    .def("to_arrays", &graph_to_arrays,
+         (arg("node_properties") = boost::python::list(), arg("arc_properties") = boost::python::list()),
+         "dict of numpy arrays: node_timestep, node_traxel_id (with traxels), arc_source and arc_target "
+         "(node numbers in node order) and the requested properties (node_active, node_active2, "
+         "division_active; arc_distance, arc_active, arc_vol_ratio, traxel_arc_id)")
     .def_pickle(HypothesesGraph_pickle_suite())
     ;
 
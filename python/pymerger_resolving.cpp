@@ -1,6 +1,10 @@
 #define PY_ARRAY_UNIQUE_SYMBOL pgmlink_pyarray
 #define NO_IMPORT_ARRAY
 
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
 #include <boost/python.hpp>
 #include "pgmlink/merger_resolving.h"
 
@@ -18,7 +22,7 @@ using namespace boost::python;
 // -> shape = [n_features, n_samples]
 
 template<typename T>
-void gmm_priors_and_centers_numpy_to_arma(const vigra::NumpyArray<2, T>& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight) {
+void gmm_priors_and_centers_numpy_to_arma(const vigra::NumpyArray<2, T>& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight, int patience) {
   arma::mat d(data.shape()[0], data.shape()[1]);
   assert((unsigned)ndim == d.n_rows);
   arma::mat::iterator dest_it = d.begin();
@@ -26,7 +30,7 @@ void gmm_priors_and_centers_numpy_to_arma(const vigra::NumpyArray<2, T>& data, f
   for (; src_it != data.end(); ++src_it, ++dest_it) {
     *dest_it = *src_it;
   }
-  gmm_priors_and_centers_arma(d, priors, centers, k_max, ndim, regularization_weight);
+  gmm_priors_and_centers_arma(d, priors, centers, k_max, ndim, regularization_weight, patience);
 }
 
 
@@ -57,13 +61,44 @@ void py_extract_coordinates(PyTimestepIdCoordinateMap coordinates,
 }
 
 
+void py_save_coordinates(PyTimestepIdCoordinateMap coordinates, const std::string& filename) {
+  if (!coordinates.get()) {
+    throw std::runtime_error("save_coordinates(): coordinate map not initialized");
+  }
+  save_coordinates(*coordinates.get(), filename);
+}
+
+void py_save_merger_cache(const MergerCentersCache& cache, const std::string& filename) {
+  std::ofstream os(filename.c_str(), std::ios::binary);
+  if (!os) {
+    throw std::runtime_error("MergerCentersCache.save(): cannot open " + filename);
+  }
+  cache.write(os);
+}
+
+void py_load_merger_cache(MergerCentersCache& cache, const std::string& filename) {
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  if (!is) {
+    throw std::runtime_error("MergerCentersCache.load(): cannot open " + filename);
+  }
+  cache.read(is);
+}
+
+
+// keywords of gmm_priors_and_centers; patience 0 fits all k
+boost::python::detail::keywords<7> gmm_priors_and_centers_args() {
+  return (arg("data"), arg("priors"), arg("centers"), arg("k_max"), arg("ndim"),
+          arg("regularization_weight"), arg("patience") = 0);
+}
+
+
 void export_gmm() {
-  def("gmm_priors_and_centers", gmm_priors_and_centers);
-  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<double>);
-  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<unsigned char>);
-  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<float>);
-  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<unsigned>);
-  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<int>);
+  def("gmm_priors_and_centers", gmm_priors_and_centers, gmm_priors_and_centers_args());
+  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<double>, gmm_priors_and_centers_args());
+  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<unsigned char>, gmm_priors_and_centers_args());
+  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<float>, gmm_priors_and_centers_args());
+  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<unsigned>, gmm_priors_and_centers_args());
+  def("gmm_priors_and_centers", gmm_priors_and_centers_numpy_to_arma<int>, gmm_priors_and_centers_args());
 
   class_<PyTimestepIdCoordinateMap>("TimestepIdCoordinateMap")
       .def("initialize", &PyTimestepIdCoordinateMap::initialize)
@@ -72,6 +107,21 @@ void export_gmm() {
 
   class_<TimestepIdCoordinateMapPtr>("TimestepIdCoordinateMapPtr");
 
+  class_<CoordinateProvider, CoordinateProviderPtr, boost::noncopyable>("CoordinateProvider", no_init);
+  class_<MappedCoordinateFile, boost::shared_ptr<MappedCoordinateFile>, bases<CoordinateProvider>, boost::noncopyable>(
+      "MappedCoordinateFile", init<std::string>(args("filename")))
+      .def("size", &MappedCoordinateFile::size)
+      ;
+  implicitly_convertible<boost::shared_ptr<MappedCoordinateFile>, CoordinateProviderPtr>();
+  def("save_coordinates", &py_save_coordinates, args("coordinates", "filename"));
+
+  class_<MergerCentersCache, MergerCentersCachePtr>("MergerCentersCache")
+      .def("save", &py_save_merger_cache, args("filename"))
+      .def("load", &py_load_merger_cache, args("filename"))
+      .def("size", &MergerCentersCache::size)
+      .def("clear", &MergerCentersCache::clear)
+      ;
+
   def("extract_coordinates", vigra::registerConverters(&py_extract_coordinates<2, vigra::UInt8>));
   def("extract_coordinates", vigra::registerConverters(&py_extract_coordinates<3, vigra::UInt8>));
 
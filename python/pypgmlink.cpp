@@ -5,7 +5,20 @@
 #include <iostream>
 #include <vector>
 #include <complex>
+#include <sstream>
+#include <string>
 
+#include "../include/pgmlink/instrumentation.h"
+#include "../include/pgmlink/log.h"
+
+
+namespace {
+std::string instrumentation_report() {
+    std::ostringstream os;
+    pgmlink::instrumentation::report(os);
+    return os.str();
+}
+}
 
 //forward declarations
 void export_field_of_view();
@@ -23,4 +36,18 @@ BOOST_PYTHON_MODULE( pgmlink )
     export_track();
     export_traxels();
     export_gmm();
+
+    boost::python::def("set_async_logging", &pgmlink::set_async_logging,
+                       (boost::python::arg("enable"), boost::python::arg("flush_interval_seconds") = 0.05),
+                       "write the log messages in batches from a background thread");
+    boost::python::def("flush_log", &pgmlink::flush_log);
+
+    boost::python::def("instrumentation_enabled", &pgmlink::instrumentation::enabled,
+                       "whether pgmlink was built with WITH_INSTRUMENTATION");
+    boost::python::def("instrumentation_report", &instrumentation_report,
+                       "timers and counters of all threads since the last reset");
+    boost::python::def("reset_instrumentation", &pgmlink::instrumentation::reset);
+    boost::python::def("start_trace", &pgmlink::instrumentation::start_trace, (boost::python::arg("filename")),
+                       "record the tracking phases of all threads as Chrome trace-event JSON");
+    boost::python::def("stop_trace", &pgmlink::instrumentation::stop_trace, "write the trace started by start_trace");
 }
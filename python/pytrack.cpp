@@ -2,10 +2,23 @@
 #define NO_IMPORT_ARRAY
 #define BOOST_PYTHON_MAX_ARITY 25
 
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "../include/pgmlink/binary_events.h"
+#include "../include/pgmlink/event_columns.h"
+#include "../include/pgmlink/temporal_chunks.h"
 #include "../include/pgmlink/tracking.h"
 #include "../include/pgmlink/field_of_view.h"
+#include <vigra/numpy_array.hxx>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/utility.hpp>
 #include <boost/python/suite/indexing/map_indexing_suite.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
@@ -31,6 +44,21 @@ vector<vector<Event> > pythonChaingraphTracking(ChaingraphTracking& tr, TraxelSt
 	return result;
 }
 
+template <class NearestNeighborTracking>
+vector<vector<Event> > pythonNNTracking(NearestNeighborTracking& tr, TraxelStore& ts) {
+	vector<vector<Event> > result = std::vector<std::vector<Event> >(0);
+	// release the GIL
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		result = tr(ts);
+	} catch (std::exception& e) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return result;
+}
+
 vector<vector<Event> > pythonConsTracking(ConsTracking& tr, TraxelStore& ts, TimestepIdCoordinateMapPtr& coordinates) {
 	vector<vector<Event> > result = std::vector<std::vector<Event> >(0);
 	// release the GIL
@@ -45,6 +73,370 @@ vector<vector<Event> > pythonConsTracking(ConsTracking& tr, TraxelStore& ts, Tim
 	return result;
 }
 
+vector<vector<Event> > pythonConsTrackingReweight(ConsTracking& tr, double division_weight, double transition_weight,
+                                                  double disappearance_cost, double appearance_cost, double forbidden_cost) {
+	vector<vector<Event> > result = std::vector<std::vector<Event> >(0);
+	// release the GIL
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		result = tr.reweight(division_weight, transition_weight, disappearance_cost, appearance_cost, forbidden_cost);
+	} catch (std::exception& e) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return result;
+}
+
+// calls a python callable from the solver, which runs without the GIL;
+// copies share the callable, so copying never touches its reference count
+struct PythonProgressCallback {
+	explicit PythonProgressCallback(object callable) : callable(new object(callable)) {}
+
+	bool operator()(double seconds, double objective, double bound) const {
+		PyGILState_STATE state = PyGILState_Ensure();
+		bool go_on = false;
+		try {
+			go_on = extract<bool>((*callable)(seconds, objective, bound));
+		} catch (error_already_set&) {
+			// a raising callback stops the solver
+			PyErr_Print();
+		}
+		PyGILState_Release(state);
+		return go_on;
+	}
+
+	boost::shared_ptr<object> callable;
+};
+
+// configurations is any sequence of ConsTrackingParameters
+vector<vector<vector<Event> > > pythonConsTrackingConfigurations(ConsTracking& tr, TraxelStore& ts, object sequence) {
+	vector<ConsTrackingParameters> configurations;
+	for (int i = 0; i < len(sequence); ++i) {
+		configurations.push_back(extract<ConsTrackingParameters>(sequence[i]));
+	}
+	vector<vector<vector<Event> > > result;
+	// release the GIL
+	Py_BEGIN_ALLOW_THREADS
+	try {
+		result = tr.track_configurations(ts, configurations);
+	} catch (std::exception& e) {
+		Py_BLOCK_THREADS
+		throw;
+	}
+	Py_END_ALLOW_THREADS
+	return result;
+}
+
+template <typename TRACKING>
+void pythonSetProgressCallback(TRACKING& tr, object callable, double interval_seconds) {
+	if (callable.ptr() == Py_None) {
+		tr.set_progress_callback(SolverProgressCallback(), interval_seconds);
+	} else {
+		tr.set_progress_callback(PythonProgressCallback(callable), interval_seconds);
+	}
+}
+
+// structured numpy array with the fields timestep, ids (width values) and
+// energy, numpy's packed layout of these fields
+object events_table_array(const EventColumns::Table& table) {
+	const npy_intp n = table.size();
+	const size_t width = table.width();
+	const size_t ids_offset = sizeof(boost::int32_t);
+	const size_t energy_offset = ids_offset + width * sizeof(boost::uint64_t);
+	const size_t itemsize = energy_offset + sizeof(double);
+
+	boost::python::list names, formats, offsets;
+	names.append("timestep");
+	names.append("ids");
+	names.append("energy");
+	formats.append("i4");
+	formats.append(make_tuple("u8", make_tuple(width)));
+	formats.append("f8");
+	offsets.append(0);
+	offsets.append(ids_offset);
+	offsets.append(energy_offset);
+	dict description;
+	description["names"] = names;
+	description["formats"] = formats;
+	description["offsets"] = offsets;
+	description["itemsize"] = itemsize;
+	PyArray_Descr* descr = 0;
+	if (!PyArray_DescrConverter(description.ptr(), &descr)) {
+		throw_error_already_set();
+	}
+	// steals the reference to descr
+	PyObject* array = PyArray_NewFromDescr(&PyArray_Type, descr, 1, const_cast<npy_intp*>(&n), NULL, NULL, 0, NULL);
+	if (!array) {
+		throw_error_already_set();
+	}
+	object result = object(handle<>(array));
+
+	char* row = static_cast<char*>(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)));
+	const vector<boost::uint64_t> ids = table.ids();
+	for (npy_intp r = 0; r < n; ++r, row += itemsize) {
+		const boost::int32_t timestep = table.timesteps()[r];
+		memcpy(row, &timestep, sizeof(timestep));
+		if (width > 0) {
+			memcpy(row + ids_offset, &ids[r * width], width * sizeof(boost::uint64_t));
+		}
+		memcpy(row + energy_offset, &table.energies()[r], sizeof(double));
+	}
+	return result;
+}
+
+// dict of event type name to structured array, for the types with events
+dict pythonEventsArrays(const vector<vector<Event> >& events, int first_timestep) {
+	EventColumns columns(first_timestep);
+	columns.add(events);
+	const char* names[] = {"Move", "Division", "Appearance", "Disappearance", "Merger",
+	                       "ResolvedTo", "MultiFrameMove", "Void"};
+	dict result;
+	for (int type = Event::Move; type <= Event::Void; ++type) {
+		const EventColumns::Table& table = columns.table(static_cast<Event::EventType>(type));
+		if (table.size() > 0) {
+			result[names[type]] = events_table_array(table);
+		}
+	}
+	return result;
+}
+
+////
+//// class TrackingJob
+////
+// state shared by a job and its thread
+struct TrackingJobState {
+	TrackingJobState() : done(false), cancelled(false), seconds(0), objective(0), bound(0) {}
+
+	boost::mutex mutex;
+	boost::condition_variable finished;
+	bool done;
+	bool cancelled;
+	double seconds, objective, bound;
+	vector<vector<Event> > result;
+	std::string error;
+};
+
+// the progress callback of a job: records the state of the solver and stops
+// it once the job is cancelled
+struct TrackingJobProgress {
+	explicit TrackingJobProgress(boost::shared_ptr<TrackingJobState> state) : state(state) {}
+
+	bool operator()(double seconds, double objective, double bound) const {
+		boost::lock_guard<boost::mutex> lock(state->mutex);
+		state->seconds = seconds;
+		state->objective = objective;
+		state->bound = bound;
+		return !state->cancelled;
+	}
+
+	boost::shared_ptr<TrackingJobState> state;
+};
+
+struct ChaingraphTrackingRun {
+	vector<vector<Event> > operator()() const { return (*tracking)(*ts); }
+	ChaingraphTracking* tracking;
+	TraxelStore* ts;
+};
+
+struct ConsTrackingRun {
+	vector<vector<Event> > operator()() const { return (*tracking)(*ts, coordinates); }
+	ConsTracking* tracking;
+	TraxelStore* ts;
+	TimestepIdCoordinateMapPtr coordinates;
+};
+
+// body of the thread of a job, never touches python objects
+template <typename RUN>
+struct TrackingJobThread {
+	void operator()() const {
+		vector<vector<Event> > result;
+		std::string error;
+		bool cancelled;
+		{
+			boost::lock_guard<boost::mutex> lock(state->mutex);
+			cancelled = state->cancelled;
+		}
+		if (!cancelled) {
+			try {
+				result = run();
+			} catch (std::exception& e) {
+				error = e.what();
+			} catch (...) {
+				error = "unknown error";
+			}
+		}
+		// the tracking may be used synchronously again
+		run.tracking->set_progress_callback(SolverProgressCallback());
+
+		boost::lock_guard<boost::mutex> lock(state->mutex);
+		state->result.swap(result);
+		state->error = error;
+		state->done = true;
+		state->finished.notify_all();
+	}
+
+	RUN run;
+	boost::shared_ptr<TrackingJobState> state;
+};
+
+/**
+ * A tracking running in a thread of its own, started by start() of
+ * ConsTracking or ChaingraphTracking.
+ *
+ * The job keeps the tracking object and the traxel store alive; neither
+ * may be used otherwise until the job is done. Destroying a running job
+ * cancels it and waits for its thread.
+ */
+class TrackingJob : boost::noncopyable {
+ public:
+	TrackingJob(object tracking, object ts, boost::shared_ptr<TrackingJobState> state)
+		: tracking_(tracking), ts_(ts), state_(state) {}
+
+	~TrackingJob() {
+		// the thread was not started if start() threw
+		if (!thread_.joinable()) {
+			return;
+		}
+		cancel();
+		// the thread does not need the GIL, but other python threads may
+		Py_BEGIN_ALLOW_THREADS
+		thread_.join();
+		Py_END_ALLOW_THREADS
+	}
+
+	template <typename FUNCTOR>
+	void start(FUNCTOR f) {
+		thread_ = boost::thread(f);
+	}
+
+	bool done() const {
+		boost::lock_guard<boost::mutex> lock(state_->mutex);
+		return state_->done;
+	}
+
+	/// stops the solver at its next progress report; result() then raises
+	void cancel() {
+		boost::lock_guard<boost::mutex> lock(state_->mutex);
+		if (!state_->done) {
+			state_->cancelled = true;
+		}
+	}
+
+	/// (seconds, objective, bound) of the last progress report of the solver
+	tuple progress() const {
+		boost::lock_guard<boost::mutex> lock(state_->mutex);
+		return make_tuple(state_->seconds, state_->objective, state_->bound);
+	}
+
+	/// waits at most timeout_seconds, or until done if negative; true if done
+	bool wait(double timeout_seconds) {
+		bool done;
+		Py_BEGIN_ALLOW_THREADS
+		{
+			boost::unique_lock<boost::mutex> lock(state_->mutex);
+			if (timeout_seconds < 0) {
+				while (!state_->done) {
+					state_->finished.wait(lock);
+				}
+			} else {
+				const boost::system_time deadline = boost::get_system_time()
+					+ boost::posix_time::microseconds(static_cast<long>(timeout_seconds * 1e6));
+				while (!state_->done && state_->finished.timed_wait(lock, deadline)) {}
+			}
+			done = state_->done;
+		}
+		Py_END_ALLOW_THREADS
+		return done;
+	}
+
+	/// waits until done; raises the error of the tracking or if cancelled
+	vector<vector<Event> > result() {
+		wait(-1);
+		boost::lock_guard<boost::mutex> lock(state_->mutex);
+		if (!state_->error.empty()) {
+			throw std::runtime_error(state_->error);
+		}
+		if (state_->cancelled) {
+			throw std::runtime_error("TrackingJob::result(): the job was cancelled");
+		}
+		return state_->result;
+	}
+
+ private:
+	object tracking_;
+	object ts_;
+	boost::shared_ptr<TrackingJobState> state_;
+	boost::thread thread_;
+};
+
+// replaces the progress callback of the tracking until the job is done
+template <typename TRACKING, typename RUN>
+boost::shared_ptr<TrackingJob> pythonStartTracking(object tracking, object ts, RUN run, double progress_interval) {
+	boost::shared_ptr<TrackingJobState> state(new TrackingJobState);
+	run.tracking = &extract<TRACKING&>(tracking)();
+	run.ts = &extract<TraxelStore&>(ts)();
+	run.tracking->set_progress_callback(TrackingJobProgress(state), progress_interval);
+
+	TrackingJobThread<RUN> body;
+	body.run = run;
+	body.state = state;
+	boost::shared_ptr<TrackingJob> job(new TrackingJob(tracking, ts, state));
+	try {
+		job->start(body);
+	} catch (...) {
+		run.tracking->set_progress_callback(SolverProgressCallback());
+		throw;
+	}
+	return job;
+}
+
+boost::shared_ptr<TrackingJob> pythonStartChaingraphTracking(object tracking, object ts, double progress_interval) {
+	return pythonStartTracking<ChaingraphTracking>(tracking, ts, ChaingraphTrackingRun(), progress_interval);
+}
+
+// coordinates is None or a TimestepIdCoordinateMapPtr
+boost::shared_ptr<TrackingJob> pythonStartConsTracking(object tracking, object ts, object coordinates,
+                                                       double progress_interval) {
+	ConsTrackingRun run;
+	if (coordinates.ptr() != Py_None) {
+		run.coordinates = extract<TimestepIdCoordinateMapPtr>(coordinates);
+	}
+	return pythonStartTracking<ConsTracking>(tracking, ts, run, progress_interval);
+}
+
+// component name -> estimated bytes
+dict pythonMemoryComponents(const MemoryReport& report) {
+	dict result;
+	for (vector<MemoryUsage>::const_iterator it = report.components.begin(); it != report.components.end(); ++it) {
+		result[it->component] = it->bytes;
+	}
+	return result;
+}
+
+// (phase, rss_kb, peak_rss_kb) in the order of the phases
+boost::python::list pythonMemoryPhases(const MemoryReport& report) {
+	boost::python::list result;
+	for (vector<PhaseMemory>::const_iterator it = report.phases.begin(); it != report.phases.end(); ++it) {
+		result.append(boost::python::make_tuple(it->phase, it->rss_kb, it->peak_rss_kb));
+	}
+	return result;
+}
+
+std::string pythonMemoryReportStr(const MemoryReport& report) {
+	std::ostringstream os;
+	report.write(os);
+	return os.str();
+}
+
+vector<vector<Event> > pythonMergeTemporalChunks(const vector<TemporalChunk>& chunks, boost::python::list filenames) {
+	vector<std::string> names;
+	for (int i = 0; i < len(filenames); ++i) {
+		names.push_back(extract<std::string>(filenames[i]));
+	}
+	return merge_temporal_chunks(chunks, names);
+}
+
 void export_track() {
     class_<vector<Event> >("EventVector")
 	.def(vector_indexing_suite<vector<Event> >())
@@ -52,6 +444,46 @@ void export_track() {
 
     class_<vector<vector<Event> > >("NestedEventVector")
 	.def(vector_indexing_suite<vector<vector<Event> > >())
+	.def("to_arrays", &pythonEventsArrays, (arg("first_timestep") = 0),
+	     "dict of event type name to a numpy structured array (timestep, ids, energy) per event, "
+	     "the timestep is first_timestep plus the index of the event vector; ids shorter than the "
+	     "table are padded with 2**64-1")
+    ;
+
+    def("save_binary_events", &save_binary_events,
+        (arg("events"), arg("filename"), arg("with_energies") = true),
+        "write a NestedEventVector in the compact binary event format");
+    def("load_binary_events",
+        static_cast<vector<vector<Event> > (*)(const std::string&)>(&load_binary_events),
+        (arg("filename")));
+
+    class_<TemporalChunk>("TemporalChunk")
+      .def_readwrite("first", &TemporalChunk::first)
+      .def_readwrite("last", &TemporalChunk::last)
+      .def_readwrite("own_first", &TemporalChunk::own_first)
+      .def_readwrite("own_last", &TemporalChunk::own_last)
+      .def_readwrite("origin", &TemporalChunk::origin)
+    ;
+    class_<vector<TemporalChunk> >("TemporalChunkVector")
+	.def(vector_indexing_suite<vector<TemporalChunk> >())
+    ;
+    def("plan_temporal_chunks",
+        static_cast<vector<TemporalChunk> (*)(int, int, int, int)>(&plan_temporal_chunks),
+        (arg("first_timestep"), arg("last_timestep"), arg("chunk_length"), arg("overlap")));
+    def("plan_temporal_chunks",
+        static_cast<vector<TemporalChunk> (*)(const TraxelStore&, int, int)>(&plan_temporal_chunks),
+        (arg("traxels"), arg("chunk_length"), arg("overlap")));
+    def("chunk_events_filename", &chunk_events_filename, (arg("prefix"), arg("chunk")));
+    def("track_temporal_chunk", &track_temporal_chunk,
+        (arg("tracking"), arg("traxels"), arg("chunk"), arg("filename")),
+        "worker: track one chunk and write the events it owns in the binary event format");
+    def("merge_temporal_chunks", &pythonMergeTemporalChunks, (arg("chunks"), arg("filenames")),
+        "coordinator: merge the event files of the chunks into one NestedEventVector");
+    def("track_temporal_chunks", &track_temporal_chunks,
+        (arg("tracking"), arg("traxels"), arg("chunk_length"), arg("overlap"), arg("prefix")));
+
+    class_<vector<vector<vector<Event> > > >("NestedEventVectorVector")
+	.def(vector_indexing_suite<vector<vector<vector<Event> > > >())
     ;
 
     class_<map<unsigned int, bool> >("DetectionMap")
@@ -62,6 +494,63 @@ void export_track() {
       .def(vector_indexing_suite<vector<map<unsigned int, bool> > >())
     ;
 
+    class_<SolverStatistics>("SolverStatistics")
+      .def_readonly("number_of_models", &SolverStatistics::number_of_models)
+      .def_readonly("number_of_variables", &SolverStatistics::number_of_variables)
+      .def_readonly("number_of_factors", &SolverStatistics::number_of_factors)
+      .def_readonly("number_of_table_entries", &SolverStatistics::number_of_table_entries)
+      .def_readonly("number_of_constraints", &SolverStatistics::number_of_constraints)
+      .def_readonly("constraints_seconds", &SolverStatistics::constraints_seconds)
+      .def_readonly("objective", &SolverStatistics::objective)
+      .def_readonly("bound", &SolverStatistics::bound)
+      .def_readonly("status", &SolverStatistics::status)
+      .add_property("gap", &SolverStatistics::gap)
+    ;
+
+    class_<TrackingStatistics>("TrackingStatistics")
+      .def_readonly("energy_seconds", &TrackingStatistics::energy_seconds)
+      .def_readonly("hypotheses_seconds", &TrackingStatistics::hypotheses_seconds)
+      .def_readonly("formulate_seconds", &TrackingStatistics::formulate_seconds)
+      .def_readonly("infer_seconds", &TrackingStatistics::infer_seconds)
+      .def_readonly("conclude_seconds", &TrackingStatistics::conclude_seconds)
+      .def_readonly("prune_seconds", &TrackingStatistics::prune_seconds)
+      .def_readonly("merger_resolution_seconds", &TrackingStatistics::merger_resolution_seconds)
+      .def_readonly("events_seconds", &TrackingStatistics::events_seconds)
+      .def_readonly("checkpoint_seconds", &TrackingStatistics::checkpoint_seconds)
+      .def_readonly("number_of_nodes", &TrackingStatistics::number_of_nodes)
+      .def_readonly("number_of_arcs", &TrackingStatistics::number_of_arcs)
+      .def_readonly("solver", &TrackingStatistics::solver)
+      .def_readonly("memory", &TrackingStatistics::memory)
+    ;
+
+    class_<MemoryReport>("MemoryReport")
+      .add_property("components", &pythonMemoryComponents)
+      .add_property("phases", &pythonMemoryPhases)
+      .add_property("total_bytes", &MemoryReport::total_bytes)
+      .def("__str__", &pythonMemoryReportStr)
+    ;
+
+    def("current_rss_kb", &current_rss_kb);
+    def("peak_rss_kb", &peak_rss_kb);
+
+    class_<TrackingJob, boost::shared_ptr<TrackingJob>, boost::noncopyable>("TrackingJob", no_init)
+      .def("done", &TrackingJob::done)
+      .def("cancel", &TrackingJob::cancel)
+      .def("progress", &TrackingJob::progress)
+      .def("wait", &TrackingJob::wait, (arg("timeout_seconds") = -1.))
+      .def("result", &TrackingJob::result)
+    ;
+
+    class_<NNTracking>("NNTracking", init<optional<double, double> >(args("division_distance", "move_distance")))
+      .def("__call__", &pythonNNTracking<NNTracking>)
+      .def("detections", &NNTracking::detections)
+    ;
+
+    class_<NNTrackletsTracking>("NNTrackletsTracking", init<optional<double> >(args("max_distance")))
+      .def("__call__", &pythonNNTracking<NNTrackletsTracking>)
+      .def("detections", &NNTrackletsTracking::detections)
+    ;
+
     class_<ChaingraphTracking>("ChaingraphTracking", 
 			       init<string,double,double,double,double,
 			       	   bool,double,double,bool,
@@ -71,14 +560,35 @@ void export_track() {
 									  "fixed_detections", "mean_div_dist", "min_angle", "ep_gap", "n_neighbors"
 									  )))
       .def("__call__", &pythonChaingraphTracking)
+      .def("start", &pythonStartChaingraphTracking, (arg("traxel_store"), arg("progress_interval") = 1.),
+           "track in a thread of its own and return a TrackingJob; replaces the progress callback")
       .def("detections", &ChaingraphTracking::detections)
       .def("set_with_divisions", &ChaingraphTracking::set_with_divisions)
       .def("set_cplex_timeout", &ChaingraphTracking::set_cplex_timeout)
+      .def("set_lp_relaxation", &ChaingraphTracking::set_lp_relaxation)
+      .def("set_with_statistics", &ChaingraphTracking::set_with_statistics)
+      .def("statistics", &ChaingraphTracking::statistics, return_value_policy<copy_const_reference>())
+      .def("set_progress_callback", &pythonSetProgressCallback<ChaingraphTracking>,
+           (arg("callback"), arg("interval_seconds") = 1.))
+    ;
+
+    class_<ConsTrackingParameters>("ConsTrackingParameters",
+                                   init<optional<double, double, double, double, double, double, double, double> >(
+                                       args("division_weight", "transition_weight", "disappearance_cost", "appearance_cost",
+                                            "forbidden_cost", "ep_gap", "transition_parameter", "cplex_timeout")))
+      .def_readwrite("division_weight", &ConsTrackingParameters::division_weight)
+      .def_readwrite("transition_weight", &ConsTrackingParameters::transition_weight)
+      .def_readwrite("disappearance_cost", &ConsTrackingParameters::disappearance_cost)
+      .def_readwrite("appearance_cost", &ConsTrackingParameters::appearance_cost)
+      .def_readwrite("forbidden_cost", &ConsTrackingParameters::forbidden_cost)
+      .def_readwrite("ep_gap", &ConsTrackingParameters::ep_gap)
+      .def_readwrite("transition_parameter", &ConsTrackingParameters::transition_parameter)
+      .def_readwrite("cplex_timeout", &ConsTrackingParameters::cplex_timeout)
     ;
 
     class_<ConsTracking>("ConsTracking",
                          init<int,double,double,string,bool,double,double,double,bool,double,double,bool,
-                         double,double, bool, int, double, double, FieldOfView, bool, double, string>(
+                         double,double, bool, int, double, double, FieldOfView, bool, double, string, optional<bool, int, int, bool, bool> >(
 						args("max_number_objects", "max_neighbor_distance", "division_threshold",
 							"detection_rf_filename", "size_dependent_detection_prob", "forbidden_cost",
 							"ep_gap", "avg_obj_size",
@@ -87,10 +597,28 @@ void export_track() {
 							"with_divisions",
 							 "disappearance_cost", "appearance_cost", "with_merger_resolution", "number_of_dimensions",
                              "transition_parameter", "border_width", "fov", "with_constraints", "cplex_timeout",
-                             "event_vector_dump_filename"
+                             "event_vector_dump_filename", "with_components",
+                             "window_length", "window_overlap", "with_warm_start", "with_min_cost_flow"
                              )))
       .def("__call__", &pythonConsTracking)
+	  .def("start", &pythonStartConsTracking,
+	       (arg("traxel_store"), arg("coordinates") = object(), arg("progress_interval") = 1.),
+	       "track in a thread of its own and return a TrackingJob; replaces the progress callback")
 	  .def("detections", &ConsTracking::detections)
+	  .def("reweight", &pythonConsTrackingReweight,
+	       args("division_weight", "transition_weight", "disappearance_cost", "appearance_cost", "forbidden_cost"))
+	  .def("track_configurations", &pythonConsTrackingConfigurations, args("traxel_store", "configurations"))
+	  .def("set_with_statistics", &ConsTracking::set_with_statistics)
+	  .def("set_with_parallel_gmm", &ConsTracking::set_with_parallel_gmm)
+	  .def("set_merger_cache", &ConsTracking::set_merger_cache)
+	  .def("set_with_assignment_resolution", &ConsTracking::set_with_assignment_resolution)
+	  .def("set_tiling", &ConsTracking::set_tiling, (arg("tile_size"), arg("halo")))
+	  .def("set_checkpoint_prefix", &ConsTracking::set_checkpoint_prefix, (arg("prefix")))
+	  .def("set_resume_checkpoint", &ConsTracking::set_resume_checkpoint, (arg("filename")))
+	  .def("set_coordinate_provider", &ConsTracking::set_coordinate_provider)
+	  .def("statistics", &ConsTracking::statistics, return_value_policy<copy_const_reference>())
+	  .def("set_progress_callback", &pythonSetProgressCallback<ConsTracking>,
+	       (arg("callback"), arg("interval_seconds") = 1.))
 	;
 
     enum_<Event::EventType>("EventType")
@@ -6,7 +6,9 @@
 #include <sstream>
 
 #include "../include/pgmlink/traxels.h"
+#include "../include/pgmlink/traxel_columns.h"
 #include <vigra/multi_array.hxx>
+#include <vigra/numpy_array.hxx>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/python.hpp>
@@ -41,11 +43,11 @@ namespace pgmlink {
   }
 
   void add_feature_array(Traxel& t, string key, size_t size) {
-    t.features[key] = feature_array(size, 0);
+    t.set_feature(key, feature_array(size, 0));
   }
 
   float get_feature_value(Traxel& t, string key, MultiArrayIndex i) {
-    FeatureMap::const_iterator it = t.features.find(key);
+    TraxelFeatures::const_iterator it = t.features.find(key);
     if(it == t.features.end()) {
       throw std::runtime_error("key not present in feature map");
     }
@@ -56,15 +58,30 @@ namespace pgmlink {
     return it->second[i];
   }
 
+  // the features as a copy; packed features have no map to refer to
+  FeatureMap get_features(const Traxel& t) {
+    return t.features.to_map();
+  }
+
+  void set_features(Traxel& t, const FeatureMap& features) {
+    const boost::shared_ptr<FeatureSchema> schema = t.feature_schema();
+    t.features = features;
+    if(schema) {
+      t.intern_features(schema);
+    } else {
+      t.update_coordinate_cache();
+    }
+  }
+
   void set_feature_value(Traxel& t, string key, MultiArrayIndex i, float value) {
-    FeatureMap::iterator it = t.features.find(key);
+    TraxelFeatures::const_iterator it = t.features.find(key);
     if(it == t.features.end()) {
       throw std::runtime_error("key not present in feature map");
     }
     if( !(static_cast<size_t>(i) < it->second.size())) {
       throw std::runtime_error("index out of range");
     }
-    it->second[i] = value;
+    t.set_feature_value(key, i, value);
   }
 
   // extending Traxels
@@ -98,6 +115,110 @@ namespace pgmlink {
     }
   }
 
+  // extending TraxelColumns
+  // The arrays are read only views of the column buffers and keep the
+  // TraxelColumns object alive, so no data is copied.
+  object numpy_view(object owner, const void* data, int typenum, npy_intp rows, npy_intp cols, int ndim) {
+    npy_intp shape[2] = {rows, cols};
+    PyObject* array = PyArray_New(&PyArray_Type, ndim, shape, typenum, NULL,
+                                  const_cast<void*>(data), 0, NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED, NULL);
+    if(!array) {
+      throw_error_already_set();
+    }
+    Py_INCREF(owner.ptr());
+    if(PyArray_SetBaseObject(reinterpret_cast<PyArrayObject*>(array), owner.ptr()) != 0) {
+      Py_DECREF(array);
+      throw_error_already_set();
+    }
+    return object(handle<>(array));
+  }
+
+  object columns_timesteps(object self) {
+    const TraxelColumns& c = extract<const TraxelColumns&>(self);
+    return numpy_view(self, c.timesteps().empty() ? 0 : &c.timesteps()[0], NPY_INT, c.size(), 0, 1);
+  }
+
+  object columns_ids(object self) {
+    const TraxelColumns& c = extract<const TraxelColumns&>(self);
+    return numpy_view(self, c.ids().empty() ? 0 : &c.ids()[0], NPY_UINT, c.size(), 0, 1);
+  }
+
+  object columns_column(object self, const std::string& name) {
+    const TraxelColumns& c = extract<const TraxelColumns&>(self);
+    const TraxelColumns::Column& column = c.column(name);
+    return numpy_view(self, column.data(), NPY_FLOAT32, c.size(), column.width(), 2);
+  }
+
+  boost::python::list columns_feature_names(const TraxelColumns& c) {
+    boost::python::list ret;
+    std::vector<std::string> names = c.feature_names();
+    for(size_t i = 0; i < names.size(); ++i) {
+      ret.append(names[i]);
+    }
+    return ret;
+  }
+
+  TraxelColumns* columns_from_names(const TraxelStore& ts, object names) {
+    std::vector<std::string> v;
+    for(int i = 0; i < len(names); ++i) {
+      v.push_back(extract<std::string>(names[i]));
+    }
+    return new TraxelColumns(ts, v);
+  }
+
+  TraxelColumns* columns_of(const TraxelStore& ts) {
+    return new TraxelColumns(ts);
+  }
+
+  // C contiguous array of typenum; a copy if o is of another layout or type
+  object contiguous_array(object o, int typenum, int max_dims) {
+    PyObject* array = PyArray_FROMANY(o.ptr(), typenum, 1, max_dims,
+                                      NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED | NPY_ARRAY_FORCECAST);
+    if(!array) {
+      throw_error_already_set();
+    }
+    return object(handle<>(array));
+  }
+
+  // timesteps and ids are arrays of n values, features maps a feature name
+  // to an n x width array (or an array of n values, width 1)
+  void add_columns_to_traxelstore(TraxelStore& ts, object timesteps, object ids, dict features) {
+    object timestep_array = contiguous_array(timesteps, NPY_INT, 1);
+    object id_array = contiguous_array(ids, NPY_UINT, 1);
+    PyArrayObject* t = reinterpret_cast<PyArrayObject*>(timestep_array.ptr());
+    PyArrayObject* i = reinterpret_cast<PyArrayObject*>(id_array.ptr());
+    const npy_intp n = PyArray_DIM(t, 0);
+    if(PyArray_DIM(i, 0) != n) {
+      throw std::invalid_argument("TraxelStore.add_columns(): timesteps and ids differ in length");
+    }
+
+    // the arrays stay referenced while the columns are added
+    boost::python::list arrays;
+    std::vector<FeatureColumnView> views;
+    boost::python::list items = features.items();
+    for(int k = 0; k < len(items); ++k) {
+      const std::string name = extract<std::string>(items[k][0]);
+      object array = contiguous_array(items[k][1], NPY_FLOAT32, 2);
+      PyArrayObject* a = reinterpret_cast<PyArrayObject*>(array.ptr());
+      if(PyArray_DIM(a, 0) != n) {
+        throw std::invalid_argument("TraxelStore.add_columns(): feature " + name + " has not one row per traxel");
+      }
+      arrays.append(array);
+      views.push_back(FeatureColumnView(name, static_cast<const feature_type*>(PyArray_DATA(a)),
+                                        PyArray_NDIM(a) == 2 ? PyArray_DIM(a, 1) : 1));
+    }
+
+    // release the GIL
+    Py_BEGIN_ALLOW_THREADS
+    try {
+      add_columns(ts, n, static_cast<const int*>(PyArray_DATA(t)), static_cast<const unsigned int*>(PyArray_DATA(i)), views);
+    } catch (std::exception& e) {
+      Py_BLOCK_THREADS
+      throw;
+    }
+    Py_END_ALLOW_THREADS
+  }
+
 } /* namespace pgmlink */
 
 void export_traxels() {
@@ -133,7 +254,7 @@ void export_traxels() {
         .def("X", &Traxel::X)
         .def("Y", &Traxel::Y)
         .def("Z", &Traxel::Z)
-	.def_readwrite("features", &Traxel::features)
+	.add_property("features", &get_features, &set_features, "Copy of the feature map; assign to change it.")
         .def("add_feature_array", &add_feature_array, args("self","name", "size"), "Add a new feature array to the features map; initialize with zeros. If the name is already present, the old feature array will be replaced.")
 	.def("get_feature_value", &get_feature_value, args("self", "name", "index"))
 	.def("set_feature_value", &set_feature_value, args("self", "name", "index", "value"))
@@ -156,9 +277,25 @@ void export_traxels() {
     class_<TraxelStore>("TraxelStore")
       .def("add", &add_traxel_to_traxelstore)
       .def("add_from_Traxels", &add_Traxels_to_traxelstore)
+      .def("add_columns", &add_columns_to_traxelstore, args("self", "timesteps", "ids", "features"),
+           "Add one traxel per entry of the timesteps and ids arrays; features maps names to arrays with one row "
+           "per traxel (rows of NaN are missing features). The inverse of columns(); built in parallel per timestep.")
       .def("bounding_box", &bounding_box)
       .def("get_by_timeid", get_by_timeid, return_internal_reference<>())
       .def("size", &TraxelStore::size)
+      .def("columns", &columns_of, return_value_policy<manage_new_object>(),
+           "Columnar snapshot of all features; see TraxelColumns.")
       .def_pickle(TraxelStore_pickle_suite())
       ;
+
+    class_<TraxelColumns>("TraxelColumns", init<const TraxelStore&>(args("traxelstore")))
+      .def("__init__", make_constructor(&columns_from_names))
+      .def("__len__", &TraxelColumns::size)
+      .def("timesteps", &columns_timesteps, "numpy array of the timesteps (shares the buffer)")
+      .def("ids", &columns_ids, "numpy array of the ids (shares the buffer)")
+      .def("column", &columns_column, args("self", "name"),
+           "n_traxels x width numpy array of a feature (shares the buffer); missing values are NaN")
+      .def("has_column", &TraxelColumns::has_column)
+      .def("feature_names", &columns_feature_names)
+      ;
 }
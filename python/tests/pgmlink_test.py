@@ -34,6 +34,78 @@ class Test_TraxelStore( ut.TestCase ):
         saved = cPickle.dumps(ts)
         loaded = cPickle.loads(saved)
 
+    def test_columns( self ):
+        ts = pgmlink.TraxelStore()
+        for id in range(3):
+            t = mk_traxel(id, 2*id, 0, id)
+            t.Id = id
+            ts.add(t)
+
+        columns = ts.columns()
+        self.assertEqual(len(columns), 3)
+        self.assertEqual(list(columns.ids()), [0, 1, 2])
+        self.assertEqual(list(columns.timesteps()), [0, 0, 0])
+        com = columns.column("com")
+        self.assertEqual(com.shape, (3, 3))
+        self.assertEqual(list(com[:, 1]), [0, 2, 4])
+        self.assertFalse(com.flags.writeable)
+
+        selected = pgmlink.TraxelColumns(ts, ["count"])
+        self.assertFalse(selected.has_column("com"))
+        self.assertEqual(selected.column("count").shape, (3, 0))
+
+    def test_add_columns( self ):
+        import numpy as np
+        ts = pgmlink.TraxelStore()
+        com = np.array([[1, 2, 0], [3, 4, 0], [5, 6, 0]])
+        ts.add_columns(np.array([1, 0, 1]), np.array([7, 7, 8]),
+                       {"com": com, "count": np.array([10, np.nan, 30])})
+        self.assertEqual(ts.size(), 3)
+
+        columns = ts.columns()
+        self.assertEqual(list(columns.timesteps()), [0, 1, 1])
+        self.assertEqual(list(columns.ids()), [7, 7, 8])
+        self.assertEqual(list(columns.column("com")[:, 0]), [3, 1, 5])
+        self.assertTrue(np.isnan(columns.column("count")[0, 0]))
+        self.assertRaises(Exception, ts.add_columns, np.array([0]), np.array([7]), {})
+
+
+class Test_Events( ut.TestCase ):
+    def test_to_arrays( self ):
+        events = pgmlink.NestedEventVector()
+        for t in range(2):
+            v = pgmlink.EventVector()
+            v.append(pgmlink.Event())
+            events.append(v)
+        arrays = events.to_arrays(3)
+        self.assertEqual(list(arrays.keys()), ["Void"])
+        self.assertEqual(list(arrays["Void"]["timestep"]), [3, 4])
+        self.assertEqual(list(arrays["Void"]["energy"]), [0, 0])
+
+    def test_binary_events( self ):
+        import os, tempfile
+        events = pgmlink.NestedEventVector()
+        for t in range(2):
+            v = pgmlink.EventVector()
+            v.append(pgmlink.Event())
+            events.append(v)
+        fd, filename = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            pgmlink.save_binary_events(events, filename)
+            loaded = pgmlink.load_binary_events(filename)
+        finally:
+            os.remove(filename)
+        self.assertEqual(len(loaded), 2)
+        self.assertEqual(len(loaded[1]), 1)
+
+    def test_temporal_chunks( self ):
+        chunks = pgmlink.plan_temporal_chunks(1, 10, 4, 2)
+        self.assertEqual(len(chunks), 3)
+        self.assertEqual(chunks[1].own_first, 5)
+        self.assertEqual(chunks[1].first, 2)
+        self.assertEqual(chunks[2].last, 10)
+        self.assertTrue(pgmlink.chunk_events_filename("movie", 2).endswith(".chunk2.pgmlevts"))
 
 class Test_HypothesesGraph( ut.TestCase ):
     def test_graph_interface( self ):
@@ -70,6 +142,22 @@ class Test_HypothesesGraph( ut.TestCase ):
         m[n1] = t
         self.assertEqual(m[n1].Id, 33)
 
+    def test_to_arrays( self ):
+        g = pgmlink.HypothesesGraph()
+        n1 = g.addNode(0)
+        n2 = g.addNode(1)
+        n3 = g.addNode(1)
+        g.addArc(n1, n2)
+        g.addArc(n1, n3)
+        g.erase(n2)
+
+        arrays = g.to_arrays()
+        self.assertEqual(list(arrays["node_timestep"]), [1, 0])
+        self.assertEqual(list(arrays["arc_source"]), [1])
+        self.assertEqual(list(arrays["arc_target"]), [0])
+        self.assertFalse("node_traxel_id" in arrays)
+        self.assertRaises(Exception, g.to_arrays, [], ["no_such_property"])
+
 
 class Test_CrossCorrelation( ut.TestCase ):
     def runTest( self ):
@@ -0,0 +1,139 @@
+#include <algorithm>
+
+#include <boost/thread/tss.hpp>
+
+#include "pgmlink/arena.h"
+
+using namespace std;
+
+namespace pgmlink {
+namespace {
+  // enough for every fundamental type
+  const size_t alignment = 16;
+
+  size_t aligned(size_t bytes) {
+    return (max(bytes, size_t(1)) + alignment - 1) / alignment * alignment;
+  }
+
+  // never destroyed: threads may exit after the static destructors ran
+  boost::thread_specific_ptr<Arena>& thread_arenas() {
+    static boost::thread_specific_ptr<Arena>* arenas = new boost::thread_specific_ptr<Arena>;
+    return *arenas;
+  }
+}
+
+////
+//// class Arena
+////
+Arena::Arena(size_t block_size)
+    : block_size_(aligned(block_size)), block_(0), offset_(0), used_before_(0) {
+}
+
+Arena::~Arena() {
+  release();
+}
+
+void* Arena::allocate(size_t bytes) {
+  bytes = aligned(bytes);
+  if (block_ >= blocks_.size() || offset_ + bytes > blocks_[block_].size) {
+    // the rest of the current block stays unused until the next rewind
+    size_t next = blocks_.empty() ? 0 : block_ + 1;
+    used_before_ += offset_;
+    offset_ = 0;
+    while (next < blocks_.size() && blocks_[next].size < bytes) {
+      ++next;
+    }
+    if (next == blocks_.size()) {
+      add_block(bytes);
+    }
+    block_ = next;
+  }
+  void* p = blocks_[block_].data + offset_;
+  offset_ += bytes;
+  return p;
+}
+
+Arena::Mark Arena::mark() const {
+  Mark m;
+  m.block = block_;
+  m.offset = offset_;
+  m.used = used_before_;
+  return m;
+}
+
+void Arena::rewind(const Mark& m) {
+  block_ = m.block;
+  offset_ = m.offset;
+  used_before_ = m.used;
+  if (block_ == 0 && offset_ == 0 && blocks_.size() > 1) {
+    // one block of the capacity needed so far
+    const size_t size = capacity();
+    for (vector<Block>::iterator b = blocks_.begin(); b != blocks_.end(); ++b) {
+      delete[] b->data;
+    }
+    blocks_.clear();
+    add_block(size);
+  }
+}
+
+void Arena::clear() {
+  Mark empty;
+  empty.block = 0;
+  empty.offset = 0;
+  empty.used = 0;
+  rewind(empty);
+}
+
+void Arena::release() {
+  for (vector<Block>::iterator b = blocks_.begin(); b != blocks_.end(); ++b) {
+    delete[] b->data;
+  }
+  blocks_.clear();
+  block_ = 0;
+  offset_ = 0;
+  used_before_ = 0;
+}
+
+size_t Arena::bytes_used() const {
+  return used_before_ + offset_;
+}
+
+size_t Arena::capacity() const {
+  size_t size = 0;
+  for (vector<Block>::const_iterator b = blocks_.begin(); b != blocks_.end(); ++b) {
+    size += b->size;
+  }
+  return size;
+}
+
+Arena& Arena::for_this_thread() {
+  boost::thread_specific_ptr<Arena>& arenas = thread_arenas();
+  if (!arenas.get()) {
+    arenas.reset(new Arena);
+  }
+  return *arenas;
+}
+
+void Arena::release_this_thread() {
+  Arena* arena = thread_arenas().get();
+  // an arena in use still has a scope open
+  if (arena && arena->bytes_used() == 0) {
+    arena->release();
+  }
+}
+
+void Arena::release_thread_arenas() {
+  release_this_thread();
+  // the workers of the team that ran the parallel loops
+  #pragma omp parallel
+  release_this_thread();
+}
+
+void Arena::add_block(size_t min_size) {
+  Block b;
+  b.size = max(block_size_, aligned(min_size));
+  b.data = new char[b.size];
+  blocks_.push_back(b);
+}
+
+} /* namespace pgmlink */
@@ -0,0 +1,241 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "pgmlink/binary_events.h"
+#include "pgmlink/log.h"
+
+using namespace std;
+using boost::uint32_t;
+using boost::uint64_t;
+
+namespace pgmlink {
+using namespace binary_events;
+
+namespace {
+  const uint64_t alignment = 8;
+
+  uint64_t aligned(uint64_t pos) {
+    return (pos + alignment - 1) / alignment * alignment;
+  }
+
+  // end of the run of events of the same type starting at begin
+  size_t run_end(const vector<Event>& events, size_t begin) {
+    size_t end = begin + 1;
+    while(end < events.size() && events[end].type == events[begin].type) {
+      ++end;
+    }
+    return end;
+  }
+
+  // bounds checked reading of a mapped file
+  class Reader {
+  public:
+    Reader(const char* data, uint64_t size) : data_(data), size_(size), pos_(0) {}
+
+    template<class T>
+    const T* read(uint64_t count = 1) {
+      const uint64_t length = count * sizeof(T);
+      if(length / sizeof(T) != count || pos_ + length > size_ || pos_ + length < pos_) {
+        throw runtime_error("load_binary_events(): truncated file");
+      }
+      const T* p = reinterpret_cast<const T*>(data_ + pos_);
+      pos_ = aligned(pos_ + length);
+      return p;
+    }
+    bool at_end() const { return pos_ >= size_; }
+    uint64_t remaining() const { return at_end() ? 0 : size_ - pos_; }
+
+  private:
+    const char* data_;
+    uint64_t size_;
+    uint64_t pos_;
+  };
+}
+
+
+
+////
+//// class BinaryEventWriter
+////
+BinaryEventWriter::BinaryEventWriter(const std::string& filename, bool with_energies)
+  : filename_(filename), out_(filename.c_str(), ios::binary | ios::trunc) {
+  if(!out_) {
+    throw runtime_error("BinaryEventWriter: could not open file " + filename);
+  }
+  memcpy(header_.magic, magic, sizeof(magic));
+  header_.version = version;
+  header_.byte_order = byte_order_mark;
+  header_.flags = with_energies ? with_energies_flag : 0;
+  header_.padding = 0;
+  header_.n_slots = 0;
+  header_.n_events = 0;
+  // completed by close()
+  write(&header_, sizeof(Header));
+}
+
+BinaryEventWriter::~BinaryEventWriter() {
+  if(out_.is_open()) {
+    try {
+      close();
+    } catch(std::exception& e) {
+      LOG(logWARNING) << "BinaryEventWriter: " << e.what();
+    }
+  }
+}
+
+void BinaryEventWriter::write(const void* data, std::size_t length) {
+  static const char zeros[alignment] = {0};
+  out_.write(static_cast<const char*>(data), static_cast<streamsize>(length));
+  out_.write(zeros, static_cast<streamsize>(aligned(length) - length));
+  if(!out_) {
+    throw runtime_error("BinaryEventWriter: could not write to file " + filename_);
+  }
+}
+
+void BinaryEventWriter::timestep(std::size_t slot, std::vector<Event>& events) {
+  if(!out_.is_open()) {
+    throw logic_error("BinaryEventWriter::timestep(): writer is closed");
+  }
+  SlotRecord s = {slot, 0};
+  for(size_t begin = 0; begin < events.size(); begin = run_end(events, begin)) {
+    ++s.n_blocks;
+  }
+  write(&s, sizeof(SlotRecord));
+
+  const bool with_energies = header_.flags & with_energies_flag;
+  for(size_t begin = 0, end = 0; begin < events.size(); begin = end) {
+    end = run_end(events, begin);
+    // events without ids get a padded row, too, so a count is backed by data
+    BlockRecord b = {static_cast<uint32_t>(events[begin].type), 1, end - begin};
+    for(size_t i = begin; i < end; ++i) {
+      b.width = max(b.width, static_cast<uint32_t>(events[i].traxel_ids.size()));
+    }
+
+    ids_.assign(b.count * b.width, missing_id);
+    energies_.clear();
+    for(size_t i = begin; i < end; ++i) {
+      const vector<size_t>& ids = events[i].traxel_ids;
+      for(size_t j = 0; j < ids.size(); ++j) {
+        if(ids[j] >= missing_id) {
+          throw invalid_argument("BinaryEventWriter::timestep(): traxel id does not fit into 32 bits");
+        }
+        ids_[(i - begin) * b.width + j] = static_cast<uint32_t>(ids[j]);
+      }
+      if(with_energies) {
+        energies_.push_back(events[i].energy());
+      }
+    }
+
+    write(&b, sizeof(BlockRecord));
+    if(!ids_.empty()) write(&ids_[0], ids_.size() * sizeof(uint32_t));
+    if(!energies_.empty()) write(&energies_[0], energies_.size() * sizeof(double));
+  }
+  ++header_.n_slots;
+  header_.n_events += events.size();
+}
+
+void BinaryEventWriter::close() {
+  if(!out_.is_open()) {
+    return;
+  }
+  out_.seekp(0);
+  write(&header_, sizeof(Header));
+  out_.close();
+  if(!out_) {
+    throw runtime_error("BinaryEventWriter: could not write to file " + filename_);
+  }
+}
+
+
+
+////
+//// save_binary_events, load_binary_events
+////
+void save_binary_events(const std::vector<std::vector<Event> >& events,
+                        const std::string& filename,
+                        bool with_energies) {
+  BinaryEventWriter writer(filename, with_energies);
+  vector<Event> slot_events;
+  for(size_t slot = 0; slot < events.size(); ++slot) {
+    // the writer may swap its argument out
+    slot_events = events[slot];
+    writer.timestep(slot, slot_events);
+  }
+  writer.close();
+}
+
+void load_binary_events(const std::string& filename, EventSink& sink) {
+  boost::iostreams::mapped_file_source file;
+  try {
+    file.open(filename);
+  } catch(std::exception& e) {
+    throw runtime_error("load_binary_events(): could not open file " + filename + ": " + e.what());
+  }
+  Reader in(file.data(), file.size());
+  const Header& header = *in.read<Header>();
+  if(memcmp(header.magic, magic, sizeof(magic)) != 0) {
+    throw runtime_error("load_binary_events(): not a binary event file: " + filename);
+  }
+  if(header.version != version) {
+    throw runtime_error("load_binary_events(): unsupported version");
+  }
+  if(header.byte_order != byte_order_mark) {
+    throw runtime_error("load_binary_events(): file was written with a different byte order");
+  }
+  const bool with_energies = header.flags & with_energies_flag;
+
+  vector<Event> events;
+  vector<double> energy(1), weight(1, 1.);
+  for(uint64_t s = 0; s < header.n_slots; ++s) {
+    const SlotRecord& slot = *in.read<SlotRecord>();
+    events.clear();
+    for(uint64_t b = 0; b < slot.n_blocks; ++b) {
+      const BlockRecord& block = *in.read<BlockRecord>();
+      if(block.type > Event::Void) {
+        throw runtime_error("load_binary_events(): unknown event type");
+      }
+      if(block.count > 0 && block.width == 0) {
+        throw runtime_error("load_binary_events(): block without ids");
+      }
+      // before multiplying or reserving: every event takes its row of ids
+      if(block.count > in.remaining() / (static_cast<uint64_t>(block.width) * sizeof(uint32_t))) {
+        throw runtime_error("load_binary_events(): truncated file");
+      }
+      const uint32_t* ids = in.read<uint32_t>(block.count * block.width);
+      const double* energies = with_energies ? in.read<double>(block.count) : 0;
+      events.reserve(events.size() + block.count);
+      for(uint64_t i = 0; i < block.count; ++i) {
+        events.push_back(Event());
+        Event& e = events.back();
+        e.type = static_cast<Event::EventType>(block.type);
+        const uint32_t* row = ids + i * block.width;
+        uint32_t width = block.width;
+        while(width > 0 && row[width - 1] == missing_id) {
+          --width;
+        }
+        e.traxel_ids.assign(row, row + width);
+        if(with_energies) {
+          energy[0] = energies[i];
+          e.number_of_features(1).features(energy).weights(weight);
+        }
+      }
+    }
+    sink.timestep(static_cast<size_t>(slot.slot), events);
+  }
+  if(!in.at_end()) {
+    LOG(logWARNING) << "load_binary_events(): ignoring trailing data in " << filename;
+  }
+}
+
+std::vector<std::vector<Event> > load_binary_events(const std::string& filename) {
+  vector<vector<Event> > events;
+  EventVectorSink sink(events);
+  load_binary_events(filename, sink);
+  return events;
+}
+
+} /* namespace pgmlink */
@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pgmlink/binary_traxelstore.h"
+#include "pgmlink/log.h"
+
+using namespace std;
+using boost::uint32_t;
+using boost::uint64_t;
+
+namespace pgmlink {
+using namespace binary_traxelstore;
+
+namespace {
+  const uint64_t alignment = 8;
+
+  uint64_t aligned(uint64_t pos) {
+    return (pos + alignment - 1) / alignment * alignment;
+  }
+
+  // bytes of count records of size bytes; throws instead of wrapping around
+  uint64_t section_bytes(uint64_t count, uint64_t size) {
+    if(size != 0 && count > numeric_limits<uint64_t>::max() / size) {
+      throw runtime_error("MappedTraxelStore: section size overflows");
+    }
+    return count * size;
+  }
+
+  // sections are read in place as arrays of 64 bit values
+  void check_aligned(uint64_t offset) {
+    if(offset % alignment != 0) {
+      throw runtime_error("MappedTraxelStore: misaligned section");
+    }
+  }
+
+  // ostream writer that keeps track of the position for padding
+  class Writer {
+  public:
+    Writer(ostream& out) : out_(out), pos_(0) {}
+
+    void write(const void* data, uint64_t length) {
+      out_.write(static_cast<const char*>(data), static_cast<streamsize>(length));
+      pos_ += length;
+    }
+    void pad() {
+      static const char zeros[alignment] = {0};
+      write(zeros, aligned(pos_) - pos_);
+    }
+    uint64_t pos() const { return pos_; }
+
+  private:
+    ostream& out_;
+    uint64_t pos_;
+  };
+
+  LocatorRecord locator_record(const Locator& l) {
+    LocatorRecord r;
+    if(dynamic_cast<const IntmaxposLocator*>(&l)) {
+      r.kind = IntmaxposLocatorKind;
+    } else if(dynamic_cast<const ComLocator*>(&l)) {
+      r.kind = ComLocatorKind;
+    } else {
+      throw invalid_argument("save_binary(): unsupported locator type");
+    }
+    r.padding = 0;
+    r.x_scale = l.x_scale;
+    r.y_scale = l.y_scale;
+    r.z_scale = l.z_scale;
+    return r;
+  }
+
+  uint32_t index_of(const LocatorRecord& l, vector<LocatorRecord>& locators) {
+    for(size_t i = 0; i < locators.size(); ++i) {
+      const LocatorRecord& r = locators[i];
+      if(r.kind == l.kind && r.x_scale == l.x_scale && r.y_scale == l.y_scale && r.z_scale == l.z_scale) {
+        return static_cast<uint32_t>(i);
+      }
+    }
+    locators.push_back(l);
+    return static_cast<uint32_t>(locators.size() - 1);
+  }
+
+  Locator* locator_from(const LocatorRecord& r) {
+    Locator* l = 0;
+    if(r.kind == IntmaxposLocatorKind) {
+      l = new IntmaxposLocator();
+    } else if(r.kind == ComLocatorKind) {
+      l = new ComLocator();
+    } else {
+      throw runtime_error("MappedTraxelStore: unknown locator kind");
+    }
+    l->x_scale = r.x_scale;
+    l->y_scale = r.y_scale;
+    l->z_scale = r.z_scale;
+    return l;
+  }
+
+  struct TimestepLess {
+    bool operator()(const TimestepRecord& r, int t) const { return r.timestep < t; }
+  };
+}
+
+
+
+////
+//// save_binary
+////
+void save_binary(const TraxelStore& ts, const std::string& filename) {
+  // traxels in timestep order together with the timestep index and locators
+  vector<const Traxel*> traxels;
+  traxels.reserve(ts.size());
+  vector<TimestepRecord> timesteps;
+  vector<TraxelRecord> records;
+  records.reserve(ts.size());
+  vector<LocatorRecord> locators;
+  map<string, uint64_t> n_values;
+  for(TraxelStoreByTimestep::const_iterator it = ts.get<by_timestep>().begin();
+      it != ts.get<by_timestep>().end(); ++it) {
+    if(timesteps.empty() || timesteps.back().timestep != it->Timestep) {
+      TimestepRecord t = {it->Timestep, 0, traxels.size(), 0};
+      timesteps.push_back(t);
+    }
+    ++timesteps.back().count;
+
+    TraxelRecord r = {it->Id, it->Timestep, index_of(locator_record(*it->locator()), locators), 0};
+    records.push_back(r);
+
+    for(TraxelFeatures::const_iterator f = it->features.begin(); f != it->features.end(); ++f) {
+      n_values[f->first] += f->second.size();
+    }
+    traxels.push_back(&(*it));
+  }
+  const uint64_t n = traxels.size();
+
+  // layout
+  Header header;
+  memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byte_order = byte_order_mark;
+  header.n_traxels = n;
+  header.n_timesteps = timesteps.size();
+  header.n_locators = locators.size();
+  header.n_features = n_values.size();
+  uint64_t pos = sizeof(Header);
+  header.timestep_index_offset = pos;
+  pos += timesteps.size() * sizeof(TimestepRecord);
+  header.traxel_table_offset = pos;
+  pos += records.size() * sizeof(TraxelRecord);
+  header.locator_table_offset = pos;
+  pos += locators.size() * sizeof(LocatorRecord);
+  header.feature_table_offset = pos;
+  pos += n_values.size() * sizeof(FeatureRecord);
+
+  vector<FeatureRecord> features;
+  for(map<string, uint64_t>::const_iterator f = n_values.begin(); f != n_values.end(); ++f) {
+    FeatureRecord r;
+    r.name_offset = pos;
+    r.name_length = f->first.size();
+    pos = aligned(pos + r.name_length);
+    r.present_offset = pos;
+    pos = aligned(pos + n);
+    r.offsets_offset = pos;
+    pos += (n + 1) * sizeof(uint64_t);
+    r.values_offset = pos;
+    pos = aligned(pos + f->second * sizeof(feature_type));
+    features.push_back(r);
+  }
+
+  // write
+  ofstream out(filename.c_str(), ios::out | ios::binary | ios::trunc);
+  if(!out) {
+    throw runtime_error("save_binary(): could not open file " + filename);
+  }
+  Writer w(out);
+  w.write(&header, sizeof(Header));
+  if(!timesteps.empty()) w.write(&timesteps[0], timesteps.size() * sizeof(TimestepRecord));
+  if(!records.empty()) w.write(&records[0], records.size() * sizeof(TraxelRecord));
+  if(!locators.empty()) w.write(&locators[0], locators.size() * sizeof(LocatorRecord));
+  if(!features.empty()) w.write(&features[0], features.size() * sizeof(FeatureRecord));
+
+  vector<char> present(n);
+  vector<uint64_t> offsets(n + 1);
+  size_t f_idx = 0;
+  for(map<string, uint64_t>::const_iterator f = n_values.begin(); f != n_values.end(); ++f, ++f_idx) {
+    w.write(f->first.data(), f->first.size());
+    w.pad();
+
+    vector<FeatureValues> columns(n);
+    offsets[0] = 0;
+    for(size_t i = 0; i < n; ++i) {
+      TraxelFeatures::const_iterator it = traxels[i]->features.find(f->first);
+      present[i] = it != traxels[i]->features.end();
+      if(present[i]) columns[i] = it->second;
+      offsets[i + 1] = offsets[i] + (present[i] ? it->second.size() : 0);
+    }
+    if(n > 0) w.write(&present[0], n);
+    w.pad();
+    w.write(&offsets[0], (n + 1) * sizeof(uint64_t));
+    for(size_t i = 0; i < n; ++i) {
+      if(!columns[i].empty()) {
+        w.write(columns[i].begin(), columns[i].size() * sizeof(feature_type));
+      }
+    }
+    w.pad();
+    LOG(logDEBUG2) << "save_binary(): wrote feature " << f->first << " at offset " << features[f_idx].values_offset;
+  }
+
+  if(!out) {
+    throw runtime_error("save_binary(): writing to file " + filename + " failed");
+  }
+  LOG(logDEBUG) << "save_binary(): wrote " << n << " traxels in " << w.pos() << " bytes to " << filename;
+}
+
+
+
+////
+//// class MappedTraxelStore
+////
+MappedTraxelStore::MappedTraxelStore(const std::string& filename)
+  : file_(filename) {
+  if(file_.size() < sizeof(Header)) {
+    throw runtime_error("MappedTraxelStore: file too small: " + filename);
+  }
+  header_ = reinterpret_cast<const Header*>(at(0, sizeof(Header)));
+  if(memcmp(header_->magic, magic, sizeof(magic)) != 0) {
+    throw runtime_error("MappedTraxelStore: not a binary traxelstore: " + filename);
+  }
+  if(header_->version != version) {
+    throw runtime_error("MappedTraxelStore: unsupported format version");
+  }
+  if(header_->byte_order != byte_order_mark) {
+    throw runtime_error("MappedTraxelStore: file was written with a different byte order");
+  }
+
+  const uint64_t n = header_->n_traxels;
+  check_aligned(header_->timestep_index_offset);
+  check_aligned(header_->traxel_table_offset);
+  check_aligned(header_->locator_table_offset);
+  check_aligned(header_->feature_table_offset);
+  const TimestepRecord* timestep_index = reinterpret_cast<const TimestepRecord*>(
+      at(header_->timestep_index_offset, section_bytes(header_->n_timesteps, sizeof(TimestepRecord))));
+  traxels_ = reinterpret_cast<const TraxelRecord*>(at(header_->traxel_table_offset,
+                                                       section_bytes(n, sizeof(TraxelRecord))));
+  locators_ = reinterpret_cast<const LocatorRecord*>(at(header_->locator_table_offset,
+                                                         section_bytes(header_->n_locators, sizeof(LocatorRecord))));
+  features_ = reinterpret_cast<const FeatureRecord*>(at(header_->feature_table_offset,
+                                                         section_bytes(header_->n_features, sizeof(FeatureRecord))));
+
+  // count() and load() binary search the index and read the ranges unchecked
+  for(uint64_t i = 0; i < header_->n_timesteps; ++i) {
+    const TimestepRecord& r = timestep_index[i];
+    if(i > 0 && r.timestep <= timestep_index[i - 1].timestep) {
+      throw runtime_error("MappedTraxelStore: timestep index is not sorted");
+    }
+    if(r.first > n || r.count > n - r.first) {
+      throw runtime_error("MappedTraxelStore: timestep index exceeds the traxel table");
+    }
+  }
+  for(uint64_t f = 0; f < header_->n_features; ++f) {
+    const FeatureRecord& r = features_[f];
+    feature_names_.push_back(string(at(r.name_offset, r.name_length), r.name_length));
+    at(r.present_offset, n);
+    check_aligned(r.offsets_offset);
+    check_aligned(r.values_offset);
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(
+        at(r.offsets_offset, section_bytes(n + 1, sizeof(uint64_t))));
+    // monotonic offsets keep every value range within offsets[n]
+    for(uint64_t i = 0; i < n; ++i) {
+      if(offsets[i] > offsets[i + 1]) {
+        throw runtime_error("MappedTraxelStore: corrupt value offsets of feature " + feature_names_.back());
+      }
+    }
+    at(r.values_offset, section_bytes(offsets[n], sizeof(feature_type)));
+  }
+  for(uint64_t l = 0; l < header_->n_locators; ++l) {
+    shared_locators_.push_back(boost::shared_ptr<Locator>(locator_from(locators_[l])));
+  }
+  for(uint64_t i = 0; i < n; ++i) {
+    if(traxels_[i].locator >= header_->n_locators) {
+      throw runtime_error("MappedTraxelStore: corrupt traxel table");
+    }
+  }
+  LOG(logDEBUG) << "MappedTraxelStore: mapped " << n << " traxels in " << header_->n_timesteps
+                << " timesteps from " << filename;
+}
+
+const char* MappedTraxelStore::at(boost::uint64_t offset, boost::uint64_t length) const {
+  if(offset > file_.size() || length > file_.size() - offset) {
+    throw runtime_error("MappedTraxelStore: section exceeds file size");
+  }
+  return file_.data() + offset;
+}
+
+const TimestepRecord* MappedTraxelStore::timestep_begin() const {
+  return reinterpret_cast<const TimestepRecord*>(file_.data() + header_->timestep_index_offset);
+}
+
+const TimestepRecord* MappedTraxelStore::timestep_end() const {
+  return timestep_begin() + header_->n_timesteps;
+}
+
+std::vector<int> MappedTraxelStore::timesteps() const {
+  vector<int> ret;
+  for(const TimestepRecord* it = timestep_begin(); it != timestep_end(); ++it) {
+    ret.push_back(it->timestep);
+  }
+  return ret;
+}
+
+size_t MappedTraxelStore::count(int timestep) const {
+  const TimestepRecord* it = lower_bound(timestep_begin(), timestep_end(), timestep, TimestepLess());
+  if(it != timestep_end() && it->timestep == timestep) {
+    return static_cast<size_t>(it->count);
+  }
+  return 0;
+}
+
+Traxel MappedTraxelStore::traxel(size_t index) const {
+  const TraxelRecord& r = traxels_[index];
+  FeatureMap features;
+  for(size_t f = 0; f < feature_names_.size(); ++f) {
+    const char* present = file_.data() + features_[f].present_offset;
+    if(!present[index]) {
+      continue;
+    }
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(file_.data() + features_[f].offsets_offset);
+    const feature_type* values = reinterpret_cast<const feature_type*>(file_.data() + features_[f].values_offset);
+    features[feature_names_[f]] = feature_array(values + offsets[index], values + offsets[index + 1]);
+  }
+  Traxel t(r.id, r.timestep, features);
+  t.set_locator(shared_locators_[r.locator]);
+  return t;
+}
+
+size_t MappedTraxelStore::load(TraxelStore& ts, int first, int last) const {
+  size_t n = 0;
+  for(const TimestepRecord* it = lower_bound(timestep_begin(), timestep_end(), first, TimestepLess());
+      it != timestep_end() && it->timestep <= last; ++it) {
+    for(uint64_t i = it->first; i < it->first + it->count; ++i, ++n) {
+      add(ts, traxel(static_cast<size_t>(i)));
+    }
+  }
+  return n;
+}
+
+size_t MappedTraxelStore::load(TraxelStore& ts) const {
+  if(header_->n_timesteps == 0) {
+    return 0;
+  }
+  return load(ts, timestep_begin()->timestep, (timestep_end() - 1)->timestep);
+}
+
+
+
+////
+//// load_binary
+////
+void load_binary(TraxelStore& ts, const std::string& filename) {
+  MappedTraxelStore(filename).load(ts);
+}
+
+
+
+
+////
+//// class StreamingTraxelStore
+////
+StreamingTraxelStore::StreamingTraxelStore(const std::string& filename, size_t window_size)
+  : source_(filename), window_size_(window_size), has_window_(false), lo_(0), hi_(-1) {
+  if(window_size_ == 0) {
+    throw invalid_argument("StreamingTraxelStore: window size has to be positive");
+  }
+}
+
+const TraxelStore& StreamingTraxelStore::require(int first, int last) {
+  if(last < first) {
+    throw invalid_argument("StreamingTraxelStore::require(): empty timestep range");
+  }
+  const long size = static_cast<long>(window_size_);
+  if(static_cast<long>(last) - first + 1 > size) {
+    throw invalid_argument("StreamingTraxelStore::require(): range exceeds window size");
+  }
+  if(has_window_ && lo_ <= first && last <= hi_) {
+    return resident_;
+  }
+
+  // move the window and prefetch in the direction of the request
+  long lo, hi;
+  if(!has_window_ || first >= lo_) {
+    lo = first;
+    hi = first + size - 1;
+  } else {
+    hi = last;
+    lo = last - size + 1;
+  }
+
+  // page out
+  TraxelStoreBase& base = resident_;
+  TraxelStoreByTimestep& by_t = base.get<by_timestep>();
+  if(has_window_) {
+    by_t.erase(by_t.begin(), by_t.lower_bound(static_cast<int>(max(lo, static_cast<long>(INT_MIN)))));
+    by_t.erase(by_t.upper_bound(static_cast<int>(min(hi, static_cast<long>(INT_MAX)))), by_t.end());
+    resident_.invalidate_aggregates();
+  }
+
+  // page in what is not resident yet
+  const int new_lo = static_cast<int>(max(lo, static_cast<long>(INT_MIN)));
+  const int new_hi = static_cast<int>(min(hi, static_cast<long>(INT_MAX)));
+  size_t n = 0;
+  if(!has_window_ || new_hi < lo_ || hi_ < new_lo) {
+    n += source_.load(resident_, new_lo, new_hi);
+  } else {
+    if(new_lo < lo_) n += source_.load(resident_, new_lo, lo_ - 1);
+    if(hi_ < new_hi) n += source_.load(resident_, hi_ + 1, new_hi);
+  }
+  LOG(logDEBUG1) << "StreamingTraxelStore::require(): window [" << new_lo << ", " << new_hi
+                 << "], paged in " << n << " traxels, " << resident_.size() << " resident";
+
+  lo_ = new_lo;
+  hi_ = new_hi;
+  has_window_ = true;
+  return resident_;
+}
+
+bool StreamingTraxelStore::is_resident(int timestep) const {
+  return has_window_ && lo_ <= timestep && timestep <= hi_;
+}
+
+} /* namespace pgmlink */
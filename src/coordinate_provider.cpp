@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pgmlink/coordinate_provider.h"
+#include "pgmlink/log.h"
+
+using namespace std;
+using boost::uint32_t;
+using boost::uint64_t;
+
+namespace pgmlink {
+using namespace binary_coordinates;
+
+namespace {
+  // the coordinates belong to the map or the mapped file
+  struct NullDeleter {
+    void operator()(const void*) const {}
+  };
+
+  bool entry_less(const EntryRecord& a, const EntryRecord& b) {
+    return a.timestep < b.timestep || (a.timestep == b.timestep && a.id < b.id);
+  }
+
+  bool same_entry(const EntryRecord& a, const EntryRecord& b) {
+    return a.timestep == b.timestep && a.id == b.id;
+  }
+
+  uint64_t section_bytes(uint64_t count, uint64_t size) {
+    if(size != 0 && count > numeric_limits<uint64_t>::max() / size) {
+      throw runtime_error("MappedCoordinateFile: section size overflows");
+    }
+    return count * size;
+  }
+
+  // the index and the coordinates are read in place as 64 bit values
+  void check_aligned(uint64_t offset) {
+    if(offset % sizeof(double) != 0) {
+      throw runtime_error("MappedCoordinateFile: misaligned section");
+    }
+  }
+}
+
+
+
+////
+//// class MapCoordinateProvider
+////
+MapCoordinateProvider::MapCoordinateProvider(TimestepIdCoordinateMapPtr coordinates)
+  : coordinates_(coordinates) {
+  if(!coordinates_) {
+    throw invalid_argument("MapCoordinateProvider: no coordinate map");
+  }
+}
+
+CoordinatesPtr MapCoordinateProvider::coordinates(int timestep, unsigned id) const {
+  TimestepIdCoordinateMap::const_iterator it = coordinates_->find(make_pair(timestep, id));
+  if(it == coordinates_->end()) {
+    return CoordinatesPtr();
+  }
+  return CoordinatesPtr(&it->second, NullDeleter());
+}
+
+
+
+////
+//// class CoordinateFileWriter
+////
+CoordinateFileWriter::CoordinateFileWriter(const std::string& filename)
+  : filename_(filename),
+    out_(filename.c_str(), ios::out | ios::binary | ios::trunc),
+    pos_(sizeof(Header)),
+    closed_(false) {
+  if(!out_) {
+    throw runtime_error("CoordinateFileWriter: could not open file " + filename);
+  }
+  // the header is written by close()
+  const Header placeholder = Header();
+  out_.write(reinterpret_cast<const char*>(&placeholder), sizeof(Header));
+}
+
+CoordinateFileWriter::~CoordinateFileWriter() {
+  if(!closed_) {
+    try {
+      close();
+    } catch(std::exception& e) {
+      LOG(logERROR) << "CoordinateFileWriter: " << e.what();
+    }
+  }
+}
+
+void CoordinateFileWriter::add(int timestep, unsigned id, const arma::mat& coordinates) {
+  if(closed_) {
+    throw runtime_error("CoordinateFileWriter::add(): file already closed");
+  }
+  EntryRecord r;
+  r.timestep = timestep;
+  r.id = id;
+  r.n_rows = static_cast<uint32_t>(coordinates.n_rows);
+  r.padding = 0;
+  r.n_cols = coordinates.n_cols;
+  r.offset = pos_;
+  const uint64_t length = coordinates.n_elem * sizeof(double);
+  out_.write(reinterpret_cast<const char*>(coordinates.memptr()), static_cast<streamsize>(length));
+  pos_ += length;
+  index_.push_back(r);
+}
+
+void CoordinateFileWriter::close() {
+  if(closed_) {
+    return;
+  }
+  closed_ = true;
+  stable_sort(index_.begin(), index_.end(), entry_less);
+  if(adjacent_find(index_.begin(), index_.end(), same_entry) != index_.end()) {
+    throw runtime_error("CoordinateFileWriter: traxel added twice to " + filename_);
+  }
+
+  Header header;
+  memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byte_order = byte_order_mark;
+  header.n_entries = index_.size();
+  header.index_offset = pos_;
+  if(!index_.empty()) {
+    out_.write(reinterpret_cast<const char*>(&index_[0]), index_.size() * sizeof(EntryRecord));
+  }
+  out_.seekp(0);
+  out_.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  out_.close();
+  if(!out_) {
+    throw runtime_error("CoordinateFileWriter: writing to file " + filename_ + " failed");
+  }
+  LOG(logDEBUG) << "CoordinateFileWriter: wrote " << index_.size() << " traxels to " << filename_;
+}
+
+void save_coordinates(const TimestepIdCoordinateMap& coordinates, const std::string& filename) {
+  CoordinateFileWriter writer(filename);
+  for(TimestepIdCoordinateMap::const_iterator it = coordinates.begin(); it != coordinates.end(); ++it) {
+    writer.add(it->first.first, it->first.second, it->second);
+  }
+  writer.close();
+}
+
+
+
+////
+//// class MappedCoordinateFile
+////
+MappedCoordinateFile::MappedCoordinateFile(const std::string& filename)
+  : file_(filename) {
+  if(file_.size() < sizeof(Header)) {
+    throw runtime_error("MappedCoordinateFile: file too small: " + filename);
+  }
+  header_ = reinterpret_cast<const Header*>(at(0, sizeof(Header)));
+  if(memcmp(header_->magic, magic, sizeof(magic)) != 0) {
+    throw runtime_error("MappedCoordinateFile: not a binary coordinate file: " + filename);
+  }
+  if(header_->version != version) {
+    throw runtime_error("MappedCoordinateFile: unsupported format version");
+  }
+  if(header_->byte_order != byte_order_mark) {
+    throw runtime_error("MappedCoordinateFile: file was written with a different byte order");
+  }
+  check_aligned(header_->index_offset);
+  index_ = reinterpret_cast<const EntryRecord*>(at(header_->index_offset,
+                                                   section_bytes(header_->n_entries, sizeof(EntryRecord))));
+  // coordinates() binary searches the index and reads the entries unchecked
+  for(uint64_t i = 0; i < header_->n_entries; ++i) {
+    const EntryRecord& r = index_[i];
+    if(i > 0 && !entry_less(index_[i - 1], r)) {
+      throw runtime_error("MappedCoordinateFile: index is not sorted");
+    }
+    check_aligned(r.offset);
+    at(r.offset, section_bytes(section_bytes(r.n_rows, r.n_cols), sizeof(double)));
+  }
+  LOG(logDEBUG) << "MappedCoordinateFile: mapped " << header_->n_entries << " traxels from " << filename;
+}
+
+const char* MappedCoordinateFile::at(boost::uint64_t offset, boost::uint64_t length) const {
+  if(offset > file_.size() || length > file_.size() - offset) {
+    throw runtime_error("MappedCoordinateFile: section exceeds file size");
+  }
+  return file_.data() + offset;
+}
+
+CoordinatesPtr MappedCoordinateFile::coordinates(int timestep, unsigned id) const {
+  EntryRecord key;
+  key.timestep = timestep;
+  key.id = id;
+  const EntryRecord* end = index_ + header_->n_entries;
+  const EntryRecord* it = lower_bound(index_, end, key, entry_less);
+  if(it == end || !same_entry(*it, key)) {
+    return CoordinatesPtr();
+  }
+  // a read only view of the mapping
+  double* values = const_cast<double*>(reinterpret_cast<const double*>(file_.data() + it->offset));
+  return CoordinatesPtr(new arma::mat(values, it->n_rows, it->n_cols, false, true));
+}
+
+} /* namespace pgmlink */
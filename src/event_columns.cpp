@@ -0,0 +1,70 @@
+#include <algorithm>
+
+#include "pgmlink/event_columns.h"
+
+using namespace std;
+
+namespace pgmlink {
+  ////
+  //// class EventColumns::Table
+  ////
+  void EventColumns::Table::add(int timestep, const Event& e) {
+    timesteps_.push_back(timestep);
+    energies_.push_back(e.energy());
+    flat_ids_.insert(flat_ids_.end(), e.traxel_ids.begin(), e.traxel_ids.end());
+    offsets_.push_back(flat_ids_.size());
+    width_ = max(width_, e.traxel_ids.size());
+  }
+
+  void EventColumns::Table::ids(boost::uint64_t* out) const {
+    for(size_t r = 0; r < size(); ++r, out += width_) {
+      const boost::uint64_t* begin = flat_ids_.empty() ? 0 : &flat_ids_[0] + offsets_[r];
+      const boost::uint64_t* end = flat_ids_.empty() ? 0 : &flat_ids_[0] + offsets_[r + 1];
+      fill(copy(begin, end, out), out + width_, missing_id);
+    }
+  }
+
+  vector<boost::uint64_t> EventColumns::Table::ids() const {
+    vector<boost::uint64_t> ret(size() * width_);
+    if(!ret.empty()) {
+      ids(&ret[0]);
+    }
+    return ret;
+  }
+
+
+
+  ////
+  //// class EventColumns
+  ////
+  const boost::uint64_t EventColumns::missing_id;
+
+  EventColumns::EventColumns(int first_timestep)
+    : first_timestep_(first_timestep), tables_(Event::Void + 1) {
+  }
+
+  void EventColumns::timestep(size_t slot, vector<Event>& events) {
+    const int t = first_timestep_ + static_cast<int>(slot);
+    for(vector<Event>::const_iterator e = events.begin(); e != events.end(); ++e) {
+      tables_[e->type].add(t, *e);
+    }
+  }
+
+  EventColumns& EventColumns::add(const vector<vector<Event> >& events) {
+    for(size_t slot = 0; slot < events.size(); ++slot) {
+      const int t = first_timestep_ + static_cast<int>(slot);
+      for(vector<Event>::const_iterator e = events[slot].begin(); e != events[slot].end(); ++e) {
+        tables_[e->type].add(t, *e);
+      }
+    }
+    return *this;
+  }
+
+  size_t EventColumns::size() const {
+    size_t n = 0;
+    for(vector<Table>::const_iterator it = tables_.begin(); it != tables_.end(); ++it) {
+      n += it->size();
+    }
+    return n;
+  }
+} /* namespace pgmlink */
@@ -1,7 +1,9 @@
 #include "pgmlink/feature.h"
 #include "pgmlink/log.h"
+#include <algorithm>
 #include <cmath>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -12,24 +14,114 @@ namespace pgmlink {
   double GeometryDivision2::operator()(const Traxel& ancestor,
 				       const Traxel& child1,
 				       const Traxel& child2) const {
+    if( dimensions_ == 2 ) {
+      return evaluate<2>(ancestor, child1, child2);
+    }
+    return evaluate<3>(ancestor, child1, child2);
+  }
+
+  template <int Dimensions>
+  double GeometryDivision2::evaluate(const Traxel& ancestor,
+				     const Traxel& child1,
+				     const Traxel& child2) const {
     double feature = 0;    
 
     if( angle_constraint_ ) {
       double pi = acos(-1.);
-      double angle = ancestor.angle(child1, child2);
+      double angle = ancestor.angle<Dimensions>(child1, child2);
       if (angle/pi < min_angle_) {
 	feature += 10000000000000;
       }
     }
 	
     if( distance_dependence_ ) {
-      feature += (ancestor.distance_to(child1)-mean_div_dist_) * (ancestor.distance_to(child1)-mean_div_dist_);
-      feature += (ancestor.distance_to(child2)-mean_div_dist_) * (ancestor.distance_to(child2)-mean_div_dist_);
+      const double d1 = ancestor.distance_to<Dimensions>(child1) - mean_div_dist_;
+      const double d2 = ancestor.distance_to<Dimensions>(child2) - mean_div_dist_;
+      feature += d1 * d1;
+      feature += d2 * d2;
     }
 
     return feature;
   }
 
+  namespace {
+    // offsets of the children from the ancestor and their lengths
+    struct ChildOffsets {
+      std::vector<double> dx, dy, dz, length;
+    };
+
+    template <int Dimensions>
+    void child_offsets(const Traxel& ancestor, const std::vector<const Traxel*>& children, ChildOffsets& o) {
+      const size_t n = children.size();
+      o.dx.resize(n);
+      o.dy.resize(n);
+      o.dz.assign(n, 0.);
+      o.length.resize(n);
+      const double x0 = ancestor.X(), y0 = ancestor.Y();
+      const double z0 = Dimensions == 3 ? ancestor.Z() : 0.;
+      for (size_t i = 0; i < n; ++i) {
+        o.dx[i] = children[i]->X() - x0;
+        o.dy[i] = children[i]->Y() - y0;
+        if (Dimensions == 3) {
+          o.dz[i] = children[i]->Z() - z0;
+          o.length[i] = std::sqrt(o.dx[i]*o.dx[i] + o.dy[i]*o.dy[i] + o.dz[i]*o.dz[i]);
+        } else {
+          o.length[i] = std::sqrt(o.dx[i]*o.dx[i] + o.dy[i]*o.dy[i]);
+        }
+      }
+    }
+  }
+
+  void GeometryDivision2::score_pairs(const Traxel& ancestor,
+				      const std::vector<const Traxel*>& children,
+				      std::vector<double>& pair_features) const {
+    if( dimensions_ == 2 ) {
+      score_pairs_in<2>(ancestor, children, pair_features);
+    } else {
+      score_pairs_in<3>(ancestor, children, pair_features);
+    }
+  }
+
+  template <int Dimensions>
+  void GeometryDivision2::score_pairs_in(const Traxel& ancestor,
+					 const std::vector<const Traxel*>& children,
+					 std::vector<double>& pair_features) const {
+    const size_t n = children.size();
+    pair_features.clear();
+    if (n < 2) {
+      return;
+    }
+    pair_features.reserve(n * (n - 1) / 2);
+    ChildOffsets o;
+    child_offsets<Dimensions>(ancestor, children, o);
+
+    std::vector<double> shifted(n, 0.);
+    if( distance_dependence_ ) {
+      for (size_t i = 0; i < n; ++i) {
+        const double d = o.length[i] - mean_div_dist_;
+        shifted[i] = d * d;
+      }
+    }
+
+    // angle/pi < min_angle_ <=> cos(angle) > cos(min_angle_*pi) for
+    // min_angle_ in [0, 1]; a cosine out of [-1, 1] (from a child at the
+    // position of the ancestor) has no angle, as with acos()
+    const double pi = acos(-1.);
+    const bool always = min_angle_ > 1;
+    const bool never = !angle_constraint_ || min_angle_ <= 0;
+    const double min_cos = always ? -1. : cos(min_angle_ * pi);
+
+    std::vector<double> row(n);
+    for (size_t i = 0; i + 1 < n; ++i) {
+      for (size_t j = i + 1; j < n; ++j) {
+        const double c = (o.dx[i]*o.dx[j] + o.dy[i]*o.dy[j] + o.dz[i]*o.dz[j]) / (o.length[i] * o.length[j]);
+        const bool violated = !never && (always ? c >= -1. : c > min_cos) && c <= 1.;
+        row[j] = (violated ? 10000000000000 : 0.) + shifted[i] + shifted[j];
+      }
+      pair_features.insert(pair_features.end(), row.begin() + i + 1, row.end());
+    }
+  }
+
 
 
   ////
@@ -45,9 +137,31 @@ namespace pgmlink {
     return w_*(feature + div_cost_);
   }
 
+  void KasterDivision2::score_pairs(const Traxel& ancestor,
+				    const std::vector<const Traxel*>& children,
+				    std::vector<double>& pair_features) const {
+    const size_t n = children.size();
+    pair_features.clear();
+    if (n < 2) {
+      return;
+    }
+    pair_features.reserve(n * (n - 1) / 2);
+    ChildOffsets o;
+    child_offsets<3>(ancestor, children, o);
+    std::vector<double> squared(n);
+    for (size_t i = 0; i < n; ++i) {
+      squared[i] = o.length[i] * o.length[i];
+    }
+    for (size_t i = 0; i + 1 < n; ++i) {
+      for (size_t j = i + 1; j < n; ++j) {
+        pair_features.push_back(w_*((0 + squared[i]) + squared[j] + div_cost_));
+      }
+    }
+  }
+
   namespace {
     double get_cellness(const Traxel& tr) {
-      FeatureMap::const_iterator it = tr.features.find("cellness");
+      TraxelFeatures::const_iterator it = tr.features.find("cellness");
       if(it == tr.features.end()) {
 	throw runtime_error("get_cellness(): cellness feature not in traxel");
       }
@@ -57,7 +171,7 @@ namespace pgmlink {
     }
 
   double get_detection_prob(const Traxel& tr, size_t state) {
-	  FeatureMap::const_iterator it = tr.features.find("detProb");
+	  TraxelFeatures::const_iterator it = tr.features.find("detProb");
 	  if (it == tr.features.end()) {
 		  throw runtime_error("get_detection_prob(): divProb feature not in traxel");
 	  }
@@ -67,7 +181,7 @@ namespace pgmlink {
   }
 
   double get_division_prob(const Traxel& tr) {
-	  FeatureMap::const_iterator it = tr.features.find("divProb");
+	  TraxelFeatures::const_iterator it = tr.features.find("divProb");
 	  if (it == tr.features.end()) {
 		  throw runtime_error("get_division_prob(): divProb feature not in traxel");
 	  }
@@ -122,16 +236,6 @@ double NegLnDivision::operator ()(const Traxel& tr, size_t state) const {
 }
 
 
-////
-//// class NegLnTransition
-////
-double NegLnTransition::operator ()(const double dist_prob) const {
-	double arg = dist_prob;
-    if(arg < 0.0000000001) arg = 0.0000000001;
-	return w_*-1*log(arg);
-}
-
-
 ////
 //// class NegLnConstant
 ////
@@ -147,15 +251,6 @@ double NegLnConstant::operator ()(size_t state) const {
 
 
 
-  ////
-  //// class SquaredDistance
-  ////
-  double SquaredDistance::operator()(const Traxel& t1,
-				     const Traxel& t2) const {
-    return t1.distance_to(t2);
-  }
-    
-
     
   ////
   //// class KasterDivison
@@ -198,9 +293,9 @@ double NegLnConstant::operator ()(size_t state) const {
                                       const Traxel& child1,
                                       const Traxel& child2) const {
     // calculate distance
-    FeatureMap::const_iterator pAncestor = ancestor.features.find("com");
-    FeatureMap::const_iterator pChild1 = child1.features.find("com");
-    FeatureMap::const_iterator pChild2 = child2.features.find("com");
+    TraxelFeatures::const_iterator pAncestor = ancestor.features.find("com");
+    TraxelFeatures::const_iterator pChild1 = child1.features.find("com");
+    TraxelFeatures::const_iterator pChild2 = child2.features.find("com");
     
     double dist1 = 0;
     double dist2 = 0;
@@ -219,9 +314,9 @@ double NegLnConstant::operator ()(size_t state) const {
       }
     
     // incorporate cellness
-    FeatureMap::const_iterator cAncestor = ancestor.features.find("cellness");
-    FeatureMap::const_iterator cChild1 = child1.features.find("cellness");
-    FeatureMap::const_iterator cChild2 = child2.features.find("cellness");
+    TraxelFeatures::const_iterator cAncestor = ancestor.features.find("cellness");
+    TraxelFeatures::const_iterator cChild1 = child1.features.find("cellness");
+    TraxelFeatures::const_iterator cChild2 = child2.features.find("cellness");
     
     double cellness = 0; // cellness of ancestor
     double dcellness12 = 0; // cellness difference child1-child2
@@ -273,8 +368,8 @@ double NegLnConstant::operator ()(size_t state) const {
   double CellnessMove::operator()(const Traxel& from, 
                                   const Traxel& to) const {
     // calculate distance
-    FeatureMap::const_iterator pFrom = from.features.find("com");
-    FeatureMap::const_iterator pTo = to.features.find("com");
+    TraxelFeatures::const_iterator pFrom = from.features.find("com");
+    TraxelFeatures::const_iterator pTo = to.features.find("com");
     
     double dist = 0;
     if(pFrom != from.features.end() && pTo != to.features.end())
@@ -286,8 +381,8 @@ double NegLnConstant::operator ()(size_t state) const {
       }
     
     // incorporate cellness
-    FeatureMap::const_iterator cFrom = from.features.find("cellness");
-    FeatureMap::const_iterator cTo = to.features.find("cellness");
+    TraxelFeatures::const_iterator cFrom = from.features.find("cellness");
+    TraxelFeatures::const_iterator cTo = to.features.find("cellness");
     
     double dcellness = 0;
     if(cFrom != from.features.end() && cTo != to.features.end())
@@ -322,7 +417,7 @@ double NegLnConstant::operator ()(size_t state) const {
 
   double CellnessDisappearance::operator()(const Traxel& from) const {
     // incorporate cellness
-    FeatureMap::const_iterator cFrom = from.features.find("cellness");
+    TraxelFeatures::const_iterator cFrom = from.features.find("cellness");
     if(cFrom == from.features.end()) {
       throw runtime_error("CellnessDisappearance::operator(): cellness feature not in traxel");
     }
@@ -353,7 +448,7 @@ double NegLnConstant::operator ()(size_t state) const {
 
   double CellnessAppearance::operator()(const Traxel& to) const {
     // incorporate cellness
-    FeatureMap::const_iterator cTo = to.features.find("cellness");
+    TraxelFeatures::const_iterator cTo = to.features.find("cellness");
     if(cTo == to.features.end()) {
       throw runtime_error("CellnessDisappearance::operator(): cellness feature not in traxel");
     }
@@ -378,9 +473,12 @@ double NegLnConstant::operator ()(size_t state) const {
   //// SpatialBorderAwareWeight
   ////
  double SpatialBorderAwareWeight::operator()( const Traxel& tr ) const {
-	double t = tr.Timestep;
-	double x = tr.X(), y = tr.Y(), z = tr.Z();
-	double distance_to_border = fov_.spatial_distance_to_border(t,x,y,z,relative_);
+	double distance_to_border;
+	if (!distances_ || !distances_->find(tr, distance_to_border)) {
+	  double t = tr.Timestep;
+	  double x = tr.X(), y = tr.Y(), z = tr.Z();
+	  distance_to_border = fov_.spatial_distance_to_border(t,x,y,z,relative_);
+	}
 	LOG(logDEBUG4) << "SpatialBorderAwareWeight(): distance to border = " << distance_to_border;
 	if( distance_to_border < margin_) {
 	  double linear_cost = (distance_to_border / margin_) * cost_; //normalize distance within the border to range (0,1)
@@ -392,5 +490,48 @@ double NegLnConstant::operator ()(size_t state) const {
 	}
   }
 
+  SpatialBorderAwareWeight& SpatialBorderAwareWeight::use_border_distances(
+      const boost::shared_ptr<const BorderDistances>& distances ) {
+    distances_ = distances;
+    return *this;
+  }
+
+  ////
+  //// BorderDistances
+  ////
+  BorderDistances::BorderDistances( const TraxelStore& ts, const FieldOfView& fov, bool relative ) {
+    vector<pair<pair<int, unsigned int>, const Traxel*> > traxels;
+    traxels.reserve(ts.size());
+    for (TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+      traxels.push_back(make_pair(make_pair(it->Timestep, it->Id), &*it));
+    }
+    sort(traxels.begin(), traxels.end());
+
+    vector<double> xyz;
+    xyz.reserve(3 * traxels.size());
+    keys_.reserve(traxels.size());
+    for (size_t i = 0; i < traxels.size(); ++i) {
+      keys_.push_back(traxels[i].first);
+      xyz.push_back(traxels[i].second->X());
+      xyz.push_back(traxels[i].second->Y());
+      xyz.push_back(traxels[i].second->Z());
+    }
+    distances_.resize(keys_.size());
+    if (!keys_.empty()) {
+      fov.spatial_distances_to_border(&xyz[0], keys_.size(), relative, &distances_[0]);
+    }
+    LOG(logDEBUG) << "BorderDistances: " << keys_.size() << " traxels";
+  }
+
+  bool BorderDistances::find( const Traxel& tr, double& distance ) const {
+    const pair<int, unsigned int> key(tr.Timestep, tr.Id);
+    vector<pair<int, unsigned int> >::const_iterator it = lower_bound(keys_.begin(), keys_.end(), key);
+    if (it == keys_.end() || *it != key) {
+      return false;
+    }
+    distance = distances_[it - keys_.begin()];
+    return true;
+  }
+
 
 } /* namespace pgmlink */
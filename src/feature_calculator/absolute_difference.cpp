@@ -1,3 +1,6 @@
+// stl
+#include <algorithm>
+
 #include "pgmlink/feature.h"
 #include "pgmlink/feature_calculator/absolute_difference.h"
 
@@ -29,6 +32,22 @@ feature_array AbsoluteDifferenceCalculator::calculate(const feature_array&f1, co
 }
 
 
+void AbsoluteDifferenceCalculator::calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                                                   feature_type* out, size_t out_stride) const {
+  for (size_t i = 0; i < n; ++i, f1 += size, f2 += size, out += out_stride) {
+    feature_type sum = 0.;
+    for (size_t j = 0; j < size; ++j) {
+      const feature_type diff = f1[j] - f2[j];
+      sum += diff > 0 ? diff : -diff;
+    }
+    std::fill(out, out + size, 0.);
+    if (size > 0) {
+      out[0] = sum;
+    }
+  }
+}
+
+
 const std::string& AbsoluteDifferenceCalculator::name() const {
   return AbsoluteDifferenceCalculator::name_;
 }
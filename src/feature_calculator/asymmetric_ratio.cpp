@@ -35,6 +35,19 @@ feature_array AsymmetricRatioCalculator::calculate(const feature_array& f1, cons
 }
 
 
+void AsymmetricRatioCalculator::calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                                                feature_type* out, size_t out_stride) const {
+  for (size_t i = 0; i < n; ++i, f1 += size, f2 += size, out += out_stride) {
+    for (size_t j = 0; j < size; ++j) {
+      const feature_type a = f1[j];
+      const feature_type b = f2[j];
+      const bool one = a == b || (a < 0.0001 && b < 0.0001);
+      out[j] = one ? 1.0f : a / b;
+    }
+  }
+}
+
+
 feature_array AsymmetricRatioCalculator::calculate(const feature_array&, const feature_array& f2, const feature_array& f3) const {
   return calculate(f2, f3);
 }
@@ -1,3 +1,7 @@
+// stl
+#include <algorithm>
+#include <stdexcept>
+
 // pgmlink
 #include "pgmlink/feature.h"
 #include "pgmlink/feature_calculator/base.h"
@@ -34,6 +38,37 @@ const std::string& FeatureCalculator::name() const {
 }
 
 
+size_t FeatureCalculator::output_size(size_t input_size) const {
+  return input_size;
+}
+
+
+void FeatureCalculator::calculate_batch(const feature_type* f1, size_t n, size_t size,
+                                        feature_type* out, size_t out_stride) const {
+  const size_t out_size = output_size(size);
+  for (size_t i = 0; i < n; ++i, f1 += size, out += out_stride) {
+    const feature_array result = calculate(feature_array(f1, f1 + size));
+    if (result.size() != out_size) {
+      throw std::runtime_error("FeatureCalculator::calculate_batch(): output_size() of " + name() + " is wrong");
+    }
+    std::copy(result.begin(), result.end(), out);
+  }
+}
+
+
+void FeatureCalculator::calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                                        feature_type* out, size_t out_stride) const {
+  const size_t out_size = output_size(size);
+  for (size_t i = 0; i < n; ++i, f1 += size, f2 += size, out += out_stride) {
+    const feature_array result = calculate(feature_array(f1, f1 + size), feature_array(f2, f2 + size));
+    if (result.size() != out_size) {
+      throw std::runtime_error("FeatureCalculator::calculate_batch(): output_size() of " + name() + " is wrong");
+    }
+    std::copy(result.begin(), result.end(), out);
+  }
+}
+
+
 bool FeatureCalculator::operator==(const FeatureCalculator& other) {
   return this->name_ == other.name();
 }
@@ -33,6 +33,17 @@ feature_array ElementWiseSquaredDistanceCalculator::calculate(const feature_arra
 }
 
 
+void ElementWiseSquaredDistanceCalculator::calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                                                           feature_type* out, size_t out_stride) const {
+  for (size_t i = 0; i < n; ++i, f1 += size, f2 += size, out += out_stride) {
+    for (size_t j = 0; j < size; ++j) {
+      const feature_type diff = f1[j] - f2[j];
+      out[j] = diff * diff;
+    }
+  }
+}
+
+
 const std::string& ElementWiseSquaredDistanceCalculator::name() const {
   return name_;
 }
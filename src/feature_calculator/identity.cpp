@@ -1,3 +1,6 @@
+// stl
+#include <algorithm>
+
 #include "pgmlink/feature.h"
 #include "pgmlink/feature_calculator/identity.h"
 
@@ -20,6 +23,14 @@ feature_array IdentityCalculator::calculate(const feature_array& f1) const {
 }
 
 
+void IdentityCalculator::calculate_batch(const feature_type* f1, size_t n, size_t size,
+                                         feature_type* out, size_t out_stride) const {
+  for (size_t i = 0; i < n; ++i, f1 += size, out += out_stride) {
+    std::copy(f1, f1 + size, out);
+  }
+}
+
+
 const std::string& IdentityCalculator::name() const {
   return IdentityCalculator::name_;
 }
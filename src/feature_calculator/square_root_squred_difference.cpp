@@ -1,3 +1,6 @@
+// stl
+#include <algorithm>
+
 #include "pgmlink/feature.h"
 #include "pgmlink/feature_calculator/square_root_squared_difference.h"
 
@@ -27,6 +30,21 @@ feature_array SquareRootSquaredDifferenceCalculator::calculate(const feature_arr
 }
 
 
+void SquareRootSquaredDifferenceCalculator::calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                                                            feature_type* out, size_t out_stride) const {
+  for (size_t i = 0; i < n; ++i, f1 += size, f2 += size, out += out_stride) {
+    feature_type sum = 0.;
+    for (size_t j = 0; j < size; ++j) {
+      sum += (f1[j] - f2[j]) * (f1[j] - f2[j]);
+    }
+    std::fill(out, out + size, 0.);
+    if (size > 0) {
+      out[0] = sqrt(sum);
+    }
+  }
+}
+
+
 const std::string& SquareRootSquaredDifferenceCalculator::name() const {
   return SquareRootSquaredDifferenceCalculator::name_;
 }
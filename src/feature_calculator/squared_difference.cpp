@@ -1,3 +1,6 @@
+// stl
+#include <algorithm>
+
 #include "pgmlink/feature.h"
 #include "pgmlink/feature_calculator/squared_difference.h"
 
@@ -28,6 +31,21 @@ feature_array SquaredDifferenceCalculator::calculate(const feature_array& f1, co
 }
 
 
+void SquaredDifferenceCalculator::calculate_batch(const feature_type* f1, const feature_type* f2, size_t n, size_t size,
+                                                  feature_type* out, size_t out_stride) const {
+  for (size_t i = 0; i < n; ++i, f1 += size, f2 += size, out += out_stride) {
+    feature_type sum = 0.;
+    for (size_t j = 0; j < size; ++j) {
+      sum += (f1[j] - f2[j]) * (f1[j] - f2[j]);
+    }
+    std::fill(out, out + size, 0.);
+    if (size > 0) {
+      out[0] = sum;
+    }
+  }
+}
+
+
 const std::string& SquaredDifferenceCalculator::name() const {
   return SquaredDifferenceCalculator::name_;
 }
@@ -2,6 +2,7 @@
 #include <string>
 #include <stdexcept>
 #include <map>
+#include <vector>
 
 // boost
 #include <boost/shared_ptr.hpp>
@@ -20,6 +21,28 @@ namespace feature_extraction {
 // class FeatureCalculator;
 
 
+namespace {
+FeatureValues feature_of(const Traxel& t, const std::string& name) {
+  TraxelFeatures::const_iterator f = t.features.find(name);
+  if ( f == t.features.end() ) {
+    throw std::runtime_error("Feature " + name + " not present in traxel.");
+  }
+  return f->second;
+}
+
+void append_feature(const FeatureValues& f, size_t size, const std::string& name, feature_array& buffer) {
+  if ( f.size() != size ) {
+    throw std::runtime_error("Feature " + name + " differs in size between traxels.");
+  }
+  buffer.insert(buffer.end(), f.begin(), f.end());
+}
+
+feature_type* data(feature_array& f) {
+  return f.empty() ? 0 : &f[0];
+}
+}
+
+
 ////
 //// class FeatureExtractor
 ////
@@ -36,40 +59,72 @@ FeatureExtractor::~FeatureExtractor() {
 
 feature_array FeatureExtractor::extract(const Traxel& t1) const {
   LOG(logDEBUG4) << "FeatureExtractor::extract: feature " << feature_name_;
-  FeatureMap::const_iterator f1 = t1.features.find(feature_name_);
+  TraxelFeatures::const_iterator f1 = t1.features.find(feature_name_);
   if ( f1 == t1.features.end() ) {
     throw std::runtime_error("Feature " + feature_name_ + " not present in traxel.");
   }
-  feature_array features1 = f1->second;
-  LOG(logDEBUG4) << "FeatureExtractor::extract: feature[0] =  " << features1[0];
-  return calculator_->calculate(features1);
+  LOG(logDEBUG4) << "FeatureExtractor::extract: feature[0] =  " << f1->second[0];
+  return calculator_->calculate(f1->second);
 }
 
 
 feature_array FeatureExtractor::extract(const Traxel& t1, const Traxel& t2) const {
   LOG(logDEBUG4) << "FeatureExtractor::extract: feature " << feature_name_;
-  FeatureMap::const_iterator f1 = t1.features.find(feature_name_);
-  FeatureMap::const_iterator f2 = t2.features.find(feature_name_);
+  TraxelFeatures::const_iterator f1 = t1.features.find(feature_name_);
+  TraxelFeatures::const_iterator f2 = t2.features.find(feature_name_);
   if ( f1 == t1.features.end() || f2 == t2.features.end() ) {
     throw std::runtime_error("Feature " + feature_name_ + " not present in traxel.");
   }
-  feature_array features1 = f1->second;
-  feature_array features2 = f2->second;
-  return calculator_->calculate(features1, features2);
+  return calculator_->calculate(f1->second, f2->second);
 }
 
 
 feature_array FeatureExtractor::extract(const Traxel& t1, const Traxel& t2, const Traxel& t3) const {
-  FeatureMap::const_iterator f1 = t1.features.find(feature_name_);
-  FeatureMap::const_iterator f2 = t2.features.find(feature_name_);
-  FeatureMap::const_iterator f3 = t3.features.find(feature_name_);
+  TraxelFeatures::const_iterator f1 = t1.features.find(feature_name_);
+  TraxelFeatures::const_iterator f2 = t2.features.find(feature_name_);
+  TraxelFeatures::const_iterator f3 = t3.features.find(feature_name_);
   if ( f1 == t1.features.end() || f2 == t2.features.end() || f3 == t3.features.end() ) {
     throw std::runtime_error("Feature " + feature_name_ + " not present in traxel.");
   }
-  feature_array features1 = f1->second;
-  feature_array features2 = f2->second;
-  feature_array features3 = f3->second;
-  return calculator_->calculate(features1, features2, features3);
+  return calculator_->calculate(f1->second, f2->second, f3->second);
+}
+
+
+size_t FeatureExtractor::extract(const std::vector<const Traxel*>& traxels, feature_array& out) const {
+  out.clear();
+  if (traxels.empty()) {
+    return 0;
+  }
+  const size_t size = feature_of(*traxels.front(), feature_name_).size();
+  feature_array features1;
+  features1.reserve(traxels.size() * size);
+  for (std::vector<const Traxel*>::const_iterator t = traxels.begin(); t != traxels.end(); ++t) {
+    append_feature(feature_of(**t, feature_name_), size, feature_name_, features1);
+  }
+  const size_t out_size = calculator_->output_size(size);
+  out.resize(traxels.size() * out_size);
+  calculator_->calculate_batch(data(features1), traxels.size(), size, data(out), out_size);
+  return out_size;
+}
+
+
+size_t FeatureExtractor::extract(const std::vector<TraxelPair>& pairs, feature_array& out) const {
+  out.clear();
+  if (pairs.empty()) {
+    return 0;
+  }
+  const size_t size = feature_of(*pairs.front().first, feature_name_).size();
+  feature_array features1, features2;
+  features1.reserve(pairs.size() * size);
+  features2.reserve(pairs.size() * size);
+  for (std::vector<TraxelPair>::const_iterator p = pairs.begin(); p != pairs.end(); ++p) {
+    append_feature(feature_of(*p->first, feature_name_), size, feature_name_, features1);
+    append_feature(feature_of(*p->second, feature_name_), size, feature_name_, features2);
+  }
+  const size_t out_size = calculator_->output_size(size);
+  out.resize(pairs.size() * out_size);
+  calculator_->calculate_batch(data(features1), data(features2), pairs.size(), size, data(out), out_size);
+  return out_size;
 }
 
 
@@ -137,6 +192,131 @@ MultipleFeatureExtraction::CombinedFeatureMap MultipleFeatureExtraction::operato
 
 
 
+////
+//// class FeatureExtractionPlan
+////
+FeatureExtractionPlan::FeatureExtractionPlan( const MultipleFeatureExtraction::FeatureList& features,
+                                              boost::shared_ptr<FeatureSchema> schema )
+    : schema_(schema), has_layout_(false), row_size_(0) {
+  for ( MultipleFeatureExtraction::FeatureList::const_iterator outer_features = features.begin();
+        outer_features != features.end();
+        ++outer_features ) {
+    boost::shared_ptr<FeatureCalculator> calc = helpers::CalculatorLookup::extract_calculator( outer_features->first );
+    for ( std::vector<std::string>::const_iterator inner_features = outer_features->second.begin();
+          inner_features != outer_features->second.end();
+          ++inner_features ) {
+      Entry entry;
+      entry.name = std::make_pair( outer_features->first, *inner_features );
+      entry.calculator = calc;
+      entry.slot = schema_ ? schema_->intern( *inner_features ) : FeatureSchema::invalid_slot;
+      entry.input_size = 0;
+      entry.offset = 0;
+      entry.output_size = 0;
+      entries_.push_back( entry );
+    }
+  }
+}
+
+
+const feature_type* FeatureExtractionPlan::feature( const Entry& entry, const Traxel& trax, size_t& size ) const {
+  if ( schema_ && trax.feature_schema() == schema_ ) {
+    size = trax.feature_size( entry.slot );
+    if ( size > 0 ) {
+      return trax.feature( entry.slot );
+    }
+  }
+  // not interned with the schema of the plan, or an empty feature
+  const FeatureValues f = feature_of( trax, entry.name.second );
+  size = f.size();
+  return f.empty() ? 0 : f.begin();
+}
+
+
+void FeatureExtractionPlan::fix_layout( const Traxel& trax ) {
+  row_size_ = 0;
+  for ( std::vector<Entry>::iterator entry = entries_.begin(); entry != entries_.end(); ++entry ) {
+    feature( *entry, trax, entry->input_size );
+    entry->offset = row_size_;
+    entry->output_size = entry->calculator->output_size( entry->input_size );
+    row_size_ += entry->output_size;
+  }
+  has_layout_ = true;
+}
+
+
+void FeatureExtractionPlan::gather( const Entry& entry, const Traxel& trax, feature_array& buffer ) const {
+  size_t size;
+  const feature_type* f = feature( entry, trax, size );
+  if ( size != entry.input_size ) {
+    throw std::runtime_error("Feature " + entry.name.second + " differs in size from the layout of the plan.");
+  }
+  buffer.insert( buffer.end(), f, f + size );
+}
+
+
+size_t FeatureExtractionPlan::operator() ( const std::vector<const Traxel*>& traxels, feature_array& out ) {
+  out.clear();
+  if ( traxels.empty() ) {
+    return row_size_;
+  }
+  if ( !has_layout_ ) {
+    fix_layout( *traxels.front() );
+  }
+  out.resize( traxels.size() * row_size_ );
+  feature_array features1;
+  for ( std::vector<Entry>::const_iterator entry = entries_.begin(); entry != entries_.end(); ++entry ) {
+    features1.clear();
+    features1.reserve( traxels.size() * entry->input_size );
+    for ( std::vector<const Traxel*>::const_iterator t = traxels.begin(); t != traxels.end(); ++t ) {
+      gather( *entry, **t, features1 );
+    }
+    entry->calculator->calculate_batch( data(features1), traxels.size(), entry->input_size,
+                                        data(out) + entry->offset, row_size_ );
+  }
+  return row_size_;
+}
+
+
+size_t FeatureExtractionPlan::operator() ( const std::vector<FeatureExtractor::TraxelPair>& pairs, feature_array& out ) {
+  out.clear();
+  if ( pairs.empty() ) {
+    return row_size_;
+  }
+  if ( !has_layout_ ) {
+    fix_layout( *pairs.front().first );
+  }
+  out.resize( pairs.size() * row_size_ );
+  feature_array features1, features2;
+  for ( std::vector<Entry>::const_iterator entry = entries_.begin(); entry != entries_.end(); ++entry ) {
+    features1.clear();
+    features2.clear();
+    features1.reserve( pairs.size() * entry->input_size );
+    features2.reserve( pairs.size() * entry->input_size );
+    for ( std::vector<FeatureExtractor::TraxelPair>::const_iterator p = pairs.begin(); p != pairs.end(); ++p ) {
+      gather( *entry, *p->first, features1 );
+      gather( *entry, *p->second, features2 );
+    }
+    entry->calculator->calculate_batch( data(features1), data(features2), pairs.size(), entry->input_size,
+                                        data(out) + entry->offset, row_size_ );
+  }
+  return row_size_;
+}
+
+
+MultipleFeatureExtraction::CombinedFeatureMap FeatureExtractionPlan::row( const feature_array& out, size_t i ) const {
+  if ( (i + 1) * row_size_ > out.size() ) {
+    throw std::out_of_range("FeatureExtractionPlan::row(): row out of range");
+  }
+  MultipleFeatureExtraction::CombinedFeatureMap res;
+  for ( std::vector<Entry>::const_iterator entry = entries_.begin(); entry != entries_.end(); ++entry ) {
+    feature_array::const_iterator begin = out.begin() + i * row_size_ + entry->offset;
+    res[entry->name] = feature_array( begin, begin + entry->output_size );
+  }
+  return res;
+}
+
+
+
 namespace helpers {
 
 
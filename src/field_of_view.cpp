@@ -134,6 +134,13 @@ namespace pgmlink {
   }
   
   double FieldOfView::spatial_distance_to_border( double /*t*/, double x, double y, double z, bool relative ) const {
+    const double q[3] = {x, y, z};
+    double distance;
+    spatial_distances_to_border(q, 1, relative, &distance);
+    return distance;
+  }
+
+  void FieldOfView::spatial_distances_to_border( const double* xyz, size_t n, bool relative, double* distances ) const {
 	  //distance to 6 cuboid planes, in the 2D case where Z=0,
 	  //we take the planes with Z upper bound set to 1.0
 	  //and return the distances to the 4 corresponding planes
@@ -156,26 +163,41 @@ namespace pgmlink {
 	//c7[0] = ub_[1]; c7[1] = ub_[2]; c7[2] = zub; // unused
 	c8[0] = lb_[1]; c8[1] = ub_[2]; c8[2] = zub;
 
-	// distances to the six faces of the cube
-	double ds[6];
-	double q[3] = {x, y, z};
-	ds[0] = abs_distance(c1, c2, c5, q);
-	ds[1] = abs_distance(c2, c3, c6, q);
-	ds[2] = abs_distance(c4, c3, c8, q);
-	ds[3] = abs_distance(c1, c4, c5, q);
-	ds[4] = abs_distance(c1, c2, c4, q);
-	ds[5] = abs_distance(c5, c6, c8, q);
-
+	// the six faces of the cube by a point and their normal
+	const double* faces[6][3] = { {c1, c2, c5}, {c2, c3, c6}, {c4, c3, c8},
+	                              {c1, c4, c5}, {c1, c2, c4}, {c5, c6, c8} };
+	double origins[6][3], normals[6][3];
+	for (int f = 0; f < 6; ++f) {
+	  double u[3], v[3];
+	  diff(faces[f][0], faces[f][1], u);
+	  diff(faces[f][0], faces[f][2], v);
+	  hesse_normal(u, v, normals[f]);
+	  copy(faces[f][0], faces[f][0] + 3, origins[f]);
+	}
+	double scales[6] = {1., 1., 1., 1., 1., 1.};
 	if (relative) {
 		//normalize relative to radius of range
-		ds[0] /= ((ub_[2] - lb_[2])); // / 2);
-		ds[1] /= ((ub_[1] - lb_[1]));// / 2);
-		ds[2] /= ((ub_[2] - lb_[2])); // / 2);
-		ds[3] /= ((ub_[1] - lb_[1])); // / 2);
-		ds[4] /= ((zub - lb_[3])); // / 2);
-		ds[5] /= ((zub - lb_[3])); // / 2);
+		scales[0] = ((ub_[2] - lb_[2])); // / 2);
+		scales[1] = ((ub_[1] - lb_[1]));// / 2);
+		scales[2] = ((ub_[2] - lb_[2])); // / 2);
+		scales[3] = ((ub_[1] - lb_[1])); // / 2);
+		scales[4] = ((zub - lb_[3])); // / 2);
+		scales[5] = ((zub - lb_[3])); // / 2);
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+	  const double* q = xyz + 3 * i;
+	  double ds[6];
+	  for (int f = 0; f < 6; ++f) {
+	    double w[3];
+	    diff(origins[f], q, w);
+	    ds[f] = abs(dot(w, normals[f]));
+	    if (relative) {
+	      ds[f] /= scales[f];
+	    }
+	  }
+	  distances[i] = *min_element(ds, ds+vlen);
 	}
-	return *min_element(ds, ds+vlen);
   }
 
 
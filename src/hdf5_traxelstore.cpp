@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <vigra/hdf5impex.hxx>
+#include <vigra/multi_array.hxx>
+
+#include "pgmlink/hdf5_traxelstore.h"
+#include "pgmlink/log.h"
+
+using namespace std;
+
+namespace pgmlink {
+  namespace {
+    struct FeatureTable {
+      string name;
+      size_t rows;
+      size_t width;
+      feature_array values; // rows x width, row major
+    };
+
+    struct TimestepTables {
+      int timestep;
+      string path;
+      vector<unsigned int> ids; // rows are labeled 1, 2, ... if empty
+      vector<FeatureTable> tables;
+    };
+
+    // timestep groups are listed with a trailing slash
+    bool parse_timestep(const string& entry, int& timestep) {
+      if(entry.size() < 2 || entry[entry.size() - 1] != '/') {
+        return false;
+      }
+      const string name = entry.substr(0, entry.size() - 1);
+      char* end = 0;
+      const long t = strtol(name.c_str(), &end, 10);
+      if(end == name.c_str() || *end != '\0') {
+        return false;
+      }
+      timestep = static_cast<int>(t);
+      return true;
+    }
+
+    bool by_timestep(const TimestepTables& a, const TimestepTables& b) {
+      return a.timestep < b.timestep;
+    }
+
+    void read_table(vigra::HDF5File& f, const string& path, const string& name, FeatureTable& table) {
+      table.name = name;
+      const int dims = static_cast<int>(f.getDatasetDimensions(path));
+      if(dims == 1) {
+        vigra::MultiArray<1, feature_type> data;
+        f.readAndResize(path, data);
+        table.rows = data.shape(0);
+        table.width = 1;
+        table.values.assign(data.begin(), data.end());
+      } else if(dims == 2) {
+        // vigra reverses the axes: (feature size, objects), so scan order
+        // is row major in objects x feature size
+        vigra::MultiArray<2, feature_type> data;
+        f.readAndResize(path, data);
+        table.width = data.shape(0);
+        table.rows = data.shape(1);
+        table.values.assign(data.begin(), data.end());
+      } else {
+        throw runtime_error("load_hdf5(): feature table " + path + " has to be one or two dimensional");
+      }
+    }
+
+    void read_timestep(vigra::HDF5File& f, TimestepTables& tables, const HDF5TraxelStoreOptions& options) {
+      f.cd(tables.path);
+      const vector<string> entries = f.ls();
+      vector<string> names;
+      if(options.features.empty()) {
+        for(vector<string>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+          if(!it->empty() && (*it)[it->size() - 1] != '/' && *it != options.id_dataset) {
+            names.push_back(*it);
+          }
+        }
+      } else {
+        names = options.features;
+      }
+
+      for(vector<string>::const_iterator name = names.begin(); name != names.end(); ++name) {
+        const string path = tables.path + "/" + *name;
+        if(!f.existsDataset(path)) {
+          LOG(logDEBUG1) << "load_hdf5(): no feature " << *name << " at timestep " << tables.timestep;
+          continue;
+        }
+        tables.tables.push_back(FeatureTable());
+        read_table(f, path, *name, tables.tables.back());
+      }
+
+      const string id_path = tables.path + "/" + options.id_dataset;
+      if(!options.id_dataset.empty() && f.existsDataset(id_path)) {
+        vigra::MultiArray<1, vigra::UInt32> ids;
+        f.readAndResize(id_path, ids);
+        tables.ids.assign(ids.begin(), ids.end());
+      }
+    }
+
+    void assemble(const TimestepTables& tables, vector<Traxel>& traxels) {
+      size_t rows = tables.ids.size();
+      if(tables.ids.empty() && !tables.tables.empty()) {
+        rows = tables.tables.front().rows;
+      }
+      for(vector<FeatureTable>::const_iterator table = tables.tables.begin(); table != tables.tables.end(); ++table) {
+        if(table->rows != rows) {
+          throw runtime_error("load_hdf5(): feature table " + table->name + " of " + tables.path + " has a wrong number of rows");
+        }
+      }
+
+      traxels.reserve(rows);
+      for(size_t r = 0; r < rows; ++r) {
+        const unsigned int id = tables.ids.empty() ? static_cast<unsigned int>(r + 1) : tables.ids[r];
+        traxels.push_back(Traxel(id, tables.timestep));
+        FeatureMap& features = traxels.back().features.map();
+        for(vector<FeatureTable>::const_iterator table = tables.tables.begin(); table != tables.tables.end(); ++table) {
+          feature_array::const_iterator row = table->values.begin() + r * table->width;
+          features[table->name].assign(row, row + table->width);
+        }
+      }
+    }
+  }
+
+  size_t load_hdf5(TraxelStore& ts, const string& filename, const HDF5TraxelStoreOptions& options) {
+    if(options.timesteps_per_chunk == 0) {
+      throw invalid_argument("load_hdf5(): timesteps_per_chunk has to be positive");
+    }
+    vigra::HDF5File f(filename, vigra::HDF5File::OpenReadOnly);
+
+    vector<TimestepTables> timesteps;
+    {
+      // throws if there is no such group
+      f.cd(options.group);
+      // read_timestep() cds from timestep to timestep, so a relative
+      // options.group must not be resolved against the previous one
+      string root = f.currentGroupName();
+      if(!root.empty() && root[root.size() - 1] == '/') {
+        root.erase(root.size() - 1);
+      }
+      const vector<string> entries = f.ls();
+      for(vector<string>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        TimestepTables tables;
+        if(parse_timestep(*it, tables.timestep)) {
+          tables.path = root + "/" + it->substr(0, it->size() - 1);
+          timesteps.push_back(tables);
+        }
+      }
+    }
+    sort(timesteps.begin(), timesteps.end(), by_timestep);
+
+    const size_t size_before = ts.size();
+    for(size_t chunk = 0; chunk < timesteps.size(); chunk += options.timesteps_per_chunk) {
+      const size_t chunk_end = min(timesteps.size(), chunk + options.timesteps_per_chunk);
+
+      // hdf5 is not necessarily thread safe: read serially...
+      for(size_t i = chunk; i < chunk_end; ++i) {
+        read_timestep(f, timesteps[i], options);
+      }
+
+      // ...and assemble in parallel
+      vector<vector<Traxel> > traxels(chunk_end - chunk);
+      string error;
+      #pragma omp parallel for schedule(dynamic)
+      for(int i = 0; i < static_cast<int>(traxels.size()); ++i) {
+        try {
+          assemble(timesteps[chunk + i], traxels[i]);
+        } catch(std::exception& e) {
+          #pragma omp critical(pgmlink_load_hdf5)
+          {
+            if(error.empty()) error = e.what();
+          }
+        }
+      }
+      if(!error.empty()) {
+        throw runtime_error(error);
+      }
+
+      for(size_t i = chunk; i < chunk_end; ++i) {
+        vector<FeatureTable>().swap(timesteps[i].tables);
+        vector<unsigned int>().swap(timesteps[i].ids);
+        add(ts, traxels[i - chunk].begin(), traxels[i - chunk].end());
+      }
+    }
+
+    const size_t n = ts.size() - size_before;
+    LOG(logDEBUG) << "load_hdf5(): added " << n << " traxels of " << timesteps.size()
+                  << " timesteps from " << filename;
+    return n;
+  }
+} /* namespace pgmlink */
@@ -1,19 +1,27 @@
 #include <cassert>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <sstream>
 #include <utility>
 #include <vector>
 #include <algorithm>
 
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/tuple/tuple.hpp>
+#include <lemon/core.h>
 #include <lemon/lgf_reader.h>
 #include <lemon/lgf_writer.h>
+#include "pgmlink/binary_traxelstore.h"
 #include "pgmlink/hypotheses.h"
+#include "pgmlink/instrumentation.h"
 #include "pgmlink/log.h"
 #include "pgmlink/nearest_neighbors.h"
+#include "pgmlink/spatial_index.h"
+#include "pgmlink/tracking_statistics.h"
 #include "pgmlink/traxels.h"
 
 using namespace std;
@@ -28,6 +36,8 @@ HypothesesGraph::Node HypothesesGraph::add_node(node_timestep_map::Value timeste
     HypothesesGraph::Node node = addNode();
     timestep_m.set(node, timestep);
     timesteps_.insert( timestep );
+    // reindex on the next lookup, when the traxel is set
+    traxel_nodes_.erase( timestep );
     return node;
 }
 
@@ -38,10 +48,161 @@ HypothesesGraph::Node HypothesesGraph::add_node(std::vector<node_timestep_map::V
     for (std::vector<node_timestep_map::Value>::const_iterator it = timesteps.begin(); it!=timesteps.end(); ++it) {
         timestep_m.set(node, *it);
         timesteps_.insert( *it );
+        traxel_nodes_.erase( *it );
     }
     return node;
 }
 
+HypothesesGraph::Node HypothesesGraph::add_traxel_node(const Traxel& traxel) {
+    node_timestep_map& timestep_m = get(node_timestep());
+    if (!has_traxels()) {
+        throw runtime_error("HypothesesGraph::add_traxel_node(): neither node_traxel nor node_traxel_handle property");
+    }
+
+    if (timesteps_.count(traxel.Timestep) == 0) {
+        // first node of the timestep: the index is complete from the start
+        traxel_nodes_[traxel.Timestep];
+    }
+    HypothesesGraph::Node node = addNode();
+    timestep_m.set(node, traxel.Timestep);
+    timesteps_.insert( traxel.Timestep );
+    set_traxel(node, traxel);
+    index_traxel_node(node, traxel);
+    return node;
+}
+
+bool HypothesesGraph::has_traxels() const {
+    return has_property(node_traxel()) || has_property(node_traxel_handle());
+}
+
+void HypothesesGraph::set_traxel(HypothesesGraph::Node node, const Traxel& traxel) {
+    if (has_property(node_traxel())) {
+        get(node_traxel()).set(node, traxel);
+    } else {
+        get(node_traxel_handle()).set(node, traxel);
+    }
+}
+
+size_t HypothesesGraph::index_memory_bytes() const {
+    // std::set and std::map nodes hold the color and three pointers
+    const size_t tree_node = 4 * sizeof(void*);
+    size_t bytes = timesteps_.size() * (tree_node + sizeof(node_timestep_map::Value));
+    for (std::map<node_timestep_map::Value, std::vector<Node> >::const_iterator it = traxel_nodes_.begin();
+         it != traxel_nodes_.end(); ++it) {
+        bytes += tree_node + sizeof(*it) + it->second.capacity() * sizeof(Node);
+    }
+    return bytes;
+}
+
+void HypothesesGraph::index_traxel_node(HypothesesGraph::Node node, const Traxel& traxel) {
+    std::map<node_timestep_map::Value, std::vector<Node> >::iterator it = traxel_nodes_.find(traxel.Timestep);
+    if (it == traxel_nodes_.end()) {
+        // indexed on the next lookup
+        return;
+    }
+    index_at(it->second, node, traxel.Id);
+}
+
+size_t HypothesesGraph::max_indexed_traxel_id() const {
+    // some slack over the node count for sparse labels
+    const size_t min_ids = 1 << 16;
+    return std::max(min_ids, 16 * static_cast<size_t>(maxNodeId() + 1));
+}
+
+void HypothesesGraph::index_at(std::vector<Node>& nodes, Node node, unsigned int id) const {
+    if (nodes.size() <= id) {
+        if (id > max_indexed_traxel_id()) {
+            std::ostringstream msg;
+            msg << "HypothesesGraph: traxel id " << id << " is too large for the node index of "
+                << (maxNodeId() + 1) << " nodes";
+            throw runtime_error(msg.str());
+        }
+        nodes.resize(static_cast<size_t>(id) + 1, lemon::INVALID);
+    }
+    nodes[id] = node;
+}
+
+void HypothesesGraph::index_traxel_nodes() const {
+    for (std::set<node_timestep_map::Value>::const_iterator t = timesteps_.begin(); t != timesteps_.end(); ++t) {
+        indexed_traxel_nodes(*t);
+    }
+}
+
+HypothesesGraph::Node HypothesesGraph::traxel_node(node_timestep_map::Value timestep, unsigned int id) const {
+    const std::vector<Node>& nodes = indexed_traxel_nodes(timestep);
+    if (id >= nodes.size() || nodes[id] == lemon::INVALID || !is_traxel_node(NodeTraxels(*this), nodes[id], timestep, id)) {
+        return lemon::INVALID;
+    }
+    return nodes[id];
+}
+
+const std::vector<HypothesesGraph::Node>& HypothesesGraph::traxel_nodes(node_timestep_map::Value timestep) const {
+    return indexed_traxel_nodes(timestep);
+}
+
+unsigned int HypothesesGraph::max_traxel_id(node_timestep_map::Value timestep) const {
+    const std::vector<Node>& nodes = indexed_traxel_nodes(timestep);
+    if (nodes.empty()) {
+        return 0;
+    }
+    const NodeTraxels traxel_m(*this);
+    for (size_t id = nodes.size(); id-- > 0;) {
+        if (nodes[id] != lemon::INVALID && is_traxel_node(traxel_m, nodes[id], timestep, id)) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+const std::vector<HypothesesGraph::Node>& HypothesesGraph::indexed_traxel_nodes(node_timestep_map::Value timestep) const {
+    std::map<node_timestep_map::Value, std::vector<Node> >::iterator it = traxel_nodes_.find(timestep);
+    if (it != traxel_nodes_.end()) {
+        return it->second;
+    }
+
+    std::vector<Node>& nodes = traxel_nodes_[timestep];
+    if (!has_traxels()) {
+        return nodes;
+    }
+    const node_timestep_map& timestep_m = get(node_timestep());
+    const NodeTraxels traxel_m(*this);
+    try {
+        for (node_timestep_map::ItemIt node(timestep_m, timestep); node != lemon::INVALID; ++node) {
+            const Traxel& traxel = traxel_m[node];
+            if (traxel.Timestep != timestep) {
+                continue;
+            }
+            index_at(nodes, node, traxel.Id);
+        }
+    } catch (...) {
+        // no partial index
+        traxel_nodes_.erase(timestep);
+        throw;
+    }
+    LOG(logDEBUG3) << "HypothesesGraph: indexed the traxel nodes of timestep " << timestep;
+    return nodes;
+}
+
+bool HypothesesGraph::is_traxel_node(const NodeTraxels& traxels, HypothesesGraph::Node node,
+                                     node_timestep_map::Value timestep, unsigned int id) const {
+    if (!valid(node)) {
+        return false;
+    }
+    const Traxel& traxel = traxels[node];
+    return traxel.Timestep == timestep && traxel.Id == id;
+}
+
+NodeTraxels::NodeTraxels(const HypothesesGraph& g)
+: copies_(0), handles_(0) {
+    if (g.has_property(node_traxel())) {
+        copies_ = &g.get(node_traxel());
+    } else if (g.has_property(node_traxel_handle())) {
+        handles_ = &g.get(node_traxel_handle());
+    } else {
+        throw runtime_error("NodeTraxels: neither node_traxel nor node_traxel_handle property");
+    }
+}
+
 const std::set<HypothesesGraph::node_timestep_map::Value>& HypothesesGraph::timesteps() const {
     return timesteps_;
 }
@@ -56,6 +217,26 @@ HypothesesGraph::node_timestep_map::Value HypothesesGraph::latest_timestep() con
 
 
 
+ActiveSubgraph::ActiveSubgraph(const HypothesesGraph& g)
+: g_(g), nodes_(g, true), arcs_(g, false), digraph_(g, nodes_, arcs_) {
+    const property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
+    if (g.has_property(node_active())) {
+        const property_map<node_active, HypothesesGraph::base_graph>::type& active_nodes = g.get(node_active());
+        for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+            nodes_.set(n, active_nodes[n]);
+        }
+    } else if (g.has_property(node_active2())) {
+        const property_map<node_active2, HypothesesGraph::base_graph>::type& active2_nodes = g.get(node_active2());
+        for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+            nodes_.set(n, active2_nodes[n] > 0);
+        }
+    }
+    typedef property_map<arc_active, HypothesesGraph::base_graph>::type::TrueIt active_arc_it;
+    for (active_arc_it a(active_arcs); a != lemon::INVALID; ++a) {
+        arcs_.set(a, true);
+    }
+}
+
 HypothesesGraph& prune_inactive(HypothesesGraph& g) {
     LOG(logDEBUG) << "prune_inactive(): entered";
     property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
@@ -119,7 +300,7 @@ HypothesesGraph& prune_inactive(HypothesesGraph& g) {
         }
     }
 
-    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g.get(node_traxel());
+    const NodeTraxels traxel_map(g);
     // prune inactive nodes
     for(vector<HypothesesGraph::Node>::const_iterator it = nodes_to_prune.begin(); it!= nodes_to_prune.end(); ++it) {
         LOG(logDEBUG3) << "prune_inactive: prune node: " << g.id(*it) << ", Traxel = " << traxel_map[*it];
@@ -138,13 +319,22 @@ HypothesesGraph& prune_inactive(HypothesesGraph& g) {
 
 
 
-boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGraph& g) {
+namespace {
+// nodes hidden by the active subgraph are skipped
+bool visible(const HypothesesGraph::base_graph&, const HypothesesGraph::Node&) {
+    return true;
+}
+
+bool visible(const ActiveSubgraph::Digraph& d, const HypothesesGraph::Node& n) {
+    return d.status(n);
+}
+
+template<typename Digraph>
+void events_of(const HypothesesGraph& g, const Digraph& d, EventSink& sink) {
     LOG(logDEBUG) << "events(): entered";
-    boost::shared_ptr<std::vector< std::vector<Event> > > ret(new vector< vector<Event> >);
     typedef property_map<node_timestep, HypothesesGraph::base_graph>::type node_timestep_map_t;
     node_timestep_map_t& node_timestep_map = g.get(node_timestep());
-    typedef property_map<node_traxel, HypothesesGraph::base_graph>::type node_traxel_map_t;
-    node_traxel_map_t& node_traxel_map = g.get(node_traxel());
+    const NodeTraxels node_traxel_map(g);
     property_map<division_active, HypothesesGraph::base_graph>::type* division_node_map;
     
     bool with_division_detection = false;
@@ -168,28 +358,34 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
         LOG(logDEBUG1) << "events(): with_origin enabeld";
     }
 
+    // arcs bridging timesteps are reported by multi_frame_move_events()
+    const property_map<arc_from_timestep, HypothesesGraph::base_graph>::type& arc_from_map = g.get(arc_from_timestep());
+    const property_map<arc_to_timestep, HypothesesGraph::base_graph>::type& arc_to_map = g.get(arc_to_timestep());
+
     // for every timestep
     LOG(logDEBUG1) << "events(): earliest_timestep: " << g.earliest_timestep();
     LOG(logDEBUG1) << "events(): latest_timestep: " << g.latest_timestep();
 
-    // add an empty first timestep
-    ret->push_back(vector<Event>());
-
+    // Events at timestep t go to the slot of t + 1, apart from mergers;
+    // so slot t is complete after timestep t.
+    vector<Event> current, next;
     for(int t = g.earliest_timestep(); t < g.latest_timestep(); ++t) {
         LOG(logDEBUG2) << "events(): processing timestep: " << t;
-        ret->push_back(vector<Event>());
 
         map<unsigned int, vector<unsigned int> > resolver_map;
 
         // for every node: destiny
         LOG(logDEBUG2) << "events(): for every node: destiny";
         for(node_timestep_map_t::ItemIt node_at(node_timestep_map, t); node_at!=lemon::INVALID; ++node_at) {
+            if (!visible(d, node_at)) {
+                continue;
+            }
             assert(node_traxel_map[node_at].Timestep == t);
 
             if (with_origin && (*origin_map)[node_at].size() > 0 && t > g.earliest_timestep()) {
                 LOG(logINFO) << "events(): collecting resolver node ids for all merger nodes " << t << ", " << (*origin_map)[node_at][0];
                 resolver_map[(*origin_map)[node_at][0]].push_back(node_traxel_map[node_at].Id);
-                const std::vector<float>& tmp_feat = (node_traxel_map[node_at].features.find("com"))->second; //node_traxel_map[node_at].features["com"];
+                const FeatureValues tmp_feat = (node_traxel_map[node_at].features.find("com"))->second; //node_traxel_map[node_at].features["com"];
                 std::copy(tmp_feat.begin(), tmp_feat.end(),
                           std::back_insert_iterator<std::vector<unsigned> >(resolver_map[(*origin_map)[node_at][0]]));
             }
@@ -212,20 +408,28 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
 
             LOG(logDEBUG3) << "Number of detected objects: " << (*node_number_of_objects)[node_at];
 
-            // count outgoing arcs
-            size_t count = 0;
-            for(HypothesesGraph::base_graph::OutArcIt a(g, node_at); a!=lemon::INVALID; ++a) ++count;
+            // count outgoing arcs (to the next timestep)
+            vector<HypothesesGraph::Node> targets;
+            bool bridged = false;
+            for(typename Digraph::OutArcIt a(d, node_at); a!=lemon::INVALID; ++a) {
+                if (arc_to_map[a] - arc_from_map[a] > 1) {
+                    bridged = true;
+                } else {
+                    targets.push_back(g.target(a));
+                }
+            }
+            size_t count = targets.size();
             LOG(logDEBUG3) << "events(): counted outgoing arcs: " << count;
 
             // construct suitable Event object
             switch(count) {
                 // Disappearance
                 case 0: {
-                    if (t<g.latest_timestep()) {
+                    if (t<g.latest_timestep() && !bridged) {
                         Event e;
                         e.type = Event::Disappearance;
                         e.traxel_ids.push_back(node_traxel_map[node_at].Id);
-                        (*ret)[t-g.earliest_timestep()+1].push_back(e);
+                        next.push_back(e);
                         LOG(logDEBUG3) << e;
                     }
                     break;
@@ -235,9 +439,8 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
                     Event e;
                     e.type = Event::Move;
                     e.traxel_ids.push_back(node_traxel_map[node_at].Id);
-                    HypothesesGraph::base_graph::OutArcIt a(g, node_at);
-                    e.traxel_ids.push_back(node_traxel_map[g.target(a)].Id);
-                    (*ret)[t-g.earliest_timestep()+1].push_back(e);
+                    e.traxel_ids.push_back(node_traxel_map[targets[0]].Id);
+                    next.push_back(e);
                     LOG(logDEBUG3) << e;
                     break;
                 }
@@ -248,19 +451,17 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
                         if (count == 2 && (*division_node_map)[node_at]) {
                             e.type = Event::Division;
                             e.traxel_ids.push_back(node_traxel_map[node_at].Id);
-                            HypothesesGraph::base_graph::OutArcIt a(g, node_at);
-                            e.traxel_ids.push_back(node_traxel_map[g.target(a)].Id);
-                            ++a;
-                            e.traxel_ids.push_back(node_traxel_map[g.target(a)].Id);
-                            (*ret)[t-g.earliest_timestep()+1].push_back(e);
+                            e.traxel_ids.push_back(node_traxel_map[targets[0]].Id);
+                            e.traxel_ids.push_back(node_traxel_map[targets[1]].Id);
+                            next.push_back(e);
                             LOG(logDEBUG3) << e;
                         } else {
-                            for(HypothesesGraph::base_graph::OutArcIt a(g, node_at); a != lemon::INVALID; ++a) {
+                            for(vector<HypothesesGraph::Node>::const_iterator target = targets.begin(); target != targets.end(); ++target) {
                                 e.type = Event::Move;
                                 e.traxel_ids.clear();
                                 e.traxel_ids.push_back(node_traxel_map[node_at].Id);
-                                e.traxel_ids.push_back(node_traxel_map[g.target(a)].Id);
-                                (*ret)[t-g.earliest_timestep()+1].push_back(e);
+                                e.traxel_ids.push_back(node_traxel_map[*target].Id);
+                                next.push_back(e);
                                 LOG(logDEBUG3) << e;
                             }
                         }
@@ -270,11 +471,9 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
                         }
                         e.type = Event::Division;
                         e.traxel_ids.push_back(node_traxel_map[node_at].Id);
-                        HypothesesGraph::base_graph::OutArcIt a(g, node_at);
-                        e.traxel_ids.push_back(node_traxel_map[g.target(a)].Id);
-                        ++a;
-                        e.traxel_ids.push_back(node_traxel_map[g.target(a)].Id);
-                        (*ret)[t-g.earliest_timestep()+1].push_back(e);
+                        e.traxel_ids.push_back(node_traxel_map[targets[0]].Id);
+                        e.traxel_ids.push_back(node_traxel_map[targets[1]].Id);
+                        next.push_back(e);
                         LOG(logDEBUG3) << e;
                     }
                     break;
@@ -288,7 +487,7 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
             for (std::vector<unsigned int>::iterator it = map_it->second.begin(); it != map_it->second.end(); ++it) {
                 e.traxel_ids.push_back(*it);
             }
-            (*ret)[t-g.earliest_timestep()+1].push_back(e);
+            next.push_back(e);
             LOG(logDEBUG1) << e;
         }
 
@@ -297,72 +496,117 @@ boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGra
         LOG(logDEBUG2) << "events(): appearances in next timestep";
         if (t+1 <= g.latest_timestep()) {
             for(node_timestep_map_t::ItemIt node_at(node_timestep_map, t+1); node_at!=lemon::INVALID; ++node_at) {
+                if (!visible(d, node_at)) {
+                    continue;
+                }
                 // count incoming arcs
                 int count = 0;
-                for(HypothesesGraph::base_graph::InArcIt a(g, node_at); a!=lemon::INVALID; ++a) ++count;
+                bool bridged = false;
+                for(typename Digraph::InArcIt a(d, node_at); a!=lemon::INVALID; ++a) {
+                    if (arc_to_map[a] - arc_from_map[a] > 1) {
+                        bridged = true;
+                    } else {
+                        ++count;
+                    }
+                }
                 LOG(logDEBUG3) << "events(): counted incoming arcs in next timestep: " << count;
 
                 // no incoming arcs => appearance
-                if(count == 0 && t + 1 > g.earliest_timestep()) {
+                if(count == 0 && !bridged && t + 1 > g.earliest_timestep()) {
                     Event e;
                     e.type = Event::Appearance;
                     e.traxel_ids.push_back(node_traxel_map[node_at].Id);
-                    (*ret)[t-g.earliest_timestep()+1].push_back(e);
+                    next.push_back(e);
                     LOG(logDEBUG3) << e;
                 }
             }
         }
         for(node_timestep_map_t::ItemIt node_at(node_timestep_map, t); node_at!=lemon::INVALID; ++node_at) {
+            if (!visible(d, node_at)) {
+                continue;
+            }
             if(with_mergers && (*node_number_of_objects)[node_at] > 1) {
                 Event e;
                 e.type = Event::Merger;
                 e.traxel_ids.push_back(node_traxel_map[node_at].Id);
                 e.traxel_ids.push_back((*node_number_of_objects)[node_at]);
-                (*ret)[t-g.earliest_timestep()].push_back(e);
+                current.push_back(e);
                 LOG(logDEBUG3) << e;
             }
         }
 
+        sink.timestep(t-g.earliest_timestep(), current);
+        current.clear();
+        current.swap(next);
     }
 
     LOG(logDEBUG2) << "events(): last timestep: " << g.latest_timestep();
     for(node_timestep_map_t::ItemIt node_at(node_timestep_map, g.latest_timestep()); node_at!=lemon::INVALID; ++node_at) {
+        if (!visible(d, node_at)) {
+            continue;
+        }
         if(with_mergers && (*node_number_of_objects)[node_at] > 1) {
             Event e;
             e.type = Event::Merger;
             e.traxel_ids.push_back(node_traxel_map[node_at].Id);
             e.traxel_ids.push_back((*node_number_of_objects)[node_at]);
-            (*ret)[g.latest_timestep()-g.earliest_timestep()].push_back(e);
+            current.push_back(e);
             LOG(logDEBUG3) << e;
         }
     }
+    sink.timestep(g.latest_timestep()-g.earliest_timestep(), current);
     LOG(logDEBUG2) << "events(): done.";
-    return ret;
 }
 
 
 
-boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(const HypothesesGraph& g) {
-    boost::shared_ptr<std::vector< std::vector<Event> > > ret(new vector< vector<Event> >);
+template<typename Digraph>
+void multi_frame_move_events_of(const HypothesesGraph& g, const Digraph& d, EventSink& sink) {
     typedef property_map<node_timestep, HypothesesGraph::base_graph>::type node_timestep_map_t;
     node_timestep_map_t& node_timestep_map = g.get(node_timestep());
-    typedef property_map<node_traxel, HypothesesGraph::base_graph>::type node_traxel_map_t;
-    node_traxel_map_t& node_traxel_map = g.get(node_traxel());
+    const NodeTraxels node_traxel_map(g);
     typedef property_map<node_originated_from, HypothesesGraph::base_graph>::type origin_map_t;
-    origin_map_t& origin_map = g.get(node_originated_from());
+    // merger resolving is optional
+    origin_map_t* resolved_origin_map = 0;
+    if (g.has_property(node_originated_from())) {
+        resolved_origin_map = &g.get(node_originated_from());
+    }
+    const property_map<arc_from_timestep, HypothesesGraph::base_graph>::type& arc_from_map = g.get(arc_from_timestep());
+    const property_map<arc_to_timestep, HypothesesGraph::base_graph>::type& arc_to_map = g.get(arc_to_timestep());
 
     std::map<int, std::vector<Event> > multi_frame_move_map;
 
-    // add an empty first timestep
-    ret->push_back(vector<Event>());
-
+    // Moves from timestep t end at t + 1 or later; so the slot of t + 1
+    // is complete after timestep t. The first slot is empty.
+    vector<Event> slot_events;
+    sink.timestep(0, slot_events);
     for(int t = g.earliest_timestep(); t < g.latest_timestep(); ++t) {
         LOG(logDEBUG2) << "events(): processing timestep: " << t;
-        ret->push_back(vector<Event>());
         for(node_timestep_map_t::ItemIt node_at(node_timestep_map, t); node_at!=lemon::INVALID; ++node_at) {
+            if (!visible(d, node_at)) {
+                continue;
+            }
             assert(node_traxel_map[node_at].Timestep == t);
+
+            // arcs bridging timesteps (see GapClosing_HypothesesBuilder):
+            // (source id, target id, source timestep) at the target timestep
+            for(typename Digraph::OutArcIt out_it(d, node_at); out_it != lemon::INVALID; ++out_it) {
+                if (arc_to_map[out_it] - arc_from_map[out_it] > 1) {
+                    Event e;
+                    e.type = Event::MultiFrameMove;
+                    e.traxel_ids.push_back(node_traxel_map[node_at].Id);
+                    e.traxel_ids.push_back(node_traxel_map[g.target(out_it)].Id);
+                    e.traxel_ids.push_back(t-g.earliest_timestep());
+                    multi_frame_move_map[arc_to_map[out_it]-g.earliest_timestep()].push_back(e);
+                }
+            }
+
+            if (!resolved_origin_map) {
+                continue;
+            }
+            origin_map_t& origin_map = *resolved_origin_map;
             if (origin_map[node_at].size()) {
-                for(HypothesesGraph::InArcIt in_it(g, node_at); in_it != lemon::INVALID; ++in_it) {
+                for(typename Digraph::InArcIt in_it(d, node_at); in_it != lemon::INVALID; ++in_it) {
                     HypothesesGraph::Node src_node = g.source(in_it);
                     if (origin_map[src_node].size()) {
                         break;
@@ -374,7 +618,7 @@ boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(co
                     int t_local = t+1;
                     HypothesesGraph::Node n = node_at;
                     while (t_local <= g.latest_timestep()) {
-                        HypothesesGraph::OutArcIt merge_it(g, n);
+                        typename Digraph::OutArcIt merge_it(d, n);
                         if (merge_it == lemon::INVALID) {
                             break;
                         }
@@ -394,14 +638,63 @@ boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(co
             }
         }
 
+        const int slot = t+1-g.earliest_timestep();
+        slot_events.clear();
+        std::map<int, std::vector<Event> >::iterator map_it = multi_frame_move_map.find(slot);
+        if (map_it != multi_frame_move_map.end()) {
+            slot_events.swap(map_it->second);
+            multi_frame_move_map.erase(map_it);
+        }
+        sink.timestep(slot, slot_events);
     }
+}
 
-    std::map<int, std::vector<Event> >::iterator map_it = multi_frame_move_map.begin();
-    for (; map_it != multi_frame_move_map.end(); ++map_it) {
-        (*ret)[map_it->first] = map_it->second;
-    }
-    
+} // anonymous namespace
+
+boost::shared_ptr<std::vector< std::vector<Event> > > events(const HypothesesGraph& g) {
+    boost::shared_ptr<std::vector< std::vector<Event> > > ret(new vector< vector<Event> >);
+    EventVectorSink sink(*ret);
+    events(g, sink);
     return ret;
+}
+
+boost::shared_ptr<std::vector< std::vector<Event> > > events(const ActiveSubgraph& active) {
+    boost::shared_ptr<std::vector< std::vector<Event> > > ret(new vector< vector<Event> >);
+    EventVectorSink sink(*ret);
+    events(active, sink);
+    return ret;
+}
+
+void events(const HypothesesGraph& g, EventSink& sink) {
+    PGMLINK_TIMED_SCOPE("events");
+    events_of(g, static_cast<const HypothesesGraph::base_graph&>(g), sink);
+}
+
+void events(const ActiveSubgraph& active, EventSink& sink) {
+    PGMLINK_TIMED_SCOPE("events");
+    events_of(active.graph(), active.digraph(), sink);
+}
+
+boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(const HypothesesGraph& g) {
+    boost::shared_ptr<std::vector< std::vector<Event> > > ret(new vector< vector<Event> >);
+    EventVectorSink sink(*ret);
+    multi_frame_move_events(g, sink);
+    return ret;
+}
+
+boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_move_events(const ActiveSubgraph& active) {
+    boost::shared_ptr<std::vector< std::vector<Event> > > ret(new vector< vector<Event> >);
+    EventVectorSink sink(*ret);
+    multi_frame_move_events(active, sink);
+    return ret;
+}
+
+void multi_frame_move_events(const HypothesesGraph& g, EventSink& sink) {
+    multi_frame_move_events_of(g, static_cast<const HypothesesGraph::base_graph&>(g), sink);
+}
+
+void multi_frame_move_events(const ActiveSubgraph& active, EventSink& sink) {
+    multi_frame_move_events_of(active.graph(), active.digraph(), sink);
 } /* multi_frame_move_events */
 
 
@@ -429,7 +722,7 @@ void generateTrackletGraph(const HypothesesGraph& traxel_graph, HypothesesGraph&
     // go through the traxels graph, add each node which doesn't have an active incoming arc, and
     // follow the active outgoing path to add those nodes to the tracklet
     property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = traxel_graph.get(arc_active());
-    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = traxel_graph.get(node_traxel());
+    const NodeTraxels traxel_map(traxel_graph);
 
     property_map<node_tracklet, HypothesesGraph::base_graph>::type* traxels_tracklet_map;
     bool traxel_nodes_are_tracklets = false;
@@ -558,143 +851,157 @@ void generateTrackletGraph(const HypothesesGraph& traxel_graph, HypothesesGraph&
     }
 }
 
-namespace {
-std::vector<HypothesesGraph::Arc> getOutgoingArcs(const HypothesesGraph& graph, const HypothesesGraph::Node& n) {
-    std::vector<HypothesesGraph::Arc> result;
-    for(HypothesesGraph::OutArcIt a(graph, n); a != lemon::INVALID; ++a) {
-        result.push_back(a);
-    }
-    return result;
-}
-
-std::vector<HypothesesGraph::Arc> getIncomingArcs(const HypothesesGraph& graph, const HypothesesGraph::Node& n) {
-    std::vector<HypothesesGraph::Arc> result;
-    for(HypothesesGraph::InArcIt a(graph, n); a != lemon::INVALID; ++a) {
-        result.push_back(a);
-    }
-    return result;
-}
-
-void addNodeToTracklet(const HypothesesGraph& traxel_graph, HypothesesGraph& tracklet_graph,
-                       const HypothesesGraph::Node& traxel_node, const HypothesesGraph::Node& ancestor_traxel_node,
-                       std::map<HypothesesGraph::Node, HypothesesGraph::Node>& traxel2tracklet, double traxel_arc_dist,
-                       std::map<HypothesesGraph::Node, std::vector<HypothesesGraph::Node> >& tracklet2traxel, const int arc_id) {
-    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = traxel_graph.get(node_traxel());
-    property_map<node_tracklet, HypothesesGraph::base_graph>::type& tracklet_map = tracklet_graph.get(node_tracklet());
-    property_map<tracklet_intern_dist, HypothesesGraph::base_graph>::type& tracklet_arc_dist_map = tracklet_graph.get(tracklet_intern_dist());
-    property_map<tracklet_intern_arc_ids, HypothesesGraph::base_graph>::type& tracklet_arc_id_map = tracklet_graph.get(tracklet_intern_arc_ids());
-
-    //	property_map<node_timestep, HypothesesGraph::base_graph>::type& timestep_map = tracklet_graph.get(node_timestep());
-
-    assert(traxel2tracklet.find(ancestor_traxel_node) != traxel2tracklet.end());
-    HypothesesGraph::Node tracklet_node = traxel2tracklet[ancestor_traxel_node];
-    std::vector<Traxel> tracklet = tracklet_map[tracklet_node];
-    Traxel tr = traxel_map[traxel_node];
-    tracklet.push_back(tr);
-    tracklet_map.set(tracklet_node, tracklet);
-    traxel2tracklet[traxel_node] = tracklet_node;
-    //	size_t timestep = tr.Timestep;
-    //	timestep_map[tracklet_node].add(timestep);
-    //	tracklet_graph.timesteps_.insert(timestep);
-
-    // add internal arc
-    std::vector<double> arc_dists = tracklet_arc_dist_map[tracklet_node];
-    arc_dists.push_back(traxel_arc_dist);
-    tracklet_arc_dist_map.set(tracklet_node,arc_dists);
-
-    tracklet2traxel[tracklet_node].push_back(traxel_node);
-
-    std::vector<int> arc_ids = tracklet_arc_id_map[tracklet_node];
-    arc_ids.push_back(arc_id);
-    tracklet_arc_id_map.set(tracklet_node, arc_ids);
-    LOG(logDEBUG4) << "addNodeToTracklet: added arc_id " << arc_id;
-}
-
-void addNodeToGraph(const HypothesesGraph& traxel_graph, HypothesesGraph& tracklet_graph,
-                    const HypothesesGraph::Node& traxel_node, std::map<HypothesesGraph::Node, HypothesesGraph::Node>& traxel2tracklet,
-                    std::map<HypothesesGraph::Node, std::vector<HypothesesGraph::Node> >& tracklet2traxel) {
-    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = traxel_graph.get(node_traxel());
-    property_map<node_tracklet, HypothesesGraph::base_graph>::type& tracklet_map = tracklet_graph.get(node_tracklet());
-    property_map<tracklet_intern_dist, HypothesesGraph::base_graph>::type& tracklet_intern_dist_map = tracklet_graph.get(tracklet_intern_dist());
-    std::vector<Traxel> tracklet;
-    Traxel tr = traxel_map[traxel_node];
-    tracklet.push_back(tr);
-    size_t timestep = tr.Timestep;
-    HypothesesGraph::Node tracklet_node = tracklet_graph.add_node(timestep);
-    LOG(logDEBUG4) << "added tracklet node " << tracklet_graph.id(tracklet_node);
-    tracklet_map.set(tracklet_node, tracklet);
-    traxel2tracklet[traxel_node] = tracklet_node;
-    std::vector<double> arc_dists;
-    tracklet_intern_dist_map.set(tracklet_node, arc_dists);
-
-    tracklet2traxel[tracklet_node].push_back(traxel_node);
-}
-
-void addArcsToGraph(const HypothesesGraph& traxel_graph, HypothesesGraph& tracklet_graph,
-                    const std::vector<HypothesesGraph::Arc>& incoming_arcs, std::map<HypothesesGraph::Node, HypothesesGraph::Node>& traxel2tracklet) {
-    property_map<arc_distance, HypothesesGraph::base_graph>::type& traxel_arc_distances = traxel_graph.get(arc_distance());
-    property_map<arc_distance, HypothesesGraph::base_graph>::type& tracklet_arc_distances = tracklet_graph.get(arc_distance());
-    property_map<traxel_arc_id, HypothesesGraph::base_graph>::type& traxel_arc_ids = tracklet_graph.get(traxel_arc_id());
-
-    for(std::vector<HypothesesGraph::Arc>::const_iterator a = incoming_arcs.begin(); a!=incoming_arcs.end(); ++a) {
-        HypothesesGraph::Arc arc = *a;
-        LOG(logDEBUG4) << "traxel arc source " << traxel_graph.id(traxel_graph.source(arc));
-        LOG(logDEBUG4) << "traxel arc target " << traxel_graph.id(traxel_graph.target(arc));
-        HypothesesGraph::Node from = traxel2tracklet[traxel_graph.source(arc)];
-        HypothesesGraph::Node to = traxel2tracklet[traxel_graph.target(arc)];
-        LOG(logDEBUG4) << "tracklet node from " << tracklet_graph.id(traxel2tracklet[traxel_graph.source(arc)]);
-        LOG(logDEBUG4) << "tracklet node to " << tracklet_graph.id(traxel2tracklet[traxel_graph.target(arc)]);
-        assert(from != to);
-        HypothesesGraph::Arc tracklet_arc = tracklet_graph.addArc(from, to);
-        tracklet_arc_distances.set(tracklet_arc,traxel_arc_distances[arc]);
-        traxel_arc_ids.set(tracklet_arc, (int) traxel_graph.id(arc));
-    }
-}
-
-} // anonymous namespace
-
 std::map<HypothesesGraph::Node, std::vector<HypothesesGraph::Node> > generateTrackletGraph2(const HypothesesGraph& traxel_graph, HypothesesGraph& tracklet_graph) {
+    typedef HypothesesGraph::Node Node;
+    typedef HypothesesGraph::Arc Arc;
     property_map<arc_distance, HypothesesGraph::base_graph>::type& traxel_arc_dist_map = traxel_graph.get(arc_distance());
 
     typedef property_map<node_timestep, HypothesesGraph::base_graph>::type node_timestep_map_t;
     node_timestep_map_t& node_timestep_map = traxel_graph.get(node_timestep());
+    const NodeTraxels traxel_map(traxel_graph);
 
     // add empty traxel_map to the tracklet graph in order to make the tracklet graph equivalent to traxelgraphs
     tracklet_graph.add(node_traxel()).add(arc_distance());
 
     tracklet_graph.add(node_tracklet()).add(tracklet_intern_dist()).add(tracklet_intern_arc_ids()).add(traxel_arc_id());
+    property_map<node_tracklet, HypothesesGraph::base_graph>::type& tracklet_map = tracklet_graph.get(node_tracklet());
+    property_map<tracklet_intern_dist, HypothesesGraph::base_graph>::type& tracklet_intern_dist_map = tracklet_graph.get(tracklet_intern_dist());
+    property_map<tracklet_intern_arc_ids, HypothesesGraph::base_graph>::type& tracklet_arc_id_map = tracklet_graph.get(tracklet_intern_arc_ids());
+    property_map<arc_distance, HypothesesGraph::base_graph>::type& tracklet_arc_distances = tracklet_graph.get(arc_distance());
+    property_map<traxel_arc_id, HypothesesGraph::base_graph>::type& traxel_arc_ids = tracklet_graph.get(traxel_arc_id());
 
-    std::map<HypothesesGraph::Node, std::vector<HypothesesGraph::Node> > tracklet_node_to_traxel_nodes;
-    // maps traxel_nodes to tracklet_nodes
-    std::map<HypothesesGraph::Node, HypothesesGraph::Node > traxel_node_to_tracklet_node;
+    std::map<Node, std::vector<Node> > tracklet_node_to_traxel_nodes;
+    if (traxel_graph.timesteps().empty()) {
+        return tracklet_node_to_traxel_nodes;
+    }
 
+    // traxel nodes in timestep order; tracklets are numbered in the order
+    // of their first node
+    vector<Node> nodes;
+    nodes.reserve(lemon::countNodes(traxel_graph));
     for(int t = traxel_graph.earliest_timestep(); t <= traxel_graph.latest_timestep(); ++t) {
         for(node_timestep_map_t::ItemIt traxel_node(node_timestep_map, t); traxel_node!=lemon::INVALID; ++traxel_node) {
-            LOG(logDEBUG4) << "traxel_node = " << traxel_graph.id(traxel_node);
-            vector<HypothesesGraph::Arc> incoming_arcs = getIncomingArcs(traxel_graph, traxel_node);
-            if(incoming_arcs.size() != 1) {
-                addNodeToGraph(traxel_graph, tracklet_graph, traxel_node, traxel_node_to_tracklet_node, tracklet_node_to_traxel_nodes);
-                addArcsToGraph(traxel_graph, tracklet_graph, incoming_arcs, traxel_node_to_tracklet_node);
-                LOG(logDEBUG4) << "traxel2tracklet.size(): " << traxel_node_to_tracklet_node.size();
-                continue;
-            }
+            nodes.push_back(traxel_node);
+        }
+    }
+    vector<int> index_of(traxel_graph.maxNodeId() + 1, -1);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        index_of[traxel_graph.id(nodes[i])] = static_cast<int>(i);
+    }
 
-            HypothesesGraph::Node ancestor = traxel_graph.source(incoming_arcs[0]);
-            if(getOutgoingArcs(traxel_graph, ancestor).size() > 1) {
-                addNodeToGraph(traxel_graph, tracklet_graph, traxel_node, traxel_node_to_tracklet_node, tracklet_node_to_traxel_nodes);
-                assert(incoming_arcs.size() == 1);
-                addArcsToGraph(traxel_graph, tracklet_graph, incoming_arcs, traxel_node_to_tracklet_node);
-                LOG(logDEBUG4) << "traxel2tracklet.size(): " << traxel_node_to_tracklet_node.size();
-                continue;
+    // A node continues the tracklet of its ancestor if it is the only
+    // successor of its only predecessor. Then, it is the successor of the
+    // ancestor in its tracklet; the ancestor has no other.
+    const int n_nodes = static_cast<int>(nodes.size());
+    vector<Arc> intern_arc(n_nodes, lemon::INVALID);
+    vector<int> successor(n_nodes, -1);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < n_nodes; ++i) {
+        HypothesesGraph::InArcIt in(traxel_graph, nodes[i]);
+        if (in == lemon::INVALID) {
+            continue;
+        }
+        const Arc arc = in;
+        if (++in != lemon::INVALID) {
+            continue;
+        }
+        const Node ancestor = traxel_graph.source(arc);
+        HypothesesGraph::OutArcIt out(traxel_graph, ancestor);
+        if (++out != lemon::INVALID) {
+            continue;
+        }
+        const int a = index_of[traxel_graph.id(ancestor)];
+        if (a < 0) {
+            continue;
+        }
+        intern_arc[i] = arc;
+        successor[a] = i;
+    }
+
+    // chains: traxels of tracklet c are members[offsets[c]], ...,
+    // members[offsets[c+1] - 1], the intern arcs the ones between them
+    vector<int> starts;
+    for (int i = 0; i < n_nodes; ++i) {
+        if (intern_arc[i] == lemon::INVALID) {
+            starts.push_back(i);
+        }
+    }
+    const int n_tracklets = static_cast<int>(starts.size());
+    vector<size_t> offsets(n_tracklets + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int c = 0; c < n_tracklets; ++c) {
+        size_t length = 0;
+        for (int i = starts[c]; i != -1; i = successor[i]) {
+            ++length;
+        }
+        offsets[c + 1] = length;
+    }
+    for (int c = 0; c < n_tracklets; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+    vector<int> members(offsets.back());
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int c = 0; c < n_tracklets; ++c) {
+        size_t k = offsets[c];
+        for (int i = starts[c]; i != -1; i = successor[i]) {
+            members[k++] = i;
+        }
+    }
+    if (offsets.back() != nodes.size()) {
+        // a cycle without start
+        throw runtime_error("generateTrackletGraph2(): the traxel graph is not acyclic");
+    }
+
+    // tracklet nodes; every property is set once per tracklet
+    vector<Node> tracklet_of(n_nodes, lemon::INVALID);
+    vector<Traxel> tracklet;
+    vector<double> intern_dists;
+    vector<int> intern_arc_ids;
+    std::map<Node, std::vector<Node> >::iterator hint = tracklet_node_to_traxel_nodes.end();
+    for (int c = 0; c < n_tracklets; ++c) {
+        tracklet.clear();
+        intern_dists.clear();
+        intern_arc_ids.clear();
+        for (size_t k = offsets[c]; k < offsets[c + 1]; ++k) {
+            const int i = members[k];
+            tracklet.push_back(traxel_map[nodes[i]]);
+            if (k != offsets[c]) {
+                intern_dists.push_back(traxel_arc_dist_map[intern_arc[i]]);
+                intern_arc_ids.push_back(traxel_graph.id(intern_arc[i]));
             }
+        }
+        const Node tracklet_node = tracklet_graph.add_node(tracklet.front().Timestep);
+        LOG(logDEBUG4) << "added tracklet node " << tracklet_graph.id(tracklet_node);
+        tracklet_map.set(tracklet_node, tracklet);
+        tracklet_intern_dist_map.set(tracklet_node, intern_dists);
+        if (!intern_arc_ids.empty()) {
+            tracklet_arc_id_map.set(tracklet_node, intern_arc_ids);
+        }
+
+        hint = tracklet_node_to_traxel_nodes.insert(hint, make_pair(tracklet_node, vector<Node>()));
+        vector<Node>& traxel_nodes = hint->second;
+        traxel_nodes.reserve(offsets[c + 1] - offsets[c]);
+        for (size_t k = offsets[c]; k < offsets[c + 1]; ++k) {
+            tracklet_of[members[k]] = tracklet_node;
+            traxel_nodes.push_back(nodes[members[k]]);
+        }
+    }
 
-            double dist = traxel_arc_dist_map[incoming_arcs[0]];
-            int arc_id = traxel_graph.id(incoming_arcs[0]);
-            addNodeToTracklet(traxel_graph, tracklet_graph, traxel_node, ancestor, traxel_node_to_tracklet_node, dist,
-                              tracklet_node_to_traxel_nodes, arc_id);
+    // arcs between the tracklets: the incoming arcs of their first traxels
+    for (int c = 0; c < n_tracklets; ++c) {
+        const Node to = tracklet_of[starts[c]];
+        for (HypothesesGraph::InArcIt arc(traxel_graph, nodes[starts[c]]); arc != lemon::INVALID; ++arc) {
+            const int source = index_of[traxel_graph.id(traxel_graph.source(arc))];
+            assert(source >= 0);
+            const Node from = tracklet_of[source];
+            assert(from != to);
+            const Arc tracklet_arc = tracklet_graph.addArc(from, to);
+            tracklet_arc_distances.set(tracklet_arc, traxel_arc_dist_map[arc]);
+            traxel_arc_ids.set(tracklet_arc, (int) traxel_graph.id(arc));
         }
     }
 
+    LOG(logDEBUG) << "generateTrackletGraph2(): " << n_tracklets << " tracklets of " << n_nodes << " traxels";
     return tracklet_node_to_traxel_nodes;
 }
 
@@ -711,8 +1018,7 @@ boost::shared_ptr<std::vector< std::map<unsigned int, bool> > > state_of_nodes(c
     // required node properties: timestep, traxel, active
     typedef property_map<node_timestep, HypothesesGraph::base_graph>::type node_timestep_map_t;
     node_timestep_map_t& node_timestep_map = g.get(node_timestep());
-    typedef property_map<node_traxel, HypothesesGraph::base_graph>::type node_traxel_map_t;
-    node_traxel_map_t& node_traxel_map = g.get(node_traxel());
+    const NodeTraxels node_traxel_map(g);
     property_map<node_active, HypothesesGraph::base_graph>::type* node_active_map;
     property_map<node_active2, HypothesesGraph::base_graph>::type* node_active2_map;
     bool active2_used = false;
@@ -801,10 +1107,249 @@ void read_lgf( HypothesesGraph& g, std::istream& is, bool with_n_traxel ) {
 
 
 
+//
+// binary serialization
+//
+void to_arrays( const HypothesesGraph& g, HypothesesGraphArrays& arrays, vector<HypothesesGraph::Node>& nodes ) {
+    vector<HypothesesGraph::Arc> arcs;
+    to_arrays(g, arrays, nodes, arcs);
+}
+
+void to_arrays( const HypothesesGraph& g, HypothesesGraphArrays& arrays, vector<HypothesesGraph::Node>& nodes,
+                vector<HypothesesGraph::Arc>& arcs ) {
+    const HypothesesGraph::node_timestep_map& timestep_m = g.get(node_timestep());
+    const property_map<arc_from_timestep, HypothesesGraph::base_graph>::type& from_m = g.get(arc_from_timestep());
+    const property_map<arc_to_timestep, HypothesesGraph::base_graph>::type& to_m = g.get(arc_to_timestep());
+
+    nodes.clear();
+    arrays.node_timesteps.clear();
+    // node ids may have holes after erasing
+    HypothesesGraph::NodeMap<int> number(g, -1);
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        number[n] = static_cast<int>(nodes.size());
+        nodes.push_back(n);
+        arrays.node_timesteps.push_back(timestep_m[n]);
+    }
+
+    const size_t n_arcs = lemon::countArcs(g);
+    arcs.clear();
+    arcs.reserve(n_arcs);
+    arrays.arc_sources.clear();
+    arrays.arc_targets.clear();
+    arrays.arc_from_timesteps.clear();
+    arrays.arc_to_timesteps.clear();
+    arrays.arc_sources.reserve(n_arcs);
+    arrays.arc_targets.reserve(n_arcs);
+    arrays.arc_from_timesteps.reserve(n_arcs);
+    arrays.arc_to_timesteps.reserve(n_arcs);
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        arcs.push_back(a);
+        arrays.arc_sources.push_back(number[g.source(a)]);
+        arrays.arc_targets.push_back(number[g.target(a)]);
+        arrays.arc_from_timesteps.push_back(from_m[a]);
+        arrays.arc_to_timesteps.push_back(to_m[a]);
+    }
+}
+
+void from_arrays( HypothesesGraph& g, const HypothesesGraphArrays& arrays, vector<HypothesesGraph::Node>& nodes ) {
+    vector<HypothesesGraph::Arc> arcs;
+    from_arrays(g, arrays, nodes, arcs);
+}
+
+void from_arrays( HypothesesGraph& g, const HypothesesGraphArrays& arrays, vector<HypothesesGraph::Node>& nodes,
+                  vector<HypothesesGraph::Arc>& arcs ) {
+    const size_t n_arcs = arrays.arc_sources.size();
+    if (arrays.arc_targets.size() != n_arcs || arrays.arc_from_timesteps.size() != n_arcs
+            || arrays.arc_to_timesteps.size() != n_arcs) {
+        throw runtime_error("from_arrays(): arc arrays differ in size");
+    }
+    property_map<arc_from_timestep, HypothesesGraph::base_graph>::type& from_m = g.get(arc_from_timestep());
+    property_map<arc_to_timestep, HypothesesGraph::base_graph>::type& to_m = g.get(arc_to_timestep());
+
+    nodes.clear();
+    nodes.reserve(arrays.node_timesteps.size());
+    arcs.clear();
+    arcs.reserve(n_arcs);
+    g.reserveNode(lemon::countNodes(g) + arrays.node_timesteps.size());
+    g.reserveArc(lemon::countArcs(g) + n_arcs);
+    for (vector<int>::const_iterator t = arrays.node_timesteps.begin(); t != arrays.node_timesteps.end(); ++t) {
+        nodes.push_back(g.add_node(*t));
+    }
+    for (size_t i = 0; i < n_arcs; ++i) {
+        const int source = arrays.arc_sources[i];
+        const int target = arrays.arc_targets[i];
+        if (source < 0 || target < 0 || static_cast<size_t>(source) >= nodes.size()
+                || static_cast<size_t>(target) >= nodes.size()) {
+            throw runtime_error("from_arrays(): arc refers to an unknown node");
+        }
+        HypothesesGraph::Arc arc = g.addArc(nodes[source], nodes[target]);
+        from_m.set(arc, arrays.arc_from_timesteps[i]);
+        to_m.set(arc, arrays.arc_to_timesteps[i]);
+        arcs.push_back(arc);
+    }
+}
+
+void write_binary( const HypothesesGraph& g, std::ostream& os, bool traxel_references ) {
+    boost::archive::binary_oarchive oa(os);
+    oa << traxel_references;
+    if (!traxel_references) {
+        oa << g;
+        return;
+    }
+
+    HypothesesGraphArrays arrays;
+    vector<HypothesesGraph::Node> nodes;
+    to_arrays(g, arrays, nodes);
+    const NodeTraxels traxel_m(g);
+    vector<int> traxel_timesteps;
+    vector<unsigned int> traxel_ids;
+    traxel_timesteps.reserve(nodes.size());
+    traxel_ids.reserve(nodes.size());
+    for (vector<HypothesesGraph::Node>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+        traxel_timesteps.push_back(traxel_m[*n].Timestep);
+        traxel_ids.push_back(traxel_m[*n].Id);
+    }
+    oa << arrays << traxel_timesteps << traxel_ids;
+}
+
+void read_binary( HypothesesGraph& g, std::istream& is, const TraxelStore* ts ) {
+    boost::archive::binary_iarchive ia(is);
+    bool traxel_references;
+    ia >> traxel_references;
+    if (!traxel_references) {
+        ia >> g;
+        return;
+    }
+    if (!ts) {
+        throw invalid_argument("read_binary(): the graph refers to the traxels of a traxelstore");
+    }
+
+    HypothesesGraphArrays arrays;
+    vector<int> traxel_timesteps;
+    vector<unsigned int> traxel_ids;
+    ia >> arrays >> traxel_timesteps >> traxel_ids;
+    if (traxel_timesteps.size() != arrays.node_timesteps.size() || traxel_ids.size() != arrays.node_timesteps.size()) {
+        throw runtime_error("read_binary(): one traxel reference per node expected");
+    }
+
+    vector<HypothesesGraph::Node> nodes;
+    from_arrays(g, arrays, nodes);
+    if (!g.has_traxels()) {
+        g.add(node_traxel());
+    }
+    const TraxelStoreByTimeid& traxels = ts->get<by_timeid>();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        TraxelStoreByTimeid::const_iterator traxel = traxels.find(boost::make_tuple(traxel_timesteps[i], traxel_ids[i]));
+        if (traxel == traxels.end()) {
+            stringstream ss;
+            ss << "read_binary(): traxel " << traxel_ids[i] << " at timestep " << traxel_timesteps[i]
+               << " not in the traxelstore";
+            throw runtime_error(ss.str());
+        }
+        g.set_traxel(nodes[i], *traxel);
+        g.index_traxel_node(nodes[i], *traxel);
+    }
+}
+
+namespace {
+// heap bytes of a property value beyond sizeof the value
+template <typename T>
+size_t dynamic_bytes(const T&) {
+    return 0;
+}
+
+size_t dynamic_bytes(const Traxel& t) {
+    return t.memory_bytes() - sizeof(Traxel);
+}
+
+template <typename T>
+size_t dynamic_bytes(const std::vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+size_t dynamic_bytes(const std::vector<Traxel>& v) {
+    size_t bytes = v.capacity() * sizeof(Traxel);
+    for (std::vector<Traxel>::const_iterator it = v.begin(); it != v.end(); ++it) {
+        bytes += dynamic_bytes(*it);
+    }
+    return bytes;
+}
+
+string property_component(const string& name) {
+    return "graph property " + name;
+}
+
+// lemon::IterableValueMap: value and list pointers per item id, and a
+// std::map entry per distinct value
+template <typename PropertyTag, typename ItemIt>
+void add_value_map_usage(const HypothesesGraph& g, size_t item_ids, MemoryReport& report) {
+    typedef typename property_map<PropertyTag, HypothesesGraph::base_graph>::type Map;
+    if (!g.has_property(PropertyTag())) {
+        return;
+    }
+    const Map& m = g.get(PropertyTag());
+    size_t bytes = item_ids * (sizeof(typename Map::Value) + 2 * sizeof(typename Map::Key));
+    for (ItemIt it(g); it != lemon::INVALID; ++it) {
+        bytes += dynamic_bytes(m[it]);
+    }
+    const size_t map_node = 4 * sizeof(void*) + sizeof(typename Map::Value) + sizeof(typename Map::Key);
+    for (typename Map::ValueIt v = m.beginValue(); v != m.endValue(); ++v) {
+        bytes += map_node + dynamic_bytes(*v);
+    }
+    report.add(property_component(property_map<PropertyTag, HypothesesGraph::base_graph>::name), bytes);
+}
+
+// lemon::IterableBoolMap: a position per item id and the partitioned items;
+// plain maps (ArcMap, TraxelHandleMap): a value per item id
+template <typename PropertyTag>
+void add_dense_map_usage(const HypothesesGraph& g, size_t item_ids, size_t bytes_per_item, MemoryReport& report) {
+    if (g.has_property(PropertyTag())) {
+        report.add(property_component(property_map<PropertyTag, HypothesesGraph::base_graph>::name),
+                   item_ids * bytes_per_item);
+    }
+}
+}
+
+void add_memory_usage(const HypothesesGraph& g, MemoryReport& report) {
+    typedef HypothesesGraph::NodeIt NodeIt;
+    typedef HypothesesGraph::ArcIt ArcIt;
+    const size_t node_ids = static_cast<size_t>(g.maxNodeId() + 1);
+    const size_t arc_ids = static_cast<size_t>(g.maxArcId() + 1);
+    // lemon::ListDigraph keeps 4 ints per node and 6 per arc
+    report.add("graph structure", node_ids * 4 * sizeof(int) + arc_ids * 6 * sizeof(int));
+    report.add("graph indices", g.index_memory_bytes());
+
+    const size_t bool_map_item = sizeof(int) + sizeof(HypothesesGraph::Node);
+    add_value_map_usage<node_timestep, NodeIt>(g, node_ids, report);
+    add_value_map_usage<node_traxel, NodeIt>(g, node_ids, report);
+    add_dense_map_usage<node_traxel_handle>(g, node_ids, sizeof(const Traxel*), report);
+    add_value_map_usage<node_tracklet, NodeIt>(g, node_ids, report);
+    add_value_map_usage<tracklet_intern_dist, NodeIt>(g, node_ids, report);
+    add_value_map_usage<tracklet_intern_arc_ids, NodeIt>(g, node_ids, report);
+    add_dense_map_usage<node_active>(g, node_ids, bool_map_item, report);
+    add_value_map_usage<node_active2, NodeIt>(g, node_ids, report);
+    add_dense_map_usage<node_offered>(g, node_ids, bool_map_item, report);
+    add_value_map_usage<arc_distance, ArcIt>(g, arc_ids, report);
+    add_value_map_usage<traxel_arc_id, ArcIt>(g, arc_ids, report);
+    add_value_map_usage<arc_vol_ratio, ArcIt>(g, arc_ids, report);
+    add_value_map_usage<split_from, NodeIt>(g, node_ids, report);
+    add_dense_map_usage<arc_from_timestep>(g, arc_ids, sizeof(int), report);
+    add_dense_map_usage<arc_to_timestep>(g, arc_ids, sizeof(int), report);
+    add_dense_map_usage<arc_active>(g, arc_ids, bool_map_item, report);
+    add_dense_map_usage<division_active>(g, node_ids, bool_map_item, report);
+    add_value_map_usage<merger_resolved_to, NodeIt>(g, node_ids, report);
+    add_value_map_usage<node_originated_from, NodeIt>(g, node_ids, report);
+    add_dense_map_usage<node_resolution_candidate>(g, node_ids, bool_map_item, report);
+    add_dense_map_usage<arc_resolution_candidate>(g, arc_ids, bool_map_item, report);
+}
+
+
+
 ////
 //// class HypothesesBuilder
 ////
 HypothesesGraph* HypothesesBuilder::build() const {
+    PGMLINK_TIMED_SCOPE("HypothesesBuilder::build");
     // construct an empty HypothesesGraph with all desired additional
     // properties added
     HypothesesGraph* graph = construct();
@@ -819,7 +1364,7 @@ HypothesesGraph* HypothesesBuilder::build() const {
 
 namespace {
 double getDivisionProbability(const Traxel& tr) {
-    FeatureMap::const_iterator it = tr.features.find("divProb");
+    TraxelFeatures::const_iterator it = tr.features.find("divProb");
     if (it == tr.features.end()) {
         throw runtime_error("getDivisionProbability(): divProb feature not in traxel");
     }
@@ -831,56 +1376,165 @@ double getDivisionProbability(const Traxel& tr) {
 //// class SingleTimestepTraxel_HypothesesBuilder
 ////
 HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::construct() const {
+    if (options_.traxel_handles && streaming_ts_) {
+        throw invalid_argument("SingleTimestepTraxel_HypothesesBuilder::construct(): traxel handles require a resident traxelstore");
+    }
     HypothesesGraph* graph = new HypothesesGraph();
-    // store traxels inside the graph data structure
-    graph->add(node_traxel());
+    if (options_.traxel_handles) {
+        // refer to the traxels of the traxelstore
+        graph->add(node_traxel_handle());
+    } else {
+        // store traxels inside the graph data structure
+        graph->add(node_traxel());
+    }
     return graph;
 }
 
 HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::add_nodes(HypothesesGraph* graph) const {
     LOG(logDEBUG) << "SingleTimestepTraxel_HypothesesBuilder::add_nodes(): entered";
-    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_m = graph->get(node_traxel());
+    add_nodes_in(graph, numeric_limits<int>::min(), numeric_limits<int>::max());
+    return graph;
+}
 
-    for(TraxelStoreByTimestep::const_iterator it = ts_->begin(); it!= ts_->end(); ++it) {
-        HypothesesGraph::Node node = graph->add_node(it->Timestep);
-        traxel_m.set(node, *it);
+void SingleTimestepTraxel_HypothesesBuilder::add_nodes_in(HypothesesGraph* graph, int first, int last) const {
+    const bool slim = !options_.node_features.empty() && !options_.traxel_handles;
+    Traxel copy;
+    if (streaming_ts_) {
+        const vector<int> timesteps = streaming_ts_->timesteps();
+        for (vector<int>::const_iterator t = timesteps.begin(); t != timesteps.end(); ++t) {
+            if (*t < first || *t > last) {
+                continue;
+            }
+            const TraxelStoreByTimestep& traxels = traxels_at(*t).get<by_timestep>();
+            pair<TraxelStoreByTimestep::const_iterator, TraxelStoreByTimestep::const_iterator> range =
+                    traxels.equal_range(*t);
+            for (TraxelStoreByTimestep::const_iterator it = range.first; it != range.second; ++it) {
+                if (slim) {
+                    copy = *it;
+                    graph->add_traxel_node(copy.keep_features(options_.node_features));
+                } else {
+                    graph->add_traxel_node(*it);
+                }
+            }
+        }
+        return;
     }
 
-    return graph;
+    const TraxelStoreByTimestep& traxels = ts_->get<by_timestep>();
+    TraxelStoreByTimestep::const_iterator end = traxels.upper_bound(last);
+    for(TraxelStoreByTimestep::const_iterator it = traxels.lower_bound(first); it != end; ++it) {
+        if (slim) {
+            copy = *it;
+            graph->add_traxel_node(copy.keep_features(options_.node_features));
+        } else {
+            graph->add_traxel_node(*it);
+        }
+    }
+}
+
+const TraxelStore& SingleTimestepTraxel_HypothesesBuilder::traxels_at(int timestep) const {
+    if (streaming_ts_) {
+        return streaming_ts_->require(timestep, timestep);
+    }
+    return *ts_;
 }
 
 HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::add_edges(
         HypothesesGraph* graph) const {
     LOG(logDEBUG) << "SingleTimestepTraxel_HypothesesBuilder::add_edges(): entered";
+    if (graph->timesteps().empty()) {
+        return graph;
+    }
+    add_edges_from(graph, graph->earliest_timestep(), graph->earliest_timestep());
+    return graph;
+}
+
+HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::extend(HypothesesGraph* graph, int first_timestep,
+                                                                int last_timestep) const {
+    LOG(logDEBUG) << "SingleTimestepTraxel_HypothesesBuilder::extend(): timesteps [" << first_timestep
+                  << ", " << last_timestep << "]";
+    if (last_timestep < first_timestep) {
+        throw invalid_argument("extend(): empty range of timesteps");
+    }
+    const bool empty = graph->timesteps().empty();
+    if (!empty && first_timestep <= graph->latest_timestep()) {
+        throw invalid_argument("extend(): timesteps have to be later than the timesteps of the graph");
+    }
+    const int boundary = empty ? first_timestep : graph->latest_timestep();
+
+    // the traxels of the new timesteps may have arrived after their
+    // (empty) indices were cached
+    for (int t = first_timestep; t <= last_timestep; ++t) {
+        indices_.erase(make_pair(t, false));
+        indices_.erase(make_pair(t, true));
+    }
+
+    add_nodes_in(graph, first_timestep, last_timestep);
+    if (!graph->timesteps().empty()) {
+        add_edges_from(graph, boundary, first_timestep);
+    }
+    return graph;
+}
+
+void SingleTimestepTraxel_HypothesesBuilder::add_edges_from(HypothesesGraph* graph, int forward_from,
+                                                            int backward_from) const {
     typedef HypothesesGraph::node_timestep_map::Value timestep_t;
     const set<timestep_t>& timesteps = graph->timesteps();
-    // iterate over all timesteps except the last
-    for (set<timestep_t>::const_iterator t = timesteps.begin();
-         t != (--timesteps.end()); ++t) {
-        add_edges_at(graph, *t);
-    }
 
-    // if the forward_backward option is enabled, go again through the graph, this time
-    // reversely and add the nearest neighbors if not already present
+    // jobs: all timesteps except the last (forward) and, if the
+    // forward_backward option is enabled, all timesteps except the first
+    // in reverse, adding the nearest neighbors if not already present
+    vector<pair<int, bool> > jobs;
+    for (set<timestep_t>::const_iterator t = timesteps.lower_bound(forward_from);
+         t != timesteps.end() && t != (--timesteps.end()); ++t) {
+        jobs.push_back(make_pair(*t, false));
+    }
     if (options_.forward_backward) {
-        // reversely iterate over all timesteps except the first
         for (set<timestep_t>::const_reverse_iterator t = timesteps.rbegin();
-             t != (--timesteps.rend()); ++t) {
-            add_edges_at(graph, *t, true);
+             t != (--timesteps.rend()) && *t >= backward_from; ++t) {
+            jobs.push_back(make_pair(*t, true));
         }
     }
 
-    return graph;
+    PGMLINK_TIMED_SCOPE("HypothesesBuilder: add arcs");
+    // search the neighbor candidates (independent per job)...
+    vector<Candidates> candidates(jobs.size());
+    if (options_.parallel && !streaming_ts_) {
+        string error;
+        #pragma omp parallel for schedule(dynamic)
+        for (int i = 0; i < static_cast<int>(jobs.size()); ++i) {
+            try {
+                candidates_at(*graph, jobs[i].first, jobs[i].second, candidates[i]);
+            } catch (std::exception& e) {
+                #pragma omp critical(pgmlink_hypotheses_builder)
+                {
+                    if (error.empty()) error = e.what();
+                }
+            }
+        }
+        if (!error.empty()) {
+            throw runtime_error(error);
+        }
+    } else {
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            candidates_at(*graph, jobs[i].first, jobs[i].second, candidates[i]);
+        }
+    }
+
+    // ...and insert the arcs in job order, so that the graph does not
+    // depend on the scheduling
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const int to_timestep = jobs[i].second ? jobs[i].first - 1 : jobs[i].first + 1;
+        add_arcs(graph, jobs[i].first, to_timestep, jobs[i].second, candidates[i]);
+        Candidates().swap(candidates[i]);
+    }
 }
 
-HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::add_edges_at(HypothesesGraph* graph,
-                                                                      int timestep, bool reverse) const {
-    const HypothesesGraph::node_timestep_map& timemap = graph->get(
+void SingleTimestepTraxel_HypothesesBuilder::candidates_at(const HypothesesGraph& graph, int timestep,
+                                                           bool reverse, Candidates& candidates) const {
+    const HypothesesGraph::node_timestep_map& timemap = graph.get(
                 node_timestep());
-    typedef property_map<node_traxel, HypothesesGraph::base_graph>::type traxelmap_t;
-    const traxelmap_t& traxelmap = graph->get(node_traxel());
-    const TraxelStoreByTimeid& traxels_by_timeid = ts_->get<by_timeid>();
-    const TraxelStoreByTimestep& traxels_by_timestep = ts_->get<by_timestep>();
+    const NodeTraxels traxelmap(graph);
 
     int to_timestep = timestep + 1;
     if (reverse) {
@@ -889,20 +1543,12 @@ HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::add_edges_at(Hypotheses
     }
 
     //// find k nearest neighbors in next timestep
-    // init nearest neighbor search
-    pair<TraxelStoreByTimestep::const_iterator,
-            TraxelStoreByTimestep::const_iterator> traxels_at =
-            traxels_by_timestep.equal_range(to_timestep);
-
-    for (TraxelStoreByTimestep::const_iterator it = traxels_at.first;
-         it != traxels_at.second; ++it) {
-        assert(it->Timestep == to_timestep);
-    }
-
-    NearestNeighborSearch nns(traxels_at.first, traxels_at.second, reverse);
+    boost::shared_ptr<SpatialIndex> nns = index_at(to_timestep, reverse);
 
-
-    // establish transition edges between a current node and appropriate nodes in next timestep
+    // queries: the current nodes and their number of nearest neighbors
+    vector<HypothesesGraph::Node> nodes;
+    vector<const Traxel*> queries;
+    vector<unsigned int> knn;
     for (HypothesesGraph::node_timestep_map::ItemIt curr_node(timemap,
                                                               timestep); curr_node != lemon::INVALID; ++curr_node) {
         assert(timemap[curr_node] == timestep);
@@ -919,41 +1565,209 @@ HypothesesGraph* SingleTimestepTraxel_HypothesesBuilder::add_edges_at(Hypotheses
             }
         }
 
-        // search
-        map<unsigned int, double> nearest_neighbors = nns.knn_in_range(
-                    traxelmap[curr_node], options_.distance_threshold,
-                    max_nn, reverse);
-
-        //// connect current node with k nearest neighbor nodes
-        for (map<unsigned int, double>::const_iterator neighbor =
-             nearest_neighbors.begin(); neighbor != nearest_neighbors.end();
-             ++neighbor) {
-            // connect with one of the neighbor nodes
-            TraxelStoreByTimeid::iterator neighbor_traxel =
-                    traxels_by_timeid.find(
-                        boost::make_tuple(to_timestep, neighbor->first));
-            assert(neighbor_traxel->Timestep == to_timestep);
-            assert(neighbor_traxel->Timestep != traxelmap[curr_node].Timestep);
-            traxelmap_t::ItemIt neighbor_node(traxelmap, *neighbor_traxel);
-            assert(curr_node != neighbor_node);
-            if (!reverse) {
-                // if we go through the graph forward in time, add an arc from curr_node to neighbor_node
-                LOG(logDEBUG4) << "added arc from traxel " << traxelmap[curr_node].Id << " to " <<
-                                  traxelmap[neighbor_node].Id;
-                graph->addArc(curr_node, neighbor_node);
-            } else {
-                // if we go through the graph backward in time, add an arc from neighbor_node to curr_node
-                // if not already present
-                if (lemon::findArc(*graph,neighbor_node,curr_node) == lemon::INVALID) {
-                    graph->addArc(neighbor_node, curr_node);
-                    LOG(logDEBUG4) << "added backward arc from traxel " << traxelmap[neighbor_node].Id << " to " <<
-                                      traxelmap[curr_node].Id;
+        nodes.push_back(curr_node);
+        queries.push_back(&traxelmap[curr_node]);
+        knn.push_back(max_nn);
+    }
+
+    // search
+    vector<size_t> offsets;
+    vector<unsigned int> neighbor_ids;
+    vector<double> distances;
+    nns->knn_in_range(queries, knn, options_.distance_threshold,
+                      offsets, neighbor_ids, distances, reverse);
+
+    // candidate transitions between a current node and appropriate nodes in next timestep
+    candidates.reserve(neighbor_ids.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (size_t n = offsets[i]; n < offsets[i + 1]; ++n) {
+            candidates.push_back(make_pair(nodes[i], neighbor_ids[n]));
+        }
+    }
+}
+
+boost::shared_ptr<SpatialIndex> SingleTimestepTraxel_HypothesesBuilder::index_at(int timestep,
+                                                                               bool reverse) const {
+    const TraxelStore& store = traxels_at(timestep);
+    const TraxelStoreByTimestep& traxels_by_timestep = store.get<by_timestep>();
+    pair<TraxelStoreByTimestep::const_iterator,
+            TraxelStoreByTimestep::const_iterator> traxels =
+            traxels_by_timestep.equal_range(timestep);
+
+    // the corrected positions are the positions unless there is a
+    // com_corrected, so the forward and the backward pass share the index
+    bool corrected = false;
+    if (reverse) {
+        for (TraxelStoreByTimestep::const_iterator t = traxels.first; t != traxels.second && !corrected; ++t) {
+            corrected = t->features.count("com_corrected") > 0;
+        }
+    }
+
+    const pair<int, bool> key(timestep, corrected);
+    // the grid cells are about the query radius; kd-trees serve any radius
+    const double cell_size = grid_index() ? options_.distance_threshold : 0.;
+    boost::shared_ptr<SpatialIndex> index;
+    if (!streaming_ts_) {
+        #pragma omp critical(pgmlink_hypotheses_builder_indices)
+        {
+            map<pair<int, bool>, CachedIndex>::const_iterator it = indices_.find(key);
+            if (it != indices_.end()) {
+                const double cached = it->second.cell_size;
+                const bool fits = cell_size > 0 ? cached > 0 && cell_size <= 2 * cached && cached <= 2 * cell_size
+                                                : cached == 0;
+                if (fits) {
+                    index = it->second.index;
                 }
             }
         }
+        if (index) {
+            return index;
+        }
     }
 
+    if (cell_size > 0) {
+        index.reset(new GridNeighborSearch(traxels.first, traxels.second, cell_size, corrected));
+    } else {
+        index.reset(new NearestNeighborSearch(traxels.first, traxels.second, corrected, options_.dimensions));
+    }
+
+    // two jobs of a parallel build may build the same index; the searches
+    // are read-only, so either copy serves
+    if (!streaming_ts_) {
+        CachedIndex entry;
+        entry.cell_size = cell_size;
+        entry.index = index;
+        #pragma omp critical(pgmlink_hypotheses_builder_indices)
+        indices_[key] = entry;
+    }
+    return index;
+}
+
+bool SingleTimestepTraxel_HypothesesBuilder::grid_index() const {
+    if (options_.spatial_index == Options::AutoIndex) {
+        // the kd-tree searches would be serialized
+        return options_.parallel && !streaming_ts_;
+    }
+    return options_.spatial_index == Options::GridIndex;
+}
+
+void SingleTimestepTraxel_HypothesesBuilder::add_arcs(HypothesesGraph* graph, int timestep, int to_timestep,
+                                                      bool reverse, const Candidates& candidates) const {
+    const NodeTraxels traxelmap(*graph);
+    property_map<arc_from_timestep, HypothesesGraph::base_graph>::type& from_timestep_m = graph->get(arc_from_timestep());
+    property_map<arc_to_timestep, HypothesesGraph::base_graph>::type& to_timestep_m = graph->get(arc_to_timestep());
+
+    // nodes of to_timestep by traxel id (no nodes are added below)
+    const vector<HypothesesGraph::Node>& neighbor_nodes = graph->traxel_nodes(to_timestep);
+
+    //// connect current node with k nearest neighbor nodes
+    size_t n_added = 0;
+    for (Candidates::const_iterator candidate = candidates.begin(); candidate != candidates.end(); ++candidate) {
+        const HypothesesGraph::Node& curr_node = candidate->first;
+        // connect with one of the neighbor nodes
+        assert(candidate->second < neighbor_nodes.size());
+        const HypothesesGraph::Node neighbor_node = neighbor_nodes[candidate->second];
+        assert(neighbor_node != lemon::INVALID);
+        assert(traxelmap[neighbor_node].Timestep == to_timestep);
+        assert(traxelmap[neighbor_node].Timestep != traxelmap[curr_node].Timestep);
+        assert(curr_node != neighbor_node);
+        if (!reverse) {
+            // if we go through the graph forward in time, add an arc from curr_node to neighbor_node
+            LOG(logDEBUG4) << "added arc from traxel " << traxelmap[curr_node].Id << " to " <<
+                              traxelmap[neighbor_node].Id;
+            HypothesesGraph::Arc arc = graph->addArc(curr_node, neighbor_node);
+            from_timestep_m.set(arc, timestep);
+            to_timestep_m.set(arc, to_timestep);
+            ++n_added;
+        } else {
+            // if we go through the graph backward in time, add an arc from neighbor_node to curr_node
+            // if not already present
+            if (lemon::findArc(*graph,neighbor_node,curr_node) == lemon::INVALID) {
+                HypothesesGraph::Arc arc = graph->addArc(neighbor_node, curr_node);
+                from_timestep_m.set(arc, to_timestep);
+                to_timestep_m.set(arc, timestep);
+                ++n_added;
+                LOG(logDEBUG4) << "added backward arc from traxel " << traxelmap[neighbor_node].Id << " to " <<
+                                  traxelmap[curr_node].Id;
+            }
+        }
+    }
+    PGMLINK_COUNT("HypothesesBuilder: arcs added", n_added);
+}
+
+
+
+////
+//// class GapClosing_HypothesesBuilder
+////
+HypothesesGraph* GapClosing_HypothesesBuilder::add_edges(HypothesesGraph* graph) const {
+    SingleTimestepTraxel_HypothesesBuilder::add_edges(graph);
+    if (max_gap_ < 2) {
+        return graph;
+    }
+    LOG(logDEBUG) << "GapClosing_HypothesesBuilder::add_edges(): bridging gaps of up to " << max_gap_ << " timesteps";
+    add_gap_arcs(graph, false);
+    if (options_.forward_backward) {
+        add_gap_arcs(graph, true);
+    }
     return graph;
 }
 
+void GapClosing_HypothesesBuilder::add_gap_arcs(HypothesesGraph* graph, bool reverse) const {
+    typedef HypothesesGraph::node_timestep_map::Value timestep_t;
+    const HypothesesGraph::node_timestep_map& timemap = graph->get(node_timestep());
+    const NodeTraxels traxelmap(*graph);
+    const set<timestep_t>& timesteps = graph->timesteps();
+
+    vector<HypothesesGraph::Node> nodes;
+    vector<const Traxel*> queries;
+    vector<unsigned int> knn;
+    vector<size_t> offsets;
+    vector<unsigned int> neighbor_ids;
+    vector<double> distances;
+    size_t n_arcs = 0;
+    for (set<timestep_t>::const_iterator t = timesteps.begin(); t != timesteps.end(); ++t) {
+        // nodes without successor (predecessor if reverse)
+        nodes.clear();
+        for (HypothesesGraph::node_timestep_map::ItemIt node(timemap, *t); node != lemon::INVALID; ++node) {
+            const bool connected = reverse ? (HypothesesGraph::InArcIt(*graph, node) != lemon::INVALID)
+                                           : (HypothesesGraph::OutArcIt(*graph, node) != lemon::INVALID);
+            if (!connected) {
+                nodes.push_back(node);
+            }
+        }
+
+        for (unsigned int gap = 2; gap <= max_gap_ && !nodes.empty(); ++gap) {
+            const int to_timestep = reverse ? *t - static_cast<int>(gap) : *t + static_cast<int>(gap);
+            if (timesteps.count(to_timestep) == 0) {
+                continue;
+            }
+            queries.clear();
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                queries.push_back(&traxelmap[nodes[i]]);
+            }
+            knn.assign(nodes.size(), options_.max_nearest_neighbors);
+            index_at(to_timestep, reverse)->knn_in_range(queries, knn, options_.distance_threshold,
+                                                         offsets, neighbor_ids, distances, reverse);
+
+            // bridge to the closest timestep with any neighbor
+            Candidates candidates;
+            vector<HypothesesGraph::Node> unbridged;
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                if (offsets[i] == offsets[i + 1]) {
+                    unbridged.push_back(nodes[i]);
+                }
+                for (size_t n = offsets[i]; n < offsets[i + 1]; ++n) {
+                    candidates.push_back(make_pair(nodes[i], neighbor_ids[n]));
+                }
+            }
+            add_arcs(graph, *t, to_timestep, reverse, candidates);
+            n_arcs += candidates.size();
+            nodes.swap(unbridged);
+        }
+    }
+    LOG(logDEBUG1) << "GapClosing_HypothesesBuilder::add_gap_arcs(): " << n_arcs << " candidate arcs"
+                   << (reverse ? " backward" : "");
+}
+
 } /* namespace pgmlink */
@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <vector>
+
+#include <lemon/core.h>
+
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/hypotheses_snapshot.h"
+
+using namespace std;
+
+namespace pgmlink {
+  const size_t HypothesesGraphSnapshot::npos;
+
+  HypothesesGraphSnapshot::HypothesesGraphSnapshot(const HypothesesGraph& g) {
+    const size_t n_nodes = lemon::countNodes(g);
+    const size_t n_arcs = lemon::countArcs(g);
+    nodes_.reserve(n_nodes);
+    arcs_.reserve(n_arcs);
+    node_numbers_.assign(g.maxNodeId() + 1, npos);
+    arc_numbers_.assign(g.maxArcId() + 1, npos);
+
+    for(HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+      node_numbers_[g.id(n)] = nodes_.size();
+      nodes_.push_back(n);
+    }
+
+    // arcs by source
+    out_offsets_.reserve(n_nodes + 1);
+    out_offsets_.push_back(0);
+    sources_.reserve(n_arcs);
+    for(size_t i = 0; i < nodes_.size(); ++i) {
+      for(HypothesesGraph::OutArcIt a(g, nodes_[i]); a != lemon::INVALID; ++a) {
+        arc_numbers_[g.id(a)] = arcs_.size();
+        arcs_.push_back(a);
+        sources_.push_back(i);
+      }
+      out_offsets_.push_back(arcs_.size());
+    }
+    targets_.resize(arcs_.size());
+    for(size_t k = 0; k < arcs_.size(); ++k) {
+      targets_[k] = node_numbers_[g.id(g.target(arcs_[k]))];
+    }
+
+    // in arcs
+    in_offsets_.reserve(n_nodes + 1);
+    in_offsets_.push_back(0);
+    in_arcs_.reserve(arcs_.size());
+    for(size_t i = 0; i < nodes_.size(); ++i) {
+      for(HypothesesGraph::InArcIt a(g, nodes_[i]); a != lemon::INVALID; ++a) {
+        in_arcs_.push_back(arc_numbers_[g.id(a)]);
+      }
+      in_offsets_.push_back(in_arcs_.size());
+    }
+
+    node_column(g.get(node_timestep()), node_timesteps_);
+    arc_column(g.get(arc_from_timestep()), arc_from_timesteps_);
+    arc_column(g.get(arc_to_timestep()), arc_to_timesteps_);
+  }
+
+  size_t HypothesesGraphSnapshot::node_index(const Node& n) const {
+    if(n == lemon::INVALID) {
+      return npos;
+    }
+    const size_t id = static_cast<size_t>(lemon::ListDigraph::id(n));
+    if(id >= node_numbers_.size() || node_numbers_[id] == npos || nodes_[node_numbers_[id]] != n) {
+      return npos;
+    }
+    return node_numbers_[id];
+  }
+
+  size_t HypothesesGraphSnapshot::arc_index(const Arc& a) const {
+    if(a == lemon::INVALID) {
+      return npos;
+    }
+    const size_t id = static_cast<size_t>(lemon::ListDigraph::id(a));
+    if(id >= arc_numbers_.size() || arc_numbers_[id] == npos || arcs_[arc_numbers_[id]] != a) {
+      return npos;
+    }
+    return arc_numbers_[id];
+  }
+} /* namespace pgmlink */
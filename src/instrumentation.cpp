@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "pgmlink/instrumentation.h"
+
+using namespace std;
+
+namespace pgmlink {
+namespace instrumentation {
+namespace {
+  struct ProbeValue {
+    ProbeValue() : calls(0), total(0) {}
+    size_t calls;
+    double total;
+  };
+
+  struct TraceRecord {
+    string name;
+    const char* category;
+    boost::posix_time::ptime start;
+    boost::posix_time::ptime end;
+    size_t tid;
+  };
+
+  bool record_less(const TraceRecord& a, const TraceRecord& b) {
+    return a.start < b.start;
+  }
+
+  void write_json_string(ostream& os, const string& s) {
+    os << '"';
+    for(string::const_iterator c = s.begin(); c != s.end(); ++c) {
+      if(*c == '"' || *c == '\\') {
+        os << '\\' << *c;
+      } else if(static_cast<unsigned char>(*c) < 0x20) {
+        char escaped[8];
+        sprintf(escaped, "\\u%04x", static_cast<unsigned>(*c));
+        os << escaped;
+      } else {
+        os << *c;
+      }
+    }
+    os << '"';
+  }
+
+  // the probes and trace events of one thread; only the report and
+  // stop_trace() read them from elsewhere
+  struct ThreadProbes {
+    boost::mutex mutex;
+    size_t tid;
+    vector<ProbeValue> values;
+    vector<TraceRecord> events;
+  };
+
+  void retire_thread(ThreadProbes* probes);
+
+  class Registry {
+   public:
+    Registry() : tracing_(false), next_tid_(1), local_(&retire_thread) {}
+
+    size_t probe(const char* name, bool timer) {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      for(size_t i = 0; i < names_.size(); ++i) {
+        if(names_[i] == name) {
+          if(timers_[i] != timer) {
+            throw invalid_argument(string("instrumentation::probe(): ") + name + " is a timer and a counter");
+          }
+          return i;
+        }
+      }
+      names_.push_back(name);
+      timers_.push_back(timer);
+      return names_.size() - 1;
+    }
+
+    string name(size_t probe) {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if(probe >= names_.size()) {
+        throw out_of_range("instrumentation::probe_name(): no such probe");
+      }
+      return names_[probe];
+    }
+
+    void add(size_t probe, double value) {
+      ThreadProbes* probes = local();
+      boost::lock_guard<boost::mutex> lock(probes->mutex);
+      if(probes->values.size() <= probe) {
+        probes->values.resize(probe + 1);
+      }
+      ProbeValue& v = probes->values[probe];
+      ++v.calls;
+      v.total += value;
+    }
+
+    // the values and events of an exited thread are kept in retired_
+    void retire(ThreadProbes* probes) {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      merge(probes->values, retired_);
+      retired_events_.insert(retired_events_.end(), probes->events.begin(), probes->events.end());
+      for(size_t i = 0; i < threads_.size(); ++i) {
+        if(threads_[i] == probes) {
+          threads_.erase(threads_.begin() + i);
+          break;
+        }
+      }
+      delete probes;
+    }
+
+    vector<ProbeTotals> totals() {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      vector<ProbeValue> sum(retired_);
+      for(size_t i = 0; i < threads_.size(); ++i) {
+        boost::lock_guard<boost::mutex> thread_lock(threads_[i]->mutex);
+        merge(threads_[i]->values, sum);
+      }
+      vector<ProbeTotals> ret(names_.size());
+      for(size_t i = 0; i < names_.size(); ++i) {
+        ret[i].name = names_[i];
+        ret[i].timer = timers_[i];
+        if(i < sum.size()) {
+          ret[i].calls = sum[i].calls;
+          ret[i].total = sum[i].total;
+        }
+      }
+      return ret;
+    }
+
+    void reset() {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      retired_.clear();
+      for(size_t i = 0; i < threads_.size(); ++i) {
+        boost::lock_guard<boost::mutex> thread_lock(threads_[i]->mutex);
+        threads_[i]->values.clear();
+      }
+    }
+
+    bool tracing() const {
+      return tracing_.load(boost::memory_order_acquire);
+    }
+
+    void start_trace(const string& filename) {
+      boost::lock_guard<boost::mutex> lock(mutex_);
+      if(tracing_.load(boost::memory_order_relaxed)) {
+        throw runtime_error("instrumentation::start_trace(): already tracing to " + trace_filename_);
+      }
+      // fail early rather than after the run
+      ofstream out(filename.c_str());
+      if(!out) {
+        throw runtime_error("instrumentation::start_trace(): could not open file " + filename);
+      }
+      retired_events_.clear();
+      for(size_t i = 0; i < threads_.size(); ++i) {
+        boost::lock_guard<boost::mutex> thread_lock(threads_[i]->mutex);
+        threads_[i]->events.clear();
+      }
+      trace_filename_ = filename;
+      trace_start_ = boost::posix_time::microsec_clock::universal_time();
+      // publishes the cleared buffers and the start time to trace_event()
+      tracing_.store(true, boost::memory_order_release);
+    }
+
+    void trace_event(const string& name, const char* category,
+                     const boost::posix_time::ptime& start, const boost::posix_time::ptime& end) {
+      if(!tracing_.load(boost::memory_order_acquire)) {
+        return;
+      }
+      ThreadProbes* probes = local();
+      TraceRecord r;
+      r.name = name;
+      r.category = category;
+      r.start = start;
+      r.end = end;
+      r.tid = probes->tid;
+      boost::lock_guard<boost::mutex> lock(probes->mutex);
+      probes->events.push_back(r);
+    }
+
+    void stop_trace() {
+      vector<TraceRecord> events;
+      string filename;
+      boost::posix_time::ptime trace_start;
+      {
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        if(!tracing_.load(boost::memory_order_relaxed)) {
+          return;
+        }
+        tracing_.store(false, boost::memory_order_release);
+        events.swap(retired_events_);
+        for(size_t i = 0; i < threads_.size(); ++i) {
+          boost::lock_guard<boost::mutex> thread_lock(threads_[i]->mutex);
+          events.insert(events.end(), threads_[i]->events.begin(), threads_[i]->events.end());
+          vector<TraceRecord>().swap(threads_[i]->events);
+        }
+        filename = trace_filename_;
+        trace_start = trace_start_;
+      }
+      stable_sort(events.begin(), events.end(), record_less);
+
+      ofstream out(filename.c_str());
+      out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+          << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"pgmlink\"}}";
+      for(size_t i = 0; i < events.size(); ++i) {
+        const TraceRecord& r = events[i];
+        out << ",\n{\"name\":";
+        write_json_string(out, r.name);
+        out << ",\"cat\":";
+        write_json_string(out, r.category);
+        out << ",\"ph\":\"X\",\"ts\":" << (r.start - trace_start).total_microseconds()
+            << ",\"dur\":" << (r.end - r.start).total_microseconds()
+            << ",\"pid\":1,\"tid\":" << r.tid << "}";
+      }
+      out << "\n]}\n";
+      out.close();
+      if(!out) {
+        throw runtime_error("instrumentation::stop_trace(): writing to file " + filename + " failed");
+      }
+    }
+
+   private:
+    ThreadProbes* local() {
+      ThreadProbes* probes = local_.get();
+      if(!probes) {
+        probes = new ThreadProbes;
+        {
+          boost::lock_guard<boost::mutex> lock(mutex_);
+          probes->tid = next_tid_++;
+          threads_.push_back(probes);
+        }
+        local_.reset(probes);
+      }
+      return probes;
+    }
+
+    static void merge(const vector<ProbeValue>& from, vector<ProbeValue>& to) {
+      if(to.size() < from.size()) {
+        to.resize(from.size());
+      }
+      for(size_t i = 0; i < from.size(); ++i) {
+        to[i].calls += from[i].calls;
+        to[i].total += from[i].total;
+      }
+    }
+
+    boost::mutex mutex_;
+    vector<string> names_;
+    vector<bool> timers_;
+    vector<ThreadProbes*> threads_;
+    vector<ProbeValue> retired_;
+    vector<TraceRecord> retired_events_;
+    // read without the lock by tracing() and trace_event(); written under
+    // mutex_ (the relaxed reads under mutex_ are ordered by it)
+    boost::atomic<bool> tracing_;
+    string trace_filename_;
+    boost::posix_time::ptime trace_start_;
+    size_t next_tid_;
+    boost::thread_specific_ptr<ThreadProbes> local_;
+  };
+
+  // never destroyed: threads may exit after the static destructors ran
+  Registry& registry() {
+    static Registry* r = new Registry;
+    return *r;
+  }
+
+  void retire_thread(ThreadProbes* probes) {
+    registry().retire(probes);
+  }
+}
+
+bool enabled() {
+#ifdef PGMLINK_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t probe(const char* name, bool timer) {
+  return registry().probe(name, timer);
+}
+
+string probe_name(size_t probe) {
+  return registry().name(probe);
+}
+
+void count(size_t probe, double n) {
+  registry().add(probe, n);
+}
+
+void add_time(size_t probe, double seconds) {
+  registry().add(probe, seconds);
+}
+
+vector<ProbeTotals> totals() {
+  return registry().totals();
+}
+
+void report(ostream& os) {
+  const vector<ProbeTotals> t = totals();
+  size_t width = 5;
+  for(size_t i = 0; i < t.size(); ++i) {
+    width = max(width, t[i].name.size());
+  }
+  os << left << setw(width) << "probe" << right << setw(12) << "calls" << setw(16) << "total"
+     << setw(16) << "per call" << '\n';
+  for(size_t i = 0; i < t.size(); ++i) {
+    if(t[i].calls == 0) {
+      continue;
+    }
+    os << left << setw(width) << t[i].name << right << setw(12) << t[i].calls
+       << setw(15) << t[i].total << (t[i].timer ? "s" : " ")
+       << setw(15) << t[i].total / t[i].calls << (t[i].timer ? "s" : " ") << '\n';
+  }
+}
+
+void reset() {
+  registry().reset();
+}
+
+void start_trace(const string& filename) {
+  registry().start_trace(filename);
+}
+
+void stop_trace() {
+  registry().stop_trace();
+}
+
+bool tracing() {
+  return registry().tracing();
+}
+
+void trace_event(const string& name, const char* category,
+                 const boost::posix_time::ptime& start, const boost::posix_time::ptime& end) {
+  registry().trace_event(name, category, start, end);
+}
+
+} /* namespace instrumentation */
+} /* namespace pgmlink */
@@ -0,0 +1,199 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "pgmlink/log.h"
+
+using namespace std;
+
+namespace pgmlink {
+namespace {
+  // messages of one thread that were not written yet
+  struct ThreadBuffer {
+    ThreadBuffer() : finished(false) {}
+    boost::mutex mutex;
+    string text;
+    // the thread has exited, the writer deletes the buffer once it is empty
+    bool finished;
+  };
+
+  void finish_buffer(ThreadBuffer* buffer) {
+    boost::lock_guard<boost::mutex> lock(buffer->mutex);
+    buffer->finished = true;
+  }
+
+  class AsyncLogWriter {
+  public:
+    AsyncLogWriter() : enabled_(false), stop_(false), interval_(0.05), local_(&finish_buffer) {}
+
+    // the buffers are left to the end of the program, threads that exit
+    // later still mark theirs as finished
+    ~AsyncLogWriter() {
+      disable();
+    }
+
+    bool enabled() const { return enabled_; }
+
+    void enable(double interval_seconds) {
+      if(!(interval_seconds > 0)) {
+        throw invalid_argument("set_async_logging(): flush_interval_seconds has to be positive");
+      }
+      boost::lock_guard<boost::mutex> lock(control_mutex_);
+      {
+        boost::lock_guard<boost::mutex> wake_lock(wake_mutex_);
+        interval_ = interval_seconds;
+        stop_ = false;
+      }
+      if(!enabled_) {
+        enabled_ = true;
+        thread_ = boost::thread(boost::bind(&AsyncLogWriter::run, this));
+      }
+    }
+
+    void disable() {
+      boost::lock_guard<boost::mutex> lock(control_mutex_);
+      if(!enabled_) {
+        return;
+      }
+      // messages logged from now on are written synchronously; those that
+      // were appended before are in the buffers when they are drained below
+      enabled_ = false;
+      {
+        boost::lock_guard<boost::mutex> wake_lock(wake_mutex_);
+        stop_ = true;
+      }
+      wake_.notify_one();
+      thread_.join();
+      write_pending();
+    }
+
+    bool push(const string& msg) {
+      // checked again under the lock of the buffer
+      if(!enabled_) {
+        return false;
+      }
+      ThreadBuffer* buffer = local_.get();
+      if(!buffer) {
+        buffer = new ThreadBuffer;
+        {
+          boost::lock_guard<boost::mutex> lock(registry_mutex_);
+          buffers_.push_back(buffer);
+        }
+        local_.reset(buffer);
+      }
+      boost::lock_guard<boost::mutex> lock(buffer->mutex);
+      if(!enabled_) {
+        return false;
+      }
+      buffer->text += msg;
+      return true;
+    }
+
+    void write_pending() {
+      // one drain at a time, from the swap to the write, so the messages of
+      // a thread keep their order across concurrent flushes
+      boost::lock_guard<boost::mutex> write_lock(write_mutex_);
+      vector<string> batch;
+      {
+        boost::lock_guard<boost::mutex> lock(registry_mutex_);
+        vector<ThreadBuffer*> alive;
+        alive.reserve(buffers_.size());
+        for(size_t i = 0; i < buffers_.size(); ++i) {
+          ThreadBuffer* buffer = buffers_[i];
+          bool finished;
+          {
+            boost::lock_guard<boost::mutex> buffer_lock(buffer->mutex);
+            if(!buffer->text.empty()) {
+              batch.push_back(string());
+              batch.back().swap(buffer->text);
+            }
+            finished = buffer->finished;
+          }
+          if(finished) {
+            delete buffer;
+          } else {
+            alive.push_back(buffer);
+          }
+        }
+        buffers_.swap(alive);
+      }
+      if(batch.empty()) {
+        return;
+      }
+      FILE* stream = Output2FILE::getRedirect();
+      if(!stream) {
+        return;
+      }
+      for(size_t i = 0; i < batch.size(); ++i) {
+        fwrite(batch[i].data(), 1, batch[i].size(), stream);
+      }
+      fflush(stream);
+    }
+
+  private:
+    void run() {
+      boost::unique_lock<boost::mutex> lock(wake_mutex_);
+      while(!stop_) {
+        wake_.timed_wait(lock, boost::posix_time::microseconds(static_cast<long>(interval_ * 1e6)));
+        lock.unlock();
+        write_pending();
+        lock.lock();
+      }
+    }
+
+    // read without a lock on the fast path of push(); written under
+    // control_mutex_ while the buffers are drained
+    boost::atomic<bool> enabled_;
+    bool stop_;
+    double interval_;
+
+    boost::mutex control_mutex_;
+    boost::mutex wake_mutex_;
+    boost::condition_variable wake_;
+    boost::thread thread_;
+
+    // held by write_pending(), before registry_mutex_
+    boost::mutex write_mutex_;
+    boost::mutex registry_mutex_;
+    vector<ThreadBuffer*> buffers_;
+    boost::thread_specific_ptr<ThreadBuffer> local_;
+  };
+
+  AsyncLogWriter& writer() {
+    static AsyncLogWriter w;
+    return w;
+  }
+}
+
+void set_async_logging(bool enable, double flush_interval_seconds) {
+  if(enable) {
+    writer().enable(flush_interval_seconds);
+  } else {
+    writer().disable();
+  }
+}
+
+bool async_logging() {
+  return writer().enabled();
+}
+
+void flush_log() {
+  writer().write_pending();
+}
+
+namespace detail {
+bool async_log_output(const std::string& msg) {
+  return writer().push(msg);
+}
+}
+
+} /* namespace pgmlink */
@@ -1,9 +1,15 @@
 // stl headers
+#include <string>
 #include <vector>
 #include <stdexcept>
 #include <cassert>
 #include <algorithm>
 #include <iterator>
+#include <istream>
+#include <ostream>
+#include <limits>
+#include <cmath>
+#include <map>
 
 // undef IN/OUT for windows, otherwise mlpack and lemon collide
 #include "pgmlink/windows.h"
@@ -14,11 +20,17 @@
 #include <mlpack/core.hpp>
 #include <mlpack/methods/kmeans/kmeans.hpp>
 #include <mlpack/methods/gmm/gmm.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
 
 
 
 // pgmlink headers
 #include "pgmlink/merger_resolving.h"
+#include "pgmlink/instrumentation.h"
 #include "pgmlink/hypotheses.h"
 #include "pgmlink/event.h"
 #include "pgmlink/traxels.h"
@@ -43,20 +55,47 @@ void ClusteringMlpackBase::copy_centers_to_feature_array(const arma::mat& center
   }
 }
 
+void ClusteringMlpackBase::feature_array_to_points(const feature_array& data, int n, arma::mat& points) {
+  if (n != 2 && n != 3) {
+    throw std::runtime_error("Number of spatial dimensions other than 2 or 3 would not make sense!");
+  }
+  if (data.size() % 3 != 0) {
+    throw std::range_error("Source vector dimension and matrix dimensions do not agree!");
+  }
+  const size_t n_samples = data.size()/3;
+  points.set_size(n, n_samples);
+  double* dest = points.memptr();
+  feature_array::const_iterator src = data.begin();
+  for (size_t i = 0; i < n_samples; ++i, src += 3, dest += n) {
+    std::copy(src, src + n, dest);
+  }
+}
+
+
 ////
 //// KMeans
 ////
+KMeans::KMeans(int k, const feature_array& data)
+: k_(k) {
+  feature_array_to_points(data, 3, data_);
+}
+
+
+KMeans::KMeans(int k, const arma::mat& data)
+: k_(k), data_(const_cast<double*>(data.memptr()), data.n_rows, data.n_cols, false, true) {
+}
+
+
 feature_array KMeans::operator()() {
   mlpack::kmeans::KMeans<> kMeans;
-  int n = data_.size()/3;
-  arma::mat data(3, n);
-  arma::mat centers(3, k_);
+  arma::mat centers(data_.n_rows, k_);
   arma::Col<size_t> labels;
-  feature_array_to_arma_mat(data_, data);
-  kMeans.Cluster(data, k_, labels);
-  get_centers(data, labels, centers, k_);
-  feature_array fa_centers(3*k_);
-  copy_centers_to_feature_array(centers, fa_centers);
+  kMeans.Cluster(data_, k_, labels);
+  get_centers(data_, labels, centers, k_);
+  feature_array fa_centers(3*k_, 0);
+  for (int i = 0; i < k_; ++i) {
+    std::copy(centers.colptr(i), centers.colptr(i) + std::min<size_t>(centers.n_rows, 3), fa_centers.begin() + 3*i);
+  }
   return fa_centers;
 }
 
@@ -64,20 +103,23 @@ feature_array KMeans::operator()() {
 ////
 //// GMM
 ////
+GMM::GMM(int k, int n, const feature_array& data, int n_trials)
+: k_(k), n_(n), score_(0.0), n_trials_(n_trials) {
+  feature_array_to_points(data, n, data_);
+}
+
+
+GMM::GMM(int k, const arma::mat& data, int n_trials)
+: k_(k), n_(data.n_rows),
+  data_(const_cast<double*>(data.memptr()), data.n_rows, data.n_cols, false, true),
+  score_(0.0), n_trials_(n_trials) {
+}
+
+
 feature_array GMM::operator()() {
   mlpack::gmm::GMM<> gmm(k_, n_);
-  int n_samples = data_.size()/3;
-  arma::mat data(n_,n_samples);
-  arma::Col<size_t> labels;
   LOG(logDEBUG1) << "GMM::operator(): n_=" << n_;
-  if (n_ == 2) {
-    feature_array_to_arma_mat_skip_last_dimension(data_, data, 3);
-  } else if(n_ == 3) {
-    feature_array_to_arma_mat(data_, data);
-  } else {
-    throw std::runtime_error("Number of spatial dimensions other than 2 or 3 would not make sense!");
-  }
-  score_ = gmm.Estimate(data, n_trials_);
+  score_ = gmm.Estimate(data_, n_trials_);
   std::vector<arma::vec> centers = gmm.Means();
   feature_array fa_centers;
   for (std::vector<arma::vec>::iterator it = centers.begin(); it != centers.end(); ++it) {
@@ -101,20 +143,30 @@ double GMM::score() const {
 ////
 //// GMMWithInitialized
 ////
+GMMWithInitialized::GMMWithInitialized(int k, int n, const feature_array& data, int n_trials,
+                                       const std::vector<arma::vec>& means,
+                                       const std::vector<arma::mat>& covs, const arma::vec& weights)
+: k_(k), n_(n), score_(0.0), n_trials_(n_trials), means_(means), covs_(covs), weights_(weights) {
+  feature_array_to_points(data, n, data_);
+}
+
+
+GMMWithInitialized::GMMWithInitialized(int k, const arma::mat& data, int n_trials,
+                                       const std::vector<arma::vec>& means,
+                                       const std::vector<arma::mat>& covs, const arma::vec& weights)
+: k_(k), n_(data.n_rows),
+  data_(const_cast<double*>(data.memptr()), data.n_rows, data.n_cols, false, true),
+  score_(0.0), n_trials_(n_trials), means_(means), covs_(covs), weights_(weights) {
+}
+
+
 feature_array GMMWithInitialized::operator()() {
   mlpack::gmm::GMM<> gmm(means_, covs_, weights_);
-  int n_samples = data_.size()/3;
-  arma::mat data(n_,n_samples);
-  arma::Col<size_t> labels;
   LOG(logDEBUG1) << "GMMWithInitialized::operator(): n_=" << n_;
-  if (n_ == 2) {
-    feature_array_to_arma_mat_skip_last_dimension(data_, data, 3);
-  } else if(n_ == 3) {
-    feature_array_to_arma_mat(data_, data);
-  } else {
-    throw std::runtime_error("Number of spatial dimensions other than 2 or 3 would not make sense!");
-  }
-  score_ = gmm.Estimate(data, n_trials_);
+  // EM from the given model instead of a random k-means initialization:
+  // draws no random numbers, so concurrent fits do not race on the
+  // global generator of mlpack
+  score_ = gmm.Estimate(data_, n_trials_, true);
   std::vector<arma::vec> centers = gmm.Means();
   feature_array fa_centers;
   for (std::vector<arma::vec>::iterator it = centers.begin(); it != centers.end(); ++it) {
@@ -179,6 +231,86 @@ double GMMInitializeArma::score() const {
 }
 
 
+////
+//// MergerCentersCache
+////
+boost::uint64_t MergerCentersCache::hash(const feature_array& data) {
+  return hash(data, UINT64_C(14695981039346656037));
+}
+
+
+boost::uint64_t MergerCentersCache::hash(const feature_array& data, boost::uint64_t seed) {
+  boost::uint64_t h = seed;
+  if (data.empty()) {
+    return h;
+  }
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&data[0]);
+  const size_t n_bytes = data.size() * sizeof(feature_type);
+  for (size_t i = 0; i < n_bytes; ++i) {
+    h ^= bytes[i];
+    h *= UINT64_C(1099511628211);
+  }
+  return h;
+}
+
+
+bool MergerCentersCache::Key::operator<(const Key& other) const {
+  if (timestep != other.timestep) return timestep < other.timestep;
+  if (id != other.id) return id < other.id;
+  if (k != other.k) return k < other.k;
+  return hash < other.hash;
+}
+
+
+bool MergerCentersCache::find(int timestep, unsigned id, int k, boost::uint64_t hash, feature_array& centers) const {
+  const Key key = {timestep, id, k, hash};
+  std::map<Key, feature_array>::const_iterator it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  centers = it->second;
+  return true;
+}
+
+
+void MergerCentersCache::insert(int timestep, unsigned id, int k, boost::uint64_t hash, const feature_array& centers) {
+  const Key key = {timestep, id, k, hash};
+  entries_[key] = centers;
+}
+
+
+size_t MergerCentersCache::size() const {
+  return entries_.size();
+}
+
+
+void MergerCentersCache::clear() {
+  entries_.clear();
+}
+
+
+void MergerCentersCache::write(std::ostream& os) const {
+  boost::archive::binary_oarchive oa(os);
+  const size_t n_entries = entries_.size();
+  oa << n_entries;
+  for (std::map<Key, feature_array>::const_iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    oa << it->first.timestep << it->first.id << it->first.k << it->first.hash << it->second;
+  }
+}
+
+
+void MergerCentersCache::read(std::istream& is) {
+  boost::archive::binary_iarchive ia(is);
+  size_t n_entries;
+  ia >> n_entries;
+  for (size_t i = 0; i < n_entries; ++i) {
+    Key key;
+    ia >> key.timestep >> key.id >> key.k >> key.hash;
+    ia >> entries_[key];
+  }
+}
+
+
 
 
 
@@ -206,11 +338,11 @@ std::vector<Traxel> FeatureExtractorMCOMsFromKMeans::operator()(Traxel& trax,
                                                                 size_t nMergers,
                                                                 unsigned int max_id
                                                                 ) {
-  std::map<std::string, feature_array>::const_iterator it = trax.features.find("coordinates");
+  TraxelFeatures::const_iterator it = trax.features.find("coordinates");
   assert(it != trax.features.end());
   std::vector<Traxel> res;
-  KMeans kmeans(nMergers, it->second);
-  trax.features["mergerCOMs"] = kmeans();
+  KMeans kmeans(nMergers, static_cast<feature_array>(it->second));
+  trax.set_feature("mergerCOMs", kmeans());
   FeatureExtractorMCOMsFromMCOMs extractor;
   return extractor(trax, nMergers, max_id);
 }
@@ -223,11 +355,21 @@ std::vector<Traxel> FeatureExtractorMCOMsFromGMM::operator() (Traxel& trax,
                                                               size_t nMergers,
                                                               unsigned int max_id
                                                               ){
-  std::map<std::string, feature_array>::iterator it = trax.features.find("coordinates");
-  assert(it != trax.features.end());
+  // the merger centers are written to the map
+  FeatureMap& features = trax.features.map();
+  FeatureMap::iterator it = features.find("coordinates");
+  assert(it != features.end());
   std::vector<Traxel> res;
-  GMM gmm(nMergers, n_dim_, it->second);
-  trax.features["mergerCOMs"] = gmm();
+  const feature_array parameters(1, static_cast<feature_type>(n_dim_));
+  const boost::uint64_t hash = MergerCentersCache::hash(it->second, MergerCentersCache::hash(parameters));
+  feature_array& merger_coms = features["mergerCOMs"];
+  if (!cache_ || !cache_->find(trax.Timestep, trax.Id, nMergers, hash, merger_coms)) {
+    GMM gmm(nMergers, n_dim_, it->second);
+    merger_coms = gmm();
+    if (cache_) {
+      cache_->insert(trax.Timestep, trax.Id, nMergers, hash, merger_coms);
+    }
+  }
   FeatureExtractorMCOMsFromMCOMs extractor;
   return extractor(trax, nMergers, max_id);
 }
@@ -242,7 +384,7 @@ std::vector<Traxel> FeatureExtractorMCOMsFromPCOMs::operator()(
     size_t nMerger,
     unsigned int start_id
                                                                ) {
-  std::map<std::string, feature_array>::iterator it = trax.features.find("possibleCOMs");
+  TraxelFeatures::const_iterator it = trax.features.find("possibleCOMs");
   assert(it != trax.features.end());
   LOG(logINFO) << "FeatureExtractorMCOMsFromPCOMs::operator()() possible coms size: " << it->second.size()
                << " and objects in merger: " << nMerger;
@@ -252,9 +394,9 @@ std::vector<Traxel> FeatureExtractorMCOMsFromPCOMs::operator()(
   feature_array range(it->second.begin()+index1, it->second.begin()+index2);
   for (unsigned int n = 0; n < nMerger; ++n, ++start_id) {
     trax.Id = start_id;
-    trax.features["com"] = feature_array(range.begin()+(3*n), range.begin()+(3*(n+1)));
+    trax.set_feature("com", feature_array(range.begin()+(3*n), range.begin()+(3*(n+1))));
     res.push_back(trax);
-    LOG(logINFO) << "FeatureExtractorMCOMsFromPCOMs::operator()(): Appended traxel with com (" << trax.features["com"][0] << "," << trax.features["com"][1] << "," << trax.features["com"][2] << ") and id " << trax.Id;
+    LOG(logINFO) << "FeatureExtractorMCOMsFromPCOMs::operator()(): Appended traxel with com (" << trax.features.at("com")[0] << "," << trax.features.at("com")[1] << "," << trax.features.at("com")[2] << ") and id " << trax.Id;
   }
   return res;
 }
@@ -269,16 +411,18 @@ std::vector<Traxel> FeatureExtractorMCOMsFromMCOMs::operator()(
     unsigned int start_id
                                                                ) {
   LOG(logDEBUG3) << "FeatureExtractorMCOMsFromMCOMs::operator() -- entered";
-  std::map<std::string, feature_array>::iterator it = trax.features.find("mergerCOMs");
+  TraxelFeatures::const_iterator it = trax.features.find("mergerCOMs");
   assert(it != trax.features.end());
   LOG(logDEBUG3) << "FeatureExtractorMCOMsFromMCOMs::operator()() possible coms size: " << it->second.size()
                << " and objects in merger: " << nMerger;
+  // set_feature() repacks the features
+  const feature_array merger_coms = it->second;
   std::vector<Traxel> res;
   for (unsigned int n = 0; n < nMerger; ++n, ++start_id) {
     trax.Id = start_id;
-    trax.features["com"] = feature_array(it->second.begin()+(3*n), it->second.begin()+(3*(n+1)));
+    trax.set_feature("com", feature_array(merger_coms.begin()+(3*n), merger_coms.begin()+(3*(n+1))));
     res.push_back(trax);
-    LOG(logDEBUG3) << "FeatureExtractorMCOMsFromMCOMs::operator()(): Appended traxel with com (" << trax.features["com"][0] << "," << trax.features["com"][1] << "," << trax.features["com"][2] << ") and id " << trax.Id;
+    LOG(logDEBUG3) << "FeatureExtractorMCOMsFromMCOMs::operator()(): Appended traxel with com (" << trax.features.at("com")[0] << "," << trax.features.at("com")[1] << "," << trax.features.at("com")[2] << ") and id " << trax.Id;
   }
   LOG(logDEBUG3) << std::endl;
   return res;
@@ -289,26 +433,34 @@ std::vector<Traxel> FeatureExtractorMCOMsFromMCOMs::operator()(
 //// FeatureExtractorArmadillo
 ////
 FeatureExtractorArmadillo::FeatureExtractorArmadillo(TimestepIdCoordinateMapPtr coordinates) :
-    coordinates_(coordinates) {
+    coordinates_(new MapCoordinateProvider(coordinates)) {
 
 }
 
 
+FeatureExtractorArmadillo::FeatureExtractorArmadillo(CoordinateProviderPtr coordinates) :
+    coordinates_(coordinates) {
+  if (!coordinates_) {
+    throw std::invalid_argument("FeatureExtractorArmadillo: no coordinate provider");
+  }
+}
+
+
 std::vector<Traxel> FeatureExtractorArmadillo::operator() (Traxel& trax,
                                                            size_t nMergers,
                                                            unsigned int max_id
                                                            ){
   LOG(logDEBUG3) << "FeatureExtractorArmadillo::operator() -- entered for " << trax;
-  TimestepIdCoordinateMap::const_iterator it = coordinates_->find(std::make_pair(trax.Timestep, trax.Id));
-  if (it == coordinates_->end()) {
+  const CoordinatesPtr coordinates = coordinates_->coordinates(trax.Timestep, trax.Id);
+  if (!coordinates) {
     throw std::runtime_error("Traxel not found in coordinates.");
   }
   LOG(logDEBUG4) << "FeatureExtractorArmadillo::operator() -- coordinate list for " << trax
-                 << " has " << it->second.n_cols << " dimensions and "
-                 << it->second.n_rows << " points.";
-  GMMInitializeArma gmm(nMergers, it->second);
+                 << " has " << coordinates->n_cols << " dimensions and "
+                 << coordinates->n_rows << " points.";
+  GMMInitializeArma gmm(nMergers, *coordinates);
   feature_array merger_coms = gmm();
-  trax.features["mergerCOMs"] = feature_array(merger_coms.begin(), merger_coms.end());
+  trax.set_feature("mergerCOMs", feature_array(merger_coms.begin(), merger_coms.end()));
   FeatureExtractorMCOMsFromMCOMs extractor;
   LOG(logDEBUG3) << "FeatureExtractorArmadillo::operator() -- exit";
   return extractor(trax, nMergers, max_id);
@@ -396,11 +548,10 @@ void FeatureHandlerFromTraxels::operator()(
     // set traxel features, most of which can be copied from the merger node
     // set new center of mass as calculated from GMM
     // add node to graph and activate it
-    HypothesesGraph::Node new_node = g.add_node(timestep);
+    HypothesesGraph::Node new_node = g.add_traxel_node(*it);
     // MAYBE LOG
-    traxel_map.set(new_node, *it);
+    assert(time_map[new_node] == timestep);
     active_map.set(new_node, 1);
-    time_map.set(new_node, timestep);
 
     // add arc candidates for new nodes (todo: need to somehow choose which ones are active)
     this->add_arcs_for_replacement_node(g, new_node, sources, targets, base_);
@@ -437,6 +588,238 @@ HypothesesGraph& ResolveAmbiguousArcsGreedy::operator()(HypothesesGraph* g) {
 }
 
 
+namespace {
+int find_root(std::vector<int>& parent, int i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+// Hungarian method for the n x n matrix cost (row major); returns the
+// column assigned to every row.
+std::vector<size_t> min_cost_assignment(const std::vector<double>& cost, size_t n) {
+  const double inf = std::numeric_limits<double>::infinity();
+  // 1-based, column 0 is the row that is currently inserted
+  std::vector<double> u(n + 1, 0.), v(n + 1, 0.), min_v(n + 1);
+  std::vector<size_t> row_of(n + 1, 0), way(n + 1, 0);
+  std::vector<char> used(n + 1);
+  for (size_t i = 1; i <= n; ++i) {
+    row_of[0] = i;
+    size_t j0 = 0;
+    std::fill(min_v.begin(), min_v.end(), inf);
+    std::fill(used.begin(), used.end(), false);
+    do {
+      used[j0] = true;
+      const size_t i0 = row_of[j0];
+      double delta = inf;
+      size_t j1 = 0;
+      for (size_t j = 1; j <= n; ++j) {
+        if (!used[j]) {
+          const double reduced = cost[(i0 - 1) * n + j - 1] - u[i0] - v[j];
+          if (reduced < min_v[j]) {
+            min_v[j] = reduced;
+            way[j] = j0;
+          }
+          if (min_v[j] < delta) {
+            delta = min_v[j];
+            j1 = j;
+          }
+        }
+      }
+      for (size_t j = 0; j <= n; ++j) {
+        if (used[j]) {
+          u[row_of[j]] += delta;
+          v[j] -= delta;
+        } else {
+          min_v[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (row_of[j0] != 0);
+    do {
+      const size_t j1 = way[j0];
+      row_of[j0] = row_of[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+  std::vector<size_t> col_of(n);
+  for (size_t j = 1; j <= n; ++j) {
+    col_of[row_of[j] - 1] = j - 1;
+  }
+  return col_of;
+}
+
+// Selects as many arcs as possible, with minimal total cost among those
+// selections, so that every target gets at most one arc and every source
+// at most its capacity.
+std::vector<bool> assign_arcs(const std::vector<double>& costs,
+                              const std::vector<size_t>& sources,
+                              const std::vector<size_t>& targets,
+                              const std::vector<size_t>& capacities,
+                              size_t number_of_targets) {
+  // one row per unit of capacity of the sources, followed by a dummy row per
+  // target; one column per target, followed by a dummy column per row
+  std::vector<size_t> first_row(capacities.size());
+  size_t number_of_rows = 0;
+  for (size_t i = 0; i < capacities.size(); ++i) {
+    first_row[i] = number_of_rows;
+    number_of_rows += capacities[i];
+  }
+  const size_t n = number_of_rows + number_of_targets;
+
+  // leaving a row or a target without arc costs more than any arcs save
+  double unassigned = 1.;
+  for (size_t k = 0; k < costs.size(); ++k) {
+    unassigned += std::fabs(costs[k]);
+  }
+  const double forbidden = unassigned * (n + 1);
+
+  std::vector<double> cost(n * n, forbidden);
+  for (size_t r = 0; r < number_of_rows; ++r) {
+    cost[r * n + number_of_targets + r] = unassigned;
+  }
+  for (size_t t = 0; t < number_of_targets; ++t) {
+    const size_t row = number_of_rows + t;
+    cost[row * n + t] = unassigned;
+    std::fill(cost.begin() + row * n + number_of_targets, cost.begin() + (row + 1) * n, 0.);
+  }
+  for (size_t k = 0; k < costs.size(); ++k) {
+    for (size_t r = first_row[sources[k]]; r < first_row[sources[k]] + capacities[sources[k]]; ++r) {
+      cost[r * n + targets[k]] = costs[k];
+    }
+  }
+
+  const std::vector<size_t> col_of = min_cost_assignment(cost, n);
+  std::vector<bool> active(costs.size(), false);
+  for (size_t k = 0; k < costs.size(); ++k) {
+    for (size_t r = first_row[sources[k]]; r < first_row[sources[k]] + capacities[sources[k]]; ++r) {
+      if (col_of[r] == targets[k]) {
+        active[k] = true;
+      }
+    }
+  }
+  return active;
+}
+}
+
+
+
+////
+//// ReasonerMaxOneArc
+////
+ReasonerMaxOneArc::ReasonerMaxOneArc(boost::function<double(const double)> transition,
+                                     double transition_parameter)
+  : transition_(transition),
+    transition_parameter_(transition_parameter) {
+}
+
+void ReasonerMaxOneArc::formulate(const HypothesesGraph& g) {
+  pieces_.clear();
+  if (!g.has_property(arc_resolution_candidate()) || !g.has_property(arc_distance())) {
+    throw std::runtime_error("ReasonerMaxOneArc::formulate(): graph without resolution candidates or arc distances");
+  }
+  property_map<arc_resolution_candidate, HypothesesGraph::base_graph>::type& candidate_map = g.get(arc_resolution_candidate());
+  property_map<arc_distance, HypothesesGraph::base_graph>::type& distance_map = g.get(arc_distance());
+  const bool with_divisions = g.has_property(division_active());
+
+  // every node is a source vertex (2 * id) and a target vertex (2 * id + 1)
+  // of the bipartite graphs
+  std::vector<int> parent(2 * (g.maxNodeId() + 1));
+  for (size_t i = 0; i < parent.size(); ++i) {
+    parent[i] = i;
+  }
+  std::vector<HypothesesGraph::Arc> arcs;
+  for (property_map<arc_resolution_candidate, HypothesesGraph::base_graph>::type::TrueIt a(candidate_map);
+       a != lemon::INVALID; ++a) {
+    arcs.push_back(a);
+    parent[find_root(parent, 2 * g.id(g.source(a)))] = find_root(parent, 2 * g.id(g.target(a)) + 1);
+  }
+
+  std::map<int, size_t> piece_of_root;
+  std::vector<std::map<int, size_t> > source_index, target_index;
+  for (std::vector<HypothesesGraph::Arc>::const_iterator a = arcs.begin(); a != arcs.end(); ++a) {
+    const HypothesesGraph::Node from = g.source(*a);
+    const HypothesesGraph::Node to = g.target(*a);
+    const int root = find_root(parent, 2 * g.id(from));
+    std::map<int, size_t>::const_iterator found = piece_of_root.find(root);
+    if (found == piece_of_root.end()) {
+      found = piece_of_root.insert(std::make_pair(root, pieces_.size())).first;
+      pieces_.push_back(Piece());
+      pieces_.back().number_of_targets = 0;
+      source_index.push_back(std::map<int, size_t>());
+      target_index.push_back(std::map<int, size_t>());
+    }
+    Piece& piece = pieces_[found->second];
+
+    std::map<int, size_t>& sources = source_index[found->second];
+    if (sources.insert(std::make_pair(g.id(from), piece.capacities.size())).second) {
+      piece.capacities.push_back(with_divisions && g.get(division_active())[from] ? 2 : 1);
+    }
+    std::map<int, size_t>& targets = target_index[found->second];
+    if (targets.insert(std::make_pair(g.id(to), piece.number_of_targets)).second) {
+      ++piece.number_of_targets;
+    }
+
+    const double prob = std::exp(-distance_map[*a] / transition_parameter_);
+    piece.arcs.push_back(*a);
+    piece.costs.push_back(transition_(prob) - transition_(1 - prob));
+    piece.sources.push_back(sources[g.id(from)]);
+    piece.targets.push_back(targets[g.id(to)]);
+  }
+  LOG(logDEBUG) << "ReasonerMaxOneArc::formulate(): " << arcs.size() << " candidate arcs in "
+                << pieces_.size() << " assignment problems";
+}
+
+void ReasonerMaxOneArc::infer() {
+  std::string error;
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < static_cast<int>(pieces_.size()); ++i) {
+    try {
+      Piece& piece = pieces_[i];
+      piece.active = assign_arcs(piece.costs, piece.sources, piece.targets,
+                                 piece.capacities, piece.number_of_targets);
+    } catch (std::exception& e) {
+      #pragma omp critical(pgmlink_max_one_arc)
+      {
+        if (error.empty()) {
+          error = e.what();
+        }
+      }
+    }
+  }
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+}
+
+void ReasonerMaxOneArc::conclude(HypothesesGraph& g) {
+  g.add(arc_active());
+  property_map<arc_active, HypothesesGraph::base_graph>::type& active_map = g.get(arc_active());
+  for (std::vector<Piece>::const_iterator piece = pieces_.begin(); piece != pieces_.end(); ++piece) {
+    if (piece->active.size() != piece->arcs.size()) {
+      throw std::runtime_error("ReasonerMaxOneArc::conclude(): infer() has not been called");
+    }
+    for (size_t k = 0; k < piece->arcs.size(); ++k) {
+      active_map.set(piece->arcs[k], piece->active[k]);
+    }
+  }
+}
+
+
+
+////
+//// ResolveAmbiguousArcsPgm
+////
+HypothesesGraph& ResolveAmbiguousArcsPgm::operator()(HypothesesGraph* g) {
+  formulate(*g);
+  infer();
+  conclude(*g);
+  return *g;
+}
+
+
 void MergerResolver::deactivate_arcs(std::vector<HypothesesGraph::base_graph::Arc> arcs) {
   // Deactivate Arcs provided by arcs.
   // Useful to deactivate arcs of merger node.
@@ -463,17 +846,29 @@ void MergerResolver::deactivate_nodes(std::vector<HypothesesGraph::Node> nodes)
   }
 }
 
-unsigned int MergerResolver::get_max_id(int ts) {
-  property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g_->get(node_traxel());
+void MergerResolver::index_ids() {
+  next_ids_.clear();
+  if (!g_->has_traxels()) {
+    return;
+  }
   property_map<node_timestep, HypothesesGraph::base_graph>::type& time_map = g_->get(node_timestep());
-  property_map<node_timestep, HypothesesGraph::base_graph>::type::ItemIt timeIt(time_map, ts);
-  unsigned int max_id = 0;
-  for (; timeIt != lemon::INVALID; ++timeIt) {
-    if (traxel_map[timeIt].Id > max_id) {
-      max_id = traxel_map[timeIt].Id;
+  const NodeTraxels traxel_map(*g_);
+  for (HypothesesGraph::NodeIt n(*g_); n != lemon::INVALID; ++n) {
+    const Traxel& trax = traxel_map[n];
+    if (trax.Timestep != time_map[n]) {
+      continue;
     }
+    unsigned int& next_id = next_ids_[trax.Timestep];
+    next_id = std::max(next_id, trax.Id + 1);
+  }
+}
+
+unsigned int MergerResolver::get_max_id(int ts) {
+  std::map<int, unsigned int>::const_iterator it = next_ids_.find(ts);
+  if (it == next_ids_.end() || it->second == 0) {
+    return 0;
   }
-  return max_id;
+  return it->second - 1;
 }
 
 void MergerResolver::refine_node(HypothesesGraph::Node node,
@@ -500,6 +895,10 @@ void MergerResolver::refine_node(HypothesesGraph::Node node,
   // create new node for each of the objects merged into node
   std::vector<unsigned int> new_ids;
   handler(*g_, node, nMerger, max_id, timestep, sources, targets, new_ids);
+  unsigned int& next_id = next_ids_[timestep];
+  for (std::vector<unsigned int>::const_iterator it = new_ids.begin(); it != new_ids.end(); ++it) {
+    next_id = std::max(next_id, *it + 1);
+  }
 
   // deactivate incoming and outgoing arcs of merger node
   // merger node will be deactivated after pruning
@@ -510,56 +909,124 @@ void MergerResolver::refine_node(HypothesesGraph::Node node,
 }
 
 
-void calculate_gmm_beforehand(HypothesesGraph& g, int n_trials, int n_dimensions) {
+namespace {
+// a merger of calculate_gmm_beforehand() with the centers of its sources
+struct MergerFit {
+  HypothesesGraph::Node node;
+  int count;
+  std::vector<arma::vec> initial_centers;
+  std::vector<arma::mat> initial_covs;
+  arma::vec initial_weights;
+  boost::uint64_t hash;
+  bool cached;
+  feature_array coms;
+};
+}
+
+void calculate_gmm_beforehand(HypothesesGraph& g, int n_trials, int n_dimensions, bool parallel,
+                              MergerCentersCachePtr cache) {
   property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g.get(node_traxel());
   HypothesesGraph::node_timestep_map& timestep_map = g.get(node_timestep());
   HypothesesGraph::node_timestep_map::ValueIt timestep_it = timestep_map.beginValue();
   property_map<node_active2, HypothesesGraph::base_graph>::type& active_map = g.get(node_active2());
   
+  // the mergers of a timestep are initialized with the mergerCOMs of the
+  // previous one: the timesteps are processed one after the other, the
+  // mergers of a timestep concurrently
   for (; timestep_it != timestep_map.endValue(); ++timestep_it) {
+    std::vector<MergerFit> fits;
     HypothesesGraph::node_timestep_map::ItemIt node_it(timestep_map, *timestep_it);
     for (; node_it != lemon::INVALID; ++node_it) {
       int count = active_map[node_it];
       if (count > 1) {
-        Traxel trax = traxel_map[node_it];
-        std::vector<arma::vec> initial_centers;
-        std::vector<arma::mat> initial_covs;
-        arma::vec initial_weights(count);
+        fits.push_back(MergerFit());
+        MergerFit& fit = fits.back();
+        fit.node = node_it;
+        fit.count = count;
+        fit.initial_weights.set_size(count);
         int curr_idx = 0;
         for (HypothesesGraph::InArcIt arc_it(g, node_it); arc_it != lemon::INVALID; ++arc_it) {
           int count_src = active_map[g.source(arc_it)];
           if (count_src == 1) {
-            const feature_array& com = traxel_map[g.source(arc_it)].features.find("com")->second;
-            initial_centers.push_back(arma::vec(n_dimensions));
-            std::copy(com.begin(), com.begin()+n_dimensions, initial_centers.rbegin()->begin());
-            initial_covs.push_back(arma::eye(n_dimensions, n_dimensions));
-            initial_weights[curr_idx] = 1.0/count;
+            const FeatureValues com = traxel_map[g.source(arc_it)].features.find("com")->second;
+            fit.initial_centers.push_back(arma::vec(n_dimensions));
+            std::copy(com.begin(), com.begin()+n_dimensions, fit.initial_centers.rbegin()->begin());
+            fit.initial_covs.push_back(arma::eye(n_dimensions, n_dimensions));
+            fit.initial_weights[curr_idx] = 1.0/count;
             ++curr_idx;
           } else {
-            const feature_array& pcoms = traxel_map[g.source(arc_it)].features.find("mergerCOMs")->second;
+            const FeatureValues pcoms = traxel_map[g.source(arc_it)].features.find("mergerCOMs")->second;
             for (int i = 0; i < count_src; ++i) {
-              initial_centers.push_back(arma::vec(n_dimensions));
-              std::copy(pcoms.begin()+3*i, pcoms.begin()+3*i+n_dimensions, initial_centers.rbegin()->begin());
-              initial_covs.push_back(arma::eye(n_dimensions, n_dimensions));
-              initial_weights[curr_idx] = 1.0/count;
+              fit.initial_centers.push_back(arma::vec(n_dimensions));
+              std::copy(pcoms.begin()+3*i, pcoms.begin()+3*i+n_dimensions, fit.initial_centers.rbegin()->begin());
+              fit.initial_covs.push_back(arma::eye(n_dimensions, n_dimensions));
+              fit.initial_weights[curr_idx] = 1.0/count;
               ++curr_idx;
             }
           }
         }
         assert(curr_idx == count && "COUNT MUST BE CORRECT!");
-        const feature_array& coordinates = trax.features["coordinates"];
-        GMMWithInitialized gmm(count, n_dimensions, coordinates, n_trials, initial_centers, initial_covs, initial_weights);
-        feature_array possible_coms = gmm();
-        trax.features["mergerCOMs"].resize(possible_coms.size());
-        std::copy(possible_coms.begin(), possible_coms.end(), trax.features["mergerCOMs"].begin());
-        traxel_map.set(node_it, trax);
+
+        fit.cached = false;
+        if (cache) {
+          const Traxel& trax = traxel_map[node_it];
+          TraxelFeatures::const_iterator coordinates = trax.features.find("coordinates");
+          feature_array parameters;
+          parameters.push_back(n_dimensions);
+          parameters.push_back(n_trials);
+          for (std::vector<arma::vec>::const_iterator it = fit.initial_centers.begin(); it != fit.initial_centers.end(); ++it) {
+            parameters.insert(parameters.end(), it->begin(), it->end());
+          }
+          fit.hash = MergerCentersCache::hash(parameters);
+          if (coordinates != trax.features.end()) {
+            fit.hash = MergerCentersCache::hash(coordinates->second, fit.hash);
+          }
+          fit.cached = cache->find(trax.Timestep, trax.Id, count, fit.hash, fit.coms);
+        }
       }
     }
+
+    // the traxels are only read while fitting
+    std::string error;
+    #pragma omp parallel for schedule(dynamic) if(parallel)
+    for (int i = 0; i < static_cast<int>(fits.size()); ++i) {
+      try {
+        MergerFit& fit = fits[i];
+        if (fit.cached) {
+          continue;
+        }
+        const TraxelFeatures& features = traxel_map[fit.node].features;
+        TraxelFeatures::const_iterator coordinates = features.find("coordinates");
+        if (coordinates == features.end()) {
+          throw std::runtime_error("calculate_gmm_beforehand(): merger without coordinates");
+        }
+        GMMWithInitialized gmm(fit.count, n_dimensions, static_cast<feature_array>(coordinates->second), n_trials,
+                               fit.initial_centers, fit.initial_covs, fit.initial_weights);
+        fit.coms = gmm();
+      } catch (std::exception& e) {
+        #pragma omp critical(pgmlink_gmm_beforehand)
+        {
+          if (error.empty()) error = e.what();
+        }
+      }
+    }
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+
+    for (std::vector<MergerFit>::iterator fit = fits.begin(); fit != fits.end(); ++fit) {
+      Traxel& trax = traxel_map.get_value(fit->node);
+      if (cache && !fit->cached) {
+        cache->insert(trax.Timestep, trax.Id, fit->count, fit->hash, fit->coms);
+      }
+      trax.features["mergerCOMs"].swap(fit->coms);
+    }
   }
   LOG(logINFO) << "calculate_gmm_beforehand: done";
 }
 
 HypothesesGraph* MergerResolver::resolve_mergers(FeatureHandlerBase& handler) {
+  PGMLINK_TIMED_SCOPE("MergerResolver::resolve_mergers");
   // extract property maps and iterators from graph
   LOG(logDEBUG) << "resolve_mergers() entered";
   property_map<node_active2, HypothesesGraph::base_graph>::type& active_map = g_->get(node_active2());
@@ -619,6 +1086,7 @@ HypothesesGraph* MergerResolver::resolve_mergers(FeatureHandlerBase& handler) {
   }
   // maybe keep merger nodes active for event extraction
   deactivate_nodes(nodes_to_deactivate);
+  PGMLINK_COUNT("MergerResolver: mergers resolved", nodes_to_deactivate.size());
 
   LOG(logDEBUG) << "resolve_mergers() done";
   return g_;
@@ -631,7 +1099,9 @@ void resolve_graph(HypothesesGraph& src,
                    double ep_gap,
                    bool with_tracklets, 
                    const double transition_parameter,
-                   const bool with_constraints) {
+                   const bool with_constraints,
+                   const bool with_components) {
+  PGMLINK_TIMED_SCOPE("resolve_graph");
 
   // Optimize the graph built by the class MergerResolver.
   // Up to here everything is only graph (nodes, arcs) based
@@ -669,10 +1139,10 @@ void resolve_graph(HypothesesGraph& src,
 
   // Storing references in nr and ar, cross references in
   // ncr and acr.
-  std::map<HypothesesGraph::Node, HypothesesGraph::Node> nr;
-  std::map<HypothesesGraph::Arc, HypothesesGraph::Arc> ar;
-  std::map<HypothesesGraph::Node, HypothesesGraph::Node> ncr;
-  std::map<HypothesesGraph::Arc, HypothesesGraph::Arc> acr;
+  NodeCrossReference nr;
+  ArcCrossReference ar;
+  NodeCrossReference ncr;
+  ArcCrossReference acr;
   copy_hypotheses_graph_subset<node_resolution_candidate, arc_resolution_candidate>(src, dest, nr, ar, ncr, acr);
 
   // if resulting graph is empty, nothing to be done here; return
@@ -726,7 +1196,9 @@ void resolve_graph(HypothesesGraph& src,
       false, // with appearance
       false, // with disappearance
       transition_parameter,
-      with_constraints
+      with_constraints,
+      1e75, // cplex_timeout
+      with_components
                            );
 
   pgm.formulate(dest);
@@ -746,38 +1218,120 @@ double calculate_BIC(int k, int n_samples, double regularization_weight, const C
 }
 
 
-void gmm_priors_and_centers(const feature_array& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight) {
+namespace {
+// fits a GMM with k components, returns its BIC and 3 coordinates per center
+typedef boost::function<double (int k, feature_array& means)> BICFit;
+
+double fit_gmm_points(const arma::mat& points, int n_samples, double regularization_weight,
+                      int k, feature_array& means) {
+  GMM gmm(k, points);
+  means = gmm();
+  return calculate_BIC(k, n_samples, regularization_weight, gmm);
+}
+
+double fit_gmm_arma(const arma::mat& data, int n_samples, double regularization_weight,
+                    int k, feature_array& means) {
+  GMMInitializeArma gmm(k, data);
+  means = gmm();
+  return calculate_BIC(k, n_samples, regularization_weight, gmm);
+}
+
+// Fits k = 1, 2, ... concurrently, in increasing order. The fits are
+// evaluated in order of k as soon as all smaller k are done; after
+// patience consecutive decreases of the BIC no larger k is fitted.
+// Since the stop only depends on the BICs, the result does not depend on
+// the number of threads.
+void select_by_BIC(const BICFit& fit, feature_array& priors, feature_array& centers,
+                   int k_max, int ndim, int patience) {
   assert(priors.size() == 0);
   assert(centers.size() == 0);
-  priors.resize(k_max);
-  centers.resize((k_max*(k_max+1))/2*ndim);
-
-  int n_samples = data.size()/ndim;
-#   pragma omp parallel for
+  priors.assign(k_max, -std::numeric_limits<feature_type>::infinity());
+  centers.assign((k_max*(k_max+1))/2*ndim, 0);
+
+  std::vector<double> bics(k_max, 0.);
+  std::vector<feature_array> means(k_max);
+  std::vector<bool> fitted(k_max, false);
+  // no k >= k_stop is fitted; the first n_evaluated fits have been evaluated
+  int k_stop = k_max + 1;
+  int n_evaluated = 0;
+  int n_decreases = 0;
+  std::string error;
+  #pragma omp parallel for schedule(dynamic, 1)
   for (int k = 1; k <= k_max; ++k) {
-    GMM gmm(k, ndim, data);
-    feature_array means = gmm();
-    double curr_bic = calculate_BIC(k, n_samples, regularization_weight, gmm);
-    priors.at(k-1) = curr_bic;
-    std::copy(means.begin(), means.end(), centers.begin() + ((k-1)*k)/2*ndim);
+    bool skip;
+    #pragma omp critical(pgmlink_bic_selection)
+    {
+      skip = k >= k_stop || !error.empty();
+    }
+    if (skip) {
+      continue;
+    }
+    try {
+      feature_array k_means;
+      const double bic = fit(k, k_means);
+      if (k_means.size() < static_cast<size_t>(3*k)) {
+        throw std::runtime_error("select_by_BIC(): fit returned too few centers");
+      }
+      #pragma omp critical(pgmlink_bic_selection)
+      {
+        bics[k-1] = bic;
+        means[k-1].swap(k_means);
+        fitted[k-1] = true;
+        while (n_evaluated < k_stop - 1 && fitted[n_evaluated]) {
+          if (n_evaluated > 0 && bics[n_evaluated] < bics[n_evaluated-1]) {
+            ++n_decreases;
+          } else {
+            n_decreases = 0;
+          }
+          ++n_evaluated;
+          if (patience > 0 && n_decreases >= patience) {
+            k_stop = n_evaluated + 1;
+          }
+        }
+      }
+    } catch (std::exception& e) {
+      #pragma omp critical(pgmlink_bic_selection)
+      {
+        if (error.empty()) error = e.what();
+      }
+    }
+  }
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+
+  for (int k = 1; k < k_stop; ++k) {
+    priors[k-1] = bics[k-1];
+    feature_array::iterator dest = centers.begin() + ((k-1)*k)/2*ndim;
+    for (int c = 0; c < k; ++c, dest += ndim) {
+      std::copy(means[k-1].begin() + 3*c, means[k-1].begin() + 3*c + ndim, dest);
+    }
   }
 }
+}
 
-  
-void gmm_priors_and_centers_arma(const arma::mat& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight) {
-  assert(priors.size() == 0);
-  assert(centers.size() == 0);
-  priors.resize(k_max);
-  centers.resize((k_max*(k_max+1))/2*ndim);
 
+void gmm_priors_and_centers(const feature_array& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight, int patience) {
+  if (ndim != 2 && ndim != 3) {
+    throw std::runtime_error("Number of spatial dimensions other than 2 or 3 would not make sense!");
+  }
   int n_samples = data.size()/ndim;
-#   pragma omp parallel for
-  for (int k = 1; k <= k_max; ++k) {
-    GMMInitializeArma gmm(k, data);
-    centers = gmm();
-    double curr_bic = calculate_BIC(k, n_samples, regularization_weight, gmm);
-    priors.at(k-1) = curr_bic;
+  // convert once for all k
+  arma::mat points(ndim, data.size()/3);
+  if (ndim == 2) {
+    feature_array_to_arma_mat_skip_last_dimension(data, points, 3);
+  } else {
+    feature_array_to_arma_mat(data, points);
   }
+  select_by_BIC(boost::bind(fit_gmm_points, boost::cref(points), n_samples, regularization_weight, _1, _2),
+                priors, centers, k_max, ndim, patience);
+}
+
+  
+void gmm_priors_and_centers_arma(const arma::mat& data, feature_array& priors, feature_array& centers, int k_max, int ndim, double regularization_weight, int patience) {
+  int n_samples = data.size()/ndim;
+  select_by_BIC(boost::bind(fit_gmm_arma, boost::cref(data), n_samples, regularization_weight, _1, _2),
+                priors, centers, k_max, ndim, patience);
 }
 
 
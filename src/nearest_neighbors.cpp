@@ -1,6 +1,10 @@
+#include <algorithm>
 #include <map>
 #include <cassert>
 #include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 #include <ANN/ANN.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_array.hpp>
@@ -13,9 +17,14 @@ using namespace boost;
 
 
 NearestNeighborSearch::~NearestNeighborSearch() {
-	if(points_ != NULL) {
-	    annDeallocPts(points_);
-	    points_ = NULL;
+	// the tree destructor reads the shared trivial leaf of ANN
+	#pragma omp critical(pgmlink_ann)
+	{
+	    kd_tree_.reset();
+	    if(points_ != NULL) {
+	        annDeallocPts(points_);
+	        points_ = NULL;
+	    }
 	}
 }
 
@@ -23,7 +32,7 @@ NearestNeighborSearch::~NearestNeighborSearch() {
 
 map<unsigned int, double> NearestNeighborSearch::knn_in_range( const Traxel& query, double radius, unsigned int knn , const bool reverse) {
     if( radius < 0 ) {
-	throw "knn_in_range: radius has to be non-negative.";
+	throw invalid_argument("knn_in_range: radius has to be non-negative.");
     }
 
     map<unsigned int, double> return_value;
@@ -37,7 +46,7 @@ map<unsigned int, double> NearestNeighborSearch::knn_in_range( const Traxel& que
     ANNpoint query_point( NULL );
     query_point = this->point_from_traxel(query, reverse);
     if( query_point == NULL ) {
-	throw "query point allocation failure";
+	throw runtime_error("knn_in_range: query point allocation failure");
     }
 
     // search
@@ -45,15 +54,17 @@ map<unsigned int, double> NearestNeighborSearch::knn_in_range( const Traxel& que
 	scoped_array<ANNidx> nn_indices( new ANNidx[knn] );
 	scoped_array<ANNdist> nn_distances( new ANNdist[knn] );
 
-	const int points_in_range = kd_tree_->annkFRSearch( query_point, radius*radius, knn,
+	int points_in_range;
+	#pragma omp critical(pgmlink_ann)
+	points_in_range = kd_tree_->annkFRSearch( query_point, radius*radius, knn,
                                          nn_indices.get(), nn_distances.get());
 
 	if( points_in_range < 0 ) {
-	    throw "knn_in_range: ANN search return negative number of nearest neighbors";
+	    throw runtime_error("knn_in_range: ANN search return negative number of nearest neighbors");
 	}
 
 	// construct return value
-	
+
 	// there may be less points in range, than nearest neighbors demanded
 	const int actual = (static_cast<int>(knn) < points_in_range) ? knn : points_in_range;
 	for( ANNidx i = 0; i < actual; ++i) {
@@ -76,9 +87,77 @@ map<unsigned int, double> NearestNeighborSearch::knn_in_range( const Traxel& que
 
 
 
+void NearestNeighborSearch::knn_in_range( const vector<const Traxel*>& queries,
+                                          const vector<unsigned int>& knn,
+                                          double radius,
+                                          vector<size_t>& offsets,
+                                          vector<unsigned int>& ids,
+                                          vector<double>& distances,
+                                          const bool reverse ) {
+    if( radius < 0 ) {
+	throw invalid_argument("knn_in_range: radius has to be non-negative.");
+    }
+    if( knn.size() != queries.size() ) {
+	throw invalid_argument("knn_in_range: one knn per query required.");
+    }
+
+    offsets.assign(1, 0);
+    ids.clear();
+    distances.clear();
+
+    // empty search space?
+    if(points_ == NULL && kd_tree_.get() == NULL) {
+      offsets.resize(queries.size() + 1, 0);
+      return;
+    }
+
+    // all query points and result slots, so that the searches of the
+    // batch take the ANN lock once
+    vector<ANNcoord> query_coords(queries.size() * dim_);
+    vector<size_t> first_result(queries.size() + 1, 0);
+    for( size_t q = 0; q < queries.size(); ++q ) {
+	set_query_point(&query_coords[q * dim_], *queries[q], reverse);
+	first_result[q + 1] = first_result[q] + knn[q];
+    }
+    vector<ANNidx> nn_indices(first_result.back());
+    vector<ANNdist> nn_distances(first_result.back());
+    vector<int> points_in_range(queries.size());
+
+    #pragma omp critical(pgmlink_ann)
+    for( size_t q = 0; q < queries.size(); ++q ) {
+	points_in_range[q] = kd_tree_->annkFRSearch( &query_coords[q * dim_], radius*radius, knn[q],
+	                                             knn[q] ? &nn_indices[first_result[q]] : NULL,
+	                                             knn[q] ? &nn_distances[first_result[q]] : NULL);
+    }
+
+    vector<pair<unsigned int, double> > found;
+    offsets.reserve(queries.size() + 1);
+    for( size_t q = 0; q < queries.size(); ++q ) {
+	if( points_in_range[q] < 0 ) {
+	    throw runtime_error("knn_in_range: ANN search return negative number of nearest neighbors");
+	}
+
+	// there may be less points in range, than nearest neighbors demanded
+	const int actual = (static_cast<int>(knn[q]) < points_in_range[q]) ? knn[q] : points_in_range[q];
+	found.clear();
+	for( int i = 0; i < actual; ++i ) {
+	    found.push_back(make_pair(point_idx2traxel_id_[nn_indices[first_result[q] + i]],
+	                              nn_distances[first_result[q] + i]));
+	}
+	sort(found.begin(), found.end());
+	for( size_t i = 0; i < found.size(); ++i ) {
+	    ids.push_back(found[i].first);
+	    distances.push_back(found[i].second);
+	}
+	offsets.push_back(ids.size());
+    }
+}
+
+
+
 unsigned int NearestNeighborSearch::count_in_range( const Traxel& query, double radius , const bool reverse) {
     if( radius < 0 ) {
-	throw "count_in_range: radius has to be non-negative.";
+	throw invalid_argument("count_in_range: radius has to be non-negative.");
     }
 
     // empty search space?
@@ -90,17 +169,18 @@ unsigned int NearestNeighborSearch::count_in_range( const Traxel& query, double
     ANNpoint query_point( NULL );
     query_point = this->point_from_traxel(query, reverse);
     if( query_point == NULL ) {
-	throw "query point allocation failure";
+	throw runtime_error("count_in_range: query point allocation failure");
     }
 
     // search
     int points_in_range;
     try {
 	// search with 0 nearest neighbors -> returns just a range count
+	#pragma omp critical(pgmlink_ann)
 	points_in_range = kd_tree_->annkFRSearch( query_point, radius*radius, 0 );
 
 	if( points_in_range < 0 ) {
-	    throw "knn_in_range: ANN search return negative number of nearest neighbors";
+	    throw runtime_error("count_in_range: ANN search return negative number of nearest neighbors");
 	}
     } catch(...) {
 	if( query_point != NULL) {
@@ -121,22 +201,21 @@ unsigned int NearestNeighborSearch::count_in_range( const Traxel& query, double
 
 
 ANNpoint NearestNeighborSearch::point_from_traxel( const Traxel& traxel , const bool reverse) {
-    assert(dim_ == 3);
     ANNpoint point = annAllocPt( dim_ );
+    set_query_point(point, traxel, reverse);
+    return point;
+}
 
-    if (reverse) {
-        point[0] = traxel.X();
-            point[1] = traxel.Y();
-            point[2] = traxel.Z();
-            LOG(logDEBUG4) << "NearestNeighborSearch::point_from_traxel (reverse): " << traxel <<
-                    " point = " << point[0] << "," << point[1] << "," << point[2];
+void NearestNeighborSearch::set_query_point( ANNpoint point, const Traxel& traxel, const bool reverse ) const {
+    // queries are placed at the corrected com unless reverse is set
+    if (dim_ == 2) {
+        set_point<2>(point, traxel, !reverse);
     } else {
-    	point[0] = traxel.X_corr();
-		point[1] = traxel.Y_corr();
-		point[2] = traxel.Z_corr();
-		LOG(logDEBUG4) << "NearestNeighborSearch::point_from_traxel: " << traxel <<
-		                " point = " << point[0] << "," << point[1] << "," << point[2];
-    }return point;
+        set_point<3>(point, traxel, !reverse);
+    }
+    LOG(logDEBUG4) << "NearestNeighborSearch::point_from_traxel" << (reverse ? " (reverse)" : "") << ": "
+                   << traxel << " point = " << point[0] << "," << point[1]
+                   << "," << (dim_ == 3 ? point[2] : 0.);
 }
 
 
@@ -5,6 +5,7 @@
 #include <cmath>
 #include <set>
 #include <stdexcept>
+#include <string>
 #include <utility>
 #include <boost/scoped_ptr.hpp>
 #include <string.h>
@@ -24,6 +25,30 @@ using namespace std;
 namespace pgmlink {
   namespace pgm {
     namespace chaingraph {
+    namespace {
+      // energies of all pairs (k, l), k < l, of children; the division
+      // geometries score the pairs of a node at once
+      template <class Division>
+      void division_energies( const Division& division, const Traxel& parent,
+			      const vector<const Traxel*>& children, vector<double>& energies ) {
+	for(size_t k = 0; k + 1 < children.size(); ++k) {
+	  for(size_t l = k + 1; l < children.size(); ++l) {
+	    energies.push_back(division(parent, *children[k], *children[l]));
+	  }
+	}
+      }
+
+      void division_energies( const GeometryDivision2& division, const Traxel& parent,
+			      const vector<const Traxel*>& children, vector<double>& energies ) {
+	division.score_pairs(parent, children, energies);
+      }
+
+      void division_energies( const KasterDivision2& division, const Traxel& parent,
+			      const vector<const Traxel*>& children, vector<double>& energies ) {
+	division.score_pairs(parent, children, energies);
+      }
+    }
+
     ////
     //// class chaingraph::Model
     ////
@@ -36,26 +61,21 @@ namespace pgmlink {
 				     const arc_var_map& arc_var
 				     )
       : opengm_model(m) {
-      node_var_.left = node_var;
-      arc_var_.left = arc_var;
+      for(node_var_map::const_iterator it = node_var.begin(); it != node_var.end(); ++it) {
+	add_node_var(it->first, it->second);
+      }
+      for(arc_var_map::const_iterator it = arc_var.begin(); it != arc_var.end(); ++it) {
+	add_arc_var(it->first, it->second);
+      }
       init();
       }
 
     const Model::node_var_map& Model::var_of_node() const {
-      return node_var_.left;
-    }
-
-    const Model::var_node_map& Model::node_of_var() const {
-      return node_var_.right;
+      return node_var_;
     }
 
     const Model::arc_var_map& Model::var_of_arc() const {
-      return arc_var_.left;
-    }
-
-    const Model::var_arc_map& Model::arc_of_var() const
-    {
-      return arc_var_.right;      
+      return arc_var_;
     }
 
     Model::var_t Model::var_of_node(node_t e) const {
@@ -77,33 +97,76 @@ namespace pgmlink {
     }
 
     Model::node_t Model::node_of_var(var_t e) const {
-      var_node_map::const_iterator it = node_of_var().find(e);
-      if(it!=node_of_var().end()) {
-	return it->second;
+      if(e < var_item_.size() && var_item_[e] >= 0 && var_category_[e] == node_var) {
+	return HypothesesGraph::base_graph::nodeFromId(var_item_[e]);
       } else {
 	throw std::out_of_range("ChaingraphModel::node_of_var(): key does not exist");
       }
     }
 
     Model::arc_t Model::arc_of_var(var_t e) const {
-      var_arc_map::const_iterator it = arc_of_var().find(e);
-      if(it!=arc_of_var().end()) {
-	return it->second;
+      if(e < var_item_.size() && var_item_[e] >= 0 && var_category_[e] == arc_var) {
+	return HypothesesGraph::base_graph::arcFromId(var_item_[e]);
       } else {
 	throw std::out_of_range("ChaingraphModel::arc_of_var(): key does not exist");
       }
     }
 
     Model::VarCategory Model::var_category(var_t e) const {
-      if(arc_of_var().count(e)) {
-	return Model::arc_var;
-      } else if(node_of_var().count(e)) {
-	return Model::node_var;
+      if(e < var_item_.size() && var_item_[e] >= 0) {
+	return var_category_[e];
       } else {
 	throw std::out_of_range("ChaingraphModel::var_category(): key does not exist");
       }
     }
 
+    void Model::add_node_var(node_t n, var_t var) {
+      node_var_.insert(node_var_map::value_type(n, var));
+      if(var >= var_item_.size()) {
+	var_item_.resize(var + 1, -1);
+	var_category_.resize(var + 1, node_var);
+      }
+      var_item_[var] = HypothesesGraph::base_graph::id(n);
+      var_category_[var] = node_var;
+    }
+
+    void Model::add_arc_var(arc_t a, var_t var) {
+      arc_var_.insert(arc_var_map::value_type(a, var));
+      if(var >= var_item_.size()) {
+	var_item_.resize(var + 1, -1);
+	var_category_.resize(var + 1, node_var);
+      }
+      var_item_[var] = HypothesesGraph::base_graph::id(a);
+      var_category_[var] = arc_var;
+    }
+
+
+    void Model::set_weights( WeightType type, const vector<OpengmModel::ValueType>& weights ) {
+      const map<WeightType, vector<OpengmModel::IndexType> >::const_iterator ids = weight_map.find(type);
+      if(ids == weight_map.end() || ids->second.size() != weights.size()) {
+	throw std::invalid_argument("chaingraph::Model::set_weights(): number of weights differs from the weight map");
+      }
+      vector<OpengmModel::ValueType> all;
+      opengm_model->getWeights(all);
+      for(size_t i = 0; i < weights.size(); ++i) {
+	all[ids->second[i]] = weights[i];
+      }
+      opengm_model->setWeights(all);
+    }
+
+    vector<OpengmModel::ValueType> Model::get_weights( WeightType type ) const {
+      vector<OpengmModel::ValueType> weights;
+      const map<WeightType, vector<OpengmModel::IndexType> >::const_iterator ids = weight_map.find(type);
+      if(ids == weight_map.end()) {
+	return weights;
+      }
+      vector<OpengmModel::ValueType> all;
+      opengm_model->getWeights(all);
+      for(size_t i = 0; i < ids->second.size(); ++i) {
+	weights.push_back(all[ids->second[i]]);
+      }
+      return weights;
+    }
 
     void Model::init() {
       weight_map[det_weight] = vector<OpengmModel::IndexType>();
@@ -181,8 +244,9 @@ namespace pgmlink {
 	  return 2*opengm_id + 1;
 	}
       }
-      void ModelBuilder::add_hard_constraints( const Model& m, const HypothesesGraph& hypotheses, OpengmLPCplex& cplex ) {
+      size_t ModelBuilder::add_hard_constraints( const Model& m, const HypothesesGraph& hypotheses, OpengmLPCplex& cplex ) {
 	LOG(logDEBUG) << "Chaingraph::add_constraints: entered";
+	size_t count = 0;
 	////
 	//// outgoing transitions
 	////
@@ -192,6 +256,7 @@ namespace pgmlink {
 	  if(has_detection_vars()) {
 	    for(HypothesesGraph::OutArcIt a(hypotheses, n); a!=lemon::INVALID; ++a) {
 	      couple(m, n, a, cplex);
+	      ++count;
 	    }
 	  }
 	
@@ -205,6 +270,7 @@ namespace pgmlink {
 	    // 0 <= 1*transition + ... + 1*transition <= 2 [div] or 1 [no div]
 	    const size_t max_on = has_divisions() ? 2 : 1;
 	    cplex.addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0, max_on);
+	    ++count;
 	  }
 	}
       
@@ -217,6 +283,7 @@ namespace pgmlink {
 	  if(has_detection_vars()) {
 	    for(HypothesesGraph::InArcIt a(hypotheses, n); a!=lemon::INVALID; ++a) {
 	      couple(m, n, a, cplex);
+	      ++count;
 	    }
 	  }
 	    
@@ -229,11 +296,13 @@ namespace pgmlink {
 	    vector<int> coeffs(cplex_idxs.size(), 1);
 	    // 0 <= 1*transition + ... + 1*transition <= 1
 	    cplex.addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0, 1);
+	    ++count;
 	  }
 	}
+	return count;
       }
 
-      void ModelBuilder::fix_detections( const Model& m, const HypothesesGraph& g, OpengmLPCplex& cplex ) {
+      size_t ModelBuilder::fix_detections( const Model& m, const HypothesesGraph& g, OpengmLPCplex& cplex ) {
 	if(!has_detection_vars()) {
 	  throw std::runtime_error("chaingraph::ModelBuilder::fix_detections(): called without has_detection_vars()");
 	}
@@ -245,6 +314,75 @@ namespace pgmlink {
 	  // 1 <= 1*detection <= 1
 	  cplex.addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin() , 1, 1);
 	}
+	return lemon::countNodes(g);
+      }
+
+      void ModelBuilder::compute_energies( const HypothesesGraph& hypotheses, vector<NodeEnergies>& energies ) const {
+	// static dispatch for the functors of ChaingraphTracking; any other
+	// function, e.g. one from Python, is called through boost::function
+	const SquaredDistance* move = move_.target<SquaredDistance>();
+	const GeometryDivision2* division = division_.target<GeometryDivision2>();
+	const KasterDivision2* kaster_division = division_.target<KasterDivision2>();
+	if(move && division) {
+	  compute_energies(hypotheses, energies, *move, *division);
+	} else if(move && kaster_division) {
+	  compute_energies(hypotheses, energies, *move, *kaster_division);
+	} else if(move) {
+	  compute_energies(hypotheses, energies, *move, division_);
+	} else {
+	  compute_energies(hypotheses, energies, move_, division_);
+	}
+      }
+
+      template <class Move, class Division>
+      void ModelBuilder::compute_energies( const HypothesesGraph& hypotheses,
+					   vector<NodeEnergies>& energies,
+					   const Move& move,
+					   const Division& division ) const {
+	vector<HypothesesGraph::Node> nodes;
+	for(HypothesesGraph::NodeIt n(hypotheses); n!=lemon::INVALID; ++n) {
+	  nodes.push_back(n);
+	}
+	energies.assign(hypotheses.maxNodeId() + 1, NodeEnergies());
+	if(nodes.empty()) {
+	  return;
+	}
+	const NodeTraxels traxel_map(hypotheses);
+
+	// the factors are added serially afterwards; the energy functions
+	// may be expensive (GeometryDivision2 runs over all arc pairs)
+	std::string error;
+	#pragma omp parallel for schedule(dynamic, 64)
+	for(int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+	  try {
+	    const HypothesesGraph::Node& n = nodes[i];
+	    const Traxel& traxel = traxel_map[n];
+	    NodeEnergies& node_energies = energies[hypotheses.id(n)];
+	    if(has_detection_vars()) {
+	      node_energies.detection = detection_(traxel);
+	      node_energies.non_detection = non_detection_(traxel);
+	    }
+	    node_energies.appearance = appearance_(traxel);
+	    node_energies.disappearance = disappearance_(traxel);
+
+	    vector<const Traxel*> targets;
+	    for(HypothesesGraph::OutArcIt a(hypotheses, n); a != lemon::INVALID; ++a) {
+	      targets.push_back(&traxel_map[hypotheses.target(a)]);
+	      node_energies.moves.push_back(move(traxel, *targets.back()));
+	    }
+	    if(has_divisions()) {
+	      division_energies(division, traxel, targets, node_energies.divisions);
+	    }
+	  } catch(std::exception& e) {
+	    #pragma omp critical(pgmlink_chaingraph_energies)
+	    {
+	      if(error.empty()) error = e.what();
+	    }
+	  }
+	}
+	if(!error.empty()) {
+	  throw std::runtime_error(error);
+	}
       }
 
       inline void ModelBuilder::add_detection_vars( const HypothesesGraph& hypotheses, Model& m ) const {
@@ -254,14 +392,14 @@ namespace pgmlink {
 
 	for(HypothesesGraph::NodeIt n(hypotheses); n!=lemon::INVALID; ++n) {
 	  m.opengm_model->addVariable(2);
-	  m.node_var_.left.insert(Model::node_var_map::value_type(n, m.opengm_model->numberOfVariables() - 1));
+	  m.add_node_var(n, m.opengm_model->numberOfVariables() - 1);
 	}
       }
 
       inline void ModelBuilder::add_assignment_vars( const HypothesesGraph& hypotheses, Model& m ) const {
 	for(HypothesesGraph::ArcIt a(hypotheses); a!=lemon::INVALID; ++a) {
 	  m.opengm_model->addVariable(2);
-	  m.arc_var_.left.insert(Model::arc_var_map::value_type(a, m.opengm_model->numberOfVariables() - 1));
+	  m.add_arc_var(a, m.opengm_model->numberOfVariables() - 1);
 	}
       }
 
@@ -339,32 +477,34 @@ namespace pgmlink {
       }
       add_assignment_vars( hypotheses, *model );
 
+      vector<NodeEnergies> energies;
+      compute_energies( hypotheses, energies );
+
       if( has_detection_vars() ) {
       	for(HypothesesGraph::NodeIt n(hypotheses); n!=lemon::INVALID; ++n) {
-      	  add_detection_factor( hypotheses, *model, n );
+      	  add_detection_factor( hypotheses, *model, n, energies[hypotheses.id(n)] );
       	}
       }
 
       for(HypothesesGraph::NodeIt n(hypotheses); n!=lemon::INVALID; ++n) {
-      	add_outgoing_factor( hypotheses, *model, n );
-      	add_incoming_factor( hypotheses, *model, n );
+      	add_outgoing_factor( hypotheses, *model, n, energies[hypotheses.id(n)] );
+      	add_incoming_factor( hypotheses, *model, n, energies[hypotheses.id(n)] );
       }
 
       return model;
     }
 
-    void TrainableModelBuilder::add_detection_factor( const HypothesesGraph& hypotheses, Model& m, const HypothesesGraph::Node& n ) const {
-      property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = hypotheses.get(node_traxel());
+    void TrainableModelBuilder::add_detection_factor( const HypothesesGraph& /*hypotheses*/, Model& m, const HypothesesGraph::Node& n, const NodeEnergies& energies ) const {
       std::vector<size_t> var_indices;
       var_indices.push_back(m.var_of_node(n));
       size_t shape[] = {2};
 
       size_t indicate[] = {0};
-      OpengmWeightedFeature<OpengmModel::ValueType>(var_indices, shape, shape+1, indicate, non_detection()(traxel_map[n]) )
+      OpengmWeightedFeature<OpengmModel::ValueType>(var_indices, shape, shape+1, indicate, energies.non_detection )
       	.add_as_feature_to( *(m.opengm_model), m.weight_map[Model::det_weight].front() );
 
       indicate[0] = 1;
-      OpengmWeightedFeature<OpengmModel::ValueType>(var_indices, shape, shape+1, indicate, detection()(traxel_map[n]) )
+      OpengmWeightedFeature<OpengmModel::ValueType>(var_indices, shape, shape+1, indicate, energies.detection )
       	.add_as_feature_to( *(m.opengm_model), m.weight_map[Model::det_weight].front() );
     }
 
@@ -397,9 +537,9 @@ namespace pgmlink {
 
     inline void TrainableModelBuilder::add_outgoing_factor( const HypothesesGraph& hypotheses,
 							    Model& m, 
-							    const HypothesesGraph::Node& n) const {
+							    const HypothesesGraph::Node& n,
+							    const NodeEnergies& energies) const {
       using namespace std;
-      property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = hypotheses.get(node_traxel());
 
       LOG(logDEBUG) << "TrainableModelBuilder::add_outgoing_factor(): entered";
       // setup node and arc var indices
@@ -410,12 +550,6 @@ namespace pgmlink {
 	return;
       }
 
-      // collect outgoing arcs for use in the feature functions further down
-      vector<HypothesesGraph::Arc> arcs; 
-      for(HypothesesGraph::OutArcIt a(hypotheses, n); a != lemon::INVALID; ++a) {
-	arcs.push_back(a);
-      }
-
       // construct factor
       const size_t table_dim = vi.size();
       assert(table_dim > 0);
@@ -446,7 +580,7 @@ namespace pgmlink {
 	size_t check = entries.erase(BinToDec(coords));
 	assert(check == 1);
    _unused(check); // for build in release mode
-	OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), disappearance()(traxel_map[n]) )
+	OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), energies.disappearance )
 	  .add_as_feature_to( *(m.opengm_model), m.weight_map[Model::dis_weight].front() );
       }
 
@@ -464,7 +598,7 @@ namespace pgmlink {
 	  size_t check = entries.erase(BinToDec(coords));
 	  assert(check == 1);
      _unused(check); // for build in release mode
-	  OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), move()(traxel_map[n], traxel_map[hypotheses.target(arcs[i-assignment_begin])]) )
+	  OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), energies.moves[i-assignment_begin] )
 	    .add_as_feature_to( *(m.opengm_model), m.weight_map[Model::mov_weight].front() );
 	  coords[i] = 0; // reset coords
 	}
@@ -480,6 +614,7 @@ namespace pgmlink {
 	}
 
 	// (1   ,0,0,1,0,1,0,0) 
+	size_t division_index = 0;
 	for(unsigned int i = assignment_begin; i < table_dim - 1; ++i) {
 	  for(unsigned int j = i+1; j < table_dim; ++j) {
 	    coords[i] = 1;
@@ -487,9 +622,7 @@ namespace pgmlink {
 	    size_t check = entries.erase(BinToDec(coords));
 	    assert(check == 1);
        _unused(check); // for build in release mode
-	    OpengmModel::ValueType value = division()(traxel_map[n],
-							traxel_map[hypotheses.target(arcs[i-assignment_begin])],
-							traxel_map[hypotheses.target(arcs[j-assignment_begin])]);
+	    OpengmModel::ValueType value = energies.divisions[division_index++];
 	    OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), value)
 	      .add_as_feature_to( *(m.opengm_model), m.weight_map[Model::div_weight].front() );
 	    // reset
@@ -518,9 +651,9 @@ namespace pgmlink {
 
     inline void TrainableModelBuilder::add_incoming_factor( const HypothesesGraph& hypotheses,
 								      Model& m,
-								      const HypothesesGraph::Node& n ) const {
+								      const HypothesesGraph::Node& n,
+								      const NodeEnergies& energies ) const {
       using namespace std;
-      property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = hypotheses.get(node_traxel());
 
       LOG(logDEBUG) << "TrainableModelBuilder::add_incoming_factor(): entered";
       // collect and count incoming arcs
@@ -558,7 +691,7 @@ namespace pgmlink {
       size_t check = entries.erase(BinToDec(coords));
       assert(check == 1);
       _unused(check); // for build in release mode
-      OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), appearance()(traxel_map[n]) )
+      OpengmWeightedFeature<OpengmModel::ValueType>(vi, shape.begin(), shape.end(), coords.begin(), energies.appearance )
 	.add_as_feature_to( *(m.opengm_model), m.weight_map[Model::app_weight].front() );
 
       // allow move configurations
@@ -621,51 +754,51 @@ namespace pgmlink {
       add_assignment_vars( hypotheses, *model );
 
 
+      vector<NodeEnergies> energies;
+      compute_energies( hypotheses, energies );
+
       if( has_detection_vars() ) {
 	for(HypothesesGraph::NodeIt n(hypotheses); n!=lemon::INVALID; ++n) {
-	  add_detection_factor( hypotheses, *model, n );
+	  add_detection_factor( hypotheses, *model, n, energies[hypotheses.id(n)] );
 	}
       }
 
       for(HypothesesGraph::NodeIt n(hypotheses); n!=lemon::INVALID; ++n) {
-	add_outgoing_factor( hypotheses, *model, n );
- 	add_incoming_factor( hypotheses, *model, n );
+	add_outgoing_factor( hypotheses, *model, n, energies[hypotheses.id(n)] );
+ 	add_incoming_factor( hypotheses, *model, n, energies[hypotheses.id(n)] );
       }
 
       return model;
     }
 
-    void ECCV12ModelBuilder::add_detection_factor( const HypothesesGraph& hypotheses, Model& m, const HypothesesGraph::Node& n) const {
-      property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = hypotheses.get(node_traxel());
+    void ECCV12ModelBuilder::add_detection_factor( const HypothesesGraph& /*hypotheses*/, Model& m, const HypothesesGraph::Node& n, const NodeEnergies& energies ) const {
 
       size_t vi[] = {m.var_of_node(n)};
       vector<size_t> coords(1,0);
       OpengmExplicitFactor<double> table( vi, vi+1 );
 
       coords[0] = 0;
-      table.set_value( coords, non_detection()(traxel_map[n]) ); 
+      table.set_value( coords, energies.non_detection );
 
       coords[0] = 1;
-      table.set_value( coords, detection()(traxel_map[n]) );
+      table.set_value( coords, energies.detection );
 
       table.add_to( *(m.opengm_model) );
     }
 
     inline void ECCV12ModelBuilder::add_outgoing_factor( const HypothesesGraph& hypotheses,
 								   Model& m, 
-								   const HypothesesGraph::Node& n
+								   const HypothesesGraph::Node& n,
+								   const NodeEnergies& energies
 								   ) const {
       using namespace std;
-      property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = hypotheses.get(node_traxel());
 
       LOG(logDEBUG) << "ECCV12ModelBuilder::add_outgoing_factor(): entered";
       // collect and count outgoing arcs
-      vector<HypothesesGraph::Arc> arcs; 
       vector<size_t> vi; 		// opengm variable indeces
       vi.push_back(m.var_of_node(n)); // first detection node, remaining will be transition nodes
       int count = 0;
       for(HypothesesGraph::OutArcIt a(hypotheses, n); a != lemon::INVALID; ++a) {
-	arcs.push_back(a);
 	vi.push_back(m.var_of_arc(a));
 	++count;
       }
@@ -684,7 +817,7 @@ namespace pgmlink {
 	// disappearance 
 	coords = std::vector<size_t>(table_dim, 0);
 	coords[0] = 1; 						// (1)
-	table.set_value( coords, disappearance()(traxel_map[n]) );
+	table.set_value( coords, energies.disappearance );
 
 	table.add_to( *m.opengm_model );
 
@@ -701,12 +834,12 @@ namespace pgmlink {
 	// disappearance configuration
 	coords = std::vector<size_t>(table_dim, 0);
 	coords[0] = 1; // (1,0)
-	table.set_value( coords, disappearance()(traxel_map[n]) );
+	table.set_value( coords, energies.disappearance );
 
 	// move configurations
 	coords = std::vector<size_t>(table_dim, 1);
 	// (1,1)
-	table.set_value( coords, move()(traxel_map[n], traxel_map[hypotheses.target(arcs[0])]) );
+	table.set_value( coords, energies.moves[0] );
 
 	table.add_to( *m.opengm_model );
 
@@ -723,7 +856,7 @@ namespace pgmlink {
 	// disappearance configuration
 	coords = std::vector<size_t>(table_dim, 0);
 	coords[0] = 1; // (1,0,...,0)
-	table.set_value( coords, disappearance()(traxel_map[n]) );
+	table.set_value( coords, energies.disappearance );
 
 	// move configurations
 	coords = std::vector<size_t>(table_dim, 0);
@@ -731,7 +864,7 @@ namespace pgmlink {
 	// (1,0,0,0,1,0,0)
 	for(size_t i = 1; i < table_dim; ++i) {
 	  coords[i] = 1; 
-	  table.set_value( coords, move()(traxel_map[n], traxel_map[hypotheses.target(arcs[i-1])]) );
+	  table.set_value( coords, energies.moves[i-1] );
 	  coords[i] = 0; // reset coords
 	}
       
@@ -740,14 +873,12 @@ namespace pgmlink {
 		coords = std::vector<size_t>(table_dim, 0);
 		coords[0] = 1;
 		// (1,0,0,1,0,1,0,0)
+		size_t division_index = 0;
 		for(unsigned int i = 1; i < table_dim - 1; ++i) {
 		  for(unsigned int j = i+1; j < table_dim; ++j) {
 			coords[i] = 1;
 			coords[j] = 1;
-			table.set_value(coords, division()(traxel_map[n],
-							  traxel_map[hypotheses.target(arcs[i-1])],
-							  traxel_map[hypotheses.target(arcs[j-1])]
-							  ));
+			table.set_value(coords, energies.divisions[division_index++]);
 
 			// reset
 			coords[i] = 0;
@@ -764,9 +895,9 @@ namespace pgmlink {
 
     inline void ECCV12ModelBuilder::add_incoming_factor( const HypothesesGraph& hypotheses,
 								   Model& m,
-								   const HypothesesGraph::Node& n) const {
+								   const HypothesesGraph::Node& n,
+								   const NodeEnergies& energies) const {
       using namespace std;
-      property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = hypotheses.get(node_traxel());
 
       LOG(logDEBUG) << "ECCV12ModelBuilder::add_incoming_factor(): entered";
       // collect and count incoming arcs
@@ -793,8 +924,8 @@ namespace pgmlink {
       // appearance configuration
       coords = std::vector<size_t>(table_dim, 0);
       coords[0] = 1; // (1,0,...,0)
-      table.set_value( coords, appearance()(traxel_map[n]) );
-      assert(table.get_value( coords ) == appearance()(traxel_map[n]));
+      table.set_value( coords, energies.appearance );
+      assert(table.get_value( coords ) == energies.appearance);
 
       // allow move configurations
       coords = std::vector<size_t>(table_dim, 0);
@@ -1,6 +1,15 @@
 #include <cassert>
+#include <cstdio>
+#include <ctime>
+#include <map>
 #include <exception>
+#include <stdexcept>
+#include <utility>
 #include <string>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include "pgmlink/randomforest.h"
 #include "pgmlink/log.h"
 
@@ -14,6 +23,7 @@ namespace pgmlink {
             if ( pFile == NULL){
                 throw std::runtime_error("pgmlink: Could not create Random Forest. Input file does not exist.");
             }
+            std::fclose(pFile);
 
             // load the Random Forest
             vigra::RandomForest<RF_LABEL_TYPE> rf;
@@ -23,6 +33,63 @@ namespace pgmlink {
         }
 
 
+      namespace {
+	struct CachedForest {
+	  time_t modification_time;
+	  off_t size;
+	  RandomForestPtr forest;
+	};
+
+	// by file name
+	std::map<std::string, CachedForest> forest_cache;
+      }
+
+        RandomForestPtr getSharedRandomForest(const std::string& filename)
+        {
+            struct stat status;
+            if(stat(filename.c_str(), &status) != 0) {
+                throw std::runtime_error("pgmlink: Could not create Random Forest. Input file does not exist.");
+            }
+
+            RandomForestPtr forest;
+            #pragma omp critical(pgmlink_random_forest_cache)
+            {
+                std::map<std::string, CachedForest>::const_iterator it = forest_cache.find(filename);
+                if(it != forest_cache.end() && it->second.modification_time == status.st_mtime
+                   && it->second.size == status.st_size) {
+                    forest = it->second.forest;
+                }
+            }
+            if(forest) {
+                return forest;
+            }
+
+            // HDF5 is not thread safe; other files are still served meanwhile
+            #pragma omp critical(pgmlink_random_forest_import)
+            {
+                forest.reset(new vigra::RandomForest<RF_LABEL_TYPE>(getRandomForest(filename)));
+            }
+            LOG(logDEBUG) << "getSharedRandomForest(): imported " << filename;
+
+            #pragma omp critical(pgmlink_random_forest_cache)
+            {
+                CachedForest& cached = forest_cache[filename];
+                cached.modification_time = status.st_mtime;
+                cached.size = status.st_size;
+                cached.forest = forest;
+            }
+            return forest;
+        }
+
+        void clearRandomForestCache()
+        {
+            #pragma omp critical(pgmlink_random_forest_cache)
+            {
+                forest_cache.clear();
+            }
+        }
+
+
         vigra::MultiArray<2,float> createFeatureVector(const Traxel &tr, const std::vector<std::string> &selFeatures)
         {
             // calculate the total size of the feature vector
@@ -32,7 +99,7 @@ namespace pgmlink {
             for(std::vector<std::string>::const_iterator it = selFeatures.begin(); it != selFeatures.end(); it++)
             {
                 // find selected element in feature map
-                FeatureMap::const_iterator f_it = tr.features.find(*it);
+                TraxelFeatures::const_iterator f_it = tr.features.find(*it);
                 if( f_it != tr.features.end() )
                 {
                     // add its length, if found
@@ -53,7 +120,7 @@ namespace pgmlink {
             for(std::vector<std::string>::const_iterator it = selFeatures.begin(); it != selFeatures.end(); it++)
             {
                 // find selected element in feature map
-                FeatureMap::const_iterator f_it = tr.features.find(*it);
+                TraxelFeatures::const_iterator f_it = tr.features.find(*it);
                 if( f_it != tr.features.end() )
                 {
                     // copy entries
@@ -89,8 +156,71 @@ namespace pgmlink {
 	  feat.push_back(value);
           tr.features[name] = feat;
 	}
+
+	// values of feature k of tr, read through the slot if tr is interned with schema
+	const float* feature_values(const Traxel& tr,
+				    const std::vector<std::string>& names,
+				    const boost::shared_ptr<FeatureSchema>& schema,
+				    const std::vector<FeatureSchema::slot_type>& slots,
+				    size_t k,
+				    size_t& size) {
+	  if(schema && tr.feature_schema() == schema && tr.feature_size(slots[k]) > 0) {
+	    size = tr.feature_size(slots[k]);
+	    return tr.feature(slots[k]);
+	  }
+	  TraxelFeatures::const_iterator f_it = tr.features.find(names[k]);
+	  if(f_it == tr.features.end() || f_it->second.empty()) {
+	    size = 0;
+	    return 0;
+	  }
+	  size = f_it->second.size();
+	  return &f_it->second[0];
+	}
       }
 
+        vigra::MultiArray<2,float> createFeatureMatrix(const std::vector<const Traxel*>& traxels,
+                                                       const std::vector<std::string>& selFeatures)
+        {
+            if(traxels.empty()) {
+                return vigra::MultiArray<2,float>();
+            }
+
+            // resolve the slots once for the schema of the first traxel
+            const boost::shared_ptr<FeatureSchema>& schema = traxels.front()->feature_schema();
+            std::vector<FeatureSchema::slot_type> slots;
+            if(schema) {
+                for(std::vector<std::string>::const_iterator it = selFeatures.begin(); it != selFeatures.end(); ++it) {
+                    slots.push_back(schema->slot(*it));
+                }
+            }
+
+            size_t len = 0;
+            for(size_t k = 0; k < selFeatures.size(); ++k) {
+                size_t size;
+                feature_values(*traxels.front(), selFeatures, schema, slots, k, size);
+                len += size;
+            }
+
+            vigra::MultiArray<2,float> featureMatrix (matrix_shape(traxels.size(), len));
+            for(size_t i = 0; i < traxels.size(); ++i) {
+                size_t col = 0;
+                for(size_t k = 0; k < selFeatures.size(); ++k) {
+                    size_t size;
+                    const float* values = feature_values(*traxels[i], selFeatures, schema, slots, k, size);
+                    if(col + size > len) {
+                        throw std::runtime_error("createFeatureMatrix(): traxels differ in their feature sizes");
+                    }
+                    for(size_t j = 0; j < size; ++j, ++col) {
+                        featureMatrix(i, col) = values[j];
+                    }
+                }
+                if(col != len) {
+                    throw std::runtime_error("createFeatureMatrix(): traxels differ in their feature sizes");
+                }
+            }
+            return featureMatrix;
+        }
+
       int predictTracklets( Traxels &ts,
                               vigra::RandomForest<RF_LABEL_TYPE> &rf,
                               std::vector<std::string> &sel,
@@ -111,11 +241,51 @@ namespace pgmlink {
                               const std::vector<std::string>& feature_names,
                               unsigned int cls = 1,
                               const std::string& output_feat_name = "cellness") {
-	for(TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
-	  Traxel tr = *it;
-	  double prob = predict(tr, rf, feature_names, cls);
-	  save_as_feature(tr, output_feat_name, prob);
-	  ts.replace(it, tr);
+	if(cls >= static_cast<unsigned int>(rf.class_count())) {
+	  throw std::runtime_error("predict_traxels(): Provided class number is too large.");
+	}
+	LOG(logDEBUG) << "predict_traxels(): random forest " << output_feat_name;
+
+	// one feature matrix per timestep; read through the const index, the
+	// predictions do not change the aggregates of the store
+	const TraxelStoreByTimestep& traxels_by_timestep = static_cast<const TraxelStore&>(ts).get<by_timestep>();
+	std::vector<std::pair<TraxelStoreByTimestep::const_iterator, TraxelStoreByTimestep::const_iterator> > ranges;
+	for(TraxelStoreByTimestep::const_iterator it = traxels_by_timestep.begin(); it != traxels_by_timestep.end();) {
+	  TraxelStoreByTimestep::const_iterator next = traxels_by_timestep.upper_bound(it->Timestep);
+	  ranges.push_back(std::make_pair(it, next));
+	  it = next;
+	}
+
+	std::string error;
+	#pragma omp parallel for schedule(dynamic)
+	for(int i = 0; i < static_cast<int>(ranges.size()); ++i) {
+	  try {
+	    std::vector<const Traxel*> traxels;
+	    for(TraxelStoreByTimestep::const_iterator it = ranges[i].first; it != ranges[i].second; ++it) {
+	      traxels.push_back(&*it);
+	    }
+	    const vigra::MultiArray<2,float> features = createFeatureMatrix(traxels, feature_names);
+	    if(features.shape(1) != rf.feature_count()) {
+	      throw std::runtime_error("predict_traxels(): number of features does not match the random forest");
+	    }
+	    vigra::MultiArray<2,double> prob (matrix_shape(features.shape(0), rf.class_count()));
+	    rf.predictProbabilities(features, prob);
+
+	    // the features are not part of any index key
+	    for(size_t k = 0; k < traxels.size(); ++k) {
+	      Traxel& tr = const_cast<Traxel&>(*traxels[k]);
+	      save_as_feature(tr, output_feat_name, prob(k, cls));
+	      tr.intern_features(ts.feature_schema_ptr());
+	    }
+	  } catch(std::exception& e) {
+	    #pragma omp critical(pgmlink_predict_traxels)
+	    {
+	      if(error.empty()) error = e.what();
+	    }
+	  }
+	}
+	if(!error.empty()) {
+	  throw std::runtime_error(error);
 	}
       }
 
@@ -1,12 +1,20 @@
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <string.h>
 #include <memory.h>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <lemon/core.h>
 #include <opengm/datastructures/marray/marray.hxx>
-#include <opengm/graphicalmodel/graphicalmodel_hdf5.hxx>
 
+#include "pgmlink/arena.h"
 #include "pgmlink/hypotheses.h"
+#include "pgmlink/hypotheses_snapshot.h"
+#include "pgmlink/instrumentation.h"
 #include "pgmlink/log.h"
 #include "pgmlink/reasoner_constracking.h"
 #include "pgmlink/traxels.h"
@@ -25,13 +33,269 @@ ConservationTracking::~ConservationTracking() {
     //   }
 }
 
+////
+//// struct ConservationTracking::Subproblem
+////
+struct ConservationTracking::Subproblem {
+    // copies the nodes (in NodeIt order of g) and the arcs between them;
+    // the copies refer to the traxels of g. sub_nodes[g.id(n)] is set to
+    // the copy of n.
+    void copy(const HypothesesGraph& g,
+              const vector<HypothesesGraph::Node>& from_nodes,
+              const vector<HypothesesGraph::Arc>& from_arcs,
+              vector<HypothesesGraph::Node>& sub_nodes);
+
+    HypothesesGraph graph;
+    // node and arc of the copied graph by id in graph
+    std::vector<HypothesesGraph::Node> nodes;
+    std::vector<HypothesesGraph::Arc> arcs;
+    boost::shared_ptr<ConservationTracking> reasoner;
+};
+
+void ConservationTracking::Subproblem::copy(const HypothesesGraph& g,
+                                            const vector<HypothesesGraph::Node>& from_nodes,
+                                            const vector<HypothesesGraph::Arc>& from_arcs,
+                                            vector<HypothesesGraph::Node>& sub_nodes) {
+    const NodeTraxels traxels(g);
+    const bool with_tracklet_properties = g.has_property(node_tracklet());
+    const bool with_intern_dists = g.has_property(tracklet_intern_dist());
+    const property_map<arc_distance, HypothesesGraph::base_graph>::type& arc_distances =
+            g.get(arc_distance());
+    const HypothesesGraph::node_timestep_map& timesteps = g.get(node_timestep());
+
+    graph.add(node_traxel_handle()).add(arc_distance());
+    if (with_tracklet_properties) {
+        graph.add(node_tracklet());
+    }
+    if (with_intern_dists) {
+        graph.add(tracklet_intern_dist());
+    }
+
+    // ListDigraph iterates the nodes in reverse insertion order: insert
+    // them backwards to keep the order of g
+    for (vector<HypothesesGraph::Node>::const_reverse_iterator n = from_nodes.rbegin(); n != from_nodes.rend(); ++n) {
+        const HypothesesGraph::Node sub_node = graph.add_node(timesteps[*n]);
+        graph.set_traxel(sub_node, traxels[*n]);
+        if (with_tracklet_properties) {
+            graph.get(node_tracklet()).set(sub_node, g.get(node_tracklet())[*n]);
+        }
+        if (with_intern_dists) {
+            graph.get(tracklet_intern_dist()).set(sub_node, g.get(tracklet_intern_dist())[*n]);
+        }
+        sub_nodes[g.id(*n)] = sub_node;
+        if (nodes.size() <= static_cast<size_t>(graph.id(sub_node))) {
+            nodes.resize(graph.id(sub_node) + 1, lemon::INVALID);
+        }
+        nodes[graph.id(sub_node)] = *n;
+    }
+
+    for (vector<HypothesesGraph::Arc>::const_iterator a = from_arcs.begin(); a != from_arcs.end(); ++a) {
+        const HypothesesGraph::Arc sub_arc = graph.addArc(sub_nodes[g.id(g.source(*a))],
+                                                          sub_nodes[g.id(g.target(*a))]);
+        graph.get(arc_distance()).set(sub_arc, arc_distances[*a]);
+        if (arcs.size() <= static_cast<size_t>(graph.id(sub_arc))) {
+            arcs.resize(graph.id(sub_arc) + 1, lemon::INVALID);
+        }
+        arcs[graph.id(sub_arc)] = *a;
+    }
+}
+
+namespace {
+// trace event of a component subproblem; only formatted while tracing
+string component_name(const char* phase, int component) {
+    if (!instrumentation::tracing()) {
+        return string();
+    }
+    ostringstream name;
+    name << "ConservationTracking: " << phase << " component " << component;
+    return name.str();
+}
+
+// the tiles of infer_tiles() along one axis
+struct TileAxis {
+    TileAxis() : lower(0), size(1), count(1) {}
+    TileAxis(double lower, double upper, double size)
+        : lower(lower), size(size),
+          count(std::max<int>(1, static_cast<int>(std::ceil((upper - lower) / size)))) {}
+
+    int clamped(double x) const {
+        return std::max(0, std::min(count - 1, static_cast<int>(std::floor((x - lower) / size))));
+    }
+    // closer than margin to a border between two tiles
+    bool near_border(double x, double margin) const {
+        const int t = clamped(x);
+        return (t > 0 && x - (lower + t * size) < margin) || (t + 1 < count && lower + (t + 1) * size - x < margin);
+    }
+
+    double lower;
+    double size;
+    int count;
+};
+
+int find_root(vector<int>& parents, int i) {
+    while (parents[i] != i) {
+        parents[i] = parents[parents[i]]; // path halving
+        i = parents[i];
+    }
+    return i;
+}
+}
+
 double ConservationTracking::forbidden_cost() const {
     return forbidden_cost_;
 }
 
+bool ConservationTracking::with_constraints() const {
+    return with_constraints_;
+}
+
+bool ConservationTracking::with_components() const {
+    return with_components_;
+}
+
+void ConservationTracking::set_constraint_names(bool with_names) {
+    with_constraint_names_ = with_names;
+}
+
+void ConservationTracking::set_with_statistics(bool state) {
+    with_statistics_ = state;
+}
+
+void ConservationTracking::set_tiling(double tile_size, double halo) {
+    if (tile_size < 0 || (tile_size > 0 && halo <= 0)) {
+        throw std::invalid_argument("ConservationTracking::set_tiling(): tile_size >= 0 and halo > 0 required");
+    }
+    if (tile_size > 0 && window_length_ > 0) {
+        throw std::invalid_argument("ConservationTracking::set_tiling(): tiles cannot be combined with windows");
+    }
+    tile_size_ = tile_size;
+    tile_halo_ = halo;
+}
+
+ConservationTracking* ConservationTracking::subproblem_reasoner(bool with_components) const {
+    ConservationTracking* reasoner = new ConservationTracking(
+            max_number_objects_, detection_, division_, transition_, forbidden_cost_, ep_gap_,
+            with_tracklets_, with_divisions_, disappearance_cost_, appearance_cost_,
+            with_misdetections_allowed_, with_appearance_, with_disappearance_,
+            transition_parameter_, with_constraints_, cplex_timeout_, with_components);
+    reasoner->with_constraint_names_ = with_constraint_names_;
+    reasoner->with_statistics_ = with_statistics_;
+    reasoner->progress_callback_ = progress_callback_;
+    reasoner->progress_interval_ = progress_interval_;
+    reasoner->stop_requested_ = stop_requested_;
+    reasoner->is_subproblem_ = true;
+    reasoner->earliest_timestep_ = earliest_timestep_;
+    reasoner->latest_timestep_ = latest_timestep_;
+    return reasoner;
+}
+
+void ConservationTracking::decompose(const HypothesesGraph& g) {
+    // union-find over the node ids
+    vector<int> parents(g.maxNodeId() + 1, -1);
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        parents[g.id(n)] = g.id(n);
+    }
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        const int source_root = find_root(parents, g.id(g.source(a)));
+        const int target_root = find_root(parents, g.id(g.target(a)));
+        if (source_root != target_root) {
+            parents[target_root] = source_root;
+        }
+    }
+
+    // number the components in NodeIt order
+    vector<int> component_of(parents.size(), -1);
+    vector<int> root_component(parents.size(), -1);
+    vector<vector<HypothesesGraph::Node> > component_nodes;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        const int root = find_root(parents, g.id(n));
+        if (root_component[root] == -1) {
+            root_component[root] = component_nodes.size();
+            component_nodes.push_back(vector<HypothesesGraph::Node>());
+        }
+        component_of[g.id(n)] = root_component[root];
+        component_nodes[root_component[root]].push_back(n);
+    }
+    LOG(logINFO) << "ConservationTracking::decompose: " << component_nodes.size() << " components";
+    if (component_nodes.size() < 2) {
+        return;
+    }
+
+    vector<vector<HypothesesGraph::Arc> > component_arcs(component_nodes.size());
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        component_arcs[component_of[g.id(g.source(a))]].push_back(a);
+    }
+
+    // the components are disjoint: one lookup for all of them
+    vector<HypothesesGraph::Node> sub_nodes(parents.size(), lemon::INVALID);
+    components_.resize(component_nodes.size());
+    for (size_t c = 0; c < component_nodes.size(); ++c) {
+        components_[c] = boost::shared_ptr<Subproblem>(new Subproblem());
+        components_[c]->copy(g, component_nodes[c], component_arcs[c], sub_nodes);
+        components_[c]->reasoner = boost::shared_ptr<ConservationTracking>(subproblem_reasoner(false));
+        pass_starting_point(g, *components_[c]);
+    }
+    for (node_var_map::const_iterator it = fixed_dis_states_.begin();
+            it != fixed_dis_states_.end(); ++it) {
+        ConservationTracking& reasoner = *components_[component_of[g.id(it->first)]]->reasoner;
+        reasoner.fixed_dis_states_[sub_nodes[g.id(it->first)]] = it->second;
+    }
+    if (!fixed_arc_states_.empty()) {
+        for (size_t c = 0; c < components_.size(); ++c) {
+            const Subproblem& component = *components_[c];
+            for (HypothesesGraph::ArcIt a(component.graph); a != lemon::INVALID; ++a) {
+                arc_var_map::const_iterator fixed = fixed_arc_states_.find(component.arcs[component.graph.id(a)]);
+                if (fixed != fixed_arc_states_.end()) {
+                    component.reasoner->fixed_arc_states_[a] = fixed->second;
+                }
+            }
+        }
+    }
+}
+
 void ConservationTracking::formulate(const HypothesesGraph& hypotheses) {
+    PGMLINK_TIMED_SCOPE("ConservationTracking::formulate");
     LOG(logDEBUG) << "ConservationTracking::formulate: entered";
+    if (!with_constraints_) {
+        throw std::runtime_error("ConservationTracking::formulate(): inference with soft constraints is not implemented");
+    }
     reset();
+    if (!is_subproblem_ && !hypotheses.timesteps().empty()) {
+        earliest_timestep_ = hypotheses.earliest_timestep();
+        latest_timestep_ = hypotheses.latest_timestep();
+    }
+
+    if (window_length_ > 0 || tile_size_ > 0) {
+        // the windows or tiles are formulated one after the other in infer()
+        windowed_graph_ = &hypotheses;
+        return;
+    }
+
+    if (with_components_) {
+        decompose(hypotheses);
+    }
+    if (!components_.empty()) {
+        string error;
+        #pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < static_cast<int>(components_.size()); ++c) {
+            try {
+                instrumentation::TraceScope trace(component_name("formulate", c), "solver");
+                components_[c]->reasoner->formulate(components_[c]->graph);
+            } catch (std::exception& e) {
+                #pragma omp critical(pgmlink_constracking)
+                {
+                    if (error.empty()) error = e.what();
+                }
+            }
+        }
+        // the rows of the components were built in the arenas of the workers
+        Arena::release_thread_arenas();
+        if (!error.empty()) {
+            throw runtime_error(error);
+        }
+        return;
+    }
+
     pgm_ = boost::shared_ptr < pgm::OpengmModelDeprecated > (new pgm::OpengmModelDeprecated());
 
     HypothesesGraph const *graph;
@@ -56,6 +320,8 @@ void ConservationTracking::formulate(const HypothesesGraph& hypotheses) {
     }
     pgm::OpengmModelDeprecated::ogmGraphicalModel* model = pgm_->Model();
 
+    LOG(logDEBUG) << "ConservationTracking::formulate: compute_energies";
+    compute_energies(*graph);
     LOG(logDEBUG) << "ConservationTracking::formulate: add_finite_factors";
     add_finite_factors(*graph);
     LOG(logDEBUG) << "ConservationTracking::formulate: finished add_finite_factors";
@@ -72,13 +338,28 @@ void ConservationTracking::formulate(const HypothesesGraph& hypotheses) {
     param.integerConstraint_ = true;
     param.epGap_ = ep_gap_;
     param.timeLimit_ = cplex_timeout_;
+    if (progress_callback_) {
+        // infer() solves in slices
+        param.timeLimit_ = pgm::anytime_slice_seconds(progress_interval_, cplex_timeout_);
+    }
     LOG(logDEBUG) << "ConservationTracking::formulate ep_gap = " << param.epGap_;
 
     optimizer_ = new cplex_optimizer(*model, param);
 
     LOG(logDEBUG) << "ConservationTracking::formulate: add_constraints";
-    if (with_constraints_) {
+    {
+        PhaseTimer timer(with_statistics_);
         add_constraints(*graph);
+        timer.stop(constraints_seconds_);
+    }
+    if (!is_subproblem_) {
+        // the constraint rows are submitted, their arena blocks are not needed anymore
+        Arena::release_this_thread();
+    }
+
+    if (!start_node_states_.empty()) {
+        LOG(logDEBUG) << "ConservationTracking::formulate: add_starting_labels";
+        add_starting_labels(hypotheses);
     }
 
     LOG(logINFO) << "number_of_transition_nodes_ = " << number_of_transition_nodes_;
@@ -89,17 +370,211 @@ void ConservationTracking::formulate(const HypothesesGraph& hypotheses) {
 }
 
 void ConservationTracking::infer() {
-	if (!with_constraints_) {
-		opengm::hdf5::save(optimizer_->graphicalModel(), "./conservationTracking.h5", "conservationTracking");
-		throw std::runtime_error("GraphicalModel::infer(): inference with soft constraints is not implemented yet. The conservation tracking factor graph has been saved to file");
-	}
-    opengm::InferenceTermination status = optimizer_->infer();
+    PGMLINK_TIMED_SCOPE("ConservationTracking::infer");
+    if (!is_subproblem_) {
+        *stop_requested_ = false;
+    }
+    if (windowed_graph_ != NULL) {
+        if (tile_size_ > 0) {
+            infer_tiles();
+        } else {
+            infer_windows();
+        }
+        // the windows and tiles are formulated here
+        Arena::release_thread_arenas();
+        return;
+    }
+
+    if (!components_.empty()) {
+        string error;
+        #pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < static_cast<int>(components_.size()); ++c) {
+            try {
+                instrumentation::TraceScope trace(component_name("solve", c), "solver");
+                components_[c]->reasoner->infer();
+            } catch (std::exception& e) {
+                #pragma omp critical(pgmlink_constracking)
+                {
+                    if (error.empty()) error = e.what();
+                }
+            }
+        }
+        if (!error.empty()) {
+            throw runtime_error(error);
+        }
+        return;
+    }
+
+    if (!starting_labels_.empty()) {
+        optimizer_->setStartingPoint(starting_labels_.begin());
+    }
+    opengm::InferenceTermination status;
+    instrumentation::TraceScope trace("ConservationTracking: solve", "solver");
+    if (progress_callback_) {
+        status = pgm::infer_anytime(*optimizer_, pgm::anytime_slice_seconds(progress_interval_, cplex_timeout_),
+                                    cplex_timeout_, ep_gap_,
+                                    boost::bind(&ConservationTracking::report_progress, this, _1, _2, _3));
+    } else {
+        status = optimizer_->infer();
+    }
     if (status != opengm::NORMAL) {
         throw std::runtime_error("GraphicalModel::infer(): optimizer terminated abnormally");
     }
+    solved_ = true;
+}
+
+void ConservationTracking::reweight(const HypothesesGraph& hypotheses,
+        boost::function<double (const Traxel&, const size_t)> detection,
+        boost::function<double (const Traxel&, const size_t)> division,
+        boost::function<double (const double)> transition,
+        double forbidden_cost,
+        boost::function<double (const Traxel&)> disappearance_cost_fn,
+        boost::function<double (const Traxel&)> appearance_cost_fn) {
+    detection_ = detection;
+    division_ = division;
+    transition_ = transition;
+    forbidden_cost_ = forbidden_cost;
+    disappearance_cost_ = disappearance_cost_fn;
+    appearance_cost_ = appearance_cost_fn;
+
+    if (windowed_graph_ != NULL) {
+        // the windows or tiles are formulated with the new energies in infer()
+        return;
+    }
+
+    if (!components_.empty()) {
+        string error;
+        #pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < static_cast<int>(components_.size()); ++c) {
+            try {
+                components_[c]->reasoner->reweight(components_[c]->graph, detection, division, transition,
+                                                   forbidden_cost, disappearance_cost_fn, appearance_cost_fn);
+            } catch (std::exception& e) {
+                #pragma omp critical(pgmlink_constracking)
+                {
+                    if (error.empty()) error = e.what();
+                }
+            }
+        }
+        if (!error.empty()) {
+            throw runtime_error(error);
+        }
+        return;
+    }
+
+    if (optimizer_ == NULL) {
+        throw runtime_error("ConservationTracking::reweight(): formulate() has to be called first");
+    }
+    LOG(logDEBUG) << "ConservationTracking::reweight: refill the energy factors";
+    const size_t number_of_energy_functions = energy_functions_.size();
+    const HypothesesGraph& graph = with_tracklets_ ? tracklet_graph_ : hypotheses;
+    compute_energies(graph);
+    add_finite_factors(graph);
+    if (energy_functions_.size() != number_of_energy_functions
+            || next_energy_function_ != number_of_energy_functions) {
+        throw runtime_error("ConservationTracking::reweight(): hypotheses differ from the formulated graph");
+    }
+    optimizer_->updateObjective();
+    solved_ = false;
+}
+
+SolverStatistics ConservationTracking::statistics() const {
+    if (windowed_graph_ != NULL) {
+        return window_statistics_;
+    }
+    SolverStatistics stats;
+    if (!components_.empty()) {
+        for (size_t c = 0; c < components_.size(); ++c) {
+            stats.add(components_[c]->reasoner->statistics());
+        }
+        return stats;
+    }
+    if (optimizer_ == NULL) {
+        return stats;
+    }
+
+    stats.number_of_models = 1;
+    stats.number_of_variables = pgm_->Model()->numberOfVariables();
+    stats.number_of_factors = pgm_->Model()->numberOfFactors();
+    stats.number_of_table_entries = pgm::number_of_table_entries(*pgm_->Model());
+    stats.number_of_constraints = number_of_constraints_;
+    stats.constraints_seconds = constraints_seconds_;
+    if (solved_) {
+        stats.objective = optimizer_->value();
+        stats.bound = optimizer_->bound();
+        // the solver stops at the gap or at the time limit
+        stats.status = stats.gap() <= ep_gap_ + 1e-9 ? "optimal" : "time limit";
+    }
+    return stats;
+}
+
+void ConservationTracking::add_memory_usage(MemoryReport& report) const {
+    for (size_t c = 0; c < components_.size(); ++c) {
+        components_[c]->reasoner->add_memory_usage(report);
+    }
+    if (pgm_) {
+        std::vector<std::string> function_types;
+        function_types.push_back("explicit functions");
+        pgm::add_model_memory_usage(*pgm_->Model(), function_types, "opengm model", report);
+    }
 }
 
 void ConservationTracking::conclude(HypothesesGraph& g) {
+    PGMLINK_TIMED_SCOPE("ConservationTracking::conclude");
+    if (windowed_graph_ != NULL) {
+        g.add(node_active2()).add(arc_active()).add(division_active());
+        property_map<node_active2, HypothesesGraph::base_graph>::type& active_nodes =
+                g.get(node_active2());
+        property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
+        property_map<division_active, HypothesesGraph::base_graph>::type& division_nodes =
+                g.get(division_active());
+        for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+            active_nodes.set(n, window_node_states_[g.id(n)]);
+            if (with_divisions_ && lemon::countOutArcs(g, n) > 1) {
+                division_nodes.set(n, window_division_states_[g.id(n)]);
+            }
+        }
+        for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+            active_arcs.set(a, window_arc_states_[g.id(a)]);
+        }
+        return;
+    }
+
+    if (!components_.empty()) {
+        g.add(node_active2()).add(arc_active()).add(division_active());
+        property_map<node_active2, HypothesesGraph::base_graph>::type& active_nodes =
+                g.get(node_active2());
+        property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
+        property_map<division_active, HypothesesGraph::base_graph>::type& division_nodes =
+                g.get(division_active());
+
+        for (size_t c = 0; c < components_.size(); ++c) {
+            Subproblem& component = *components_[c];
+            HypothesesGraph& sub = component.graph;
+            component.reasoner->conclude(sub);
+
+            property_map<node_active2, HypothesesGraph::base_graph>::type& sub_active_nodes =
+                    sub.get(node_active2());
+            property_map<arc_active, HypothesesGraph::base_graph>::type& sub_active_arcs =
+                    sub.get(arc_active());
+            property_map<division_active, HypothesesGraph::base_graph>::type& sub_division_nodes =
+                    sub.get(division_active());
+            for (HypothesesGraph::NodeIt n(sub); n != lemon::INVALID; ++n) {
+                const HypothesesGraph::Node node = component.nodes[sub.id(n)];
+                active_nodes.set(node, sub_active_nodes[n]);
+                // the division variables are at the nodes with more than
+                // one out arc, both with and without tracklets
+                if (with_divisions_ && lemon::countOutArcs(sub, n) > 1) {
+                    division_nodes.set(node, sub_division_nodes[n]);
+                }
+            }
+            for (HypothesesGraph::ArcIt a(sub); a != lemon::INVALID; ++a) {
+                active_arcs.set(component.arcs[sub.id(a)], sub_active_arcs[a]);
+            }
+        }
+        return;
+    }
+
     // extract solution from optimizer
     vector<pgm::OpengmModelDeprecated::ogmInference::LabelType> solution;
     opengm::InferenceTermination status = optimizer_->arg(solution);
@@ -129,7 +604,7 @@ void ConservationTracking::conclude(HypothesesGraph& g) {
 
     // write state after inference into 'active'-property maps
     // the node is also active if its appearance node is active
-    for (std::map<HypothesesGraph::Node, size_t>::const_iterator it = app_node_map_.begin();
+    for (node_var_map::const_iterator it = app_node_map_.begin();
             it != app_node_map_.end(); ++it) {
         if (with_tracklets_) {
             // set state of tracklet nodes
@@ -159,7 +634,7 @@ void ConservationTracking::conclude(HypothesesGraph& g) {
     }
 
     // the node is also active if its disappearance node is active
-    for (std::map<HypothesesGraph::Node, size_t>::const_iterator it = dis_node_map_.begin();
+    for (node_var_map::const_iterator it = dis_node_map_.begin();
             it != dis_node_map_.end(); ++it) {
 
         if (solution[it->second] > 0) {
@@ -198,7 +673,7 @@ void ConservationTracking::conclude(HypothesesGraph& g) {
         }
     }
 
-    for (std::map<HypothesesGraph::Arc, size_t>::const_iterator it = arc_map_.begin();
+    for (arc_var_map::const_iterator it = arc_map_.begin();
             it != arc_map_.end(); ++it) {
         if (solution[it->second] >= 1) {
             if (with_tracklets_) {
@@ -210,11 +685,11 @@ void ConservationTracking::conclude(HypothesesGraph& g) {
     }
     // initialize division node map
     if (with_divisions_) {
-        for (std::map<HypothesesGraph::Node, size_t>::const_iterator it = div_node_map_.begin();
+        for (node_var_map::const_iterator it = div_node_map_.begin();
                 it != div_node_map_.end(); ++it) {
             division_nodes.set(it->first, false);
         }
-        for (std::map<HypothesesGraph::Node, size_t>::const_iterator it = div_node_map_.begin();
+        for (node_var_map::const_iterator it = div_node_map_.begin();
                 it != div_node_map_.end(); ++it) {
             if (solution[it->second] >= 1) {
                 if (with_tracklets_) {
@@ -228,7 +703,483 @@ void ConservationTracking::conclude(HypothesesGraph& g) {
     }
 }
 
-const std::map<HypothesesGraph::Arc, size_t>& ConservationTracking::get_arc_map() const {
+void ConservationTracking::infer_windows() {
+    const HypothesesGraph& g = *windowed_graph_;
+    const HypothesesGraph::node_timestep_map& timesteps = g.get(node_timestep());
+    window_node_states_.assign(g.maxNodeId() + 1, 0);
+    window_arc_states_.assign(g.maxArcId() + 1, false);
+    window_division_states_.assign(g.maxNodeId() + 1, false);
+    window_statistics_ = SolverStatistics();
+    if (g.timesteps().empty()) {
+        return;
+    }
+
+    // every window visits only its own timesteps
+    std::map<int, vector<HypothesesGraph::Node> > nodes_at;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        nodes_at[timesteps[n]].push_back(n);
+    }
+
+    // the incoming flow of the nodes at the first timestep of the window,
+    // as decided by the previous window
+    node_var_map fixed;
+    vector<HypothesesGraph::Node> sub_nodes(g.maxNodeId() + 1, lemon::INVALID);
+    int start = earliest_timestep_;
+    while (true) {
+        const int end = std::min(start + static_cast<int>(window_length_) - 1, latest_timestep_);
+        const bool last = (end == latest_timestep_);
+        // nodes before next and arcs up to next are final after this window
+        const int next = last ? end + 1 : end - static_cast<int>(window_overlap_) + 1;
+        LOG(logINFO) << "ConservationTracking::infer_windows: timesteps [" << start << ", " << end << "]";
+
+        vector<HypothesesGraph::Node> nodes;
+        vector<HypothesesGraph::Arc> arcs;
+        for (std::map<int, vector<HypothesesGraph::Node> >::const_iterator t = nodes_at.lower_bound(start);
+                t != nodes_at.end() && t->first <= end; ++t) {
+            nodes.insert(nodes.end(), t->second.begin(), t->second.end());
+            for (vector<HypothesesGraph::Node>::const_iterator n = t->second.begin(); n != t->second.end(); ++n) {
+                for (HypothesesGraph::OutArcIt a(g, *n); a != lemon::INVALID; ++a) {
+                    if (timesteps[g.target(a)] <= end) {
+                        arcs.push_back(a);
+                    }
+                }
+            }
+        }
+
+        if (!nodes.empty()) {
+            Subproblem window;
+            window.copy(g, nodes, arcs, sub_nodes);
+            window.reasoner = boost::shared_ptr<ConservationTracking>(subproblem_reasoner(with_components_));
+            pass_starting_point(g, window);
+            // ends of tracks at the end of the window are not penalized
+            window.reasoner->latest_timestep_ = end;
+            for (node_var_map::const_iterator it = fixed.begin(); it != fixed.end(); ++it) {
+                window.reasoner->fixed_dis_states_[sub_nodes[g.id(it->first)]] = it->second;
+            }
+            window.reasoner->formulate(window.graph);
+            window.reasoner->infer();
+            window.reasoner->conclude(window.graph);
+            window_statistics_.add(window.reasoner->statistics());
+
+            const HypothesesGraph& w = window.graph;
+            property_map<node_active2, HypothesesGraph::base_graph>::type& active_nodes =
+                    window.graph.get(node_active2());
+            property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs =
+                    window.graph.get(arc_active());
+            property_map<division_active, HypothesesGraph::base_graph>::type& division_nodes =
+                    window.graph.get(division_active());
+            fixed.clear();
+            for (HypothesesGraph::NodeIt n(w); n != lemon::INVALID; ++n) {
+                const HypothesesGraph::Node node = window.nodes[w.id(n)];
+                if (timesteps[node] < next) {
+                    window_node_states_[g.id(node)] = active_nodes[n];
+                    window_division_states_[g.id(node)] = division_nodes[n];
+                } else if (timesteps[node] == next) {
+                    // a node with an active in arc has as many incoming
+                    // objects as it has objects
+                    bool has_active_in_arc = false;
+                    for (HypothesesGraph::InArcIt a(w, n); a != lemon::INVALID; ++a) {
+                        has_active_in_arc = has_active_in_arc || active_arcs[a];
+                    }
+                    fixed[node] = has_active_in_arc ? active_nodes[n] : 0;
+                }
+            }
+            for (HypothesesGraph::ArcIt a(w); a != lemon::INVALID; ++a) {
+                const HypothesesGraph::Arc arc = window.arcs[w.id(a)];
+                if (timesteps[g.target(arc)] <= next) {
+                    window_arc_states_[g.id(arc)] = active_arcs[a];
+                }
+            }
+        } else {
+            fixed.clear();
+        }
+
+        if (last) {
+            break;
+        }
+        start = next;
+    }
+}
+
+void ConservationTracking::infer_tiles() {
+    const HypothesesGraph& g = *windowed_graph_;
+    window_node_states_.assign(g.maxNodeId() + 1, 0);
+    window_arc_states_.assign(g.maxArcId() + 1, false);
+    window_division_states_.assign(g.maxNodeId() + 1, false);
+    window_statistics_ = SolverStatistics();
+    if (lemon::countNodes(g) == 0) {
+        return;
+    }
+
+    // positions of the nodes and the tiles spanning them
+    const NodeTraxels traxels(g);
+    vector<double> positions(3 * (g.maxNodeId() + 1), 0.);
+    double lower[3], upper[3];
+    bool first = true;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        const Traxel& trax = traxels[n];
+        double* x = &positions[3 * g.id(n)];
+        x[0] = trax.X();
+        x[1] = trax.Y();
+        x[2] = trax.Z();
+        for (int d = 0; d < 3; ++d) {
+            lower[d] = first ? x[d] : std::min(lower[d], x[d]);
+            upper[d] = first ? x[d] : std::max(upper[d], x[d]);
+        }
+        first = false;
+    }
+    TileAxis axes[3];
+    for (int d = 0; d < 3; ++d) {
+        axes[d] = TileAxis(lower[d], upper[d], tile_size_);
+    }
+    const size_t n_tiles = static_cast<size_t>(axes[0].count) * axes[1].count * axes[2].count;
+
+    // the tile of every node, whether it is in a seam, and the nodes of
+    // every tile including its halo (in NodeIt order)
+    vector<int> owner(g.maxNodeId() + 1, -1);
+    vector<char> in_seam(g.maxNodeId() + 1, 0);
+    vector<vector<HypothesesGraph::Node> > tile_nodes(n_tiles);
+    bool with_seam = false;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        const double* x = &positions[3 * g.id(n)];
+        int first_tile[3], last_tile[3];
+        for (int d = 0; d < 3; ++d) {
+            first_tile[d] = axes[d].clamped(x[d] - tile_halo_);
+            last_tile[d] = axes[d].clamped(x[d] + tile_halo_);
+            in_seam[g.id(n)] = in_seam[g.id(n)] || axes[d].near_border(x[d], tile_halo_ / 2);
+        }
+        owner[g.id(n)] = (axes[2].clamped(x[2]) * axes[1].count + axes[1].clamped(x[1])) * axes[0].count
+                + axes[0].clamped(x[0]);
+        with_seam = with_seam || in_seam[g.id(n)];
+        for (int k = first_tile[2]; k <= last_tile[2]; ++k) {
+            for (int j = first_tile[1]; j <= last_tile[1]; ++j) {
+                for (int i = first_tile[0]; i <= last_tile[0]; ++i) {
+                    tile_nodes[(k * axes[1].count + j) * axes[0].count + i].push_back(n);
+                }
+            }
+        }
+    }
+
+    // the tiles with nodes; their arcs are those between their nodes
+    vector<boost::shared_ptr<Subproblem> > tiles;
+    vector<int> tile_index;
+    {
+        vector<HypothesesGraph::Node> sub_nodes(g.maxNodeId() + 1, lemon::INVALID);
+        vector<size_t> member(g.maxNodeId() + 1, n_tiles);
+        for (size_t t = 0; t < n_tiles; ++t) {
+            if (tile_nodes[t].empty()) {
+                continue;
+            }
+            vector<HypothesesGraph::Arc> arcs;
+            const vector<HypothesesGraph::Node>& nodes = tile_nodes[t];
+            for (vector<HypothesesGraph::Node>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+                member[g.id(*n)] = t;
+            }
+            for (vector<HypothesesGraph::Node>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+                for (HypothesesGraph::OutArcIt a(g, *n); a != lemon::INVALID; ++a) {
+                    if (member[g.id(g.target(a))] == t) {
+                        arcs.push_back(a);
+                    }
+                }
+            }
+            boost::shared_ptr<Subproblem> tile(new Subproblem());
+            tile->copy(g, nodes, arcs, sub_nodes);
+            tile->reasoner = boost::shared_ptr<ConservationTracking>(subproblem_reasoner(with_components_));
+            pass_starting_point(g, *tile);
+            tiles.push_back(tile);
+            tile_index.push_back(static_cast<int>(t));
+            vector<HypothesesGraph::Node>().swap(tile_nodes[t]);
+        }
+    }
+    LOG(logINFO) << "ConservationTracking::infer_tiles: " << tiles.size() << " tiles of " << tile_size_
+                 << " with a halo of " << tile_halo_;
+
+    // the models are freed once their states are in the tile graphs
+    vector<SolverStatistics> tile_statistics(tiles.size());
+    string error;
+    #pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < static_cast<int>(tiles.size()); ++t) {
+        try {
+            Subproblem& tile = *tiles[t];
+            tile.reasoner->formulate(tile.graph);
+            tile.reasoner->infer();
+            tile.reasoner->conclude(tile.graph);
+            tile_statistics[t] = tile.reasoner->statistics();
+            tile.reasoner.reset();
+        } catch (std::exception& e) {
+            #pragma omp critical(pgmlink_constracking)
+            {
+                if (error.empty()) error = e.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+
+    // The owner tile decides its nodes outside of the seam and their arcs
+    // (by the source if both ends are outside of the seam). An arc between
+    // the seam and the rest is active only if the owners of both of its
+    // ends activated it: the owners of the seam node and of the other end
+    // each solved a consistent flow through their node, so the arcs kept
+    // at any node are a subset of the ones its owner chose. Otherwise two
+    // tiles could activate two out-arcs (or in-arcs) of one seam node,
+    // which the seam model cannot satisfy without a division or merger.
+    vector<char> decided(g.maxArcId() + 1, 0);
+    vector<char> seam_owner_active(g.maxArcId() + 1, 0);
+    for (size_t t = 0; t < tiles.size(); ++t) {
+        const Subproblem& tile = *tiles[t];
+        window_statistics_.add(tile_statistics[t]);
+        const HypothesesGraph& sub = tile.graph;
+        const property_map<node_active2, HypothesesGraph::base_graph>::type& active_nodes =
+                sub.get(node_active2());
+        const property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = sub.get(arc_active());
+        const property_map<division_active, HypothesesGraph::base_graph>::type& division_nodes =
+                sub.get(division_active());
+        for (HypothesesGraph::NodeIt n(sub); n != lemon::INVALID; ++n) {
+            const int id = g.id(tile.nodes[sub.id(n)]);
+            if (owner[id] == tile_index[t] && !in_seam[id]) {
+                window_node_states_[id] = active_nodes[n];
+                window_division_states_[id] = division_nodes[n];
+            }
+        }
+        for (HypothesesGraph::ArcIt a(sub); a != lemon::INVALID; ++a) {
+            const HypothesesGraph::Arc arc = tile.arcs[sub.id(a)];
+            const int source = g.id(g.source(arc));
+            const int target = g.id(g.target(arc));
+            if ((!in_seam[source] && owner[source] == tile_index[t])
+                    || (in_seam[source] && !in_seam[target] && owner[target] == tile_index[t])) {
+                window_arc_states_[g.id(arc)] = active_arcs[a];
+                decided[g.id(arc)] = 1;
+            }
+            if ((in_seam[source] && !in_seam[target] && owner[source] == tile_index[t])
+                    || (!in_seam[source] && in_seam[target] && owner[target] == tile_index[t])) {
+                seam_owner_active[g.id(arc)] = active_arcs[a];
+            }
+        }
+    }
+    tiles.clear();
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        if (in_seam[g.id(g.source(a))] != in_seam[g.id(g.target(a))] && !seam_owner_active[g.id(a)]) {
+            window_arc_states_[g.id(a)] = false;
+        }
+    }
+    size_t n_long = 0;
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        if (!decided[g.id(a)] && !(in_seam[g.id(g.source(a))] && in_seam[g.id(g.target(a))])) {
+            ++n_long;
+        }
+    }
+    if (n_long > 0) {
+        LOG(logWARNING) << "ConservationTracking::infer_tiles: " << n_long
+                        << " arcs between tiles are longer than the halo and inactive";
+    }
+    if (!with_seam) {
+        return;
+    }
+
+    // the seam with the nodes next to it, whose arcs to the seam are fixed
+    vector<char> in_model(in_seam);
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        const int source = g.id(g.source(a));
+        const int target = g.id(g.target(a));
+        if (in_seam[source] || in_seam[target]) {
+            in_model[source] = in_model[target] = 1;
+        }
+    }
+    vector<HypothesesGraph::Node> nodes;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        if (in_model[g.id(n)]) {
+            nodes.push_back(n);
+        }
+    }
+    vector<HypothesesGraph::Arc> arcs;
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        if (in_seam[g.id(g.source(a))] || in_seam[g.id(g.target(a))]) {
+            arcs.push_back(a);
+        }
+    }
+    Subproblem seam;
+    vector<HypothesesGraph::Node> sub_nodes(g.maxNodeId() + 1, lemon::INVALID);
+    seam.copy(g, nodes, arcs, sub_nodes);
+    // the fixed arcs must not vanish in tracklets; the seam falls apart
+    // into many small components
+    seam.reasoner = boost::shared_ptr<ConservationTracking>(subproblem_reasoner(true));
+    seam.reasoner->with_tracklets_ = false;
+    pass_starting_point(g, seam);
+    for (HypothesesGraph::ArcIt a(seam.graph); a != lemon::INVALID; ++a) {
+        const HypothesesGraph::Arc arc = seam.arcs[seam.graph.id(a)];
+        if (!in_seam[g.id(g.source(arc))] || !in_seam[g.id(g.target(arc))]) {
+            seam.reasoner->fixed_arc_states_[a] = window_arc_states_[g.id(arc)] ? 1 : 0;
+        }
+    }
+    LOG(logINFO) << "ConservationTracking::infer_tiles: seam of "
+                 << std::count(in_seam.begin(), in_seam.end(), 1) << " nodes";
+    seam.reasoner->formulate(seam.graph);
+    seam.reasoner->infer();
+    seam.reasoner->conclude(seam.graph);
+    window_statistics_.add(seam.reasoner->statistics());
+
+    const HypothesesGraph& sub = seam.graph;
+    const property_map<node_active2, HypothesesGraph::base_graph>::type& active_nodes =
+            sub.get(node_active2());
+    const property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = sub.get(arc_active());
+    const property_map<division_active, HypothesesGraph::base_graph>::type& division_nodes =
+            sub.get(division_active());
+    for (HypothesesGraph::NodeIt n(sub); n != lemon::INVALID; ++n) {
+        const int id = g.id(seam.nodes[sub.id(n)]);
+        if (in_seam[id]) {
+            window_node_states_[id] = active_nodes[n];
+            window_division_states_[id] = division_nodes[n];
+        }
+    }
+    for (HypothesesGraph::ArcIt a(sub); a != lemon::INVALID; ++a) {
+        const HypothesesGraph::Arc arc = seam.arcs[sub.id(a)];
+        if (in_seam[g.id(g.source(arc))] && in_seam[g.id(g.target(arc))]) {
+            window_arc_states_[g.id(arc)] = active_arcs[a];
+        }
+    }
+}
+
+void ConservationTracking::set_starting_point(const HypothesesGraph& solved) {
+    const bool with_counts = solved.has_property(node_active2());
+    if (!(with_counts || solved.has_property(node_active())) || !solved.has_property(arc_active())) {
+        throw runtime_error("ConservationTracking::set_starting_point(): node_active2 or node_active and arc_active required");
+    }
+    start_node_states_.assign(solved.maxNodeId() + 1, 0);
+    start_arc_flows_.assign(solved.maxArcId() + 1, 0);
+    start_division_states_.assign(solved.maxNodeId() + 1, false);
+
+    for (HypothesesGraph::NodeIt n(solved); n != lemon::INVALID; ++n) {
+        if (with_counts) {
+            start_node_states_[solved.id(n)] = solved.get(node_active2())[n];
+        } else {
+            start_node_states_[solved.id(n)] = solved.get(node_active())[n] ? 1 : 0;
+        }
+        if (solved.has_property(division_active())) {
+            start_division_states_[solved.id(n)] = solved.get(division_active())[n];
+        }
+    }
+    const property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = solved.get(arc_active());
+    for (HypothesesGraph::ArcIt a(solved); a != lemon::INVALID; ++a) {
+        if (active_arcs[a]) {
+            start_arc_flows_[solved.id(a)] = std::min(start_node_states_[solved.id(solved.source(a))],
+                                                      start_node_states_[solved.id(solved.target(a))]);
+        }
+    }
+}
+
+void ConservationTracking::set_greedy_starting_point(const HypothesesGraph& g) {
+    start_node_states_.assign(g.maxNodeId() + 1, 0);
+    start_arc_flows_.assign(g.maxArcId() + 1, 0);
+    start_division_states_.assign(g.maxNodeId() + 1, false);
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        start_node_states_[g.id(n)] = 1;
+    }
+
+    // (distance, arc id), nearest first
+    const property_map<arc_distance, HypothesesGraph::base_graph>::type& distances = g.get(arc_distance());
+    vector<std::pair<double, int> > arcs;
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        arcs.push_back(std::make_pair(distances[a], g.id(a)));
+    }
+    std::sort(arcs.begin(), arcs.end());
+
+    vector<bool> has_out_arc(g.maxNodeId() + 1, false);
+    vector<bool> has_in_arc(g.maxNodeId() + 1, false);
+    for (vector<std::pair<double, int> >::const_iterator it = arcs.begin(); it != arcs.end(); ++it) {
+        const HypothesesGraph::Arc a = g.arcFromId(it->second);
+        const int source = g.id(g.source(a));
+        const int target = g.id(g.target(a));
+        if (!has_out_arc[source] && !has_in_arc[target]) {
+            start_arc_flows_[it->second] = 1;
+            has_out_arc[source] = true;
+            has_in_arc[target] = true;
+        }
+    }
+    LOG(logDEBUG) << "ConservationTracking::set_greedy_starting_point: "
+                  << std::count(has_out_arc.begin(), has_out_arc.end(), true) << " of " << arcs.size() << " arcs";
+}
+
+void ConservationTracking::clear_starting_point() {
+    start_node_states_.clear();
+    start_arc_flows_.clear();
+    start_division_states_.clear();
+}
+
+void ConservationTracking::pass_starting_point(const HypothesesGraph& g, Subproblem& sub) const {
+    if (start_node_states_.empty()) {
+        return;
+    }
+    ConservationTracking& reasoner = *sub.reasoner;
+    reasoner.start_node_states_.assign(sub.nodes.size(), 0);
+    reasoner.start_division_states_.assign(sub.nodes.size(), false);
+    for (size_t i = 0; i < sub.nodes.size(); ++i) {
+        if (sub.nodes[i] != lemon::INVALID && static_cast<size_t>(g.id(sub.nodes[i])) < start_node_states_.size()) {
+            reasoner.start_node_states_[i] = start_node_states_[g.id(sub.nodes[i])];
+            reasoner.start_division_states_[i] = start_division_states_[g.id(sub.nodes[i])];
+        }
+    }
+    reasoner.start_arc_flows_.assign(sub.arcs.size(), 0);
+    for (size_t k = 0; k < sub.arcs.size(); ++k) {
+        if (sub.arcs[k] != lemon::INVALID && static_cast<size_t>(g.id(sub.arcs[k])) < start_arc_flows_.size()) {
+            reasoner.start_arc_flows_[k] = start_arc_flows_[g.id(sub.arcs[k])];
+        }
+    }
+}
+
+namespace {
+size_t state_at(const vector<size_t>& states, int id) {
+    return static_cast<size_t>(id) < states.size() ? states[id] : 0;
+}
+}
+
+void ConservationTracking::add_starting_labels(const HypothesesGraph& hypotheses) {
+    starting_labels_.assign(pgm_->Model()->numberOfVariables(), 0);
+    const HypothesesGraph& g = with_tracklets_ ? tracklet_graph_ : hypotheses;
+
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        HypothesesGraph::Node first = n;
+        HypothesesGraph::Node last = n;
+        if (with_tracklets_) {
+            const std::vector<HypothesesGraph::Node>& traxel_nodes = tracklet2traxel_node_map_[n];
+            first = traxel_nodes.front();
+            last = traxel_nodes.back();
+        }
+        size_t in = 0;
+        for (HypothesesGraph::InArcIt a(hypotheses, first); a != lemon::INVALID; ++a) {
+            in += state_at(start_arc_flows_, hypotheses.id(a));
+        }
+        size_t out = 0;
+        for (HypothesesGraph::OutArcIt a(hypotheses, last); a != lemon::INVALID; ++a) {
+            out += state_at(start_arc_flows_, hypotheses.id(a));
+        }
+
+        size_t division = 0;
+        if (div_node_map_.count(n) > 0) {
+            const size_t id = hypotheses.id(last);
+            division = (id < start_division_states_.size() && start_division_states_[id]) ? 1 : 0;
+            starting_labels_[div_node_map_[n]] = division;
+        }
+        // sum(Y_ij) = D_i + App_i and sum_k(Y_kj) = Dis_j; a detection
+        // without active arcs appears
+        size_t app = 0;
+        if (out > 0) {
+            app = out > division ? out - division : 0;
+        } else if (in == 0) {
+            app = state_at(start_node_states_, hypotheses.id(first));
+        }
+        starting_labels_[app_node_map_[n]] = std::min<size_t>(app, max_number_objects_);
+        starting_labels_[dis_node_map_[n]] = std::min<size_t>(in, max_number_objects_);
+    }
+
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        const int id = with_tracklets_ ? tracklet_graph_.get(traxel_arc_id())[a] : g.id(a);
+        starting_labels_[arc_map_[a]] = std::min<size_t>(state_at(start_arc_flows_, id), max_number_objects_);
+    }
+}
+
+const ConservationTracking::arc_var_map& ConservationTracking::get_arc_map() const {
     return arc_map_;
 }
 
@@ -241,6 +1192,13 @@ void ConservationTracking::reset() {
     div_node_map_.clear();
     app_node_map_.clear();
     dis_node_map_.clear();
+    components_.clear();
+    windowed_graph_ = NULL;
+    starting_labels_.clear();
+    energy_functions_.clear();
+    number_of_constraints_ = 0;
+    constraints_seconds_ = 0;
+    solved_ = false;
 }
 
 void ConservationTracking::add_appearance_nodes(const HypothesesGraph& g) {
@@ -294,96 +1252,236 @@ void ConservationTracking::add_division_nodes(const HypothesesGraph& g) {
 }
 
 namespace {
-double get_transition_prob(double distance, size_t state, double alpha) {
-    double prob = exp(-distance / alpha);
-    if (state == 0) {
-        return 1 - prob;
+// The energy functions are evaluated through these overloads. The generic
+// ones call the function once per state; the ones for the built-in functors
+// read their probability feature once per traxel, through the slot of the
+// reader.
+double neg_ln(double weight, double arg) {
+    if (arg < 0.0000000001) arg = 0.0000000001;
+    return weight * -1 * log(arg);
+}
+
+template <class Detection>
+void add_detection_energies(const Detection& detection, const FeatureReader&, const Traxel& trax,
+                            size_t count_states, double* energies) {
+    for (size_t state = 0; state < count_states; ++state) {
+        energies[state] += detection(trax, state);
+    }
+}
+
+void add_detection_energies(const NegLnDetection& detection, const FeatureReader& det_prob, const Traxel& trax,
+                            size_t count_states, double* energies) {
+    size_t size;
+    const feature_type* prob = det_prob(trax, size);
+    if (!prob) {
+        throw runtime_error("get_detection_prob(): detProb feature not in traxel");
+    }
+    if (size < count_states) {
+        throw runtime_error("get_detection_prob(): detProb feature has fewer values than states");
+    }
+    for (size_t state = 0; state < count_states; ++state) {
+        energies[state] += neg_ln(detection.weight(), prob[state]);
     }
-    return prob;
 }
+
+template <class Division>
+void division_energies(const Division& division, const FeatureReader&, const Traxel& trax, double* energies) {
+    for (size_t state = 0; state <= 1; ++state) {
+        energies[state] = division(trax, state);
+    }
 }
 
-void ConservationTracking::add_finite_factors(const HypothesesGraph& g) {
-    LOG(logDEBUG) << "ConservationTracking::add_finite_factors: entered";
-    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g.get(node_traxel());
+void division_energies(const NegLnDivision& division, const FeatureReader& div_prob_reader, const Traxel& trax,
+                       double* energies) {
+    size_t size;
+    const feature_type* prob = div_prob_reader(trax, size);
+    if (!prob) {
+        throw runtime_error("get_division_prob(): divProb feature not in traxel");
+    }
+    const double div_prob = prob[0];
+    energies[0] = neg_ln(division.weight(), 1 - div_prob);
+    energies[1] = neg_ln(division.weight(), div_prob);
+}
+
+// the probability of state 0 is 1 - exp(-distance / alpha), the one of all
+// other states exp(-distance / alpha)
+template <class Transition>
+void add_transition_energies(const Transition& transition, double distance, double alpha,
+                             size_t count_states, double* energies) {
+    const double prob = exp(-distance / alpha);
+    for (size_t state = 0; state < count_states; ++state) {
+        energies[state] += transition(state == 0 ? 1 - prob : prob);
+    }
+}
+}
+
+void ConservationTracking::compute_energies(const HypothesesGraph& g) {
+    // static dispatch for the functors ConsTracking passes; any other
+    // function, e.g. one from Python, is called through boost::function
+    const NegLnDetection* detection = detection_.target<NegLnDetection>();
+    const NegLnDivision* division = division_.target<NegLnDivision>();
+    const NegLnTransition* transition = transition_.target<NegLnTransition>();
+    if (detection && division && transition) {
+        LOG(logDEBUG) << "ConservationTracking::compute_energies: built-in energy functions";
+        compute_energies(g, *detection, *division, *transition);
+    } else if (division && transition) {
+        LOG(logDEBUG) << "ConservationTracking::compute_energies: built-in division and transition energies";
+        compute_energies(g, detection_, *division, *transition);
+    } else {
+        compute_energies(g, detection_, division_, transition_);
+    }
+}
+
+template <class Detection, class Division, class Transition>
+void ConservationTracking::compute_energies(const HypothesesGraph& g,
+                                            const Detection& detection,
+                                            const Division& division,
+                                            const Transition& transition) {
+    LOG(logDEBUG) << "ConservationTracking::compute_energies: entered";
+    const NodeTraxels traxel_map(g);
     property_map<node_tracklet, HypothesesGraph::base_graph>::type& tracklet_map =
             g.get(node_tracklet());
     property_map<tracklet_intern_dist, HypothesesGraph::base_graph>::type& tracklet_intern_dist_map =
             g.get(tracklet_intern_dist());
+    property_map<arc_distance, HypothesesGraph::base_graph>::type& arc_distances = g.get(
+            arc_distance());
+
+    const size_t count_states = max_number_objects_ + 1;
+    detection_energies_.assign(count_states * (g.maxNodeId() + 1), 0.);
+    division_energies_.assign(2 * (g.maxNodeId() + 1), 0.);
+    appearance_costs_.assign(g.maxNodeId() + 1, 0.);
+    disappearance_costs_.assign(g.maxNodeId() + 1, 0.);
+    transition_energies_.assign(count_states * (g.maxArcId() + 1), 0.);
+
+    vector<HypothesesGraph::Node> nodes;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        nodes.push_back(n);
+    }
+    vector<HypothesesGraph::Arc> arcs;
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        arcs.push_back(a);
+    }
+
+    // the traxels of the graph are usually interned with one schema
+    boost::shared_ptr<FeatureSchema> schema;
+    if (!nodes.empty()) {
+        schema = with_tracklets_ ? tracklet_map[nodes[0]].front().feature_schema()
+                                 : traxel_map[nodes[0]].feature_schema();
+    }
+    const FeatureReader det_prob("detProb", schema), div_prob("divProb", schema);
+
+    // every entry is written by one iteration only
+    string error;
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+        try {
+            const HypothesesGraph::Node n = nodes[i];
+            const int id = g.id(n);
+            const Traxel& first = with_tracklets_ ? tracklet_map[n].front() : traxel_map[n];
+            const Traxel& last = with_tracklets_ ? tracklet_map[n].back() : traxel_map[n];
+
+            // "<" holds if there are only tracklets in the first frame
+            if (first.Timestep > earliest_timestep_) {
+                appearance_costs_[id] = appearance_cost_(first);
+            }
+            // ">" holds if there are only tracklets in the last frame
+            if (last.Timestep < latest_timestep_) {
+                disappearance_costs_[id] = disappearance_cost_(last);
+            }
+
+            double* energies = &detection_energies_[id * count_states];
+            if (with_tracklets_) {
+                // add all detection factors of the internal nodes
+                for (std::vector<Traxel>::const_iterator trax_it = tracklet_map[n].begin();
+                        trax_it != tracklet_map[n].end(); ++trax_it) {
+                    add_detection_energies(detection, det_prob, *trax_it, count_states, energies);
+                }
+                // add all transition factors of the internal arcs
+                for (std::vector<double>::const_iterator intern_dist_it =
+                        tracklet_intern_dist_map[n].begin();
+                        intern_dist_it != tracklet_intern_dist_map[n].end(); ++intern_dist_it) {
+                    add_transition_energies(transition, *intern_dist_it, transition_parameter_,
+                                            count_states, energies);
+                }
+            } else {
+                add_detection_energies(detection, det_prob, traxel_map[n], count_states, energies);
+            }
+
+            if (with_divisions_ && div_node_map_.count(n) != 0) {
+                division_energies(division, div_prob, last, &division_energies_[2 * id]);
+            }
+        } catch (std::exception& e) {
+            #pragma omp critical(pgmlink_constracking)
+            {
+                if (error.empty()) error = e.what();
+            }
+        }
+    }
+
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < static_cast<int>(arcs.size()); ++i) {
+        try {
+            const int id = g.id(arcs[i]);
+            add_transition_energies(transition, arc_distances[arcs[i]], transition_parameter_,
+                                    count_states, &transition_energies_[id * count_states]);
+        } catch (std::exception& e) {
+            #pragma omp critical(pgmlink_constracking)
+            {
+                if (error.empty()) error = e.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+}
+
+void ConservationTracking::add_finite_factors(const HypothesesGraph& g) {
+    PGMLINK_TIMED_SCOPE("ConservationTracking::add_finite_factors");
+    LOG(logDEBUG) << "ConservationTracking::add_finite_factors: entered";
+    // reweight() refills the factors a previous call has added
+    const bool refill = !energy_functions_.empty();
+    next_energy_function_ = 0;
+    const size_t count_states = max_number_objects_ + 1;
+
+    // the factors are added in the order of the flat snapshot, which is the
+    // same for formulate() and reweight() of one graph
+    const HypothesesGraphSnapshot snapshot(g);
+    vector<size_t> arc_vars(snapshot.arc_count());
+    for (size_t k = 0; k < snapshot.arc_count(); ++k) {
+        arc_vars[k] = arc_map_[snapshot.arc(k)];
+    }
 
     ////
     //// add detection factors
     ////
     LOG(logDEBUG) << "ConservationTracking::add_finite_factors: add detection factors";
-    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+    for (size_t i = 0; i < snapshot.node_count(); ++i) {
+        const HypothesesGraph::Node n = snapshot.node(i);
+        const int id = g.id(n);
         size_t num_vars = 0;
         vector<size_t> vi;
         vector<double> cost;
 
-        int node_begin_time = -1;
-        int node_end_time = -1;
-        if (with_tracklets_) {
-            node_begin_time = tracklet_map[n].front().Timestep;
-            node_end_time = tracklet_map[n].back().Timestep;
-        } else {
-            node_begin_time = traxel_map[n].Timestep;
-            node_end_time = traxel_map[n].Timestep;
-        }
-
         if (app_node_map_.count(n) > 0) {
             vi.push_back(app_node_map_[n]);
-            if (node_begin_time <= g.earliest_timestep()) {  // "<" holds if there are only tracklets in the first frame
-                // pay no appearance costs in the first timestep
-                cost.push_back(0.);
-            } else {
-                if (with_tracklets_) {
-                    cost.push_back(appearance_cost_(tracklet_map[n].front()));
-                    LOG(logDEBUG4) << "App-costs 1: " << appearance_cost_(tracklet_map[n].front()) << ", " << tracklet_map[n].front();
-                } else {
-                    cost.push_back(appearance_cost_(traxel_map[n]));
-                    LOG(logDEBUG4) << "App-costs 2: " << appearance_cost_(traxel_map[n]) << ", " << traxel_map[n];
-                }
-            }
+            cost.push_back(appearance_costs_[id]);
             ++num_vars;
         }
         if (dis_node_map_.count(n) > 0) {
             vi.push_back(dis_node_map_[n]);
-            double c = 0;
-            if (node_end_time < g.latest_timestep()) { // "<" holds if there are only tracklets in the last frame
-                if (with_tracklets_) {
-                    c += disappearance_cost_(tracklet_map[n].back());
-                    LOG(logDEBUG4) << "Disapp-costs 1: " << disappearance_cost_(tracklet_map[n].back()) << ", " << tracklet_map[n].back();
-                } else {
-                    c += disappearance_cost_(traxel_map[n]);
-                    LOG(logDEBUG4) << "Disapp-costs 2: " << disappearance_cost_(traxel_map[n]) << ", " << traxel_map[n];
-                }
-            }
-            cost.push_back(c);
+            cost.push_back(disappearance_costs_[id]);
             ++num_vars;
         }
+        LOG(logDEBUG4) << "ConservationTracking::add_finite_factors: appearance/disappearance costs "
+                << appearance_costs_[id] << ", " << disappearance_costs_[id];
 
         // convert vector to array
         vector<size_t> coords(num_vars, 0); // number of variables
         // ITER first_ogm_idx, ITER last_ogm_idx, VALUE init, size_t states_per_var
-        pgm::OpengmExplicitFactor<double> table(vi.begin(), vi.end(), forbidden_cost_, (max_number_objects_ + 1));
+        pgm::OpengmExplicitFactor<double> table(vi.begin(), vi.end(), forbidden_cost_, count_states);
         for (size_t state = 0; state <= max_number_objects_; ++state) {
-            double energy = 0;
-            if (with_tracklets_) {
-                // add all detection factors of the internal nodes
-                for (std::vector<Traxel>::const_iterator trax_it = tracklet_map[n].begin();
-                        trax_it != tracklet_map[n].end(); ++trax_it) {
-                    energy += detection_(*trax_it, state);
-                }
-                // add all transition factors of the internal arcs
-                for (std::vector<double>::const_iterator intern_dist_it =
-                        tracklet_intern_dist_map[n].begin();
-                        intern_dist_it != tracklet_intern_dist_map[n].end(); ++intern_dist_it) {
-                    energy += transition_(
-                            get_transition_prob(*intern_dist_it, state, transition_parameter_));
-                }
-            } else {
-                energy = detection_(traxel_map[n], state);
-            }
+            const double energy = detection_energies_[id * count_states + state];
             LOG(logDEBUG2) << "ConservationTracking::add_finite_factors: detection[" << state
                     << "] = " << energy;
             for (size_t var_idx = 0; var_idx < num_vars; ++var_idx) {
@@ -411,29 +1509,28 @@ void ConservationTracking::add_finite_factors(const HypothesesGraph& g) {
         }
 
         LOG(logDEBUG3) << "ConservationTracking::add_finite_factors: adding table to pgm";
-        table.add_to(*(pgm_->Model()));
+        add_energy_table(table);
     }
 
     ////
     //// add transition factors
     ////
     LOG(logDEBUG) << "ConservationTracking::add_finite_factors: add transition factors";
-    property_map<arc_distance, HypothesesGraph::base_graph>::type& arc_distances = g.get(
-            arc_distance());
-    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
-        size_t vi[] = { arc_map_[a] };
+    for (size_t k = 0; k < snapshot.arc_count(); ++k) {
+        size_t vi[] = { arc_vars[k] };
+        const int id = g.id(snapshot.arc(k));
         vector<size_t> coords(1, 0); // number of variables
         // ITER first_ogm_idx, ITER last_ogm_idx, VALUE init, size_t states_per_var
-        pgm::OpengmExplicitFactor<double> table(vi, vi + 1, forbidden_cost_, (max_number_objects_ + 1));
+        pgm::OpengmExplicitFactor<double> table(vi, vi + 1, forbidden_cost_, count_states);
         for (size_t state = 0; state <= max_number_objects_; ++state) {
-            double energy = transition_(get_transition_prob(arc_distances[a], state, transition_parameter_));
+            const double energy = transition_energies_[id * count_states + state];
             LOG(logDEBUG2) << "ConservationTracking::add_finite_factors: transition[" << state
                     << "] = " << energy;
             coords[0] = state;
             table.set_value(coords, energy);
             coords[0] = 0;
         }
-        table.add_to(*(pgm_->Model()));
+        add_energy_table(table);
     }
 
     ////
@@ -441,7 +1538,8 @@ void ConservationTracking::add_finite_factors(const HypothesesGraph& g) {
     ////
     if (with_divisions_) {
         LOG(logDEBUG) << "ConservationTracking::add_finite_factors: add division factors";
-        for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        for (size_t i = 0; i < snapshot.node_count(); ++i) {
+            const HypothesesGraph::Node n = snapshot.node(i);
             if (div_node_map_.count(n) == 0) {
                 continue;
             }
@@ -450,158 +1548,181 @@ void ConservationTracking::add_finite_factors(const HypothesesGraph& g) {
             // ITER first_ogm_idx, ITER last_ogm_idx, VALUE init, size_t states_per_var
             pgm::OpengmExplicitFactor<double> table(vi, vi + 1, forbidden_cost_, 2);
             for (size_t state = 0; state <= 1; ++state) {
-                double energy = 0;
-                if (with_tracklets_) {
-                    energy = division_(tracklet_map[n].back(), state);
-                } else {
-                    energy = division_(traxel_map[n], state);
-                }
+                const double energy = division_energies_[2 * g.id(n) + state];
                 LOG(logDEBUG2) << "ConservationTracking::add_finite_factors: division[" << state
                         << "] = " << energy;
                 coords[0] = state;
                 table.set_value(coords, energy);
                 coords[0] = 0;
             }
-            table.add_to(*(pgm_->Model()));
+            add_energy_table(table);
         }
     }
 
+    if (!refill) {
+        PGMLINK_COUNT("ConservationTracking: factors created", pgm_->Model()->numberOfFactors());
+    }
+}
 
-    if (!with_constraints_) {
-    	for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
-			LOG(logDEBUG) << "ConservationTracking::add_finite_factors: add soft-constraints for outgoing";
-
-			// collect and count outgoing arcs
-			  std::vector<HypothesesGraph::Arc> arcs;
-			  std::vector<size_t> vi;
-			  std::vector<size_t> states_vars;
-			  states_vars.push_back(max_number_objects_+1);
-			  vi.push_back(app_node_map_[n]); // first detection node, remaining will be transition nodes
-			  bool has_div_node = false;
-			  if (with_divisions_ && div_node_map_.count(n) != 0) {
-				  vi.push_back(div_node_map_[n]);
-				  has_div_node = true;
-				  states_vars.push_back(2);
-			  }
-
-			  int count = 0;
-			  //int trans_idx = vi.size();
-			  for(HypothesesGraph::OutArcIt a(g, n); a != lemon::INVALID; ++a) {
-				  arcs.push_back(a);
-				  vi.push_back(arc_map_[a]);
-				  states_vars.push_back(max_number_objects_+1);
-				  ++count;
-			  }
-
-			  // construct factor
-			  // build value table
-			  if (count != 0) {
-				  //size_t table_dim = count + 1 + int(has_div_node); 		// n * transition var + detection var (+ division var)
-				  std::vector<size_t> coords;
-				  // ITER first_ogm_idx, ITER last_ogm_idx, VALUE init, size_t states_vars
-				  pgm::OpengmExplicitFactor<double> table( vi.begin(), vi.end(), 0, states_vars);
-
-				  //assert(table_dim - trans_idx == count);
-
-				  ////
-				  //// TODO: set the forbidden configurations to infinity or the allowed to zero
-				  ////
-              if (has_div_node) {
-                    // TODO
-              }
-              
-				  table.add_to(*(pgm_->Model()));
-			  }
-
-
-
-			  LOG(logDEBUG) << "ConservationTracking::add_finite_factors: add soft-constraints for incomfing";
-			  // collect and count incoming arcs
-			  arcs.clear();
-			  vi.clear();
-			  states_vars.clear();
-			  states_vars.push_back(max_number_objects_+1);
-			  vi.push_back(dis_node_map_[n]); // first detection node, remaining will be transition nodes
-
-			  count = 0;
-			  for(HypothesesGraph::InArcIt a(g, n); a != lemon::INVALID; ++a) {
-				  arcs.push_back(a);
-				  vi.push_back(arc_map_[a]);
-				  states_vars.push_back(max_number_objects_+1);
-				  ++count;
-			  }
-			  if (count != 0) {
-				  // construct factor
-				  // build value table
-				  //size_t table_dim = count + 1; 		// n * transition var + detection var
-				  std::vector<size_t> coords;
-				  // ITER first_ogm_idx, ITER last_ogm_idx, VALUE init, size_t states_vars
-				  pgm::OpengmExplicitFactor<double> table( vi.begin(), vi.end(), 0, states_vars);
-
-				  //assert(table_dim - trans_idx == count);
-
-				  ////
-				  //// TODO: set the forbidden configurations to infinity or the allowed to zero
-				  /////
-
-				  table.add_to(*(pgm_->Model()));
-			  }
-    	}
+void ConservationTracking::add_energy_table(const pgm::OpengmExplicitFactor<double>& table) {
+    pgm::OpengmModelDeprecated::ogmGraphicalModel& model = *(pgm_->Model());
+    if (next_energy_function_ < energy_functions_.size()) {
+        pgm::OpengmModelDeprecated::ExplicitFunctionType& f =
+                model.getFunction<pgm::OpengmModelDeprecated::ExplicitFunctionType>(
+                        energy_functions_[next_energy_function_]);
+        assert(f.size() == table.function().size());
+        std::copy(table.function().begin(), table.function().end(), f.begin());
+    } else {
+        vector<size_t> sorted_vi(table.var_indices());
+        std::sort(sorted_vi.begin(), sorted_vi.end());
+        // opengm expects a monotonic increasing sequence
+        if (!model.isValidIndexSequence(sorted_vi.begin(), sorted_vi.end())) {
+            throw runtime_error("ConservationTracking::add_energy_table(): invalid index sequence");
+        }
+        pgm::OpengmModelDeprecated::FunctionIdentifier id = model.addFunction(table.function());
+        model.addFactor(id, sorted_vi.begin(), sorted_vi.end());
+        energy_functions_.push_back(id);
+    }
+    ++next_energy_function_;
+}
 
+void ConservationTracking::set_progress_callback(SolverProgressCallback callback, double interval_seconds) {
+    if (interval_seconds <= 0) {
+        throw std::invalid_argument("ConservationTracking::set_progress_callback(): interval_seconds has to be positive");
     }
+    progress_callback_ = callback;
+    progress_interval_ = interval_seconds;
+}
+
+bool ConservationTracking::report_progress(double seconds, double objective, double bound) {
+    bool go_on = false;
+    #pragma omp critical(pgmlink_constracking_progress)
+    {
+        if (!*stop_requested_) {
+            *stop_requested_ = !progress_callback_(seconds, objective, bound);
+        }
+        go_on = !*stop_requested_;
+    }
+    return go_on;
 }
 
 size_t ConservationTracking::cplex_id(size_t opengm_id, size_t state) {
     return optimizer_->lpNodeVi(opengm_id, state);
 }
 
+namespace {
+// constraints in compressed sparse row layout: the entries of row r are
+// [offsets_[r], offsets_[r+1]); submitted to the solver in one pass. The
+// rows live in arena until they are submitted
+class ConstraintRows {
+public:
+    ConstraintRows(bool with_names, Arena& arena)
+        : offsets_(1, size_t(0), ArenaAllocator<size_t>(arena)),
+          variables_(ArenaAllocator<size_t>(arena)),
+          coefficients_(ArenaAllocator<int>(arena)),
+          lower_(ArenaAllocator<int>(arena)),
+          upper_(ArenaAllocator<int>(arena)),
+          with_names_(with_names) {}
+
+    bool with_names() const { return with_names_; }
+    size_t size() const { return lower_.size(); }
+
+    void add(size_t variable, int coefficient) {
+        variables_.push_back(variable);
+        coefficients_.push_back(coefficient);
+    }
+
+    // closes the current row with lower <= sum <= upper
+    void close(int lower, int upper, const std::stringstream& name) {
+        offsets_.push_back(variables_.size());
+        lower_.push_back(lower);
+        upper_.push_back(upper);
+        if (with_names_) {
+            names_.push_back(name.str());
+            LOG(logDEBUG3) << names_.back();
+        }
+    }
+
+    template<typename Optimizer>
+    void submit(Optimizer& optimizer) const {
+        for (size_t r = 0; r < size(); ++r) {
+            optimizer.addConstraint(variables_.begin() + offsets_[r], variables_.begin() + offsets_[r + 1],
+                    coefficients_.begin() + offsets_[r], lower_[r], upper_[r],
+                    with_names_ ? names_[r].c_str() : "");
+        }
+    }
+
+private:
+    arena_vector<size_t>::type offsets_;
+    arena_vector<size_t>::type variables_;
+    arena_vector<int>::type coefficients_;
+    arena_vector<int>::type lower_, upper_;
+    std::vector<std::string> names_;
+    bool with_names_;
+};
+}
+
 void ConservationTracking::add_constraints(const HypothesesGraph& g) {
+    PGMLINK_TIMED_SCOPE("ConservationTracking::add_constraints");
     size_t counter = 0;
     LOG(logDEBUG) << "ConservationTracking::add_constraints: entered";
-    //typedef opengm::LPCplex<pgm::OpengmModelDeprecated::ogmGraphicalModel,
-    //        pgm::OpengmModelDeprecated::ogmAccumulator> cplex;
 
     property_map<node_tracklet, HypothesesGraph::base_graph>::type& tracklet_map = g.get(
             node_tracklet());
 
+    // the rows and index vectors are freed together when the constraints
+    // are submitted; the memory stays with the thread for the next model
+    const ArenaScope scope(Arena::for_this_thread());
+    const ArenaAllocator<size_t> index_allocator(scope.arena());
+
+    // names are only formatted if requested
+    ConstraintRows rows(with_constraint_names_, scope.arena());
     std::stringstream constraint_name;
+    std::string traxel_names;
+
+    // the constraints are added in the order of the lemon iterators, but
+    // the adjacency is walked in the flat snapshot
+    const HypothesesGraphSnapshot snapshot(g);
+    arena_vector<size_t>::type arc_vars(snapshot.arc_count(), 0, index_allocator);
+    for (size_t k = 0; k < snapshot.arc_count(); ++k) {
+        arc_vars[k] = arc_map_[snapshot.arc(k)];
+    }
+    // the division row is collected while other rows are added
+    arena_vector<size_t>::type division_vars(index_allocator);
+    arena_vector<int>::type division_coeffs((ArenaAllocator<int>(index_allocator)));
 
     LOG(logDEBUG) << "ConservationTracking::add_constraints: transitions";
-    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
-        std::stringstream traxel_names_ss;
-        for (std::vector<Traxel>::const_iterator trax_it = tracklet_map[n].begin();
-                trax_it != tracklet_map[n].end(); ++trax_it) {
-            traxel_names_ss << trax_it->Id << "." << trax_it->Timestep << " ";
+    for (size_t i = 0; i < snapshot.node_count(); ++i) {
+        const HypothesesGraph::Node n = snapshot.node(i);
+        if (rows.with_names()) {
+            std::stringstream traxel_names_ss;
+            for (std::vector<Traxel>::const_iterator trax_it = tracklet_map[n].begin();
+                    trax_it != tracklet_map[n].end(); ++trax_it) {
+                traxel_names_ss << trax_it->Id << "." << trax_it->Timestep << " ";
+            }
+            traxel_names = traxel_names_ss.str();
         }
-        std::string traxel_names = traxel_names_ss.str();
-
-        vector<size_t> cplex_idxs, cplex_idxs2;
-        vector<int> coeffs, coeffs2;
 
         ////
         //// outgoing transitions
         ////
         size_t num_outarcs = 0;
         // couple detection and transitions: Y_ij <= App_i
-        for (HypothesesGraph::OutArcIt a(g, n); a != lemon::INVALID; ++a) {
+        for (size_t a = snapshot.out_begin(i); a != snapshot.out_end(i); ++a) {
             assert(app_node_map_.count(n) > 0
                     && "this node should be contained in app_node_map_ since it has outgoing arcs");
             for (size_t nu = 0; nu < max_number_objects_; ++nu) {
                 for (size_t mu = nu + 1; mu <= max_number_objects_; ++mu) {
-                    cplex_idxs.clear();
-                    coeffs.clear();
-                    coeffs.push_back(1);
-                    cplex_idxs.push_back(cplex_id(app_node_map_[n], nu));
-                    coeffs.push_back(1);
-                    cplex_idxs.push_back(cplex_id(arc_map_[a], mu));
+                    rows.add(cplex_id(app_node_map_[n], nu), 1);
+                    rows.add(cplex_id(arc_vars[a], mu), 1);
                     // 0 <= App_i[nu] + Y_ij[mu] <= 1  forall mu>nu
-                    constraint_name.str(std::string()); // clear the name
-                    constraint_name << "outgoing: 0 <= App_i[" << nu << "] + Y_ij[" << mu << "] <= 1; ";
-                    constraint_name << "g.id(n) = " << g.id(n) << ", g.id(a) = " << g.id(a) << ", Traxel " << traxel_names;
-                    constraint_name << ", cid = " << ++counter;
-                    optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(),
-                            0, 1, constraint_name.str().c_str());
-                    LOG(logDEBUG3) << constraint_name.str();
+                    if (rows.with_names()) {
+                        constraint_name.str(std::string()); // clear the name
+                        constraint_name << "outgoing: 0 <= App_i[" << nu << "] + Y_ij[" << mu << "] <= 1; ";
+                        constraint_name << "g.id(n) = " << g.id(n) << ", g.id(a) = " << g.id(snapshot.arc(a)) << ", Traxel " << traxel_names;
+                        constraint_name << ", cid = " << ++counter;
+                    }
+                    rows.close(0, 1, constraint_name);
                 }
             }
             ++num_outarcs;
@@ -616,136 +1737,114 @@ void ConservationTracking::add_constraints(const HypothesesGraph& g) {
         }
         if (num_outarcs > 0) {
             // couple transitions: sum(Y_ij) = D_i + App_i
-            cplex_idxs.clear();
-            coeffs.clear();
-            for (HypothesesGraph::OutArcIt a(g, n); a != lemon::INVALID; ++a) {
+            for (size_t a = snapshot.out_begin(i); a != snapshot.out_end(i); ++a) {
                 for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
-                    coeffs.push_back(nu);
-                    cplex_idxs.push_back(cplex_id(arc_map_[a], nu));
+                    rows.add(cplex_id(arc_vars[a], nu), nu);
                 }
             }
             if (div_cplex_id != -1) {
-                cplex_idxs.push_back(div_cplex_id);
-                coeffs.push_back(-1);
+                rows.add(div_cplex_id, -1);
             }
             for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
-                coeffs.push_back(-nu);
-                cplex_idxs.push_back(cplex_id(app_node_map_[n], nu));
+                rows.add(cplex_id(app_node_map_[n], nu), -int(nu));
             }
 
             // 0 <= sum_nu [ sum_j( nu * Y_ij[nu] ) ] - [ sum_nu nu * X_i[nu] + D_i[1] + sum_nu nu * App_i[nu] ]<= 0
-            constraint_name.str(std::string()); // clear the name
-            constraint_name << "couple transitions: ";
-            constraint_name << " sum(Y_ij) = D_i + App_i added for Traxel " << traxel_names << ", "
-                    << "n = " << app_node_map_[n];
-            constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0, 0,
-                    constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
-
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "couple transitions: ";
+                constraint_name << " sum(Y_ij) = D_i + App_i added for Traxel " << traxel_names << ", "
+                        << "n = " << app_node_map_[n];
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(0, 0, constraint_name);
         }
 
         if (div_cplex_id != -1) {
             // couple detection and division: D_i = 1 => App_i = 1
             assert(app_node_map_.count(n) > 0
                     && "this node should be contained in app_node_map_ since it may divide");
-            cplex_idxs.clear();
-            coeffs.clear();
-
-            cplex_idxs.push_back(div_cplex_id);
-            coeffs.push_back(1);
-
-            cplex_idxs.push_back(cplex_id(app_node_map_[n], 1));
-            coeffs.push_back(-1);
+            rows.add(div_cplex_id, 1);
+            rows.add(cplex_id(app_node_map_[n], 1), -1);
 
             // -1 <= D_i[1] - App_i[1] <= 0
-            constraint_name.str(std::string()); // clear the name
-            constraint_name << "couple division and detection: ";
-            constraint_name << " D_i=1 => App_i =1 added for Traxel " << traxel_names << ", " << "n = "
-                    << app_node_map_[n] << ", d = " << div_node_map_[n];
-            constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), -1, 0,
-                    constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "couple division and detection: ";
+                constraint_name << " D_i=1 => App_i =1 added for Traxel " << traxel_names << ", " << "n = "
+                        << app_node_map_[n] << ", d = " << div_node_map_[n];
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(-1, 0, constraint_name);
 
             // couple divsion and transition: D_1 = 1 => sum_k(Y_ik) = 2
-            cplex_idxs2.clear();
-            coeffs2.clear(); // -m <= 2 * D_i[1] - sum_j ( Y_ij[1] ) <= 0
-            cplex_idxs2.push_back(div_cplex_id);
-            coeffs2.push_back(2);
+            division_vars.clear();
+            division_coeffs.clear(); // -m <= 2 * D_i[1] - sum_j ( Y_ij[1] ) <= 0
+            division_vars.push_back(div_cplex_id);
+            division_coeffs.push_back(2);
 
-            for (HypothesesGraph::OutArcIt a(g, n); a != lemon::INVALID; ++a) {
+            for (size_t a = snapshot.out_begin(i); a != snapshot.out_end(i); ++a) {
                 for (size_t nu = 2; nu <= max_number_objects_; ++nu) {
                     // D_i[1] = 1 => Y_ij[nu] = 0 forall nu > 1
-                    cplex_idxs.clear();
-                    coeffs.clear();
-                    cplex_idxs.push_back(div_cplex_id);
-                    coeffs.push_back(1);
-                    cplex_idxs.push_back(cplex_id(arc_map_[a], nu));
-                    coeffs.push_back(1);
+                    rows.add(div_cplex_id, 1);
+                    rows.add(cplex_id(arc_vars[a], nu), 1);
 
                     // 0 <= D_i[1] + Y_ij[nu] <= 1 forall nu>1
-                    constraint_name.str(std::string()); // clear the name
-                    constraint_name << "couple division and transition: ";
-                    constraint_name << " D_i=1 => Y_i[nu]=0 added for Traxel " << traxel_names << ", "
-                            << "d = " << div_node_map_[n] << ", y = " << arc_map_[a] << ", nu = "
-                            << nu;
-                    constraint_name << ", cid = " << ++counter;
-
-                    optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(),
-                            0, 1, constraint_name.str().c_str());
-                    LOG(logDEBUG3) << constraint_name.str();
-
+                    if (rows.with_names()) {
+                        constraint_name.str(std::string()); // clear the name
+                        constraint_name << "couple division and transition: ";
+                        constraint_name << " D_i=1 => Y_i[nu]=0 added for Traxel " << traxel_names << ", "
+                                << "d = " << div_node_map_[n] << ", y = " << arc_vars[a] << ", nu = "
+                                << nu;
+                        constraint_name << ", cid = " << ++counter;
+                    }
+                    rows.close(0, 1, constraint_name);
                 }
 
-                cplex_idxs2.push_back(cplex_id(arc_map_[a], 1));
-                coeffs2.push_back(-1);
+                division_vars.push_back(cplex_id(arc_vars[a], 1));
+                division_coeffs.push_back(-1);
             }
 
             // -m <= 2 * D_i[1] - sum_j (Y_ij[1]) <= 0
-            constraint_name.str(std::string()); // clear the name
-            constraint_name << "couple division and transitions: ";
-            constraint_name  << " D_i = 1 => sum_k(Y_ik) = 2 added for Traxel " << traxel_names << ", "
-                    << "d = " << div_node_map_[n];
-            constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs2.begin(), cplex_idxs2.end(), coeffs2.begin(),
-                    -int(max_number_objects_), 0, constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
+            for (size_t k = 0; k < division_vars.size(); ++k) {
+                rows.add(division_vars[k], division_coeffs[k]);
+            }
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "couple division and transitions: ";
+                constraint_name  << " D_i = 1 => sum_k(Y_ik) = 2 added for Traxel " << traxel_names << ", "
+                        << "d = " << div_node_map_[n];
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(-int(max_number_objects_), 0, constraint_name);
         }
 
         ////
         //// incoming transitions
         ////
         // couple transitions: sum_k(Y_kj) = Dis_j
-        cplex_idxs.clear();
-        coeffs.clear();
-
-        size_t num_inarcs = 0;
-        for (HypothesesGraph::InArcIt a(g, n); a != lemon::INVALID; ++a) {
-            for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
-                cplex_idxs.push_back(cplex_id(arc_map_[a], nu));
-                coeffs.push_back(nu);
-            }
-            ++num_inarcs;
-        }
-
-        if (num_inarcs > 0) {
+        if (snapshot.in_degree(i) > 0) {
             assert(dis_node_map_.count(n) > 0
                     && "this node should be contained in dis_node_map_ since it has incoming arcs");
+            for (size_t j = snapshot.in_begin(i); j != snapshot.in_end(i); ++j) {
+                const size_t a = snapshot.in_arc(j);
+                for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
+                    rows.add(cplex_id(arc_vars[a], nu), nu);
+                }
+            }
             for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
-                cplex_idxs.push_back(cplex_id(dis_node_map_[n], nu));
-                coeffs.push_back(-nu);
+                rows.add(cplex_id(dis_node_map_[n], nu), -int(nu));
             }
 
             // 0 <= sum_nu [ nu * sum_i (Y_ij[nu] ) ] - sum_nu ( nu * X_j[nu] ) - sum_nu ( nu * Dis_j[nu] ) <= 0
-            constraint_name.str(std::string()); // clear the name
-            constraint_name << "incoming transitions: ";
-            constraint_name << " sum_k(Y_kj) = Dis_j added for Traxel " << traxel_names << ", " << "n = "
-                    << dis_node_map_[n];
-            constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0, 0,
-                    constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "incoming transitions: ";
+                constraint_name << " sum_k(Y_kj) = Dis_j added for Traxel " << traxel_names << ", " << "n = "
+                        << dis_node_map_[n];
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(0, 0, constraint_name);
         }
 
         ////
@@ -753,116 +1852,128 @@ void ConservationTracking::add_constraints(const HypothesesGraph& g) {
         ////
         if (app_node_map_.count(n) > 0 && dis_node_map_.count(n) > 0) {
             for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
-                cplex_idxs.clear();
-                coeffs.clear();
-
-                cplex_idxs.push_back(cplex_id(app_node_map_[n], nu));
-                coeffs.push_back(1);
-
-                cplex_idxs.push_back(cplex_id(dis_node_map_[n], nu));
-                coeffs.push_back(-1);
-
-                cplex_idxs.push_back(cplex_id(dis_node_map_[n], 0));
-                coeffs.push_back(-1);
+                rows.add(cplex_id(app_node_map_[n], nu), 1);
+                rows.add(cplex_id(dis_node_map_[n], nu), -1);
+                rows.add(cplex_id(dis_node_map_[n], 0), -1);
 
                 // A_i[nu] = 1 => V_i[nu] = 1 v V_i[0] = 1
                 // -1 <= App_i[nu] - ( Dis_i[nu] + Dis_i[0] ) <= 0 forall nu > 0
-                constraint_name.str(std::string()); // clear the name
-                constraint_name << "disappearance/appearance coupling: ";
-                constraint_name << " A_i[nu] = 1 => V_i[nu] = 1 v V_i[0] = 1 added for Traxel "
-                        << traxel_names << ", " << "n = " << app_node_map_[n];
-                constraint_name << ", cid = " << ++counter;
-                optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), -1,
-                        0, constraint_name.str().c_str());
-                LOG(logDEBUG3) << constraint_name.str();
+                if (rows.with_names()) {
+                    constraint_name.str(std::string()); // clear the name
+                    constraint_name << "disappearance/appearance coupling: ";
+                    constraint_name << " A_i[nu] = 1 => V_i[nu] = 1 v V_i[0] = 1 added for Traxel "
+                            << traxel_names << ", " << "n = " << app_node_map_[n];
+                    constraint_name << ", cid = " << ++counter;
+                }
+                rows.close(-1, 0, constraint_name);
             }
 
             for (size_t nu = 1; nu <= max_number_objects_; ++nu) {
-                cplex_idxs.clear();
-                coeffs.clear();
-
-                cplex_idxs.push_back(cplex_id(dis_node_map_[n], nu));
-                coeffs.push_back(1);
-
-                cplex_idxs.push_back(cplex_id(app_node_map_[n], nu));
-                coeffs.push_back(-1);
-
-                cplex_idxs.push_back(cplex_id(app_node_map_[n], 0));
-                coeffs.push_back(-1);
+                rows.add(cplex_id(dis_node_map_[n], nu), 1);
+                rows.add(cplex_id(app_node_map_[n], nu), -1);
+                rows.add(cplex_id(app_node_map_[n], 0), -1);
 
                 // V_i[nu] = 1 => A_i[nu] = 1 v A_i[0] = 1
                 // -1 <= Dis_i[nu] - ( App_i[nu] + App_i[0] ) <= 0 forall nu > 0
-                constraint_name.str(std::string()); // clear the name
-                constraint_name << "disappearance/appearance coupling: ";
-                constraint_name << " V_i[nu] = 1 => A_i[nu] = 1 v A_i[0] = 1 added for Traxel "
-                        << traxel_names << ", " << "n = " << app_node_map_[n];
-                constraint_name << ", cid = " << ++counter;
-                optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), -1,
-                        0, constraint_name.str().c_str());
-                LOG(logDEBUG3) << constraint_name.str();
+                if (rows.with_names()) {
+                    constraint_name.str(std::string()); // clear the name
+                    constraint_name << "disappearance/appearance coupling: ";
+                    constraint_name << " V_i[nu] = 1 => A_i[nu] = 1 v A_i[0] = 1 added for Traxel "
+                            << traxel_names << ", " << "n = " << app_node_map_[n];
+                    constraint_name << ", cid = " << ++counter;
+                }
+                rows.close(-1, 0, constraint_name);
             }
         }
 
         if (!with_misdetections_allowed_) {
-            cplex_idxs.clear();
-            coeffs.clear();
             if (dis_node_map_.count(n) > 0) {
-                cplex_idxs.push_back(cplex_id(dis_node_map_[n], 0));
-                coeffs.push_back(1);
+                rows.add(cplex_id(dis_node_map_[n], 0), 1);
             }
             if (app_node_map_.count(n) > 0) {
-                cplex_idxs.push_back(cplex_id(app_node_map_[n], 0));
-                coeffs.push_back(1);
+                rows.add(cplex_id(app_node_map_[n], 0), 1);
             }
 
             // V_i[0] = 0 => 1 <= A_i[0]
             // A_i[0] = 0 => 1 <= V_i[0]
             // V_i <= m, A_i <= m
             // 0 <= Dis_i[0] + App_i[0] <= 0
-            constraint_name.str(std::string()); // clear the name
-            constraint_name << "disappearance/appearance coupling: ";
-            constraint_name << " A_i[0] + V_i[0] = 0 added for Traxel " << traxel_names;
-            constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0, 0,
-                    constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "disappearance/appearance coupling: ";
+                constraint_name << " A_i[0] + V_i[0] = 0 added for Traxel " << traxel_names;
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(0, 0, constraint_name);
         }
 
         if (!with_disappearance_ && (dis_node_map_.count(n) > 0)) {
-            cplex_idxs.clear();
-            coeffs.clear();
-            cplex_idxs.push_back(cplex_id(dis_node_map_[n], 0));
-            coeffs.push_back(1);
+            rows.add(cplex_id(dis_node_map_[n], 0), 1);
             // V_i[0] = 0
             // 1 <= V_i <= m
-            constraint_name.str(std::string()); // clear the name
-            constraint_name << "disappearance/appearance coupling: ";
-            constraint_name << " V_i[0] = 0 added for Traxel " << traxel_names << ", " << "n = "
-                    << dis_node_map_[n];
-            constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0,
-                    0, constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "disappearance/appearance coupling: ";
+                constraint_name << " V_i[0] = 0 added for Traxel " << traxel_names << ", " << "n = "
+                        << dis_node_map_[n];
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(0, 0, constraint_name);
         }
 
         if (!with_appearance_ && (app_node_map_.count(n) > 0)) {
-            cplex_idxs.clear();
-            coeffs.clear();
-            cplex_idxs.push_back(cplex_id(app_node_map_[n], 0));
-            coeffs.push_back(1);
+            rows.add(cplex_id(app_node_map_[n], 0), 1);
             // A_i[0] = 0
             // 1 <= A_i <= m
+            if (rows.with_names()) {
+                constraint_name.str(std::string()); // clear the name
+                constraint_name << "disappearance/appearance coupling: ";
+                constraint_name << " A_i[0] = 0 added for Traxel " << traxel_names << ", " << "n = "
+                        << app_node_map_[n];
+                constraint_name << ", cid = " << ++counter;
+            }
+            rows.close(0, 0, constraint_name);
+        }
+
+        if (!fixed_dis_states_.empty()) {
+            // the incoming arcs of a tracklet are those of its first node
+            const HypothesesGraph::Node first = with_tracklets_ ? tracklet2traxel_node_map_[n].front() : n;
+            node_var_map::const_iterator fixed = fixed_dis_states_.find(first);
+            if (fixed != fixed_dis_states_.end()) {
+                rows.add(cplex_id(dis_node_map_[n], fixed->second), 1);
+                // V_i[k] = 1
+                if (rows.with_names()) {
+                    constraint_name.str(std::string()); // clear the name
+                    constraint_name << "fixed incoming flow: ";
+                    constraint_name << " V_i[" << fixed->second << "] = 1 added for Traxel " << traxel_names
+                            << ", " << "n = " << dis_node_map_[n];
+                    constraint_name << ", cid = " << ++counter;
+                }
+                rows.close(1, 1, constraint_name);
+            }
+        }
+    }
+
+    // Y_a[0] = 0 for active arcs, Y_a[0] = 1 for inactive ones
+    for (arc_var_map::const_iterator it = fixed_arc_states_.begin(); it != fixed_arc_states_.end(); ++it) {
+        if (with_tracklets_) {
+            throw runtime_error("ConservationTracking::add_constraints(): fixed arcs require with_tracklets off");
+        }
+        rows.add(cplex_id(arc_map_[it->first], 0), 1);
+        if (rows.with_names()) {
             constraint_name.str(std::string()); // clear the name
-            constraint_name << "disappearance/appearance coupling: ";
-            constraint_name << " A_i[0] = 0 added for Traxel " << traxel_names << ", " << "n = "
-                    << app_node_map_[n];
+            constraint_name << "fixed arc: Y_a[0] = " << (it->second ? 0 : 1) << " added for a = "
+                    << arc_map_[it->first];
             constraint_name << ", cid = " << ++counter;
-            optimizer_->addConstraint(cplex_idxs.begin(), cplex_idxs.end(), coeffs.begin(), 0,
-                    0, constraint_name.str().c_str());
-            LOG(logDEBUG3) << constraint_name.str();
         }
+        const int inactive = it->second ? 0 : 1;
+        rows.close(inactive, inactive, constraint_name);
     }
 
+    LOG(logDEBUG) << "ConservationTracking::add_constraints: submitting " << rows.size() << " constraints";
+    rows.submit(*optimizer_);
+    number_of_constraints_ = rows.size();
+    PGMLINK_COUNT("ConservationTracking: constraints added", rows.size());
 }
 
 } /* namespace pgmlink */
@@ -0,0 +1,240 @@
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <lemon/core.h>
+#include <lemon/network_simplex.h>
+
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/instrumentation.h"
+#include "pgmlink/log.h"
+#include "pgmlink/reasoner_flow.h"
+#include "pgmlink/traxels.h"
+
+using namespace std;
+
+namespace pgmlink {
+namespace {
+// same as in ConservationTracking
+double get_transition_prob(double distance, size_t state, double alpha) {
+    double prob = exp(-distance / alpha);
+    if (state == 0) {
+        return 1 - prob;
+    }
+    return prob;
+}
+}
+
+////
+//// class FlowTracking
+////
+FlowTracking::Network::Arc FlowTracking::add_arc(Network::Node from, Network::Node to, int capacity, double cost) {
+    const Network::Arc a = network_.addArc(from, to);
+    capacities_.set(a, capacity);
+    costs_.set(a, cost);
+    if (from == source_) {
+        supply_ += capacity;
+    }
+    return a;
+}
+
+void FlowTracking::formulate(const HypothesesGraph& g) {
+    LOG(logDEBUG) << "FlowTracking::formulate: entered";
+    network_.clear();
+    supply_ = 0;
+    solved_ = false;
+    graph_ = &g;
+    detection_arcs_.assign(max_number_objects_ * (g.maxNodeId() + 1), lemon::INVALID);
+    disappearance_arcs_.assign(g.maxNodeId() + 1, lemon::INVALID);
+    division_arcs_.assign(g.maxNodeId() + 1, lemon::INVALID);
+    transition_arcs_.assign(g.maxArcId() + 1, lemon::INVALID);
+    if (g.timesteps().empty()) {
+        return;
+    }
+
+    source_ = network_.addNode();
+    sink_ = network_.addNode();
+    const int earliest_timestep = g.earliest_timestep();
+    const int latest_timestep = g.latest_timestep();
+    const int capacity = max_number_objects_;
+    const NodeTraxels traxel_map(g);
+
+    // the energies of a node are evaluated concurrently, the network is
+    // built afterwards
+    vector<HypothesesGraph::Node> nodes;
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        nodes.push_back(n);
+    }
+    const size_t m = max_number_objects_;
+    vector<double> detection_energies(nodes.size() * (m + 1));
+    vector<double> appearance_costs(nodes.size(), 0.);
+    vector<double> disappearance_costs(nodes.size(), 0.);
+    vector<double> division_costs(nodes.size(), 0.);
+    vector<bool> divisible(nodes.size(), false);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        divisible[i] = with_divisions_ && lemon::countOutArcs(g, nodes[i]) > 1;
+    }
+    string error;
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < static_cast<int>(nodes.size()); ++i) {
+        try {
+            const Traxel& traxel = traxel_map[nodes[i]];
+            for (size_t state = 0; state <= m; ++state) {
+                detection_energies[i * (m + 1) + state] = detection_(traxel, state);
+            }
+            // pay no appearance costs in the first and no disappearance
+            // costs in the last timestep
+            if (traxel.Timestep > earliest_timestep) {
+                appearance_costs[i] = appearance_cost_(traxel);
+            }
+            if (traxel.Timestep < latest_timestep) {
+                disappearance_costs[i] = disappearance_cost_(traxel);
+            }
+            if (divisible[i]) {
+                division_costs[i] = division_(traxel, 1) - division_(traxel, 0);
+            }
+        } catch (std::exception& e) {
+            #pragma omp critical(pgmlink_flow_energies)
+            {
+                if (error.empty()) error = e.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        throw runtime_error(error);
+    }
+
+    // a detection: in -> out through the unit arcs
+    vector<Network::Node> in(g.maxNodeId() + 1, lemon::INVALID);
+    vector<Network::Node> out(g.maxNodeId() + 1, lemon::INVALID);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const int id = g.id(nodes[i]);
+        in[id] = network_.addNode();
+        out[id] = network_.addNode();
+
+        for (size_t state = 1; state <= m; ++state) {
+            detection_arcs_[id * m + state - 1] = add_arc(in[id], out[id], 1,
+                    detection_energies[i * (m + 1) + state] - detection_energies[i * (m + 1) + state - 1]);
+        }
+        add_arc(source_, in[id], capacity, appearance_costs[i]);
+        disappearance_arcs_[id] = add_arc(out[id], sink_, capacity, disappearance_costs[i]);
+        if (divisible[i]) {
+            division_arcs_[id] = add_arc(source_, out[id], 1, division_costs[i]);
+        }
+    }
+
+    property_map<arc_distance, HypothesesGraph::base_graph>::type& arc_distances = g.get(arc_distance());
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        const double cost = transition_(get_transition_prob(arc_distances[a], 1, transition_parameter_))
+                - transition_(get_transition_prob(arc_distances[a], 0, transition_parameter_));
+        transition_arcs_[g.id(a)] = add_arc(out[g.id(g.source(a))], in[g.id(g.target(a))], capacity, cost);
+    }
+
+    // the objects that are not tracked
+    const Network::Arc untracked = network_.addArc(source_, sink_);
+    capacities_.set(untracked, supply_);
+    costs_.set(untracked, 0.);
+    LOG(logINFO) << "FlowTracking::formulate: " << lemon::countNodes(network_) << " nodes, "
+                 << lemon::countArcs(network_) << " arcs";
+}
+
+int FlowTracking::node_flow(int id) const {
+    int flow = 0;
+    for (size_t k = 0; k < max_number_objects_; ++k) {
+        flow += flows_[detection_arcs_[id * max_number_objects_ + k]];
+    }
+    return flow;
+}
+
+bool FlowTracking::invalid_division(const HypothesesGraph& g, const HypothesesGraph::Node& n) const {
+    // D_i = 1 => App_i = 1 and sum_j(Y_ij) = 2 with Y_ij <= 1
+    const int id = g.id(n);
+    if (node_flow(id) != 1 || flows_[disappearance_arcs_[id]] != 0) {
+        return true;
+    }
+    for (HypothesesGraph::OutArcIt a(g, n); a != lemon::INVALID; ++a) {
+        if (flows_[transition_arcs_[g.id(a)]] > 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FlowTracking::infer() {
+    if (graph_ == NULL) {
+        throw runtime_error("FlowTracking::infer(): formulate() has to be called first");
+    }
+    number_of_disabled_divisions_ = 0;
+    total_cost_ = 0;
+    solved_ = true;
+    if (lemon::countNodes(network_) == 0) {
+        return;
+    }
+
+    instrumentation::TraceScope trace("FlowTracking: solve", "solver");
+    const HypothesesGraph& g = *graph_;
+    while (true) {
+        lemon::NetworkSimplex<Network, int, double> solver(network_);
+        solver.upperMap(capacities_).costMap(costs_).stSupply(source_, sink_, supply_);
+        if (solver.run() != lemon::NetworkSimplex<Network, int, double>::OPTIMAL) {
+            throw runtime_error("FlowTracking::infer(): min-cost flow terminated abnormally");
+        }
+        solver.flowMap(flows_);
+        total_cost_ = solver.totalCost();
+        LOG(logDEBUG) << "FlowTracking::infer: total cost " << total_cost_;
+
+        // divisions are relaxed: disable the invalid ones and solve again
+        size_t disabled = 0;
+        for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+            const Network::Arc division = division_arcs_[g.id(n)];
+            if (division != lemon::INVALID && flows_[division] > 0 && invalid_division(g, n)) {
+                capacities_.set(division, 0);
+                ++disabled;
+            }
+        }
+        if (disabled == 0) {
+            break;
+        }
+        LOG(logDEBUG) << "FlowTracking::infer: disabled " << disabled << " invalid divisions";
+        number_of_disabled_divisions_ += disabled;
+    }
+}
+
+SolverStatistics FlowTracking::statistics() const {
+    SolverStatistics stats;
+    if (graph_ == NULL) {
+        return stats;
+    }
+    stats.number_of_models = 1;
+    stats.number_of_variables = lemon::countArcs(network_);
+    stats.number_of_constraints = lemon::countNodes(network_);
+    if (solved_) {
+        stats.objective = total_cost_;
+        stats.bound = total_cost_;
+        stats.status = "optimal";
+    }
+    return stats;
+}
+
+void FlowTracking::conclude(HypothesesGraph& g) {
+    if (graph_ == NULL) {
+        throw runtime_error("FlowTracking::conclude(): formulate() has to be called first");
+    }
+    g.add(node_active2()).add(arc_active()).add(division_active());
+    property_map<node_active2, HypothesesGraph::base_graph>::type& active_nodes = g.get(node_active2());
+    property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
+    property_map<division_active, HypothesesGraph::base_graph>::type& division_nodes = g.get(division_active());
+
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        active_nodes.set(n, node_flow(g.id(n)));
+        const Network::Arc division = division_arcs_[g.id(n)];
+        if (division != lemon::INVALID) {
+            division_nodes.set(n, flows_[division] > 0);
+        }
+    }
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        active_arcs.set(a, flows_[transition_arcs_[g.id(a)]] > 0);
+    }
+}
+
+} /* namespace pgmlink */
@@ -18,6 +18,7 @@
 
 #include "pgmlink/pgm.h"
 #include "pgmlink/hypotheses.h"
+#include "pgmlink/instrumentation.h"
 #include "pgmlink/log.h"
 #include "pgmlink/reasoner_pgm.h"
 #include "pgmlink/pgm_chaingraph.h"
@@ -28,6 +29,34 @@
 using namespace std;
 
 namespace pgmlink {
+  namespace {
+    // orders arcs by the energy of their moves, indexed by arc id
+    struct CheaperMove {
+      explicit CheaperMove(const vector<double>& energies) : energies_(energies) {}
+      bool operator()(const HypothesesGraph::Arc& a, const HypothesesGraph::Arc& b) const {
+	return energies_[HypothesesGraph::base_graph::id(a)] < energies_[HypothesesGraph::base_graph::id(b)];
+      }
+      const vector<double>& energies_;
+    };
+
+    // switch off all but the max_active cheapest of the active arcs;
+    // returns the number of switched off arcs
+    size_t keep_cheapest_arcs(vector<HypothesesGraph::Arc>& active,
+			      size_t max_active,
+			      const vector<double>& move_energies,
+			      const pgm::chaingraph::Model& m,
+			      vector<pgm::OpengmLPCplex::LabelType>& labels) {
+      if(active.size() <= max_active) {
+	return 0;
+      }
+      std::stable_sort(active.begin(), active.end(), CheaperMove(move_energies));
+      for(size_t i = max_active; i < active.size(); ++i) {
+	labels[m.var_of_arc(active[i])] = 0;
+      }
+      return active.size() - max_active;
+    }
+  }
+
   ////
   //// class Chaingraph
   ////
@@ -60,40 +89,121 @@ void Chaingraph::formulate( const HypothesesGraph& hypotheses ) {
     // refine the model with hard constraints
     pgm::OpengmLPCplex::Parameter param;
     param.verbose_ = true;
-    param.integerConstraint_ = true;
+    param.integerConstraint_ = !with_lp_relaxation_;
     param.epGap_ = ep_gap_;
     param.timeLimit_ = cplex_timeout_;
+    if(progress_callback_) {
+      // infer() solves in slices
+      param.timeLimit_ = pgm::anytime_slice_seconds(progress_interval_, cplex_timeout_);
+    }
     LOG(logDEBUG) << "Chaingraph::formulate ep_gap = " << param.epGap_;
     pgm::OpengmLPCplex* cplex = new pgm::OpengmLPCplex(*(linking_model_->opengm_model), param);
     optimizer_ = cplex; // opengm::Inference optimizer_
+    graph_ = &hypotheses;
 
+    PhaseTimer timer(with_statistics_);
     if (with_constraints_) {
       LOG(logDEBUG) << "Chaingraph::formulate: add_constraints";
-      builder_->add_hard_constraints( *linking_model_ , hypotheses, *cplex );
+      number_of_constraints_ += builder_->add_hard_constraints( *linking_model_ , hypotheses, *cplex );
     }
     
     if (fixed_detections_) {
       LOG(logDEBUG) << "Chaingraph::formulate: fix_detections";
-      builder_->fix_detections( *linking_model_, hypotheses, *cplex );
+      number_of_constraints_ += builder_->fix_detections( *linking_model_, hypotheses, *cplex );
     }
+    timer.stop(constraints_seconds_);
 }
 
 
 
 void Chaingraph::infer() {
-    opengm::InferenceTermination status = optimizer_->infer();
+    opengm::InferenceTermination status;
+    instrumentation::TraceScope trace("Chaingraph: solve", "solver");
+    if(progress_callback_) {
+      status = pgm::infer_anytime(*optimizer_, pgm::anytime_slice_seconds(progress_interval_, cplex_timeout_),
+				  cplex_timeout_, ep_gap_, progress_callback_);
+    } else {
+      status = optimizer_->infer();
+    }
     if(status != opengm::NORMAL) {
         throw std::runtime_error("GraphicalModel::infer(): optimizer terminated unnormally");
     }
+    if(with_lp_relaxation_) {
+      round_relaxed_solution();
+    }
+    solved_ = true;
+}
+
+void Chaingraph::round_relaxed_solution() {
+    vector<pgm::OpengmLPCplex::LabelType>& labels = rounded_solution_;
+    if(optimizer_->arg(labels) != opengm::NORMAL) {
+	throw runtime_error("Chaingraph::infer(): solution extraction terminated unnormally");
+    }
+    const HypothesesGraph& g = *graph_;
+    const pgm::chaingraph::Model& m = *linking_model_;
+    const bool detection_vars = builder_->has_detection_vars();
+    size_t repaired = 0;
+
+    if(fixed_detections_) {
+      for(HypothesesGraph::NodeIt n(g); n!=lemon::INVALID; ++n) {
+	labels[m.var_of_node(n)] = 1;
+      }
+    }
+
+    // an active arc needs detected end points
+    if(detection_vars) {
+      for(HypothesesGraph::ArcIt a(g); a!=lemon::INVALID; ++a) {
+	if(labels[m.var_of_arc(a)] == 1
+	   && (labels[m.var_of_node(g.source(a))] == 0 || labels[m.var_of_node(g.target(a))] == 0)) {
+	  labels[m.var_of_arc(a)] = 0;
+	  ++repaired;
+	}
+      }
+    }
+
+    // at most one incoming and one (two if dividing) outgoing arc
+    if(lemon::countArcs(g) > 0) {
+      const NodeTraxels traxel_map(g);
+      const boost::function<double (const Traxel&, const Traxel&)> move = builder_->move();
+      vector<double> move_energies(g.maxArcId() + 1, 0.);
+      const size_t max_outgoing = builder_->has_divisions() ? 2 : 1;
+      for(HypothesesGraph::NodeIt n(g); n!=lemon::INVALID; ++n) {
+	vector<HypothesesGraph::Arc> active;
+	for(HypothesesGraph::OutArcIt a(g, n); a!=lemon::INVALID; ++a) {
+	  if(labels[m.var_of_arc(a)] == 1) {
+	    move_energies[g.id(a)] = move(traxel_map[n], traxel_map[g.target(a)]);
+	    active.push_back(a);
+	  }
+	}
+	repaired += keep_cheapest_arcs(active, max_outgoing, move_energies, m, labels);
+      }
+      for(HypothesesGraph::NodeIt n(g); n!=lemon::INVALID; ++n) {
+	vector<HypothesesGraph::Arc> active;
+	for(HypothesesGraph::InArcIt a(g, n); a!=lemon::INVALID; ++a) {
+	  if(labels[m.var_of_arc(a)] == 1) {
+	    active.push_back(a);
+	  }
+	}
+	repaired += keep_cheapest_arcs(active, 1, move_energies, m, labels);
+      }
+    }
+
+    rounded_objective_ = m.opengm_model->evaluate(labels.begin());
+    LOG(logINFO) << "Chaingraph::infer: rounded the LP solution, switched off " << repaired
+		 << " arcs, energy " << rounded_objective_ << ", LP bound " << optimizer_->bound();
 }
 
 
 void Chaingraph::conclude( HypothesesGraph& g ) {
     // extract solution from optimizer
   vector<pgm::OpengmLPCplex::LabelType> solution;
-    opengm::InferenceTermination status = optimizer_->arg(solution);
-    if(status != opengm::NORMAL) {
+    if(with_lp_relaxation_) {
+      solution = rounded_solution_;
+    } else {
+      opengm::InferenceTermination status = optimizer_->arg(solution);
+      if(status != opengm::NORMAL) {
 	throw runtime_error("GraphicalModel::infer(): solution extraction terminated unnormally");
+      }
     }
 
     // add 'active' properties to graph
@@ -131,11 +241,72 @@ void Chaingraph::conclude( HypothesesGraph& g ) {
     return linking_model_->var_of_arc();
   }
 
+  SolverStatistics Chaingraph::statistics() const {
+    SolverStatistics stats;
+    if(optimizer_ == NULL) {
+      return stats;
+    }
+    stats.number_of_models = 1;
+    stats.number_of_variables = linking_model_->opengm_model->numberOfVariables();
+    stats.number_of_factors = linking_model_->opengm_model->numberOfFactors();
+    stats.number_of_table_entries = pgm::number_of_table_entries(*linking_model_->opengm_model);
+    stats.number_of_constraints = number_of_constraints_;
+    stats.constraints_seconds = constraints_seconds_;
+    if(solved_ && with_lp_relaxation_) {
+      stats.objective = rounded_objective_;
+      stats.bound = optimizer_->bound();
+      stats.status = "rounded";
+    } else if(solved_) {
+      stats.objective = optimizer_->value();
+      stats.bound = optimizer_->bound();
+      // the solver stops at the gap or at the time limit
+      stats.status = stats.gap() <= ep_gap_ + 1e-9 ? "optimal" : "time limit";
+    }
+    return stats;
+  }
+
+  void Chaingraph::add_memory_usage( MemoryReport& report ) const {
+    if(!linking_model_) {
+      return;
+    }
+    std::vector<std::string> function_types;
+    function_types.push_back("explicit functions");
+    function_types.push_back("feature functions");
+    function_types.push_back("loss functions");
+    pgm::add_model_memory_usage(*linking_model_->opengm_model, function_types, "opengm model", report);
+  }
+
+  void Chaingraph::set_progress_callback( SolverProgressCallback callback, double interval_seconds ) {
+    if(interval_seconds <= 0) {
+      throw std::invalid_argument("Chaingraph::set_progress_callback(): interval_seconds has to be positive");
+    }
+    progress_callback_ = callback;
+    progress_interval_ = interval_seconds;
+  }
+
+  void Chaingraph::set_lp_relaxation( bool state ) {
+    with_lp_relaxation_ = state;
+  }
+
+  bool Chaingraph::lp_relaxation() const {
+    return with_lp_relaxation_;
+  }
+
+  void Chaingraph::set_with_statistics(bool state) {
+    with_statistics_ = state;
+  }
+
 void Chaingraph::reset() {
     if(optimizer_ != NULL) {
 	delete optimizer_;
 	optimizer_ = NULL;
     }
+    number_of_constraints_ = 0;
+    constraints_seconds_ = 0;
+    solved_ = false;
+    graph_ = NULL;
+    rounded_solution_.clear();
+    rounded_objective_ = 0;
 }
 
 } /* namespace pgmlink */ 
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "pgmlink/log.h"
+#include "pgmlink/spatial_index.h"
+#include "pgmlink/traxels.h"
+
+using namespace std;
+
+namespace pgmlink {
+  namespace {
+    bool by_id(const pair<double, unsigned int>& a, const pair<double, unsigned int>& b) {
+      return a.second < b.second;
+    }
+
+    // position of a query (the counterpart of the indexed positions)
+    void query_position(const Traxel& query, const bool reverse, double q[3]) {
+      if (reverse) {
+        q[0] = query.X();
+        q[1] = query.Y();
+        q[2] = query.Z();
+      } else {
+        q[0] = query.X_corr();
+        q[1] = query.Y_corr();
+        q[2] = query.Z_corr();
+      }
+    }
+  }
+
+////
+//// class GridNeighborSearch
+////
+void GridNeighborSearch::build(double cell_size) {
+  const size_t n = ids_.size();
+  for (int d = 0; d < 3; ++d) {
+    origin_[d] = 0;
+    shape_[d] = 1;
+  }
+  dimension_ = 2;
+  cell_size_ = (cell_size > 0) ? cell_size : 1.;
+  cell_offsets_.assign(2, 0);
+  if (n == 0) {
+    return;
+  }
+
+  double lo[3], hi[3];
+  for (int d = 0; d < 3; ++d) {
+    lo[d] = hi[d] = coordinates_[d];
+  }
+  for (size_t i = 0; i < n; ++i) {
+    for (int d = 0; d < 3; ++d) {
+      const double x = coordinates_[3 * i + d];
+      if (!(std::abs(x) <= std::numeric_limits<double>::max())) {
+        throw invalid_argument("GridNeighborSearch: traxel positions have to be finite");
+      }
+      lo[d] = min(lo[d], x);
+      hi[d] = max(hi[d], x);
+    }
+  }
+  dimension_ = (hi[2] > lo[2]) ? 3 : 2;
+
+  if (!(cell_size > 0)) {
+    // about one traxel per cell
+    double volume = 1.;
+    int dims = 0;
+    for (int d = 0; d < 3; ++d) {
+      if (hi[d] > lo[d]) {
+        volume *= hi[d] - lo[d];
+        ++dims;
+      }
+    }
+    cell_size = dims ? pow(volume / n, 1. / dims) : 1.;
+    if (!(cell_size > 0)) {
+      cell_size = 1.;
+    }
+  }
+  // bound the number of (mostly empty) cells
+  const double max_cells = 4. * n + 64;
+  while (true) {
+    double cells = 1.;
+    for (int d = 0; d < 3; ++d) {
+      cells *= floor((hi[d] - lo[d]) / cell_size) + 1;
+    }
+    if (cells <= max_cells) {
+      break;
+    }
+    cell_size *= 2;
+  }
+  cell_size_ = cell_size;
+  for (int d = 0; d < 3; ++d) {
+    origin_[d] = lo[d];
+    shape_[d] = static_cast<size_t>(floor((hi[d] - lo[d]) / cell_size_)) + 1;
+  }
+
+  // bucket the points (counting sort by cell)
+  vector<size_t> cell_of(n);
+  cell_offsets_.assign(shape_[0] * shape_[1] * shape_[2] + 1, 0);
+  for (size_t i = 0; i < n; ++i) {
+    size_t c[3];
+    for (int d = 0; d < 3; ++d) {
+      c[d] = min(static_cast<size_t>((coordinates_[3 * i + d] - origin_[d]) / cell_size_), shape_[d] - 1);
+    }
+    cell_of[i] = (c[2] * shape_[1] + c[1]) * shape_[0] + c[0];
+    ++cell_offsets_[cell_of[i] + 1];
+  }
+  for (size_t c = 1; c < cell_offsets_.size(); ++c) {
+    cell_offsets_[c] += cell_offsets_[c - 1];
+  }
+  vector<size_t> next(cell_offsets_.begin(), cell_offsets_.end() - 1);
+  vector<double> coordinates(3 * n);
+  vector<unsigned int> ids(n);
+  for (size_t i = 0; i < n; ++i) {
+    const size_t j = next[cell_of[i]]++;
+    copy(coordinates_.begin() + 3 * i, coordinates_.begin() + 3 * i + 3, coordinates.begin() + 3 * j);
+    ids[j] = ids_[i];
+  }
+  coordinates_.swap(coordinates);
+  ids_.swap(ids);
+
+  LOG(logDEBUG3) << "GridNeighborSearch: " << n << " traxels in " << shape_[0] << "x" << shape_[1] << "x" << shape_[2]
+                 << " cells of size " << cell_size_;
+}
+
+void GridNeighborSearch::in_range(const Traxel& query, double radius, const bool reverse, Found& found) const {
+  found.clear();
+  if (ids_.empty()) {
+    return;
+  }
+  double q[3];
+  query_position(query, reverse, q);
+
+  // cells overlapping the bounding box of the search sphere (with some
+  // slack against rounding at the cell borders)
+  size_t first[3], last[3];
+  for (int d = 0; d < 3; ++d) {
+    const double a = floor((q[d] - origin_[d] - radius) / cell_size_ - 1e-9);
+    const double b = floor((q[d] - origin_[d] + radius) / cell_size_ + 1e-9);
+    if (!(a <= b) || b < 0 || a >= static_cast<double>(shape_[d])) {
+      return;
+    }
+    first[d] = (a < 0) ? 0 : static_cast<size_t>(a);
+    last[d] = (b >= static_cast<double>(shape_[d])) ? shape_[d] - 1 : static_cast<size_t>(b);
+  }
+
+  const double squared_radius = radius * radius;
+  for (size_t z = first[2]; z <= last[2]; ++z) {
+    for (size_t y = first[1]; y <= last[1]; ++y) {
+      const size_t row = (z * shape_[1] + y) * shape_[0];
+      // the cells of a row are contiguous
+      const size_t begin = cell_offsets_[row + first[0]];
+      const size_t end = cell_offsets_[row + last[0] + 1];
+      for (size_t i = begin; i < end; ++i) {
+        const double* p = &coordinates_[3 * i];
+        double dist = 0;
+        for (int d = 0; d < 3; ++d) {
+          const double t = q[d] - p[d];
+          dist += t * t;
+        }
+        if (dist <= squared_radius) {
+          found.push_back(make_pair(dist, ids_[i]));
+        }
+      }
+    }
+  }
+}
+
+void GridNeighborSearch::nearest(Found& found, unsigned int knn) {
+  if (found.size() > knn) {
+    nth_element(found.begin(), found.begin() + knn, found.end());
+    found.resize(knn);
+  }
+  sort(found.begin(), found.end(), by_id);
+}
+
+map<unsigned int, double> GridNeighborSearch::knn_in_range(const Traxel& query, double radius, unsigned int knn, const bool reverse) {
+  if (radius < 0) {
+    throw invalid_argument("knn_in_range: radius has to be non-negative.");
+  }
+  Found found;
+  in_range(query, radius, reverse, found);
+  nearest(found, knn);
+
+  map<unsigned int, double> return_value;
+  for (Found::const_iterator it = found.begin(); it != found.end(); ++it) {
+    return_value[it->second] = it->first;
+  }
+  return return_value;
+}
+
+unsigned int GridNeighborSearch::count_in_range(const Traxel& query, double radius, const bool reverse) {
+  if (radius < 0) {
+    throw invalid_argument("count_in_range: radius has to be non-negative.");
+  }
+  Found found;
+  in_range(query, radius, reverse, found);
+  return found.size();
+}
+
+void GridNeighborSearch::knn_in_range(const vector<const Traxel*>& queries,
+                                      const vector<unsigned int>& knn,
+                                      double radius,
+                                      vector<size_t>& offsets,
+                                      vector<unsigned int>& ids,
+                                      vector<double>& distances,
+                                      const bool reverse) {
+  if (radius < 0) {
+    throw invalid_argument("knn_in_range: radius has to be non-negative.");
+  }
+  if (knn.size() != queries.size()) {
+    throw invalid_argument("knn_in_range: one knn per query required.");
+  }
+
+  offsets.assign(1, 0);
+  offsets.reserve(queries.size() + 1);
+  ids.clear();
+  distances.clear();
+
+  Found found;
+  for (size_t q = 0; q < queries.size(); ++q) {
+    in_range(*queries[q], radius, reverse, found);
+    nearest(found, knn[q]);
+    for (Found::const_iterator it = found.begin(); it != found.end(); ++it) {
+      ids.push_back(it->second);
+      distances.push_back(it->first);
+    }
+    offsets.push_back(ids.size());
+  }
+}
+
+} /* namespace pgmlink */
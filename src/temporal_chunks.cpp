@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pgmlink/binary_events.h"
+#include "pgmlink/log.h"
+#include "pgmlink/temporal_chunks.h"
+#include "pgmlink/tracking.h"
+
+using namespace std;
+
+namespace pgmlink {
+namespace {
+  Event single_traxel_event(Event::EventType type, size_t id) {
+    Event e;
+    e.type = type;
+    e.traxel_ids.push_back(id);
+    return e;
+  }
+
+  // the events of the merger resolution carry traxel ids assigned by one
+  // chunk, which the tracks of the other chunks know nothing about
+  void check_unresolved(const vector<Event>& slot) {
+    for (vector<Event>::const_iterator e = slot.begin(); e != slot.end(); ++e) {
+      if (e->type == Event::ResolvedTo || e->type == Event::MultiFrameMove) {
+        throw runtime_error("merge_temporal_chunks(): events of a merger resolution can not be merged");
+      }
+    }
+  }
+
+  // makes the tracks through the traxels at the last timestep before
+  // slot_out continuous; returns the number of repaired traxels. slot_in
+  // is the slot of the first timestep if first_slot, which has no
+  // Appearances: every traxel there is tracked. Mergers only count the
+  // objects of traxels tracked by Moves and need no repair.
+  size_t repair_seam(vector<Event>& slot_in, vector<Event>& slot_out, bool first_slot) {
+    // continued or ended as decided by the later chunk
+    set<size_t> continued, ended;
+    for (vector<Event>::const_iterator e = slot_out.begin(); e != slot_out.end(); ++e) {
+      if (e->type == Event::Move || e->type == Event::Division) {
+        continued.insert(e->traxel_ids[0]);
+      } else if (e->type == Event::Disappearance) {
+        ended.insert(e->traxel_ids[0]);
+      }
+    }
+    // tracked as decided by the earlier chunk
+    set<size_t> tracked;
+    if (first_slot) {
+      tracked.insert(continued.begin(), continued.end());
+      tracked.insert(ended.begin(), ended.end());
+    }
+    for (vector<Event>::const_iterator e = slot_in.begin(); e != slot_in.end(); ++e) {
+      if (e->type == Event::Appearance) {
+        tracked.insert(e->traxel_ids[0]);
+      } else if (e->type == Event::Move || e->type == Event::Division) {
+        tracked.insert(e->traxel_ids.begin() + 1, e->traxel_ids.end());
+      }
+    }
+
+    size_t repaired = 0;
+    for (set<size_t>::const_iterator id = tracked.begin(); id != tracked.end(); ++id) {
+      if (!continued.count(*id) && !ended.count(*id)) {
+        slot_out.push_back(single_traxel_event(Event::Disappearance, *id));
+        ++repaired;
+      }
+    }
+    for (set<size_t>::const_iterator id = continued.begin(); id != continued.end(); ++id) {
+      if (!tracked.count(*id)) {
+        slot_in.push_back(single_traxel_event(Event::Appearance, *id));
+        ++repaired;
+      }
+    }
+    const size_t n_out = slot_out.size();
+    for (vector<Event>::iterator e = slot_out.begin(); e != slot_out.end();) {
+      if (e->type == Event::Disappearance && !tracked.count(e->traxel_ids[0])) {
+        e = slot_out.erase(e);
+      } else {
+        ++e;
+      }
+    }
+    return repaired + n_out - slot_out.size();
+  }
+}
+
+vector<TemporalChunk> plan_temporal_chunks(int first_timestep, int last_timestep, int chunk_length, int overlap) {
+  if (chunk_length < 1 || overlap < 0) {
+    throw invalid_argument("plan_temporal_chunks(): chunk_length > 0 and overlap >= 0 required");
+  }
+  vector<TemporalChunk> chunks;
+  for (int own_first = first_timestep; own_first <= last_timestep; own_first += chunk_length) {
+    TemporalChunk chunk;
+    chunk.origin = first_timestep;
+    chunk.own_first = own_first;
+    chunk.own_last = min(own_first + chunk_length - 1, last_timestep);
+    // the first owned slot needs the timestep before it
+    chunk.first = max(own_first - 1 - overlap, first_timestep);
+    chunk.last = min(chunk.own_last + overlap, last_timestep);
+    chunks.push_back(chunk);
+  }
+  return chunks;
+}
+
+vector<TemporalChunk> plan_temporal_chunks(const TraxelStore& ts, int chunk_length, int overlap) {
+  if (ts.empty()) {
+    return plan_temporal_chunks(0, -1, chunk_length, overlap);
+  }
+  return plan_temporal_chunks(earliest_timestep(ts), latest_timestep(ts), chunk_length, overlap);
+}
+
+string chunk_events_filename(const string& prefix, size_t chunk) {
+  stringstream ss;
+  ss << prefix << ".chunk" << chunk << ".pgmlevts";
+  return ss.str();
+}
+
+
+
+////
+//// track_temporal_chunk
+////
+void track_temporal_chunk(ConsTracking& tracking, const TraxelStore& ts, const TemporalChunk& chunk,
+                          const string& filename) {
+  if (tracking.resolves_mergers()) {
+    throw invalid_argument("track_temporal_chunk(): the mergers of a chunk can not be resolved");
+  }
+  const TraxelStoreByTimestep& traxels = ts.get<by_timestep>();
+  TraxelStore chunk_ts;
+  add(chunk_ts, traxels.lower_bound(chunk.first), traxels.upper_bound(chunk.last));
+  LOG(logINFO) << "track_temporal_chunk(): " << chunk_ts.size() << " traxels in timesteps [" << chunk.first
+               << ", " << chunk.last << "], owning [" << chunk.own_first << ", " << chunk.own_last << "]";
+
+  BinaryEventWriter writer(filename);
+  if (chunk_ts.empty()) {
+    writer.close();
+    return;
+  }
+  vector<vector<Event> > events = tracking(chunk_ts);
+  const int earliest = earliest_timestep(chunk_ts);
+  for (size_t slot = 0; slot < events.size(); ++slot) {
+    const int t = earliest + static_cast<int>(slot);
+    if (chunk.own_first <= t && t <= chunk.own_last) {
+      writer.timestep(static_cast<size_t>(t - chunk.origin), events[slot]);
+    }
+  }
+  writer.close();
+}
+
+
+
+////
+//// merge_temporal_chunks
+////
+vector<vector<Event> > merge_temporal_chunks(const vector<TemporalChunk>& chunks, const vector<string>& filenames) {
+  if (chunks.size() != filenames.size()) {
+    throw invalid_argument("merge_temporal_chunks(): one file per chunk expected");
+  }
+  vector<vector<Event> > events;
+  if (chunks.empty()) {
+    return events;
+  }
+  events.resize(chunks.back().own_last - chunks.back().origin + 1);
+  EventVectorSink sink(events);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    load_binary_events(filenames[i], sink);
+  }
+  if (events.size() != static_cast<size_t>(chunks.back().own_last - chunks.back().origin + 1)) {
+    throw runtime_error("merge_temporal_chunks(): events beyond the last chunk");
+  }
+
+  for (size_t slot = 0; slot < events.size(); ++slot) {
+    check_unresolved(events[slot]);
+  }
+  size_t repaired = 0;
+  for (size_t i = 1; i < chunks.size(); ++i) {
+    const size_t slot_out = chunks[i].own_first - chunks[i].origin;
+    repaired += repair_seam(events[slot_out - 1], events[slot_out], slot_out == 1);
+  }
+  LOG(logINFO) << "merge_temporal_chunks(): " << chunks.size() << " chunks merged, " << repaired
+               << " traxels at the seams repaired";
+  return events;
+}
+
+vector<vector<Event> > track_temporal_chunks(ConsTracking& tracking, const TraxelStore& ts, int chunk_length,
+                                             int overlap, const string& prefix) {
+  const vector<TemporalChunk> chunks = plan_temporal_chunks(ts, chunk_length, overlap);
+  vector<string> filenames;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    filenames.push_back(chunk_events_filename(prefix, i));
+    track_temporal_chunk(tracking, ts, chunks[i], filenames.back());
+  }
+  return merge_temporal_chunks(chunks, filenames);
+}
+
+} /* namespace pgmlink */
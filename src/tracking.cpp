@@ -1,23 +1,30 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <map>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <iostream>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
 
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/archive/text_oarchive.hpp>
-
+#include "pgmlink/binary_events.h"
+#include "pgmlink/binary_traxelstore.h"
 #include "pgmlink/feature.h"
+#include "pgmlink/feature_stage.h"
 #include "pgmlink/pgm.h"
 #include "pgmlink/hypotheses.h"
+#include "pgmlink/instrumentation.h"
 #include "pgmlink/log.h"
 #include "pgmlink/reasoner_pgm.h"
 #include "pgmlink/tracking.h"
 #include "pgmlink/reasoner_constracking.h"
+#include "pgmlink/reasoner_flow.h"
 #include "pgmlink/merger_resolving.h"
+#include "pgmlink/spatial_index.h"
 
 
 using namespace std;
@@ -25,6 +32,16 @@ using boost::shared_ptr;
 using boost::shared_array;
 
 namespace pgmlink {
+namespace {
+struct DetProbAsCellness {
+	typedef NoScratch scratch_type;
+	void operator()(const Traxel&, FeatureMap& features, NoScratch&) const {
+		features["cellness"] = features["detProb"];
+		assert(features["detProb"].size() == 2);
+	}
+};
+}
+
 ////
 //// class ChaingraphTracking
 ////
@@ -37,6 +54,59 @@ void ChaingraphTracking::set_cplex_timeout(double seconds) {
 	cplex_timeout_ = seconds;
 }
 
+void ChaingraphTracking::set_with_statistics(bool state) {
+	with_statistics_ = state;
+}
+
+const TrackingStatistics& ChaingraphTracking::statistics() const {
+	return statistics_;
+}
+
+void ChaingraphTracking::set_progress_callback(SolverProgressCallback callback, double interval_seconds) {
+	progress_callback_ = callback;
+	progress_interval_ = interval_seconds;
+}
+
+void ConsTracking::set_with_parallel_gmm(bool state) {
+	with_parallel_gmm_ = state;
+}
+
+void ConsTracking::set_merger_cache(MergerCentersCachePtr cache) {
+	merger_cache_ = cache;
+}
+
+void ConsTracking::set_coordinate_provider(CoordinateProviderPtr provider) {
+	coordinate_provider_ = provider;
+}
+
+void ConsTracking::set_with_assignment_resolution(bool state) {
+	with_assignment_resolution_ = state;
+}
+
+bool ConsTracking::resolves_mergers() const {
+	return max_number_objects_ > 1 && with_merger_resolution_;
+}
+
+void ConsTracking::set_tiling(double tile_size, double halo) {
+	if (tile_size < 0 || (tile_size > 0 && halo <= 0)) {
+		throw std::invalid_argument("ConsTracking::set_tiling(): tile_size >= 0 and halo > 0 required");
+	}
+	tile_size_ = tile_size;
+	tile_halo_ = halo;
+}
+
+void ConsTracking::set_checkpoint_prefix(const std::string& prefix) {
+	checkpoint_prefix_ = prefix;
+}
+
+void ConsTracking::set_resume_checkpoint(const std::string& filename) {
+	resume_checkpoint_ = filename;
+}
+
+void ChaingraphTracking::set_lp_relaxation(bool state) {
+	with_lp_relaxation_ = state;
+}
+
 vector<vector<Event> > ChaingraphTracking::operator()(TraxelStore& ts) {
   LOG(logINFO) << "Calling chaingraph tracking with the following parameters:\n"
 	       << "\trandom forest filename: " << rf_fn_ << "\n"
@@ -57,7 +127,11 @@ vector<vector<Event> > ChaingraphTracking::operator()(TraxelStore& ts) {
    	       << "\tcplex timeout: " << cplex_timeout_ << "\n"
    	       << "\talternative builder: " << alternative_builder_;
 
-	cout << "-> building feature functions " << endl;
+	instrumentation::TraceScope trace("ChaingraphTracking", "tracking");
+	statistics_ = TrackingStatistics();
+	PhaseTimer timer(with_statistics_, with_statistics_ ? &statistics_.memory : NULL);
+
+	LOG(logINFO) << "ChaingraphTracking(): building feature functions";
 	SquaredDistance move;
 	BorderAwareConstant appearance(app_, earliest_timestep(ts), true, 0);
 	BorderAwareConstant disappearance(dis_, latest_timestep(ts), false, 0);
@@ -68,7 +142,7 @@ vector<vector<Event> > ChaingraphTracking::operator()(TraxelStore& ts) {
 	boost::function<double(const Traxel&)> detection, misdetection;
 	if (use_rf_) {
 		LOG(logINFO) << "Loading Random Forest";
-		vigra::RandomForest<RF::RF_LABEL_TYPE> rf = RF::getRandomForest(rf_fn_);
+		RF::RandomForestPtr rf = RF::getSharedRandomForest(rf_fn_);
 		std::vector<std::string> rf_features;
 		rf_features.push_back("volume");
 		rf_features.push_back("bbox");
@@ -87,17 +161,12 @@ vector<vector<Event> > ChaingraphTracking::operator()(TraxelStore& ts) {
 		rf_features.push_back("lsgf");
 
 		LOG(logINFO) << "Predicting cellness";
-		RF::predict_traxels(ts, rf, rf_features, 1, "cellness");
+		RF::predict_traxels(ts, *rf, rf_features, 1, "cellness");
 
 		detection = NegLnCellness(det_);
 		misdetection = NegLnOneMinusCellness(mis_);
 	} else if (ts.begin()->features.find("detProb") != ts.begin()->features.end()) {
-          for (TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
-            Traxel trax = *it;
-            trax.features["cellness"] = trax.features["detProb"];
-            assert(trax.features["detProb"].size() == 2);
-            ts.replace(it, trax);
-          }
+          feature_stage("cellness from detProb", DetProbAsCellness())(ts);
           detection = NegLnCellness(det_);
           misdetection = NegLnOneMinusCellness(mis_);
 	} else {
@@ -105,12 +174,18 @@ vector<vector<Event> > ChaingraphTracking::operator()(TraxelStore& ts) {
 	  misdetection = ConstantFeature(mis_);
 	}
 
-	cout << "-> building hypotheses" << endl;
+	// positions are read for every kd-tree point, move and division pair
+	CoordinateCacheScope coordinate_cache(ts);
+
+	timer.stop(statistics_.energy_seconds, "ChaingraphTracking: energy");
+
+	LOG(logINFO) << "ChaingraphTracking(): building hypotheses";
 	SingleTimestepTraxel_HypothesesBuilder::Options builder_opts(n_neighbors_, 50);
 	SingleTimestepTraxel_HypothesesBuilder hyp_builder(&ts, builder_opts);
 	boost::shared_ptr<HypothesesGraph> graph = boost::shared_ptr<HypothesesGraph>(hyp_builder.build());
+	timer.stop(statistics_.hypotheses_seconds, "ChaingraphTracking: hypotheses");
 
-	cout << "-> init MRF reasoner" << endl;
+	LOG(logINFO) << "ChaingraphTracking(): init MRF reasoner";
 	std::auto_ptr<Chaingraph> mrf;
 
 	if(alternative_builder_) {
@@ -141,24 +216,44 @@ vector<vector<Event> > ChaingraphTracking::operator()(TraxelStore& ts) {
 	  mrf = std::auto_ptr<Chaingraph>(new Chaingraph(b, with_constraints_, ep_gap_, fixed_detections_, cplex_timeout_));
 	}
 
-	cout << "-> formulate MRF model" << endl;
+	if (progress_callback_) {
+		mrf->set_progress_callback(progress_callback_, progress_interval_);
+	}
+	mrf->set_lp_relaxation(with_lp_relaxation_);
+	mrf->set_with_statistics(with_statistics_);
+
+	LOG(logINFO) << "ChaingraphTracking(): formulate MRF model";
 	mrf->formulate(*graph);
+	timer.stop(statistics_.formulate_seconds, "ChaingraphTracking: formulate");
 
-	cout << "-> infer" << endl;
+	LOG(logINFO) << "ChaingraphTracking(): infer";
 	mrf->infer();
+	timer.stop(statistics_.infer_seconds, "ChaingraphTracking: infer");
 
-	cout << "-> conclude" << endl;
+	LOG(logINFO) << "ChaingraphTracking(): conclude";
 	mrf->conclude(*graph);
+	timer.stop(statistics_.conclude_seconds, "ChaingraphTracking: conclude");
 
-	cout << "-> storing state of detection vars" << endl;
+	LOG(logINFO) << "ChaingraphTracking(): storing state of detection vars";
 	last_detections_ = state_of_nodes(*graph);
 
-	cout << "-> pruning inactive hypotheses" << endl;
-	prune_inactive(*graph);
-
-	cout << "-> constructing events" << endl;
-
-	return *events(*graph);
+	LOG(logINFO) << "ChaingraphTracking(): constructing events";
+	boost::shared_ptr<std::vector< std::vector<Event> > > ev;
+	{
+		const ActiveSubgraph active(*graph);
+		ev = events(active);
+	}
+	timer.stop(statistics_.events_seconds, "ChaingraphTracking: events");
+
+	if (with_statistics_) {
+		statistics_.number_of_nodes = lemon::countNodes(*graph);
+		statistics_.number_of_arcs = lemon::countArcs(*graph);
+		statistics_.solver = mrf->statistics();
+		statistics_.memory.add("traxelstore", memory_bytes(ts));
+		add_memory_usage(*graph, statistics_.memory);
+		mrf->add_memory_usage(statistics_.memory);
+	}
+	return *ev;
 }
 
 vector<map<unsigned int, bool> > ChaingraphTracking::detections() {
@@ -173,9 +268,299 @@ vector<map<unsigned int, bool> > ChaingraphTracking::detections() {
 
 
 
+////
+//// class NNTracking, NNTrackletsTracking
+////
+namespace {
+// settings shared by the nearest neighbor trackers
+struct NearestNeighborLinking {
+	double move_distance;
+	double division_distance;
+	const vector<string>* features;
+	double division_threshold;
+	bool splitters;
+	bool mergers;
+	// only links between mutual nearest neighbors
+	bool mutual;
+};
+
+struct Link {
+	double distance; // in the distance features
+	double spatial;
+	size_t source, target;
+
+	bool operator<(const Link& other) const {
+		if (distance != other.distance) return distance < other.distance;
+		if (source != other.source) return source < other.source;
+		return target < other.target;
+	}
+};
+
+struct LinkSourceLess {
+	bool operator()(const Link& a, const Link& b) const {
+		return a.source < b.source || (a.source == b.source && a < b);
+	}
+};
+
+double feature_distance(const Traxel& a, const Traxel& b, const vector<string>& features) {
+	double d = 0;
+	for (vector<string>::const_iterator f = features.begin(); f != features.end(); ++f) {
+		TraxelFeatures::const_iterator fa = a.features.find(*f);
+		TraxelFeatures::const_iterator fb = b.features.find(*f);
+		if (fa == a.features.end() || fb == b.features.end() || fa->second.size() != fb->second.size()) {
+			throw runtime_error("NNTracking: distance feature " + *f + " missing or of different length");
+		}
+		for (size_t i = 0; i < fa->second.size(); ++i) {
+			const double diff = fa->second[i] - fb->second[i];
+			d += diff * diff;
+		}
+	}
+	return sqrt(d);
+}
+
+double division_probability(const Traxel& trax) {
+	TraxelFeatures::const_iterator f = trax.features.find("divProb");
+	return f == trax.features.end() || f->second.empty() ? 0. : f->second[0];
+}
+
+Event event(Event::EventType type, size_t a, size_t b = 0, size_t c = 0, size_t n_ids = 1) {
+	Event e;
+	e.type = type;
+	e.traxel_ids.push_back(a);
+	if (n_ids > 1) e.traxel_ids.push_back(b);
+	if (n_ids > 2) e.traxel_ids.push_back(c);
+	return e;
+}
+
+// the events between timestep t and t+1, which go to the slot of t+1
+void link_timesteps(const TraxelStore& ts, int t, const NearestNeighborLinking& p, vector<Event>& events) {
+	typedef TraxelStoreByTimestep::const_iterator Iterator;
+	const TraxelStoreByTimestep& traxels = ts.get<by_timestep>();
+	const pair<Iterator, Iterator> from = traxels.equal_range(t);
+	const pair<Iterator, Iterator> to = traxels.equal_range(t + 1);
+	vector<const Traxel*> sources, targets;
+	for (Iterator it = from.first; it != from.second; ++it) sources.push_back(&*it);
+	for (Iterator it = to.first; it != to.second; ++it) targets.push_back(&*it);
+
+	// candidate links from one batched query, grouped by source and
+	// sorted by distance; every successor within the radius is a
+	// candidate, so the distance features rank all of them
+	vector<Link> links;
+	if (!sources.empty() && !targets.empty()) {
+		const double radius = max(p.move_distance, p.division_distance);
+		GridNeighborSearch index(to.first, to.second, radius);
+		const vector<unsigned int> knn(sources.size(), static_cast<unsigned int>(targets.size()));
+		vector<size_t> offsets;
+		vector<unsigned int> ids;
+		vector<double> distances;
+		index.knn_in_range(sources, knn, radius, offsets, ids, distances);
+
+		vector<pair<unsigned int, size_t> > target_of_id(targets.size());
+		for (size_t i = 0; i < targets.size(); ++i) {
+			target_of_id[i] = make_pair(targets[i]->Id, i);
+		}
+		sort(target_of_id.begin(), target_of_id.end());
+
+		links.reserve(ids.size());
+		for (size_t s = 0; s < sources.size(); ++s) {
+			for (size_t k = offsets[s]; k < offsets[s + 1]; ++k) {
+				Link l;
+				l.source = s;
+				l.target = lower_bound(target_of_id.begin(), target_of_id.end(),
+				                       make_pair(ids[k], size_t(0)))->second;
+				l.spatial = sqrt(distances[k]);
+				l.distance = p.features->empty() ? l.spatial
+				                                 : feature_distance(*sources[s], *targets[l.target], *p.features);
+				links.push_back(l);
+			}
+		}
+		sort(links.begin(), links.end(), LinkSourceLess());
+	}
+	vector<size_t> first_link(sources.size() + 1, 0);
+	for (size_t i = 0; i < links.size(); ++i) {
+		++first_link[links[i].source + 1];
+	}
+	for (size_t s = 0; s < sources.size(); ++s) {
+		first_link[s + 1] += first_link[s];
+	}
+
+	vector<int> out(sources.size(), 0), in(targets.size(), 0);
+	vector<char> dividing(sources.size(), 0);
+
+	// divisions, the most probable first
+	vector<pair<double, size_t> > mothers;
+	for (size_t s = 0; s < sources.size(); ++s) {
+		const double prob = division_probability(*sources[s]);
+		if (prob > p.division_threshold) {
+			mothers.push_back(make_pair(-prob, s));
+		}
+	}
+	sort(mothers.begin(), mothers.end());
+	for (size_t m = 0; m < mothers.size(); ++m) {
+		const size_t s = mothers[m].second;
+		size_t daughters[2], n_daughters = 0;
+		for (size_t l = first_link[s]; l < first_link[s + 1] && n_daughters < 2; ++l) {
+			if (in[links[l].target] == 0 && links[l].spatial <= p.division_distance) {
+				daughters[n_daughters++] = links[l].target;
+			}
+		}
+		if (n_daughters == 2) {
+			dividing[s] = 1;
+			out[s] = 2;
+			in[daughters[0]] = in[daughters[1]] = 1;
+			events.push_back(event(Event::Division, sources[s]->Id, targets[daughters[0]]->Id,
+			                       targets[daughters[1]]->Id, 3));
+		}
+	}
+
+	// moves, the shortest links first
+	vector<Link> moves;
+	for (size_t i = 0; i < links.size(); ++i) {
+		if (links[i].spatial <= p.move_distance) {
+			moves.push_back(links[i]);
+		}
+	}
+	sort(moves.begin(), moves.end());
+	vector<int> nearest_source(targets.size(), -1);
+	for (size_t i = 0; i < moves.size(); ++i) {
+		if (nearest_source[moves[i].target] < 0) {
+			nearest_source[moves[i].target] = static_cast<int>(moves[i].source);
+		}
+	}
+	for (size_t i = 0; i < moves.size(); ++i) {
+		const Link& l = moves[i];
+		if (out[l.source] > 0 || in[l.target] > 0) {
+			continue;
+		}
+		// the nearest successor of a source is its first move
+		if (p.mutual && (nearest_source[l.target] != static_cast<int>(l.source)
+		                 || links[first_link[l.source]].target != l.target)) {
+			continue;
+		}
+		out[l.source] = in[l.target] = 1;
+		events.push_back(event(Event::Move, sources[l.source]->Id, targets[l.target]->Id, 0, 2));
+	}
+
+	// leftover sources merge into taken successors, leftover successors
+	// split off single moves
+	for (size_t i = 0; i < moves.size(); ++i) {
+		const Link& l = moves[i];
+		if (p.mergers && out[l.source] == 0 && in[l.target] > 0 && !dividing[l.source]) {
+			out[l.source] = 1;
+			++in[l.target];
+			events.push_back(event(Event::Move, sources[l.source]->Id, targets[l.target]->Id, 0, 2));
+		} else if (p.splitters && in[l.target] == 0 && out[l.source] == 1 && !dividing[l.source]) {
+			out[l.source] = 2;
+			in[l.target] = 1;
+			events.push_back(event(Event::Move, sources[l.source]->Id, targets[l.target]->Id, 0, 2));
+		}
+	}
+
+	for (size_t s = 0; s < sources.size(); ++s) {
+		if (out[s] == 0) {
+			events.push_back(event(Event::Disappearance, sources[s]->Id));
+		}
+	}
+	for (size_t i = 0; i < targets.size(); ++i) {
+		if (in[i] == 0) {
+			events.push_back(event(Event::Appearance, targets[i]->Id));
+		} else if (in[i] > 1) {
+			events.push_back(event(Event::Merger, targets[i]->Id, in[i], 0, 2));
+		}
+	}
+}
+
+// all traxels are detected
+shared_ptr<vector<map<unsigned int, bool> > > all_detections(const TraxelStore& ts, int first, int last) {
+	shared_ptr<vector<map<unsigned int, bool> > > detections(new vector<map<unsigned int, bool> >(last - first + 1));
+	for (TraxelStoreByTimestep::const_iterator it = ts.get<by_timestep>().begin();
+	     it != ts.get<by_timestep>().end(); ++it) {
+		(*detections)[it->Timestep - first][it->Id] = true;
+	}
+	return detections;
+}
+
+shared_ptr<vector<map<unsigned int, bool> > > nearest_neighbor_tracking(TraxelStore& ts,
+                                                                        const NearestNeighborLinking& p,
+                                                                        EventSink& sink) {
+	if (ts.size() == 0) {
+		return shared_ptr<vector<map<unsigned int, bool> > >(new vector<map<unsigned int, bool> >());
+	}
+	instrumentation::TraceScope trace("NNTracking", "tracking");
+	// positions are read for every grid point and query
+	CoordinateCacheScope coordinate_cache(ts);
+	const int first = earliest_timestep(ts);
+	const int last = latest_timestep(ts);
+
+	vector<vector<Event> > slots(last - first + 1);
+	string error;
+	#pragma omp parallel for schedule(dynamic)
+	for (int t = first; t < last; ++t) {
+		try {
+			link_timesteps(ts, t, p, slots[t - first + 1]);
+		} catch (std::exception& e) {
+			#pragma omp critical(pgmlink_nn_tracking)
+			{
+				if (error.empty()) error = e.what();
+			}
+		}
+	}
+	if (!error.empty()) {
+		throw runtime_error(error);
+	}
+	for (size_t slot = 0; slot < slots.size(); ++slot) {
+		sink.timestep(slot, slots[slot]);
+	}
+	return all_detections(ts, first, last);
+}
+}
+
+vector<vector<Event> > NNTracking::operator()(TraxelStore& ts) {
+	vector<vector<Event> > events;
+	EventVectorSink sink(events);
+	(*this)(ts, sink);
+	return events;
+}
+
+void NNTracking::operator()(TraxelStore& ts, EventSink& sink) {
+	LOG(logINFO) << "NNTracking(): linking nearest neighbors";
+	const NearestNeighborLinking p = {movDist_, divDist_, &distanceFeatures_, divisionThreshold_,
+	                                  splitterHandling_, mergerHandling_, false};
+	last_detections_ = nearest_neighbor_tracking(ts, p, sink);
+}
+
+vector<map<unsigned int, bool> > NNTracking::detections() {
+	if (!last_detections_) {
+		throw std::runtime_error("NNTracking::detections(): previous tracking result required");
+	}
+	return *last_detections_;
+}
+
+vector<vector<Event> > NNTrackletsTracking::operator()(TraxelStore& ts) {
+	vector<vector<Event> > events;
+	EventVectorSink sink(events);
+	(*this)(ts, sink);
+	return events;
+}
+
+void NNTrackletsTracking::operator()(TraxelStore& ts, EventSink& sink) {
+	LOG(logINFO) << "NNTrackletsTracking(): linking mutual nearest neighbors";
+	const NearestNeighborLinking p = {maxDist_, maxDist_, &distanceFeatures_, divisionThreshold_,
+	                                  splitterHandling_, mergerHandling_, true};
+	last_detections_ = nearest_neighbor_tracking(ts, p, sink);
+}
+
+vector<map<unsigned int, bool> > NNTrackletsTracking::detections() {
+	if (!last_detections_) {
+		throw std::runtime_error("NNTrackletsTracking::detections(): previous tracking result required");
+	}
+	return *last_detections_;
+}
+
+
 namespace {
-std::vector<double> computeDetProb(double vol, vector<double> means, vector<double> s2) {
-	std::vector<double> result;
+void computeDetProb(double vol, const vector<double>& means, const vector<double>& s2, vector<double>& result) {
+	result.clear();
 
 	double sum = 0;
 	for (size_t k = 0; k < means.size(); ++k) {
@@ -189,9 +574,40 @@ std::vector<double> computeDetProb(double vol, vector<double> means, vector<doub
 	for(std::vector<double>::iterator it = result.begin(); it!=result.end(); ++it) {
 		(*it) /= sum;
 	}
-
-	return result;
 }
+
+struct SizeDependentDetProb {
+	SizeDependentDetProb(const vector<double>& means, const vector<double>& sigma2, int max_number_objects)
+		: means(means), sigma2(sigma2), max_number_objects(max_number_objects) {}
+
+	// detection probabilities
+	typedef vector<double> scratch_type;
+
+	void operator()(const Traxel& trax, FeatureMap& features, vector<double>& detProb) const {
+		FeatureMap::const_iterator it = features.find("count");
+		if(it == features.end()) {
+			throw runtime_error("get_detection_prob(): cellness feature not in traxel");
+		}
+		double vol = it->second[0];
+		computeDetProb(vol,means,sigma2,detProb);
+		feature_array detProbFeat(feature_array::difference_type(max_number_objects+1));
+		for(int i = 0; i<=max_number_objects; ++i) {
+			double d = detProb[i];
+			if (d < 0.01) {
+				d = 0.01;
+			} else if (d > 0.99) {
+				d = 0.99;
+			}
+			LOG(logDEBUG2) << "detection probability for " << trax.Id << "[" << i << "] = " << d;
+			detProbFeat[i] = d;
+		}
+		features["detProb"] = detProbFeat;
+	}
+
+	const vector<double>& means;
+	const vector<double>& sigma2;
+	int max_number_objects;
+};
 }
 
 ////
@@ -219,17 +635,17 @@ bool all_true (InputIterator first, InputIterator last, UnaryPredicate pred) {
 ////
 //// class ConsTracking
 ////
-vector<vector<Event> > ConsTracking::operator()(TraxelStore& ts, TimestepIdCoordinateMapPtr coordinates) {
-	cout << "-> building energy functions " << endl;
+void ConsTracking::prepare_traxels(TraxelStore& ts,
+                                   boost::function<double(const Traxel&, const size_t)>& detection,
+                                   PhaseTimer& timer) {
+	LOG(logINFO) << "ConsTracking(): building energy functions";
 
 	double detection_weight = 10;
 	Traxels empty;
-	boost::function<double(const Traxel&, const size_t)> detection, division;
-	boost::function<double(const double)> transition;
 
 	bool use_classifier_prior = false;
 	Traxel trax = *(ts.begin());
-	FeatureMap::const_iterator it = trax.features.find("detProb");
+	TraxelFeatures::const_iterator it = trax.features.find("detProb");
 	if(it != trax.features.end()) {
 		use_classifier_prior = true;
 	}
@@ -269,29 +685,7 @@ vector<vector<Event> > ConsTracking::operator()(TraxelStore& ts, TimestepIdCoord
 			}
 		}
 
-		for(TraxelStore::iterator tr = ts.begin(); tr != ts.end(); ++tr) {
-			Traxel trax = *tr;
-			FeatureMap::const_iterator it = trax.features.find("count");
-			if(it == trax.features.end()) {
-				throw runtime_error("get_detection_prob(): cellness feature not in traxel");
-			}
-			double vol = it->second[0];
-			vector<double> detProb;
-			detProb = computeDetProb(vol,means,sigma2);
-			feature_array detProbFeat(feature_array::difference_type(max_number_objects_+1));
-			for(int i = 0; i<=max_number_objects_; ++i) {
-				double d = detProb[i];
-				if (d < 0.01) {
-					d = 0.01;
-				} else if (d > 0.99) {
-					d = 0.99;
-				}
-				LOG(logDEBUG2) << "detection probability for " << trax.Id << "[" << i << "] = " << d;
-				detProbFeat[i] = d;
-			}
-			trax.features["detProb"] = detProbFeat;
-			ts.replace(tr, trax);
-		}
+		feature_stage("size dependent detProb", SizeDependentDetProb(means, sigma2, max_number_objects_))(ts);
 		detection = NegLnDetection(detection_weight); // weight 1
 	} else {
 		LOG(logINFO) << "Using hard prior";
@@ -309,136 +703,510 @@ vector<vector<Event> > ConsTracking::operator()(TraxelStore& ts, TimestepIdCoord
 		detection = boost::bind<double>(NegLnConstant(detection_weight,prob_vector), _2);
 	}
 
-	LOG(logDEBUG1) << "division_weight_ = " << division_weight_;
-	LOG(logDEBUG1) << "transition_weight_ = " << transition_weight_;
-	division = NegLnDivision(division_weight_);
-	transition = NegLnTransition(transition_weight_);
+	// the border-aware costs read the distances instead of computing them
+	// for every node and solver configuration
+	border_distances_.reset();
+	if (border_width_ > 0) {
+		border_distances_.reset(new BorderDistances(ts, fov_, false));
+	}
+
+	timer.stop(statistics_.energy_seconds, "ConsTracking: energy");
+}
+
+shared_ptr<HypothesesGraph> ConsTracking::build_hypotheses(TraxelStore& ts,
+                                                         boost::function<double(const Traxel&, const size_t)>& detection,
+                                                         PhaseTimer& timer) {
+	prepare_traxels(ts, detection, timer);
 
-	cout << "-> building hypotheses" << endl;
+	LOG(logINFO) << "ConsTracking(): building hypotheses";
 	SingleTimestepTraxel_HypothesesBuilder::Options builder_opts(1, // max_nearest_neighbors
 				max_dist_,
 				true, // forward_backward
 				with_divisions_, // consider_divisions
 				division_threshold_
 				);
+	// a planar data set has 2D kd-trees and distances
+	const bool planar = number_of_dimensions_ == 2;
+	builder_opts.dimensions = planar ? 2 : 3;
 	SingleTimestepTraxel_HypothesesBuilder hyp_builder(&ts, builder_opts);
-	HypothesesGraph* graph = hyp_builder.build();
+	shared_ptr<HypothesesGraph> graph(hyp_builder.build());
 
 
 	LOG(logDEBUG1) << "ConsTracking(): adding distance property to edges";
 	HypothesesGraph& g = *graph;
 	g.add(arc_distance()).add(tracklet_intern_dist()).add(node_tracklet()).add(tracklet_intern_arc_ids()).add(traxel_arc_id());
 	property_map<arc_distance, HypothesesGraph::base_graph>::type& arc_distances = g.get(arc_distance());
-	property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g.get(node_traxel());
+	const NodeTraxels traxel_map(g);
 	bool with_optical_correction = false;
-	Traxel some_traxel = (*traxel_map.beginValue());
-	if (some_traxel.features.find("com_corrected") != some_traxel.features.end()) {
-		LOG(logINFO) << "optical correction enabled";
-		with_optical_correction = true;
+	HypothesesGraph::NodeIt some_node(g);
+	if (some_node != lemon::INVALID) {
+		const Traxel& some_traxel = traxel_map[some_node];
+		if (some_traxel.features.find("com_corrected") != some_traxel.features.end()) {
+			LOG(logINFO) << "optical correction enabled";
+			with_optical_correction = true;
+		}
 	}
 
+	// the distances only read the cached coordinates and are computed
+	// concurrently; the iterable arc map is not thread-safe and is filled
+	// afterwards
+	vector<HypothesesGraph::Arc> arcs;
+	arcs.reserve(lemon::countArcs(g));
 	for(HypothesesGraph::ArcIt a(g); a!=lemon::INVALID; ++a) {
-		HypothesesGraph::Node from = g.source(a);
-		HypothesesGraph::Node to = g.target(a);
-		Traxel from_tr = traxel_map[from];
-		Traxel to_tr = traxel_map[to];
-
-		if (with_optical_correction) {
-			arc_distances.set(a, from_tr.distance_to_corr(to_tr));
-		} else {
-			arc_distances.set(a, from_tr.distance_to(to_tr));
+		arcs.push_back(a);
+	}
+	vector<double> distances(arcs.size());
+	string error;
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < static_cast<int>(arcs.size()); ++i) {
+		try {
+			const Traxel& from_tr = traxel_map[g.source(arcs[i])];
+			const Traxel& to_tr = traxel_map[g.target(arcs[i])];
+			if (planar) {
+				distances[i] = with_optical_correction ? from_tr.distance_to_corr<2>(to_tr) : from_tr.distance_to<2>(to_tr);
+			} else {
+				distances[i] = with_optical_correction ? from_tr.distance_to_corr<3>(to_tr) : from_tr.distance_to<3>(to_tr);
+			}
+		} catch (std::exception& e) {
+			#pragma omp critical(pgmlink_tracking)
+			{
+				if (error.empty()) error = e.what();
+			}
 		}
 	}
-	//border_width_ is given in normalized scale, 1 corresponds to a maximal distance of dim_range/2
-	boost::function<double(const Traxel&)> appearance_cost_fn, disappearance_cost_fn;
-	LOG(logINFO) << "using border-aware appearance and disappearance costs, with absolute margin: " << border_width_;
-	appearance_cost_fn = SpatialBorderAwareWeight(appearance_cost_,
-												border_width_,
-												false, // true if relative margin to border
-												fov_);
-	disappearance_cost_fn = SpatialBorderAwareWeight(disappearance_cost_,
-												border_width_,
-												false, // true if relative margin to border
-												fov_);
+	if (!error.empty()) {
+		throw runtime_error(error);
+	}
+	for (size_t i = 0; i < arcs.size(); ++i) {
+		arc_distances.set(arcs[i], distances[i]);
+	}
+	timer.stop(statistics_.hypotheses_seconds, "ConsTracking: hypotheses");
+	if (with_statistics_) {
+		statistics_.number_of_nodes = lemon::countNodes(g);
+		statistics_.number_of_arcs = lemon::countArcs(g);
+	}
 
-	cout << "-> init ConservationTracking reasoner" << endl;
-	ConservationTracking pgm(
-			max_number_objects_,
-			detection,
-			division,
-			transition,
-			forbidden_cost_,
-			ep_gap_,
-			with_tracklets_,
-			with_divisions_,
-			disappearance_cost_fn,
-			appearance_cost_fn,
-			true, // with_misdetections_allowed
-			true, // with_appearance
-			true, // with_disappearance
-			transition_parameter_,
-            with_constraints_,
-            cplex_timeout_
-			);
+	return graph;
+}
 
-	cout << "-> formulate ConservationTracking model" << endl;
-	pgm.formulate(*graph);
+void ConsTracking::checkpoint(const HypothesesGraph& graph, TrackingStage stage, PhaseTimer& timer) {
+	if (checkpoint_prefix_.empty()) {
+		return;
+	}
+	save_checkpoint(graph, stage, checkpoint_filename(checkpoint_prefix_, stage));
+	timer.stop(statistics_.checkpoint_seconds, "ConsTracking: checkpoint");
+}
 
-	cout << "-> infer" << endl;
-	pgm.infer();
+vector<vector<Event> > ConsTracking::operator()(TraxelStore& ts, TimestepIdCoordinateMapPtr coordinates) {
+	instrumentation::TraceScope trace("ConsTracking", "tracking");
+	statistics_ = TrackingStatistics();
+	PhaseTimer timer(with_statistics_, with_statistics_ ? &statistics_.memory : NULL);
+	// positions are read for every kd-tree point, arc and border distance
+	CoordinateCacheScope coordinate_cache(ts);
+
+	boost::function<double(const Traxel&, const size_t)> detection;
+	shared_ptr<HypothesesGraph> graph_ptr;
+	// the stages up to this one are done
+	TrackingStage stage = HypothesesStage;
+	if (resume_checkpoint_.empty()) {
+		graph_ptr = build_hypotheses(ts, detection, timer);
+		checkpoint(*graph_ptr, HypothesesStage, timer);
+	} else {
+		// the detection energy and the border distances are not checkpointed
+		prepare_traxels(ts, detection, timer);
+		LOG(logINFO) << "ConsTracking(): resuming from checkpoint " << resume_checkpoint_;
+		graph_ptr.reset(new HypothesesGraph);
+		stage = load_checkpoint(*graph_ptr, ts, resume_checkpoint_);
+		graph_ptr->add(tracklet_intern_dist()).add(node_tracklet()).add(tracklet_intern_arc_ids()).add(traxel_arc_id());
+		timer.stop(statistics_.hypotheses_seconds, "ConsTracking: hypotheses");
+		if (with_statistics_) {
+			statistics_.number_of_nodes = lemon::countNodes(*graph_ptr);
+			statistics_.number_of_arcs = lemon::countArcs(*graph_ptr);
+		}
+	}
+	HypothesesGraph* graph = graph_ptr.get();
 
-	cout << "-> conclude" << endl;
-	pgm.conclude(*graph);
+	boost::function<double(const Traxel&, const size_t)> division;
+	boost::function<double(const double)> transition;
+	boost::function<double(const Traxel&)> appearance_cost_fn, disappearance_cost_fn;
+	const ConsTrackingParameters parameters = current_parameters();
+	energy_functions(parameters, division, transition, disappearance_cost_fn, appearance_cost_fn);
+
+	shared_ptr<ConservationTracking> reasoner;
+	if (stage >= SolvedStage) {
+		LOG(logINFO) << "ConsTracking(): solution read from the checkpoint";
+	} else if (with_min_cost_flow_) {
+		solve_min_cost_flow(*graph, detection, division, transition, disappearance_cost_fn, appearance_cost_fn, timer);
+	} else {
+		LOG(logINFO) << "ConsTracking(): init ConservationTracking reasoner";
+		reasoner = conservation_reasoner(*graph, parameters, detection, division, transition,
+		                                 disappearance_cost_fn, appearance_cost_fn);
+		ConservationTracking& pgm = *reasoner;
+
+		LOG(logINFO) << "ConsTracking(): formulate ConservationTracking model";
+		pgm.formulate(*graph);
+		timer.stop(statistics_.formulate_seconds, "ConsTracking: formulate");
+
+		LOG(logINFO) << "ConsTracking(): infer";
+		pgm.infer();
+		timer.stop(statistics_.infer_seconds, "ConsTracking: infer");
+
+		LOG(logINFO) << "ConsTracking(): conclude";
+		pgm.conclude(*graph);
+		timer.stop(statistics_.conclude_seconds, "ConsTracking: conclude");
+		if (with_statistics_) {
+			statistics_.solver = pgm.statistics();
+			pgm.add_memory_usage(statistics_.memory);
+		}
+	}
+	if (stage < SolvedStage) {
+		checkpoint(*graph, SolvedStage, timer);
+	}
+	if (with_statistics_) {
+		// before the merger resolution rewrites the graph
+		statistics_.memory.add("traxelstore", memory_bytes(ts));
+		add_memory_usage(*graph, statistics_.memory);
+	}
 
-	cout << "-> storing state of detection vars" << endl;
+	LOG(logINFO) << "ConsTracking(): storing state of detection vars";
 	last_detections_ = state_of_nodes(*graph);
 
-	cout << "-> pruning inactive hypotheses" << endl;
-	prune_inactive(*graph);
+    LOG(logINFO) << "ConsTracking(): constructing unresolved events";
+    boost::shared_ptr<std::vector< std::vector<Event> > > ev;
+    {
+        const ActiveSubgraph active(*graph);
+        ev = events(active);
+    }
+    timer.stop(statistics_.events_seconds, "ConsTracking: events");
 
-    cout << "-> constructing unresolved events" << endl;
-    boost::shared_ptr<std::vector< std::vector<Event> > > ev = events(*graph);
 
+    // kept for reweight() unless the mergers are resolved below
+    last_graph_ = graph_ptr;
+    last_reasoner_ = reasoner;
+    last_detection_ = detection;
 
     if (max_number_objects_ > 1 && with_merger_resolution_ && all_true(ev->begin()+1, ev->end(), has_data<Event>)) {
-      cout << "-> resolving mergers" << endl;
+      last_graph_.reset();
+      last_reasoner_.reset();
+      LOG(logINFO) << "ConsTracking(): resolving mergers";
+      // the resolver rewrites the active part of the graph in place
+      if (stage < PreMergerStage) {
+        prune_inactive(*graph);
+        timer.stop(statistics_.prune_seconds, "ConsTracking: prune");
+        checkpoint(*graph, PreMergerStage, timer);
+      }
       MergerResolver m(graph);
       FeatureExtractorBase* extractor;
       DistanceFromCOMs distance;
       if (coordinates) {
         extractor = new FeatureExtractorArmadillo(coordinates);
+      } else if (coordinate_provider_) {
+        extractor = new FeatureExtractorArmadillo(coordinate_provider_);
       } else {
-        calculate_gmm_beforehand(*graph, 1, number_of_dimensions_);
+        calculate_gmm_beforehand(*graph, 1, number_of_dimensions_, with_parallel_gmm_, merger_cache_);
         extractor = new FeatureExtractorMCOMsFromMCOMs;
       }
       FeatureHandlerFromTraxels handler(*extractor, distance);
       
       m.resolve_mergers(handler);
 
-      HypothesesGraph g_res;
-      resolve_graph(*graph, g_res, transition, ep_gap_, with_tracklets_, transition_parameter_, with_constraints_);
-      prune_inactive(*graph);
+      if (with_assignment_resolution_) {
+        ResolveAmbiguousArcsPgm assignment(transition, transition_parameter_);
+        assignment(graph);
+      } else {
+        HypothesesGraph g_res;
+        resolve_graph(*graph, g_res, transition, ep_gap_, with_tracklets_, transition_parameter_, with_constraints_, with_components_);
+      }
 
-      cout << "-> constructing resolved events" << endl;
-      boost::shared_ptr<std::vector< std::vector<Event> > > multi_frame_moves = multi_frame_move_events(*graph);
+      timer.stop(statistics_.merger_resolution_seconds, "ConsTracking: merger resolution");
 
-      cout << "-> merging unresolved and resolved events" << endl;
+      LOG(logINFO) << "ConsTracking(): constructing resolved events and merging them into the unresolved events";
+      const ActiveSubgraph active(*graph);
+      EventVectorSink merged(*ev);
+      multi_frame_move_events(active, merged);
+      timer.stop(statistics_.events_seconds, "ConsTracking: events");
       // delete extractor; // TO DELETE FIRST CREATE VIRTUAL DTORS
-      ev = merge_event_vectors(*ev, *multi_frame_moves);
     }
 
     if(event_vector_dump_filename_ != "none")
     {
-        // store the traxel store and the resulting event vector
-        std::ofstream ofs(event_vector_dump_filename_.c_str());
-        boost::archive::text_oarchive out_archive(ofs);
-        out_archive << ts;
-        out_archive << *ev;
+        // store the resulting event vector and, next to it, the traxel store
+        save_binary_events(*ev, event_vector_dump_filename_);
+        try {
+            save_binary(ts, event_vector_dump_filename_ + ".traxels");
+        } catch (std::exception& e) {
+            LOG(logWARNING) << "ConsTracking(): traxel store not dumped: " << e.what();
+        }
     }
 
     return *ev;
 }
 
+vector<vector<Event> > ConsTracking::reweight(double division_weight,
+                                              double transition_weight,
+                                              double disappearance_cost,
+                                              double appearance_cost,
+                                              double forbidden_cost) {
+	if (!last_graph_) {
+		throw std::runtime_error(
+				"ConsTracking::reweight(): previous tracking result without merger resolution required");
+	}
+	if (!with_min_cost_flow_ && !last_reasoner_) {
+		throw std::runtime_error(
+				"ConsTracking::reweight(): previous tracking result was resumed from a checkpoint without a model");
+	}
+	division_weight_ = division_weight;
+	transition_weight_ = transition_weight;
+	disappearance_cost_ = disappearance_cost;
+	appearance_cost_ = appearance_cost;
+	forbidden_cost_ = forbidden_cost;
+
+	boost::function<double(const Traxel&, const size_t)> division;
+	boost::function<double(const double)> transition;
+	boost::function<double(const Traxel&)> appearance_cost_fn, disappearance_cost_fn;
+	energy_functions(current_parameters(), division, transition, disappearance_cost_fn, appearance_cost_fn);
+
+	// the hypotheses are the ones of the last call
+	const size_t number_of_nodes = statistics_.number_of_nodes;
+	const size_t number_of_arcs = statistics_.number_of_arcs;
+	statistics_ = TrackingStatistics();
+	statistics_.number_of_nodes = number_of_nodes;
+	statistics_.number_of_arcs = number_of_arcs;
+	PhaseTimer timer(with_statistics_);
+	timer.stop(statistics_.energy_seconds, "ConsTracking::reweight: energy");
+
+	if (with_min_cost_flow_) {
+		// formulating the flow is cheap
+		solve_min_cost_flow(*last_graph_, last_detection_, division, transition, disappearance_cost_fn, appearance_cost_fn, timer);
+	} else {
+		LOG(logINFO) << "ConsTracking::reweight(): reweight ConservationTracking model";
+		last_reasoner_->reweight(*last_graph_, last_detection_, division, transition, forbidden_cost_,
+		                         disappearance_cost_fn, appearance_cost_fn);
+		timer.stop(statistics_.formulate_seconds, "ConsTracking::reweight: formulate");
+
+		LOG(logINFO) << "ConsTracking::reweight(): infer";
+		last_reasoner_->infer();
+		timer.stop(statistics_.infer_seconds, "ConsTracking::reweight: infer");
+
+		LOG(logINFO) << "ConsTracking::reweight(): conclude";
+		last_reasoner_->conclude(*last_graph_);
+		timer.stop(statistics_.conclude_seconds, "ConsTracking::reweight: conclude");
+		if (with_statistics_) {
+			statistics_.solver = last_reasoner_->statistics();
+		}
+	}
+	last_detections_ = state_of_nodes(*last_graph_);
+
+	boost::shared_ptr<std::vector< std::vector<Event> > > ev;
+	{
+		const ActiveSubgraph active(*last_graph_);
+		ev = events(active);
+	}
+	timer.stop(statistics_.events_seconds, "ConsTracking::reweight: events");
+	return *ev;
+}
+
+void ConsTracking::solve_min_cost_flow(HypothesesGraph& graph,
+                                       boost::function<double(const Traxel&, const size_t)> detection,
+                                       boost::function<double(const Traxel&, const size_t)> division,
+                                       boost::function<double(const double)> transition,
+                                       boost::function<double(const Traxel&)> disappearance_cost_fn,
+                                       boost::function<double(const Traxel&)> appearance_cost_fn,
+                                       PhaseTimer& timer) {
+	LOG(logINFO) << "ConsTracking(): formulate min-cost flow";
+	FlowTracking flow(max_number_objects_,
+	                  detection,
+	                  division,
+	                  transition,
+	                  with_divisions_,
+	                  disappearance_cost_fn,
+	                  appearance_cost_fn,
+	                  transition_parameter_);
+	flow.formulate(graph);
+	timer.stop(statistics_.formulate_seconds, "ConsTracking::solve_min_cost_flow: formulate");
+
+	LOG(logINFO) << "ConsTracking(): infer min-cost flow";
+	flow.infer();
+	timer.stop(statistics_.infer_seconds, "ConsTracking::solve_min_cost_flow: infer");
+
+	LOG(logINFO) << "ConsTracking(): conclude min-cost flow";
+	flow.conclude(graph);
+	timer.stop(statistics_.conclude_seconds, "ConsTracking::solve_min_cost_flow: conclude");
+	if (with_statistics_) {
+		statistics_.solver = flow.statistics();
+	}
+}
+
+vector<vector<vector<Event> > > ConsTracking::track_configurations(TraxelStore& ts,
+                                                                   const vector<ConsTrackingParameters>& configurations) {
+	statistics_ = TrackingStatistics();
+	PhaseTimer timer(with_statistics_);
+	CoordinateCacheScope coordinate_cache(ts);
+	last_graph_.reset();
+	last_reasoner_.reset();
+
+	boost::function<double(const Traxel&, const size_t)> detection;
+	shared_ptr<HypothesesGraph> graph = build_hypotheses(ts, detection, timer);
+	HypothesesGraph& g = *graph;
+
+	// formulate() and infer() only read the graph, so the configurations
+	// are solved concurrently; conclude() writes it and runs one
+	// configuration after the other
+	LOG(logINFO) << "ConsTracking::track_configurations(): solving " << configurations.size() << " configurations";
+	vector<shared_ptr<ConservationTracking> > reasoners(configurations.size());
+	vector<shared_ptr<FlowTracking> > flows(configurations.size());
+	string error;
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < static_cast<int>(configurations.size()); ++i) {
+		try {
+			boost::function<double(const Traxel&, const size_t)> division;
+			boost::function<double(const double)> transition;
+			boost::function<double(const Traxel&)> appearance_cost_fn, disappearance_cost_fn;
+			energy_functions(configurations[i], division, transition, disappearance_cost_fn, appearance_cost_fn);
+			Reasoner* reasoner;
+			if (with_min_cost_flow_) {
+				flows[i] = shared_ptr<FlowTracking>(new FlowTracking(max_number_objects_, detection, division, transition,
+				                                                     with_divisions_, disappearance_cost_fn, appearance_cost_fn,
+				                                                     configurations[i].transition_parameter));
+				reasoner = flows[i].get();
+			} else {
+				reasoners[i] = conservation_reasoner(g, configurations[i], detection, division, transition,
+				                                     disappearance_cost_fn, appearance_cost_fn);
+				reasoner = reasoners[i].get();
+			}
+			reasoner->formulate(g);
+			reasoner->infer();
+		} catch (std::exception& e) {
+			#pragma omp critical(pgmlink_tracking)
+			{
+				if (error.empty()) error = e.what();
+			}
+		}
+	}
+	if (!error.empty()) {
+		throw runtime_error(error);
+	}
+	timer.stop(statistics_.infer_seconds, "ConsTracking::track_configurations: infer");
+
+	vector<vector<vector<Event> > > results(configurations.size());
+	for (size_t i = 0; i < configurations.size(); ++i) {
+		if (with_min_cost_flow_) {
+			flows[i]->conclude(g);
+		} else {
+			reasoners[i]->conclude(g);
+		}
+		timer.stop(statistics_.conclude_seconds, "ConsTracking::track_configurations: conclude");
+		if (with_statistics_) {
+			statistics_.solver.add(with_min_cost_flow_ ? flows[i]->statistics() : reasoners[i]->statistics());
+		}
+		// free the model as early as possible
+		reasoners[i].reset();
+		flows[i].reset();
+
+		{
+			const ActiveSubgraph active(g);
+			results[i] = *events(active);
+		}
+		timer.stop(statistics_.events_seconds, "ConsTracking::track_configurations: events");
+	}
+	if (!configurations.empty()) {
+		last_detections_ = state_of_nodes(g);
+	}
+	return results;
+}
+
+ConsTrackingParameters ConsTracking::current_parameters() const {
+	return ConsTrackingParameters(division_weight_, transition_weight_, disappearance_cost_, appearance_cost_,
+	                              forbidden_cost_, ep_gap_, transition_parameter_, cplex_timeout_);
+}
+
+shared_ptr<ConservationTracking> ConsTracking::conservation_reasoner(
+		const HypothesesGraph& graph,
+		const ConsTrackingParameters& parameters,
+		boost::function<double(const Traxel&, const size_t)> detection,
+		boost::function<double(const Traxel&, const size_t)> division,
+		boost::function<double(const double)> transition,
+		boost::function<double(const Traxel&)> disappearance_cost_fn,
+		boost::function<double(const Traxel&)> appearance_cost_fn) const {
+	shared_ptr<ConservationTracking> reasoner(new ConservationTracking(
+			max_number_objects_,
+			detection,
+			division,
+			transition,
+			parameters.forbidden_cost,
+			parameters.ep_gap,
+			with_tracklets_,
+			with_divisions_,
+			disappearance_cost_fn,
+			appearance_cost_fn,
+			true, // with_misdetections_allowed
+			true, // with_appearance
+			true, // with_disappearance
+			parameters.transition_parameter,
+			with_constraints_,
+			parameters.cplex_timeout,
+			with_components_,
+			window_length_,
+			window_overlap_
+			));
+
+	if (tile_size_ > 0) {
+		reasoner->set_tiling(tile_size_, tile_halo_);
+	}
+
+	if (with_warm_start_) {
+		LOG(logINFO) << "ConsTracking(): greedy starting point";
+		reasoner->set_greedy_starting_point(graph);
+	}
+
+	if (progress_callback_) {
+		reasoner->set_progress_callback(progress_callback_, progress_interval_);
+	}
+	reasoner->set_with_statistics(with_statistics_);
+	return reasoner;
+}
+
+void ConsTracking::energy_functions(const ConsTrackingParameters& parameters,
+                                    boost::function<double(const Traxel&, const size_t)>& division,
+                                    boost::function<double(const double)>& transition,
+                                    boost::function<double(const Traxel&)>& disappearance_cost_fn,
+                                    boost::function<double(const Traxel&)>& appearance_cost_fn) const {
+	LOG(logDEBUG1) << "division_weight = " << parameters.division_weight;
+	LOG(logDEBUG1) << "transition_weight = " << parameters.transition_weight;
+	division = NegLnDivision(parameters.division_weight);
+	transition = NegLnTransition(parameters.transition_weight);
+
+	//border_width_ is given in normalized scale, 1 corresponds to a maximal distance of dim_range/2
+	LOG(logINFO) << "using border-aware appearance and disappearance costs, with absolute margin: " << border_width_;
+	SpatialBorderAwareWeight appearance(parameters.appearance_cost,
+												border_width_,
+												false, // true if relative margin to border
+												fov_);
+	SpatialBorderAwareWeight disappearance(parameters.disappearance_cost,
+												border_width_,
+												false, // true if relative margin to border
+												fov_);
+	if (border_distances_) {
+		appearance.use_border_distances(border_distances_);
+		disappearance.use_border_distances(border_distances_);
+	}
+	appearance_cost_fn = appearance;
+	disappearance_cost_fn = disappearance;
+}
+
+void ConsTracking::set_with_statistics(bool state) {
+	with_statistics_ = state;
+}
+
+const TrackingStatistics& ConsTracking::statistics() const {
+	return statistics_;
+}
+
+void ConsTracking::set_progress_callback(SolverProgressCallback callback, double interval_seconds) {
+	progress_callback_ = callback;
+	progress_interval_ = interval_seconds;
+}
+
 vector<map<unsigned int, bool> > ConsTracking::detections() {
 	vector<map<unsigned int, bool> > res;
 	if (last_detections_) {
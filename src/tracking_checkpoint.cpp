@@ -0,0 +1,189 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/tuple/tuple.hpp>
+
+#include "pgmlink/log.h"
+#include "pgmlink/tracking_checkpoint.h"
+
+using namespace std;
+
+namespace pgmlink {
+namespace {
+  const string magic = "pgmlink checkpoint";
+  const unsigned int version = 1;
+
+  // column of the property in item order; only the presence if the graph lacks it
+  template <typename PropertyTag, typename Value, typename Item>
+  void save_column(const HypothesesGraph& g, const vector<Item>& items, boost::archive::binary_oarchive& oa) {
+    const bool present = g.has_property(PropertyTag());
+    oa << present;
+    if (!present) {
+      return;
+    }
+    const typename property_map<PropertyTag, HypothesesGraph::base_graph>::type& m = g.get(PropertyTag());
+    vector<Value> column;
+    column.reserve(items.size());
+    for (typename vector<Item>::const_iterator it = items.begin(); it != items.end(); ++it) {
+      column.push_back(m[*it]);
+    }
+    oa << column;
+  }
+
+  template <typename PropertyTag, typename Value, typename Item>
+  void load_column(HypothesesGraph& g, const vector<Item>& items, boost::archive::binary_iarchive& ia) {
+    bool present;
+    ia >> present;
+    if (!present) {
+      return;
+    }
+    vector<Value> column;
+    ia >> column;
+    if (column.size() != items.size()) {
+      throw runtime_error("load_checkpoint(): column of " + property_map<PropertyTag, HypothesesGraph::base_graph>::name
+                          + " does not match the graph");
+    }
+    if (!g.has_property(PropertyTag())) {
+      g.add(PropertyTag());
+    }
+    typename property_map<PropertyTag, HypothesesGraph::base_graph>::type& m = g.get(PropertyTag());
+    for (size_t i = 0; i < items.size(); ++i) {
+      m.set(items[i], column[i]);
+    }
+  }
+}
+
+std::string checkpoint_filename(const std::string& prefix, TrackingStage stage) {
+  switch (stage) {
+  case HypothesesStage:
+    return prefix + ".hypotheses.pgmlckpt";
+  case SolvedStage:
+    return prefix + ".solved.pgmlckpt";
+  case PreMergerStage:
+    return prefix + ".premerger.pgmlckpt";
+  }
+  throw invalid_argument("checkpoint_filename(): unknown stage");
+}
+
+
+
+////
+//// save_checkpoint
+////
+void save_checkpoint(const HypothesesGraph& g, TrackingStage stage, const std::string& filename) {
+  HypothesesGraphArrays arrays;
+  vector<HypothesesGraph::Node> nodes;
+  vector<HypothesesGraph::Arc> arcs;
+  to_arrays(g, arrays, nodes, arcs);
+
+  const NodeTraxels traxel_map(g);
+  vector<int> traxel_timesteps;
+  vector<unsigned int> traxel_ids;
+  traxel_timesteps.reserve(nodes.size());
+  traxel_ids.reserve(nodes.size());
+  for (vector<HypothesesGraph::Node>::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+    traxel_timesteps.push_back(traxel_map[*n].Timestep);
+    traxel_ids.push_back(traxel_map[*n].Id);
+  }
+
+  const string partial = filename + ".partial";
+  {
+    ofstream os(partial.c_str(), ios::binary | ios::trunc);
+    if (!os) {
+      throw runtime_error("save_checkpoint(): could not open file " + partial);
+    }
+    boost::archive::binary_oarchive oa(os);
+    const int stage_number = stage;
+    oa << magic << version << stage_number << arrays << traxel_timesteps << traxel_ids;
+    save_column<arc_distance, double>(g, arcs, oa);
+    save_column<node_active, char>(g, nodes, oa);
+    save_column<node_active2, size_t>(g, nodes, oa);
+    save_column<arc_active, char>(g, arcs, oa);
+    save_column<division_active, char>(g, nodes, oa);
+    if (!os) {
+      throw runtime_error("save_checkpoint(): could not write to file " + partial);
+    }
+  }
+  remove(filename.c_str());
+  if (rename(partial.c_str(), filename.c_str()) != 0) {
+    throw runtime_error("save_checkpoint(): could not rename " + partial + " to " + filename);
+  }
+  LOG(logINFO) << "save_checkpoint(): " << nodes.size() << " nodes and " << arcs.size() << " arcs written to "
+               << filename;
+}
+
+
+
+////
+//// load_checkpoint
+////
+TrackingStage load_checkpoint(HypothesesGraph& g, const TraxelStore& ts, const std::string& filename) {
+  ifstream is(filename.c_str(), ios::binary);
+  if (!is) {
+    throw runtime_error("load_checkpoint(): could not open file " + filename);
+  }
+  HypothesesGraphArrays arrays;
+  vector<int> traxel_timesteps;
+  vector<unsigned int> traxel_ids;
+  vector<HypothesesGraph::Node> nodes;
+  vector<HypothesesGraph::Arc> arcs;
+  int stage_number = 0;
+  try {
+    boost::archive::binary_iarchive ia(is);
+    string file_magic;
+    unsigned int file_version;
+    ia >> file_magic;
+    if (file_magic != magic) {
+      throw runtime_error("not a checkpoint");
+    }
+    ia >> file_version;
+    if (file_version != version) {
+      throw runtime_error("unsupported version");
+    }
+    ia >> stage_number >> arrays >> traxel_timesteps >> traxel_ids;
+    if (stage_number < HypothesesStage || stage_number > PreMergerStage) {
+      throw runtime_error("unknown stage");
+    }
+    if (traxel_timesteps.size() != arrays.node_timesteps.size() || traxel_ids.size() != arrays.node_timesteps.size()) {
+      throw runtime_error("one traxel reference per node expected");
+    }
+
+    from_arrays(g, arrays, nodes, arcs);
+    load_column<arc_distance, double>(g, arcs, ia);
+    load_column<node_active, char>(g, nodes, ia);
+    load_column<node_active2, size_t>(g, nodes, ia);
+    load_column<arc_active, char>(g, arcs, ia);
+    load_column<division_active, char>(g, nodes, ia);
+  } catch (std::exception& e) {
+    throw runtime_error("load_checkpoint(): " + filename + ": " + e.what());
+  }
+
+  if (!g.has_traxels()) {
+    g.add(node_traxel());
+  }
+  const TraxelStoreByTimeid& traxels = ts.get<by_timeid>();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    TraxelStoreByTimeid::const_iterator traxel = traxels.find(boost::make_tuple(traxel_timesteps[i], traxel_ids[i]));
+    if (traxel == traxels.end()) {
+      stringstream ss;
+      ss << "load_checkpoint(): traxel " << traxel_ids[i] << " at timestep " << traxel_timesteps[i]
+         << " not in the traxelstore";
+      throw runtime_error(ss.str());
+    }
+    g.set_traxel(nodes[i], *traxel);
+    g.index_traxel_node(nodes[i], *traxel);
+  }
+  LOG(logINFO) << "load_checkpoint(): " << nodes.size() << " nodes and " << arcs.size() << " arcs read from "
+               << filename;
+  return static_cast<TrackingStage>(stage_number);
+}
+
+} /* namespace pgmlink */
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "pgmlink/tracking_statistics.h"
+
+namespace pgmlink {
+namespace {
+// the worse a status, the higher its rank
+int status_rank(const std::string& status) {
+    if (status == "time limit") {
+        return 3;
+    } else if (status == "rounded") {
+        return 2;
+    } else if (status == "optimal") {
+        return 1;
+    }
+    return 0;
+}
+}
+
+long current_rss_kb() {
+#if defined(__linux__)
+    long pages = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (statm) {
+        long size;
+        if (fscanf(statm, "%ld %ld", &size, &pages) != 2) {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+    // no portable way; the peak is the closest
+    return peak_rss_kb();
+#endif
+}
+
+long peak_rss_kb() {
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+double relative_gap(double objective, double bound) {
+    return std::fabs(objective - bound) / (1e-10 + std::fabs(objective));
+}
+
+////
+//// struct SolverStatistics
+////
+SolverStatistics::SolverStatistics()
+    : number_of_models(0),
+      number_of_variables(0),
+      number_of_factors(0),
+      number_of_table_entries(0),
+      number_of_constraints(0),
+      constraints_seconds(0),
+      objective(0),
+      bound(0),
+      status("not solved") {
+}
+
+double SolverStatistics::gap() const {
+    return relative_gap(objective, bound);
+}
+
+void SolverStatistics::add(const SolverStatistics& other) {
+    if (number_of_models == 0 || status_rank(other.status) > status_rank(status)) {
+        status = other.status;
+    }
+    number_of_models += other.number_of_models;
+    number_of_variables += other.number_of_variables;
+    number_of_factors += other.number_of_factors;
+    number_of_table_entries += other.number_of_table_entries;
+    number_of_constraints += other.number_of_constraints;
+    constraints_seconds += other.constraints_seconds;
+    objective += other.objective;
+    bound += other.bound;
+}
+
+////
+//// struct MemoryReport
+////
+void MemoryReport::add(const std::string& component, size_t bytes) {
+    for (std::vector<MemoryUsage>::iterator it = components.begin(); it != components.end(); ++it) {
+        if (it->component == component) {
+            it->bytes += bytes;
+            return;
+        }
+    }
+    components.push_back(MemoryUsage(component, bytes));
+}
+
+void MemoryReport::record_phase(const std::string& phase) {
+    PhaseMemory p;
+    p.phase = phase;
+    p.rss_kb = current_rss_kb();
+    p.peak_rss_kb = peak_rss_kb();
+    phases.push_back(p);
+}
+
+size_t MemoryReport::total_bytes() const {
+    size_t total = 0;
+    for (std::vector<MemoryUsage>::const_iterator it = components.begin(); it != components.end(); ++it) {
+        total += it->bytes;
+    }
+    return total;
+}
+
+void MemoryReport::write(std::ostream& os) const {
+    size_t width = 9;
+    for (std::vector<MemoryUsage>::const_iterator it = components.begin(); it != components.end(); ++it) {
+        width = std::max(width, it->component.size());
+    }
+    for (std::vector<PhaseMemory>::const_iterator it = phases.begin(); it != phases.end(); ++it) {
+        width = std::max(width, it->phase.size());
+    }
+    os << std::left << std::setw(width) << "component" << std::right << std::setw(16) << "estimate [kB]" << '\n';
+    for (std::vector<MemoryUsage>::const_iterator it = components.begin(); it != components.end(); ++it) {
+        os << std::left << std::setw(width) << it->component << std::right << std::setw(16) << it->bytes / 1024 << '\n';
+    }
+    os << std::left << std::setw(width) << "total" << std::right << std::setw(16) << total_bytes() / 1024 << '\n';
+    if (!phases.empty()) {
+        os << '\n' << std::left << std::setw(width) << "phase" << std::right << std::setw(16) << "RSS [kB]"
+           << std::setw(16) << "peak RSS [kB]" << '\n';
+        for (std::vector<PhaseMemory>::const_iterator it = phases.begin(); it != phases.end(); ++it) {
+            os << std::left << std::setw(width) << it->phase << std::right << std::setw(16) << it->rss_kb
+               << std::setw(16) << it->peak_rss_kb << '\n';
+        }
+    }
+}
+
+////
+//// struct TrackingStatistics
+////
+TrackingStatistics::TrackingStatistics()
+    : energy_seconds(0),
+      hypotheses_seconds(0),
+      formulate_seconds(0),
+      infer_seconds(0),
+      conclude_seconds(0),
+      prune_seconds(0),
+      merger_resolution_seconds(0),
+      events_seconds(0),
+      checkpoint_seconds(0),
+      number_of_nodes(0),
+      number_of_arcs(0) {
+}
+
+} /* namespace pgmlink */
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "pgmlink/log.h"
+#include "pgmlink/traxel_columns.h"
+
+using namespace std;
+
+namespace pgmlink {
+  namespace {
+    // interned feature of a traxel of ts (falls back to the feature map
+    // for traxels that are not interned with the schema of ts)
+    const feature_type* feature_of(const Traxel& t, const TraxelStore& ts,
+                                   const string& name, FeatureSchema::slot_type slot, size_t& size) {
+      if(t.feature_schema() == ts.feature_schema_ptr()) {
+        size = t.feature_size(slot);
+        return t.feature(slot);
+      }
+      TraxelFeatures::const_iterator it = t.features.find(name);
+      if(it == t.features.end() || it->second.empty()) {
+        size = 0;
+        return 0;
+      }
+      size = it->second.size();
+      return &it->second[0];
+    }
+
+    struct RowLess {
+      RowLess(const int* timesteps, const unsigned int* ids) : timesteps(timesteps), ids(ids) {}
+      bool operator()(size_t a, size_t b) const {
+        return timesteps[a] < timesteps[b] || (timesteps[a] == timesteps[b] && ids[a] < ids[b]);
+      }
+      const int* timesteps;
+      const unsigned int* ids;
+    };
+
+    bool all_nan(const feature_type* values, size_t width) {
+      for(size_t i = 0; i < width; ++i) {
+        if(values[i] == values[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  TraxelColumns::TraxelColumns(const TraxelStore& ts) {
+    vector<string> names;
+    const FeatureSchema& schema = ts.feature_schema();
+    for(FeatureSchema::slot_type slot = 0; slot < schema.size(); ++slot) {
+      names.push_back(schema.name(slot));
+    }
+    fill(ts, names);
+  }
+
+  TraxelColumns::TraxelColumns(const TraxelStore& ts, const vector<string>& feature_names) {
+    fill(ts, feature_names);
+  }
+
+  void TraxelColumns::fill(const TraxelStore& ts, const vector<string>& feature_names) {
+    const size_t n = ts.size();
+    timesteps_.reserve(n);
+    ids_.reserve(n);
+    for(TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+      timesteps_.push_back(it->Timestep);
+      ids_.push_back(it->Id);
+    }
+
+    const FeatureSchema& schema = ts.feature_schema();
+    for(vector<string>::const_iterator name = feature_names.begin(); name != feature_names.end(); ++name) {
+      if(index_.count(*name)) {
+        continue;
+      }
+      const FeatureSchema::slot_type slot = schema.slot(*name);
+
+      size_t width = 0;
+      size_t size = 0;
+      for(TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+        feature_of(*it, ts, *name, slot, size);
+        width = max(width, size);
+      }
+
+      index_[*name] = columns_.size();
+      columns_.push_back(Column(*name, width));
+      Column& column = columns_.back();
+      column.values_.assign(n * width, numeric_limits<feature_type>::quiet_NaN());
+      feature_array::iterator row = column.values_.begin();
+      for(TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it, row += width) {
+        const feature_type* values = feature_of(*it, ts, *name, slot, size);
+        if(values) {
+          copy(values, values + size, row);
+        }
+      }
+    }
+    LOG(logDEBUG1) << "TraxelColumns: " << columns_.size() << " columns of " << n << " traxels";
+  }
+
+  pair<size_t, size_t> TraxelColumns::rows(int timestep) const {
+    pair<vector<int>::const_iterator, vector<int>::const_iterator> range =
+        equal_range(timesteps_.begin(), timesteps_.end(), timestep);
+    return make_pair(static_cast<size_t>(range.first - timesteps_.begin()),
+                     static_cast<size_t>(range.second - timesteps_.begin()));
+  }
+
+  vector<string> TraxelColumns::feature_names() const {
+    vector<string> ret;
+    for(vector<Column>::const_iterator it = columns_.begin(); it != columns_.end(); ++it) {
+      ret.push_back(it->name());
+    }
+    return ret;
+  }
+
+  const TraxelColumns::Column& TraxelColumns::column(const string& name) const {
+    map<string, size_t>::const_iterator it = index_.find(name);
+    if(it == index_.end()) {
+      throw invalid_argument("TraxelColumns::column(): no column " + name);
+    }
+    return columns_[it->second];
+  }
+
+  TraxelStore& add_columns(TraxelStore& ts, size_t n, const int* timesteps, const unsigned int* ids,
+                           const vector<FeatureColumnView>& features) {
+    for(vector<FeatureColumnView>::const_iterator f = features.begin(); f != features.end(); ++f) {
+      if(n > 0 && f->width > 0 && !f->data) {
+        throw invalid_argument("add_columns(): no values for feature " + f->name);
+      }
+    }
+
+    // rows in (timestep, id) order, split into timesteps
+    vector<size_t> order(n);
+    for(size_t i = 0; i < n; ++i) {
+      order[i] = i;
+    }
+    const RowLess less(timesteps, ids);
+    sort(order.begin(), order.end(), less);
+    vector<size_t> timestep_begin;
+    const TraxelStoreByTimeid& by_key = ts.get<by_timeid>();
+    for(size_t r = 0; r < n; ++r) {
+      const int t = timesteps[order[r]];
+      const unsigned int id = ids[order[r]];
+      if(r > 0 && !less(order[r-1], order[r])) {
+        throw invalid_argument("add_columns(): duplicate traxel in the columns");
+      }
+      if(by_key.find(boost::make_tuple(t, id)) != by_key.end()) {
+        throw invalid_argument("add_columns(): traxel already in the store");
+      }
+      if(r == 0 || timesteps[order[r-1]] != t) {
+        timestep_begin.push_back(r);
+      }
+    }
+    timestep_begin.push_back(n);
+
+    const boost::shared_ptr<FeatureSchema>& schema = ts.feature_schema_ptr();
+    for(vector<FeatureColumnView>::const_iterator f = features.begin(); f != features.end(); ++f) {
+      schema->intern(f->name);
+    }
+    const bool cache_coordinates = ts.caches_coordinates();
+    vector<Traxel> traxels(n);
+    string error;
+    #pragma omp parallel for schedule(dynamic)
+    for(int i = 0; i < static_cast<int>(timestep_begin.size()) - 1; ++i) {
+      try {
+        for(size_t r = timestep_begin[i]; r < timestep_begin[i+1]; ++r) {
+          const size_t row = order[r];
+          Traxel& t = traxels[r];
+          t.Timestep = timesteps[row];
+          t.Id = ids[row];
+          for(vector<FeatureColumnView>::const_iterator f = features.begin(); f != features.end(); ++f) {
+            const feature_type* values = f->data + row * f->width;
+            if(f->width > 0 && !all_nan(values, f->width)) {
+              t.features[f->name] = feature_array(values, values + f->width);
+            }
+          }
+          t.intern_features(schema);
+          if(cache_coordinates) {
+            t.cache_coordinates();
+          }
+        }
+      } catch(std::exception& e) {
+        #pragma omp critical(pgmlink_add_columns)
+        {
+          if(error.empty()) error = e.what();
+        }
+      }
+    }
+    if(!error.empty()) {
+      throw runtime_error(error);
+    }
+
+    for(vector<Traxel>::const_iterator it = traxels.begin(); it != traxels.end(); ++it) {
+      add_interned(ts, *it);
+    }
+    LOG(logDEBUG1) << "add_columns(): added " << n << " traxels in " << timestep_begin.size() - 1 << " timesteps";
+    return ts;
+  }
+} /* namespace pgmlink */
@@ -2,66 +2,392 @@
 #include <cmath>
 #include <stdexcept>
 #include <set>
+#include <typeinfo>
 #include <vector>
+#include <boost/thread/locks.hpp>
 #include "pgmlink/traxels.h"
 #include "pgmlink/field_of_view.h"
 
 using namespace std;
 
 namespace pgmlink {
+  ////
+  //// class FeatureSchema
+  ////
+  const FeatureSchema::slot_type FeatureSchema::invalid_slot;
+
+  FeatureSchema::slot_type FeatureSchema::intern(const std::string& name) {
+    {
+      boost::shared_lock<boost::shared_mutex> lock(mutex_);
+      std::map<std::string, slot_type>::const_iterator it = slots_.find(name);
+      if(it != slots_.end()) {
+        return it->second;
+      }
+    }
+    boost::unique_lock<boost::shared_mutex> lock(mutex_);
+    // another thread may have registered it in between
+    std::map<std::string, slot_type>::const_iterator it = slots_.find(name);
+    if(it != slots_.end()) {
+      return it->second;
+    }
+    const slot_type slot = names_.size();
+    slots_[name] = slot;
+    names_.push_back(name);
+    return slot;
+  }
+
+  FeatureSchema::slot_type FeatureSchema::slot(const std::string& name) const {
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    std::map<std::string, slot_type>::const_iterator it = slots_.find(name);
+    return it != slots_.end() ? it->second : invalid_slot;
+  }
+
+  std::string FeatureSchema::name(slot_type slot) const {
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    if(slot >= names_.size()) {
+      throw out_of_range("FeatureSchema::name(): slot not registered");
+    }
+    return names_[slot];
+  }
+
+  size_t FeatureSchema::size() const {
+    boost::shared_lock<boost::shared_mutex> lock(mutex_);
+    return names_.size();
+  }
+
+
+  ////
+  //// class FeatureValues
+  ////
+  bool operator==(const FeatureValues& a, const FeatureValues& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+  }
+
+
+  ////
+  //// class TraxelFeatures
+  ////
+  TraxelFeatures::const_iterator::const_iterator(const TraxelFeatures* features, FeatureMap::const_iterator it,
+                                                 size_t slot)
+    : features_(features), it_(it), slot_(slot) {
+    load();
+  }
+
+  TraxelFeatures::const_iterator& TraxelFeatures::const_iterator::operator++() {
+    if(features_->packed()) {
+      ++slot_;
+      // skip the slots of absent features
+      while(slot_ + 1 < features_->offsets_.size() && !features_->present(slot_)) {
+        ++slot_;
+      }
+    } else {
+      ++it_;
+    }
+    load();
+    return *this;
+  }
+
+  void TraxelFeatures::const_iterator::load() {
+    if(features_->packed()) {
+      if(slot_ + 1 < features_->offsets_.size()) {
+        value_.first = features_->schema_->name(slot_);
+        value_.second = FeatureValues(features_->feature(slot_), features_->feature_size(slot_));
+      }
+    } else if(it_ != features_->map_.end()) {
+      value_.first = it_->first;
+      value_.second = FeatureValues(it_->second);
+    }
+  }
+
+  TraxelFeatures::const_iterator TraxelFeatures::begin() const {
+    if(!packed()) {
+      return const_iterator(this, map_.begin(), 0);
+    }
+    size_t slot = 0;
+    while(slot + 1 < offsets_.size() && !present(slot)) {
+      ++slot;
+    }
+    return const_iterator(this, map_.end(), slot);
+  }
+
+  TraxelFeatures::const_iterator TraxelFeatures::end() const {
+    return const_iterator(this, map_.end(), packed() ? offsets_.size() - 1 : 0);
+  }
+
+  TraxelFeatures::const_iterator TraxelFeatures::find(const std::string& name) const {
+    if(!packed()) {
+      return const_iterator(this, map_.find(name), 0);
+    }
+    const FeatureSchema::slot_type slot = schema_->slot(name);
+    return present(slot) ? const_iterator(this, map_.end(), slot) : end();
+  }
+
+  size_t TraxelFeatures::size() const {
+    if(!packed()) {
+      return map_.size();
+    }
+    size_t n = 0;
+    for(size_t slot = 0; slot + 1 < offsets_.size(); ++slot) {
+      if(present(slot)) ++n;
+    }
+    return n;
+  }
+
+  FeatureValues TraxelFeatures::at(const std::string& name) const {
+    const_iterator it = find(name);
+    if(it == end()) {
+      throw out_of_range("TraxelFeatures::at(): no feature " + name);
+    }
+    return it->second;
+  }
+
+  FeatureMap TraxelFeatures::to_map() const {
+    if(!packed()) {
+      return map_;
+    }
+    FeatureMap map;
+    for(const_iterator it = begin(); it != end(); ++it) {
+      map[it->first] = it->second;
+    }
+    return map;
+  }
+
+  FeatureMap& TraxelFeatures::map() {
+    if(packed()) {
+      FeatureMap map = to_map();
+      map_.swap(map);
+      feature_array().swap(values_);
+      std::vector<unsigned int>().swap(offsets_);
+      std::vector<bool>().swap(present_);
+    }
+    return map_;
+  }
+
+  void TraxelFeatures::pack(const boost::shared_ptr<FeatureSchema>& schema) {
+    if(!schema) {
+      throw invalid_argument("TraxelFeatures::pack(): schema is null");
+    }
+    if(packed() && schema == schema_) {
+      return;
+    }
+    FeatureMap& features = map();
+
+    // register names first to know the extent of the offset table
+    vector<FeatureSchema::slot_type> slots;
+    slots.reserve(features.size());
+    size_t n_values = 0;
+    for(FeatureMap::const_iterator it = features.begin(); it != features.end(); ++it) {
+      slots.push_back(schema->intern(it->first));
+      n_values += it->second.size();
+    }
+    vector<unsigned int> sizes(schema->size() + 1, 0);
+    vector<bool> present(schema->size(), false);
+    {
+      vector<FeatureSchema::slot_type>::const_iterator slot = slots.begin();
+      for(FeatureMap::const_iterator it = features.begin(); it != features.end(); ++it, ++slot) {
+        sizes[*slot] = it->second.size();
+        present[*slot] = true;
+      }
+    }
+
+    // exclusive prefix sum over the sizes gives the offsets
+    vector<unsigned int> offsets(sizes.size(), 0);
+    for(size_t i = 1; i < sizes.size(); ++i) {
+      offsets[i] = offsets[i-1] + sizes[i-1];
+    }
+
+    feature_array values(n_values);
+    {
+      vector<FeatureSchema::slot_type>::const_iterator slot = slots.begin();
+      for(FeatureMap::const_iterator it = features.begin(); it != features.end(); ++it, ++slot) {
+        std::copy(it->second.begin(), it->second.end(), values.begin() + offsets[*slot]);
+      }
+    }
+    values_.swap(values);
+    offsets_.swap(offsets);
+    present_.swap(present);
+    FeatureMap().swap(map_);
+    schema_ = schema;
+  }
+
+  size_t TraxelFeatures::memory_bytes() const {
+    // a std::map node holds the color and three pointers besides the value
+    const size_t map_node = sizeof(FeatureMap::value_type) + 4 * sizeof(void*);
+    size_t bytes = 0;
+    for(FeatureMap::const_iterator it = map_.begin(); it != map_.end(); ++it) {
+      bytes += map_node + it->first.capacity() + it->second.capacity() * sizeof(feature_type);
+    }
+    bytes += values_.capacity() * sizeof(feature_type);
+    bytes += offsets_.capacity() * sizeof(unsigned int);
+    bytes += present_.capacity() / 8;
+    return bytes;
+  }
+
+  bool operator==(const TraxelFeatures& a, const TraxelFeatures& b) {
+    if(a.size() != b.size()) {
+      return false;
+    }
+    for(TraxelFeatures::const_iterator it = a.begin(); it != a.end(); ++it) {
+      TraxelFeatures::const_iterator other = b.find(it->first);
+      if(other == b.end() || other->second != it->second) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+
   ////
   //// class Locator
   ////
-  double Locator::coordinate_from(const FeatureMap& m, size_t idx) const {
+  double Locator::coordinate_from(const TraxelFeatures& m, size_t idx) const {
     if(is_applicable(m)) {
-      FeatureMap::const_iterator it;
+      TraxelFeatures::const_iterator it;
       it = m.find(feature_name_);
       return it->second[idx];
     } else {
       throw invalid_argument("Locator::coordinate_from(): FeatureMap is not applicable");    
     }
   }
+
+  bool Locator::equivalent(const Locator& other) const {
+    return typeid(*this) == typeid(other) && feature_name_ == other.feature_name_ &&
+      x_scale == other.x_scale && y_scale == other.y_scale && z_scale == other.z_scale;
+  }
     
 
   ////
   //// class Traxel
   ////
-  Traxel::Traxel(const Traxel& other): Id(other.Id), Timestep(other.Timestep), features(other.features) {
-    locator_ = other.locator_->clone();
-    corr_locator_ = other.corr_locator_;
-  }
-
-  Traxel& Traxel::operator=(const Traxel& other) {
-    Id = other.Id;
-    Timestep = other.Timestep;
-    features = other.features;
-    corr_locator_ = other.corr_locator_;
-    // This gracefully handles self assignment
-    Locator* temp = other.locator_->clone();
-    delete locator_;
-    locator_ = temp;
-    return *this;
+  namespace {
+    // shared by all traxels constructed without locators
+    const boost::shared_ptr<Locator>& default_locator() {
+      static const boost::shared_ptr<Locator> l(new ComLocator());
+      return l;
+    }
+    const boost::shared_ptr<ComCorrLocator>& default_corr_locator() {
+      static const boost::shared_ptr<ComCorrLocator> l(new ComCorrLocator());
+      return l;
+    }
+  }
+
+  Traxel::Traxel(unsigned int id, int timestep, FeatureMap fmap, Locator* l, ComCorrLocator* lc)
+    : Id(id), Timestep(timestep), features(fmap),
+      locator_(l ? boost::shared_ptr<Locator>(l) : default_locator()),
+      corr_locator_(lc ? boost::shared_ptr<ComCorrLocator>(lc) : default_corr_locator()),
+      coordinates_cached_(false) {
   }
 
   Traxel& Traxel::set_locator(Locator* l) {
-    delete locator_;
+    locator_.reset(l);
+    coordinates_cached_ = false;
+    return *this;
+  }
+
+  Traxel& Traxel::set_locator(const boost::shared_ptr<Locator>& l) {
     locator_ = l;
+    coordinates_cached_ = false;
+    return *this;
+  }
+
+  Locator* Traxel::locator() {
+    if(!locator_.unique()) {
+      locator_.reset(locator_->clone());
+    }
+    coordinates_cached_ = false;
+    return locator_.get();
+  }
+
+  Traxel& Traxel::cache_coordinates() {
+    // compute uncached, so that a stale cache is never read
+    coordinates_cached_ = false;
+    if(!locator_->is_applicable(features)) {
+      // nothing to cache; X() and friends report the error on use
+      return *this;
+    }
+    double coordinates[6];
+    coordinates[0] = X();
+    coordinates[1] = Y();
+    coordinates[2] = Z();
+    coordinates[3] = X_corr();
+    coordinates[4] = Y_corr();
+    coordinates[5] = Z_corr();
+    std::copy(coordinates, coordinates + 6, coordinates_);
+    coordinates_cached_ = true;
     return *this;
   }
 
+  Traxel& Traxel::intern_features(const boost::shared_ptr<FeatureSchema>& schema) {
+    if(!schema) {
+      throw invalid_argument("Traxel::intern_features(): schema is null");
+    }
+    features.pack(schema);
+    // interning usually follows a feature edit
+    return update_coordinate_cache();
+  }
+
+  Traxel& Traxel::set_feature(const std::string& name, const feature_array& value) {
+    const boost::shared_ptr<FeatureSchema> schema = features.schema();
+    features[name] = value;
+    return schema ? intern_features(schema) : update_coordinate_cache();
+  }
+
+  Traxel& Traxel::set_feature_value(const std::string& name, size_t i, feature_type value) {
+    if(features.packed()) {
+      const FeatureSchema::slot_type slot = features.schema()->slot(name);
+      if(i >= features.feature_size(slot)) {
+        throw out_of_range("Traxel::set_feature_value(): no value " + name + " at this index");
+      }
+      features.packed_value(slot, i) = value;
+      return update_coordinate_cache();
+    }
+    FeatureMap& map = features.map();
+    FeatureMap::iterator it = map.find(name);
+    if(it == map.end() || i >= it->second.size()) {
+      throw out_of_range("Traxel::set_feature_value(): no value " + name + " at this index");
+    }
+    it->second[i] = value;
+    // pack again after a direct edit
+    return features.schema() ? intern_features(features.schema()) : update_coordinate_cache();
+  }
+
+  Traxel& Traxel::keep_features(const std::vector<std::string>& names) {
+    std::vector<std::string> kept(names);
+    kept.push_back(locator_->feature_name());
+    kept.push_back(corr_locator_->feature_name());
+    FeatureMap map;
+    for(std::vector<std::string>::const_iterator name = kept.begin(); name != kept.end(); ++name) {
+      TraxelFeatures::const_iterator it = features.find(*name);
+      if(it != features.end()) {
+        map[it->first] = it->second;
+      }
+    }
+    const boost::shared_ptr<FeatureSchema> schema = features.schema();
+    features = TraxelFeatures(map);
+    return schema ? intern_features(schema) : update_coordinate_cache();
+  }
+
+  size_t Traxel::memory_bytes() const {
+    return sizeof(Traxel) + features.memory_bytes();
+  }
+
   double Traxel::X() const {
+    if(coordinates_cached_) return coordinates_[0];
     return locator_->X(features);
   }
 
   double Traxel::Y() const {
+    if(coordinates_cached_) return coordinates_[1];
     return locator_->Y(features);
   }
 
   double Traxel::Z() const {
+    if(coordinates_cached_) return coordinates_[2];
     return locator_->Z(features);
   }
 
   double Traxel::X_corr() const {
+    if(coordinates_cached_) return coordinates_[3];
 	if (features.count("com_corrected") == 1) {
 		return corr_locator_->X(features);
 	} else {
@@ -70,6 +396,7 @@ namespace pgmlink {
   }
 
   double Traxel::Y_corr() const {
+    if(coordinates_cached_) return coordinates_[4];
 	  if (features.count("com_corrected") == 1) {
 		return corr_locator_->Y(features);
 	} else {
@@ -78,6 +405,7 @@ namespace pgmlink {
   }
 
   double Traxel::Z_corr() const {
+    if(coordinates_cached_) return coordinates_[5];
 	  if (features.count("com_corrected") == 1) {
 		  return corr_locator_->Z(features);
 	  } else {
@@ -85,45 +413,38 @@ namespace pgmlink {
 	  }
   }
 
-  namespace {
-    double dot(double x1,double y1,double z1, double x2,double y2,double z2) {
-      return x1*x2 + y1*y2 + z1*z2;
-    }
-    double norm(double x,double y,double z) {
-      return sqrt(dot(x,y,z, x,y,z));
-    }
-  }
-
   double Traxel::distance_to(const Traxel& other) const {
-    return norm(other.X()-X(), other.Y()-Y(), other.Z()-Z());
+    return distance_to<3>(other);
   }
 
   double Traxel::distance_to_corr(const Traxel& other) const {
-      return norm(other.X()-X_corr(), other.Y()-Y_corr(), other.Z()-Z_corr());
-    }
+    return distance_to_corr<3>(other);
+  }
 
   double Traxel::angle(const Traxel& leg1, const Traxel& leg2) const {
-    double x0 = this->X();
-    double y0 = this->Y();
-    double z0 = this->Z();
-
-    double x1 = leg1.X();
-    double y1 = leg1.Y();
-    double z1 = leg1.Z();
-
-    double x2 = leg2.X();
-    double y2 = leg2.Y();
-    double z2 = leg2.Z();
-
-    double dx1 = x1 - x0;
-    double dy1 = y1 - y0;
-    double dz1 = z1 - z0;
-
-    double dx2 = x2 - x0;
-    double dy2 = y2 - y0;
-    double dz2 = z2 - z0;
+    return angle<3>(leg1, leg2);
+  }
 
-    return std::acos((dot(dx1, dy1, dz1, dx2, dy2, dz2))/(norm(dx1, dy1, dz1)*norm(dx2,dy2,dz2)));
+  ////
+  //// class FeatureReader
+  ////
+  FeatureReader::FeatureReader(const std::string& name, const boost::shared_ptr<FeatureSchema>& schema)
+    : name_(name), schema_(schema), slot_(schema ? schema->slot(name) : FeatureSchema::invalid_slot) {}
+
+  const feature_type* FeatureReader::operator()(const Traxel& t, size_t& size) const {
+    if(schema_ && t.feature_schema() == schema_) {
+      size = t.feature_size(slot_);
+      if(size > 0) {
+        return t.feature(slot_);
+      }
+    }
+    TraxelFeatures::const_iterator it = t.features.find(name_);
+    if(it == t.features.end() || it->second.empty()) {
+      size = 0;
+      return 0;
+    }
+    size = it->second.size();
+    return it->second.begin();
   }
 
   std::ostream& operator<< (std::ostream &out, const Traxel &t) {
@@ -153,70 +474,267 @@ namespace pgmlink {
   //
   // type TraxelStore
   //
-  std::vector<double> bounding_box(const TraxelStore& ts) {
-    std::vector<double> bb(8,0);
-    double lt,lx,ly,lz,ut,ux,uy,uz;
-    lt=0; lx=1; ly=2; lz=3; ut=4; ux=5; uy=6; uz=7;
-
-    TraxelStoreByTimestep::iterator it=ts.get<by_timestep>().begin();
-    bb[lt] = static_cast<double>(it->Timestep);
-    bb[lx] = it->X();
-    bb[ly] = it->Y();
-    bb[lz] = it->Z();
-    bb[ut] = static_cast<double>(it->Timestep);
-    bb[ux] = it->X();
-    bb[uy] = it->Y();
-    bb[uz] = it->Z();
-    ++it;
-
-    for(;
-	it!=ts.get<by_timestep>().end(); ++it) {
-      bb[lt] = min(bb[lt], static_cast<double>(it->Timestep));
-      bb[lx] = min(bb[lx], it->X());
-      bb[ly] = min(bb[ly], it->Y());
-      bb[lz] = min(bb[lz], it->Z());
-      bb[ut] = max(bb[ut], static_cast<double>(it->Timestep));
-      bb[ux] = max(bb[ux], it->X());
-      bb[uy] = max(bb[uy], it->Y());
-      bb[uz] = max(bb[uz], it->Z());
-    }
-
-    return bb;
+  namespace {
+    struct FeatureInterner {
+      FeatureInterner(const boost::shared_ptr<FeatureSchema>& schema, bool cache_coordinates = false)
+        : schema(schema), cache_coordinates(cache_coordinates) {}
+      void operator()(Traxel& t) const {
+        t.intern_features(schema);
+        if(cache_coordinates) t.cache_coordinates();
+      }
+      boost::shared_ptr<FeatureSchema> schema;
+      bool cache_coordinates;
+    };
+
+    struct LocatorSharer {
+      LocatorSharer(const boost::shared_ptr<Locator>& locator) : locator(locator) {}
+      void operator()(Traxel& t) const {
+        // equivalent locators give the same coordinates
+        const bool cached = t.has_coordinate_cache();
+        t.set_locator(locator);
+        if(cached) t.cache_coordinates();
+      }
+      boost::shared_ptr<Locator> locator;
+    };
+
+    struct CoordinateCacher {
+      CoordinateCacher(bool cache) : cache(cache) {}
+      void operator()(Traxel& t) const {
+        if(cache) t.cache_coordinates();
+        else t.drop_coordinate_cache();
+      }
+      bool cache;
+    };
+  }
+
+  void TraxelStore::intern_features() {
+    FeatureInterner interner(schema_);
+    for(iterator it = begin(); it != end(); ++it) {
+      modify(it, interner);
+    }
+  }
+
+  void TraxelStore::cache_coordinates() {
+    cache_coordinates_ = true;
+    CoordinateCacher cacher(true);
+    for(iterator it = begin(); it != end(); ++it) {
+      modify(it, cacher);
+    }
+  }
+
+  const boost::shared_ptr<Locator>& TraxelStore::shared_locator(const boost::shared_ptr<Locator>& l) {
+    for(size_t i = 0; i < locators_.size(); ++i) {
+      if(locators_[i] == l || locators_[i]->equivalent(*l)) {
+        return locators_[i];
+      }
+    }
+    // a private copy, so that the registered locator is never changed through a traxel
+    locators_.push_back(boost::shared_ptr<Locator>(l->clone()));
+    return locators_.back();
+  }
+
+  void TraxelStore::share_locators() {
+    for(iterator it = begin(); it != end(); ++it) {
+      const boost::shared_ptr<Locator>& l = shared_locator(it->locator_ptr());
+      if(l != it->locator_ptr()) {
+        modify(it, LocatorSharer(l));
+      }
+    }
+  }
+
+  void TraxelStore::drop_coordinate_caches() {
+    cache_coordinates_ = false;
+    CoordinateCacher dropper(false);
+    for(iterator it = begin(); it != end(); ++it) {
+      modify(it, dropper);
+    }
   }
 
   namespace {
-    template<typename ordered_index_t>
-    set<typename ordered_index_t::key_type> keys_in(const ordered_index_t& i) {
-      set<typename ordered_index_t::key_type> keys;
-      typename ordered_index_t::key_from_value key = i.key_extractor();
-      for(typename ordered_index_t::iterator it=i.begin();
-	  it!=i.end(); ++it) {
-	keys.insert(key(*it));
+    // lt lx ly lz ut ux uy uz
+    void extend_bounding_box(std::vector<double>& bb, const Traxel& t) {
+      const double p[4] = {static_cast<double>(t.Timestep), t.X(), t.Y(), t.Z()};
+      for(size_t i = 0; i < 4; ++i) {
+        bb[i] = min(bb[i], p[i]);
+        bb[i + 4] = max(bb[i + 4], p[i]);
+      }
+    }
+  }
+
+  void TraxelStore::invalidate_aggregates() {
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    {
+      ++generation_;
+      index_exposed_ = false;
+    }
+  }
+
+  void TraxelStore::drop_aggregates() {
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    ++generation_;
+  }
+
+  void TraxelStore::expose_index() {
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    {
+      ++generation_;
+      index_exposed_ = true;
+    }
+  }
+
+  std::vector<double> TraxelStore::bounding_box() const {
+    std::vector<double> ret;
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    {
+      if(index_exposed_ || bounding_box_generation_ != generation_) {
+        std::vector<double> bb(8, 0);
+        const_iterator it = begin();
+        if(it != end()) {
+          const double p[4] = {static_cast<double>(it->Timestep), it->X(), it->Y(), it->Z()};
+          std::copy(p, p + 4, bb.begin());
+          std::copy(p, p + 4, bb.begin() + 4);
+          for(++it; it != end(); ++it) {
+            extend_bounding_box(bb, *it);
+          }
+        }
+        bounding_box_.swap(bb);
+        bounding_box_generation_ = generation_;
+      }
+      ret = bounding_box_;
+    }
+    return ret;
+  }
+
+  std::map<int, size_t> TraxelStore::timestep_counts() const {
+    std::map<int, size_t> ret;
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    {
+      if(index_exposed_ || counts_generation_ != generation_) {
+        counts_.clear();
+        for(const_iterator it = begin(); it != end(); ++it) {
+          ++counts_[it->Timestep];
+        }
+        counts_generation_ = generation_;
+      }
+      ret = counts_;
+    }
+    return ret;
+  }
+
+  // keep the aggregates that are current at the new generation
+  void TraxelStore::aggregate_added(const Traxel& t) {
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    {
+      const unsigned long current = generation_++;
+      if(counts_generation_ == current) {
+        ++counts_[t.Timestep];
+        counts_generation_ = generation_;
+      }
+      // the box of the empty store is no box; an unlocatable traxel is
+      // reported when the bounding box is requested
+      if(bounding_box_generation_ == current && size() > 1 && t.locator()->is_applicable(t.features)) {
+        extend_bounding_box(bounding_box_, t);
+        bounding_box_generation_ = generation_;
       }
-      return keys;
     }
   }
 
+  void TraxelStore::aggregate_replaced(int old_timestep, const Traxel& t) {
+    #pragma omp critical(pgmlink_traxelstore_aggregates)
+    {
+      const unsigned long current = generation_++;
+      if(counts_generation_ == current) {
+        if(--counts_[old_timestep] == 0) {
+          counts_.erase(old_timestep);
+        }
+        ++counts_[t.Timestep];
+        counts_generation_ = generation_;
+      }
+      // the bounding box may shrink, so it is left stale
+    }
+  }
+
+  std::vector<double> bounding_box(const TraxelStore& ts) {
+    return ts.bounding_box();
+  }
+
   std::set<TraxelStoreByTimestep::key_type>
   timesteps(const TraxelStore& t) {
-    return keys_in(t.get<by_timestep>());
+    std::set<TraxelStoreByTimestep::key_type> keys;
+    const std::map<int, size_t> counts = t.timestep_counts();
+    for(std::map<int, size_t>::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+      keys.insert(keys.end(), it->first);
+    }
+    return keys;
   }
 
  TraxelStoreByTimestep::key_type
  earliest_timestep(const TraxelStore& t) {
-    return *(timesteps(t).begin());
+    if(t.empty()) {
+      throw runtime_error("earliest_timestep(): empty TraxelStore");
+    }
+    return t.timestep_counts().begin()->first;
  }
 
  TraxelStoreByTimestep::key_type
  latest_timestep(const TraxelStore& t) {
-    return *(timesteps(t).rbegin());
+    if(t.empty()) {
+      throw runtime_error("latest_timestep(): empty TraxelStore");
+    }
+    return t.timestep_counts().rbegin()->first;
  }
   
+  // add() and replace() maintain the aggregates themselves and work on
+  // the container past the invalidating interface of TraxelStore
   TraxelStore& add(TraxelStore& ts, const Traxel& t) {
-    ts.get<by_timestep>().insert(t);
+    TraxelStoreBase& base = ts;
+    std::pair<TraxelStoreByTimestep::iterator, bool> inserted = base.get<by_timestep>().insert(t);
+    if(inserted.second) {
+      const boost::shared_ptr<Locator>& l = ts.shared_locator(t.locator_ptr());
+      if(l != t.locator_ptr()) {
+        base.get<by_timestep>().modify(inserted.first, LocatorSharer(l));
+      }
+      base.get<by_timestep>().modify(inserted.first, FeatureInterner(ts.feature_schema_ptr(), ts.caches_coordinates()));
+      ts.aggregate_added(*inserted.first);
+    }
     return ts;
   }
 
+  bool add_interned(TraxelStore& ts, const Traxel& t) {
+    if(t.feature_schema() != ts.feature_schema_ptr()) {
+      throw invalid_argument("add_interned(): traxel is not interned with the schema of the store");
+    }
+    TraxelStoreBase& base = ts;
+    std::pair<TraxelStoreByTimestep::iterator, bool> inserted = base.get<by_timestep>().insert(t);
+    if(!inserted.second) {
+      return false;
+    }
+    const boost::shared_ptr<Locator>& l = ts.shared_locator(t.locator_ptr());
+    if(l != t.locator_ptr()) {
+      base.get<by_timestep>().modify(inserted.first, LocatorSharer(l));
+    }
+    if(ts.caches_coordinates() && !t.has_coordinate_cache()) {
+      base.get<by_timestep>().modify(inserted.first, CoordinateCacher(true));
+    }
+    ts.aggregate_added(*inserted.first);
+    return true;
+  }
+
+  bool replace(TraxelStore& ts, TraxelStore::iterator it, const Traxel& t) {
+    TraxelStoreBase& base = ts;
+    const int old_timestep = it->Timestep;
+    if(!base.replace(it, t)) {
+      return false;
+    }
+    const boost::shared_ptr<Locator>& l = ts.shared_locator(t.locator_ptr());
+    if(l != t.locator_ptr()) {
+      base.modify(it, LocatorSharer(l));
+    }
+    base.modify(it, FeatureInterner(ts.feature_schema_ptr(), ts.caches_coordinates()));
+    ts.aggregate_replaced(old_timestep, *it);
+    return true;
+  }
+
   std::vector<std::vector<Traxel> > nested_vec_from(const TraxelStore& t) {
     // determine offset and range of timesteps
     TraxelStoreByTimestep::key_type offset = earliest_timestep(t);
@@ -233,6 +751,17 @@ namespace pgmlink {
     return ret;
   }
 
+  size_t memory_bytes(const TraxelStore& ts) {
+    // a node of the ordered index has three pointers, one of the hashed
+    // index a pointer and a share of the bucket array
+    const size_t index_overhead = 5 * sizeof(void*);
+    size_t bytes = sizeof(TraxelStore);
+    for(TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+      bytes += it->memory_bytes() + index_overhead;
+    }
+    return bytes;
+  }
+
   size_t filter_by_fov( const TraxelStore& in, TraxelStore& out, const FieldOfView& fov ) {
     size_t n = 0;
     for(TraxelStore::iterator it = in.begin(); it != in.end(); ++it) {
@@ -0,0 +1,91 @@
+#define BOOST_TEST_MODULE arena_test
+
+#include <map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/arena.h"
+
+using namespace pgmlink;
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( Arena_allocate_and_rewind )
+{
+  Arena arena(64);
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 0u);
+  void* a = arena.allocate(1);
+  void* b = arena.allocate(24);
+  BOOST_CHECK(a != b);
+  BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(b) % 16, 0u);
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 48u);
+
+  const Arena::Mark m = arena.mark();
+  // larger than a block
+  arena.allocate(100);
+  arena.allocate(8);
+  BOOST_CHECK_GT(arena.bytes_used(), 48u + 100u);
+  arena.rewind(m);
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 48u);
+  BOOST_CHECK(arena.allocate(8) != b);
+
+  // the empty arena keeps one block of the capacity
+  const size_t capacity = arena.capacity();
+  arena.clear();
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 0u);
+  BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+  arena.allocate(capacity);
+  BOOST_CHECK_EQUAL(arena.capacity(), capacity);
+
+  // release() frees the blocks
+  arena.release();
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 0u);
+  BOOST_CHECK_EQUAL(arena.capacity(), 0u);
+  arena.allocate(8);
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 16u);
+  BOOST_CHECK_EQUAL(arena.capacity(), 64u);
+}
+
+BOOST_AUTO_TEST_CASE( ArenaAllocator_containers )
+{
+  Arena arena(256);
+  {
+    const ArenaScope scope(arena);
+    arena_vector<size_t>::type v((ArenaAllocator<size_t>(scope.arena())));
+    for (size_t i = 0; i < 1000; ++i) {
+      v.push_back(i);
+    }
+    BOOST_CHECK_EQUAL(v[999], 999u);
+    arena_vector<size_t>::type copy(v);
+    BOOST_CHECK(copy == v);
+
+    typedef map<int, double, less<int>, ArenaAllocator<pair<const int, double> > > ArenaMap;
+    ArenaMap m((less<int>()), ArenaAllocator<pair<const int, double> >(arena));
+    m[3] = 1.5;
+    m[1] = 2.5;
+    BOOST_CHECK_EQUAL(m.begin()->second, 2.5);
+    BOOST_CHECK_GT(arena.bytes_used(), 1000 * sizeof(size_t));
+  }
+  // the scope rewound the arena
+  BOOST_CHECK_EQUAL(arena.bytes_used(), 0u);
+  BOOST_CHECK_GT(arena.capacity(), 1000 * sizeof(size_t));
+
+  Arena& local = Arena::for_this_thread();
+  BOOST_CHECK_EQUAL(&local, &Arena::for_this_thread());
+}
+
+BOOST_AUTO_TEST_CASE( Arena_release_thread_arenas )
+{
+  Arena& local = Arena::for_this_thread();
+  {
+    const ArenaScope scope(local);
+    local.allocate(1 << 21);
+    // in use: kept
+    Arena::release_this_thread();
+    BOOST_CHECK_GE(local.capacity(), size_t(1 << 21));
+  }
+  BOOST_CHECK_GE(local.capacity(), size_t(1 << 21));
+  Arena::release_thread_arenas();
+  BOOST_CHECK_EQUAL(local.capacity(), 0u);
+  BOOST_CHECK_EQUAL(&local, &Arena::for_this_thread());
+}
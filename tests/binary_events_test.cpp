@@ -0,0 +1,151 @@
+#define BOOST_TEST_MODULE binary_events_test
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/binary_events.h"
+#include "pgmlink/event.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  Event make_event(Event::EventType type, size_t a, size_t b = 0, size_t c = 0, size_t n_ids = 1) {
+    Event e;
+    e.type = type;
+    const size_t ids[] = {a, b, c};
+    e.traxel_ids.assign(ids, ids + n_ids);
+    e.number_of_features(2);
+    vector<double> features(2), weights(2, 0.5);
+    features[0] = a;
+    features[1] = 1.5;
+    e.features(features).weights(weights);
+    return e;
+  }
+
+  vector<vector<Event> > make_events() {
+    vector<vector<Event> > events(4);
+    events[0].push_back(make_event(Event::Appearance, 1));
+    events[0].push_back(make_event(Event::Move, 2, 3, 0, 2));
+    events[0].push_back(make_event(Event::Move, 4, 5, 0, 2));
+    events[0].push_back(make_event(Event::Division, 6, 7, 8, 3));
+    events[0].push_back(make_event(Event::Move, 9, 10, 0, 2));
+    // slot 1 stays empty
+    events[2].push_back(make_event(Event::Merger, 3, 2, 0, 2));
+    events[2].push_back(make_event(Event::ResolvedTo, 3, 11, 12, 3));
+    events[2].push_back(make_event(Event::ResolvedTo, 4, 13, 0, 2));
+    events[3].push_back(make_event(Event::Disappearance, 5));
+    Event v;
+    events[3].push_back(v);
+    return events;
+  }
+
+  const char* filename = "binary_events_test.pgmlevts";
+}
+
+BOOST_AUTO_TEST_CASE( BinaryEvents_roundtrip )
+{
+  const vector<vector<Event> > events = make_events();
+  save_binary_events(events, filename);
+  const vector<vector<Event> > loaded = load_binary_events(filename);
+
+  BOOST_REQUIRE_EQUAL(loaded.size(), events.size());
+  for(size_t t = 0; t < events.size(); ++t) {
+    BOOST_REQUIRE_EQUAL(loaded[t].size(), events[t].size());
+    for(size_t i = 0; i < events[t].size(); ++i) {
+      // same order, type and ids; variable width events keep their length
+      BOOST_CHECK_EQUAL(loaded[t][i], events[t][i]);
+      BOOST_CHECK_EQUAL(loaded[t][i].traxel_ids.size(), events[t][i].traxel_ids.size());
+      BOOST_CHECK_CLOSE(loaded[t][i].energy() + 1, events[t][i].energy() + 1, 1e-9);
+    }
+  }
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( BinaryEvents_without_energies )
+{
+  const vector<vector<Event> > events = make_events();
+  save_binary_events(events, filename, false);
+  const vector<vector<Event> > loaded = load_binary_events(filename);
+  BOOST_REQUIRE_EQUAL(loaded.size(), events.size());
+  BOOST_REQUIRE_EQUAL(loaded[0].size(), events[0].size());
+  BOOST_CHECK_EQUAL(loaded[0][1], events[0][1]);
+  BOOST_CHECK_EQUAL(loaded[0][1].number_of_features(), 0u);
+  BOOST_CHECK_EQUAL(loaded[0][1].energy(), 0.);
+
+  // smaller than the text archive
+  ifstream binary(filename, ios::binary | ios::ate);
+  const streamoff binary_size = binary.tellg();
+  {
+    ofstream ofs("binary_events_test.txt");
+    boost::archive::text_oarchive out_archive(ofs);
+    out_archive << events;
+  }
+  ifstream text("binary_events_test.txt", ios::binary | ios::ate);
+  BOOST_CHECK_LT(binary_size, text.tellg());
+  remove("binary_events_test.txt");
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( BinaryEventWriter_as_sink )
+{
+  // repeated slots are merged by the reader like by EventVectorSink
+  {
+    BinaryEventWriter writer(filename);
+    vector<Event> events(1, make_event(Event::Move, 1, 2, 0, 2));
+    writer.timestep(0, events);
+    events.assign(1, make_event(Event::Appearance, 3));
+    writer.timestep(1, events);
+    events.assign(1, make_event(Event::Move, 4, 5, 0, 2));
+    writer.timestep(0, events);
+  }
+  const vector<vector<Event> > loaded = load_binary_events(filename);
+  BOOST_REQUIRE_EQUAL(loaded.size(), 2u);
+  BOOST_REQUIRE_EQUAL(loaded[0].size(), 2u);
+  BOOST_CHECK_EQUAL(loaded[0][1], make_event(Event::Move, 4, 5, 0, 2));
+  BOOST_CHECK_EQUAL(loaded[1].size(), 1u);
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( BinaryEvents_rejects_corrupt_blocks )
+{
+  using namespace binary_events;
+  // the first block record follows the header and the first slot record
+  const streamoff block_offset = sizeof(Header) + sizeof(SlotRecord);
+  const uint64_t counts[] = {~static_cast<uint64_t>(0), static_cast<uint64_t>(1) << 62, 1000};
+  const uint32_t widths[] = {2, 1 << 30, 0};
+  for(size_t c = 0; c < 3; ++c) {
+    for(size_t w = 0; w < 3; ++w) {
+      save_binary_events(make_events(), filename);
+      {
+        fstream f(filename, ios::in | ios::out | ios::binary);
+        BlockRecord block;
+        f.seekg(block_offset);
+        f.read(reinterpret_cast<char*>(&block), sizeof(BlockRecord));
+        block.count = counts[c];
+        block.width = widths[w];
+        f.seekp(block_offset);
+        f.write(reinterpret_cast<const char*>(&block), sizeof(BlockRecord));
+      }
+      BOOST_CHECK_THROW(load_binary_events(filename), std::runtime_error);
+    }
+  }
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( BinaryEvents_rejects_foreign_files )
+{
+  {
+    ofstream out(filename);
+    out << "not an event file, but long enough for a header";
+  }
+  BOOST_CHECK_THROW(load_binary_events(filename), std::runtime_error);
+  remove(filename);
+  BOOST_CHECK_THROW(load_binary_events("no_such_file.pgmlevts"), std::runtime_error);
+}
@@ -0,0 +1,187 @@
+#define BOOST_TEST_MODULE binary_traxelstore_test
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/tuple/tuple.hpp>
+
+#include "pgmlink/binary_traxelstore.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  TraxelStore make_store() {
+    TraxelStore ts;
+    for(int t = 3; t >= 0; --t) {
+      for(unsigned int id = 1; id <= 2; ++id) {
+        Traxel trax(id, t);
+        feature_array com(3);
+        com[0] = t; com[1] = id; com[2] = 0.5;
+        trax.features["com"] = com;
+        trax.features["count"] = feature_array(1, 10*t + id);
+        if(id == 2) {
+          trax.features["detProb"] = feature_array(2, 0.25);
+          trax.features["empty"] = feature_array();
+        }
+        add(ts, trax);
+      }
+    }
+    Traxel scaled(3, 2);
+    scaled.features["intmaxpos"] = feature_array(4, 1.);
+    scaled.set_locator(new IntmaxposLocator());
+    scaled.locator()->x_scale = 2.;
+    add(ts, scaled);
+    return ts;
+  }
+
+  const char* filename = "binary_traxelstore_test.pgmlts";
+}
+
+BOOST_AUTO_TEST_CASE( BinaryTraxelStore_roundtrip )
+{
+  TraxelStore ts = make_store();
+  save_binary(ts, filename);
+
+  TraxelStore loaded;
+  load_binary(loaded, filename);
+  BOOST_REQUIRE_EQUAL(loaded.size(), ts.size());
+  for(TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
+    TraxelStoreByTimeid::const_iterator l = loaded.get<by_timeid>().find(boost::make_tuple(it->Timestep, it->Id));
+    BOOST_REQUIRE(l != loaded.get<by_timeid>().end());
+    BOOST_CHECK(l->features == it->features);
+    BOOST_CHECK_EQUAL(l->X(), it->X());
+    BOOST_CHECK_EQUAL(l->Y(), it->Y());
+    BOOST_CHECK_EQUAL(l->Z(), it->Z());
+  }
+  // loaded traxels are interned as usual
+  FeatureSchema::slot_type det = loaded.feature_schema().slot("detProb");
+  BOOST_REQUIRE(det != FeatureSchema::invalid_slot);
+  BOOST_CHECK_EQUAL(loaded.get<by_timeid>().find(boost::make_tuple(1, 2))->feature_size(det), 2);
+  BOOST_CHECK_EQUAL(loaded.get<by_timeid>().find(boost::make_tuple(2, 3))->X(), 2.);
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( MappedTraxelStore_lazy_load )
+{
+  save_binary(make_store(), filename);
+  MappedTraxelStore mapped(filename);
+  BOOST_CHECK_EQUAL(mapped.size(), 9);
+  BOOST_REQUIRE_EQUAL(mapped.timesteps().size(), 4);
+  BOOST_CHECK_EQUAL(mapped.timesteps()[0], 0);
+  BOOST_CHECK_EQUAL(mapped.timesteps()[3], 3);
+  BOOST_CHECK_EQUAL(mapped.count(2), 3);
+  BOOST_CHECK_EQUAL(mapped.count(7), 0);
+  BOOST_CHECK_EQUAL(mapped.feature_names().size(), 5);
+
+  TraxelStore ts;
+  BOOST_CHECK_EQUAL(mapped.load(ts, 1, 2), 5);
+  BOOST_CHECK_EQUAL(ts.size(), 5);
+  BOOST_CHECK_EQUAL(earliest_timestep(ts), 1);
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 2);
+  BOOST_CHECK_EQUAL(mapped.load(ts, 5, 7), 0);
+  BOOST_CHECK_EQUAL(mapped.load(ts, 3, 3), 2);
+  BOOST_CHECK_EQUAL(ts.size(), 7);
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( MappedTraxelStore_rejects_foreign_files )
+{
+  {
+    ofstream out(filename);
+    out << "this is definitely not a binary traxelstore, but long enough to hold a header" << endl;
+  }
+  BOOST_CHECK_THROW(MappedTraxelStore mapped(filename), std::runtime_error);
+  remove(filename);
+}
+
+namespace {
+  // the saved test store with one patched value
+  template <typename T>
+  void patch_file(boost::uint64_t offset, T value) {
+    fstream file(filename, ios::in | ios::out | ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  binary_traxelstore::Header read_header() {
+    binary_traxelstore::Header header;
+    ifstream file(filename, ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return header;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( MappedTraxelStore_rejects_corrupt_tables )
+{
+  using namespace binary_traxelstore;
+  save_binary(make_store(), filename);
+  const Header header = read_header();
+  BOOST_REQUIRE_GT(header.n_timesteps, 1u);
+  BOOST_REQUIRE_GT(header.n_features, 0u);
+
+  // traxel range past the end of the traxel table
+  const boost::uint64_t second = header.timestep_index_offset + sizeof(TimestepRecord);
+  patch_file(second + offsetof(TimestepRecord, count), header.n_traxels);
+  BOOST_CHECK_THROW(MappedTraxelStore mapped(filename), std::runtime_error);
+
+  // unsorted timesteps
+  save_binary(make_store(), filename);
+  patch_file(second + offsetof(TimestepRecord, timestep), boost::int32_t(-1));
+  BOOST_CHECK_THROW(MappedTraxelStore mapped(filename), std::runtime_error);
+
+  // decreasing value offsets
+  save_binary(make_store(), filename);
+  FeatureRecord feature;
+  {
+    ifstream file(filename, ios::binary);
+    file.seekg(header.feature_table_offset);
+    file.read(reinterpret_cast<char*>(&feature), sizeof(feature));
+  }
+  patch_file(feature.offsets_offset + sizeof(boost::uint64_t), boost::uint64_t(1) << 40);
+  BOOST_CHECK_THROW(MappedTraxelStore mapped(filename), std::runtime_error);
+
+  // misaligned section
+  save_binary(make_store(), filename);
+  patch_file(offsetof(Header, traxel_table_offset), header.traxel_table_offset + 4);
+  BOOST_CHECK_THROW(MappedTraxelStore mapped(filename), std::runtime_error);
+
+  // unpatched files still open
+  save_binary(make_store(), filename);
+  BOOST_CHECK_NO_THROW(MappedTraxelStore mapped(filename));
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( StreamingTraxelStore_window )
+{
+  save_binary(make_store(), filename);
+  BOOST_CHECK_THROW(StreamingTraxelStore(filename, 0), std::invalid_argument);
+  StreamingTraxelStore streaming(filename, 2);
+  BOOST_CHECK_EQUAL(streaming.resident().size(), 0);
+  BOOST_CHECK_THROW(streaming.require(1, 0), std::invalid_argument);
+  BOOST_CHECK_THROW(streaming.require(0, 2), std::invalid_argument);
+
+  // moving forward
+  BOOST_CHECK_EQUAL(streaming.require(0, 0).size(), 4);
+  BOOST_CHECK(streaming.is_resident(0));
+  BOOST_CHECK(streaming.is_resident(1));
+  BOOST_CHECK(!streaming.is_resident(2));
+  BOOST_CHECK_EQUAL(streaming.require(2, 3).size(), 5);
+  BOOST_CHECK(!streaming.is_resident(0));
+  BOOST_CHECK(!streaming.is_resident(1));
+
+  // moving backward
+  const TraxelStore& ts = streaming.require(1, 1);
+  BOOST_CHECK_EQUAL(ts.size(), 4);
+  BOOST_CHECK(streaming.is_resident(0));
+  BOOST_CHECK(streaming.is_resident(1));
+  BOOST_CHECK(!streaming.is_resident(3));
+  BOOST_CHECK_EQUAL(ts.get<by_timeid>().count(boost::make_tuple(0, 1)), 1);
+  remove(filename);
+}
+
+// EOF
@@ -0,0 +1,121 @@
+#define BOOST_TEST_MODULE coordinate_provider_test
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/coordinate_provider.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  TimestepIdCoordinateMapPtr make_coordinates() {
+    TimestepIdCoordinateMapPtr coordinates(new TimestepIdCoordinateMap);
+    for(int t = 2; t >= 0; --t) {
+      for(unsigned id = 1; id <= 2; ++id) {
+        arma::mat& c = (*coordinates)[make_pair(t, id)];
+        c = arma::mat(2, id + 1);
+        for(unsigned col = 0; col < c.n_cols; ++col) {
+          c(0, col) = t;
+          c(1, col) = 10 * id + col;
+        }
+      }
+    }
+    return coordinates;
+  }
+
+  const char* filename = "coordinate_provider_test.pgmlcrd";
+
+  template <typename T>
+  void patch_file(boost::uint64_t offset, T value) {
+    fstream file(filename, ios::in | ios::out | ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  binary_coordinates::Header read_header() {
+    binary_coordinates::Header header;
+    ifstream file(filename, ios::binary);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return header;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( MapCoordinateProvider_lookup )
+{
+  TimestepIdCoordinateMapPtr coordinates = make_coordinates();
+  MapCoordinateProvider provider(coordinates);
+  CoordinatesPtr c = provider.coordinates(1, 2);
+  BOOST_REQUIRE(c);
+  // no copy of the map entry
+  BOOST_CHECK_EQUAL(c->memptr(), (*coordinates)[make_pair(1, 2u)].memptr());
+  BOOST_CHECK(!provider.coordinates(3, 1));
+}
+
+BOOST_AUTO_TEST_CASE( MappedCoordinateFile_roundtrip )
+{
+  TimestepIdCoordinateMapPtr coordinates = make_coordinates();
+  save_coordinates(*coordinates, filename);
+  {
+    MappedCoordinateFile mapped(filename);
+    BOOST_CHECK_EQUAL(mapped.size(), coordinates->size());
+    for(TimestepIdCoordinateMap::const_iterator it = coordinates->begin(); it != coordinates->end(); ++it) {
+      CoordinatesPtr c = mapped.coordinates(it->first.first, it->first.second);
+      BOOST_REQUIRE(c);
+      BOOST_REQUIRE_EQUAL(c->n_rows, it->second.n_rows);
+      BOOST_REQUIRE_EQUAL(c->n_cols, it->second.n_cols);
+      BOOST_CHECK_EQUAL_COLLECTIONS(c->memptr(), c->memptr() + c->n_elem,
+                                    it->second.memptr(), it->second.memptr() + it->second.n_elem);
+    }
+    BOOST_CHECK(!mapped.coordinates(0, 3));
+    BOOST_CHECK(!mapped.coordinates(5, 1));
+  }
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( MappedCoordinateFile_rejects_corrupt_index )
+{
+  using namespace binary_coordinates;
+  TimestepIdCoordinateMapPtr coordinates = make_coordinates();
+  save_coordinates(*coordinates, filename);
+  const Header header = read_header();
+  BOOST_REQUIRE_GT(header.n_entries, 1u);
+  const boost::uint64_t second = header.index_offset + sizeof(EntryRecord);
+
+  // unsorted index
+  patch_file(second + offsetof(EntryRecord, timestep), boost::int32_t(-1));
+  BOOST_CHECK_THROW(MappedCoordinateFile mapped(filename), std::runtime_error);
+
+  // n_rows * n_cols * 8 overflows
+  save_coordinates(*coordinates, filename);
+  patch_file(second + offsetof(EntryRecord, n_cols), (boost::uint64_t(1) << 62) + 1);
+  BOOST_CHECK_THROW(MappedCoordinateFile mapped(filename), std::runtime_error);
+
+  // misaligned index
+  save_coordinates(*coordinates, filename);
+  patch_file(offsetof(Header, index_offset), header.index_offset - 4);
+  BOOST_CHECK_THROW(MappedCoordinateFile mapped(filename), std::runtime_error);
+
+  // unpatched files still open
+  save_coordinates(*coordinates, filename);
+  BOOST_CHECK_NO_THROW(MappedCoordinateFile mapped(filename));
+  remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE( CoordinateFileWriter_duplicate )
+{
+  {
+    CoordinateFileWriter writer(filename);
+    writer.add(0, 1, arma::mat(2, 1));
+    writer.add(0, 1, arma::mat(2, 2));
+    BOOST_CHECK_THROW(writer.close(), runtime_error);
+  }
+  remove(filename);
+}
+
+// EOF
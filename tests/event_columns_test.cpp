@@ -0,0 +1,64 @@
+#define BOOST_TEST_MODULE event_columns_test
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/event_columns.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  Event make_event(Event::EventType type, size_t a, size_t b = 0, size_t c = 0, size_t n_ids = 1) {
+    Event e;
+    e.type = type;
+    const size_t ids[] = {a, b, c};
+    e.traxel_ids.assign(ids, ids + n_ids);
+    return e;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( EventColumns_tables )
+{
+  vector<vector<Event> > events(2);
+  events[0].push_back(make_event(Event::Move, 1, 2, 0, 2));
+  events[0].push_back(make_event(Event::Division, 3, 4, 5, 3));
+  events[1].push_back(make_event(Event::Move, 2, 7, 0, 2));
+  events[1].push_back(make_event(Event::Appearance, 9));
+  // ResolvedTo events differ in length
+  events[1].push_back(make_event(Event::ResolvedTo, 8, 11, 0, 2));
+  events[1].push_back(make_event(Event::ResolvedTo, 6, 12, 13, 3));
+  events[0][0].number_of_features(1).features(vector<double>(1, 2.)).weights(vector<double>(1, 3.));
+
+  EventColumns columns(5);
+  columns.add(events);
+  BOOST_CHECK_EQUAL(columns.size(), 6);
+  BOOST_CHECK_EQUAL(columns.table(Event::Disappearance).size(), 0);
+
+  const EventColumns::Table& moves = columns.table(Event::Move);
+  BOOST_REQUIRE_EQUAL(moves.size(), 2);
+  BOOST_CHECK_EQUAL(moves.width(), 2);
+  BOOST_CHECK_EQUAL(moves.timesteps()[0], 5);
+  BOOST_CHECK_EQUAL(moves.timesteps()[1], 6);
+  BOOST_CHECK_EQUAL(moves.energies()[0], 6.);
+  BOOST_CHECK_EQUAL(moves.energies()[1], 0.);
+  const vector<boost::uint64_t> move_ids = moves.ids();
+  const boost::uint64_t should_move_ids[] = {1, 2, 2, 7};
+  BOOST_CHECK_EQUAL_COLLECTIONS(move_ids.begin(), move_ids.end(), should_move_ids, should_move_ids + 4);
+
+  const vector<boost::uint64_t> resolved_ids = columns.table(Event::ResolvedTo).ids();
+  const boost::uint64_t should_resolved_ids[] = {8, 11, EventColumns::missing_id, 6, 12, 13};
+  BOOST_CHECK_EQUAL_COLLECTIONS(resolved_ids.begin(), resolved_ids.end(), should_resolved_ids, should_resolved_ids + 6);
+
+  // as a sink
+  EventColumns sunk;
+  for(size_t slot = 0; slot < events.size(); ++slot) {
+    sunk.timestep(slot, events[slot]);
+  }
+  BOOST_CHECK_EQUAL(sunk.table(Event::Division).size(), 1);
+  BOOST_CHECK_EQUAL(sunk.table(Event::Division).timesteps()[0], 0);
+  BOOST_CHECK_EQUAL(sunk.table(Event::Division).width(), 3);
+}
+
+// EOF
@@ -6,6 +6,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <utility>
+#include <vector>
 
 // boost
 #include <boost/shared_ptr.hpp>
@@ -79,6 +80,70 @@ BOOST_AUTO_TEST_CASE( FeatureExtractor_Test_2_Traxels )
 }
 
 
+BOOST_AUTO_TEST_CASE( FeatureCalculator_batch )
+{
+  const char* names[] = {"ElementWiseSquaredDistance", "AbsoluteDifference", "SquareRooteSquaredDifference",
+                         "Ratio", "AsymmetricRatio", "SquaredDifference"};
+  const size_t n = 4, size = 3, stride = 5;
+  pgmlink::feature_array f1, f2;
+  for (size_t i = 0; i < n * size; ++i) {
+    f1.push_back( 0.5f * i );
+    f2.push_back( i % 2 ? 0.5f * i : 2.f );
+  }
+  for (size_t c = 0; c < 6; ++c) {
+    boost::shared_ptr<fe::FeatureCalculator> calc = fe::helpers::CalculatorLookup::extract_calculator( names[c] );
+    BOOST_REQUIRE_EQUAL( calc->output_size( size ), size );
+    pgmlink::feature_array out( n * stride, -1.f );
+    calc->calculate_batch( &f1[0], &f2[0], n, size, &out[0], stride );
+    for (size_t i = 0; i < n; ++i) {
+      pgmlink::feature_array single = calc->calculate( pgmlink::feature_array( f1.begin() + i * size, f1.begin() + (i + 1) * size ),
+                                                       pgmlink::feature_array( f2.begin() + i * size, f2.begin() + (i + 1) * size ) );
+      BOOST_CHECK_EQUAL_COLLECTIONS( out.begin() + i * stride, out.begin() + i * stride + size, single.begin(), single.end() );
+      // the padding of the rows is left alone
+      BOOST_CHECK_EQUAL( out[i * stride + size], -1.f );
+    }
+  }
+
+  boost::shared_ptr<fe::FeatureCalculator> identity = fe::helpers::CalculatorLookup::extract_calculator( "Identity" );
+  pgmlink::feature_array out( n * size );
+  identity->calculate_batch( &f1[0], n, size, &out[0], size );
+  BOOST_CHECK_EQUAL_COLLECTIONS( out.begin(), out.end(), f1.begin(), f1.end() );
+
+  // the default goes through calculate()
+  fe::FeatureCalculator calc;
+  BOOST_CHECK_THROW( calc.calculate_batch( &f1[0], &f2[0], n, size, &out[0], size ), std::runtime_error );
+}
+
+
+BOOST_AUTO_TEST_CASE( FeatureExtractor_batch )
+{
+  std::vector<pgmlink::Traxel> traxels( 3 );
+  for (size_t i = 0; i < traxels.size(); ++i) {
+    traxels[i].features["feat"] = pgmlink::feature_array( 2, float(i) );
+  }
+  std::vector<fe::FeatureExtractor::TraxelPair> pairs;
+  pairs.push_back( std::make_pair( &traxels[0], &traxels[1] ) );
+  pairs.push_back( std::make_pair( &traxels[0], &traxels[2] ) );
+
+  fe::FeatureExtractor e( fe::helpers::CalculatorLookup::extract_calculator( "ElementWiseSquaredDistance" ), "feat" );
+  pgmlink::feature_array out;
+  BOOST_CHECK_EQUAL( e.extract( pairs, out ), 2u );
+  float expected[] = {1.f, 1.f, 4.f, 4.f};
+  BOOST_CHECK_EQUAL_COLLECTIONS( out.begin(), out.end(), expected, expected + 4 );
+
+  std::vector<const pgmlink::Traxel*> singles;
+  singles.push_back( &traxels[2] );
+  fe::FeatureExtractor identity( fe::helpers::CalculatorLookup::extract_calculator( "Identity" ), "feat" );
+  BOOST_CHECK_EQUAL( identity.extract( singles, out ), 2u );
+  BOOST_CHECK_EQUAL_COLLECTIONS( out.begin(), out.end(), traxels[2].features["feat"].begin(), traxels[2].features["feat"].end() );
+
+  traxels[1].features["feat"].push_back( 0.f );
+  BOOST_CHECK_THROW( e.extract( pairs, out ), std::runtime_error );
+  traxels[1].features.clear();
+  BOOST_CHECK_THROW( e.extract( pairs, out ), std::runtime_error );
+}
+
+
 BOOST_AUTO_TEST_CASE( CalculatorLookup ) {
   boost::shared_ptr<fe::FeatureCalculator> calc = fe::helpers::CalculatorLookup::extract_calculator( "ElementWiseSquaredDistance" );
   BOOST_CHECK_EQUAL( calc->name(), "squared distance" );
@@ -135,3 +200,70 @@ BOOST_AUTO_TEST_CASE( MultipleFeatureExtraction ) {
   }
 }
 
+
+BOOST_AUTO_TEST_CASE( FeatureExtractionPlan_pairs ) {
+  fe::MultipleFeatureExtraction::FeatureList flist;
+  flist["ElementWiseSquaredDistance"].push_back( "feat" );
+  flist["SquaredDifference"].push_back( "feat" );
+  flist["SquaredDifference"].push_back( "other" );
+  flist["Ratio"].push_back( "other" );
+
+  std::vector<pgmlink::Traxel> traxels( 3 );
+  for (size_t i = 0; i < traxels.size(); ++i) {
+    traxels[i].features["feat"] = pgmlink::feature_array( 2, float(i) );
+    traxels[i].features["other"] = pgmlink::feature_array( 3, float(2 * i + 1) );
+  }
+  std::vector<fe::FeatureExtractor::TraxelPair> pairs;
+  pairs.push_back( std::make_pair( &traxels[0], &traxels[1] ) );
+  pairs.push_back( std::make_pair( &traxels[2], &traxels[1] ) );
+
+  boost::shared_ptr<pgmlink::FeatureSchema> schema( new pgmlink::FeatureSchema );
+  // the second traxel of each pair is read by slots
+  traxels[1].intern_features( schema );
+  fe::FeatureExtractionPlan plan( flist, schema );
+  BOOST_CHECK( !plan.has_layout() );
+  pgmlink::feature_array out;
+  BOOST_CHECK_EQUAL( plan( pairs, out ), 2u + 2u + 3u + 3u );
+  BOOST_REQUIRE_EQUAL( plan.size(), 4u );
+  BOOST_CHECK_EQUAL( out.size(), 2 * plan.row_size() );
+
+  fe::MultipleFeatureExtraction ex;
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    fe::MultipleFeatureExtraction::CombinedFeatureMap expected = ex( flist, *pairs[i].first, *pairs[i].second );
+    fe::MultipleFeatureExtraction::CombinedFeatureMap row = plan.row( out, i );
+    BOOST_REQUIRE_EQUAL( row.size(), expected.size() );
+    for ( fe::MultipleFeatureExtraction::CombinedFeatureMap::const_iterator res = row.begin(), comp = expected.begin();
+          res != row.end();
+          ++res, ++comp ) {
+      BOOST_REQUIRE( res->first == comp->first );
+      BOOST_CHECK_EQUAL_COLLECTIONS( res->second.begin(), res->second.end(), comp->second.begin(), comp->second.end() );
+    }
+  }
+  BOOST_CHECK_THROW( plan.row( out, 2 ), std::out_of_range );
+
+  // the layout is fixed
+  traxels[2].features["other"].push_back( 1.f );
+  BOOST_CHECK_THROW( plan( pairs, out ), std::runtime_error );
+
+  flist["NoSuchCalculator"].push_back( "feat" );
+  BOOST_CHECK_THROW( fe::FeatureExtractionPlan broken( flist ), std::runtime_error );
+}
+
+
+BOOST_AUTO_TEST_CASE( FeatureExtractionPlan_unary ) {
+  fe::MultipleFeatureExtraction::FeatureList flist;
+  flist["Identity"].push_back( "feat" );
+  flist["Identity"].push_back( "other" );
+  pgmlink::Traxel t;
+  t.features["feat"] = pgmlink::feature_array( 2, 1.f );
+  t.features["other"] = pgmlink::feature_array( 1, 2.f );
+  std::vector<const pgmlink::Traxel*> traxels( 2, &t );
+
+  fe::FeatureExtractionPlan plan( flist );
+  pgmlink::feature_array out;
+  BOOST_CHECK_EQUAL( plan( traxels, out ), 3u );
+  float expected[] = {1.f, 1.f, 2.f, 1.f, 1.f, 2.f};
+  BOOST_CHECK_EQUAL_COLLECTIONS( out.begin(), out.end(), expected, expected + 6 );
+  BOOST_CHECK_EQUAL( plan.offset( 1 ), 2u );
+  BOOST_CHECK( plan.name( 1 ) == std::make_pair( std::string("Identity"), std::string("other") ) );
+}
@@ -0,0 +1,67 @@
+#define BOOST_TEST_MODULE feature_stage_test
+
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/tuple/tuple.hpp>
+
+#include "pgmlink/feature_stage.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  // squares the count feature through a per thread buffer
+  struct SquaredCount {
+    typedef vector<feature_type> scratch_type;
+    void operator()(const Traxel&, FeatureMap& features, scratch_type& buffer) const {
+      FeatureMap::const_iterator it = features.find("count");
+      if(it == features.end()) {
+        throw runtime_error("SquaredCount: no count");
+      }
+      buffer.assign(it->second.begin(), it->second.end());
+      for(size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] *= buffer[i];
+      }
+      // the buffer is never shrunk, so its capacity records earlier traxels
+      features["squared_count"] = feature_array(buffer.begin(), buffer.end());
+      features["capacity"] = feature_array(1, buffer.capacity());
+    }
+  };
+}
+
+BOOST_AUTO_TEST_CASE( FeatureStage_run )
+{
+  TraxelStore ts;
+  for(int t = 0; t < 20; ++t) {
+    for(unsigned int id = 0; id < 3; ++id) {
+      Traxel trax(id, t);
+      trax.features["count"] = feature_array(id + 1, t);
+      add(ts, trax);
+    }
+  }
+
+  FeatureStage<SquaredCount> stage("squared count", SquaredCount());
+  BOOST_CHECK(stage.parallel());
+  stage(ts);
+  FeatureSchema::slot_type slot = ts.feature_schema().slot("squared_count");
+  BOOST_REQUIRE(slot != FeatureSchema::invalid_slot);
+  for(TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+    BOOST_REQUIRE_EQUAL(it->feature_size(slot), it->Id + 1);
+    BOOST_CHECK_EQUAL(it->feature(slot)[0], it->Timestep * it->Timestep);
+  }
+
+  // scratch persists across the traxels of a thread
+  feature_stage("serial", SquaredCount(), false)(ts, 0, 1);
+  const Traxel& first = *ts.get<by_timeid>().find(boost::make_tuple(0, 0));
+  BOOST_CHECK_EQUAL(first.features.find("capacity")->second[0], 1);
+  const Traxel& later = *ts.get<by_timeid>().find(boost::make_tuple(1, 0));
+  BOOST_CHECK_EQUAL(later.features.find("capacity")->second[0], 3);
+
+  add(ts, Traxel(5, 21));
+  BOOST_CHECK_THROW(stage(ts), std::runtime_error);
+}
+
+// EOF
@@ -1,6 +1,7 @@
 #define BOOST_TEST_MODULE energy_test
 
 #include <iostream>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
@@ -47,6 +48,51 @@ BOOST_AUTO_TEST_CASE( GeometryDivision_operator )
 }
 
 
+BOOST_AUTO_TEST_CASE( DivisionGeometry_score_pairs )
+{
+    // the ancestor at the origin, children around it; the last one sits
+    // on the ancestor and has no angle to the others
+    const double coms[][3] = { { 0, 0, 0 }, { 3, 1, 2 }, { -2, 1, 5 }, { 4, 0.5, -1 },
+                               { -1, -3, 0.5 }, { 2.5, 2, 3 }, { 0, 0, 0 } };
+    Traxel ancestor;
+    ancestor.features["com"] = feature_array(coms[0], coms[0] + 3);
+    vector<Traxel> children(6);
+    vector<const Traxel*> child_ptrs;
+    for (size_t i = 0; i < children.size(); ++i) {
+        children[i].features["com"] = feature_array(coms[i + 1], coms[i + 1] + 3);
+        child_ptrs.push_back(&children[i]);
+    }
+
+    const double min_angles[] = { 0., 0.3, 0.55, 1.5 };
+    vector<double> pairs;
+    for (int dimensions = 2; dimensions <= 3; ++dimensions) {
+        for (int a = 0; a < 4; ++a) {
+            for (int dependence = 0; dependence < 2; ++dependence) {
+                GeometryDivision2 division(2.5, min_angles[a], dependence, true, dimensions);
+                division.score_pairs(ancestor, child_ptrs, pairs);
+                BOOST_REQUIRE_EQUAL(pairs.size(), 15u);
+                size_t p = 0;
+                for (size_t i = 0; i < children.size(); ++i) {
+                    for (size_t j = i + 1; j < children.size(); ++j, ++p) {
+                        BOOST_CHECK_CLOSE(pairs[p], division(ancestor, children[i], children[j]), 1e-9);
+                    }
+                }
+            }
+        }
+    }
+
+    KasterDivision2 kaster(2., 10.);
+    kaster.score_pairs(ancestor, child_ptrs, pairs);
+    BOOST_REQUIRE_EQUAL(pairs.size(), 15u);
+    BOOST_CHECK_EQUAL(pairs[0], kaster(ancestor, children[0], children[1]));
+    BOOST_CHECK_EQUAL(pairs[14], kaster(ancestor, children[4], children[5]));
+
+    // fewer than two children have no pairs
+    child_ptrs.resize(1);
+    kaster.score_pairs(ancestor, child_ptrs, pairs);
+    BOOST_CHECK(pairs.empty());
+}
+
 BOOST_AUTO_TEST_CASE( SpatialDistanceToBorder )
 {
     Traxel t1, t2, t3, t4, t5, t6;
@@ -118,4 +164,49 @@ BOOST_AUTO_TEST_CASE( SpatialDistanceToBorder )
 	BOOST_CHECK_EQUAL(cost_fn(t6), 25.);
 }
 
+BOOST_AUTO_TEST_CASE( SpatialBorderAwareWeight_stored_distances )
+{
+    FieldOfView fov(0, 0, 0, 0, 1, 10, 12, 6); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+
+    TraxelStore ts;
+    const double positions[][3] = { {1, 1, 0}, {1, 10, 3}, {5, 5, 5}, {8, 8, 1}, {0.5, 7, 2}, {9.5, 11, 3} };
+    for (unsigned i = 0; i < 6; ++i) {
+        Traxel t;
+        t.Id = i + 1;
+        t.Timestep = 0;
+        t.features["com"] = feature_array(positions[i], positions[i] + 3);
+        add(ts, t);
+    }
+
+    // the batch gives the distances of the single points
+    vector<double> xyz, distances(6);
+    for (unsigned i = 0; i < 6; ++i) {
+        xyz.insert(xyz.end(), positions[i], positions[i] + 3);
+    }
+    for (int relative = 0; relative < 2; ++relative) {
+        fov.spatial_distances_to_border(&xyz[0], 6, relative, &distances[0]);
+        for (unsigned i = 0; i < 6; ++i) {
+            BOOST_CHECK_EQUAL(distances[i], fov.spatial_distance_to_border(0, positions[i][0], positions[i][1], positions[i][2], relative));
+        }
+    }
+
+    const boost::shared_ptr<const BorderDistances> border_distances(new BorderDistances(ts, fov, false));
+    BOOST_CHECK_EQUAL(border_distances->size(), 6u);
+    const double cost = 100, border_width = 2;
+    SpatialBorderAwareWeight computed(cost, border_width, false, fov);
+    SpatialBorderAwareWeight stored(cost, border_width, false, fov);
+    stored.use_border_distances(border_distances);
+    for (TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+        // the store itself is left alone
+        BOOST_CHECK_EQUAL(it->features.count("border_distance"), 0u);
+        BOOST_CHECK_CLOSE(stored(*it), computed(*it), 1e-4);
+    }
+
+    // traxels not in the store are computed
+    Traxel other;
+    other.Id = 7;
+    other.features["com"] = feature_array(positions[0], positions[0] + 3);
+    BOOST_CHECK_EQUAL(stored(other), computed(other));
+}
+
 // EOF
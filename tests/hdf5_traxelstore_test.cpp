@@ -0,0 +1,92 @@
+#define BOOST_TEST_MODULE hdf5_traxelstore_test
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/tuple/tuple.hpp>
+
+#include <vigra/hdf5impex.hxx>
+#include <vigra/multi_array.hxx>
+
+#include "pgmlink/hdf5_traxelstore.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  const char* filename = "hdf5_traxelstore_test.h5";
+
+  // two objects per timestep; timestep 1 is labeled explicitly
+  void write_tables() {
+    vigra::HDF5File f(filename, vigra::HDF5File::New);
+    for(int t = 0; t < 3; ++t) {
+      const string group = "/objects/" + string(1, '0' + t);
+      vigra::MultiArray<2, float> com(vigra::MultiArrayShape<2>::type(3, 2));
+      vigra::MultiArray<1, float> count(vigra::MultiArrayShape<1>::type(2));
+      for(int o = 0; o < 2; ++o) {
+        com(0, o) = t;
+        com(1, o) = o;
+        com(2, o) = 0.5;
+        count(o) = 10 * t + o;
+      }
+      f.write(group + "/com", com);
+      f.write(group + "/count", count);
+      if(t == 1) {
+        vigra::MultiArray<1, vigra::UInt32> ids(vigra::MultiArrayShape<1>::type(2));
+        ids(0) = 7;
+        ids(1) = 9;
+        f.write(group + "/ids", ids);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( load_hdf5_tables )
+{
+  write_tables();
+  TraxelStore ts;
+  HDF5TraxelStoreOptions options;
+  options.timesteps_per_chunk = 2;
+  BOOST_CHECK_EQUAL(load_hdf5(ts, filename, options), 6);
+  BOOST_CHECK_EQUAL(ts.size(), 6);
+  BOOST_CHECK_EQUAL(earliest_timestep(ts), 0);
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 2);
+
+  const TraxelStoreByTimeid& by_id = ts.get<by_timeid>();
+  BOOST_REQUIRE_EQUAL(by_id.count(boost::make_tuple(2, 2)), 1);
+  const Traxel& t = *by_id.find(boost::make_tuple(2, 2));
+  BOOST_CHECK_EQUAL(t.X(), 2.);
+  BOOST_CHECK_EQUAL(t.Y(), 1.);
+  BOOST_CHECK_EQUAL(t.Z(), 0.5);
+  BOOST_REQUIRE_EQUAL(t.features.find("count")->second.size(), 1);
+  BOOST_CHECK_EQUAL(t.features.find("count")->second[0], 21.);
+  BOOST_CHECK_EQUAL(t.features.count("ids"), 0);
+
+  // explicit ids
+  BOOST_CHECK_EQUAL(by_id.count(boost::make_tuple(1, 7)), 1);
+  BOOST_CHECK_EQUAL(by_id.count(boost::make_tuple(1, 9)), 1);
+  BOOST_CHECK_EQUAL(by_id.count(boost::make_tuple(1, 1)), 0);
+
+  // selected features
+  TraxelStore selected;
+  options.features.push_back("count");
+  BOOST_CHECK_EQUAL(load_hdf5(selected, filename, options), 6);
+  BOOST_CHECK_EQUAL(selected.begin()->features.size(), 1);
+
+  // a relative group is resolved against the file root, not against the
+  // group of the previous timestep
+  TraxelStore relative;
+  HDF5TraxelStoreOptions relative_options;
+  relative_options.group = "objects";
+  BOOST_CHECK_EQUAL(load_hdf5(relative, filename, relative_options), 6);
+  BOOST_CHECK_EQUAL(latest_timestep(relative), 2);
+
+  options.timesteps_per_chunk = 0;
+  BOOST_CHECK_THROW(load_hdf5(selected, filename, options), std::invalid_argument);
+  remove(filename);
+}
+
+// EOF
@@ -0,0 +1,91 @@
+#define BOOST_TEST_MODULE hypotheses_snapshot_test
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <lemon/core.h>
+
+#include "pgmlink/hypotheses.h"
+#include "pgmlink/hypotheses_snapshot.h"
+
+using namespace pgmlink;
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( HypothesesGraphSnapshot_adjacency ) {
+    // t0: a, b
+    // t1: c, d
+    // t2: e
+    HypothesesGraph g;
+    g.add(arc_distance());
+    HypothesesGraph::Node a = g.add_node(0);
+    HypothesesGraph::Node b = g.add_node(0);
+    HypothesesGraph::Node c = g.add_node(1);
+    HypothesesGraph::Node d = g.add_node(1);
+    HypothesesGraph::Node e = g.add_node(2);
+    HypothesesGraph::Arc ad = g.addArc(a, d);
+    g.addArc(a, c);
+    g.addArc(b, d);
+    g.addArc(c, e);
+    HypothesesGraph::Arc de = g.addArc(d, e);
+
+    // erased items are not in the snapshot
+    HypothesesGraph::Node erased = g.add_node(2);
+    g.addArc(d, erased);
+    g.erase(erased);
+
+    property_map<arc_distance, HypothesesGraph::base_graph>::type& dist = g.get(arc_distance());
+    dist.set(ad, 3.);
+    dist.set(de, 7.);
+    property_map<arc_to_timestep, HypothesesGraph::base_graph>::type& to = g.get(arc_to_timestep());
+    to[de] = 2;
+
+    const HypothesesGraphSnapshot s(g);
+    BOOST_CHECK_EQUAL(s.node_count(), 5u);
+    BOOST_CHECK_EQUAL(s.arc_count(), 5u);
+
+    // same order as the lemon iterators
+    size_t i = 0;
+    for(HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n, ++i) {
+        BOOST_REQUIRE(i < s.node_count());
+        BOOST_CHECK(s.node(i) == n);
+        BOOST_CHECK_EQUAL(s.node_index(n), i);
+        BOOST_CHECK_EQUAL(s.node_timesteps()[i], g.get(node_timestep())[n]);
+
+        size_t k = s.out_begin(i);
+        for(HypothesesGraph::OutArcIt arc(g, n); arc != lemon::INVALID; ++arc, ++k) {
+            BOOST_REQUIRE(k < s.out_end(i));
+            BOOST_CHECK(s.arc(k) == arc);
+            BOOST_CHECK_EQUAL(s.arc_index(arc), k);
+            BOOST_CHECK_EQUAL(s.source(k), i);
+            BOOST_CHECK(s.node(s.target(k)) == g.target(arc));
+        }
+        BOOST_CHECK_EQUAL(k, s.out_end(i));
+
+        size_t j = s.in_begin(i);
+        for(HypothesesGraph::InArcIt arc(g, n); arc != lemon::INVALID; ++arc, ++j) {
+            BOOST_REQUIRE(j < s.in_end(i));
+            BOOST_CHECK(s.arc(s.in_arc(j)) == arc);
+            BOOST_CHECK_EQUAL(s.target(s.in_arc(j)), i);
+        }
+        BOOST_CHECK_EQUAL(j, s.in_end(i));
+    }
+
+    BOOST_CHECK_EQUAL(s.out_degree(s.node_index(a)), 2u);
+    BOOST_CHECK_EQUAL(s.out_degree(s.node_index(e)), 0u);
+    BOOST_CHECK_EQUAL(s.in_degree(s.node_index(d)), 2u);
+    BOOST_CHECK_EQUAL(s.in_degree(s.node_index(e)), 2u);
+    BOOST_CHECK_EQUAL(s.node_index(erased), HypothesesGraphSnapshot::npos);
+    BOOST_CHECK_EQUAL(s.node_index(lemon::INVALID), HypothesesGraphSnapshot::npos);
+
+    BOOST_CHECK_EQUAL(s.arc_to_timesteps()[s.arc_index(de)], 2);
+    BOOST_CHECK_EQUAL(s.arc_to_timesteps()[s.arc_index(ad)], 0);
+
+    vector<double> distances;
+    s.arc_column(dist, distances);
+    BOOST_REQUIRE_EQUAL(distances.size(), 5u);
+    BOOST_CHECK_EQUAL(distances[s.arc_index(ad)], 3.);
+    BOOST_CHECK_EQUAL(distances[s.arc_index(de)], 7.);
+}
+
+// EOF
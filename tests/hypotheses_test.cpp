@@ -1,13 +1,16 @@
 #define BOOST_TEST_MODULE hypotheses_test
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <limits>
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
+#include <boost/tuple/tuple.hpp>
 #include <lemon/core.h>
 #include <lemon/concepts/digraph.h>
 #include <lemon/list_graph.h>
@@ -25,6 +28,48 @@ BOOST_AUTO_TEST_CASE( HypothesesGraph_add_node ) {
     graph.add_node(13);
 }
 
+BOOST_AUTO_TEST_CASE( HypothesesGraph_traxel_node_index ) {
+    HypothesesGraph g;
+    g.add(node_traxel());
+    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_m = g.get(node_traxel());
+
+    HypothesesGraph::Node n1 = g.add_traxel_node(Traxel(1, 0));
+    HypothesesGraph::Node n7 = g.add_traxel_node(Traxel(7, 0));
+    BOOST_CHECK(g.traxel_node(0, 1) == n1);
+    BOOST_CHECK(g.traxel_node(0, 7) == n7);
+    BOOST_CHECK(g.traxel_node(0, 3) == lemon::INVALID);
+    BOOST_CHECK(g.traxel_node(0, 100) == lemon::INVALID);
+    BOOST_CHECK(g.traxel_node(1, 1) == lemon::INVALID);
+    BOOST_CHECK_EQUAL(g.traxel_nodes(0).size(), 8);
+    BOOST_CHECK_EQUAL(g.max_traxel_id(0), 7);
+    BOOST_CHECK_EQUAL(g.max_traxel_id(1), 0);
+    BOOST_CHECK_EQUAL(traxel_m[n7].Id, 7);
+
+    // nodes added directly are indexed on the next lookup
+    HypothesesGraph::Node n9 = g.add_node(0);
+    traxel_m.set(n9, Traxel(9, 0));
+    BOOST_CHECK(g.traxel_node(0, 9) == n9);
+    BOOST_CHECK(g.traxel_node(0, 1) == n1);
+    BOOST_CHECK_EQUAL(g.max_traxel_id(0), 9);
+
+    // erased nodes are skipped
+    g.erase(n9);
+    BOOST_CHECK(g.traxel_node(0, 9) == lemon::INVALID);
+    BOOST_CHECK_EQUAL(g.max_traxel_id(0), 7);
+
+    // ids changed in place have to be reindexed
+    Traxel renamed(2, 0);
+    traxel_m.set(n1, renamed);
+    BOOST_CHECK(g.traxel_node(0, 1) == lemon::INVALID);
+    g.index_traxel_node(n1, renamed);
+    BOOST_CHECK(g.traxel_node(0, 2) == n1);
+
+    // ids far beyond the node count do not blow up the table
+    BOOST_CHECK_THROW(g.add_traxel_node(Traxel(std::numeric_limits<unsigned int>::max(), 0)), std::runtime_error);
+    BOOST_CHECK_THROW(g.add_traxel_node(Traxel(1u << 30, 1)), std::runtime_error);
+    BOOST_CHECK_EQUAL(g.traxel_nodes(0).size(), 8);
+}
+
 BOOST_AUTO_TEST_CASE( HypothesesGraph_serialize ) {
   HypothesesGraph g;
   HypothesesGraph::Node n00 = g.add_node(0);
@@ -94,6 +139,55 @@ BOOST_AUTO_TEST_CASE( HypothesesGraph_serialize ) {
   
 }
 
+BOOST_AUTO_TEST_CASE( HypothesesGraph_binary_serialization ) {
+  TraxelStore ts;
+  for(int t = 0; t < 3; ++t) {
+    for(unsigned int id = 1; id <= 4; ++id) {
+      Traxel tr(id, t);
+      feature_array com(3, 0);
+      com[0] = id + 0.5 * t;
+      tr.features["com"] = com;
+      add(ts, tr);
+    }
+  }
+  boost::shared_ptr<HypothesesGraph> g(SingleTimestepTraxel_HypothesesBuilder(&ts, SingleTimestepTraxel_HypothesesBuilder::Options(2, 5)).build());
+  // holes in the node ids
+  g->erase(g->traxel_node(1, 3));
+
+  for(int references = 0; references < 2; ++references) {
+    stringstream ss;
+    write_binary(*g, ss, references);
+
+    if(references) {
+      HypothesesGraph unresolved;
+      stringstream copy(ss.str());
+      BOOST_CHECK_THROW(read_binary(unresolved, copy), std::invalid_argument);
+    }
+    HypothesesGraph loaded;
+    read_binary(loaded, ss, &ts);
+
+    BOOST_CHECK_EQUAL(countNodes(loaded), countNodes(*g));
+    BOOST_CHECK_EQUAL(countArcs(loaded), countArcs(*g));
+    BOOST_CHECK_EQUAL_COLLECTIONS(g->timesteps().begin(), g->timesteps().end(),
+                                  loaded.timesteps().begin(), loaded.timesteps().end());
+    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxels = loaded.get(node_traxel());
+    property_map<node_traxel, HypothesesGraph::base_graph>::type& original = g->get(node_traxel());
+    for(HypothesesGraph::ArcIt a(loaded); a != lemon::INVALID; ++a) {
+      const Traxel& from = traxels[loaded.source(a)];
+      const Traxel& to = traxels[loaded.target(a)];
+      HypothesesGraph::Node source = g->traxel_node(from.Timestep, from.Id);
+      HypothesesGraph::Node target = g->traxel_node(to.Timestep, to.Id);
+      BOOST_REQUIRE(source != lemon::INVALID && target != lemon::INVALID);
+      BOOST_CHECK(lemon::findArc(*g, source, target) != lemon::INVALID);
+      BOOST_CHECK_EQUAL(loaded.get(arc_from_timestep())[a], from.Timestep);
+      BOOST_CHECK_EQUAL(loaded.get(arc_to_timestep())[a], to.Timestep);
+      BOOST_CHECK_EQUAL(from.X(), original[source].X());
+    }
+    BOOST_CHECK(loaded.traxel_node(1, 3) == lemon::INVALID);
+    BOOST_CHECK(loaded.traxel_node(1, 4) != lemon::INVALID);
+  }
+}
+
 BOOST_AUTO_TEST_CASE( lgf_serialization ) {
   HypothesesGraph g;
   HypothesesGraph::Node n00 = g.add_node(0);
@@ -286,6 +380,278 @@ BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_build_forward_backw
 }
 
 
+namespace {
+    // (from timestep, from id, to timestep, to id) of every arc in arc order
+    vector<vector<int> > arcs_of(const HypothesesGraph& g) {
+        const NodeTraxels traxel_map(g);
+        vector<vector<int> > arcs;
+        for(HypothesesGraph::ArcIt a(g); a!=lemon::INVALID; ++a) {
+            vector<int> arc;
+            arc.push_back(traxel_map[g.source(a)].Timestep);
+            arc.push_back(traxel_map[g.source(a)].Id);
+            arc.push_back(traxel_map[g.target(a)].Timestep);
+            arc.push_back(traxel_map[g.target(a)].Id);
+            arcs.push_back(arc);
+        }
+        return arcs;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_build_parallel ) {
+    TraxelStore ts;
+    for(int t = 0; t < 8; ++t) {
+        for(unsigned int id = 1; id <= 10; ++id) {
+            Traxel tr(id, t);
+            feature_array com(3, 0);
+            com[0] = (id * 7 + t * 3) % 11;
+            com[1] = (id * 5 + t) % 13;
+            tr.features["com"] = com;
+            add(ts, tr);
+        }
+    }
+
+    typedef SingleTimestepTraxel_HypothesesBuilder::Options Options;
+    const Options::SpatialIndexType indices[] = {Options::KDTreeIndex, Options::GridIndex};
+    for (size_t i = 0; i < 2; ++i) {
+        Options serial_opts(2, 6, true);
+        serial_opts.spatial_index = indices[i];
+        Options parallel_opts(serial_opts);
+        parallel_opts.parallel = true;
+        boost::shared_ptr<HypothesesGraph> serial(SingleTimestepTraxel_HypothesesBuilder(&ts, serial_opts).build());
+        boost::shared_ptr<HypothesesGraph> parallel(SingleTimestepTraxel_HypothesesBuilder(&ts, parallel_opts).build());
+
+        vector<vector<int> > serial_arcs = arcs_of(*serial);
+        vector<vector<int> > parallel_arcs = arcs_of(*parallel);
+        BOOST_CHECK(serial_arcs.size() > 0);
+        BOOST_REQUIRE_EQUAL(serial_arcs.size(), parallel_arcs.size());
+        BOOST_CHECK(serial_arcs == parallel_arcs);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_index_cache ) {
+    TraxelStore ts;
+    for(int t = 0; t < 4; ++t) {
+        for(unsigned int id = 1; id <= 5; ++id) {
+            Traxel tr(id, t);
+            feature_array com(3, 0);
+            com[0] = id * 2;
+            tr.features["com"] = com;
+            add(ts, tr);
+        }
+    }
+
+    SingleTimestepTraxel_HypothesesBuilder builder(&ts, SingleTimestepTraxel_HypothesesBuilder::Options(1, 1, true));
+    boost::shared_ptr<HypothesesGraph> narrow(builder.build());
+    // forward pass: timesteps 1-3, backward pass: timesteps 0-2, sharing
+    // the indices of timesteps 1 and 2
+    BOOST_CHECK_EQUAL(builder.n_cached_indices(), 4);
+    vector<vector<int> > narrow_arcs = arcs_of(*narrow);
+    BOOST_CHECK_EQUAL(narrow_arcs.size(), 15);
+
+    // reused with another distance threshold
+    builder.options().max_nearest_neighbors = 3;
+    builder.options().distance_threshold = 2.5;
+    boost::shared_ptr<HypothesesGraph> wide(builder.build());
+    BOOST_CHECK_EQUAL(builder.n_cached_indices(), 4);
+    vector<vector<int> > wide_arcs = arcs_of(*wide);
+    BOOST_CHECK_EQUAL(wide_arcs.size(), 39);
+
+    builder.clear_index_cache();
+    BOOST_CHECK_EQUAL(builder.n_cached_indices(), 0);
+    boost::shared_ptr<HypothesesGraph> rebuilt(builder.build());
+    BOOST_CHECK(arcs_of(*rebuilt) == wide_arcs);
+
+    // the backward pass needs its own index of a timestep with com_corrected
+    TraxelStore corrected_ts;
+    for(TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+        Traxel tr = *it;
+        if(tr.Timestep == 1) {
+            tr.features["com_corrected"] = tr.features["com"];
+        }
+        add(corrected_ts, tr);
+    }
+    SingleTimestepTraxel_HypothesesBuilder corrected_builder(&corrected_ts, builder.options());
+    boost::shared_ptr<HypothesesGraph> corrected(corrected_builder.build());
+    BOOST_CHECK_EQUAL(corrected_builder.n_cached_indices(), 5);
+    BOOST_CHECK(arcs_of(*corrected) == wide_arcs);
+
+    // grids replace the kd-trees and are rebuilt for far other radii
+    typedef SingleTimestepTraxel_HypothesesBuilder::Options Options;
+    builder.options().spatial_index = Options::GridIndex;
+    const double thresholds[] = {2.5, 1., 20.};
+    for (size_t i = 0; i < 3; ++i) {
+        builder.options().distance_threshold = thresholds[i];
+        boost::shared_ptr<HypothesesGraph> cached(builder.build());
+        BOOST_CHECK_EQUAL(builder.n_cached_indices(), 4);
+        SingleTimestepTraxel_HypothesesBuilder fresh(&ts, builder.options());
+        boost::shared_ptr<HypothesesGraph> expected(fresh.build());
+        BOOST_CHECK(arcs_of(*cached) == arcs_of(*expected));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_extend ) {
+    TraxelStore ts, complete;
+    for(int t = 0; t < 6; ++t) {
+        for(unsigned int id = 1; id <= 6; ++id) {
+            Traxel tr(id, t);
+            feature_array com(3, 0);
+            com[0] = (id * 7 + t * 3) % 11;
+            com[1] = (id * 5 + t) % 13;
+            tr.features["com"] = com;
+            add(complete, tr);
+            if(t < 3) add(ts, tr);
+        }
+    }
+
+    SingleTimestepTraxel_HypothesesBuilder::Options opts(2, 6, true);
+    SingleTimestepTraxel_HypothesesBuilder builder(&ts, opts);
+    boost::shared_ptr<HypothesesGraph> graph(builder.build());
+
+    // frames 3 and 4 arrive, then frame 5
+    for(TraxelStoreByTimestep::const_iterator it = complete.begin(); it != complete.end(); ++it) {
+        if(it->Timestep >= 3) add(ts, *it);
+    }
+    BOOST_CHECK_THROW(builder.extend(graph.get(), 2, 4), std::invalid_argument);
+    builder.extend(graph.get(), 3, 4);
+    BOOST_CHECK_EQUAL(graph->latest_timestep(), 4);
+    builder.extend(graph.get(), 5, 5);
+    BOOST_CHECK_EQUAL(lemon::countNodes(*graph), 36);
+
+    boost::shared_ptr<HypothesesGraph> rebuilt(SingleTimestepTraxel_HypothesesBuilder(&complete, opts).build());
+    vector<vector<int> > extended_arcs = arcs_of(*graph);
+    vector<vector<int> > rebuilt_arcs = arcs_of(*rebuilt);
+    sort(extended_arcs.begin(), extended_arcs.end());
+    sort(rebuilt_arcs.begin(), rebuilt_arcs.end());
+    BOOST_CHECK(rebuilt_arcs.size() > 0);
+    BOOST_CHECK(extended_arcs == rebuilt_arcs);
+}
+
+BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_traxel_handles ) {
+    TraxelStore ts;
+    for(int t = 0; t < 3; ++t) {
+        for(unsigned int id = 1; id <= 4; ++id) {
+            Traxel tr(id, t);
+            feature_array com(3, 0);
+            com[0] = (id * 7 + t * 3) % 11;
+            com[1] = (id * 5 + t) % 13;
+            tr.features["com"] = com;
+            add(ts, tr);
+        }
+    }
+
+    SingleTimestepTraxel_HypothesesBuilder::Options opts(2, 6, true);
+    boost::shared_ptr<HypothesesGraph> copies(SingleTimestepTraxel_HypothesesBuilder(&ts, opts).build());
+    opts.traxel_handles = true;
+    boost::shared_ptr<HypothesesGraph> handles(SingleTimestepTraxel_HypothesesBuilder(&ts, opts).build());
+
+    BOOST_CHECK(!handles->has_property(node_traxel()));
+    BOOST_REQUIRE(handles->has_traxels());
+    BOOST_CHECK(arcs_of(*copies) == arcs_of(*handles));
+
+    // the nodes refer to the traxels of the store
+    const NodeTraxels traxels(*handles);
+    const TraxelStoreByTimeid& by_id = ts.get<by_timeid>();
+    HypothesesGraph::Node n = handles->traxel_node(1, 3);
+    BOOST_REQUIRE(n != lemon::INVALID);
+    BOOST_CHECK_EQUAL(&traxels[n], &*by_id.find(boost::make_tuple(1, 3u)));
+
+    // saved as copies
+    stringstream ss;
+    {
+        boost::archive::text_oarchive oa(ss);
+        const HypothesesGraph& g = *handles;
+        oa & g;
+    }
+    HypothesesGraph loaded;
+    {
+        boost::archive::text_iarchive ia(ss);
+        ia & loaded;
+    }
+    BOOST_CHECK(loaded.has_property(node_traxel()));
+    BOOST_CHECK(arcs_of(loaded) == arcs_of(*handles));
+}
+
+BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_node_features ) {
+    TraxelStore ts;
+    for(int t = 0; t < 3; ++t) {
+        for(unsigned int id = 1; id <= 4; ++id) {
+            Traxel tr(id, t);
+            feature_array com(3, 0);
+            com[0] = (id * 7 + t * 3) % 11;
+            com[1] = (id * 5 + t) % 13;
+            tr.features["com"] = com;
+            tr.features["detProb"] = feature_array(2, 0.5);
+            tr.features["coordinates"] = feature_array(300, 1.);
+            add(ts, tr);
+        }
+    }
+
+    SingleTimestepTraxel_HypothesesBuilder::Options opts(2, 6, true);
+    boost::shared_ptr<HypothesesGraph> full(SingleTimestepTraxel_HypothesesBuilder(&ts, opts).build());
+    opts.node_features.push_back("detProb");
+    boost::shared_ptr<HypothesesGraph> slim(SingleTimestepTraxel_HypothesesBuilder(&ts, opts).build());
+    BOOST_CHECK(arcs_of(*full) == arcs_of(*slim));
+
+    // only the requested and the position features are copied
+    const NodeTraxels traxels(*slim);
+    HypothesesGraph::Node n = slim->traxel_node(1, 3);
+    BOOST_REQUIRE(n != lemon::INVALID);
+    BOOST_CHECK_EQUAL(traxels[n].features.size(), 2);
+    BOOST_CHECK(traxels[n].features.count("detProb") == 1);
+    BOOST_CHECK(traxels[n].features.count("coordinates") == 0);
+}
+
+BOOST_AUTO_TEST_CASE( GapClosing_HypothesesBuilder_build ) {
+    // track 1 is missed at timestep 1; track 2 only lives at timestep 1
+    TraxelStore ts;
+    const double x[3][2] = { {0, -1}, {-1, 100}, {1, -1} };
+    for(int t = 0; t < 3; ++t) {
+        for(unsigned int id = 1; id <= 2; ++id) {
+            if(x[t][id - 1] < 0) continue;
+            Traxel tr(id, t);
+            feature_array com(3, 0);
+            com[0] = x[t][id - 1];
+            tr.features["com"] = com;
+            add(ts, tr);
+        }
+    }
+
+    SingleTimestepTraxel_HypothesesBuilder::Options opts(2, 10);
+    boost::shared_ptr<HypothesesGraph> plain(SingleTimestepTraxel_HypothesesBuilder(&ts, opts).build());
+    BOOST_CHECK_EQUAL(lemon::countArcs(*plain), 0);
+
+    GapClosing_HypothesesBuilder builder(&ts, opts, 2);
+    boost::shared_ptr<HypothesesGraph> graph(builder.build());
+    BOOST_REQUIRE_EQUAL(lemon::countArcs(*graph), 1);
+    HypothesesGraph::ArcIt a(*graph);
+    property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_m = graph->get(node_traxel());
+    BOOST_CHECK_EQUAL(traxel_m[graph->source(a)].Timestep, 0);
+    BOOST_CHECK_EQUAL(traxel_m[graph->target(a)].Timestep, 2);
+    BOOST_CHECK_EQUAL(graph->get(arc_from_timestep())[a], 0);
+    BOOST_CHECK_EQUAL(graph->get(arc_to_timestep())[a], 2);
+
+    // the bridge is neither a disappearance nor an appearance...
+    vector<vector<Event> > evts = *events(*graph);
+    BOOST_REQUIRE_EQUAL(evts.size(), 3);
+    BOOST_CHECK_EQUAL(evts[1].size(), 1); // appearance of 2
+    BOOST_CHECK_EQUAL(evts[1][0].type, Event::Appearance);
+    BOOST_CHECK_EQUAL(evts[2].size(), 1); // disappearance of 2
+    BOOST_CHECK_EQUAL(evts[2][0].type, Event::Disappearance);
+
+    // ...but a multi frame move
+    vector<vector<Event> > moves = *multi_frame_move_events(*graph);
+    BOOST_REQUIRE_EQUAL(moves.size(), 3);
+    BOOST_REQUIRE_EQUAL(moves[2].size(), 1);
+    BOOST_CHECK_EQUAL(moves[2][0].type, Event::MultiFrameMove);
+    BOOST_CHECK_EQUAL(moves[2][0].traxel_ids[0], 1);
+    BOOST_CHECK_EQUAL(moves[2][0].traxel_ids[1], 1);
+    BOOST_CHECK_EQUAL(moves[2][0].traxel_ids[2], 0);
+
+    // a gap of one timestep only is the plain builder
+    boost::shared_ptr<HypothesesGraph> no_gap(GapClosing_HypothesesBuilder(&ts, opts, 1).build());
+    BOOST_CHECK_EQUAL(lemon::countArcs(*no_gap), 0);
+}
+
 BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesBuilder_build_divisions ) {
     Traxel tr11, tr12, tr21, tr22, tr23;
     feature_array com11(3);
@@ -490,6 +856,143 @@ BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesGraph_generateTraxelGraph )
 }
 
 
+BOOST_AUTO_TEST_CASE( HypothesesGraph_generateTrackletGraph2 ) {
+    // a - b < c - e
+    //         d
+    HypothesesGraph traxel_graph;
+    traxel_graph.add(node_traxel()).add(arc_distance());
+    typedef HypothesesGraph::Node Node;
+    Node a = traxel_graph.add_traxel_node(Traxel(1, 0));
+    Node b = traxel_graph.add_traxel_node(Traxel(1, 1));
+    Node c = traxel_graph.add_traxel_node(Traxel(1, 2));
+    Node d = traxel_graph.add_traxel_node(Traxel(2, 2));
+    Node e = traxel_graph.add_traxel_node(Traxel(1, 3));
+    property_map<arc_distance, HypothesesGraph::base_graph>::type& dist = traxel_graph.get(arc_distance());
+    dist.set(traxel_graph.addArc(a, b), 1.);
+    HypothesesGraph::Arc bc = traxel_graph.addArc(b, c);
+    dist.set(bc, 2.);
+    dist.set(traxel_graph.addArc(b, d), 3.);
+    HypothesesGraph::Arc ce = traxel_graph.addArc(c, e);
+    dist.set(ce, 4.);
+
+    HypothesesGraph tracklet_graph;
+    std::map<Node, vector<Node> > traxel_nodes = generateTrackletGraph2(traxel_graph, tracklet_graph);
+    BOOST_CHECK_EQUAL(lemon::countNodes(tracklet_graph), 3);
+    BOOST_CHECK_EQUAL(lemon::countArcs(tracklet_graph), 2);
+    BOOST_REQUIRE_EQUAL(traxel_nodes.size(), 3u);
+
+    property_map<node_tracklet, HypothesesGraph::base_graph>::type& tracklets = tracklet_graph.get(node_tracklet());
+    property_map<tracklet_intern_dist, HypothesesGraph::base_graph>::type& intern_dists = tracklet_graph.get(tracklet_intern_dist());
+    property_map<tracklet_intern_arc_ids, HypothesesGraph::base_graph>::type& intern_arcs = tracklet_graph.get(tracklet_intern_arc_ids());
+    property_map<traxel_arc_id, HypothesesGraph::base_graph>::type& arc_ids = tracklet_graph.get(traxel_arc_id());
+
+    // tracklets in the order of their first traxel
+    std::map<Node, vector<Node> >::const_iterator it = traxel_nodes.begin();
+    const Node ab = it->first;
+    BOOST_REQUIRE_EQUAL(it->second.size(), 2u);
+    BOOST_CHECK(it->second[0] == a && it->second[1] == b);
+    BOOST_REQUIRE_EQUAL(tracklets[ab].size(), 2u);
+    BOOST_CHECK_EQUAL(tracklets[ab][1].Timestep, 1);
+    BOOST_REQUIRE_EQUAL(intern_dists[ab].size(), 1u);
+    BOOST_CHECK_EQUAL(intern_dists[ab][0], 1.);
+
+    ++it;
+    const Node ce_node = it->first;
+    BOOST_REQUIRE_EQUAL(it->second.size(), 2u);
+    BOOST_CHECK(it->second[0] == c && it->second[1] == e);
+    BOOST_REQUIRE_EQUAL(intern_arcs[ce_node].size(), 1u);
+    BOOST_CHECK_EQUAL(intern_arcs[ce_node][0], traxel_graph.id(ce));
+    BOOST_CHECK_EQUAL(tracklet_graph.get(node_timestep())[ce_node], 2);
+
+    ++it;
+    BOOST_REQUIRE_EQUAL(it->second.size(), 1u);
+    BOOST_CHECK(it->second[0] == d);
+    BOOST_CHECK(intern_dists[it->first].empty());
+
+    HypothesesGraph::InArcIt in(tracklet_graph, ce_node);
+    BOOST_REQUIRE(in != lemon::INVALID);
+    BOOST_CHECK(tracklet_graph.source(in) == ab);
+    BOOST_CHECK_EQUAL(arc_ids[in], traxel_graph.id(bc));
+    BOOST_CHECK_EQUAL(tracklet_graph.get(arc_distance())[in], 2.);
+}
+
+namespace {
+    // t0: 1 - 1   t1
+    //     2 . 2   (inactive arcs and node 2 at t1)
+    //       ` 3
+    void build_solved_graph(HypothesesGraph& g) {
+        g.add(node_traxel()).add(arc_active()).add(node_active());
+        HypothesesGraph::Node a = g.add_traxel_node(Traxel(1, 0));
+        HypothesesGraph::Node x = g.add_traxel_node(Traxel(2, 0));
+        HypothesesGraph::Node b = g.add_traxel_node(Traxel(1, 1));
+        HypothesesGraph::Node c = g.add_traxel_node(Traxel(2, 1));
+        HypothesesGraph::Node d = g.add_traxel_node(Traxel(3, 1));
+        property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
+        property_map<node_active, HypothesesGraph::base_graph>::type& active_nodes = g.get(node_active());
+        active_arcs.set(g.addArc(a, b), true);
+        active_arcs.set(g.addArc(a, c), false);
+        active_arcs.set(g.addArc(x, c), false);
+        active_arcs.set(g.addArc(x, d), true);
+        active_nodes.set(a, true);
+        active_nodes.set(x, true);
+        active_nodes.set(b, true);
+        active_nodes.set(c, false);
+        active_nodes.set(d, true);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( ActiveSubgraph_events ) {
+    HypothesesGraph solved;
+    build_solved_graph(solved);
+    const ActiveSubgraph active(solved);
+    BOOST_CHECK(!active.active(solved.traxel_node(1, 2)));
+    BOOST_CHECK(active.active(solved.traxel_node(1, 3)));
+    boost::shared_ptr<std::vector< std::vector<Event> > > view_events = events(active);
+    BOOST_CHECK_EQUAL(lemon::countNodes(solved), 5);
+
+    HypothesesGraph pruned;
+    build_solved_graph(pruned);
+    prune_inactive(pruned);
+    boost::shared_ptr<std::vector< std::vector<Event> > > pruned_events = events(pruned);
+
+    BOOST_REQUIRE_EQUAL(view_events->size(), 2u);
+    BOOST_CHECK_EQUAL((*view_events)[1].size(), 2u);
+    BOOST_CHECK(*view_events == *pruned_events);
+    BOOST_CHECK(*multi_frame_move_events(active) == *multi_frame_move_events(pruned));
+}
+
+namespace {
+    struct RecordingSink : public EventSink {
+        virtual void timestep(size_t slot, vector<Event>& events) {
+            slots.push_back(slot);
+            counts.push_back(events.size());
+        }
+        vector<size_t> slots;
+        vector<size_t> counts;
+    };
+}
+
+BOOST_AUTO_TEST_CASE( EventSink_events ) {
+    HypothesesGraph solved;
+    build_solved_graph(solved);
+    const ActiveSubgraph active(solved);
+
+    RecordingSink recorded;
+    events(active, recorded);
+    BOOST_REQUIRE_EQUAL(recorded.slots.size(), 2u);
+    BOOST_CHECK_EQUAL(recorded.slots[0], 0u);
+    BOOST_CHECK_EQUAL(recorded.slots[1], 1u);
+    BOOST_CHECK_EQUAL(recorded.counts[0], 0u);
+    BOOST_CHECK_EQUAL(recorded.counts[1], 2u);
+
+    // the vector sink merges like merge_event_vectors()
+    vector<vector<Event> > merged;
+    EventVectorSink sink(merged);
+    events(active, sink);
+    multi_frame_move_events(active, sink);
+    BOOST_CHECK(merged == *merge_event_vectors(*events(active), *multi_frame_move_events(active)));
+}
+
 BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesGraph_eventVector ) {
     HypothesesGraph traxel_graph;
 
@@ -781,4 +1284,33 @@ BOOST_AUTO_TEST_CASE( SingleTimestepTraxel_HypothesesGraph_eventVector ) {
             trueEvents4.begin(), trueEvents4.end());
 }
 
+BOOST_AUTO_TEST_CASE( DenseItemMap_Lookup ) {
+    HypothesesGraph g;
+    HypothesesGraph::Node n1 = g.add_node(0);
+    HypothesesGraph::Node n2 = g.add_node(1);
+    HypothesesGraph::Node n3 = g.add_node(1);
+    HypothesesGraph::Arc a = g.addArc(n1, n3);
+
+    DenseItemMap<HypothesesGraph::Node, size_t> nodes;
+    nodes[n3] = 4;
+    BOOST_CHECK(nodes.insert(std::make_pair(n1, size_t(7))).second);
+    BOOST_CHECK(!nodes.insert(std::make_pair(n1, size_t(8))).second);
+    BOOST_CHECK_EQUAL(nodes.size(), 2u);
+    BOOST_CHECK_EQUAL(nodes.count(n1), 1u);
+    BOOST_CHECK_EQUAL(nodes.count(n2), 0u);
+    BOOST_CHECK(nodes.find(n2) == nodes.end());
+    BOOST_CHECK_EQUAL(nodes.find(n1)->second, 7u);
+    BOOST_CHECK_EQUAL(nodes[n3], 4u);
+    // insertion order
+    BOOST_CHECK(nodes.begin()->first == n3);
+
+    DenseItemMap<HypothesesGraph::Arc, size_t> arcs;
+    arcs[a] = 1;
+    BOOST_CHECK_EQUAL(arcs.count(a), 1u);
+
+    nodes.clear();
+    BOOST_CHECK(nodes.empty());
+    BOOST_CHECK_EQUAL(nodes.count(n3), 0u);
+}
+
 // EOF
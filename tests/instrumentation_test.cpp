@@ -0,0 +1,127 @@
+#define BOOST_TEST_MODULE instrumentation_test
+
+// the macros are tested enabled, whatever the build option
+#ifndef PGMLINK_INSTRUMENTATION
+#define PGMLINK_INSTRUMENTATION
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "pgmlink/instrumentation.h"
+#include "pgmlink/tracking_statistics.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  const instrumentation::ProbeTotals& find_probe(const vector<instrumentation::ProbeTotals>& totals,
+                                                 const string& name) {
+    for(size_t i = 0; i < totals.size(); ++i) {
+      if(totals[i].name == name) {
+        return totals[i];
+      }
+    }
+    throw runtime_error("no probe " + name);
+  }
+
+  void work(size_t n) {
+    PGMLINK_TIMED_SCOPE("instrumentation_test: work");
+    for(size_t i = 0; i < n; ++i) {
+      PGMLINK_COUNT("instrumentation_test: items", 2);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( Instrumentation_probe )
+{
+  const size_t a = instrumentation::probe("instrumentation_test: a", false);
+  BOOST_CHECK_EQUAL(instrumentation::probe("instrumentation_test: a", false), a);
+  BOOST_CHECK(instrumentation::probe("instrumentation_test: b", false) != a);
+  BOOST_CHECK_THROW(instrumentation::probe("instrumentation_test: a", true), invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( Instrumentation_threads )
+{
+  instrumentation::reset();
+  work(10);
+  // the counts of exited threads are kept as well as those of running ones
+  boost::thread_group threads;
+  for(size_t i = 0; i < 4; ++i) {
+    threads.create_thread(boost::bind(&work, 5));
+  }
+  threads.join_all();
+
+  const vector<instrumentation::ProbeTotals> totals = instrumentation::totals();
+  const instrumentation::ProbeTotals& items = find_probe(totals, "instrumentation_test: items");
+  BOOST_CHECK(!items.timer);
+  BOOST_CHECK_EQUAL(items.calls, 30u);
+  BOOST_CHECK_EQUAL(items.total, 60.);
+  const instrumentation::ProbeTotals& timer = find_probe(totals, "instrumentation_test: work");
+  BOOST_CHECK(timer.timer);
+  BOOST_CHECK_EQUAL(timer.calls, 5u);
+  BOOST_CHECK(timer.total >= 0.);
+
+  ostringstream report;
+  instrumentation::report(report);
+  BOOST_CHECK(report.str().find("instrumentation_test: items") != string::npos);
+
+  instrumentation::reset();
+  BOOST_CHECK_EQUAL(find_probe(instrumentation::totals(), "instrumentation_test: items").calls, 0u);
+  ostringstream empty;
+  instrumentation::report(empty);
+  BOOST_CHECK(empty.str().find("instrumentation_test: items") == string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( Instrumentation_trace )
+{
+  const char* filename = "instrumentation_test_trace.json";
+  BOOST_CHECK(!instrumentation::tracing());
+  instrumentation::start_trace(filename);
+  BOOST_CHECK(instrumentation::tracing());
+  BOOST_CHECK_THROW(instrumentation::start_trace(filename), runtime_error);
+  {
+    instrumentation::TraceScope trace("instrumentation_test \"run\"", "tracking");
+    double seconds = 0;
+    PhaseTimer timer(false);
+    work(1);
+    timer.stop(seconds, "instrumentation_test: phase");
+    // a disabled timer adds no time
+    BOOST_CHECK_EQUAL(seconds, 0.);
+    boost::thread worker(boost::bind(&work, 1));
+    worker.join();
+  }
+  instrumentation::stop_trace();
+  BOOST_CHECK(!instrumentation::tracing());
+  // dropped
+  {
+    instrumentation::TraceScope trace("instrumentation_test: untraced", "tracking");
+  }
+  instrumentation::stop_trace();
+
+  ifstream in(filename);
+  const string json((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  BOOST_CHECK(json.find("\"traceEvents\"") != string::npos);
+  BOOST_CHECK(json.find("\"name\":\"instrumentation_test \\\"run\\\"\",\"cat\":\"tracking\",\"ph\":\"X\"") != string::npos);
+  BOOST_CHECK(json.find("instrumentation_test: phase") != string::npos);
+  BOOST_CHECK(json.find("instrumentation_test: untraced") == string::npos);
+  // the timers of both threads
+  size_t n_work = 0;
+  for(size_t pos = json.find("instrumentation_test: work"); pos != string::npos;
+      pos = json.find("instrumentation_test: work", pos + 1)) {
+    ++n_work;
+  }
+  BOOST_CHECK_EQUAL(n_work, 2u);
+  in.close();
+  remove(filename);
+}
+
+// EOF
@@ -0,0 +1,111 @@
+#define BOOST_TEST_MODULE log_test
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "pgmlink/log.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  size_t count_lines(FILE* f, size_t& with_marker) {
+    fflush(f);
+    rewind(f);
+    size_t lines = 0;
+    with_marker = 0;
+    char line[512];
+    while(fgets(line, sizeof(line), f)) {
+      ++lines;
+      if(string(line).find("log_test marker") != string::npos) {
+        ++with_marker;
+      }
+    }
+    return lines;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( Log_async )
+{
+  FILE* f = tmpfile();
+  BOOST_REQUIRE(f);
+  FILE* previous = Output2FILE::getRedirect();
+  Output2FILE::getRedirect() = f;
+
+  set_async_logging(true, 10.);
+  BOOST_CHECK(async_logging());
+  const int n = 1000;
+  #pragma omp parallel for
+  for(int i = 0; i < n; ++i) {
+    LOG(logINFO) << "log_test marker " << i;
+  }
+  // nothing is written before the interval passed or the log is flushed
+  size_t with_marker = 0;
+  BOOST_CHECK_EQUAL(count_lines(f, with_marker), 0u);
+  flush_log();
+  BOOST_CHECK_EQUAL(count_lines(f, with_marker), static_cast<size_t>(n));
+  BOOST_CHECK_EQUAL(with_marker, static_cast<size_t>(n));
+
+  // disabling writes the pending messages
+  LOG(logINFO) << "log_test marker";
+  set_async_logging(false);
+  BOOST_CHECK(!async_logging());
+  BOOST_CHECK_EQUAL(count_lines(f, with_marker), static_cast<size_t>(n + 1));
+  LOG(logINFO) << "log_test marker";
+  BOOST_CHECK_EQUAL(count_lines(f, with_marker), static_cast<size_t>(n + 2));
+
+  BOOST_CHECK_THROW(set_async_logging(true, 0.), std::invalid_argument);
+
+  Output2FILE::getRedirect() = previous;
+  fclose(f);
+}
+
+namespace {
+  void log_sequence(int n) {
+    for(int i = 0; i < n; ++i) {
+      LOG(logINFO) << "log_test order " << i;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( Log_async_order )
+{
+  FILE* f = tmpfile();
+  BOOST_REQUIRE(f);
+  FILE* previous = Output2FILE::getRedirect();
+  Output2FILE::getRedirect() = f;
+
+  // the writer thread and flush_log() drain concurrently
+  set_async_logging(true, 1e-4);
+  const int n = 20000;
+  boost::thread logger(boost::bind(&log_sequence, n));
+  for(int i = 0; i < 200; ++i) {
+    flush_log();
+  }
+  logger.join();
+  set_async_logging(false);
+
+  fflush(f);
+  rewind(f);
+  char line[512];
+  int expected = 0;
+  while(fgets(line, sizeof(line), f)) {
+    const char* marker = strstr(line, "log_test order ");
+    if(marker) {
+      BOOST_REQUIRE_EQUAL(atoi(marker + strlen("log_test order ")), expected);
+      ++expected;
+    }
+  }
+  BOOST_CHECK_EQUAL(expected, n);
+
+  Output2FILE::getRedirect() = previous;
+  fclose(f);
+}
+
+// EOF
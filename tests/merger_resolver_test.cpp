@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <cstring>
 #include <iostream>
+#include <sstream>
 #include <algorithm>
 #include <set>
 #include <vector>
@@ -115,6 +116,105 @@ BOOST_AUTO_TEST_CASE( MergerResolver_subgraph ) {
 }
 
 
+BOOST_AUTO_TEST_CASE( MergerResolver_subgraph_dense_cross_reference ) {
+  HypothesesGraph g1, g2;
+  g1.add(node_active()).add(arc_active()).add(node_active2()).add(node_traxel()).add(node_originated_from());
+  HypothesesGraph::Node n1 = g1.add_node(1);
+  HypothesesGraph::Node n2 = g1.add_node(2);
+  HypothesesGraph::Node n3 = g1.add_node(2);
+  HypothesesGraph::Arc a13 = g1.addArc(n1, n3);
+  g1.addArc(n1, n2);
+  property_map<node_active, HypothesesGraph::base_graph>::type& na_map = g1.get(node_active());
+  property_map<node_active2, HypothesesGraph::base_graph>::type& na2_map = g1.get(node_active2());
+  property_map<arc_active, HypothesesGraph::base_graph>::type& aa_map = g1.get(arc_active());
+  na_map.set(n1, true);
+  na_map.set(n2, false);
+  na_map.set(n3, true);
+  na2_map.set(n1, 2);
+  na2_map.set(n3, 3);
+  aa_map.set(a13, true);
+
+  NodeCrossReference nr, ncr;
+  ArcCrossReference ar, acr;
+  copy_hypotheses_graph_subset<node_active, arc_active>(g1, g2, nr, ar, ncr, acr);
+  g2.add(node_active()).add(node_active2());
+  translate_property_bool_map<node_active, HypothesesGraph::Node>(g1, g2, nr);
+  translate_property_value_map<node_active2, HypothesesGraph::Node>(g1, g2, nr);
+
+  BOOST_CHECK_EQUAL(lemon::countNodes(g2), 2);
+  BOOST_CHECK_EQUAL(lemon::countArcs(g2), 1);
+  BOOST_CHECK_EQUAL(nr.count(n2), 0);
+  BOOST_REQUIRE_EQUAL(ar.count(a13), 1);
+  BOOST_CHECK(acr[ar[a13]] == a13);
+  BOOST_CHECK(g2.source(ar[a13]) == nr[n1]);
+  BOOST_CHECK(g2.target(ar[a13]) == nr[n3]);
+  BOOST_CHECK(ncr[nr[n1]] == n1);
+  property_map<node_active, HypothesesGraph::base_graph>::type& n2a_map = g2.get(node_active());
+  property_map<node_active2, HypothesesGraph::base_graph>::type& n2a2_map = g2.get(node_active2());
+  BOOST_CHECK(n2a_map[nr[n1]]);
+  BOOST_CHECK(n2a_map[nr[n3]]);
+  BOOST_CHECK_EQUAL(n2a2_map[nr[n1]], 2);
+  BOOST_CHECK_EQUAL(n2a2_map[nr[n3]], 3);
+}
+
+
+BOOST_AUTO_TEST_CASE( MergerResolver_max_one_arc ) {
+  HypothesesGraph g;
+  g.add(arc_distance()).add(arc_resolution_candidate()).add(division_active());
+  HypothesesGraph::Node n1 = g.add_node(0);
+  HypothesesGraph::Node n2 = g.add_node(0);
+  HypothesesGraph::Node m1 = g.add_node(1);
+  HypothesesGraph::Node m2 = g.add_node(1);
+  HypothesesGraph::Node k = g.add_node(2);
+  // a division
+  HypothesesGraph::Node d = g.add_node(0);
+  HypothesesGraph::Node d1 = g.add_node(1);
+  HypothesesGraph::Node d2 = g.add_node(1);
+
+  HypothesesGraph::Arc a11 = g.addArc(n1, m1);
+  HypothesesGraph::Arc a12 = g.addArc(n1, m2);
+  HypothesesGraph::Arc a21 = g.addArc(n2, m1);
+  HypothesesGraph::Arc b1 = g.addArc(m1, k);
+  HypothesesGraph::Arc b2 = g.addArc(m2, k);
+  HypothesesGraph::Arc c1 = g.addArc(d, d1);
+  HypothesesGraph::Arc c2 = g.addArc(d, d2);
+  // not a candidate, keeps its state
+  HypothesesGraph::Arc e = g.addArc(n2, d1);
+
+  property_map<arc_distance, HypothesesGraph::base_graph>::type& distance_map = g.get(arc_distance());
+  property_map<arc_resolution_candidate, HypothesesGraph::base_graph>::type& candidate_map = g.get(arc_resolution_candidate());
+  HypothesesGraph::Arc candidates[] = {a11, a12, a21, b1, b2, c1, c2};
+  double distances[] = {1., 2., 2., 1., 3., 1., 1.};
+  for (size_t i = 0; i < 7; ++i) {
+    distance_map.set(candidates[i], distances[i]);
+    candidate_map.set(candidates[i], true);
+  }
+  distance_map.set(e, 0.);
+  g.get(division_active()).set(d, true);
+  g.add(arc_active());
+  property_map<arc_active, HypothesesGraph::base_graph>::type& active_map = g.get(arc_active());
+  active_map.set(a11, true);
+  active_map.set(e, true);
+
+  ResolveAmbiguousArcsPgm resolve(NegLnTransition(1), 5);
+  resolve(&g);
+  BOOST_CHECK_EQUAL(resolve.number_of_pieces(), 3);
+
+  // both sources get an arc, although n1 -> m1 is the shortest one
+  BOOST_CHECK(!active_map[a11]);
+  BOOST_CHECK(active_map[a12]);
+  BOOST_CHECK(active_map[a21]);
+  BOOST_CHECK(active_map[b1]);
+  BOOST_CHECK(!active_map[b2]);
+  BOOST_CHECK(active_map[c1]);
+  BOOST_CHECK(active_map[c2]);
+  BOOST_CHECK(active_map[e]);
+
+  HypothesesGraph h;
+  BOOST_CHECK_THROW(resolve(&h), std::runtime_error);
+}
+
+
 BOOST_AUTO_TEST_CASE( MergerResolver_constructor ) {
   HypothesesGraph g;
   BOOST_CHECK_THROW(MergerResolver m(&g), std::runtime_error);
@@ -844,6 +944,58 @@ BOOST_AUTO_TEST_CASE( MergerResolver_get_max_id ) {
 }
 
 
+namespace {
+// hands out the ids from max_id on without changing the graph
+class ConsecutiveIdsHandler : public FeatureHandlerBase {
+ public:
+  virtual void operator()(HypothesesGraph&, HypothesesGraph::Node, std::size_t n_merger, unsigned int max_id, int,
+                          const std::vector<HypothesesGraph::base_graph::Arc>&,
+                          const std::vector<HypothesesGraph::base_graph::Arc>&,
+                          std::vector<unsigned int>& new_ids) {
+    for (std::size_t i = 0; i < n_merger; ++i) {
+      new_ids.push_back(max_id + i);
+    }
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE( MergerResolver_next_ids ) {
+  // the replacement ids of consecutive mergers of a timestep do not overlap
+  HypothesesGraph g;
+  g.add(node_traxel()).add(node_active2()).add(arc_active()).add(arc_distance());
+  Traxel t11, t13, t21;
+  t11.Timestep = 1;
+  t11.Id = 1;
+  t13.Timestep = 1;
+  t13.Id = 3;
+  t21.Timestep = 2;
+  t21.Id = 1;
+  HypothesesGraph::Node n11 = g.add_node(1);
+  HypothesesGraph::Node n13 = g.add_node(1);
+  HypothesesGraph::Node n21 = g.add_node(2);
+  property_map<node_traxel, HypothesesGraph::base_graph>::type& traxel_map = g.get(node_traxel());
+  traxel_map.set(n11, t11);
+  traxel_map.set(n13, t13);
+  traxel_map.set(n21, t21);
+
+  MergerResolver m(&g);
+  BOOST_CHECK_EQUAL(m.get_max_id(0), 0);
+  ConsecutiveIdsHandler handler;
+  m.refine_node(n11, 2, handler);
+  m.refine_node(n13, 3, handler);
+  m.refine_node(n21, 2, handler);
+
+  property_map<merger_resolved_to, HypothesesGraph::base_graph>::type& resolved_map = g.get(merger_resolved_to());
+  unsigned int ids11[] = {4, 5};
+  unsigned int ids13[] = {6, 7, 8};
+  unsigned int ids21[] = {2, 3};
+  BOOST_CHECK_EQUAL_COLLECTIONS(resolved_map[n11].begin(), resolved_map[n11].end(), ids11, ids11 + 2);
+  BOOST_CHECK_EQUAL_COLLECTIONS(resolved_map[n13].begin(), resolved_map[n13].end(), ids13, ids13 + 3);
+  BOOST_CHECK_EQUAL_COLLECTIONS(resolved_map[n21].begin(), resolved_map[n21].end(), ids21, ids21 + 2);
+  BOOST_CHECK_EQUAL(m.get_max_id(1), 8);
+}
+
+
 BOOST_AUTO_TEST_CASE( MergerResolver_add_arcs_for_replacement_node ) {
   // BOOST_CHECK(false); // FIXME: fix this test!
 //  // MergerResolver::add_arcs_for_replacement_node(HypothesesGraph::Node node,
@@ -1011,6 +1163,42 @@ BOOST_AUTO_TEST_CASE( MergerResolver_kmeans) {
 }
 
 
+BOOST_AUTO_TEST_CASE( MergerResolver_kmeans_arma ) {
+  // KMeans(int k, const arma::mat& data) works on the memory of data
+  double arr[] = {-6, 0, -5, 0, -4, 0, 6, 0, 5, 0, 4, 0};
+  float arr_res[] = {5, 0, 0, -5, 0, 0};
+  arma::mat data(arr, 2, 6, false, true);
+  KMeans kMeans(2, data);
+  feature_array centers = kMeans();
+  BOOST_CHECK_EQUAL_COLLECTIONS(centers.begin(), centers.end(), arr_res, arr_res+sizeof(arr_res)/sizeof(arr_res[0]));
+}
+
+
+BOOST_AUTO_TEST_CASE( MergerResolver_merger_centers_cache ) {
+  float arr_coordinates[] = {-6, 0, 0, -5, 0, 0, 6, 0, 0, 5, 0, 0};
+  float arr_centers[] = {5.5, 0, 0, -5.5, 0, 0};
+  feature_array coordinates(arr_coordinates, arr_coordinates + sizeof(arr_coordinates)/sizeof(arr_coordinates[0]));
+  feature_array centers(arr_centers, arr_centers + sizeof(arr_centers)/sizeof(arr_centers[0]));
+  const boost::uint64_t hash = MergerCentersCache::hash(coordinates);
+
+  MergerCentersCache cache;
+  cache.insert(3, 7, 2, hash, centers);
+  std::stringstream ss;
+  cache.write(ss);
+  MergerCentersCache restored;
+  restored.read(ss);
+  BOOST_CHECK_EQUAL(restored.size(), 1);
+
+  feature_array found;
+  BOOST_REQUIRE(restored.find(3, 7, 2, hash, found));
+  BOOST_CHECK_EQUAL_COLLECTIONS(found.begin(), found.end(), centers.begin(), centers.end());
+  // another object count or changed coordinates miss the cache
+  BOOST_CHECK(!restored.find(3, 7, 3, hash, found));
+  coordinates[0] = -7;
+  BOOST_CHECK(!restored.find(3, 7, 2, MergerCentersCache::hash(coordinates), found));
+}
+
+
 BOOST_AUTO_TEST_CASE( MergerResolver_extract_coordinates ) {
   std::cout << "MergerResolver_extract_coordinates" << std::endl;
   vigra::MultiArray<2, unsigned> label_image2D(vigra::Shape2(10,10), 0u);
@@ -0,0 +1,104 @@
+#define BOOST_TEST_MODULE nearest_neighbors_test
+
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/nearest_neighbors.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  Traxel traxel_at(unsigned int id, double x, double y) {
+    Traxel t(id, 0);
+    feature_array com(3, 0);
+    com[0] = x;
+    com[1] = y;
+    t.features["com"] = com;
+    return t;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( NearestNeighborSearch_batch_knn_in_range )
+{
+  vector<Traxel> points;
+  for(unsigned int id = 0; id < 25; ++id) {
+    points.push_back(traxel_at(id, id % 5, id / 5));
+  }
+  NearestNeighborSearch nns(points.begin(), points.end());
+
+  vector<Traxel> query_traxels;
+  query_traxels.push_back(traxel_at(100, 0, 0));
+  query_traxels.push_back(traxel_at(101, 2.1, 2.1));
+  query_traxels.push_back(traxel_at(102, 50, 50));
+  query_traxels.push_back(traxel_at(103, 4, 4));
+  vector<const Traxel*> queries;
+  vector<unsigned int> knn;
+  for(size_t i = 0; i < query_traxels.size(); ++i) {
+    queries.push_back(&query_traxels[i]);
+    knn.push_back(i + 1);
+  }
+
+  vector<size_t> offsets;
+  vector<unsigned int> ids;
+  vector<double> distances;
+  nns.knn_in_range(queries, knn, 1.5, offsets, ids, distances);
+  BOOST_REQUIRE_EQUAL(offsets.size(), queries.size() + 1);
+  BOOST_CHECK_EQUAL(offsets.back(), ids.size());
+  BOOST_CHECK_EQUAL(distances.size(), ids.size());
+
+  // same as one query at a time
+  for(size_t i = 0; i < queries.size(); ++i) {
+    map<unsigned int, double> expected = nns.knn_in_range(*queries[i], 1.5, knn[i]);
+    BOOST_REQUIRE_EQUAL(offsets[i + 1] - offsets[i], expected.size());
+    size_t n = offsets[i];
+    for(map<unsigned int, double>::const_iterator it = expected.begin(); it != expected.end(); ++it, ++n) {
+      BOOST_CHECK_EQUAL(ids[n], it->first);
+      BOOST_CHECK_CLOSE(distances[n], it->second, 1e-9);
+    }
+  }
+  BOOST_CHECK_EQUAL(offsets[3] - offsets[2], 0);
+
+  // the output is overwritten
+  nns.knn_in_range(vector<const Traxel*>(), vector<unsigned int>(), 1.5, offsets, ids, distances);
+  BOOST_CHECK_EQUAL(offsets.size(), 1);
+  BOOST_CHECK(ids.empty());
+
+  BOOST_CHECK_THROW(nns.knn_in_range(queries, knn, -1, offsets, ids, distances), std::invalid_argument);
+  knn.pop_back();
+  BOOST_CHECK_THROW(nns.knn_in_range(queries, knn, 1, offsets, ids, distances), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( NearestNeighborSearch_planar )
+{
+  vector<Traxel> points;
+  for(unsigned int id = 0; id < 25; ++id) {
+    points.push_back(traxel_at(id, id % 5, id / 5));
+  }
+  NearestNeighborSearch nns3(points.begin(), points.end());
+  NearestNeighborSearch nns2(points.begin(), points.end(), false, 2);
+
+  // z is ignored by the 2D index
+  Traxel query = traxel_at(100, 2.1, 2.1);
+  Traxel lifted = query;
+  lifted.features["com"][2] = 10;
+  for(unsigned int knn = 1; knn < 6; ++knn) {
+    map<unsigned int, double> expected = nns3.knn_in_range(query, 1.5, knn);
+    map<unsigned int, double> found = nns2.knn_in_range(lifted, 1.5, knn);
+    BOOST_REQUIRE_EQUAL(found.size(), expected.size());
+    for(map<unsigned int, double>::const_iterator it = expected.begin(); it != expected.end(); ++it) {
+      BOOST_REQUIRE(found.count(it->first));
+      BOOST_CHECK_CLOSE(found[it->first], it->second, 1e-9);
+    }
+  }
+  BOOST_CHECK_EQUAL(nns2.count_in_range(lifted, 1.5), nns3.count_in_range(query, 1.5));
+  BOOST_CHECK_EQUAL(nns3.count_in_range(lifted, 1.5), 0u);
+
+  BOOST_CHECK_THROW(NearestNeighborSearch(points.begin(), points.end(), false, 4), std::invalid_argument);
+}
+
+// EOF
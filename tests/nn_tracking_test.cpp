@@ -0,0 +1,131 @@
+#define BOOST_TEST_MODULE nn_tracking_test
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/event.h"
+#include "pgmlink/tracking.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  void add_traxel(TraxelStore& ts, unsigned int id, int t, double x, double div_prob = 0.1) {
+    Traxel trax(id, t);
+    feature_array com(3, 0.);
+    com[0] = x;
+    trax.features["com"] = com;
+    trax.features["divProb"] = feature_array(1, div_prob);
+    add(ts, trax);
+  }
+
+  Event event(Event::EventType type, size_t a, size_t b = 0, size_t c = 0) {
+    Event e;
+    e.type = type;
+    e.traxel_ids.push_back(a);
+    if (type == Event::Move || type == Event::Merger || type == Event::Division) e.traxel_ids.push_back(b);
+    if (type == Event::Division) e.traxel_ids.push_back(c);
+    return e;
+  }
+
+  bool contains(const vector<Event>& events, const Event& e) {
+    return find(events.begin(), events.end(), e) != events.end();
+  }
+}
+
+BOOST_AUTO_TEST_CASE( NNTracking_events )
+{
+  //  t=0        1        2
+  //  o (1) -- o (2) --< o (3), o (4)   division
+  //  o (5) -- o (7) --\
+  //                     o (9)          merger
+  //  o (6) -- o (8) --/
+  //                     o (10)         appearance
+  TraxelStore ts;
+  add_traxel(ts, 1, 0, 0);
+  add_traxel(ts, 2, 1, 0, 0.9);
+  add_traxel(ts, 3, 2, -3);
+  add_traxel(ts, 4, 2, 3);
+  add_traxel(ts, 5, 0, 50);
+  add_traxel(ts, 6, 0, 56);
+  add_traxel(ts, 7, 1, 50);
+  add_traxel(ts, 8, 1, 56);
+  add_traxel(ts, 9, 2, 52);
+  add_traxel(ts, 10, 2, 200);
+
+  NNTracking tracking(30, 10);
+  vector<vector<Event> > events = tracking(ts);
+  BOOST_REQUIRE_EQUAL(events.size(), 3u);
+  BOOST_CHECK(events[0].empty());
+  BOOST_CHECK_EQUAL(events[1].size(), 3u);
+  BOOST_CHECK(contains(events[1], event(Event::Move, 1, 2)));
+  BOOST_CHECK(contains(events[1], event(Event::Move, 5, 7)));
+  BOOST_CHECK(contains(events[1], event(Event::Move, 6, 8)));
+
+  BOOST_CHECK_EQUAL(events[2].size(), 5u);
+  BOOST_CHECK(contains(events[2], event(Event::Division, 2, 3, 4)));
+  BOOST_CHECK(contains(events[2], event(Event::Move, 7, 9)));
+  BOOST_CHECK(contains(events[2], event(Event::Move, 8, 9)));
+  BOOST_CHECK(contains(events[2], event(Event::Merger, 9, 2)));
+  BOOST_CHECK(contains(events[2], event(Event::Appearance, 10)));
+
+  vector<map<unsigned int, bool> > detections = tracking.detections();
+  BOOST_REQUIRE_EQUAL(detections.size(), 3u);
+  BOOST_CHECK_EQUAL(detections[2].size(), 4u);
+
+  // without merger handling, one of the two disappears
+  NNTracking no_mergers(30, 10, vector<string>(), 0.5, true, false);
+  events = no_mergers(ts);
+  BOOST_CHECK(contains(events[2], event(Event::Disappearance, 8)));
+  BOOST_CHECK(!contains(events[2], event(Event::Merger, 9, 2)));
+}
+
+BOOST_AUTO_TEST_CASE( NNTrackletsTracking_mutual_neighbors )
+{
+  // 1 at x=0 and 2 at x=4 both have 3 at x=2.5 as their nearest
+  // successor; 4 at x=9 is in range of 1 only
+  TraxelStore ts;
+  add_traxel(ts, 1, 0, 0);
+  add_traxel(ts, 2, 0, 4);
+  add_traxel(ts, 3, 1, 2.5);
+  add_traxel(ts, 4, 1, 9);
+
+  // the greedy linking takes the second nearest successor
+  NNTracking nn(10, 10, vector<string>(), 0.5, false, false);
+  vector<vector<Event> > events = nn(ts);
+  BOOST_REQUIRE_EQUAL(events.size(), 2u);
+  BOOST_CHECK(contains(events[1], event(Event::Move, 2, 3)));
+  BOOST_CHECK(contains(events[1], event(Event::Move, 1, 4)));
+
+  // tracklets only link mutual nearest neighbors
+  NNTrackletsTracking tracklets(10, vector<string>(), 0.5, false, false);
+  events = tracklets(ts);
+  BOOST_REQUIRE_EQUAL(events.size(), 2u);
+  BOOST_CHECK_EQUAL(events[1].size(), 3u);
+  BOOST_CHECK(contains(events[1], event(Event::Move, 2, 3)));
+  BOOST_CHECK(contains(events[1], event(Event::Disappearance, 1)));
+  BOOST_CHECK(contains(events[1], event(Event::Appearance, 4)));
+}
+
+BOOST_AUTO_TEST_CASE( NNTracking_feature_distance_ranks_all_in_range )
+{
+  // 1 looks like 5, the fourth nearest successor within movDist
+  TraxelStore ts;
+  for (unsigned int id = 1; id <= 5; ++id) {
+    Traxel trax(id, id == 1 ? 0 : 1);
+    feature_array com(3, 0.);
+    com[0] = id - 1.;
+    trax.features["com"] = com;
+    trax.features["size"] = feature_array(1, id == 1 || id == 5 ? 10. : 0.);
+    add(ts, trax);
+  }
+
+  NNTracking tracking(30, 10, vector<string>(1, "size"), 0.5, false, false);
+  vector<vector<Event> > events = tracking(ts);
+  BOOST_REQUIRE_EQUAL(events.size(), 2u);
+  BOOST_CHECK(contains(events[1], event(Event::Move, 1, 5)));
+}
@@ -1,5 +1,7 @@
 #define BOOST_TEST_MODULE randomforest_test
 
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -259,3 +261,71 @@ BOOST_AUTO_TEST_CASE( checkLoadTracklets )
     BOOST_CHECK( ts[3].features["sgf"][4] == 4 );
     BOOST_CHECK( ts[4].features["pc"][1] == 1 );
 }
+
+
+BOOST_AUTO_TEST_CASE( checkPredictTraxels )
+{
+    // XOR data in two timesteps
+    pgmlink::TraxelStore ts;
+    std::vector<pgmlink::Traxel> traxels;
+    for(int i = 0; i < 4; ++i) {
+        pgmlink::Traxel t;
+        t.Id = i + 1;
+        t.Timestep = i / 2;
+        t.features["first"] = pgmlink::feature_array(1, float(i % 2));
+        t.features["second"] = pgmlink::feature_array(1, float(i / 2));
+        traxels.push_back(t);
+        pgmlink::add(ts, t);
+    }
+
+    std::vector<std::string> sel;
+    sel.push_back("second"); sel.push_back("first");
+    std::vector<const pgmlink::Traxel*> rows;
+    rows.push_back(&traxels[1]);
+    rows.push_back(&traxels[2]);
+    vigra::MultiArray<2,float> m = pgmlink::RF::createFeatureMatrix(rows, sel);
+    BOOST_CHECK_EQUAL( m.shape(0), 2 );
+    BOOST_CHECK_EQUAL( m.shape(1), 2 );
+    BOOST_CHECK_EQUAL( m(0,0), 0.f );
+    BOOST_CHECK_EQUAL( m(0,1), 1.f );
+    BOOST_CHECK_EQUAL( m(1,0), 1.f );
+    BOOST_CHECK_EQUAL( m(1,1), 0.f );
+
+    vigra::RandomForest<pgmlink::RF::RF_LABEL_TYPE> rf ( pgmlink::RF::getRandomForest("@PROJECT_SOURCE_DIR@/tests/xorforest.h5"));
+    sel[0] = "first"; sel[1] = "second";
+    pgmlink::RF::predict_traxels(ts, rf, sel, 1, "prediction");
+    BOOST_CHECK_EQUAL( ts.size(), 4 );
+    for(pgmlink::TraxelStore::const_iterator it = ts.begin(); it != ts.end(); ++it) {
+        pgmlink::TraxelFeatures::const_iterator f = it->features.find("prediction");
+        BOOST_REQUIRE( f != it->features.end() );
+        const pgmlink::Traxel& single = traxels[it->Id - 1];
+        BOOST_CHECK_CLOSE( double(f->second[0]), pgmlink::RF::predict(single, rf, sel, 1), 1e-4 );
+    }
+
+    // rows of different length
+    pgmlink::Traxel broken = traxels[0];
+    broken.Timestep = 3;
+    broken.features.map().erase("second");
+    pgmlink::add(ts, broken);
+    BOOST_CHECK_THROW( pgmlink::RF::predict_traxels(ts, rf, sel, 1, "prediction"), std::runtime_error );
+    BOOST_CHECK_THROW( pgmlink::RF::predict_traxels(ts, rf, sel, 2, "prediction"), std::runtime_error );
+}
+
+
+BOOST_AUTO_TEST_CASE( checkSharedRandomForest )
+{
+    const std::string filename = "@PROJECT_SOURCE_DIR@/tests/xorforest.h5";
+    pgmlink::RF::RandomForestPtr rf1 = pgmlink::RF::getSharedRandomForest(filename);
+    pgmlink::RF::RandomForestPtr rf2 = pgmlink::RF::getSharedRandomForest(filename);
+    BOOST_REQUIRE( rf1 );
+    BOOST_CHECK( rf1 == rf2 );
+    BOOST_CHECK_EQUAL( rf1->class_count(), 2 );
+
+    pgmlink::RF::clearRandomForestCache();
+    pgmlink::RF::RandomForestPtr rf3 = pgmlink::RF::getSharedRandomForest(filename);
+    BOOST_CHECK( rf3 != rf1 );
+    // still usable after it was dropped from the cache
+    BOOST_CHECK_EQUAL( rf1->feature_count(), 2 );
+
+    BOOST_CHECK_THROW( pgmlink::RF::getSharedRandomForest("@PROJECT_SOURCE_DIR@/tests/no_such_forest.h5"), std::runtime_error );
+}
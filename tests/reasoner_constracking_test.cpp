@@ -1,8 +1,12 @@
 #define BOOST_TEST_MODULE reasoner_constracking_test
 
+#include <algorithm>
+#include <cstdio>
 #include <vector>
 #include <iostream>
+#include <map>
 #include <set>
+#include <string>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/floating_point_comparison.hpp>
@@ -1801,3 +1805,814 @@ BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_TranslationVector2 ) {
 	}
 
 }
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Components ) {
+	// three components, far apart:
+	//  t=1      2      3
+	//  o ------ o ---- o
+	//
+	//  o ------ o
+	//           \
+	//            o
+	//
+	//           o ---- o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	const int timesteps[] = { 1, 2, 3, 1, 2, 2, 2, 3 };
+	const double xs[] = { 0, 0, 0, 100, 100, 104, 200, 200 };
+	const double div[] = { 0.1, 0.1, 0.1, 0.9, 0.1, 0.1, 0.1, 0.1 };
+	for (unsigned int i = 0; i < 8; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0; divProb[0] = div[i];
+		t.features["com"] = com; t.features["divProb"] = divProb;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 300, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	std::vector< std::vector<Event> > results[2];
+	for (int with_components = 0; with_components < 2; ++with_components) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov,
+					  true, // with_constraints
+					  1e+75, // cplex_timeout
+					  "none", // event_vector_dump_filename
+					  with_components
+					  );
+		results[with_components] = tracking(ts);
+		for (std::vector< std::vector<Event> >::iterator it = results[with_components].begin();
+		     it != results[with_components].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Windows ) {
+	// two tracks over seven timesteps, one of them divides at t=4:
+	//  t=1   2   3   4   5   6   7
+	//  o - o - o - o - o - o - o
+	//                \
+	//                  o - o - o
+	//  o - o - o - o - o - o - o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	unsigned int id = 1;
+	for (int t = 1; t <= 7; ++t) {
+		const double xs[] = { 0, 100, 6 };
+		for (int track = 0; track < 3; ++track) {
+			if (track == 2 && t < 5) {
+				continue;
+			}
+			Traxel tr;
+			tr.Id = id++; tr.Timestep = t;
+			com[0] = xs[track]; com[1] = 0; com[2] = 0;
+			divProb[0] = (track == 0 && t == 4) ? 0.9 : 0.1;
+			tr.features["com"] = com; tr.features["divProb"] = divProb;
+			add(ts, tr);
+		}
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 8, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	std::vector< std::vector<Event> > results[2];
+	for (int windowed = 0; windowed < 2; ++windowed) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov,
+					  true, // with_constraints
+					  1e+75, // cplex_timeout
+					  "none", // event_vector_dump_filename
+					  false, // with_components
+					  windowed ? 3 : 0, // window_length
+					  1 // window_overlap
+					  );
+		results[windowed] = tracking(ts);
+		for (std::vector< std::vector<Event> >::iterator it = results[windowed].begin();
+		     it != results[windowed].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Tiles ) {
+	// three tracks over five timesteps; the middle one crosses the border
+	// between the tiles at x=50 and lies in the seam
+	//  x=0     45..53     100
+	//  o        o          o
+	//  |         \         |
+	//  ...       ...       ...
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	unsigned int id = 1;
+	for (int t = 1; t <= 5; ++t) {
+		const double xs[] = { 0, 43. + 2 * t, 100 };
+		for (int track = 0; track < 3; ++track) {
+			Traxel tr;
+			tr.Id = id++; tr.Timestep = t;
+			com[0] = xs[track]; com[1] = 0; com[2] = 0;
+			divProb[0] = 0.1;
+			tr.features["com"] = com; tr.features["divProb"] = divProb;
+			add(ts, tr);
+		}
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 6, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	std::vector< std::vector<Event> > results[2];
+	for (int tiled = 0; tiled < 2; ++tiled) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		if (tiled) {
+			tracking.set_tiling(50, 30);
+		}
+		results[tiled] = tracking(ts);
+		for (std::vector< std::vector<Event> >::iterator it = results[tiled].begin();
+		     it != results[tiled].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Tiles_two_borders ) {
+	// a fast track crosses the borders at x=50 and x=100 of three tiles and
+	// passes through both seams; two static tracks span the tiles
+	//  x=0    30  46  62  78  94  110  126    150
+	//  o      o---o---o---o---o---o----o      o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	unsigned int id = 1;
+	for (int t = 1; t <= 7; ++t) {
+		const double xs[] = { 0, 14. + 16 * t, 150 };
+		for (int track = 0; track < 3; ++track) {
+			Traxel tr;
+			tr.Id = id++; tr.Timestep = t;
+			com[0] = xs[track]; com[1] = 0; com[2] = 0;
+			divProb[0] = 0.1;
+			tr.features["com"] = com; tr.features["divProb"] = divProb;
+			add(ts, tr);
+		}
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 8, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	std::vector< std::vector<Event> > results[2];
+	for (int tiled = 0; tiled < 2; ++tiled) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		if (tiled) {
+			tracking.set_tiling(50, 30);
+		}
+		results[tiled] = tracking(ts);
+		for (std::vector< std::vector<Event> >::iterator it = results[tiled].begin();
+		     it != results[tiled].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	// one move per track and timestep, no mergers or divisions
+	BOOST_REQUIRE_EQUAL(results[1].size(), 7u);
+	for (size_t t = 1; t < results[1].size(); ++t) {
+		size_t moves = 0;
+		for (std::vector<Event>::const_iterator e = results[1][t].begin(); e != results[1][t].end(); ++e) {
+			BOOST_CHECK(e->type != Event::Merger && e->type != Event::Division);
+			moves += e->type == Event::Move;
+		}
+		BOOST_CHECK_EQUAL(moves, 3u);
+	}
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_WarmStart ) {
+	//  t=1      2      3
+	//  o ------ o ---- o
+	//            \
+	//             o -- o
+	//
+	//  o ------ o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	const int timesteps[] = { 1, 2, 3, 2, 3, 1, 2 };
+	const double xs[] = { 0, 0, 0, 5, 5, 100, 100 };
+	const double div[] = { 0.1, 0.9, 0.1, 0.1, 0.1, 0.1, 0.1 };
+	for (unsigned int i = 0; i < 7; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0; divProb[0] = div[i];
+		t.features["com"] = com; t.features["divProb"] = divProb;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	std::vector< std::vector<Event> > results[2];
+	for (int warm_start = 0; warm_start < 2; ++warm_start) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov,
+					  true, // with_constraints
+					  1e+75, // cplex_timeout
+					  "none", // event_vector_dump_filename
+					  false, // with_components
+					  0, // window_length
+					  1, // window_overlap
+					  warm_start
+					  );
+		results[warm_start] = tracking(ts);
+		for (std::vector< std::vector<Event> >::iterator it = results[warm_start].begin();
+		     it != results[warm_start].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Checkpoints ) {
+	//  t=1      2      3
+	//  o ------ o ---- o
+	//            \
+	//             o -- o
+	//
+	//  o ------ o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	const int timesteps[] = { 1, 2, 3, 2, 3, 1, 2 };
+	const double xs[] = { 0, 0, 0, 5, 5, 100, 100 };
+	const double div[] = { 0.1, 0.9, 0.1, 0.1, 0.1, 0.1, 0.1 };
+	for (unsigned int i = 0; i < 7; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0; divProb[0] = div[i];
+		t.features["com"] = com; t.features["divProb"] = divProb;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	const std::string prefix = "reasoner_constracking_test";
+	// run 0 writes the checkpoints, run 1 resumes from the hypotheses and
+	// run 2 from the solved graph
+	const TrackingStage stages[] = { HypothesesStage, HypothesesStage, SolvedStage };
+	std::vector< std::vector<Event> > results[3];
+	for (int run = 0; run < 3; ++run) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		tracking.set_with_statistics(true);
+		if (run == 0) {
+			tracking.set_checkpoint_prefix(prefix);
+		} else {
+			tracking.set_resume_checkpoint(checkpoint_filename(prefix, stages[run]));
+		}
+		results[run] = tracking(ts);
+		BOOST_CHECK_EQUAL(tracking.statistics().number_of_nodes, 7u);
+		if (run == 2) {
+			// there is no model to reweight
+			BOOST_CHECK_THROW(tracking.reweight(10.0, 10.0, 1500., 1500., 0), std::runtime_error);
+		}
+		for (std::vector< std::vector<Event> >::iterator it = results[run].begin();
+		     it != results[run].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	for (int run = 1; run < 3; ++run) {
+		BOOST_REQUIRE_EQUAL(results[0].size(), results[run].size());
+		for (size_t t = 0; t < results[0].size(); ++t) {
+			BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+			                              results[run][t].begin(), results[run][t].end());
+		}
+	}
+	std::remove(checkpoint_filename(prefix, HypothesesStage).c_str());
+	std::remove(checkpoint_filename(prefix, SolvedStage).c_str());
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Reweight ) {
+	//  t=1      2      3
+	//  o ------ o ---- o
+	//            \
+	//             o -- o
+	//
+	//  o ------ o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	const int timesteps[] = { 1, 2, 3, 2, 3, 1, 2 };
+	const double xs[] = { 0, 0, 0, 5, 5, 100, 100 };
+	const double div[] = { 0.1, 0.9, 0.1, 0.1, 0.1, 0.1, 0.1 };
+	for (unsigned int i = 0; i < 7; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0; divProb[0] = div[i];
+		t.features["com"] = com; t.features["divProb"] = divProb;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	// run 0 tracks with the second weights, run 1 with the first ones and
+	// then reweights to the second
+	const double division_weights[] = { 10.0, 1000.0 };
+	const double app_costs[] = { 1500., 1. };
+	std::vector< std::vector<Event> > results[2];
+	for (int reweighted = 0; reweighted < 2; ++reweighted) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  division_weights[1 - reweighted], //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  app_costs[1 - reweighted], // disappearance_cost,
+					  app_costs[1 - reweighted], // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		results[reweighted] = tracking(ts);
+		if (reweighted) {
+			results[reweighted] = tracking.reweight(division_weights[1], 10.0, app_costs[1], app_costs[1], 0);
+		}
+		for (std::vector< std::vector<Event> >::iterator it = results[reweighted].begin();
+		     it != results[reweighted].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Statistics ) {
+	//  t=1      2
+	//  o ------ o
+	//
+	//  o ------ o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	const int timesteps[] = { 1, 2, 1, 2 };
+	const double xs[] = { 0, 0, 100, 100 };
+	for (unsigned int i = 0; i < 4; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0;
+		t.features["com"] = com;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	for (int with_statistics = 0; with_statistics < 2; ++with_statistics) {
+		ConsTracking tracking = ConsTracking(
+					  1, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  false, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		tracking.set_with_statistics(with_statistics);
+		tracking(ts);
+
+		const TrackingStatistics& stats = tracking.statistics();
+		if (!with_statistics) {
+			BOOST_CHECK_EQUAL(stats.number_of_nodes, 0u);
+			BOOST_CHECK_EQUAL(stats.solver.number_of_models, 0u);
+			BOOST_CHECK_EQUAL(stats.infer_seconds, 0.);
+			BOOST_CHECK_EQUAL(stats.solver.status, "not solved");
+			BOOST_CHECK(stats.memory.components.empty());
+			BOOST_CHECK(stats.memory.phases.empty());
+			continue;
+		}
+		BOOST_CHECK_EQUAL(stats.number_of_nodes, 4u);
+		BOOST_CHECK_EQUAL(stats.number_of_arcs, 2u);
+		BOOST_CHECK_EQUAL(stats.solver.number_of_models, 1u);
+		// appearance, disappearance and transition variables
+		BOOST_CHECK_EQUAL(stats.solver.number_of_variables, 10u);
+		BOOST_CHECK(stats.solver.number_of_factors > 0);
+		BOOST_CHECK(stats.solver.number_of_table_entries >= stats.solver.number_of_factors);
+		BOOST_CHECK(stats.solver.number_of_constraints > 0);
+		BOOST_CHECK_EQUAL(stats.solver.status, "optimal");
+		BOOST_CHECK_SMALL(stats.solver.gap(), 1e-6);
+		BOOST_CHECK(stats.infer_seconds >= 0.);
+
+		std::map<std::string, size_t> components;
+		for (size_t i = 0; i < stats.memory.components.size(); ++i) {
+			components[stats.memory.components[i].component] = stats.memory.components[i].bytes;
+		}
+		BOOST_CHECK(components["traxelstore"] > 4 * sizeof(Traxel));
+		BOOST_CHECK(components["graph property node_traxel"] > 4 * sizeof(Traxel));
+		BOOST_CHECK(components["opengm model: explicit functions"] > 0);
+		BOOST_CHECK(components["opengm model: factors"] > 0);
+		BOOST_CHECK(stats.memory.total_bytes() >= components["traxelstore"]);
+		BOOST_REQUIRE(!stats.memory.phases.empty());
+		BOOST_CHECK_EQUAL(stats.memory.phases.back().phase, "ConsTracking: events");
+		BOOST_CHECK(stats.memory.phases.back().peak_rss_kb >= stats.memory.phases.back().rss_kb);
+	}
+
+	SolverStatistics sum;
+	SolverStatistics part;
+	part.number_of_models = 1;
+	part.number_of_variables = 3;
+	part.objective = 2.;
+	part.bound = 1.;
+	part.status = "time limit";
+	sum.add(part);
+	part.status = "optimal";
+	sum.add(part);
+	BOOST_CHECK_EQUAL(sum.number_of_models, 2u);
+	BOOST_CHECK_EQUAL(sum.number_of_variables, 6u);
+	BOOST_CHECK_EQUAL(sum.status, "time limit");
+	BOOST_CHECK_CLOSE(sum.gap(), 0.5, 1e-6);
+}
+
+namespace {
+struct RecordingProgress {
+	explicit RecordingProgress(bool go_on) : go_on(go_on), calls(new std::vector<std::pair<double, double> >()) {}
+	bool operator()(double, double objective, double bound) {
+		calls->push_back(std::make_pair(objective, bound));
+		return go_on;
+	}
+	bool go_on;
+	boost::shared_ptr<std::vector<std::pair<double, double> > > calls;
+};
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_ProgressCallback ) {
+	//  t=1      2      3
+	//  o ------ o ---- o
+	//            \
+	//             o -- o
+	//
+	//  o ------ o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	const int timesteps[] = { 1, 2, 3, 2, 3, 1, 2 };
+	const double xs[] = { 0, 0, 0, 5, 5, 100, 100 };
+	const double div[] = { 0.1, 0.9, 0.1, 0.1, 0.1, 0.1, 0.1 };
+	for (unsigned int i = 0; i < 7; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0; divProb[0] = div[i];
+		t.features["com"] = com; t.features["divProb"] = divProb;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	// run 0 without a callback, run 1 with one that lets the solver
+	// finish and run 2 with one that stops at the first solution
+	RecordingProgress progress[] = { RecordingProgress(true), RecordingProgress(true), RecordingProgress(false) };
+	std::vector< std::vector<Event> > results[3];
+	for (int run = 0; run < 3; ++run) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  10.0, //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  1500., // disappearance_cost,
+					  1500., // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		if (run > 0) {
+			tracking.set_progress_callback(progress[run], 0.5);
+		}
+		results[run] = tracking(ts);
+		for (std::vector< std::vector<Event> >::iterator it = results[run].begin();
+		     it != results[run].end(); ++it) {
+			std::sort(it->begin(), it->end());
+		}
+	}
+
+	BOOST_CHECK(progress[0].calls->empty());
+	BOOST_REQUIRE(!progress[1].calls->empty());
+	BOOST_CHECK_CLOSE(progress[1].calls->back().first, progress[1].calls->back().second, 1e-6);
+	BOOST_CHECK_EQUAL(progress[2].calls->size(), 1u);
+
+	BOOST_REQUIRE_EQUAL(results[0].size(), results[1].size());
+	for (size_t t = 0; t < results[0].size(); ++t) {
+		BOOST_CHECK_EQUAL_COLLECTIONS(results[0][t].begin(), results[0][t].end(),
+		                              results[1][t].begin(), results[1][t].end());
+	}
+	// stopped, but with a solution
+	BOOST_CHECK_EQUAL(results[2].size(), results[0].size());
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_Configurations ) {
+	//  t=1      2      3
+	//  o ------ o ---- o
+	//            \
+	//             o -- o
+	//
+	//  o ------ o
+	TraxelStore ts;
+	feature_array com(feature_array::difference_type(3));
+	feature_array divProb(feature_array::difference_type(1));
+	const int timesteps[] = { 1, 2, 3, 2, 3, 1, 2 };
+	const double xs[] = { 0, 0, 0, 5, 5, 100, 100 };
+	const double div[] = { 0.1, 0.9, 0.1, 0.1, 0.1, 0.1, 0.1 };
+	for (unsigned int i = 0; i < 7; ++i) {
+		Traxel t;
+		t.Id = i + 1; t.Timestep = timesteps[i];
+		com[0] = xs[i]; com[1] = 0; com[2] = 0; divProb[0] = div[i];
+		t.features["com"] = com; t.features["divProb"] = divProb;
+		add(ts, t);
+	}
+
+	FieldOfView fov(0, 0, 0, 0, 4, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+	const double division_weights[] = { 10.0, 1000.0 };
+	const double app_costs[] = { 1500., 1. };
+	std::vector<ConsTrackingParameters> configurations;
+	std::vector< std::vector< std::vector<Event> > > expected;
+	for (int i = 0; i < 2; ++i) {
+		ConsTracking tracking = ConsTracking(
+					  2, // max_number_objects
+					  20, // max_neighbor_distance
+					  0.3, // division_threshold
+					  "none", // random_forest_filename
+					  false, // detection_by_volume
+					  0, // forbidden_cost
+					  0.0, // ep_gap
+					  double(1.1), // avg_obj_size
+					  false, // with_tracklets
+					  division_weights[i], //division_weight
+					  10.0, //transition_weight
+					  true, //with_divisions
+					  app_costs[i], // disappearance_cost,
+					  app_costs[i], // appearance_cost
+					  false, //with_merger_resolution
+					  3, //n_dim
+					  5, //transition_parameter
+					  0, //border_width for app/disapp costs
+					  fov
+					  );
+		expected.push_back(tracking(ts));
+		configurations.push_back(ConsTrackingParameters(division_weights[i], 10.0, app_costs[i], app_costs[i], 0, 0.0));
+	}
+
+	ConsTracking tracking = ConsTracking(
+				  2, // max_number_objects
+				  20, // max_neighbor_distance
+				  0.3, // division_threshold
+				  "none", // random_forest_filename
+				  false, // detection_by_volume
+				  0, // forbidden_cost
+				  0.0, // ep_gap
+				  double(1.1), // avg_obj_size
+				  false, // with_tracklets
+				  10.0, //division_weight
+				  10.0, //transition_weight
+				  true, //with_divisions
+				  0, // disappearance_cost,
+				  0, // appearance_cost
+				  false, //with_merger_resolution
+				  3, //n_dim
+				  5, //transition_parameter
+				  0, //border_width for app/disapp costs
+				  fov
+				  );
+	std::vector< std::vector< std::vector<Event> > > results = tracking.track_configurations(ts, configurations);
+
+	BOOST_REQUIRE_EQUAL(results.size(), 2u);
+	for (size_t i = 0; i < 2; ++i) {
+		BOOST_REQUIRE_EQUAL(results[i].size(), expected[i].size());
+		for (size_t t = 0; t < results[i].size(); ++t) {
+			std::sort(results[i][t].begin(), results[i][t].end());
+			std::sort(expected[i][t].begin(), expected[i][t].end());
+			BOOST_CHECK_EQUAL_COLLECTIONS(results[i][t].begin(), results[i][t].end(),
+			                              expected[i][t].begin(), expected[i][t].end());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE( Tracking_ConservationTracking_BuiltinEnergies ) {
+	//  t=0    1    2
+	//  1 ---- 2 -- 3
+	//          \
+	//           -- 4
+	// the built-in functors are evaluated without boost::function; wrapped
+	// by boost::bind, the same functors take the generic path
+	const double det[][3] = { { 0.1, 0.8, 0.1 }, { 0.1, 0.7, 0.2 },
+	                          { 0.2, 0.7, 0.1 }, { 0.2, 0.7, 0.1 } };
+	const double div[] = { 0.1, 0.8, 0.1, 0.1 };
+	const double dist[] = { 1., 2., 2. };
+	std::vector<size_t> states[2];
+	double objectives[2];
+	for (int generic = 0; generic < 2; ++generic) {
+		HypothesesGraph g;
+		g.add(node_traxel()).add(arc_distance()).add(node_tracklet()).add(tracklet_intern_dist());
+		HypothesesGraph::Node n[4];
+		for (int i = 0; i < 4; ++i) {
+			Traxel t;
+			t.Id = i + 1;
+			t.Timestep = i < 2 ? i : 2;
+			t.features["detProb"] = feature_array(det[i], det[i] + 3);
+			t.features["divProb"] = feature_array(1, div[i]);
+			n[i] = g.add_traxel_node(t);
+		}
+		HypothesesGraph::Arc a[3];
+		a[0] = g.addArc(n[0], n[1]);
+		a[1] = g.addArc(n[1], n[2]);
+		a[2] = g.addArc(n[1], n[3]);
+		for (int i = 0; i < 3; ++i) {
+			g.get(arc_distance()).set(a[i], dist[i]);
+		}
+
+		boost::function<double (const Traxel&, const size_t)> detection = NegLnDetection(10);
+		boost::function<double (const Traxel&, const size_t)> division = NegLnDivision(10);
+		boost::function<double (const double)> transition = NegLnTransition(10);
+		if (generic) {
+			detection = boost::bind<double>(NegLnDetection(10), _1, _2);
+			division = boost::bind<double>(NegLnDivision(10), _1, _2);
+			transition = boost::bind<double>(NegLnTransition(10), _1);
+		}
+		ConservationTracking pgm(2, detection, division, transition, 0, 0.0, false, true,
+		                         ConstantFeature(100.), ConstantFeature(100.));
+		pgm.formulate(g);
+		pgm.infer();
+		pgm.conclude(g);
+		objectives[generic] = pgm.statistics().objective;
+
+		for (int i = 0; i < 4; ++i) {
+			states[generic].push_back(g.get(node_active2())[n[i]]);
+		}
+		for (int i = 0; i < 3; ++i) {
+			states[generic].push_back(g.get(arc_active())[a[i]]);
+		}
+		states[generic].push_back(g.get(division_active())[n[1]]);
+	}
+
+	BOOST_CHECK_EQUAL_COLLECTIONS(states[0].begin(), states[0].end(), states[1].begin(), states[1].end());
+	BOOST_CHECK_CLOSE(objectives[0], objectives[1], 1e-9);
+	// traxel 2 divides
+	BOOST_CHECK_EQUAL(states[0][7], 1u);
+}
@@ -354,3 +354,90 @@ BOOST_AUTO_TEST_CASE( HypothesesGraph_build_hyp_mrf ) {
     prune_inactive(*graph);
 
 }
+
+BOOST_AUTO_TEST_CASE( Chaingraph_LPRelaxation ) {
+    HypothesesGraph g;
+    g.add(node_traxel());
+    // every detection at t=0 may move to every detection at t=1
+    vector<HypothesesGraph::Node> from, to;
+    for (int i = 0; i < 2; ++i) {
+        from.push_back(g.add_node(0));
+    }
+    for (int i = 0; i < 3; ++i) {
+        to.push_back(g.add_node(1));
+    }
+    for (size_t i = 0; i < from.size(); ++i) {
+        for (size_t j = 0; j < to.size(); ++j) {
+            g.addArc(from[i], to[j]);
+        }
+    }
+
+    pgm::chaingraph::ECCV12ModelBuilder b;
+    b.with_detection_vars(ConstantFeature(0), ConstantFeature(100))
+        .appearance(ConstantFeature(50))
+        .disappearance(ConstantFeature(50))
+        .move(ConstantFeature(1))
+        .with_divisions(ConstantFeature(10))
+        .forbidden_cost(1000);
+    Chaingraph mrf(b, true, 0.01, false);
+    mrf.set_lp_relaxation(true);
+    BOOST_CHECK(mrf.lp_relaxation());
+
+    mrf.formulate(g);
+    mrf.infer();
+    mrf.conclude(g);
+
+    // the rounded solution satisfies the hard constraints
+    property_map<node_active, HypothesesGraph::base_graph>::type& active_nodes = g.get(node_active());
+    property_map<arc_active, HypothesesGraph::base_graph>::type& active_arcs = g.get(arc_active());
+    for (HypothesesGraph::NodeIt n(g); n != lemon::INVALID; ++n) {
+        size_t in = 0, out = 0;
+        for (HypothesesGraph::InArcIt a(g, n); a != lemon::INVALID; ++a) {
+            in += active_arcs[a];
+        }
+        for (HypothesesGraph::OutArcIt a(g, n); a != lemon::INVALID; ++a) {
+            out += active_arcs[a];
+        }
+        BOOST_CHECK_LE(in, 1u);
+        BOOST_CHECK_LE(out, 2u);
+    }
+    for (HypothesesGraph::ArcIt a(g); a != lemon::INVALID; ++a) {
+        if (active_arcs[a]) {
+            BOOST_CHECK(active_nodes[g.source(a)]);
+            BOOST_CHECK(active_nodes[g.target(a)]);
+        }
+    }
+
+    const SolverStatistics stats = mrf.statistics();
+    BOOST_CHECK_EQUAL(stats.status, "rounded");
+    BOOST_CHECK_GE(stats.objective, stats.bound - 1e-6);
+    // no forbidden configuration left
+    BOOST_CHECK_LT(stats.objective, 1000);
+}
+
+BOOST_AUTO_TEST_CASE( TrainableModel_SetWeights ) {
+    HypothesesGraph g;
+    g.add(node_traxel());
+    HypothesesGraph::Node n1 = g.add_node(0);
+    HypothesesGraph::Node n2 = g.add_node(1);
+    g.addArc(n1, n2);
+
+    pgm::chaingraph::TrainableModelBuilder b(ConstantFeature(70), ConstantFeature(50), ConstantFeature(20), 0, 0);
+    b.with_detection_vars(ConstantFeature(10), ConstantFeature(90));
+    boost::scoped_ptr<pgm::chaingraph::Model> m(b.build(g));
+
+    // both detected, linked
+    vector<size_t> labels(m->opengm_model->numberOfVariables(), 1);
+    const double energy = m->opengm_model->evaluate(labels.begin());
+    const vector<pgm::OpengmModel::ValueType> move_weights = m->get_weights(pgm::chaingraph::Model::mov_weight);
+    BOOST_REQUIRE_EQUAL(move_weights.size(), 1u);
+    BOOST_CHECK_EQUAL(move_weights[0], 1.);
+
+    // the factors follow the new weight without rebuilding the model
+    m->set_weights(pgm::chaingraph::Model::mov_weight, vector<pgm::OpengmModel::ValueType>(1, 3.));
+    BOOST_CHECK_EQUAL(m->get_weights(pgm::chaingraph::Model::mov_weight)[0], 3.);
+    BOOST_CHECK_CLOSE(m->opengm_model->evaluate(labels.begin()), energy + 2 * 20, 1e-9);
+
+    BOOST_CHECK_THROW(m->set_weights(pgm::chaingraph::Model::mov_weight, vector<pgm::OpengmModel::ValueType>(2, 1.)),
+                      std::invalid_argument);
+}
@@ -0,0 +1,155 @@
+#define BOOST_TEST_MODULE spatial_index_test
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/spatial_index.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  Traxel traxel_at(unsigned int id, double x, double y, double z) {
+    Traxel t(id, 0);
+    feature_array com(3);
+    com[0] = x;
+    com[1] = y;
+    com[2] = z;
+    t.features["com"] = com;
+    return t;
+  }
+
+  double squared_distance(const Traxel& a, const Traxel& b) {
+    const double dx = a.X() - b.X(), dy = a.Y() - b.Y(), dz = a.Z() - b.Z();
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  // brute force knn_in_range() with ties broken by the smaller id
+  map<unsigned int, double> brute_force(const vector<Traxel>& points, const Traxel& query,
+                                        double radius, unsigned int knn) {
+    vector<pair<double, unsigned int> > in_range;
+    for(size_t i = 0; i < points.size(); ++i) {
+      const double d = squared_distance(points[i], query);
+      if(d <= radius * radius) in_range.push_back(make_pair(d, points[i].Id));
+    }
+    sort(in_range.begin(), in_range.end());
+    map<unsigned int, double> ret;
+    for(size_t i = 0; i < in_range.size() && i < knn; ++i) {
+      ret[in_range[i].second] = in_range[i].first;
+    }
+    return ret;
+  }
+
+  vector<Traxel> random_points(size_t n, bool planar) {
+    vector<Traxel> points;
+    for(unsigned int id = 0; id < n; ++id) {
+      points.push_back(traxel_at(id + 1, rand() % 1000 / 10., rand() % 1000 / 10.,
+                                 planar ? 0 : rand() % 300 / 10.));
+    }
+    return points;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( GridNeighborSearch_matches_brute_force )
+{
+  srand(42);
+  for(int planar = 0; planar < 2; ++planar) {
+    const vector<Traxel> points = random_points(500, planar);
+    const vector<Traxel> queries = random_points(100, planar);
+    for(double cell_size = 0; cell_size < 30; cell_size += 7.5) {
+      GridNeighborSearch grid(points.begin(), points.end(), cell_size);
+      BOOST_CHECK_EQUAL(grid.size(), points.size());
+      BOOST_CHECK_EQUAL(grid.dimension(), planar ? 2 : 3);
+      BOOST_CHECK(grid.cell_size() > 0);
+      for(size_t q = 0; q < queries.size(); ++q) {
+        for(unsigned int knn = 0; knn < 8; knn += 3) {
+          map<unsigned int, double> expected = brute_force(points, queries[q], 10., knn);
+          map<unsigned int, double> found = grid.knn_in_range(queries[q], 10., knn);
+          BOOST_REQUIRE_EQUAL(found.size(), expected.size());
+          BOOST_CHECK(found == expected);
+        }
+        BOOST_CHECK_EQUAL(grid.count_in_range(queries[q], 12.),
+                          brute_force(points, queries[q], 12., points.size()).size());
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( GridNeighborSearch_edge_cases )
+{
+  vector<Traxel> points;
+  GridNeighborSearch empty(points.begin(), points.end(), 5.);
+  BOOST_CHECK(empty.knn_in_range(traxel_at(1, 0, 0, 0), 10., 3).empty());
+  BOOST_CHECK_EQUAL(empty.count_in_range(traxel_at(1, 0, 0, 0), 10.), 0);
+
+  points.push_back(traxel_at(3, 1, 1, 0));
+  points.push_back(traxel_at(4, 1, 1, 0));
+  points.push_back(traxel_at(5, 4, 1, 0));
+  GridNeighborSearch grid(points.begin(), points.end(), 1.);
+
+  // radii are inclusive
+  BOOST_CHECK_EQUAL(grid.count_in_range(traxel_at(1, 1, 1, 0), 3.), 3);
+  BOOST_CHECK_EQUAL(grid.count_in_range(traxel_at(1, 1, 1, 0), 0.), 2);
+  // far away and huge radius
+  BOOST_CHECK_EQUAL(grid.count_in_range(traxel_at(1, -1e6, 0, 0), 1.), 0);
+  BOOST_CHECK_EQUAL(grid.count_in_range(traxel_at(1, -1e6, 0, 0), 1e7), 3);
+  // ties go to the smaller id
+  map<unsigned int, double> nearest = grid.knn_in_range(traxel_at(1, 1, 1, 0), 5., 1);
+  BOOST_REQUIRE_EQUAL(nearest.size(), 1);
+  BOOST_CHECK_EQUAL(nearest.begin()->first, 3);
+
+  BOOST_CHECK_THROW(grid.knn_in_range(traxel_at(1, 0, 0, 0), -1., 1), std::invalid_argument);
+  BOOST_CHECK_THROW(grid.count_in_range(traxel_at(1, 0, 0, 0), -1.), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( GridNeighborSearch_reverse_and_batch )
+{
+  // indexed at com_corrected in reverse, queried at com
+  vector<Traxel> points;
+  for(unsigned int id = 1; id <= 20; ++id) {
+    Traxel t = traxel_at(id, id, 0, 0);
+    t.features["com_corrected"] = feature_array(3, 0.);
+    t.features["com_corrected"][0] = 100 + id;
+    points.push_back(t);
+  }
+  GridNeighborSearch forward(points.begin(), points.end(), 2.);
+  GridNeighborSearch reverse(points.begin(), points.end(), 2., true);
+
+  Traxel query = traxel_at(100, 104, 0, 0);
+  query.features["com_corrected"] = feature_array(3, 0.);
+  query.features["com_corrected"][0] = 4;
+  BOOST_CHECK_EQUAL(forward.count_in_range(query, 1.), 3);
+  BOOST_CHECK_EQUAL(reverse.count_in_range(query, 1., true), 3);
+  BOOST_CHECK_EQUAL(reverse.count_in_range(query, 1.), 0);
+
+  vector<const Traxel*> queries;
+  vector<unsigned int> knn;
+  for(size_t i = 0; i < points.size(); i += 4) {
+    queries.push_back(&points[i]);
+    knn.push_back(i % 3);
+  }
+  vector<size_t> offsets;
+  vector<unsigned int> ids;
+  vector<double> distances;
+  forward.knn_in_range(queries, knn, 2.5, offsets, ids, distances);
+  BOOST_REQUIRE_EQUAL(offsets.size(), queries.size() + 1);
+  for(size_t i = 0; i < queries.size(); ++i) {
+    map<unsigned int, double> expected = forward.knn_in_range(*queries[i], 2.5, knn[i]);
+    BOOST_REQUIRE_EQUAL(offsets[i + 1] - offsets[i], expected.size());
+    size_t n = offsets[i];
+    for(map<unsigned int, double>::const_iterator it = expected.begin(); it != expected.end(); ++it, ++n) {
+      BOOST_CHECK_EQUAL(ids[n], it->first);
+      BOOST_CHECK_EQUAL(distances[n], it->second);
+    }
+  }
+  knn.pop_back();
+  BOOST_CHECK_THROW(forward.knn_in_range(queries, knn, 1, offsets, ids, distances), std::invalid_argument);
+}
+
+// EOF
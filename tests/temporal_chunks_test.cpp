@@ -0,0 +1,242 @@
+#define BOOST_TEST_MODULE temporal_chunks_test
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/binary_events.h"
+#include "pgmlink/event.h"
+#include "pgmlink/field_of_view.h"
+#include "pgmlink/temporal_chunks.h"
+#include "pgmlink/tracking.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+namespace {
+  Event event(Event::EventType type, size_t a, size_t b = 0, size_t c = 0) {
+    Event e;
+    e.type = type;
+    e.traxel_ids.push_back(a);
+    if (type == Event::Move || type == Event::Division) e.traxel_ids.push_back(b);
+    if (type == Event::Division) e.traxel_ids.push_back(c);
+    return e;
+  }
+
+  bool contains(const vector<Event>& events, const Event& e) {
+    return find(events.begin(), events.end(), e) != events.end();
+  }
+
+  const string prefix = "temporal_chunks_test";
+}
+
+BOOST_AUTO_TEST_CASE( TemporalChunks_plan )
+{
+  const vector<TemporalChunk> chunks = plan_temporal_chunks(1, 10, 4, 2);
+  BOOST_REQUIRE_EQUAL(chunks.size(), 3u);
+  BOOST_CHECK_EQUAL(chunks[0].own_first, 1);
+  BOOST_CHECK_EQUAL(chunks[0].own_last, 4);
+  BOOST_CHECK_EQUAL(chunks[0].first, 1);
+  BOOST_CHECK_EQUAL(chunks[0].last, 6);
+  BOOST_CHECK_EQUAL(chunks[1].own_first, 5);
+  BOOST_CHECK_EQUAL(chunks[1].own_last, 8);
+  BOOST_CHECK_EQUAL(chunks[1].first, 2);
+  BOOST_CHECK_EQUAL(chunks[1].last, 10);
+  BOOST_CHECK_EQUAL(chunks[2].own_first, 9);
+  BOOST_CHECK_EQUAL(chunks[2].own_last, 10);
+  BOOST_CHECK_EQUAL(chunks[2].first, 6);
+  BOOST_CHECK_EQUAL(chunks[2].last, 10);
+  BOOST_CHECK_EQUAL(chunks[2].origin, 1);
+
+  BOOST_CHECK(plan_temporal_chunks(TraxelStore(), 4, 2).empty());
+  BOOST_CHECK_THROW(plan_temporal_chunks(1, 10, 0, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( TemporalChunks_merge_repairs_seams )
+{
+  // timesteps 0..3 in chunks owning [0, 1] and [2, 3]; traxel 10 is at
+  // t=1, 20 and 21 at t=2 and the seam is between the slots 1 and 2
+  const vector<TemporalChunk> chunks = plan_temporal_chunks(0, 3, 2, 1);
+  BOOST_REQUIRE_EQUAL(chunks.size(), 2u);
+  vector<string> filenames;
+  filenames.push_back(chunk_events_filename(prefix, 0));
+  filenames.push_back(chunk_events_filename(prefix, 1));
+  {
+    // 1 -> 10 -> 2 and 3 -> 11 (which ends)
+    BinaryEventWriter writer(filenames[0]);
+    vector<Event> slot(1, event(Event::Move, 1, 10));
+    slot.push_back(event(Event::Move, 3, 11));
+    writer.timestep(1, slot);
+  }
+  {
+    // the later chunk lets 10 disappear, continues 11 and lets 12,
+    // untracked by the earlier chunk, disappear
+    BinaryEventWriter writer(filenames[1]);
+    vector<Event> slot(1, event(Event::Disappearance, 10));
+    slot.push_back(event(Event::Move, 11, 20));
+    slot.push_back(event(Event::Disappearance, 12));
+    writer.timestep(2, slot);
+    slot.assign(1, event(Event::Move, 20, 30));
+    writer.timestep(3, slot);
+  }
+
+  const vector<vector<Event> > events = merge_temporal_chunks(chunks, filenames);
+  BOOST_REQUIRE_EQUAL(events.size(), 4u);
+  BOOST_CHECK(events[0].empty());
+  BOOST_CHECK_EQUAL(events[1].size(), 2u);
+  BOOST_CHECK_EQUAL(events[2].size(), 2u);
+  BOOST_CHECK(contains(events[2], event(Event::Disappearance, 10)));
+  BOOST_CHECK(contains(events[2], event(Event::Move, 11, 20)));
+  BOOST_CHECK(!contains(events[2], event(Event::Disappearance, 12)));
+  BOOST_CHECK_EQUAL(events[3].size(), 1u);
+
+  // a track continued without an incoming decision appears; one that is
+  // not continued disappears
+  {
+    BinaryEventWriter writer(filenames[1]);
+    vector<Event> slot(1, event(Event::Move, 13, 21));
+    writer.timestep(2, slot);
+  }
+  const vector<vector<Event> > repaired = merge_temporal_chunks(chunks, filenames);
+  BOOST_CHECK(contains(repaired[1], event(Event::Appearance, 13)));
+  BOOST_CHECK(contains(repaired[2], event(Event::Disappearance, 10)));
+  BOOST_CHECK(contains(repaired[2], event(Event::Disappearance, 11)));
+
+  BOOST_CHECK_THROW(merge_temporal_chunks(chunks, vector<string>(1, filenames[0])), std::invalid_argument);
+  remove(filenames[0].c_str());
+  remove(filenames[1].c_str());
+}
+
+BOOST_AUTO_TEST_CASE( TemporalChunks_merge_first_timestep )
+{
+  // one timestep per chunk: the first seam is at the first timestep, whose
+  // slot has no Appearances
+  const vector<TemporalChunk> chunks = plan_temporal_chunks(0, 2, 1, 0);
+  BOOST_REQUIRE_EQUAL(chunks.size(), 3u);
+  vector<string> filenames;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    filenames.push_back(chunk_events_filename(prefix, i));
+  }
+  {
+    BinaryEventWriter writer(filenames[0]);
+    vector<Event> slot;
+    writer.timestep(0, slot);
+  }
+  {
+    BinaryEventWriter writer(filenames[1]);
+    vector<Event> slot(1, event(Event::Move, 1, 10));
+    slot.push_back(event(Event::Disappearance, 2));
+    writer.timestep(1, slot);
+  }
+  {
+    BinaryEventWriter writer(filenames[2]);
+    vector<Event> slot(1, event(Event::Move, 10, 20));
+    writer.timestep(2, slot);
+  }
+
+  const vector<vector<Event> > events = merge_temporal_chunks(chunks, filenames);
+  BOOST_REQUIRE_EQUAL(events.size(), 3u);
+  BOOST_CHECK(events[0].empty());
+  BOOST_CHECK_EQUAL(events[1].size(), 2u);
+  BOOST_CHECK(contains(events[1], event(Event::Disappearance, 2)));
+  BOOST_CHECK_EQUAL(events[2].size(), 1u);
+
+  // the ids of resolved mergers are only known to their chunk
+  {
+    BinaryEventWriter writer(filenames[2]);
+    vector<Event> slot(1, event(Event::Move, 10, 20));
+    Event resolved;
+    resolved.type = Event::ResolvedTo;
+    resolved.traxel_ids.push_back(20);
+    resolved.traxel_ids.push_back(21);
+    resolved.traxel_ids.push_back(22);
+    slot.push_back(resolved);
+    writer.timestep(2, slot);
+  }
+  BOOST_CHECK_THROW(merge_temporal_chunks(chunks, filenames), std::runtime_error);
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    remove(filenames[i].c_str());
+  }
+}
+
+BOOST_AUTO_TEST_CASE( TemporalChunks_ConsTracking )
+{
+  // two tracks over seven timesteps, one of them divides at t=4:
+  //  t=1   2   3   4   5   6   7
+  //  o - o - o - o - o - o - o
+  //                \
+  //                  o - o - o
+  //  o - o - o - o - o - o - o
+  TraxelStore ts;
+  feature_array com(feature_array::difference_type(3));
+  feature_array divProb(feature_array::difference_type(1));
+  unsigned int id = 1;
+  for (int t = 1; t <= 7; ++t) {
+    const double xs[] = { 0, 100, 6 };
+    for (int track = 0; track < 3; ++track) {
+      if (track == 2 && t < 5) {
+        continue;
+      }
+      Traxel tr;
+      tr.Id = id++; tr.Timestep = t;
+      com[0] = xs[track]; com[1] = 0; com[2] = 0;
+      divProb[0] = (track == 0 && t == 4) ? 0.9 : 0.1;
+      tr.features["com"] = com; tr.features["divProb"] = divProb;
+      add(ts, tr);
+    }
+  }
+
+  FieldOfView fov(0, 0, 0, 0, 8, 200, 5, 5); // tlow, xlow, ylow, zlow, tup, xup, yup, zup
+  ConsTracking tracking = ConsTracking(
+                2, // max_number_objects
+                20, // max_neighbor_distance
+                0.3, // division_threshold
+                "none", // random_forest_filename
+                false, // detection_by_volume
+                0, // forbidden_cost
+                0.0, // ep_gap
+                double(1.1), // avg_obj_size
+                false, // with_tracklets
+                10.0, //division_weight
+                10.0, //transition_weight
+                true, //with_divisions
+                1500., // disappearance_cost,
+                1500., // appearance_cost
+                false, //with_merger_resolution
+                3, //n_dim
+                5, //transition_parameter
+                0, //border_width for app/disapp costs
+                fov
+                );
+  TraxelStore whole_ts;
+  add(whole_ts, ts.begin(), ts.end());
+  vector<vector<Event> > whole = tracking(whole_ts);
+  vector<vector<Event> > chunked = track_temporal_chunks(tracking, ts, 3, 2, prefix);
+  // the input is left alone
+  BOOST_CHECK_EQUAL(ts.size(), 17u);
+
+  BOOST_REQUIRE_EQUAL(whole.size(), chunked.size());
+  for (size_t t = 0; t < whole.size(); ++t) {
+    sort(whole[t].begin(), whole[t].end());
+    sort(chunked[t].begin(), chunked[t].end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(whole[t].begin(), whole[t].end(), chunked[t].begin(), chunked[t].end());
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    remove(chunk_events_filename(prefix, i).c_str());
+  }
+
+  // one timestep per chunk, the first seam at the first timestep
+  chunked = track_temporal_chunks(tracking, ts, 1, 2, prefix);
+  BOOST_REQUIRE_EQUAL(whole.size(), chunked.size());
+  for (size_t t = 0; t < whole.size(); ++t) {
+    sort(chunked[t].begin(), chunked[t].end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(whole[t].begin(), whole[t].end(), chunked[t].begin(), chunked[t].end());
+  }
+  for (size_t i = 0; i < 7; ++i) {
+    remove(chunk_events_filename(prefix, i).c_str());
+  }
+}
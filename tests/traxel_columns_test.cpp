@@ -0,0 +1,122 @@
+#define BOOST_TEST_MODULE traxel_columns_test
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "pgmlink/traxel_columns.h"
+#include "pgmlink/traxels.h"
+
+using namespace pgmlink;
+using namespace std;
+
+BOOST_AUTO_TEST_CASE( TraxelColumns_columns )
+{
+  TraxelStore ts;
+  for(int t = 2; t >= 0; --t) {
+    for(unsigned int id = 1; id <= 2; ++id) {
+      Traxel trax(id, t);
+      feature_array com(3);
+      com[0] = t; com[1] = id; com[2] = 0.5;
+      trax.features["com"] = com;
+      if(id == 2) {
+        trax.features["detProb"] = feature_array(2, 0.25);
+      }
+      add(ts, trax);
+    }
+  }
+
+  TraxelColumns columns(ts);
+  BOOST_REQUIRE_EQUAL(columns.size(), 6);
+  BOOST_CHECK_EQUAL(columns.feature_names().size(), 2);
+  BOOST_CHECK_EQUAL(columns.timesteps()[0], 0);
+  BOOST_CHECK_EQUAL(columns.timesteps()[5], 2);
+  BOOST_CHECK_EQUAL(columns.rows(1).first, 2);
+  BOOST_CHECK_EQUAL(columns.rows(1).second, 4);
+  BOOST_CHECK_EQUAL(columns.rows(7).first, columns.rows(7).second);
+
+  const TraxelColumns::Column& com = columns.column("com");
+  BOOST_REQUIRE_EQUAL(com.width(), 3);
+  for(size_t r = 0; r < columns.size(); ++r) {
+    BOOST_CHECK_EQUAL(com.row(r)[0], columns.timesteps()[r]);
+    BOOST_CHECK_EQUAL(com.row(r)[1], columns.ids()[r]);
+    BOOST_CHECK_EQUAL(com.data()[3 * r + 2], 0.5);
+  }
+
+  // missing features are padded
+  const TraxelColumns::Column& det = columns.column("detProb");
+  BOOST_REQUIRE_EQUAL(det.width(), 2);
+  for(size_t r = 0; r < columns.size(); ++r) {
+    if(columns.ids()[r] == 2) {
+      BOOST_CHECK_EQUAL(det.row(r)[1], 0.25);
+    } else {
+      BOOST_CHECK(std::isnan(det.row(r)[0]));
+      BOOST_CHECK(std::isnan(det.row(r)[1]));
+    }
+  }
+  BOOST_CHECK_THROW(columns.column("count"), std::invalid_argument);
+
+  // selected and unknown features
+  vector<string> names;
+  names.push_back("detProb");
+  names.push_back("count");
+  TraxelColumns selected(ts, names);
+  BOOST_CHECK(!selected.has_column("com"));
+  BOOST_REQUIRE(selected.has_column("count"));
+  BOOST_CHECK_EQUAL(selected.column("count").width(), 0);
+  BOOST_CHECK_EQUAL(selected.column("detProb").width(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( add_columns_roundtrip )
+{
+  const int timesteps[] = {1, 0, 1, 0, 2};
+  const unsigned int ids[] = {2, 1, 1, 2, 1};
+  const feature_type nan = numeric_limits<feature_type>::quiet_NaN();
+  feature_type com[5 * 3];
+  for(size_t r = 0; r < 5; ++r) {
+    com[3 * r] = timesteps[r];
+    com[3 * r + 1] = ids[r];
+    com[3 * r + 2] = 0.5;
+  }
+  const feature_type det[] = {0.25, nan, 0.5, nan, nan};
+  vector<FeatureColumnView> features;
+  features.push_back(FeatureColumnView("com", com, 3));
+  features.push_back(FeatureColumnView("detProb", det, 1));
+
+  TraxelStore ts;
+  ts.cache_coordinates();
+  add_columns(ts, 5, timesteps, ids, features);
+  BOOST_REQUIRE_EQUAL(ts.size(), 5);
+  BOOST_CHECK_EQUAL(ts.timestep_counts().find(1)->second, 2);
+
+  const TraxelStoreByTimeid& by_key = ts.get<by_timeid>();
+  TraxelStoreByTimeid::const_iterator t = by_key.find(boost::make_tuple(1, 2u));
+  BOOST_REQUIRE(t != by_key.end());
+  BOOST_CHECK(t->feature_schema() == ts.feature_schema_ptr());
+  BOOST_CHECK(t->has_coordinate_cache());
+  BOOST_CHECK_EQUAL(t->X(), 1);
+  BOOST_CHECK_EQUAL(t->Y(), 2);
+  BOOST_CHECK_EQUAL(t->features.find("detProb")->second[0], 0.25);
+  // a row of NaN is a missing feature
+  t = by_key.find(boost::make_tuple(0, 1u));
+  BOOST_REQUIRE(t != by_key.end());
+  BOOST_CHECK(t->features.find("detProb") == t->features.end());
+  BOOST_CHECK_EQUAL(ts.n_locators(), 1);
+
+  TraxelColumns columns(ts);
+  BOOST_CHECK_EQUAL(columns.column("com").row(4)[0], 2);
+  BOOST_CHECK(std::isnan(columns.column("detProb").row(0)[0]));
+
+  // nothing is added for duplicates
+  BOOST_CHECK_THROW(add_columns(ts, 1, timesteps, ids, features), std::invalid_argument);
+  const int same_timesteps[] = {3, 3};
+  const unsigned int same_ids[] = {1, 1};
+  BOOST_CHECK_THROW(add_columns(ts, 2, same_timesteps, same_ids, features), std::invalid_argument);
+  BOOST_CHECK_EQUAL(ts.size(), 5);
+}
+
+// EOF
@@ -1,5 +1,6 @@
 #define BOOST_TEST_MODULE traxels_test
 
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -128,6 +129,28 @@ BOOST_AUTO_TEST_CASE( Traxel_distance_to )
     BOOST_CHECK_CLOSE( distance, 7.1414284285, 0.01);
  }
 
+BOOST_AUTO_TEST_CASE( Traxel_planar_geometry )
+{
+    Traxel vertex, leg1, leg2;
+    const double coms[3][3] = { { 1, 2, 0 }, { 2, 3, 0 }, { 3, 1, 0 } };
+    Traxel* traxels[3] = { &vertex, &leg1, &leg2 };
+    for (int i = 0; i < 3; ++i) {
+        traxels[i]->features["com"] = feature_array(coms[i], coms[i] + 3);
+    }
+
+    // the same as in 3D for z = 0
+    BOOST_CHECK_EQUAL( vertex.distance_to<2>(leg1), vertex.distance_to(leg1) );
+    BOOST_CHECK_EQUAL( vertex.distance_to<3>(leg1), vertex.distance_to(leg1) );
+    BOOST_CHECK_EQUAL( vertex.distance_to_corr<2>(leg1), vertex.distance_to_corr(leg1) );
+    BOOST_CHECK_CLOSE( vertex.angle<2>(leg1, leg2), vertex.angle(leg1, leg2), 1e-9 );
+    BOOST_CHECK_CLOSE( vertex.angle<3>(leg1, leg2), vertex.angle(leg1, leg2), 1e-9 );
+
+    // z is ignored in 2D
+    leg1.features["com"][2] = 7;
+    BOOST_CHECK_CLOSE( vertex.distance_to<2>(leg1), std::sqrt(2.), 1e-9 );
+    BOOST_CHECK_CLOSE( vertex.distance_to<3>(leg1), vertex.distance_to(leg1), 1e-9 );
+}
+
 BOOST_AUTO_TEST_CASE( Traxel_angle )
 {
     // prepare mock objects
@@ -329,4 +352,504 @@ BOOST_AUTO_TEST_CASE( global_fun_filter_by_fov )
   BOOST_CHECK_EQUAL(ts_out.get<by_timeid>().count(tuple<int, unsigned int>(2,1)), 1);
   BOOST_CHECK_EQUAL(ts_out.get<by_timeid>().count(tuple<int, unsigned int>(1,2)), 1);
 }
+BOOST_AUTO_TEST_CASE( FeatureSchema_intern )
+{
+  FeatureSchema schema;
+  BOOST_CHECK_EQUAL(schema.size(), 0);
+  BOOST_CHECK_EQUAL(schema.slot("com"), FeatureSchema::invalid_slot);
+
+  FeatureSchema::slot_type com = schema.intern("com");
+  FeatureSchema::slot_type count = schema.intern("count");
+  BOOST_CHECK(com != count);
+  BOOST_CHECK_EQUAL(schema.intern("com"), com);
+  BOOST_CHECK_EQUAL(schema.slot("count"), count);
+  BOOST_CHECK_EQUAL(schema.name(com), "com");
+  BOOST_CHECK_EQUAL(schema.size(), 2);
+  BOOST_CHECK_THROW(schema.name(2), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE( Traxel_intern_features )
+{
+  Traxel t;
+  feature_array com(3);
+  com[0] = 1; com[1] = 2; com[2] = 3;
+  t.features["com"] = com;
+  t.features["count"] = feature_array(1, 42);
+  
+  // not interned yet
+  BOOST_CHECK(!t.feature_schema());
+  BOOST_CHECK(t.feature(0) == 0);
+  BOOST_CHECK_EQUAL(t.feature_size(0), 0);
+
+  boost::shared_ptr<FeatureSchema> schema(new FeatureSchema);
+  schema->intern("detProb");
+  t.intern_features(schema);
+  BOOST_CHECK(t.feature_schema() == schema);
+  BOOST_CHECK_EQUAL(schema->size(), 3);
+
+  FeatureSchema::slot_type com_slot = schema->slot("com");
+  BOOST_REQUIRE_EQUAL(t.feature_size(com_slot), 3);
+  BOOST_CHECK_EQUAL(t.feature(com_slot)[0], 1);
+  BOOST_CHECK_EQUAL(t.feature(com_slot)[2], 3);
+  BOOST_REQUIRE_EQUAL(t.feature_size(schema->slot("count")), 1);
+  BOOST_CHECK_EQUAL(t.feature(schema->slot("count"))[0], 42);
+  BOOST_CHECK(t.feature(schema->slot("detProb")) == 0);
+  BOOST_CHECK(t.feature(FeatureSchema::invalid_slot) == 0);
+
+  // compatibility: map access still works and copies keep the packed features
+  BOOST_CHECK_EQUAL(t.features.find("com")->second[1], 2);
+  Traxel copy(t);
+  BOOST_CHECK_EQUAL(copy.feature(com_slot)[1], 2);
+  Traxel assigned;
+  assigned = t;
+  BOOST_CHECK_EQUAL(assigned.feature(com_slot)[1], 2);
+}
+
+BOOST_AUTO_TEST_CASE( Traxel_set_feature )
+{
+  Traxel t;
+  t.features["com"] = feature_array(3, 1);
+  boost::shared_ptr<FeatureSchema> schema(new FeatureSchema);
+  t.intern_features(schema);
+  t.cache_coordinates();
+
+  // the interned copy and the coordinate cache follow the edits
+  t.set_feature("detProb", feature_array(2, 0.5));
+  BOOST_REQUIRE_EQUAL(t.feature_size(schema->slot("detProb")), 2);
+  BOOST_CHECK_EQUAL(t.feature(schema->slot("detProb"))[1], 0.5);
+  t.set_feature_value("com", 0, 4);
+  BOOST_CHECK_EQUAL(t.feature(schema->slot("com"))[0], 4);
+  BOOST_CHECK_EQUAL(t.features["com"][0], 4);
+  BOOST_CHECK(t.has_coordinate_cache());
+  BOOST_CHECK_EQUAL(t.X(), 4);
+  BOOST_CHECK_THROW(t.set_feature_value("com", 3, 0), std::out_of_range);
+  BOOST_CHECK_THROW(t.set_feature_value("count", 0, 0), std::out_of_range);
+
+  // a direct edit of the map is picked up by the next set_feature_value()
+  t.features["com"] = feature_array(2, 0);
+  t.set_feature_value("com", 1, 7);
+  BOOST_REQUIRE_EQUAL(t.feature_size(schema->slot("com")), 2);
+  BOOST_CHECK_EQUAL(t.feature(schema->slot("com"))[1], 7);
+
+  // not interned: only the map
+  Traxel plain;
+  plain.set_feature("count", feature_array(1, 3));
+  BOOST_CHECK(!plain.feature_schema());
+  BOOST_CHECK_EQUAL(plain.features["count"][0], 3);
+}
+
+BOOST_AUTO_TEST_CASE( FeatureReader_slots_and_maps )
+{
+  boost::shared_ptr<FeatureSchema> schema(new FeatureSchema);
+  Traxel interned, other;
+  interned.features["detProb"] = feature_array(2, 0.25);
+  interned.intern_features(schema);
+  other.features["detProb"] = feature_array(3, 0.75);
+
+  const FeatureReader reader("detProb", schema);
+  size_t size = 0;
+  const feature_type* values = reader(interned, size);
+  BOOST_REQUIRE(values != 0);
+  BOOST_CHECK_EQUAL(size, 2);
+  BOOST_CHECK(values == interned.feature(schema->slot("detProb")));
+  values = reader(other, size);
+  BOOST_REQUIRE(values != 0);
+  BOOST_CHECK_EQUAL(size, 3);
+  BOOST_CHECK_EQUAL(values[2], 0.75);
+  BOOST_CHECK(FeatureReader("count", schema)(interned, size) == 0);
+  BOOST_CHECK_EQUAL(size, 0);
+  BOOST_CHECK(FeatureReader("detProb", boost::shared_ptr<FeatureSchema>())(other, size) != 0);
+}
+
+BOOST_AUTO_TEST_CASE( TraxelStore_interns_on_add )
+{
+  Traxel t1, t2;
+  t1.Timestep = 0; t1.Id = 1;
+  t1.features["com"] = feature_array(3, 1);
+  t2.Timestep = 1; t2.Id = 1;
+  t2.features["com"] = feature_array(3, 2);
+  t2.features["detProb"] = feature_array(2, 0.5);
+
+  TraxelStore ts;
+  add(ts, t1);
+  add(ts, t2);
+  BOOST_CHECK_EQUAL(ts.feature_schema().size(), 2);
+  FeatureSchema::slot_type det = ts.feature_schema().slot("detProb");
+
+  const Traxel& loaded = *ts.get<by_timeid>().find(boost::make_tuple(1, 1));
+  BOOST_CHECK(loaded.feature_schema() == ts.feature_schema_ptr());
+  BOOST_REQUIRE_EQUAL(loaded.feature_size(det), 2);
+  BOOST_CHECK_CLOSE(loaded.feature(det)[1], 0.5, 0.0001);
+  BOOST_CHECK(ts.get<by_timeid>().find(boost::make_tuple(0, 1))->feature(det) == 0);
+
+  // archives only carry the feature maps; loading interns again
+  string s;
+  {
+    stringstream ss;
+    boost::archive::text_oarchive oa(ss);
+    oa & ts;
+    s = ss.str();
+  }
+  TraxelStore ts_loaded;
+  {
+    stringstream ss(s);
+    boost::archive::text_iarchive ia(ss);
+    ia & ts_loaded;
+  }
+  BOOST_CHECK_EQUAL(ts_loaded.size(), 2);
+  FeatureSchema::slot_type com = ts_loaded.feature_schema().slot("com");
+  BOOST_REQUIRE(com != FeatureSchema::invalid_slot);
+  const Traxel& t = *ts_loaded.get<by_timeid>().find(boost::make_tuple(1, 1));
+  BOOST_REQUIRE_EQUAL(t.feature_size(com), 3);
+  BOOST_CHECK_EQUAL(t.feature(com)[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE( Traxel_cache_coordinates )
+{
+  Traxel t;
+  feature_array com(3);
+  com[0] = 1; com[1] = 2; com[2] = 3;
+  t.features["com"] = com;
+  t.locator()->x_scale = 2.;
+
+  BOOST_CHECK(!t.has_coordinate_cache());
+  t.cache_coordinates();
+  BOOST_CHECK(t.has_coordinate_cache());
+  BOOST_CHECK_EQUAL(t.X(), 2.);
+  BOOST_CHECK_EQUAL(t.Y(), 2.);
+  BOOST_CHECK_EQUAL(t.Z(), 3.);
+  // no com_corrected: corrected positions fall back to the plain ones
+  BOOST_CHECK_EQUAL(t.X_corr(), 2.);
+
+  // copies keep the cache
+  Traxel copy(t);
+  BOOST_CHECK(copy.has_coordinate_cache());
+  BOOST_CHECK_EQUAL(copy.X(), 2.);
+
+  // feature edits are picked up by update_coordinate_cache()
+  t.features["com"][1] = 5;
+  BOOST_CHECK_EQUAL(t.Y(), 2.);
+  t.update_coordinate_cache();
+  BOOST_CHECK_EQUAL(t.Y(), 5.);
+
+  // locator access drops the cache
+  t.locator()->x_scale = 3.;
+  BOOST_CHECK(!t.has_coordinate_cache());
+  BOOST_CHECK_EQUAL(t.X(), 3.);
+  t.cache_coordinates();
+  t.set_locator(new ComLocator());
+  BOOST_CHECK(!t.has_coordinate_cache());
+  BOOST_CHECK_EQUAL(t.X(), 1.);
+
+  // nothing to cache without position
+  Traxel no_com;
+  no_com.cache_coordinates();
+  BOOST_CHECK(!no_com.has_coordinate_cache());
+  BOOST_CHECK_THROW(no_com.X(), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE( TraxelStore_cache_coordinates )
+{
+  Traxel t1, t2;
+  t1.Timestep = 0; t1.Id = 1;
+  t1.features["com"] = feature_array(3, 1);
+  t2.Timestep = 1; t2.Id = 1;
+  t2.features["com"] = feature_array(3, 2);
+
+  TraxelStore ts;
+  add(ts, t1);
+  BOOST_CHECK(!ts.caches_coordinates());
+  BOOST_CHECK(!ts.begin()->has_coordinate_cache());
+  ts.cache_coordinates();
+  BOOST_CHECK(ts.begin()->has_coordinate_cache());
+  add(ts, t2);
+  for(TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
+    BOOST_CHECK(it->has_coordinate_cache());
+  }
+  BOOST_CHECK_EQUAL(ts.get<by_timeid>().find(boost::make_tuple(1, 1))->X(), 2.);
+
+  ts.drop_coordinate_caches();
+  BOOST_CHECK(!ts.caches_coordinates());
+  for(TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
+    BOOST_CHECK(!it->has_coordinate_cache());
+  }
+
+  // a scope restores the previous mode
+  {
+    CoordinateCacheScope scope(ts);
+    BOOST_CHECK(ts.caches_coordinates());
+    BOOST_CHECK(ts.begin()->has_coordinate_cache());
+  }
+  BOOST_CHECK(!ts.caches_coordinates());
+  BOOST_CHECK(!ts.begin()->has_coordinate_cache());
+  ts.cache_coordinates();
+  {
+    CoordinateCacheScope scope(ts);
+  }
+  BOOST_CHECK(ts.caches_coordinates());
+  BOOST_CHECK(ts.begin()->has_coordinate_cache());
+}
+
+namespace {
+  struct DoubleCount {
+    void operator()(const Traxel& t, FeatureMap& features) const {
+      if(features.count("count") == 0) {
+        throw std::runtime_error("no count");
+      }
+      features["double_count"] = feature_array(1, 2 * features["count"][0]);
+      features["timestep"] = feature_array(1, t.Timestep);
+    }
+  };
+}
+
+BOOST_AUTO_TEST_CASE( global_fun_modify_features )
+{
+  TraxelStore ts;
+  for(int t = 0; t < 4; ++t) {
+    for(unsigned int id = 0; id < 3; ++id) {
+      Traxel trax(id, t);
+      trax.features["com"] = feature_array(3, id);
+      trax.features["count"] = feature_array(1, 10*t + id);
+      add(ts, trax);
+    }
+  }
+  ts.cache_coordinates();
+
+  // timestep range, serial
+  modify_features(ts, DoubleCount(), 1, 2);
+  FeatureSchema::slot_type slot = ts.feature_schema().slot("double_count");
+  BOOST_REQUIRE(slot != FeatureSchema::invalid_slot);
+  for(TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
+    bool in_range = it->Timestep == 1 || it->Timestep == 2;
+    BOOST_CHECK_EQUAL(it->features.count("double_count"), in_range ? 1u : 0u);
+    BOOST_CHECK_EQUAL(it->feature(slot) != 0, in_range);
+    BOOST_CHECK(it->has_coordinate_cache());
+  }
+  const Traxel& t = *ts.get<by_timeid>().find(boost::make_tuple(2, 1));
+  BOOST_CHECK_EQUAL(t.feature(slot)[0], 42);
+
+  // all timesteps, parallel
+  modify_features(ts, DoubleCount(), true);
+  BOOST_CHECK_EQUAL(ts.size(), 12);
+  for(TraxelStore::iterator it = ts.begin(); it != ts.end(); ++it) {
+    BOOST_REQUIRE_EQUAL(it->feature_size(slot), 1);
+    BOOST_CHECK_EQUAL(it->feature(slot)[0], 2 * it->features.find("count")->second[0]);
+    BOOST_CHECK_EQUAL(it->features.find("timestep")->second[0], it->Timestep);
+  }
+  BOOST_CHECK_EQUAL(ts.get<by_timeid>().count(boost::make_tuple(3, 2)), 1);
+
+  // errors propagate in both modes
+  Traxel no_count(7, 3);
+  add(ts, no_count);
+  BOOST_CHECK_THROW(modify_features(ts, DoubleCount()), std::runtime_error);
+  BOOST_CHECK_THROW(modify_features(ts, DoubleCount(), true), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( Traxel_shared_locators )
+{
+  Traxel t1, t2;
+  BOOST_CHECK_EQUAL(t1.locator_ptr(), t2.locator_ptr());
+  feature_array com(3, 1.);
+  t1.features["com"] = com;
+  t2.features["com"] = com;
+
+  // copies share the locator
+  Traxel copy(t1);
+  BOOST_CHECK_EQUAL(copy.locator_ptr(), t1.locator_ptr());
+
+  // writing through a shared locator copies it
+  copy.locator()->x_scale = 2.;
+  BOOST_CHECK(copy.locator_ptr() != t1.locator_ptr());
+  BOOST_CHECK_EQUAL(copy.X(), 2.);
+  BOOST_CHECK_EQUAL(t1.X(), 1.);
+  BOOST_CHECK_EQUAL(t2.X(), 1.);
+  Locator* unique = copy.locator();
+  BOOST_CHECK_EQUAL(copy.locator(), unique);
+
+  BOOST_CHECK(t1.locator()->equivalent(*t2.locator()));
+  BOOST_CHECK(!copy.locator()->equivalent(*t1.locator()));
+  BOOST_CHECK(!IntmaxposLocator().equivalent(ComLocator()));
+}
+
+BOOST_AUTO_TEST_CASE( TraxelStore_share_locators )
+{
+  TraxelStore ts;
+  feature_array com(3, 1.);
+  for(int i = 0; i < 4; ++i) {
+    Traxel t(i, 0);
+    t.features["com"] = com;
+    if(i % 2) {
+      t.locator()->x_scale = 2.;
+    }
+    add(ts, t);
+  }
+  BOOST_CHECK_EQUAL(ts.n_locators(), 2);
+  const TraxelStoreByTimeid& by_id = ts.get<by_timeid>();
+  BOOST_CHECK_EQUAL(by_id.find(boost::make_tuple(0, 0))->locator_ptr(),
+                    by_id.find(boost::make_tuple(0, 2))->locator_ptr());
+  BOOST_CHECK_EQUAL(by_id.find(boost::make_tuple(0, 1))->locator_ptr(),
+                    by_id.find(boost::make_tuple(0, 3))->locator_ptr());
+  BOOST_CHECK_EQUAL(by_id.find(boost::make_tuple(0, 3))->X(), 2.);
+
+  // sharing survives serialization
+  string s;
+  {
+    stringstream ss;
+    boost::archive::text_oarchive oa(ss);
+    oa << ts;
+    s = ss.str();
+  }
+  TraxelStore loaded;
+  {
+    stringstream ss(s);
+    boost::archive::text_iarchive ia(ss);
+    ia >> loaded;
+  }
+  BOOST_CHECK_EQUAL(loaded.size(), 4);
+  BOOST_CHECK_EQUAL(loaded.n_locators(), 2);
+  const TraxelStoreByTimeid& loaded_by_id = loaded.get<by_timeid>();
+  BOOST_CHECK_EQUAL(loaded_by_id.find(boost::make_tuple(0, 0))->locator_ptr(),
+                    loaded_by_id.find(boost::make_tuple(0, 2))->locator_ptr());
+  BOOST_CHECK_EQUAL(loaded_by_id.find(boost::make_tuple(0, 1))->X(), 2.);
+  BOOST_CHECK_EQUAL(loaded_by_id.find(boost::make_tuple(0, 2))->X(), 1.);
+}
+
+namespace {
+  struct TimestepSetter {
+    explicit TimestepSetter(int timestep) : timestep(timestep) {}
+    void operator()(Traxel& t) const { t.Timestep = timestep; }
+    int timestep;
+  };
+}
+
+BOOST_AUTO_TEST_CASE( TraxelStore_aggregates )
+{
+  TraxelStore ts;
+  BOOST_CHECK_THROW(earliest_timestep(ts), std::runtime_error);
+  BOOST_CHECK_EQUAL(bounding_box(ts).size(), 8);
+  for(int t = 0; t < 3; ++t) {
+    for(int id = 0; id <= t; ++id) {
+      Traxel trax(id, t);
+      feature_array com(3, 1.);
+      com[0] = t; com[1] = -id;
+      trax.features["com"] = com;
+      add(ts, trax);
+    }
+  }
+  BOOST_CHECK_EQUAL(ts.timestep_counts().size(), 3);
+  BOOST_CHECK_EQUAL(ts.timestep_counts().find(2)->second, 3);
+  BOOST_CHECK_EQUAL(earliest_timestep(ts), 0);
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 2);
+  vector<double> bb = bounding_box(ts);
+  BOOST_CHECK_EQUAL(bb[0], 0); BOOST_CHECK_EQUAL(bb[4], 2);
+  BOOST_CHECK_EQUAL(bb[1], 0); BOOST_CHECK_EQUAL(bb[5], 2);
+  BOOST_CHECK_EQUAL(bb[2], -2); BOOST_CHECK_EQUAL(bb[6], 0);
+
+  // maintained by add...
+  Traxel far(0, 5);
+  feature_array com(3, 10.);
+  far.features["com"] = com;
+  add(ts, far);
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 5);
+  BOOST_CHECK_EQUAL(bounding_box(ts)[5], 10);
+  BOOST_CHECK_EQUAL(timesteps(ts).size(), 4);
+
+  // ...and replace
+  Traxel moved(0, 7);
+  moved.features["com"] = feature_array(3, 0.);
+  BOOST_REQUIRE(replace(ts, ts.get<by_timestep>().find(5), moved));
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 7);
+  BOOST_CHECK_EQUAL(ts.timestep_counts().count(5), 0);
+  BOOST_CHECK_EQUAL(bounding_box(ts)[5], 2);
+  BOOST_CHECK_EQUAL(ts.get<by_timeid>().find(boost::make_tuple(7, 0))->feature_schema(), ts.feature_schema_ptr());
+  BOOST_CHECK(!replace(ts, ts.get<by_timestep>().find(7), Traxel(1, 2)));
+
+  // direct index operations drop the aggregates, also if the size stays
+  ts.get<by_timestep>().erase(7);
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 2);
+  Traxel shifted(0, 9);
+  shifted.features["com"] = feature_array(3, -5.);
+  BOOST_REQUIRE(ts.get<by_timeid>().replace(ts.get<by_timeid>().find(boost::make_tuple(2, 2)), shifted));
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 9);
+  BOOST_CHECK_EQUAL(ts.timestep_counts().find(2)->second, 2);
+  BOOST_CHECK_EQUAL(bounding_box(ts)[1], -5);
+  BOOST_CHECK(ts.modify(ts.get<by_timestep>().find(9), TimestepSetter(4)));
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 4);
+
+  // an index taken before the aggregates were cached
+  TraxelStoreByTimestep& held = ts.get<by_timestep>();
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 4);
+  BOOST_CHECK(held.modify(held.find(4), TimestepSetter(6)));
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 6);
+  ts.invalidate_aggregates();
+  BOOST_CHECK_EQUAL(latest_timestep(ts), 6);
+  ts.clear();
+  BOOST_CHECK(ts.timestep_counts().empty());
+}
+
+BOOST_AUTO_TEST_CASE( TraxelFeatures_packed_form )
+{
+  TraxelFeatures f;
+  f["com"] = feature_array(3, 1.);
+  f["empty"] = feature_array();
+  const TraxelFeatures unpacked = f;
+  boost::shared_ptr<FeatureSchema> schema(new FeatureSchema());
+  schema->intern("unused");
+  f.pack(schema);
+  BOOST_REQUIRE(f.packed());
+  BOOST_CHECK(f == unpacked);
+  BOOST_CHECK_EQUAL(f.size(), 2);
+  BOOST_CHECK(f.find("unused") == f.end());
+  BOOST_REQUIRE(f.find("empty") != f.end());
+  BOOST_CHECK(f.find("empty")->second.empty());
+  BOOST_CHECK_EQUAL(f.at("com").size(), 3);
+  BOOST_CHECK_THROW(f.at("unused"), std::out_of_range);
+  size_t n = 0;
+  for(TraxelFeatures::const_iterator it = f.begin(); it != f.end(); ++it) {
+    ++n;
+  }
+  BOOST_CHECK_EQUAL(n, 2);
+
+  // writing unpacks, the schema is kept for packing again
+  f["com"][0] = 2.;
+  BOOST_CHECK(!f.packed());
+  BOOST_CHECK(f.schema() == schema);
+  BOOST_CHECK_EQUAL(f.at("com")[0], 2.);
+  BOOST_CHECK(f != unpacked);
+}
+
+BOOST_AUTO_TEST_CASE( Traxel_keep_features )
+{
+  Traxel t(1, 0);
+  t.features["com"] = feature_array(3, 2.);
+  t.features["detProb"] = feature_array(2, 0.5);
+  t.features["coordinates"] = feature_array(1000, 0.);
+  TraxelStore ts;
+  add(ts, t);
+  Traxel slim = *ts.begin();
+  slim.keep_features(vector<string>(1, "detProb"));
+  BOOST_CHECK_EQUAL(slim.features.size(), 2);
+  BOOST_CHECK(slim.features.count("coordinates") == 0);
+  BOOST_CHECK(slim.features.packed());
+  BOOST_CHECK_EQUAL(slim.X(), 2.);
+  BOOST_CHECK(slim.memory_bytes() < ts.begin()->memory_bytes());
+}
+
+BOOST_AUTO_TEST_CASE( Traxel_memory_bytes )
+{
+  Traxel t(1, 0);
+  const size_t empty = t.memory_bytes();
+  BOOST_CHECK(empty >= sizeof(Traxel));
+  t.features["com"] = feature_array(3, 0.);
+  t.features["coordinates"] = feature_array(1000, 0.);
+  const size_t with_features = t.memory_bytes();
+  BOOST_CHECK(with_features >= empty + 1003 * sizeof(feature_type));
+  TraxelStore ts;
+  add(ts, t);
+  // interned, the values are held once, in the flat buffer
+  BOOST_CHECK(ts.begin()->memory_bytes() >= empty + 1003 * sizeof(feature_type));
+  BOOST_CHECK(ts.begin()->memory_bytes() < with_features + 1003 * sizeof(feature_type));
+  BOOST_CHECK(memory_bytes(ts) > ts.begin()->memory_bytes());
+}
+
 // EOF